@@ -0,0 +1,155 @@
+/*
+ * afc.c - adaptive feed control from spindle load
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Operation
+ *
+ *	Spindle load tracks cut engagement, so holding the load at a setpoint lets
+ *	conservative fixed feeds be replaced by a hotter nominal feed that backs
+ *	off only where the cut actually deepens. Doing this through a host adds a
+ *	serial round trip (~100ms) to every correction; here the whole loop is
+ *	in-firmware: the ADC samples the spindle load signal, the RTC tick runs a
+ *	proportional controller on the error, and the resulting override factor is
+ *	applied by replanning the queued blocks through mp_feed_rate_override() -
+ *	the same incremental replan M50.1 uses, so the runtime is never disturbed.
+ *
+ *	The controller is deliberately simple. Each 10ms tick it filters the new
+ *	sample, converts the load error to a factor step ($afg, per volt per tick),
+ *	and slews the factor by at most the rate bound ($afr). The factor itself is
+ *	clamped to 1.0 +/- the authority bound ($afa), so a failed sensor can never
+ *	stall the feed or push it past what the operator allowed. Corrections only
+ *	accumulate while AFC is enabled ($afe), the spindle is on (runtime model)
+ *	and motion is running; otherwise the factor bleeds back to 1.0 at the same
+ *	rate bound, so the feed returns to programmed without a step change.
+ *
+ *	Replans run from the controller loop (afc_callback), not the RTC tick -
+ *	mp_feed_rate_override() is too heavy for interrupt level. The callback
+ *	applies the factor only when it has moved by AFC_APPLY_DEADBAND, which
+ *	bounds replan frequency to a few per second even while hunting.
+ */
+
+#include "tinyg.h"			// #1
+#include "config.h"			// #2
+#include "canonical_machine.h"
+#include "planner.h"
+#include "text_parser.h"
+#include "util.h"
+#include "afc.h"
+
+#ifdef __AVR
+#include "xmega/xmega_adc.h"
+#endif
+
+afcSingleton_t afc;
+
+static float applied_factor = 1.0;		// factor the queue was last replanned with
+
+/*
+ * afc_init() - initialize the adaptive feed controller and its ADC channel
+ * afc_reset() - clear controller state (factor snaps to 1.0 - use with motion stopped)
+ */
+
+void afc_init()
+{
+	afc_reset();
+#ifdef __AVR
+	adc_init_load(AFC_ADC_CHANNEL);
+#endif
+}
+
+void afc_reset()
+{
+	afc.load_voltage = 0;
+	afc.factor = 1.0;
+	applied_factor = 1.0;
+}
+
+#ifdef __AVR
+/*
+ * afc_rtc_callback() - 10ms control loop, called from the RTC tick ISR
+ *
+ *	Runs at the interrupt level - see the ISR notes in xmega_rtc.c. Only the
+ *	factor crosses to the controller context, and a torn float read at worst
+ *	costs one deadband comparison, so no locking is needed.
+ */
+
+void afc_rtc_callback()
+{
+	float sample = (float)adc_read_load() * afc.scale;		// also starts the next conversion
+	afc.load_voltage += (sample - afc.load_voltage) / (1 << AFC_FILTER_SHIFT);
+
+	float step = afc.rate / 100;				// rate bound per 10ms tick
+
+	if ((afc.enable == false) ||
+		(mr.gm.spindle_mode == SPINDLE_OFF) ||	// spindle off in the runtime model
+		(cm.motion_state != MOTION_RUN)) {
+		if (afc.factor > 1.0 + step) { afc.factor -= step;}			// bleed the correction back
+		else if (afc.factor < 1.0 - step) { afc.factor += step;}	// out so the feed lands where
+		else { afc.factor = 1.0;}									// the program set it
+		return;
+	}
+	float error = afc.load_voltage - afc.target_voltage;	// positive error = overloaded = slow down
+	float correction = -error * afc.gain;
+	correction = min(step, max(-step, correction));
+	afc.factor = min(1.0 + afc.authority, max(1.0 - afc.authority, afc.factor + correction));
+}
+#endif // __AVR
+
+/*
+ * afc_callback() - apply the factor by replanning the queue (controller loop)
+ *
+ *	The factor from the control loop is absolute, so a missed application is
+ *	simply corrected by the next one. While AFC holds the override, M50.1
+ *	replans are overwritten on the next application - the two should not be
+ *	used together.
+ */
+
+stat_t afc_callback()
+{
+	if (fabs(afc.factor - applied_factor) < AFC_APPLY_DEADBAND) { return (STAT_NOOP);}
+	if (cm.machine_state != MACHINE_CYCLE) { return (STAT_NOOP);}
+	applied_factor = afc.factor;
+	mp_feed_rate_override(true, applied_factor);
+	return (STAT_OK);
+}
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_afe[] PROGMEM  = "[afe]  afc enable%17d [0=off,1=on]\n";
+static const char fmt_afv[] PROGMEM  = "[afv]  afc target load%12.2f volts\n";
+static const char fmt_afg[] PROGMEM  = "[afg]  afc gain%19.4f factor/volt\n";
+static const char fmt_afa[] PROGMEM  = "[afa]  afc authority%14.3f factor\n";
+static const char fmt_afr[] PROGMEM  = "[afr]  afc slew rate%14.3f factor/sec\n";
+static const char fmt_afs[] PROGMEM  = "[afs]  afc voltage scale%10.5f volts/count\n";
+static const char fmt_aflv[] PROGMEM = "[aflv] afc load voltage%11.2f volts\n";
+static const char fmt_afof[] PROGMEM = "[afof] afc override factor%8.3f\n";
+
+void afc_print_afe(nvObj_t *nv) { text_print_ui8(nv, fmt_afe);}
+void afc_print_afv(nvObj_t *nv) { text_print_flt(nv, fmt_afv);}
+void afc_print_afg(nvObj_t *nv) { text_print_flt(nv, fmt_afg);}
+void afc_print_afa(nvObj_t *nv) { text_print_flt(nv, fmt_afa);}
+void afc_print_afr(nvObj_t *nv) { text_print_flt(nv, fmt_afr);}
+void afc_print_afs(nvObj_t *nv) { text_print_flt(nv, fmt_afs);}
+void afc_print_aflv(nvObj_t *nv) { text_print_flt(nv, fmt_aflv);}
+void afc_print_afof(nvObj_t *nv) { text_print_flt(nv, fmt_afof);}
+
+#endif // __TEXT_MODE
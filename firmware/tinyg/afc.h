@@ -0,0 +1,92 @@
+/*
+ * afc.h - adaptive feed control from spindle load
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef AFC_H_ONCE
+#define AFC_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define AFC_ADC_CHANNEL 3				// ADCA input pin carrying the spindle load signal
+#define AFC_FILTER_SHIFT 2				// IIR smoothing - each new sample carries 1/4 weight
+#define AFC_APPLY_DEADBAND 0.02			// don't replan the queue for factor changes smaller than this
+
+typedef struct afcSingleton {			// see afc.c for operation
+	// configuration ($af group)
+	uint8_t enable;						// $afe - 0=off, 1=on
+	float target_voltage;				// $afv - spindle load setpoint in volts
+	float gain;							// $afg - override factor change per volt of error, per tick
+	float authority;					// $afa - max deviation of the factor from 1.000
+	float rate;							// $afr - max factor slew rate per second
+	float scale;						// $afs - volts per ADC count (sensor dependent)
+	// state
+	float load_voltage;					// filtered spindle load in volts ($aflv)
+	volatile float factor;				// current override factor - applied by afc_callback() ($afof)
+} afcSingleton_t;
+
+extern afcSingleton_t afc;
+
+/*** function prototypes ***/
+
+void afc_init(void);
+void afc_reset(void);
+stat_t afc_callback(void);				// apply factor changes by replanning the queue
+
+#ifdef __AVR
+void afc_rtc_callback(void);			// called from the RTC tick
+#endif
+
+#ifdef __TEXT_MODE
+
+	void afc_print_afe(nvObj_t *nv);
+	void afc_print_afv(nvObj_t *nv);
+	void afc_print_afg(nvObj_t *nv);
+	void afc_print_afa(nvObj_t *nv);
+	void afc_print_afr(nvObj_t *nv);
+	void afc_print_afs(nvObj_t *nv);
+	void afc_print_aflv(nvObj_t *nv);
+	void afc_print_afof(nvObj_t *nv);
+
+#else
+
+	#define afc_print_afe tx_print_stub
+	#define afc_print_afv tx_print_stub
+	#define afc_print_afg tx_print_stub
+	#define afc_print_afa tx_print_stub
+	#define afc_print_afr tx_print_stub
+	#define afc_print_afs tx_print_stub
+	#define afc_print_aflv tx_print_stub
+	#define afc_print_afof tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// End of include guard: AFC_H_ONCE
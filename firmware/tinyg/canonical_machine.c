@@ -91,6 +91,7 @@
 #include "text_parser.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_spline.h"
 #include "planner.h"
 #include "stepper.h"
 #include "encoder.h"
@@ -99,8 +100,10 @@
 #include "gpio.h"
 #include "switch.h"
 #include "hardware.h"
+#include "diagnostics.h"	// for feedhold event stamping
 #include "util.h"
 #include "xio.h"			// for serial queue flush
+#include "persistence.h"	// for event macros (macro_run_event)
 /*
 #ifdef __cplusplus
 extern "C"{
@@ -169,6 +172,11 @@ uint8_t cm_get_homing_state() { return cm.homing_state;}
 
 void cm_set_motion_state(uint8_t motion_state)
 {
+#ifdef __SR_ADAPTIVE
+	if (cm.motion_state != motion_state) {		// report state transitions as they happen
+		sr_request_status_report(SR_IMMEDIATE_REQUEST);
+	}
+#endif
 	cm.motion_state = motion_state;
 
 	switch (motion_state) {
@@ -220,6 +228,62 @@ void cm_set_model_linenum(uint32_t linenum)
 	nv_add_object((const char_t *)"n");	// then add the line number to the nv list
 }
 
+/*
+ * cm_state_to_core() - compact model state into a planner buffer record
+ * cm_core_to_state() - expand a planner buffer record into a full gcode state
+ *
+ *	These support the slimmed GCodeStateCore_t carried in mpBuf_t. Fields not in
+ *	the core record (work offsets, parameter, etc.) are left alone on expansion -
+ *	the runtime copies are maintained separately by queued commands.
+ */
+void cm_state_to_core(GCodeStateCore_t *core, const GCodeState_t *gcode_state)
+{
+	core->linenum = gcode_state->linenum;
+	core->motion_mode = gcode_state->motion_mode;
+	copy_vector(core->target, gcode_state->target);
+	core->move_time = gcode_state->move_time;
+	core->minimum_time = gcode_state->minimum_time;
+	core->feed_rate = gcode_state->feed_rate;
+	core->spindle_speed = gcode_state->spindle_speed;
+#ifdef __SPINDLE_SYNC
+	core->parameter = gcode_state->parameter;
+#endif
+	core->feed_rate_mode = gcode_state->feed_rate_mode;
+	core->select_plane = gcode_state->select_plane;
+	core->units_mode = gcode_state->units_mode;
+	core->coord_system = gcode_state->coord_system;
+	core->path_control = gcode_state->path_control;
+	core->distance_mode = gcode_state->distance_mode;
+	core->tool = gcode_state->tool;
+	core->mist_coolant = gcode_state->mist_coolant;
+	core->flood_coolant = gcode_state->flood_coolant;
+	core->spindle_mode = gcode_state->spindle_mode;
+}
+
+void cm_core_to_state(GCodeState_t *gcode_state, const GCodeStateCore_t *core)
+{
+	gcode_state->linenum = core->linenum;
+	gcode_state->motion_mode = core->motion_mode;
+	copy_vector(gcode_state->target, core->target);
+	gcode_state->move_time = core->move_time;
+	gcode_state->minimum_time = core->minimum_time;
+	gcode_state->feed_rate = core->feed_rate;
+	gcode_state->spindle_speed = core->spindle_speed;
+#ifdef __SPINDLE_SYNC
+	gcode_state->parameter = core->parameter;
+#endif
+	gcode_state->feed_rate_mode = core->feed_rate_mode;
+	gcode_state->select_plane = core->select_plane;
+	gcode_state->units_mode = core->units_mode;
+	gcode_state->coord_system = core->coord_system;
+	gcode_state->path_control = core->path_control;
+	gcode_state->distance_mode = core->distance_mode;
+	gcode_state->tool = core->tool;
+	gcode_state->mist_coolant = core->mist_coolant;
+	gcode_state->flood_coolant = core->flood_coolant;
+	gcode_state->spindle_mode = core->spindle_mode;
+}
+
 /***********************************************************************************
  * COORDINATE SYSTEMS AND OFFSETS
  * Functions to get, set and report coordinate systems and work offsets
@@ -258,12 +322,45 @@ void cm_set_model_linenum(uint32_t linenum)
 float cm_get_active_coord_offset(uint8_t axis)
 {
 	if (cm.gm.absolute_override == true) return (0);		// no offset if in absolute override mode
+#ifdef __OFFSET_CACHE
+	return (cm.gmx.combined_offset[axis]);
+#else
 	float offset = cm.offset[cm.gm.coord_system][axis];
 	if (cm.gmx.origin_offset_enable == true)
 		offset += cm.gmx.origin_offset[axis];				// includes G5x and G92 components
+#ifdef __TOOL_TABLE
+	if ((axis == AXIS_Z) && (cm.gmx.tool_length_enable == true))
+		offset += cm.gmx.tool_length_offset;				// G43 tool length compensation
+#endif
 	return (offset);
+#endif
 }
 
+#ifdef __OFFSET_CACHE
+/*
+ * cm_update_combined_offsets() - rebuild the combined G5x+G92 offset vector
+ *
+ *	Offsets change rarely (G10, G54-G59, the G92s, $g54x - $g59c sets) while every
+ *	block reads them, so the active coord and origin offsets are resolved into one
+ *	vector at change time and the per-block readers reduce to an array lookup.
+ */
+void cm_update_combined_offsets(void)
+{
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		float offset = cm.offset[cm.gm.coord_system][axis];
+		if (cm.gmx.origin_offset_enable == true) {
+			offset += cm.gmx.origin_offset[axis];			// includes G5x and G92 components
+		}
+#ifdef __TOOL_TABLE
+		if ((axis == AXIS_Z) && (cm.gmx.tool_length_enable == true)) {
+			offset += cm.gmx.tool_length_offset;			// G43 tool length compensation
+		}
+#endif
+		cm.gmx.combined_offset[axis] = offset;
+	}
+}
+#endif
+
 /*
  * cm_get_work_offset() - return a coord offset from the gcode_state
  *
@@ -422,7 +519,11 @@ stat_t cm_deferred_write_callback()
 
 static float _calc_ABC(uint8_t axis, float target[], float flag[])
 {
-	if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
+	if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)
+#ifdef __ROTARY_MODULO
+		|| (cm.a[axis].axis_mode == AXIS_MODULO)
+#endif
+		) {
 		return(target[axis]);	// no mm conversion - it's in degrees
 	}
 	return(_to_millimeters(target[axis]) * 360 / (2 * M_PI * cm.a[axis].radius));
@@ -433,18 +534,56 @@ void cm_set_model_target(float target[], float flag[])
 	uint8_t axis;
 	float tmp = 0;
 
+#ifdef __OFFSET_CACHE
+	// hoist the block-invariant terms so each flagged axis is one multiply-add:
+	// offsets come from the combined vector and the units test is made only once
+	static const float no_offset[AXES] = {0,0,0,0,0,0};
+	const float *offset = (cm.gm.absolute_override == true) ? no_offset : cm.gmx.combined_offset;
+	float scale = (cm.gm.units_mode == INCHES) ? MM_PER_INCH : 1;
+#endif
+
+#ifdef __G68_ROTATION
+	// under G68 the XYZ loop below runs in program space and the result is
+	// rotated into machine space afterwards. G53 blocks bypass the rotation
+	uint8_t rotate = ((cm.gmx.rotation_active == true) && (cm.gm.absolute_override == false));
+	if (rotate) {
+		cm.gm.target[AXIS_X] = cm.gmx.rot_pos[0];	// see cm_set_rotation()
+		cm.gm.target[AXIS_Y] = cm.gmx.rot_pos[1];
+	}
+#endif
 	// process XYZABC for lower modes
 	for (axis=AXIS_X; axis<=AXIS_Z; axis++) {
 		if ((fp_FALSE(flag[axis])) || (cm.a[axis].axis_mode == AXIS_DISABLED)) {
 			continue;		// skip axis if not flagged for update or its disabled
 		} else if ((cm.a[axis].axis_mode == AXIS_STANDARD) || (cm.a[axis].axis_mode == AXIS_INHIBITED)) {
 			if (cm.gm.distance_mode == ABSOLUTE_MODE) {
+#ifdef __OFFSET_CACHE
+				cm.gm.target[axis] = offset[axis] + (target[axis] * scale);
+			} else {
+				cm.gm.target[axis] += target[axis] * scale;
+#else
 				cm.gm.target[axis] = cm_get_active_coord_offset(axis) + _to_millimeters(target[axis]);
 			} else {
 				cm.gm.target[axis] += _to_millimeters(target[axis]);
+#endif
 			}
 		}
 	}
+#ifdef __G68_ROTATION
+	if (rotate) {
+		float px = cm.gm.target[AXIS_X];			// keep the program-space shadow current,
+		float py = cm.gm.target[AXIS_Y];			//  then rotate about the cached center
+		cm.gmx.rot_pos[0] = px;
+		cm.gmx.rot_pos[1] = py;
+		cm.gm.target[AXIS_X] = (cm.gmx.rot_cos * px) - (cm.gmx.rot_sin * py) + cm.gmx.rot_ofs[0];
+		cm.gm.target[AXIS_Y] = (cm.gmx.rot_sin * px) + (cm.gmx.rot_cos * py) + cm.gmx.rot_ofs[1];
+	} else if (cm.gmx.rotation_active == true) {	// G53 moved in machine space - resync the shadow
+		float mx = cm.gm.target[AXIS_X] - cm.gmx.rot_ofs[0];
+		float my = cm.gm.target[AXIS_Y] - cm.gmx.rot_ofs[1];
+		cm.gmx.rot_pos[0] = ( cm.gmx.rot_cos * mx) + (cm.gmx.rot_sin * my);
+		cm.gmx.rot_pos[1] = (-cm.gmx.rot_sin * mx) + (cm.gmx.rot_cos * my);
+	}
+#endif
 	// FYI: The ABC loop below relies on the XYZ loop having been run first
 	for (axis=AXIS_A; axis<=AXIS_C; axis++) {
 		if ((fp_FALSE(flag[axis])) || (cm.a[axis].axis_mode == AXIS_DISABLED)) {
@@ -453,7 +592,23 @@ void cm_set_model_target(float target[], float flag[])
 			tmp = _calc_ABC(axis, target, flag);
 		}
 		if (cm.gm.distance_mode == ABSOLUTE_MODE) {
+#ifdef __ROTARY_MODULO
+			if (cm.a[axis].axis_mode == AXIS_MODULO) {	// resolve the target modulo 360, shortest path
+#ifdef __OFFSET_CACHE
+				float delta = fmod((tmp + offset[axis]) - cm.gm.target[axis], (float)360);
+#else
+				float delta = fmod((tmp + cm_get_active_coord_offset(axis)) - cm.gm.target[axis], (float)360);
+#endif
+				if (delta > 180) { delta -= 360; }
+				else if (delta < -180) { delta += 360; }
+				cm.gm.target[axis] += delta;			// incremental moves (G91) still wind explicitly
+			} else
+#endif
+#ifdef __OFFSET_CACHE
+			cm.gm.target[axis] = tmp + offset[axis];			// sacidu93's fix to Issue #22
+#else
 			cm.gm.target[axis] = tmp + cm_get_active_coord_offset(axis); // sacidu93's fix to Issue #22
+#endif
 		} else {
 			cm.gm.target[axis] += tmp;
 		}
@@ -470,6 +625,46 @@ void cm_set_model_target(float target[], float flag[])
  *	value is < -1000000 (negative one million). This allows a single end to be tested w/the other
  *	disabled, should that requirement ever arise.
  */
+#ifdef __SOFT_LIMIT_CACHE
+/*
+ *	This runs on every planned block, so the eligibility logic (enable flag, homed
+ *	state, min/max equality, disabled bounds) is hoisted out of the test and into
+ *	cm_update_soft_limits(), which rebuilds the precomputed travel windows whenever
+ *	any of those inputs change - $sl, travel min/max settings, and homing state
+ *	transitions. The per-move test reduces to two compares per active axis, and
+ *	falls straight through on the common all-disabled case.
+ */
+stat_t cm_test_soft_limits(float target[])
+{
+	uint8_t axes = cm.limit_axes;					// zero unless enabled, homed and configured
+	for (uint8_t axis = AXIS_X; axes != 0; axis++, axes >>= 1) {
+		if (axes & 0x01) {
+			if ((target[axis] < cm.limit_min[axis]) || (target[axis] > cm.limit_max[axis])) {
+				return (STAT_SOFT_LIMIT_EXCEEDED);
+			}
+		}
+	}
+	return (STAT_OK);
+}
+
+void cm_update_soft_limits()
+{
+	cm.limit_axes = 0;
+	if (cm.soft_limit_enable != true) return;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		if (cm.homed[axis] != true) continue;		// don't test axes that are not homed
+		if (fp_EQ(cm.a[axis].travel_min, cm.a[axis].travel_max)) continue;
+		if ((cm.a[axis].travel_min < DISABLE_SOFT_LIMIT) &&
+			(cm.a[axis].travel_max < DISABLE_SOFT_LIMIT)) continue;
+
+		cm.limit_min[axis] = (cm.a[axis].travel_min > DISABLE_SOFT_LIMIT) ? cm.a[axis].travel_min : -INFINITY;
+		cm.limit_max[axis] = (cm.a[axis].travel_max > DISABLE_SOFT_LIMIT) ? cm.a[axis].travel_max : INFINITY;
+		cm.limit_axes |= (1 << axis);
+	}
+}
+
+#else // not __SOFT_LIMIT_CACHE
+
 stat_t cm_test_soft_limits(float target[])
 {
 	if (cm.soft_limit_enable == true) {
@@ -489,6 +684,7 @@ stat_t cm_test_soft_limits(float target[])
 	}
 	return (STAT_OK);
 }
+#endif // __SOFT_LIMIT_CACHE
 
 /*************************************************************************
  * CANONICAL MACHINING FUNCTIONS
@@ -524,6 +720,9 @@ void canonical_machine_init()
 	cm_set_path_control(cm.path_control);
 	cm_set_distance_mode(cm.distance_mode);
 	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);// always the default
+#ifdef __SPINDLE_CSS
+	cm.gmx.spindle_speed_mode = SPINDLE_RPM_MODE;// always the default (G97)
+#endif
 
 	cm.gmx.block_delete_switch = true;
 
@@ -539,9 +738,19 @@ void canonical_machine_init()
 	cm.machine_state = MACHINE_READY;
 	cm.combined_state = COMBINED_READY;
 
+#ifdef __SOFT_LIMIT_CACHE
+	cm_update_soft_limits();			// build the soft limit windows from the loaded config
+#endif
+#ifdef __AXIS_TABLE
+	mp_update_axis_table();				// build the planner's axis constraint table likewise
+#endif
+
 	// sub-system inits
 	cm_spindle_init();
 	cm_arc_init();
+#ifdef __CUBIC_SPLINE
+	cm_spline_init();
+#endif
 }
 
 /*
@@ -663,6 +872,9 @@ stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[])
 			cm.deferred_write_flag = true;								// persist offsets once machining cycle is over
 		}
 	}
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	return (STAT_OK);
 }
 
@@ -676,7 +888,9 @@ stat_t cm_set_coord_offsets(uint8_t coord_system, float offset[], float flag[])
 stat_t cm_set_coord_system(uint8_t coord_system)
 {
 	cm.gm.coord_system = coord_system;
-
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	float value[AXES] = { (float)coord_system,0,0,0,0,0 };	// pass coordinate system in value[0] element
 	mp_queue_command(_exec_offset, value, value);			// second vector (flags) is not used, so fake it
 	return (STAT_OK);
@@ -760,6 +974,9 @@ static void _exec_absolute_origin(float *value, float *flag)
 			cm.homed[axis] = true;	// G28.3 is not considered homed until you get here
 		}
 	}
+#ifdef __SOFT_LIMIT_CACHE
+	cm_update_soft_limits();
+#endif
 	mp_set_steps_to_runtime_position();
 }
 
@@ -782,6 +999,9 @@ stat_t cm_set_origin_offsets(float offset[], float flag[])
 									  cm.offset[cm.gm.coord_system][axis] - _to_millimeters(offset[axis]);
 		}
 	}
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	// now pass the offset to the callback - setting the coordinate system also applies the offsets
 	float value[AXES] = { (float)cm.gm.coord_system,0,0,0,0,0 }; // pass coordinate system in value[0] element
 	mp_queue_command(_exec_offset, value, value);				  // second vector is not used
@@ -794,6 +1014,9 @@ stat_t cm_reset_origin_offsets()
 	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
 		cm.gmx.origin_offset[axis] = 0;
 	}
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	float value[AXES] = { (float)cm.gm.coord_system,0,0,0,0,0 };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
@@ -802,6 +1025,9 @@ stat_t cm_reset_origin_offsets()
 stat_t cm_suspend_origin_offsets()
 {
 	cm.gmx.origin_offset_enable = 0;
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	float value[AXES] = { (float)cm.gm.coord_system,0,0,0,0,0 };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
@@ -810,11 +1036,62 @@ stat_t cm_suspend_origin_offsets()
 stat_t cm_resume_origin_offsets()
 {
 	cm.gmx.origin_offset_enable = 1;
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
 	float value[AXES] = { (float)cm.gm.coord_system,0,0,0,0,0 };
 	mp_queue_command(_exec_offset, value, value);
 	return (STAT_OK);
 }
 
+#ifdef __G68_ROTATION
+/*
+ * cm_set_rotation()		- G68 rotate the coordinate system in the XY plane
+ * cm_cancel_rotation()		- G69 cancel coordinate rotation
+ *
+ *	G68 X<cx> Y<cy> R<angle> rotates all subsequent XY coordinates by <angle>
+ *	degrees (CCW positive) about the center, given in the current coordinate
+ *	system. Omitted center words default to the current position. The terms
+ *	are cached here - a 2x2 rotation and a fused center translation - so
+ *	cm_set_model_target() applies the rotation as two multiply-adds per block.
+ *	This lets one stored job be played at any rotation (e.g. nesting parts on
+ *	a sheet) instead of re-transforming and re-streaming it per instance.
+ *
+ *	Targets are computed in program space (a shadow of the unrotated position
+ *	is kept so G91 increments and unflagged axes resolve before rotation) and
+ *	rotated on their way to the planner, so soft limits, position reports and
+ *	the planner itself all see true machine coordinates.
+ */
+
+stat_t cm_set_rotation(float angle, uint8_t angle_flag, float center[], float flag[])
+{
+	if (angle_flag == false) { return (STAT_GCODE_GENERIC_INPUT_ERROR);}	// R word is required
+	if (cm.gmx.rotation_active == false) {		// entering rotation - current target is program space
+		cm.gmx.rot_pos[0] = cm.gm.target[AXIS_X];
+		cm.gmx.rot_pos[1] = cm.gm.target[AXIS_Y];
+	}
+	float cx = cm.gmx.rot_pos[0];				// omitted center words default to current position
+	float cy = cm.gmx.rot_pos[1];
+	if (fp_TRUE(flag[AXIS_X])) { cx = cm_get_active_coord_offset(AXIS_X) + _to_millimeters(center[AXIS_X]);}
+	if (fp_TRUE(flag[AXIS_Y])) { cy = cm_get_active_coord_offset(AXIS_Y) + _to_millimeters(center[AXIS_Y]);}
+
+	cm.gmx.rotation_angle = angle;
+	cm.gmx.rot_cos = cos(angle * M_PI / 180);
+	cm.gmx.rot_sin = sin(angle * M_PI / 180);
+	cm.gmx.rot_ofs[0] = cx - (cm.gmx.rot_cos * cx) + (cm.gmx.rot_sin * cy);	// fold the rotate-about-
+	cm.gmx.rot_ofs[1] = cy - (cm.gmx.rot_sin * cx) - (cm.gmx.rot_cos * cy);	//  center translation in
+	cm.gmx.rotation_active = true;
+	return (STAT_OK);
+}
+
+stat_t cm_cancel_rotation()
+{
+	cm.gmx.rotation_active = false;				// gm.target keeps the rotated (machine) coordinates
+	cm.gmx.rotation_angle = 0;
+	return (STAT_OK);
+}
+#endif // __G68_ROTATION
+
 /*****************************
  * Free Space Motion (4.3.4) *
  *****************************/
@@ -919,6 +1196,22 @@ stat_t cm_set_path_control(uint8_t mode)
 	return (STAT_OK);
 }
 
+#ifdef __PATH_CONTROL
+/*
+ * cm_set_path_tolerance() - G64 P<tol>
+ *
+ *	The tolerance persists until the next G64 word; a bare G64 resets it to
+ *	zero, which falls back to the junction deviation settings. See the
+ *	junction velocity and chord blend functions in plan_line.c for use.
+ */
+stat_t cm_set_path_tolerance(float tolerance)
+{
+	if (tolerance < 0) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	cm.path_tolerance = _to_millimeters(tolerance);
+	return (STAT_OK);
+}
+#endif
+
 /*******************************
  * Machining Functions (4.3.6) *
  *******************************/
@@ -960,6 +1253,50 @@ stat_t cm_straight_feed(float target[], float flags[])
 	return (status);
 }
 
+#ifdef __SPINDLE_SYNC
+/*
+ * cm_spindle_sync_feed() - G33 spindle-synchronized straight feed
+ *
+ *	Plans a straight move whose axial advance is locked to spindle rotation at
+ *	'pitch' length units per revolution (the K word). The move is planned like a
+ *	normal feed at the nominal rate (pitch x programmed spindle speed) so vmax
+ *	and jerk sanity checks all apply, but execution paces each segment off the
+ *	spindle encoder instead of the planned velocity profile - see
+ *	_exec_spindle_sync_segment() in plan_exec.c. The pitch rides into the
+ *	planner buffer through the gcode core state (see cm_state_to_core()).
+ */
+
+stat_t cm_spindle_sync_feed(float target[], float flags[], float pitch)
+{
+	pitch = _to_millimeters(pitch);
+	if (pitch < EPSILON) {						// trap missing or zero K word
+		return (STAT_INPUT_LESS_THAN_MIN_VALUE);
+	}
+	if (((cm.gm.spindle_mode != SPINDLE_CW) && (cm.gm.spindle_mode != SPINDLE_CCW)) ||
+		(fp_ZERO(cm.gm.spindle_speed))) {
+		return (STAT_SPINDLE_MUST_BE_TURNING);
+	}
+	cm.gm.motion_mode = MOTION_MODE_SPINDLE_SYNC_FEED;
+	cm.gm.parameter = pitch;					// carried to the runtime in the buffer copy
+	cm_set_model_target(target, flags);
+
+	// test soft limits
+	stat_t status = cm_test_soft_limits(cm.gm.target);
+	if (status != STAT_OK) return (cm_soft_alarm(status));
+
+	// prep and plan the move. The feed rate is swapped for the synchronous
+	// nominal so planning sees a real velocity, then restored so F survives
+	cm_set_work_offsets(&cm.gm);				// capture the fully resolved offsets to the state
+	cm_cycle_start();							// required for homing & other cycles
+	float feed_rate = cm.gm.feed_rate;
+	cm.gm.feed_rate = pitch * cm.gm.spindle_speed;
+	status = mp_aline(&cm.gm);					// send the move to the planner
+	cm.gm.feed_rate = feed_rate;
+	cm_finalize_move();
+	return (status);
+}
+#endif // __SPINDLE_SYNC
+
 /*****************************
  * Spindle Functions (4.3.7) *
  *****************************/
@@ -994,6 +1331,9 @@ stat_t cm_change_tool(uint8_t tool_change)
 {
 	float value[AXES] = { (float)cm.gm.tool_select,0,0,0,0,0 };
 	mp_queue_command(_exec_change_tool, value, value);
+#ifdef __EVENT_MACRO
+	macro_run_event("m6");				// stored tool change sequence, if one is recorded
+#endif
 	return (STAT_OK);
 }
 
@@ -1002,6 +1342,48 @@ static void _exec_change_tool(float *value, float *flag)
 	cm.gm.tool = (uint8_t)value[0];
 }
 
+#ifdef __TOOL_TABLE
+/*
+ * cm_set_tool_length_offset() - G43 Hn / G49
+ * cm_set_tt() - set a $tt1z - $tt9d tool table entry
+ *
+ *	G43 pulls the Z length offset for tool table entry H (or the tool selected
+ *	in the same block when H is omitted - the parser resolves this) into the
+ *	model and folds it into the combined offset vector, so compensation costs
+ *	nothing per block. G49 clears it. Tool table edits refresh a live offset
+ *	so a re-measured tool takes effect without reprogramming G43.
+ */
+stat_t cm_set_tool_length_offset(uint8_t enable, uint8_t h_number)
+{
+	if (enable == false) {							// G49
+		cm.gmx.tool_length_enable = false;
+		cm.gmx.tool_length_offset = 0;
+	} else {
+		if ((h_number == 0) || (h_number > TOOLS)) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+		cm.gmx.tool_length_enable = true;
+		cm.gmx.tool_length_tool = h_number;
+		cm.gmx.tool_length_offset = cm.tt_length[h_number];
+	}
+#ifdef __OFFSET_CACHE
+	cm_update_combined_offsets();
+#endif
+	return (STAT_OK);
+}
+
+stat_t cm_set_tt(nvObj_t *nv)
+{
+	set_flu(nv);
+	if ((cm.gmx.tool_length_enable == true) &&
+		(nv->token[3] == 'z') && ((nv->token[2] - '0') == cm.gmx.tool_length_tool)) {
+		cm.gmx.tool_length_offset = nv->value;		// edited the live entry - refresh
+#ifdef __OFFSET_CACHE
+		cm_update_combined_offsets();
+#endif
+	}
+	return (STAT_OK);
+}
+#endif // __TOOL_TABLE
+
 /***********************************
  * Miscellaneous Functions (4.3.9) *
  ***********************************/
@@ -1013,7 +1395,7 @@ static void _exec_change_tool(float *value, float *flag)
 stat_t cm_mist_coolant_control(uint8_t mist_coolant)
 {
 	float value[AXES] = { (float)mist_coolant,0,0,0,0,0 };
-	mp_queue_command(_exec_mist_coolant_control, value, value);
+	mp_queue_passthru_command(_exec_mist_coolant_control, value, value);	// coolant doesn't affect motion geometry
 	return (STAT_OK);
 }
 static void _exec_mist_coolant_control(float *value, float *flag)
@@ -1036,7 +1418,7 @@ static void _exec_mist_coolant_control(float *value, float *flag)
 stat_t cm_flood_coolant_control(uint8_t flood_coolant)
 {
 	float value[AXES] = { (float)flood_coolant,0,0,0,0,0 };
-	mp_queue_command(_exec_flood_coolant_control, value, value);
+	mp_queue_passthru_command(_exec_flood_coolant_control, value, value);	// coolant doesn't affect motion geometry
 	return (STAT_OK);
 }
 static void _exec_flood_coolant_control(float *value, float *flag)
@@ -1099,8 +1481,7 @@ stat_t cm_feed_rate_override_factor(uint8_t flag)	// M50.1
 {
 	cm.gmx.feed_rate_override_enable = flag;
 	cm.gmx.feed_rate_override_factor = cm.gn.parameter;
-//	mp_feed_rate_override(flag, cm.gn.parameter);	// replan the queue for new feed rate
-	return (STAT_OK);
+	return (mp_feed_rate_override(flag, cm.gn.parameter));	// replan the queue for new feed rate
 }
 
 stat_t cm_traverse_override_enable(uint8_t flag)	// M50.2
@@ -1204,7 +1585,88 @@ void cm_message(char_t *message)
  *		should start to run anything in the planner queue
  */
 
+#ifdef __EVENT_TRACE
+void cm_request_feedhold(void) { cm.feedhold_requested = true; dia_trace_event(DIA_EVENT_FEEDHOLD, cm.motion_state);}
+#else
 void cm_request_feedhold(void) { cm.feedhold_requested = true; }
+#endif
+
+#ifdef __HOLD_ACTIONS
+/*
+ * _process_hold_actions() - run hold-entry / hold-exit park actions
+ *
+ *	Runs from cm_feedhold_sequencing_callback(). Once a feedhold has fully
+ *	stopped, pauses the spindle ($fhp=1) and retracts Z off the work ($fhz,
+ *	clamped to the Z soft limit when one is configured) so the part is not
+ *	burning while the host decides what to do. On cycle start the spindle is
+ *	restored first - the descent doubles as spin-up time - then Z returns and
+ *	lands exactly on the hold point before the hold is released. Motion runs
+ *	on the velocity jog engine, which generates segments directly and leaves
+ *	the held program untouched in the planner queue. Returns true while
+ *	actions are in progress, which locks out the cycle start restart below.
+ *	Holds taken during homing, probing or jogging are left alone. A queue
+ *	flush while parked abandons the program where it is - spindle off and Z
+ *	retracted is the safe place to be left.
+ */
+static uint8_t _process_hold_actions()
+{
+	switch (cm.park_state) {
+
+		case PARK_OFF: {
+			if ((cm.hold_state != FEEDHOLD_HOLD) || (cm.cycle_start_requested == true) ||
+				(cm.cycle_state != CYCLE_MACHINING) || (cm_get_runtime_busy() == true)) {
+				return (false);
+			}
+			if ((cm.fh_z_retract < EPSILON) && (cm.fh_spindle_pause == false)) {
+				return (false);								// no hold actions configured
+			}
+			cm.park_spindle_mode = cm_get_spindle_mode(MODEL);
+			if ((cm.fh_spindle_pause == true) && (cm.park_spindle_mode != SPINDLE_OFF)) {
+				cm_spindle_control_immediate(SPINDLE_OFF);
+			}
+			cm.park_return_z = cm_get_absolute_position(RUNTIME, AXIS_Z);
+			if (cm.fh_z_retract > EPSILON) {
+				float retract_to = cm.park_return_z + cm.fh_z_retract;
+				if ((cm.soft_limit_enable == true) && (cm.a[AXIS_Z].travel_max > DISABLE_SOFT_LIMIT)) {
+					retract_to = min(retract_to, cm.a[AXIS_Z].travel_max);
+				}
+				if (mp_jog_to(AXIS_Z, cm.a[AXIS_Z].velocity_max, retract_to) == true) {
+					cm.park_state = PARK_RETRACT;
+					return (true);
+				}
+			}
+			cm.park_state = PARK_PARKED;					// nothing to retract (or already at the limit)
+			return (true);
+		}
+		case PARK_RETRACT: {
+			if (mp_jog_active() == true) { return (true);}
+			cm_set_motion_state(MOTION_HOLD);				// report as holding, not stopped
+			cm.park_state = PARK_PARKED;
+			return (true);
+		}
+		case PARK_PARKED: {
+			if (cm.hold_state != FEEDHOLD_HOLD) {			// hold was flushed or alarmed out from
+				cm.park_state = PARK_OFF;					//  under us - stay parked; that's the safe spot
+				return (false);
+			}
+			if (cm.cycle_start_requested == false) { return (true);}
+			if ((cm.fh_spindle_pause == true) && (cm.park_spindle_mode != SPINDLE_OFF)) {
+				cm_spindle_control_immediate(cm.park_spindle_mode);	// restore before descending -
+			}														//  the descent is spin-up time
+			mp_jog_to(AXIS_Z, cm.a[AXIS_Z].velocity_max, cm.park_return_z);
+			cm.park_state = PARK_RETURN;
+			return (true);
+		}
+		case PARK_RETURN: {
+			if (mp_jog_active() == true) { return (true);}
+			cm_set_motion_state(MOTION_HOLD);
+			cm.park_state = PARK_OFF;						// fall through to the normal hold release
+			return (false);
+		}
+	}
+	return (false);
+}
+#endif // __HOLD_ACTIONS
 void cm_request_queue_flush(void) { cm.queue_flush_requested = true; }
 void cm_request_cycle_start(void) { cm.cycle_start_requested = true; }
 
@@ -1229,6 +1691,9 @@ stat_t cm_feedhold_sequencing_callback()
 		cm.hold_state == FEEDHOLD_SYNC ||
 		cm.hold_state == FEEDHOLD_PLAN ||
 		cm.hold_state == FEEDHOLD_DECEL;
+#ifdef __HOLD_ACTIONS
+	if (_process_hold_actions() == true) { feedhold_processing = true;}	// park/return locks out the restart
+#endif
 	if ((cm.cycle_start_requested == true) && (cm.queue_flush_requested == false) && !feedhold_processing) {
 		cm.cycle_start_requested = false;
 		cm.hold_state = FEEDHOLD_END_HOLD;
@@ -1320,16 +1785,29 @@ static void _exec_program_finalize(float *value, float *flag)
 		cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);	// G94
 	//	cm_set_motion_mode(MOTION_MODE_STRAIGHT_FEED);	// NIST specifies G1, but we cancel motion mode. Safer.
 		cm_set_motion_mode(MODEL, MOTION_MODE_CANCEL_MOTION_MODE);
+#ifdef __JOB_STATS
+		rpt_request_job_summary();						// schedule the end-of-job stats report
+#endif
 	}
 	sr_request_status_report(SR_IMMEDIATE_REQUEST);		// request a final status report (not unfiltered)
 }
 
 void cm_cycle_start()
 {
+#ifdef __EVENT_MACRO
+	if ((cm.cycle_state == CYCLE_OFF) &&				// a new program is beginning - this is
+		((cm.machine_state == MACHINE_READY) ||			// not a canned cycle and not a resume
+		 (cm.machine_state == MACHINE_PROGRAM_END))) {	// from an M0 program stop
+		macro_run_event("start");			// stored program start sequence, if one is recorded
+	}
+#endif
 	cm.machine_state = MACHINE_CYCLE;
 	if (cm.cycle_state == CYCLE_OFF) {					// don't (re)start homing, probe or other canned cycles
 		cm.cycle_state = CYCLE_MACHINING;
 		qr_init_queue_report();							// clear queue reporting buffer counts
+#ifdef __JOB_STATS
+		rpt_job_stats_start();							// open the end-of-job stats window
+#endif
 	}
 }
 
@@ -1341,6 +1819,56 @@ void cm_cycle_end()
 	}
 }
 
+#ifdef __CYCLE_SNAPSHOT
+/*
+ * cm_cycle_save_state()    - snapshot gcode modal state on canned cycle entry
+ * cm_cycle_restore_state() - restore gcode modal state on canned cycle exit
+ *
+ *	Canned cycles (homing, probing) run in their own modal context - mm units,
+ *	absolute machine coords, etc. - and must put the gcode model back the way
+ *	they found it. Rather than each cycle keeping its own saved_xxx variables
+ *	the state disturbed by cycles is captured here in a pair of slots indexed
+ *	by a depth counter. Entry and exit flip the slot index, so the save and
+ *	restore are a fixed small copy with no per-cycle bookkeeping, and one level
+ *	of cycle nesting is tolerated. A restore with no matching save is a no-op,
+ *	which makes error exit paths that can fire before the cycle has saved
+ *	anything safe to call.
+ */
+
+typedef struct cmCycleSnapshot {		// modal state disturbed by canned cycles
+	uint8_t units_mode;					// G20, G21
+	uint8_t coord_system;				// G54 - G59
+	uint8_t distance_mode;				// G90, G91
+	uint8_t feed_rate_mode;				// G93, G94
+	float feed_rate;					// F word
+} cmCycleSnapshot_t;
+
+static cmCycleSnapshot_t cm_snap[2];	// two slots - supports one level of cycle nesting
+static uint8_t cm_snap_depth = 0;
+
+void cm_cycle_save_state()
+{
+	if (cm_snap_depth >= 2) return;					// deeper nesting would clobber a live slot
+	cmCycleSnapshot_t *s = &cm_snap[cm_snap_depth++];
+	s->units_mode = cm_get_units_mode(ACTIVE_MODEL);
+	s->coord_system = cm_get_coord_system(ACTIVE_MODEL);
+	s->distance_mode = cm_get_distance_mode(ACTIVE_MODEL);
+	s->feed_rate_mode = cm_get_feed_rate_mode(ACTIVE_MODEL);
+	s->feed_rate = cm_get_feed_rate(ACTIVE_MODEL);
+}
+
+void cm_cycle_restore_state()
+{
+	if (cm_snap_depth == 0) return;					// unmatched restore (error exit before save)
+	cmCycleSnapshot_t *s = &cm_snap[--cm_snap_depth];
+	cm_set_units_mode(s->units_mode);
+	cm_set_coord_system(s->coord_system);
+	cm_set_distance_mode(s->distance_mode);
+	cm_set_feed_rate_mode(s->feed_rate_mode);
+	cm.gm.feed_rate = s->feed_rate;
+}
+#endif // __CYCLE_SNAPSHOT
+
 void cm_program_stop()
 {
 	float value[AXES] = { (float)MACHINE_PROGRAM_STOP, 0,0,0,0,0 };
@@ -1357,6 +1885,9 @@ void cm_program_end()
 {
 	float value[AXES] = { (float)MACHINE_PROGRAM_END, 0,0,0,0,0 };
 	mp_queue_command(_exec_program_finalize, value, value);
+#ifdef __EVENT_MACRO
+	macro_run_event("end");				// stored program end sequence, if one is recorded
+#endif
 }
 
 /**************************************
@@ -1384,7 +1915,12 @@ static const char msg_am00[] PROGMEM = "[disabled]";
 static const char msg_am01[] PROGMEM = "[standard]";
 static const char msg_am02[] PROGMEM = "[inhibited]";
 static const char msg_am03[] PROGMEM = "[radius]";
+#ifdef __ROTARY_MODULO
+static const char msg_am04[] PROGMEM = "[modulo]";
+static const char *const msg_am[] PROGMEM = { msg_am00, msg_am01, msg_am02, msg_am03, msg_am04};
+#else
 static const char *const msg_am[] PROGMEM = { msg_am00, msg_am01, msg_am02, msg_am03};
+#endif
 
 static const char msg_g20[] PROGMEM = "G20 - inches mode";
 static const char msg_g21[] PROGMEM = "G21 - millimeter mode";
@@ -1567,8 +2103,7 @@ static int8_t _get_axis_type(const index_t index)
 
 stat_t _get_msg_helper(nvObj_t *nv, const char *const msg_array[], uint8_t value)
 {
-	nv->value = (float)value;
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, value);
 	return(nv_copy_string(nv, (const char_t *)GET_TEXT_ITEM(msg_array, value)));
 }
 
@@ -1589,22 +2124,19 @@ stat_t cm_get_frmo(nvObj_t *nv) { return(_get_msg_helper(nv, msg_frmo, cm_get_fe
 
 stat_t cm_get_toolv(nvObj_t *nv)
 {
-	nv->value = (float)cm_get_tool(ACTIVE_MODEL);
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, cm_get_tool(ACTIVE_MODEL));
 	return (STAT_OK);
 }
 
 stat_t cm_get_mline(nvObj_t *nv)
 {
-	nv->value = (float)cm_get_linenum(MODEL);
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, cm_get_linenum(MODEL));
 	return (STAT_OK);
 }
 
 stat_t cm_get_line(nvObj_t *nv)
 {
-	nv->value = (float)cm_get_linenum(ACTIVE_MODEL);
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, cm_get_linenum(ACTIVE_MODEL));
 	return (STAT_OK);
 }
 
@@ -1676,6 +2208,9 @@ stat_t cm_set_am(nvObj_t *nv)		// axis mode
 		if (nv->value > AXIS_MODE_MAX_ROTARY) { return (STAT_INPUT_EXCEEDS_MAX_VALUE);}
 	}
 	set_ui8(nv);
+#ifdef __AXIS_TABLE
+	mp_update_axis_table();
+#endif
 	return(STAT_OK);
 }
 
@@ -1685,6 +2220,7 @@ stat_t cm_set_am(nvObj_t *nv)		// axis mode
  *
  * cm_set_xjm()		  - set jerk max value
  * cm_set_xjh()		  - set jerk halt value (used by homing and other stops)
+ * cm_set_xjt()		  - set traverse jerk value (used by G0 moves - see __TRAVERSE_JERK)
  *
  *	Jerk values can be rather large, often in the billions. This makes for some pretty big
  *	numbers for people to deal with. Jerk values are stored in the system in truncated format;
@@ -1705,6 +2241,9 @@ void cm_set_axis_jerk(uint8_t axis, float jerk)
 {
 	cm.a[axis].jerk_max = jerk;
 	cm.a[axis].recip_jerk = 1/(jerk * JERK_MULTIPLIER);
+#ifdef __AXIS_TABLE
+	mp_update_axis_table();
+#endif
 }
 
 stat_t cm_set_xjm(nvObj_t *nv)
@@ -1722,6 +2261,79 @@ stat_t cm_set_xjh(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+#ifdef __TRAVERSE_JERK
+stat_t cm_set_xjt(nvObj_t *nv)
+{
+	if (nv->value > JERK_MULTIPLIER) nv->value /= JERK_MULTIPLIER;
+	set_flu(nv);
+	uint8_t axis = _get_axis(nv->index);
+	cm.a[axis].recip_jerk_traverse = 1/(cm.a[axis].jerk_traverse * JERK_MULTIPLIER);
+#ifdef __AXIS_TABLE
+	mp_update_axis_table();
+#endif
+	return(STAT_OK);
+}
+#endif
+
+#ifdef __SOFT_LIMIT_CACHE
+/*
+ * cm_set_sl()  - set soft limit enable and rebuild the precomputed travel windows
+ * cm_set_trv() - set travel min/max and rebuild the precomputed travel windows
+ */
+stat_t cm_set_sl(nvObj_t *nv)
+{
+	set_ui8(nv);
+	cm_update_soft_limits();
+	return(STAT_OK);
+}
+
+stat_t cm_set_trv(nvObj_t *nv)
+{
+	set_flu(nv);
+	cm_update_soft_limits();
+	return(STAT_OK);
+}
+
+stat_t cm_set_trt(nvObj_t *nv)		// rotary variant - no unit conversion
+{
+	set_flt(nv);
+	cm_update_soft_limits();
+	return(STAT_OK);
+}
+#endif
+
+#ifdef __AXIS_TABLE
+/*
+ * cm_set_xvm() - set velocity/feedrate max and rebuild the planner's axis table
+ * cm_set_avm() - rotary variant - no unit conversion
+ */
+stat_t cm_set_xvm(nvObj_t *nv)
+{
+	set_flu(nv);
+	mp_update_axis_table();
+	return(STAT_OK);
+}
+
+stat_t cm_set_avm(nvObj_t *nv)
+{
+	set_flt(nv);
+	mp_update_axis_table();
+	return(STAT_OK);
+}
+#endif
+
+#ifdef __OFFSET_CACHE
+/*
+ * cm_set_ofs() - set a $g54x - $g59c coordinate offset and rebuild the combined vector
+ */
+stat_t cm_set_ofs(nvObj_t *nv)
+{
+	set_flu(nv);
+	cm_update_combined_offsets();
+	return(STAT_OK);
+}
+#endif
+
 /*
  * Commands
  *
@@ -1780,6 +2392,15 @@ float cm_get_jogging_dest(void)
 	return cm.jogging_dest;
 }
 
+#ifdef __MPG_WHEEL
+stat_t cm_set_mpga(nvObj_t *nv)		// $mpga - handwheel axis with range validation
+{
+	if ((uint8_t)nv->value >= AXES)
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+	return (set_ui8(nv));
+}
+#endif
+
 stat_t cm_run_jogx(nvObj_t *nv)
 {
 	set_flt(nv);
@@ -1874,19 +2495,33 @@ void cm_print_gdi(nvObj_t *nv) { text_print_int(nv, fmt_gdi);}
 
 const char fmt_ja[] PROGMEM = "[ja]  junction acceleration%8.0f%s\n";
 const char fmt_ct[] PROGMEM = "[ct]  chordal tolerance%17.4f%s\n";
+#ifdef __CHORD_BLEND
+const char fmt_bt[] PROGMEM = "[bt]  blend tolerance%19.4f%s\n";
+#endif
 const char fmt_sl[] PROGMEM = "[sl]  soft limit enable%12d\n";
 const char fmt_ml[] PROGMEM = "[ml]  min line segment%17.3f%s\n";
 const char fmt_ma[] PROGMEM = "[ma]  min arc segment%18.3f%s\n";
 const char fmt_ms[] PROGMEM = "[ms]  min segment time%13.0f uSec\n";
 const char fmt_sa[] PROGMEM = "[sa]  spindle active high/low%12d [0=AH,1=AL]\n";
+#ifdef __HOLD_ACTIONS
+const char fmt_fhz[] PROGMEM = "[fhz] feedhold z retract%16.3f%s [0=disabled]\n";
+const char fmt_fhp[] PROGMEM = "[fhp] feedhold spindle pause%13d [0=run,1=pause]\n";
+#endif
 
 void cm_print_ja(nvObj_t *nv) { text_print_flt_units(nv, fmt_ja, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ct(nvObj_t *nv) { text_print_flt_units(nv, fmt_ct, GET_UNITS(ACTIVE_MODEL));}
+#ifdef __CHORD_BLEND
+void cm_print_bt(nvObj_t *nv) { text_print_flt_units(nv, fmt_bt, GET_UNITS(ACTIVE_MODEL));}
+#endif
 void cm_print_sl(nvObj_t *nv) { text_print_ui8(nv, fmt_sl);}
 void cm_print_ml(nvObj_t *nv) { text_print_flt_units(nv, fmt_ml, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ma(nvObj_t *nv) { text_print_flt_units(nv, fmt_ma, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_ms(nvObj_t *nv) { text_print_flt_units(nv, fmt_ms, GET_UNITS(ACTIVE_MODEL));}
 void cm_print_sa(nvObj_t *nv) { text_print_ui8(nv, fmt_sa);}
+#ifdef __HOLD_ACTIONS
+void cm_print_fhz(nvObj_t *nv) { text_print_flt_units(nv, fmt_fhz, GET_UNITS(ACTIVE_MODEL));}
+void cm_print_fhp(nvObj_t *nv) { text_print_ui8(nv, fmt_fhp);}
+#endif
 
 /*
  * axis print functions
@@ -1921,6 +2556,13 @@ static const char fmt_Xtm[] PROGMEM = "[%s%s] %s travel maximum%17.3f%s\n";
 static const char fmt_Xtn[] PROGMEM = "[%s%s] %s travel minimum%17.3f%s\n";
 static const char fmt_Xjm[] PROGMEM = "[%s%s] %s jerk maximum%15.0f%s/min^3 * 1 million\n";
 static const char fmt_Xjh[] PROGMEM = "[%s%s] %s jerk homing%16.0f%s/min^3 * 1 million\n";
+#ifdef __TRAVERSE_JERK
+static const char fmt_Xjt[] PROGMEM = "[%s%s] %s jerk traverse%14.0f%s/min^3 * 1 million\n";
+#endif
+#ifdef __INPUT_SHAPER
+static const char fmt_Xshf[] PROGMEM = "[%s%s] %s shaper frequency%13.1f Hz [0=off]\n";
+static const char fmt_Xshz[] PROGMEM = "[%s%s] %s shaper damping%17.3f\n";
+#endif
 static const char fmt_Xjd[] PROGMEM = "[%s%s] %s junction deviation%14.4f%s (larger is faster)\n";
 static const char fmt_Xra[] PROGMEM = "[%s%s] %s radius value%20.4f%s\n";
 static const char fmt_Xsn[] PROGMEM = "[%s%s] %s switch min%17d [0=off,1=homing,2=limit,3=limit+homing]\n";
@@ -1934,7 +2576,7 @@ static const char fmt_cpos[] PROGMEM = "[%s%s] %s %s position%18.3f%s\n";
 
 static void _print_axis_ui8(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, (uint8_t)nv->value);
+	text_print_P(format, nv->group, nv->token, nv->group, (uint8_t)nv->value);
 }
 
 static void _print_axis_flt(nvObj_t *nv, const char *format)
@@ -1945,7 +2587,7 @@ static void _print_axis_flt(nvObj_t *nv, const char *format)
 	} else {
 		units = (char *)GET_TEXT_ITEM(msg_units, DEGREE_INDEX);
 	}
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value, units);
+	text_print_P(format, nv->group, nv->token, nv->group, nv->value, units);
 }
 
 static void _print_axis_coord_flt(nvObj_t *nv, const char *format)
@@ -1956,7 +2598,7 @@ static void _print_axis_coord_flt(nvObj_t *nv, const char *format)
 	} else {
 		units = (char *)GET_TEXT_ITEM(msg_units, DEGREE_INDEX);
 	}
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->token, nv->value, units);
+	text_print_P(format, nv->group, nv->token, nv->group, nv->token, nv->value, units);
 }
 
 static void _print_pos(nvObj_t *nv, const char *format, uint8_t units)
@@ -1964,12 +2606,12 @@ static void _print_pos(nvObj_t *nv, const char *format, uint8_t units)
 	char axes[] = {"XYZABC"};
 	uint8_t axis = _get_axis(nv->index);
 	if (axis >= AXIS_A) { units = DEGREES;}
-	fprintf_P(stderr, format, axes[axis], nv->value, GET_TEXT_ITEM(msg_units, units));
+	text_print_P(format, axes[axis], nv->value, GET_TEXT_ITEM(msg_units, units));
 }
 
 void cm_print_am(nvObj_t *nv)	// print axis mode with enumeration string
 {
-	fprintf_P(stderr, fmt_Xam, nv->group, nv->token, nv->group, (uint8_t)nv->value,
+	text_print_P(fmt_Xam, nv->group, nv->token, nv->group, (uint8_t)nv->value,
 	GET_TEXT_ITEM(msg_am, (uint8_t)nv->value));
 }
 
@@ -1979,6 +2621,13 @@ void cm_print_tm(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xtm);}
 void cm_print_tn(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xtn);}
 void cm_print_jm(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjm);}
 void cm_print_jh(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjh);}
+#ifdef __TRAVERSE_JERK
+void cm_print_jt(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjt);}
+#endif
+#ifdef __INPUT_SHAPER		// Hz and damping ratio are unitless - bypass the units helper
+void cm_print_shf(nvObj_t *nv) { text_print_P(fmt_Xshf, nv->group, nv->token, nv->group, nv->value);}
+void cm_print_shz(nvObj_t *nv) { text_print_P(fmt_Xshz, nv->group, nv->token, nv->group, nv->value);}
+#endif
 void cm_print_jd(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xjd);}
 void cm_print_ra(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xra);}
 void cm_print_sn(nvObj_t *nv) { _print_axis_ui8(nv, fmt_Xsn);}
@@ -1989,6 +2638,13 @@ void cm_print_lb(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xlb);}
 void cm_print_zb(nvObj_t *nv) { _print_axis_flt(nv, fmt_Xzb);}
 
 void cm_print_cofs(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cofs);}
+
+#ifdef __TOOL_TABLE
+static const char fmt_ttl[] PROGMEM = "[%s] tool %c length offset%14.3f%s\n";
+static const char fmt_ttd[] PROGMEM = "[%s] tool %c diameter%19.3f%s\n";
+void cm_print_ttl(nvObj_t *nv) { text_print_P(fmt_ttl, nv->token, nv->token[2], nv->value, GET_UNITS(MODEL));}
+void cm_print_ttd(nvObj_t *nv) { text_print_P(fmt_ttd, nv->token, nv->token[2], nv->value, GET_UNITS(MODEL));}
+#endif
 void cm_print_cpos(nvObj_t *nv) { _print_axis_coord_flt(nv, fmt_cpos);}
 
 void cm_print_pos(nvObj_t *nv) { _print_pos(nv, fmt_pos, cm_get_units_mode(MODEL));}
@@ -47,6 +47,15 @@ extern "C"{
 #define _to_millimeters(a) ((cm.gm.units_mode == INCHES) ? (a * MM_PER_INCH) : a)
 
 #define JOGGING_START_VELOCITY ((float)10.0)
+
+#ifdef __MPG_WHEEL
+#define MPG_AXIS_DEFAULT AXIS_X			// axis the handwheel drives until $mpga changes it
+#define MPG_SCALE_DEFAULT ((float)0.01)		// millimeters of travel per wheel detent ($mpgs)
+#endif
+#ifdef __HOLD_ACTIONS
+#define FEEDHOLD_Z_RETRACT ((float)0.0)	// millimeters of Z retract on feedhold; 0 disables ($fhz)
+#define FEEDHOLD_SPINDLE_PAUSE 0		// pause the spindle while holding, restore on resume ($fhp)
+#endif
 #define DISABLE_SOFT_LIMIT (-1000000)
 
 /*****************************************************************************
@@ -110,6 +119,33 @@ typedef struct GCodeState {				// Gcode model state - used by model, planning an
 
 } GCodeState_t;
 
+typedef struct GCodeStateCore {			// compact per-move state carried in each planner buffer
+	uint32_t linenum;					// Gcode block line number
+	uint8_t motion_mode;				// Group1 modal motion for this block
+
+	float target[AXES]; 				// XYZABC where the move should go
+	float move_time;					// optimal time for move given axis constraints
+	float minimum_time;					// minimum time possible for move given axis constraints
+	float feed_rate; 					// F - normalized to millimeters/minute or in inverse time mode
+	float spindle_speed;				// in RPM
+#ifdef __SPINDLE_SYNC
+	float parameter;					// K - thread pitch for spindle-synchronized feed
+#endif
+
+	uint8_t feed_rate_mode;				// modal bytes mirrored so runtime reports stay accurate
+	uint8_t select_plane;
+	uint8_t units_mode;
+	uint8_t coord_system;
+	uint8_t path_control;
+	uint8_t distance_mode;
+	uint8_t tool;
+	uint8_t mist_coolant;
+	uint8_t flood_coolant;
+	uint8_t spindle_mode;
+
+} GCodeStateCore_t;						// work offsets are omitted - runtime offsets are maintained
+										// by the queued _exec_offset() command, not the buffer copy
+
 typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by model and arcs
 	uint16_t magic_start;				// magic number to test memory integrity
 	uint8_t next_action;				// handles G modal group 1 moves & non-modals
@@ -117,6 +153,9 @@ typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by
 
 	float position[AXES];				// XYZABC model position (Note: not used in gn or gf)
 	float origin_offset[AXES];			// XYZABC G92 offsets (Note: not used in gn or gf)
+#ifdef __OFFSET_CACHE
+	float combined_offset[AXES];		// XYZABC resolved G5x+G92 offsets - see cm_update_combined_offsets()
+#endif
 	float g28_position[AXES];			// XYZABC stored machine position for G28
 	float g30_position[AXES];			// XYZABC stored machine position for G30
 
@@ -128,9 +167,26 @@ typedef struct GCodeStateExtended {		// Gcode dynamic state extensions - used by
 
 	uint8_t origin_offset_enable;		// G92 offsets enabled/disabled.  0=disabled, 1=enabled
 	uint8_t block_delete_switch;		// set true to enable block deletes (true is default)
+#ifdef __G68_ROTATION
+	uint8_t rotation_active;			// G68 coordinate rotation is in effect
+	float rotation_angle;				// active rotation angle, in degrees
+	float rot_cos;						// cached 2x2 rotation terms - see cm_set_rotation()
+	float rot_sin;
+	float rot_ofs[2];					// fused center translation - rebuilt only when the rotation changes
+	float rot_pos[2];					// program-space XY shadow of gm.target
+#endif
+#ifdef __TOOL_TABLE
+	uint8_t tool_length_enable;			// G43 enabled / G49 disabled
+	uint8_t tool_length_tool;			// tool table entry the active compensation came from
+	float tool_length_offset;			// active Z compensation, from the tool table
+#endif
 
 	float spindle_override_factor;		// 1.0000 x S spindle speed. Go up or down from there
 	uint8_t	spindle_override_enable;	// TRUE = override enabled
+#ifdef __SPINDLE_CSS
+	uint8_t spindle_speed_mode;			// G96 CSS / G97 RPM - routes the S word (see spindle.c)
+	float css_max_rpm;					// D - model copy, queued with the G96/G97 switch
+#endif
 
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
@@ -170,6 +226,10 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
 	uint8_t tool;						// Tool after T and M6 (tool_select and tool_change)
 	uint8_t tool_select;				// T value - T sets this value
 	uint8_t tool_change;				// M6 tool change flag - moves "tool_select" to "tool"
+#ifdef __TOOL_TABLE
+	uint8_t tool_length_enable;			// G43 TRUE, G49 FALSE - tool length compensation
+	uint8_t h_number;					// H - tool table entry for G43 (0 = use the current tool)
+#endif
 	uint8_t mist_coolant;				// TRUE = mist on (M7), FALSE = off (M9)
 	uint8_t flood_coolant;				// TRUE = flood on (M8), FALSE = off (M9)
 
@@ -177,10 +237,17 @@ typedef struct GCodeInput {				// Gcode model inputs - meaning depends on contex
 	float spindle_speed;				// in RPM
 	float spindle_override_factor;		// 1.0000 x S spindle speed. Go up or down from there
 	uint8_t	spindle_override_enable;	// TRUE = override enabled
+#ifdef __SPINDLE_CSS
+	uint8_t spindle_speed_mode;			// G96 CSS / G97 RPM (see cmSpindleSpeedMode)
+	float css_max_rpm;					// D - RPM cap while G96 is active
+#endif
 
 	float parameter;					// P - parameter used for dwell time in seconds, G10 coord select...
 	float arc_radius;					// R - radius value in arc radius mode
 	float arc_offset[3];  				// IJK - used by arc commands
+#ifdef __CANNED_CYCLES
+	float q_parameter;					// Q - peck depth for G83 (prevailing units)
+#endif
 
 // unimplemented gcode parameters
 //	float cutter_radius;				// D - cutter radius compensation (0 is off)
@@ -200,6 +267,14 @@ typedef struct cmAxis {
 	float travel_min;					// min work envelope for soft limits
 	float jerk_max;						// max jerk (Jm) in mm/min^3 divided by 1 million
 	float jerk_homing;					// homing jerk (Jh) in mm/min^3 divided by 1 million
+#ifdef __INPUT_SHAPER
+	float shaper_freq;					// resonant frequency to cancel, in Hz (0 = no shaping)
+	float shaper_zeta;					// damping ratio of that resonance (typ 0.05 - 0.2)
+#endif
+#ifdef __TRAVERSE_JERK
+	float jerk_traverse;				// traverse jerk (Jt) in mm/min^3 divided by 1 million - used for G0 ramps
+	float recip_jerk_traverse;			// stored reciprocal of traverse jerk - has the million in it
+#endif
 	float recip_jerk;					// stored reciprocal of current jerk value - has the million in it
 	float junction_dev;					// aka cornering delta
 	float radius;						// radius in mm for rotary axis modes
@@ -217,7 +292,34 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	// system group settings
 	float junction_acceleration;		// centripetal acceleration max for cornering
 	float chordal_tolerance;			// arc chordal accuracy setting in mm
+#ifdef __CHORD_BLEND
+	float blend_tolerance;				// polyline blending chord tolerance in mm, 0 = off ($bt)
+#endif
+#ifdef __PATH_CONTROL
+	float path_tolerance;				// G64 P<tol> blend tolerance in mm, 0 = use junction deviation
+#endif
+#ifdef __ADAPTIVE_SEGMENTS
+	float segment_usec_min;				// adaptive segment time lower bound, in uSec ($sgl)
+	float segment_usec_max;				// adaptive segment time upper bound, in uSec ($sgh)
+#endif
+#ifdef __START_GATE
+	float planner_start_ms;				// planned-time depth to buffer before first motion, in ms ($pst)
+#endif
+#ifdef __TRAP_PLAN
+#ifdef __INPUT_SHAPER
+	uint8_t shaper_mode;				// $shm - 0=ZV (2 impulses), 1=ZVD (3 impulses)
+#endif
+	uint8_t plan_profile;				// 0=jerk-limited S-curve, 1=constant-accel trapezoid ($apm)
+	float accel_max;					// trapezoid path acceleration, in mm/min^2 ($amx)
+	float accel_2x;						// 2a - cached for mp_get_target_velocity()
+	float recip_accel_2x;				// 1/2a - cached for mp_get_target_length()
+#endif
 	uint8_t soft_limit_enable;
+#ifdef __SOFT_LIMIT_CACHE
+	uint8_t limit_axes;					// bitmap of axes with an active soft limit test
+	float limit_min[AXES];				// precomputed travel windows. Untested bounds are set
+	float limit_max[AXES];				// to -/+INFINITY so the test needs no per-axis config logic
+#endif
 
 	// hidden system settings
 	float min_segment_len;				// line drawing resolution in mm
@@ -234,6 +336,11 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	// coordinate systems and offsets
 	float offset[COORDS+1][AXES];		// persistent coordinate offsets: absolute (G53) + G54,G55,G56,G57,G58,G59
 
+#ifdef __TOOL_TABLE
+	float tt_length[TOOLS+1];			// persistent tool length offsets (Z), indexed by tool number
+	float tt_diameter[TOOLS+1];			// persistent tool diameters - stored for hosts, not used in motion
+#endif
+
 	// settings for axes X,Y,Z,A B,C
 	cfgAxis_t a[AXES];
 
@@ -250,6 +357,15 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	uint8_t probe_state;				// 1==success, 0==failed
 	float probe_results[AXES];			// probing results
 
+#ifdef __HOMING_CAL
+	uint8_t homing_cal_passes;			// $hcp - latch repeats per axis during homing (0,1 = normal homing)
+	float homing_cal_axis;				// hcl group - results of the last axis calibrated
+	float homing_cal_count;				// samples collected
+	float homing_cal_min;				// lowest latch position relative to the mean, mm
+	float homing_cal_max;				// highest latch position relative to the mean, mm
+	float homing_cal_sdev;				// standard deviation of latch position, mm
+#endif
+
 	uint8_t	g28_flag;					// true = complete a G28 move
 	uint8_t	g30_flag;					// true = complete a G30 move
 	uint8_t deferred_write_flag;		// G10 data has changed (e.g. offsets) - flag to persist them
@@ -257,6 +373,20 @@ typedef struct cmSingleton {			// struct to manage cm globals and cycles
 	uint8_t queue_flush_requested;		// queue flush character has been received
 	uint8_t cycle_start_requested;		// cycle start character has been received (flag to end feedhold)
 	float jogging_dest;					// jogging direction as a relative move from current position
+#ifdef __MPG_WHEEL
+	uint8_t mpg_axis;					// axis the handwheel drives ($mpga)
+	float mpg_scale;					// millimeters of travel per wheel detent ($mpgs)
+#endif
+#ifdef __HOLD_ACTIONS
+	float fh_z_retract;					// millimeters of Z retract on feedhold; 0 disables ($fhz)
+	uint8_t fh_spindle_pause;			// pause the spindle while holding ($fhp)
+#ifdef __SPINDLE_RPM
+	uint8_t spindle_pulses_per_rev;		// $sppr - RPM sensor pulses per spindle revolution
+#endif
+	uint8_t park_state;					// hold entry/exit action sub-state machine
+	uint8_t park_spindle_mode;			// spindle mode captured at hold entry for resume
+	float park_return_z;				// Z position to return to before the hold is released
+#endif
 	struct GCodeState *am;				// active Gcode model is maintained by state management
 
 	/**** Model states ****/
@@ -352,6 +482,15 @@ enum cmFeedholdState {				// feedhold_state machine
 	FEEDHOLD_END_HOLD				// end hold (transient state to OFF)
 };
 
+#ifdef __HOLD_ACTIONS
+enum cmParkState {					// applies to cm.park_state
+	PARK_OFF = 0,					// no hold actions in effect
+	PARK_RETRACT,					// retracting Z away from the work
+	PARK_PARKED,					// parked - hold entry actions complete
+	PARK_RETURN						// returning to the hold point for resume
+};
+#endif
+
 enum cmHomingState {				// applies to cm.homing_state
 	HOMING_NOT_HOMED = 0,			// machine is not homed (0=false)
 	HOMING_HOMED = 1,				// machine is homed (1=true)
@@ -384,7 +523,11 @@ enum cmNextAction {						// these are in order to optimized CASE statement
 	NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS,	// G92.2
 	NEXT_ACTION_RESUME_ORIGIN_OFFSETS,	// G92.3
 	NEXT_ACTION_DWELL,					// G4
-	NEXT_ACTION_STRAIGHT_PROBE			// G38.2
+	NEXT_ACTION_STRAIGHT_PROBE,			// G38.2
+#ifdef __G68_ROTATION
+	NEXT_ACTION_SET_ROTATION,			// G68
+	NEXT_ACTION_CANCEL_ROTATION			// G69
+#endif
 };
 
 enum cmMotionMode {						// G Modal Group 1
@@ -402,7 +545,10 @@ enum cmMotionMode {						// G Modal Group 1
 	MOTION_MODE_CANNED_CYCLE_86,		// G86 - boring, spindle stop, rapid out
 	MOTION_MODE_CANNED_CYCLE_87,		// G87 - back boring
 	MOTION_MODE_CANNED_CYCLE_88,		// G88 - boring, spindle stop, manual out
-	MOTION_MODE_CANNED_CYCLE_89			// G89 - boring, dwell, feed out
+	MOTION_MODE_CANNED_CYCLE_89,		// G89 - boring, dwell, feed out
+	MOTION_MODE_SPINDLE_SYNC_FEED,		// G33 - spindle-synchronized feed (only active with __SPINDLE_SYNC)
+	MOTION_MODE_CUBIC_SPLINE,			// G5 - cubic Bezier feed (only active with __CUBIC_SPLINE)
+	MOTION_MODE_QUADRATIC_SPLINE		// G5.1 - quadratic Bezier feed (only active with __CUBIC_SPLINE)
 };
 
 enum cmModalGroup {						// Used for detecting gcode errors. See NIST section 3.4
@@ -417,6 +563,9 @@ enum cmModalGroup {						// Used for detecting gcode errors. See NIST section 3.
 	MODAL_GROUP_G9,						// {G98,G99}			return mode in canned cycles
 	MODAL_GROUP_G12,					// {G54,G55,G56,G57,G58,G59} coordinate system selection
 	MODAL_GROUP_G13,					// {G61,G61.1,G64}		path control mode
+#ifdef __SPINDLE_CSS
+	MODAL_GROUP_G14,					// {G96,G97}			spindle speed mode
+#endif
 	MODAL_GROUP_M4,						// {M0,M1,M2,M30,M60}	stopping
 	MODAL_GROUP_M6,						// {M6}					tool change
 	MODAL_GROUP_M7,						// {M3,M4,M5}			spindle turning
@@ -467,6 +616,13 @@ enum cmFeedRateMode {
 	UNITS_PER_REVOLUTION_MODE		// G95 (unimplemented)
 };
 
+#ifdef __SPINDLE_CSS
+enum cmSpindleSpeedMode {
+	SPINDLE_RPM_MODE = 0,			// G97 - S word is spindle RPM
+	SPINDLE_CSS_MODE				// G96 - S word is surface speed at the current X radius
+};
+#endif
+
 enum cmOriginOffset {
 	ORIGIN_OFFSET_SET=0,			// G92 - set origin offsets
 	ORIGIN_OFFSET_CANCEL,			// G92.1 - zero out origin offsets
@@ -507,9 +663,16 @@ enum cmAxisMode {					// axis modes (ordered: see _cm_get_feed_time())
 	AXIS_STANDARD,					// axis in coordinated motion w/standard behaviors
 	AXIS_INHIBITED,					// axis is computed but not activated
 	AXIS_RADIUS						// rotary axis calibrated to circumference
+#ifdef __ROTARY_MODULO
+	,AXIS_MODULO					// rotary axis resolved modulo 360 w/shortest-path selection
+#endif
 };	// ordering must be preserved. See cm_set_move_times()
 #define AXIS_MODE_MAX_LINEAR AXIS_INHIBITED
+#ifdef __ROTARY_MODULO
+#define AXIS_MODE_MAX_ROTARY AXIS_MODULO
+#else
 #define AXIS_MODE_MAX_ROTARY AXIS_RADIUS
+#endif
 
 /*****************************************************************************
  * FUNCTION PROTOTYPES
@@ -550,6 +713,8 @@ void cm_set_spindle_speed_parameter(GCodeState_t *gcode_state, float speed);
 void cm_set_tool_number(GCodeState_t *gcode_state, uint8_t tool);
 void cm_set_absolute_override(GCodeState_t *gcode_state, uint8_t absolute_override);
 void cm_set_model_linenum(uint32_t linenum);
+void cm_state_to_core(GCodeStateCore_t *core, const GCodeState_t *gcode_state);
+void cm_core_to_state(GCodeState_t *gcode_state, const GCodeStateCore_t *core);
 
 // Coordinate systems and offsets
 float cm_get_active_coord_offset(uint8_t axis);
@@ -564,6 +729,29 @@ void cm_finalize_move(void);
 stat_t cm_deferred_write_callback(void);
 void cm_set_model_target(float target[], float flag[]);
 stat_t cm_test_soft_limits(float target[]);
+#ifdef __SOFT_LIMIT_CACHE
+void cm_update_soft_limits(void);
+stat_t cm_set_sl(nvObj_t *nv);		// rebuild the windows on $sl and travel min/max changes
+stat_t cm_set_trv(nvObj_t *nv);
+stat_t cm_set_trt(nvObj_t *nv);
+#else
+#define cm_set_sl set_ui8
+#define cm_set_trv set_flu
+#define cm_set_trt set_flt
+#endif
+#ifdef __AXIS_TABLE
+stat_t cm_set_xvm(nvObj_t *nv);		// rebuild the planner axis table on rate limit changes
+stat_t cm_set_avm(nvObj_t *nv);
+#else
+#define cm_set_xvm set_flu
+#define cm_set_avm set_flt
+#endif
+#ifdef __OFFSET_CACHE
+void cm_update_combined_offsets(void);
+stat_t cm_set_ofs(nvObj_t *nv);		// rebuild the combined offset vector on $g54x - $g59c changes
+#else
+#define cm_set_ofs set_flu
+#endif
 
 /*--- Canonical machining functions (loosely) defined by NIST [organized by NIST Gcode doc] ---*/
 
@@ -591,6 +779,10 @@ stat_t cm_set_origin_offsets(float offset[], float flag[]);		// G92
 stat_t cm_reset_origin_offsets(void); 							// G92.1
 stat_t cm_suspend_origin_offsets(void); 						// G92.2
 stat_t cm_resume_origin_offsets(void);				 			// G92.3
+#ifdef __G68_ROTATION
+stat_t cm_set_rotation(float angle, uint8_t angle_flag, float center[], float flag[]);	// G68
+stat_t cm_cancel_rotation(void);								// G69
+#endif
 
 // Free Space Motion (4.3.4)
 stat_t cm_straight_traverse(float target[], float flags[]);		// G0
@@ -603,12 +795,23 @@ stat_t cm_goto_g30_position(float target[], float flags[]);		// G30
 stat_t cm_set_feed_rate(float feed_rate);						// F parameter
 stat_t cm_set_feed_rate_mode(uint8_t mode);						// G93, G94, (G95 unimplemented)
 stat_t cm_set_path_control(uint8_t mode);						// G61, G61.1, G64
+#ifdef __PATH_CONTROL
+stat_t cm_set_path_tolerance(float tolerance);					// G64 P<tol>
+#endif
 
 // Machining Functions (4.3.6)
 stat_t cm_straight_feed(float target[], float flags[]);		    // G1
+#ifdef __SPINDLE_SYNC
+stat_t cm_spindle_sync_feed(float target[], float flags[], float pitch); // G33
+#endif
 stat_t cm_arc_feed(	float target[], float flags[],              // G2, G3
 					float i, float j, float k,
 					float radius, uint8_t motion_mode);
+#ifdef __CUBIC_SPLINE
+stat_t cm_spline_feed(float target[], float flags[],            // G5, G5.1
+					float i, float j,
+					float p, float q, uint8_t motion_mode);
+#endif
 stat_t cm_dwell(float seconds);									// G4, P parameter
 
 // Spindle Functions (4.3.7)
@@ -617,6 +820,10 @@ stat_t cm_dwell(float seconds);									// G4, P parameter
 // Tool Functions (4.3.8)
 stat_t cm_select_tool(uint8_t tool);							// T parameter
 stat_t cm_change_tool(uint8_t tool);							// M6
+#ifdef __TOOL_TABLE
+stat_t cm_set_tool_length_offset(uint8_t enable, uint8_t h_number);	// G43, G49
+stat_t cm_set_tt(nvObj_t *nv);			// set a $tt1z - $tt9d tool table entry
+#endif
 
 // Miscellaneous Functions (4.3.9)
 stat_t cm_mist_coolant_control(uint8_t mist_coolant); 			// M7
@@ -649,19 +856,41 @@ void cm_program_end(void);										// M2
 
 /*--- Cycles ---*/
 
+#ifdef __CYCLE_SNAPSHOT
+void cm_cycle_save_state(void);									// snapshot modal state on cycle entry
+void cm_cycle_restore_state(void);								// restore modal state on cycle exit
+#endif
+
 // Homing cycles
 stat_t cm_homing_cycle_start(void);								// G28.2
 stat_t cm_homing_cycle_start_no_set(void);						// G28.4
 stat_t cm_homing_callback(void);								// G28.2/.4 main loop callback
+#ifdef __DUAL_ENDSTOP
+uint8_t cm_homing_squaring_switch(uint8_t sw_num);				// called from switch ISR - true if closure was absorbed by gating
+#endif
 
 // Probe cycles
 stat_t cm_straight_probe(float target[], float flags[]);		// G38.2
 stat_t cm_probe_callback(void);									// G38.2 main loop callback
+#ifdef __PROBE_GRID
+stat_t cm_probe_grid_start(float x0, float y0, float x1, float y1,	// {prbg:[...]} grid probing cycle
+						   uint8_t nx, uint8_t ny, float z_clear, float z_min, float feed);
+#endif
+
+// Canned drilling cycles
+#ifdef __CANNED_CYCLES
+stat_t cm_canned_cycle(float target[], float flags[]);			// G81, G82, G83
+stat_t cm_canned_cycle_callback(void);							// drilling cycle main loop callback
+#endif
 
 // Jogging cycle
 stat_t cm_jogging_callback(void);								// jogging cycle main loop
 stat_t cm_jogging_cycle_start(uint8_t axis);					// {"jogx":-100.3}
 float cm_get_jogging_dest(void);
+#ifdef __MPG_WHEEL
+stat_t cm_mpg_callback(void);									// poll the handwheel (see cycle_jogging.c)
+stat_t cm_set_mpga(nvObj_t *nv);								// set handwheel axis with validation
+#endif
 
 /*--- cfgArray interface functions ---*/
 
@@ -705,6 +934,9 @@ stat_t cm_get_am(nvObj_t *nv);			// get axis mode
 stat_t cm_set_am(nvObj_t *nv);			// set axis mode
 stat_t cm_set_xjm(nvObj_t *nv);			// set jerk max with 1,000,000 correction
 stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
+#ifdef __TRAVERSE_JERK
+stat_t cm_set_xjt(nvObj_t *nv);			// set traverse jerk with 1,000,000 correction
+#endif
 
 /*--- text_mode support functions ---*/
 
@@ -741,12 +973,19 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 
 	void cm_print_ja(nvObj_t *nv);		// global CM settings
 	void cm_print_ct(nvObj_t *nv);
+#ifdef __CHORD_BLEND
+	void cm_print_bt(nvObj_t *nv);
+#endif
 	void cm_print_sl(nvObj_t *nv);
 	void cm_print_ml(nvObj_t *nv);
 	void cm_print_ma(nvObj_t *nv);
 	void cm_print_ms(nvObj_t *nv);
 	void cm_print_st(nvObj_t *nv);
 	void cm_print_sa(nvObj_t *nv);
+#ifdef __HOLD_ACTIONS
+	void cm_print_fhz(nvObj_t *nv);
+	void cm_print_fhp(nvObj_t *nv);
+#endif
 
 	void cm_print_am(nvObj_t *nv);		// axis print functions
 	void cm_print_fr(nvObj_t *nv);
@@ -755,6 +994,11 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_tn(nvObj_t *nv);
 	void cm_print_jm(nvObj_t *nv);
 	void cm_print_jh(nvObj_t *nv);
+#ifdef __INPUT_SHAPER
+	void cm_print_shf(nvObj_t *nv);
+	void cm_print_shz(nvObj_t *nv);
+#endif
+	void cm_print_jt(nvObj_t *nv);
 	void cm_print_jd(nvObj_t *nv);
 	void cm_print_ra(nvObj_t *nv);
 	void cm_print_sn(nvObj_t *nv);
@@ -764,6 +1008,10 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	void cm_print_lb(nvObj_t *nv);
 	void cm_print_zb(nvObj_t *nv);
 	void cm_print_cofs(nvObj_t *nv);
+#ifdef __TOOL_TABLE
+	void cm_print_ttl(nvObj_t *nv);
+	void cm_print_ttd(nvObj_t *nv);
+#endif
 	void cm_print_cpos(nvObj_t *nv);
 
 #else // __TEXT_MODE
@@ -799,12 +1047,19 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 
 	#define cm_print_ja tx_print_stub		// global CM settings
 	#define cm_print_ct tx_print_stub
+#ifdef __CHORD_BLEND
+	#define cm_print_bt tx_print_stub
+#endif
 	#define cm_print_sl tx_print_stub
 	#define cm_print_ml tx_print_stub
 	#define cm_print_ma tx_print_stub
 	#define cm_print_ms tx_print_stub
 	#define cm_print_st tx_print_stub
 	#define cm_print_sa tx_print_stub
+#ifdef __HOLD_ACTIONS
+	#define cm_print_fhz tx_print_stub
+	#define cm_print_fhp tx_print_stub
+#endif
 
 	#define cm_print_am tx_print_stub		// axis print functions
 	#define cm_print_fr tx_print_stub
@@ -813,6 +1068,11 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_tn tx_print_stub
 	#define cm_print_jm tx_print_stub
 	#define cm_print_jh tx_print_stub
+#ifdef __INPUT_SHAPER
+	#define cm_print_shf tx_print_stub
+	#define cm_print_shz tx_print_stub
+#endif
+	#define cm_print_jt tx_print_stub
 	#define cm_print_jd tx_print_stub
 	#define cm_print_ra tx_print_stub
 	#define cm_print_sn tx_print_stub
@@ -822,6 +1082,10 @@ stat_t cm_set_xjh(nvObj_t *nv);			// set jerk homing with 1,000,000 correction
 	#define cm_print_lb tx_print_stub
 	#define cm_print_zb tx_print_stub
 	#define cm_print_cofs tx_print_stub
+#ifdef __TOOL_TABLE
+	#define cm_print_ttl tx_print_stub
+	#define cm_print_ttd tx_print_stub
+#endif
 	#define cm_print_cpos tx_print_stub
 
 #endif // __TEXT_MODE
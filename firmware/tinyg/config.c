@@ -41,9 +41,9 @@
 #include "util.h"
 #include "xio.h"
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 static void _set_defa(nvObj_t *nv);
 
@@ -51,8 +51,35 @@ static void _set_defa(nvObj_t *nv);
  **** STRUCTURE ALLOCATIONS ********************************************************
  ***********************************************************************************/
 
+#ifdef __NV_ARENAS
+nvStr_t nvStr_arena[NV_ARENAS];				// arena 0: command traffic, arena 1: reports
+nvList_t nvl_arena[NV_ARENAS];
+nvStr_t *nvStr_p = &nvStr_arena[NV_ARENA_COMMAND];
+nvList_t *nvl_p = &nvl_arena[NV_ARENA_COMMAND];
+static uint8_t nv_arena_selected = NV_ARENA_COMMAND;
+
+/*
+ * nv_select_arena() - bind nvl/nvStr to an owner's pool, return the previous owner
+ *
+ *	Report generation runs between command lines - and sometimes within them -
+ *	so reports get their own fixed pool. An SR can populate and serialize
+ *	without destroying a command list being parsed or responded to, which is
+ *	what forced serialization of reports and command bursts when there was a
+ *	single shared list. Callers restore the returned owner when done so
+ *	nested selections compose.
+ */
+uint8_t nv_select_arena(uint8_t owner)
+{
+	uint8_t previous = nv_arena_selected;
+	nv_arena_selected = owner;
+	nvl_p = &nvl_arena[owner];
+	nvStr_p = &nvStr_arena[owner];
+	return (previous);
+}
+#else
 nvStr_t nvStr;
 nvList_t nvl;
+#endif
 
 /***********************************************************************************
  **** CODE *************************************************************************
@@ -68,18 +95,40 @@ nvList_t nvl;
  *
  *	!!!! NOTE: nv_persist() cannot be called from an interrupt on the AVR due to the AVR1008 EEPROM workaround
  */
+#ifdef __CFG_RECORD_CACHE					// resolve hot record fields through the RAM cache (see config_app.c)
+#define TABLE_GET		(nv_record(nv->index)->get)
+#define TABLE_SET		(nv_record(nv->index)->set)
+#define TABLE_FLAGS		(nv_record(nv->index)->flags)
+#define TABLE_TARGET	(nv_record(nv->index)->target)
+#define TABLE_PRECISION	(nv_record(nv->index)->precision)
+#else										// read them from PROGMEM every time
+#define TABLE_GET		((fptrCmd)GET_TABLE_WORD(get))
+#define TABLE_SET		((fptrCmd)GET_TABLE_WORD(set))
+#define TABLE_FLAGS		GET_TABLE_BYTE(flags)
+#define TABLE_TARGET	((float *)GET_TABLE_WORD(target))
+#define TABLE_PRECISION	((int8_t)GET_TABLE_WORD(precision))
+#endif
+
 stat_t nv_set(nvObj_t *nv)
 {
 	if (nv->index >= nv_index_max())
         return(STAT_INTERNAL_RANGE_ERROR);
-	return (((fptrCmd)GET_TABLE_WORD(set))(nv));
+#ifdef __CONFIG_REPORT
+	stat_t status = (TABLE_SET)(nv);
+	if (status == STAT_OK) {
+		cr_mark_group_changed(nv->index);	// queue a config report if the group is subscribed
+	}
+	return (status);
+#else
+	return ((TABLE_SET)(nv));
+#endif
 }
 
 stat_t nv_get(nvObj_t *nv)
 {
 	if (nv->index >= nv_index_max())
         return(STAT_INTERNAL_RANGE_ERROR);
-	return (((fptrCmd)GET_TABLE_WORD(get))(nv));
+	return ((TABLE_GET)(nv));
 }
 
 void nv_print(nvObj_t *nv)
@@ -93,7 +142,7 @@ stat_t nv_persist(nvObj_t *nv)	// nv_persist() cannot be called from an interrup
 #ifndef __DISABLE_PERSISTENCE	// cutout for faster simulation in test
 	if (nv_index_lt_groups(nv->index) == false)
         return(STAT_INTERNAL_RANGE_ERROR);
-	if (GET_TABLE_BYTE(flags) & F_PERSIST)
+	if (TABLE_FLAGS & F_PERSIST)
         return(write_persistent_value(nv));
 #endif
 	return (STAT_OK);
@@ -115,18 +164,27 @@ void config_init()
 {
 	nvObj_t *nv = nv_reset_nv_list();
 	config_init_assertions();
+#ifdef __CFG_SORTED_INDEX
+	nv_index_init();							// build sorted index before any lookups occur
+#endif
+#ifdef __CFG_GROUP_CACHE
+	nv_group_cache_init();						// build group spans before any group expansions
+#endif
+#ifdef __CFG_RECORD_CACHE
+	nv_record_cache_init();						// empty the hot record cache
+#endif
 
-#ifdef __ARM
-// ++++ The following code is offered until persistence is implemented.
-// ++++ Then you can use the AVR code (or something like it)
-	cfg.comm_mode = JSON_MODE;					// initial value until EEPROM is read
-	_set_defa(nv);
-#endif
+#ifdef __ARM
+// ++++ The following code is offered until persistence is implemented.
+// ++++ Then you can use the AVR code (or something like it)
+	cfg.comm_mode = JSON_MODE;					// initial value until EEPROM is read
+	_set_defa(nv);
+#endif
 #ifdef __AVR
-	cm_set_units_mode(MILLIMETERS);				// must do inits in millimeter mode
+	cm_set_units_mode(MILLIMETERS);				// must do inits in millimeter mode
 	nv->index = 0;								// this will read the first record in NVM
 
-	read_persistent_value(nv);
+	read_persistent_value(nv);
 	if (nv->value != cs.fw_build) {				// case (1) NVM is not setup or not in revision
 //	if (fp_NE(nv->value, cs.fw_build)) {
 		_set_defa(nv);
@@ -135,7 +193,7 @@ void config_init()
 		for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
 			if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
 				strncpy_P(nv->token, cfgArray[nv->index].token, TOKEN_LEN);	// read the token from the array
-				read_persistent_value(nv);
+				read_persistent_value(nv);
 				nv_set(nv);
 			}
 		}
@@ -178,7 +236,31 @@ stat_t set_defaults(nvObj_t *nv)
 	return (STAT_OK);
 }
 
-/*
+#ifdef __SETTINGS_PROFILES
+/*
+ * config_apply_persistent() - re-run the NVM apply loop after a profile swap
+ *
+ *	Same loop as config_init() case (2), applied to whatever image is now in
+ *	NVM (or the NVM shadow). Every F_INITIALIZE value runs through its normal
+ *	setter, so the dependent recomputations (steps/unit, jerk terms, the flat
+ *	axis table) all happen as side effects. The passed nv is consumed - same
+ *	contract as _set_defa().
+ */
+void config_apply_persistent(nvObj_t *nv)
+{
+	cm_set_units_mode(MILLIMETERS);				// must do inits in MM mode
+	for (nv->index=0; nv_index_is_single(nv->index); nv->index++) {
+		if (GET_TABLE_BYTE(flags) & F_INITIALIZE) {
+			strncpy_P(nv->token, cfgArray[nv->index].token, TOKEN_LEN);
+			read_persistent_value(nv);
+			nv_set(nv);
+		}
+	}
+	sr_init_status_report();					// reset status reports
+}
+#endif // __SETTINGS_PROFILES
+
+/*
  * config_init_assertions()
  * config_test_assertions() - check memory integrity of config sub-system
  */
@@ -187,18 +269,40 @@ void config_init_assertions()
 {
 	cfg.magic_start = MAGICNUM;
 	cfg.magic_end = MAGICNUM;
+#ifdef __NV_ARENAS
+	for (uint8_t i=0; i<NV_ARENAS; i++) {
+		nvl_arena[i].magic_start = MAGICNUM;
+		nvl_arena[i].magic_end = MAGICNUM;
+		nvStr_arena[i].magic_start = MAGICNUM;
+		nvStr_arena[i].magic_end = MAGICNUM;
+	}
+#else
 	nvl.magic_start = MAGICNUM;
 	nvl.magic_end = MAGICNUM;
 	nvStr.magic_start = MAGICNUM;
 	nvStr.magic_end = MAGICNUM;
+#endif
 }
 
 stat_t config_test_assertions()
 {
 	if ((cfg.magic_start	!= MAGICNUM) || (cfg.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+#ifdef __NV_ARENAS
+	for (uint8_t i=0; i<NV_ARENAS; i++) {
+		if ((nvl_arena[i].magic_start	!= MAGICNUM) || (nvl_arena[i].magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+		if ((nvStr_arena[i].magic_start	!= MAGICNUM) || (nvStr_arena[i].magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+	}
+#else
 	if ((nvl.magic_start	!= MAGICNUM) || (nvl.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
 	if ((nvStr.magic_start	!= MAGICNUM) || (nvStr.magic_end != MAGICNUM)) return (STAT_CONFIG_ASSERTION_FAILURE);
+#endif
 	if (global_string_buf[MESSAGE_LEN-1] != NUL) return (STAT_CONFIG_ASSERTION_FAILURE);
+#if defined(__AVR) && defined(__NVM_SHADOW)
+	// every single-valued config must be covered by the RAM shadow image, or
+	// read_persistent_value() silently falls back to EEPROM wait states when
+	// a setter or $defa comparison touches an uncovered index
+	if (nv_index_is_single(NVM_SHADOW_ENTRIES)) return (STAT_CONFIG_ASSERTION_FAILURE);
+#endif
 	return (STAT_OK);
 }
 
@@ -208,6 +312,7 @@ stat_t config_test_assertions()
  *	get_nul()  - get nothing (returns STAT_PARAMETER_CANNOT_BE_READ)
  *	get_ui8()  - get value as 8 bit uint8_t
  *	get_int()  - get value as 32 bit integer
+ *	get_int32() - get value as signed 32 bit integer
  *	get_data() - get value as 32 bit integer blind cast
  *	get_flt()  - get value as float
  *	get_format() - internal accessor for printf() format string
@@ -220,31 +325,34 @@ stat_t get_nul(nvObj_t *nv)
 
 stat_t get_ui8(nvObj_t *nv)
 {
-	nv->value = (float)*((uint8_t *)GET_TABLE_WORD(target));
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, *((uint8_t *)TABLE_TARGET));
 	return (STAT_OK);
 }
 
 stat_t get_int(nvObj_t *nv)
 {
-//	nv->value = (float)*((uint32_t *)GET_TABLE_WORD(target));
-	nv->value = *((uint32_t *)GET_TABLE_WORD(target));
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, *((uint32_t *)TABLE_TARGET));
+	return (STAT_OK);
+}
+
+stat_t get_int32(nvObj_t *nv)
+{
+	nv_store_int(nv, *((int32_t *)TABLE_TARGET));
 	return (STAT_OK);
 }
 
 stat_t get_data(nvObj_t *nv)
 {
 	uint32_t *v = (uint32_t*)&nv->value;
-	*v = *((uint32_t *)GET_TABLE_WORD(target));
+	*v = *((uint32_t *)TABLE_TARGET);
 	nv->valuetype = TYPE_DATA;
 	return (STAT_OK);
 }
 
 stat_t get_flt(nvObj_t *nv)
 {
-	nv->value = *((float *)GET_TABLE_WORD(target));
-	nv->precision = (int8_t)GET_TABLE_WORD(precision);
+	nv->value = *(TABLE_TARGET);
+	nv->precision = TABLE_PRECISION;
 	nv->valuetype = TYPE_FLOAT;
 	return (STAT_OK);
 }
@@ -263,8 +371,8 @@ stat_t set_nul(nvObj_t *nv) { return (STAT_PARAMETER_IS_READ_ONLY); }
 
 stat_t set_ui8(nvObj_t *nv)
 {
-	*((uint8_t *)GET_TABLE_WORD(target)) = nv->value;
-	nv->valuetype = TYPE_INTEGER;
+	*((uint8_t *)TABLE_TARGET) = nv->value;		// parser input is always a float
+	nv_store_int(nv, *((uint8_t *)TABLE_TARGET));
 	return(STAT_OK);
 }
 
@@ -291,23 +399,23 @@ stat_t set_0123(nvObj_t *nv)
 
 stat_t set_int(nvObj_t *nv)
 {
-	*((uint32_t *)GET_TABLE_WORD(target)) = (uint32_t)nv->value;
-	nv->valuetype = TYPE_INTEGER;
+	*((uint32_t *)TABLE_TARGET) = (uint32_t)nv->value;	// parser input is always a float
+	nv_store_int(nv, *((uint32_t *)TABLE_TARGET));
 	return(STAT_OK);
 }
 
 stat_t set_data(nvObj_t *nv)
 {
 	uint32_t *v = (uint32_t*)&nv->value;
-	*((uint32_t *)GET_TABLE_WORD(target)) = *v;
+	*((uint32_t *)TABLE_TARGET) = *v;
 	nv->valuetype = TYPE_DATA;
 	return(STAT_OK);
 }
 
 stat_t set_flt(nvObj_t *nv)
 {
-	*((float *)GET_TABLE_WORD(target)) = nv->value;
-	nv->precision = GET_TABLE_WORD(precision);
+	*(TABLE_TARGET) = nv->value;
+	nv->precision = TABLE_PRECISION;
 	nv->valuetype = TYPE_FLOAT;
 	return(STAT_OK);
 }
@@ -357,6 +465,18 @@ stat_t get_grp(nvObj_t *nv)
 	char_t *parent_group = nv->token;				// token in the parent nv object is the group
 	char_t group[GROUP_LEN+1];						// group string retrieved from cfgArray child
 	nv->valuetype = TYPE_PARENT;					// make first object the parent
+#ifdef __CFG_GROUP_CACHE
+	index_t first, last;							// walk just the group's span if it's cached
+	if (nv_group_cache_lookup(parent_group, &first, &last)) {
+		for (index_t i=first; i <= last; i++) {		// the span may contain interleaved foreign
+			strcpy_P(group, cfgArray[i].group);		//...rows so the membership test is retained
+			if (strcmp(parent_group, group) != 0) continue;
+			(++nv)->index = i;
+			nv_get_nvObj(nv);
+		}
+		return (STAT_OK);
+	}
+#endif
 	for (index_t i=0; nv_index_is_single(i); i++) {
 		strcpy_P(group, cfgArray[i].group);			// don't need strncpy as it's always terminated
 		if (strcmp(parent_group, group) != 0) continue;
@@ -394,7 +514,7 @@ stat_t set_grp(nvObj_t *nv)
 	return (STAT_OK);
 }
 
-/*
+/*
  * nv_group_is_prefixed() - hack
  *
  *	This little function deals with the exception cases that some groups don't use
@@ -403,6 +523,9 @@ stat_t set_grp(nvObj_t *nv)
 uint8_t nv_group_is_prefixed(char_t *group)
 {
 	if (strcmp("sr",group) == 0) return (false);
+#ifdef __CONFIG_REPORT
+	if (strcmp("cr",group) == 0) return (false);
+#endif
 	if (strcmp("sys",group) == 0) return (false);
 	return (true);
 }
@@ -417,17 +540,22 @@ uint8_t nv_group_is_prefixed(char_t *group)
 
 /* nv_get_index() - get index from mnenonic token + group
  *
- * nv_get_index() is the most expensive routine in the whole config. It does a
- * linear table scan of the PROGMEM strings, which of course could be further
- * optimized with indexes or hashing.
+ * nv_get_index() is the most expensive routine in the whole config. With
+ * __CFG_SORTED_INDEX set it binary searches a first-character bucket of a RAM
+ * permutation of cfgArray built at config_init() time (see nv_index_init /
+ * nv_index_lookup in config_app.c).
+ * Otherwise it falls back to a linear table scan of the PROGMEM strings.
  */
 index_t nv_get_index(const char_t *group, const char_t *token)
 {
-	char_t c;
 	char_t str[TOKEN_LEN + GROUP_LEN+1];	// should actually never be more than TOKEN_LEN+1
 	strncpy(str, group, GROUP_LEN+1);
 	strncat(str, token, TOKEN_LEN+1);
 
+#ifdef __CFG_SORTED_INDEX
+	return (nv_index_lookup(str));
+#else
+	char_t c;
 	index_t i;
 	index_t index_max = nv_index_max();
 
@@ -444,12 +572,31 @@ index_t nv_get_index(const char_t *group, const char_t *token)
 		return (i);																	// five character match
 	}
 	return (NO_MATCH);
+#endif // __CFG_SORTED_INDEX
 }
 
 /*
  * nv_get_type() - returns command type as a NV_TYPE enum
  */
 
+#ifdef __JV_MASK
+uint8_t nv_get_type(nvObj_t *nv)
+{
+	// runs once per serialized response object, so dispatch on the first
+	// character instead of running the strcmp chain for the common configs
+	char_t *token = nv->token;
+	switch (token[0]) {
+		case NUL: return (NV_TYPE_NULL);
+		case 'g': { if ((token[1] == 'c') && (token[2] == NUL)) return (NV_TYPE_GCODE); break;}
+		case 's': { if ((token[1] == 'r') && (token[2] == NUL)) return (NV_TYPE_REPORT); break;}
+		case 'q': { if ((token[1] == 'r') && (token[2] == NUL)) return (NV_TYPE_REPORT); break;}
+		case 'm': { if (strcmp("msg", token) == 0) return (NV_TYPE_MESSAGE); break;}
+		case 'e': { if (strcmp("err", token) == 0) return (NV_TYPE_MESSAGE); break;}	// errors are reported as messages
+		case 'n': { if (token[1] == NUL) return (NV_TYPE_LINENUM); break;}
+	}
+	return (NV_TYPE_CONFIG);
+}
+#else
 uint8_t nv_get_type(nvObj_t *nv)
 {
 	if (nv->token[0] == NUL) return (NV_TYPE_NULL);
@@ -461,6 +608,7 @@ uint8_t nv_get_type(nvObj_t *nv)
 	if (strcmp("n",  nv->token) == 0) return (NV_TYPE_LINENUM);
 	return (NV_TYPE_CONFIG);
 }
+#endif	// __JV_MASK
 
 /******************************************************************************
  * nvObj low-level object and list operations
@@ -504,13 +652,13 @@ void nv_get_nvObj(nvObj_t *nv)
 
 	// special processing for system groups and stripping tokens for groups
 	if (nv->group[0] != NUL) {
-		if (GET_TABLE_BYTE(flags) & F_NOSTRIP) {
+		if (TABLE_FLAGS & F_NOSTRIP) {
 			nv->group[0] = NUL;
 		} else {
 			strcpy(nv->token, &nv->token[strlen(nv->group)]); // strip group from the token
 		}
 	}
-	((fptrCmd)GET_TABLE_WORD(get))(nv);		// populate the value
+	(TABLE_GET)(nv);						// populate the value
 }
 
 nvObj_t *nv_reset_nv(nvObj_t *nv)			// clear a single nvObj structure
@@ -604,8 +752,7 @@ nvObj_t *nv_add_integer(const char_t *token, const uint32_t value)// add an inte
 			continue;
 		}
 		strncpy(nv->token, token, TOKEN_LEN);
-		nv->value = (float) value;
-		nv->valuetype = TYPE_INTEGER;
+		nv_store_int(nv, value);
 		return (nv);
 	}
 	return (NULL);
@@ -627,7 +774,7 @@ nvObj_t *nv_add_data(const char_t *token, const uint32_t value)// add an integer
 	}
 	return (NULL);
 }
-
+
 nvObj_t *nv_add_float(const char_t *token, const float value)	// add a float object to the body
 {
 	nvObj_t *nv = nv_body;
@@ -700,6 +847,56 @@ void nv_print_list(stat_t status, uint8_t text_flags, uint8_t json_flags)
 	}
 }
 
+#ifdef __ASYNC_COMMAND
+/**** Async command records - see config.h for the usage contract ***********
+ * nv_async_start()	   - park a command's nvObj and defer its response
+ * nv_async_callback() - poll parked commands, emit responses on completion
+ */
+
+typedef struct asyncCmd {
+	uint8_t busy;						// record holds a parked command
+	nvObj_t nv;							// standalone copy of the command's nvObj (list links are NULL)
+	stat_t (*poll)(nvObj_t *nv);		// completion poll - STAT_EAGAIN while the operation runs
+} asyncCmd_t;
+
+static asyncCmd_t async_cmd[ASYNC_CMD_POOL];
+
+stat_t nv_async_start(nvObj_t *nv, stat_t (*poll)(nvObj_t *nv))
+{
+	for (uint8_t i=0; i<ASYNC_CMD_POOL; i++) {
+		if (async_cmd[i].busy == true) { continue;}
+		memcpy(&async_cmd[i].nv, nv, sizeof(nvObj_t));
+		async_cmd[i].nv.pv = NULL;					// the parked copy is not in a list
+		async_cmd[i].nv.nx = NULL;
+		async_cmd[i].poll = poll;
+		async_cmd[i].busy = true;
+		return (STAT_ASYNC_PENDING);
+	}
+	return (STAT_BUFFER_FULL);			// no record free - caller should complete synchronously
+}
+
+stat_t nv_async_callback()
+{
+	for (uint8_t i=0; i<ASYNC_CMD_POOL; i++) {
+		if (async_cmd[i].busy == false) { continue;}
+		stat_t status = async_cmd[i].poll(&async_cmd[i].nv);
+		if (status == STAT_EAGAIN) { continue;}		// operation still in flight
+		async_cmd[i].busy = false;
+
+		// emit the deferred response - rebuild the nv list around the parked copy
+		nvObj_t *nv = nv_reset_nv_list();
+		nvObj_t *pv = nv->pv;
+		nvObj_t *nx = nv->nx;
+		memcpy(nv, &async_cmd[i].nv, sizeof(nvObj_t));
+		nv->pv = pv;
+		nv->nx = nx;
+		nv_print_list(status, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+		return (STAT_OK);				// one completion per pass bounds the callback
+	}
+	return (STAT_NOOP);
+}
+#endif // __ASYNC_COMMAND
+
 /****************************************************************************
  ***** Diagnostics **********************************************************
  ****************************************************************************/
@@ -717,6 +914,6 @@ void nv_dump_nv(nvObj_t *nv)
 			 (char *)nv->stringp);
 }
 
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+#ifdef __cplusplus
+}
+#endif // __cplusplus
@@ -145,7 +145,7 @@ extern "C"{
  *	  - Text-mode displays. Concatenates grp+token for display, may also use grp alone
  *	  - JSON-mode display for single - element value e.g. xvm. Concatenate as above
  *	  - JSON-mode display of a parent/child group. Parent is named grp, children nems are tokens
- */
+ */
 /*	--- nv object string handling ---
  *
  *	It's very expensive to allocate sufficient string space to each nvObj, so nv uses a cheater's
@@ -189,7 +189,11 @@ typedef uint16_t index_t;				// use this if there are > 255 indexed objects
 
 #define GROUP_LEN 3						// max length of group prefix
 #define TOKEN_LEN 5						// mnemonic token string: group prefix + short token
+#ifdef __FOOTER_FLOW
+#define NV_FOOTER_LEN 32				// footer array with the flow advisory fields
+#else
 #define NV_FOOTER_LEN 18				// sufficient space to contain a JSON footer array
+#endif
 #define NV_LIST_LEN (NV_BODY_LEN+2)		// +2 allows for a header and a footer
 #define NV_MAX_OBJECTS (NV_BODY_LEN-1)	// maximum number of objects in a body string
 #define NO_MATCH (index_t)0xFFFF
@@ -271,12 +275,39 @@ typedef struct nvObject {				// depending on use, not all elements may be popula
 	int8_t depth;						// depth of object in the tree. 0 is root (-1 is invalid)
 	int8_t valuetype;					// see valueType enum
 	int8_t precision;					// decimal precision for reporting (JSON)
+#ifdef __TYPED_CONFIG
+	union {
+		float value;					// numeric value (TYPE_FLOAT, and all parser input)
+		int32_t value_int;				// native integer image (TYPE_INTEGER - see nv_store_int)
+	};
+#else
 	float value;						// numeric value
+#endif
 	char_t group[GROUP_LEN+1];			// group prefix or NUL if not in a group
 	char_t token[TOKEN_LEN+1];			// full mnemonic token for lookup
 	char_t (*stringp)[];				// pointer to array of characters from shared character array
 } nvObj_t; 								// OK, so it's not REALLY an object
 
+/* Typed value storage (__TYPED_CONFIG)
+ *
+ *	Producers of integer values store through nv_store_int() and readers use
+ *	nv_int_value(), so integers ride the union natively - no int-to-float
+ *	conversion on hot get paths (status / queue reports per block) and no
+ *	float formatting on serialization. Parser input always arrives as a
+ *	float in 'value' and the NVM image stays float (nv_flt_value() converts
+ *	for persistence), so set functions and stored settings are unaffected.
+ *	TYPE_BOOL and TYPE_DATA keep their existing float / bit-image handling.
+ */
+#ifdef __TYPED_CONFIG
+#define nv_store_int(nv,v)	{ (nv)->value_int = (int32_t)(v); (nv)->valuetype = TYPE_INTEGER;}
+#define nv_int_value(nv)	(((nv)->valuetype == TYPE_INTEGER) ? (nv)->value_int : (int32_t)(nv)->value)
+#define nv_flt_value(nv)	(((nv)->valuetype == TYPE_INTEGER) ? (float)(nv)->value_int : (nv)->value)
+#else
+#define nv_store_int(nv,v)	{ (nv)->value = (float)(v); (nv)->valuetype = TYPE_INTEGER;}
+#define nv_int_value(nv)	((int32_t)(nv)->value)
+#define nv_flt_value(nv)	((nv)->value)
+#endif
+
 typedef uint8_t (*fptrCmd)(nvObj_t *nv);// required for cfg table access
 typedef void (*fptrPrint)(nvObj_t *nv);	// required for PROGMEM access
 
@@ -300,8 +331,25 @@ typedef struct cfgItem {
 
 /**** static allocation and definitions ****/
 
+#ifdef __NV_ARENAS
+enum nvArenaOwner {						// fixed owner-to-pool assignment
+	NV_ARENA_COMMAND = 0,				// command parsing and responses
+	NV_ARENA_REPORT						// status report generation
+};
+#define NV_ARENAS 2
+
+extern nvStr_t nvStr_arena[NV_ARENAS];
+extern nvList_t nvl_arena[NV_ARENAS];
+extern nvStr_t *nvStr_p;				// active arena - all nvl/nvStr references resolve through these
+extern nvList_t *nvl_p;
+#define nvStr (*nvStr_p)
+#define nvl (*nvl_p)
+
+uint8_t nv_select_arena(uint8_t owner);	// bind the active pool, returns the previous owner
+#else
 extern nvStr_t nvStr;
 extern nvList_t nvl;
+#endif
 extern const cfgItem_t cfgArray[];
 
 //#define nv_header nv.list
@@ -312,6 +360,9 @@ extern const cfgItem_t cfgArray[];
 
 void config_init(void);
 stat_t set_defaults(nvObj_t *nv);			// reset config to default values
+#ifdef __SETTINGS_PROFILES
+void config_apply_persistent(nvObj_t *nv);	// re-run the NVM apply loop after a profile swap
+#endif
 void config_init_assertions(void);
 stat_t config_test_assertions(void);
 
@@ -324,6 +375,26 @@ stat_t nv_persist(nvObj_t *nv);				// main entry point for persistence
 // helpers
 uint8_t nv_get_type(nvObj_t *nv);
 index_t nv_get_index(const char_t *group, const char_t *token);
+#ifdef __CFG_SORTED_INDEX
+void nv_index_init(void);					// (see config_app.c)
+index_t nv_index_lookup(const char_t *str);	// (see config_app.c)
+#endif
+#ifdef __CFG_GROUP_CACHE
+void nv_group_cache_init(void);				// (see config_app.c)
+uint8_t nv_group_cache_lookup(const char_t *group, index_t *first, index_t *last);
+#endif
+#ifdef __CFG_RECORD_CACHE
+typedef struct cfgRecord {					// RAM image of a cfgArray record's hot fields
+	index_t index;							// cfgArray index this entry holds, or NO_MATCH
+	uint8_t flags;							// operations flags
+	int8_t precision;						// display precision
+	fptrCmd get;							// GET binding
+	fptrCmd set;							// SET binding
+	float *target;							// value target
+} cfgRecord_t;
+void nv_record_cache_init(void);			// (see config_app.c)
+cfgRecord_t *nv_record(index_t index);		// (see config_app.c)
+#endif
 index_t	nv_index_max(void);					// (see config_app.c)
 uint8_t nv_index_is_single(index_t index);	// (see config_app.c)
 uint8_t nv_index_is_group(index_t index);	// (see config_app.c)
@@ -343,6 +414,7 @@ stat_t set_flt(nvObj_t *nv);				// set floating point value
 stat_t get_nul(nvObj_t *nv);				// get null value type
 stat_t get_ui8(nvObj_t *nv);				// get uint8_t value
 stat_t get_int(nvObj_t *nv);				// get uint32_t integer value
+stat_t get_int32(nvObj_t *nv);				// get int32_t integer value
 stat_t get_data(nvObj_t *nv);				// get uint32_t integer value blind cast
 stat_t get_flt(nvObj_t *nv);				// get floating point value
 
@@ -361,6 +433,22 @@ nvObj_t *nv_add_string(const char_t *token, const char_t *string);
 nvObj_t *nv_add_conditional_message(const char_t *string);
 void nv_print_list(stat_t status, uint8_t text_flags, uint8_t json_flags);
 
+#ifdef __ASYNC_COMMAND
+/* Async command records. A setter that starts a long peripheral operation
+ * parks its nvObj in a record with nv_async_start() and returns the result
+ * (STAT_ASYNC_PENDING), freeing the dispatcher to keep feeding motion. The
+ * poll function runs from the controller loop against the parked copy and
+ * returns STAT_EAGAIN until the operation completes; any other return
+ * releases the record and is reported in the deferred response. Parked
+ * objects are value-only - TYPE_STRING points into the shared string pool
+ * and may be overwritten before completion.
+ */
+#define ASYNC_CMD_POOL 4				// concurrent async commands (each record holds one nvObj)
+
+stat_t nv_async_start(nvObj_t *nv, stat_t (*poll)(nvObj_t *nv));
+stat_t nv_async_callback(void);
+#endif
+
 // application specific helpers and functions (config_app.c)
 stat_t set_flu(nvObj_t *nv);				// set floating point number with G20/G21 units conversion
 void preprocess_float(nvObj_t *nv);			// pre-process float values for units and illegal values
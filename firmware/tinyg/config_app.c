@@ -36,13 +36,20 @@
 #include "planner.h"
 #include "stepper.h"
 #include "switch.h"
+#include "kinematics.h"
 #include "pwm.h"
+#include "spindle.h"
+#include "thc.h"
+#include "afc.h"
 #include "report.h"
 #include "hardware.h"
+#include "job_store.h"
 #include "test.h"
+#include "diagnostics.h"
 #include "util.h"
 #include "help.h"
 #include "network.h"
+#include "persistence.h"
 #include "xio.h"
 
 #ifdef __cplusplus
@@ -71,7 +78,26 @@ static stat_t _do_all(nvObj_t *nv);			// print all parameters
 static stat_t set_ec(nvObj_t *nv);			// expand CRLF on TX output
 static stat_t set_ee(nvObj_t *nv);			// enable character echo
 static stat_t set_ex(nvObj_t *nv);			// enable XON/XOFF and RTS/CTS flow control
+#ifdef __LINE_CRC
+static stat_t set_fr(nvObj_t *nv);			// enable CRC16 line framing
+#endif
 static stat_t set_baud(nvObj_t *nv);		// set USB baud rate
+#ifdef __BULK_SET
+static stat_t set_bset(nvObj_t *nv);		// apply a bulk settings array
+#endif
+#ifdef __SYNC_OUT
+static stat_t set_sot(nvObj_t *nv);			// arm a position-triggered output change
+#endif
+#ifdef __JOB_CHECKPOINT
+static stat_t set_rsm(nvObj_t *nv);			// restore the job checkpoint for resume
+#endif
+#ifdef __PROBE_GRID
+static stat_t set_prbg(nvObj_t *nv);		// run the grid probing cycle
+#endif
+#ifdef __MESH_COMP
+static stat_t get_mesh(nvObj_t *nv);		// get mesh Z-compensation state
+static stat_t set_mesh(nvObj_t *nv);		// enable/disable mesh Z-compensation
+#endif
 static stat_t get_rx(nvObj_t *nv);			// get bytes in RX buffer
 //static stat_t run_sx(nvObj_t *nv);		// send XOFF, XON
 
@@ -113,6 +139,13 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "",   "line",_fi, 0, cm_print_line, cm_get_line, set_int,(float *)&cm.gm.linenum,0 },		// Active line number - model or runtime line number
 	{ "",   "vel", _f0, 2, cm_print_vel,  cm_get_vel,  set_nul,(float *)&cs.null, 0 },			// current velocity
 	{ "",   "feed",_f0, 2, cm_print_feed, cm_get_feed, set_nul,(float *)&cs.null, 0 },			// feed rate
+#ifdef __SPINDLE_RPM
+	{ "",   "srpm",_f0, 0, cm_print_srpm, cm_get_srpm, set_nul,(float *)&cs.null, 0 },			// measured spindle RPM
+#endif
+#ifdef __TIME_ESTIMATE
+	{ "",   "prog",_f0, 1, mp_print_prog, mp_get_prog, set_nul,(float *)&cs.null, 0 },			// job percent complete (needs an $est run)
+	{ "",   "eta", _f0, 1, mp_print_eta,  mp_get_eta,  set_nul,(float *)&cs.null, 0 },			// job seconds remaining (needs an $est run)
+#endif
 	{ "",   "stat",_f0, 0, cm_print_stat, cm_get_stat, set_nul,(float *)&cs.null, 0 },			// combined machine state
 	{ "",   "macs",_f0, 0, cm_print_macs, cm_get_macs, set_nul,(float *)&cs.null, 0 },			// raw machine state
 	{ "",   "cycs",_f0, 0, cm_print_cycs, cm_get_cycs, set_nul,(float *)&cs.null, 0 },			// cycle state
@@ -165,12 +198,24 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "prb","prbb",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[AXIS_B], 0 },
 	{ "prb","prbc",_f0, 3, tx_print_nul, get_flt, set_nul,(float *)&cm.probe_results[AXIS_C], 0 },
 
+#ifdef __HOMING_CAL
+	{ "hcl","hcla",_f0, 0, tx_print_nul, get_flt, set_nul,(float *)&cm.homing_cal_axis, 0 },	// homing calibration results
+	{ "hcl","hcln",_f0, 0, tx_print_nul, get_flt, set_nul,(float *)&cm.homing_cal_count, 0 },	// samples collected
+	{ "hcl","hclmn",_f0, 4, tx_print_nul, get_flt, set_nul,(float *)&cm.homing_cal_min, 0 },	// min latch offset from mean, mm
+	{ "hcl","hclmx",_f0, 4, tx_print_nul, get_flt, set_nul,(float *)&cm.homing_cal_max, 0 },	// max latch offset from mean, mm
+	{ "hcl","hclsd",_f0, 4, tx_print_nul, get_flt, set_nul,(float *)&cm.homing_cal_sdev, 0 },	// latch standard deviation, mm
+#endif
+
 	{ "jog","jogx",_f0, 0, tx_print_nul, get_nul, cm_run_jogx, (float *)&cm.jogging_dest, 0},
 	{ "jog","jogy",_f0, 0, tx_print_nul, get_nul, cm_run_jogy, (float *)&cm.jogging_dest, 0},
 	{ "jog","jogz",_f0, 0, tx_print_nul, get_nul, cm_run_jogz, (float *)&cm.jogging_dest, 0},
 	{ "jog","joga",_f0, 0, tx_print_nul, get_nul, cm_run_joga, (float *)&cm.jogging_dest, 0},
 //	{ "jog","jogb",_f0, 0, tx_print_nul, get_nul, cm_run_jogb, (float *)&cm.jogging_dest, 0},
 //	{ "jog","jogc",_f0, 0, tx_print_nul, get_nul, cm_run_jogc, (float *)&cm.jogging_dest, 0},
+#ifdef __MPG_WHEEL
+	{ "","mpga",_fip, 0, tx_print_int, get_ui8, cm_set_mpga,(float *)&cm.mpg_axis,	MPG_AXIS_DEFAULT },
+	{ "","mpgs",_fip, 4, tx_print_flt, get_flt, set_flt,	(float *)&cm.mpg_scale,	MPG_SCALE_DEFAULT },
+#endif
 
 	{ "pwr","pwr1",_f0, 0, st_print_pwr, st_get_pwr, set_nul, (float *)&cs.null, 0},	// motor power enable readouts
 	{ "pwr","pwr2",_f0, 0, st_print_pwr, st_get_pwr, set_nul, (float *)&cs.null, 0},
@@ -185,10 +230,32 @@ const cfgItem_t cfgArray[] PROGMEM = {
 
 	// Reports, tests, help, and messages
 	{ "", "sr",  _f0, 0, sr_print_sr,  sr_get,  sr_set,   (float *)&cs.null, 0 },	// status report object
+#ifdef __CONFIG_REPORT
+	{ "", "cr",  _f0, 0, tx_print_nul, cr_get,  cr_set,   (float *)&cs.null, 0 },	// config change report subscriptions
+#endif
 	{ "", "qr",  _f0, 0, qr_print_qr,  qr_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - planner buffers available
 	{ "", "qi",  _f0, 0, qr_print_qi,  qi_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - buffers added to queue
 	{ "", "qo",  _f0, 0, qr_print_qo,  qo_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - buffers removed from queue
+#ifdef __QR_LOOKAHEAD_TIME
+	{ "", "qt",  _f0, 0, qr_print_qt,  qt_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - planned time in queue (ms)
+	{ "", "qs",  _f0, 0, qr_print_qs,  qs_get,  set_nul,  (float *)&cs.null, 0 },	// queue report - starvation count
+#endif
+#ifdef __EVENT_TRACE
+	{ "", "det", _f0, 0, tx_print_int, dia_trace_get, set_nul,(float *)&cs.null, 0 },	// dump diagnostic event trace, returns event count
+#ifdef __TRACE_RING
+	{ "", "dtr", _f0, 0, tx_print_int, trace_get, set_nul,(float *)&cs.null, 0 },	// format and dump trace ring, returns record count
+#endif
+#endif
+#ifdef __PC_PROFILE
+	{ "", "pcd", _f0, 0, tx_print_int, dia_profile_get, set_nul,(float *)&cs.null, 0 },	// dump PC sample histogram, returns sample count
+#endif
+#ifdef __CRASH_DUMP
+	{ "", "crash",_f0, 0, tx_print_int, dia_crash_get, set_nul,(float *)&cs.null, 0 },	// read back watchdog post-mortem dump, returns record count
+#endif
 	{ "", "er",  _f0, 0, tx_print_nul, rpt_er,  set_nul,  (float *)&cs.null, 0 },	// invoke bogus exception report for testing
+#ifdef __ER_RING
+	{ "", "erd", _f0, 0, tx_print_int, rpt_er_get, set_nul,(float *)&cs.null, 0 },	// dump exception ring, returns record count
+#endif
 	{ "", "qf",  _f0, 0, tx_print_nul, get_nul, cm_run_qf,(float *)&cs.null, 0 },	// queue flush
 	{ "", "rx",  _f0, 0, tx_print_int, get_rx,  set_nul,  (float *)&cs.null, 0 },	// space in RX buffer
 	{ "", "msg", _f0, 0, tx_print_str, get_nul, set_nul,  (float *)&cs.null, 0 },	// string for generic messages
@@ -197,8 +264,43 @@ const cfgItem_t cfgArray[] PROGMEM = {
 //	{ "", "sx",  _f0, 0, tx_print_nul, run_sx,  run_sx ,  (float *)&cs.null, 0 },	// send XOFF, XON test
 
 	{ "", "test",_f0, 0, tx_print_nul, help_test, run_test, (float *)&cs.null,0 },	// run tests, print test help screen
+#ifdef __BENCHMARK
+	{ "", "bench",_f0, 0, tx_print_nul, help_test, run_benchmark, (float *)&cs.null,0 },	// run a test file with timing
+#endif
+#ifdef __TIME_ESTIMATE
+	{ "", "est", _f0, 0, tx_print_nul, get_nul, mp_set_estimate, (float *)&cs.null,0 },	// job time estimation mode on/off
+#endif
 	{ "", "defa",_f0, 0, tx_print_nul, help_defa, set_defaults,(float *)&cs.null,0 },	// set/print defaults / help screen
+#ifdef __BULK_SET
+	{ "", "bset",_f0, 0, tx_print_int, get_nul, set_bset, (float *)&cs.null,0 },	// bulk settings load - array of index,value pairs
+#endif
+#ifdef __SYNC_OUT
+	{ "", "sot", _f0, 3, tx_print_nul, get_nul, set_sot, (float *)&cs.null,0 },	// arm position-triggered output at N units of travel
+#endif
+#ifdef __JOB_CHECKPOINT
+	{ "", "rsm", _f0, 0, tx_print_int, get_nul, set_rsm, (float *)&cs.null,0 },	// restore job checkpoint - returns line number to re-stream from
+#endif
+#ifdef __PROBE_GRID
+	{ "", "prbg",_f0, 0, tx_print_nul, get_nul, set_prbg, (float *)&cs.null,0 },	// grid probing cycle - [x0,y0,x1,y1,nx,ny,zclear,zmin,feed]
+#endif
+#ifdef __MESH_COMP
+	{ "", "mesh",_f0, 0, tx_print_int, get_mesh, set_mesh, (float *)&cs.null,0 },	// mesh Z-compensation on/off (map comes from prbg)
+#endif
 	{ "", "boot",_f0, 0, tx_print_nul, help_boot_loader,hw_run_boot, (float *)&cs.null,0 },
+#ifdef __JOB_STORE
+	{ "", "job", _f0, 0, tx_print_nul, job_get_job, job_run_job, (float *)&cs.null,0 },	// stored job: get = size in bytes, set 1 = replay
+#endif
+#ifdef __SD_CARD
+	{ "", "sd",  _f0, 0, tx_print_nul, sd_get_job, sd_run_job, (float *)&cs.null,0 },	// SD job image: get = size in bytes, set 1 = run
+#endif
+#ifdef __STARTUP_MACRO
+	{ "", "mac", _f0, 0, tx_print_nul, macro_get_macro, macro_set_macro, (float *)&cs.null,0 },	// startup macro: get = size in bytes, 1 = record, 0 = erase, 2 = run
+#endif
+#ifdef __SETTINGS_PROFILES
+	// "profs" must precede "prof" - longer tokens precede shorter overlapping ones
+	{ "", "profs",_f0, 0, tx_print_nul, get_nul, profile_save_profile, (float *)&cs.null,0 },	// burn current settings into flash slot n
+	{ "", "prof",_f0, 0, tx_print_nul, profile_get_profile, profile_set_profile, (float *)&cs.null,0 },	// settings profile: get = active, set = activate (0 = EEPROM image)
+#endif
 
 #ifdef __HELP_SCREENS
 	{ "", "help",_f0, 0, tx_print_nul, help_config, set_nul, (float *)&cs.null,0 },  // prints config help screen
@@ -212,6 +314,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "1","1mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_1].microsteps,	M1_MICROSTEPS },
 	{ "1","1po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_1].polarity,	M1_POLARITY },
 	{ "1","1pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_1].power_mode,	M1_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "1","1bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_1].backlash,	M1_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "1","1pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_1].power_level,M1_POWER_LEVEL },
 #endif
@@ -222,6 +327,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "2","2mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_2].microsteps,	M2_MICROSTEPS },
 	{ "2","2po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_2].polarity,	M2_POLARITY },
 	{ "2","2pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_2].power_mode,	M2_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "2","2bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_2].backlash,	M2_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "2","2pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_2].power_level,M2_POWER_LEVEL},
 #endif
@@ -233,6 +341,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "3","3mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_3].microsteps,	M3_MICROSTEPS },
 	{ "3","3po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_3].polarity,	M3_POLARITY },
 	{ "3","3pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_3].power_mode,	M3_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "3","3bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_3].backlash,	M3_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "3","3pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_3].power_level,M3_POWER_LEVEL },
 #endif
@@ -244,6 +355,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "4","4mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_4].microsteps,	M4_MICROSTEPS },
 	{ "4","4po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_4].polarity,	M4_POLARITY },
 	{ "4","4pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_4].power_mode,	M4_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "4","4bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_4].backlash,	M4_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "4","4pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_4].power_level,M4_POWER_LEVEL },
 #endif
@@ -255,6 +369,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "5","5mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_5].microsteps,	M5_MICROSTEPS },
 	{ "5","5po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_5].polarity,	M5_POLARITY },
 	{ "5","5pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_5].power_mode,	M5_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "5","5bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_5].backlash,	M5_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "5","5pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_5].power_level,M5_POWER_LEVEL },
 #endif
@@ -266,18 +383,28 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "6","6mi",_fip, 0, st_print_mi, get_ui8, st_set_mi, (float *)&st_cfg.mot[MOTOR_6].microsteps,	M6_MICROSTEPS },
 	{ "6","6po",_fip, 0, st_print_po, get_ui8, set_01,    (float *)&st_cfg.mot[MOTOR_6].polarity,	M6_POLARITY },
 	{ "6","6pm",_fip, 0, st_print_pm, get_ui8, st_set_pm, (float *)&st_cfg.mot[MOTOR_6].power_mode,	M6_POWER_MODE },
+#ifdef __BACKLASH_COMP
+	{ "6","6bl",_fipc,4, st_print_bl, get_flt, set_flu,   (float *)&st_cfg.mot[MOTOR_6].backlash,	M6_BACKLASH },
+#endif
 #ifdef __ARM
 	{ "6","6pl",_fip, 3, st_print_pl, get_flt, st_set_pl, (float *)&st_cfg.mot[MOTOR_6].power_level,M6_POWER_LEVEL },
 #endif
 #endif
 	// Axis parameters
 	{ "x","xam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_X].axis_mode,		X_AXIS_MODE },
-	{ "x","xvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].velocity_max,	X_VELOCITY_MAX },
-	{ "x","xfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].feedrate_max,	X_FEEDRATE_MAX },
-	{ "x","xtn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].travel_min,		X_TRAVEL_MIN },
-	{ "x","xtm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].travel_max,		X_TRAVEL_MAX },
+	{ "x","xvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_X].velocity_max,	X_VELOCITY_MAX },
+	{ "x","xfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_X].feedrate_max,	X_FEEDRATE_MAX },
+	{ "x","xtn",_fipc, 3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_X].travel_min,		X_TRAVEL_MIN },
+	{ "x","xtm",_fipc, 3, cm_print_tm, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_X].travel_max,		X_TRAVEL_MAX },
 	{ "x","xjm",_fipc, 0, cm_print_jm, get_flt,   cm_set_xjm,(float *)&cm.a[AXIS_X].jerk_max,		X_JERK_MAX },
 	{ "x","xjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_X].jerk_homing,	X_JERK_HOMING },
+#ifdef __TRAVERSE_JERK
+	{ "x","xjt",_fipc, 0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_X].jerk_traverse,	X_JERK_TRAVERSE },
+#endif
+#ifdef __INPUT_SHAPER
+	{ "x","xshf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_X].shaper_freq,	SHAPER_FREQUENCY },
+	{ "x","xshz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_X].shaper_zeta,	SHAPER_ZETA },
+#endif
 	{ "x","xjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].junction_dev,	X_JUNCTION_DEVIATION },
 	{ "x","xsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[0],					X_SWITCH_MODE_MIN },
 	{ "x","xsx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[1],					X_SWITCH_MODE_MAX },
@@ -289,12 +416,19 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "x","xzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_X].zero_backoff,	X_ZERO_BACKOFF },
 
 	{ "y","yam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Y].axis_mode,		Y_AXIS_MODE },
-	{ "y","yvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].velocity_max,	Y_VELOCITY_MAX },
-	{ "y","yfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].feedrate_max,	Y_FEEDRATE_MAX },
-	{ "y","ytn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].travel_min,		Y_TRAVEL_MIN },
-	{ "y","ytm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].travel_max,		Y_TRAVEL_MAX },
+	{ "y","yvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_Y].velocity_max,	Y_VELOCITY_MAX },
+	{ "y","yfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_Y].feedrate_max,	Y_FEEDRATE_MAX },
+	{ "y","ytn",_fipc, 3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_Y].travel_min,		Y_TRAVEL_MIN },
+	{ "y","ytm",_fipc, 3, cm_print_tm, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_Y].travel_max,		Y_TRAVEL_MAX },
 	{ "y","yjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_Y].jerk_max,		Y_JERK_MAX },
 	{ "y","yjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_Y].jerk_homing,	Y_JERK_HOMING },
+#ifdef __TRAVERSE_JERK
+	{ "y","yjt",_fipc, 0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_Y].jerk_traverse,	Y_JERK_TRAVERSE },
+#endif
+#ifdef __INPUT_SHAPER
+	{ "y","yshf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_Y].shaper_freq,	SHAPER_FREQUENCY },
+	{ "y","yshz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_Y].shaper_zeta,	SHAPER_ZETA },
+#endif
 	{ "y","yjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].junction_dev,	Y_JUNCTION_DEVIATION },
 	{ "y","ysn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[2],					Y_SWITCH_MODE_MIN },
 	{ "y","ysx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[3],					Y_SWITCH_MODE_MAX },
@@ -306,12 +440,19 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "y","yzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Y].zero_backoff,	Y_ZERO_BACKOFF },
 
 	{ "z","zam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_Z].axis_mode,		Z_AXIS_MODE },
-	{ "z","zvm",_fipc, 0, cm_print_vm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].velocity_max,	Z_VELOCITY_MAX },
-	{ "z","zfr",_fipc, 0, cm_print_fr, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].feedrate_max,	Z_FEEDRATE_MAX },
-	{ "z","ztn",_fipc, 3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].travel_min,		Z_TRAVEL_MIN },
-	{ "z","ztm",_fipc, 3, cm_print_tm, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].travel_max,		Z_TRAVEL_MAX },
+	{ "z","zvm",_fipc, 0, cm_print_vm, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_Z].velocity_max,	Z_VELOCITY_MAX },
+	{ "z","zfr",_fipc, 0, cm_print_fr, get_flt,   cm_set_xvm,(float *)&cm.a[AXIS_Z].feedrate_max,	Z_FEEDRATE_MAX },
+	{ "z","ztn",_fipc, 3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_Z].travel_min,		Z_TRAVEL_MIN },
+	{ "z","ztm",_fipc, 3, cm_print_tm, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_Z].travel_max,		Z_TRAVEL_MAX },
 	{ "z","zjm",_fipc, 0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_Z].jerk_max,		Z_JERK_MAX },
 	{ "z","zjh",_fipc, 0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_Z].jerk_homing, 	Z_JERK_HOMING },
+#ifdef __TRAVERSE_JERK
+	{ "z","zjt",_fipc, 0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_Z].jerk_traverse,	Z_JERK_TRAVERSE },
+#endif
+#ifdef __INPUT_SHAPER
+	{ "z","zshf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_Z].shaper_freq,	SHAPER_FREQUENCY },
+	{ "z","zshz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_Z].shaper_zeta,	SHAPER_ZETA },
+#endif
 	{ "z","zjd",_fipc, 4, cm_print_jd, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].junction_dev,	Z_JUNCTION_DEVIATION },
 	{ "z","zsn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[4],					Z_SWITCH_MODE_MIN },
 	{ "z","zsx",_fip,  0, cm_print_sx, get_ui8,   sw_set_sw, (float *)&sw.mode[5],					Z_SWITCH_MODE_MAX },
@@ -323,12 +464,19 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "z","zzb",_fipc, 3, cm_print_zb, get_flt,   set_flu,   (float *)&cm.a[AXIS_Z].zero_backoff,	Z_ZERO_BACKOFF },
 
 	{ "a","aam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_A].axis_mode,		A_AXIS_MODE },
-	{ "a","avm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].velocity_max,	A_VELOCITY_MAX },
-	{ "a","afr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].feedrate_max,	A_FEEDRATE_MAX },
-	{ "a","atn",_fip,  3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_A].travel_min,		A_TRAVEL_MIN },
-	{ "a","atm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].travel_max,		A_TRAVEL_MAX },
+	{ "a","avm",_fip,  0, cm_print_vm, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_A].velocity_max,	A_VELOCITY_MAX },
+	{ "a","afr",_fip,  0, cm_print_fr, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_A].feedrate_max,	A_FEEDRATE_MAX },
+	{ "a","atn",_fip,  3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_A].travel_min,		A_TRAVEL_MIN },
+	{ "a","atm",_fip,  3, cm_print_tm, get_flt,   cm_set_trt,(float *)&cm.a[AXIS_A].travel_max,		A_TRAVEL_MAX },
 	{ "a","ajm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_A].jerk_max,		A_JERK_MAX },
 	{ "a","ajh",_fip,  0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_A].jerk_homing, 	A_JERK_HOMING },
+#ifdef __TRAVERSE_JERK
+	{ "a","ajt",_fip,  0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_A].jerk_traverse,	A_JERK_TRAVERSE },
+#endif
+#ifdef __INPUT_SHAPER
+	{ "a","ashf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_A].shaper_freq,	SHAPER_FREQUENCY },
+	{ "a","ashz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_A].shaper_zeta,	SHAPER_ZETA },
+#endif
 	{ "a","ajd",_fip,  4, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].junction_dev,	A_JUNCTION_DEVIATION },
 	{ "a","ara",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].radius,			A_RADIUS},
 	{ "a","asn",_fip,  0, cm_print_sn, get_ui8,   sw_set_sw, (float *)&sw.mode[6],					A_SWITCH_MODE_MIN },
@@ -341,10 +489,10 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "a","azb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_A].zero_backoff,	A_ZERO_BACKOFF },
 
 	{ "b","bam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_B].axis_mode,		B_AXIS_MODE },
-	{ "b","bvm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].velocity_max,	B_VELOCITY_MAX },
-	{ "b","bfr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].feedrate_max,	B_FEEDRATE_MAX },
-	{ "b","btn",_fip,  3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_B].travel_min,		B_TRAVEL_MIN },
-	{ "b","btm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX },
+	{ "b","bvm",_fip,  0, cm_print_vm, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_B].velocity_max,	B_VELOCITY_MAX },
+	{ "b","bfr",_fip,  0, cm_print_fr, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_B].feedrate_max,	B_FEEDRATE_MAX },
+	{ "b","btn",_fip,  3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_B].travel_min,		B_TRAVEL_MIN },
+	{ "b","btm",_fip,  3, cm_print_tm, get_flt,   cm_set_trt,(float *)&cm.a[AXIS_B].travel_max,		B_TRAVEL_MAX },
 	{ "b","bjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_B].jerk_max,		B_JERK_MAX },
 	{ "b","bjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].junction_dev,	B_JUNCTION_DEVIATION },
 	{ "b","bra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].radius,			B_RADIUS },
@@ -356,13 +504,20 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "b","blb",_fip,  3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].latch_backoff,	B_LATCH_BACKOFF },
 	{ "b","bzb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_B].zero_backoff,	B_ZERO_BACKOFF },
 	{ "b","bjh",_fip,  0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_B].jerk_homing,	B_JERK_HOMING },
+#ifdef __INPUT_SHAPER
+	{ "b","bshf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_B].shaper_freq,	SHAPER_FREQUENCY },
+	{ "b","bshz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_B].shaper_zeta,	SHAPER_ZETA },
+#endif
+#ifdef __TRAVERSE_JERK
+	{ "b","bjt",_fip,  0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_B].jerk_traverse,	B_JERK_TRAVERSE },
+#endif
 #endif
 
 	{ "c","cam",_fip,  0, cm_print_am, cm_get_am, cm_set_am, (float *)&cm.a[AXIS_C].axis_mode,		C_AXIS_MODE },
-	{ "c","cvm",_fip,  0, cm_print_vm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].velocity_max,	C_VELOCITY_MAX },
-	{ "c","cfr",_fip,  0, cm_print_fr, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].feedrate_max,	C_FEEDRATE_MAX },
-	{ "c","ctn",_fip,  3, cm_print_tn, get_flt,   set_flu,   (float *)&cm.a[AXIS_C].travel_min,		C_TRAVEL_MIN },
-	{ "c","ctm",_fip,  3, cm_print_tm, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX },
+	{ "c","cvm",_fip,  0, cm_print_vm, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_C].velocity_max,	C_VELOCITY_MAX },
+	{ "c","cfr",_fip,  0, cm_print_fr, get_flt,   cm_set_avm,(float *)&cm.a[AXIS_C].feedrate_max,	C_FEEDRATE_MAX },
+	{ "c","ctn",_fip,  3, cm_print_tn, get_flt,   cm_set_trv,(float *)&cm.a[AXIS_C].travel_min,		C_TRAVEL_MIN },
+	{ "c","ctm",_fip,  3, cm_print_tm, get_flt,   cm_set_trt,(float *)&cm.a[AXIS_C].travel_max,		C_TRAVEL_MAX },
 	{ "c","cjm",_fip,  0, cm_print_jm, get_flt,	  cm_set_xjm,(float *)&cm.a[AXIS_C].jerk_max,		C_JERK_MAX },
 	{ "c","cjd",_fip,  0, cm_print_jd, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].junction_dev,	C_JUNCTION_DEVIATION },
 	{ "c","cra",_fipc, 3, cm_print_ra, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].radius,			C_RADIUS },
@@ -374,62 +529,116 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "c","clb",_fip,  3, cm_print_lb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].latch_backoff,	C_LATCH_BACKOFF },
 	{ "c","czb",_fip,  3, cm_print_zb, get_flt,   set_flt,   (float *)&cm.a[AXIS_C].zero_backoff,	C_ZERO_BACKOFF },
 	{ "c","cjh",_fip,  0, cm_print_jh, get_flt,	  cm_set_xjh,(float *)&cm.a[AXIS_C].jerk_homing, 	C_JERK_HOMING },
+#ifdef __INPUT_SHAPER
+	{ "c","cshf",_fip, 1, cm_print_shf,get_flt,	  set_flt,   (float *)&cm.a[AXIS_C].shaper_freq,	SHAPER_FREQUENCY },
+	{ "c","cshz",_fip, 3, cm_print_shz,get_flt,	  set_flt,   (float *)&cm.a[AXIS_C].shaper_zeta,	SHAPER_ZETA },
+#endif
+#ifdef __TRAVERSE_JERK
+	{ "c","cjt",_fip,  0, cm_print_jt, get_flt,	  cm_set_xjt,(float *)&cm.a[AXIS_C].jerk_traverse,	C_JERK_TRAVERSE },
+#endif
 #endif
 
 	// PWM settings
 	{ "p1","p1frq",_fip, 0, pwm_print_p1frq, get_flt, set_flt,(float *)&pwm.c[PWM_1].frequency,		P1_PWM_FREQUENCY },
-	{ "p1","p1csl",_fip, 0, pwm_print_p1csl, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_speed_lo,	P1_CW_SPEED_LO },
-	{ "p1","p1csh",_fip, 0, pwm_print_p1csh, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_speed_hi,	P1_CW_SPEED_HI },
-	{ "p1","p1cpl",_fip, 3, pwm_print_p1cpl, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_phase_lo,	P1_CW_PHASE_LO },
-	{ "p1","p1cph",_fip, 3, pwm_print_p1cph, get_flt, set_flt,(float *)&pwm.c[PWM_1].cw_phase_hi,	P1_CW_PHASE_HI },
-	{ "p1","p1wsl",_fip, 0, pwm_print_p1wsl, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_speed_lo,	P1_CCW_SPEED_LO },
-	{ "p1","p1wsh",_fip, 0, pwm_print_p1wsh, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_speed_hi,	P1_CCW_SPEED_HI },
-	{ "p1","p1wpl",_fip, 3, pwm_print_p1wpl, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_phase_lo,	P1_CCW_PHASE_LO },
-	{ "p1","p1wph",_fip, 3, pwm_print_p1wph, get_flt, set_flt,(float *)&pwm.c[PWM_1].ccw_phase_hi,	P1_CCW_PHASE_HI },
+	{ "p1","p1csl",_fip, 0, pwm_print_p1csl, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].cw_speed_lo,	P1_CW_SPEED_LO },
+	{ "p1","p1csh",_fip, 0, pwm_print_p1csh, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].cw_speed_hi,	P1_CW_SPEED_HI },
+	{ "p1","p1cpl",_fip, 3, pwm_print_p1cpl, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].cw_phase_lo,	P1_CW_PHASE_LO },
+	{ "p1","p1cph",_fip, 3, pwm_print_p1cph, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].cw_phase_hi,	P1_CW_PHASE_HI },
+	{ "p1","p1wsl",_fip, 0, pwm_print_p1wsl, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].ccw_speed_lo,	P1_CCW_SPEED_LO },
+	{ "p1","p1wsh",_fip, 0, pwm_print_p1wsh, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].ccw_speed_hi,	P1_CCW_SPEED_HI },
+	{ "p1","p1wpl",_fip, 3, pwm_print_p1wpl, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].ccw_phase_lo,	P1_CCW_PHASE_LO },
+	{ "p1","p1wph",_fip, 3, pwm_print_p1wph, get_flt, pwm_set_cfg,(float *)&pwm.c[PWM_1].ccw_phase_hi,	P1_CCW_PHASE_HI },
 	{ "p1","p1pof",_fip, 3, pwm_print_p1pof, get_flt, set_flt,(float *)&pwm.c[PWM_1].phase_off,		P1_PWM_PHASE_OFF },
 
+#ifdef __THC
+	// Torch height control group ("thav" and "thof" must precede shorter overlapping tokens)
+	{ "th","thav",_f0, 1, thc_print_thav, get_flt, set_nul,(float *)&thc.arc_voltage,	0 },
+	{ "th","thof",_f0, 3, thc_print_thof, get_flt, set_nul,(float *)&thc.z_offset,		0 },
+	{ "th","the",_fip, 0, thc_print_the, get_ui8, set_01, (float *)&thc.enable,			THC_ENABLE },
+	{ "th","thv",_fip, 1, thc_print_thv, get_flt, set_flt,(float *)&thc.target_voltage,	THC_TARGET_VOLTAGE },
+	{ "th","thg",_fip, 4, thc_print_thg, get_flt, set_flt,(float *)&thc.gain,			THC_GAIN },
+	{ "th","tha",_fip, 3, thc_print_tha, get_flt, set_flt,(float *)&thc.authority,		THC_AUTHORITY },
+	{ "th","thr",_fip, 0, thc_print_thr, get_flt, set_flt,(float *)&thc.rate,			THC_RATE },
+	{ "th","ths",_fip, 4, thc_print_ths, get_flt, set_flt,(float *)&thc.scale,			THC_VOLTAGE_SCALE },
+#endif
+
+#ifdef __ADAPTIVE_FEED
+	// Adaptive feed control group ("aflv" and "afof" must precede shorter overlapping tokens)
+	{ "af","aflv",_f0, 2, afc_print_aflv, get_flt, set_nul,(float *)&afc.load_voltage,	0 },
+	{ "af","afof",_f0, 3, afc_print_afof, get_flt, set_nul,(float *)&afc.factor,		0 },
+	{ "af","afe",_fip, 0, afc_print_afe, get_ui8, set_01, (float *)&afc.enable,			AFC_ENABLE },
+	{ "af","afv",_fip, 2, afc_print_afv, get_flt, set_flt,(float *)&afc.target_voltage,	AFC_TARGET_VOLTAGE },
+	{ "af","afg",_fip, 4, afc_print_afg, get_flt, set_flt,(float *)&afc.gain,			AFC_GAIN },
+	{ "af","afa",_fip, 3, afc_print_afa, get_flt, set_flt,(float *)&afc.authority,		AFC_AUTHORITY },
+	{ "af","afr",_fip, 3, afc_print_afr, get_flt, set_flt,(float *)&afc.rate,			AFC_RATE },
+	{ "af","afs",_fip, 5, afc_print_afs, get_flt, set_flt,(float *)&afc.scale,			AFC_VOLTAGE_SCALE },
+#endif
+
 	// Coordinate system offsets (G54-G59 and G92)
-	{ "g54","g54x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_X], G54_X_OFFSET },
-	{ "g54","g54y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_Y], G54_Y_OFFSET },
-	{ "g54","g54z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_Z], G54_Z_OFFSET },
-	{ "g54","g54a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_A], G54_A_OFFSET },
-	{ "g54","g54b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_B], G54_B_OFFSET },
-	{ "g54","g54c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G54][AXIS_C], G54_C_OFFSET },
-
-	{ "g55","g55x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_X], G55_X_OFFSET },
-	{ "g55","g55y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_Y], G55_Y_OFFSET },
-	{ "g55","g55z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_Z], G55_Z_OFFSET },
-	{ "g55","g55a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_A], G55_A_OFFSET },
-	{ "g55","g55b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_B], G55_B_OFFSET },
-	{ "g55","g55c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G55][AXIS_C], G55_C_OFFSET },
-
-	{ "g56","g56x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_X], G56_X_OFFSET },
-	{ "g56","g56y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_Y], G56_Y_OFFSET },
-	{ "g56","g56z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_Z], G56_Z_OFFSET },
-	{ "g56","g56a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_A], G56_A_OFFSET },
-	{ "g56","g56b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_B], G56_B_OFFSET },
-	{ "g56","g56c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G56][AXIS_C], G56_C_OFFSET },
-
-	{ "g57","g57x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_X], G57_X_OFFSET },
-	{ "g57","g57y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_Y], G57_Y_OFFSET },
-	{ "g57","g57z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_Z], G57_Z_OFFSET },
-	{ "g57","g57a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_A], G57_A_OFFSET },
-	{ "g57","g57b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_B], G57_B_OFFSET },
-	{ "g57","g57c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G57][AXIS_C], G57_C_OFFSET },
-
-	{ "g58","g58x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_X], G58_X_OFFSET },
-	{ "g58","g58y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_Y], G58_Y_OFFSET },
-	{ "g58","g58z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_Z], G58_Z_OFFSET },
-	{ "g58","g58a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_A], G58_A_OFFSET },
-	{ "g58","g58b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_B], G58_B_OFFSET },
-	{ "g58","g58c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G58][AXIS_C], G58_C_OFFSET },
-
-	{ "g59","g59x",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_X], G59_X_OFFSET },
-	{ "g59","g59y",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_Y], G59_Y_OFFSET },
-	{ "g59","g59z",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_Z], G59_Z_OFFSET },
-	{ "g59","g59a",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_A], G59_A_OFFSET },
-	{ "g59","g59b",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_B], G59_B_OFFSET },
-	{ "g59","g59c",_fipc, 3, cm_print_cofs, get_flt, set_flu,(float *)&cm.offset[G59][AXIS_C], G59_C_OFFSET },
+	{ "g54","g54x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_X], G54_X_OFFSET },
+	{ "g54","g54y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_Y], G54_Y_OFFSET },
+	{ "g54","g54z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_Z], G54_Z_OFFSET },
+	{ "g54","g54a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_A], G54_A_OFFSET },
+	{ "g54","g54b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_B], G54_B_OFFSET },
+	{ "g54","g54c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G54][AXIS_C], G54_C_OFFSET },
+
+	{ "g55","g55x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_X], G55_X_OFFSET },
+	{ "g55","g55y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_Y], G55_Y_OFFSET },
+	{ "g55","g55z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_Z], G55_Z_OFFSET },
+	{ "g55","g55a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_A], G55_A_OFFSET },
+	{ "g55","g55b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_B], G55_B_OFFSET },
+	{ "g55","g55c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G55][AXIS_C], G55_C_OFFSET },
+
+	{ "g56","g56x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_X], G56_X_OFFSET },
+	{ "g56","g56y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_Y], G56_Y_OFFSET },
+	{ "g56","g56z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_Z], G56_Z_OFFSET },
+	{ "g56","g56a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_A], G56_A_OFFSET },
+	{ "g56","g56b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_B], G56_B_OFFSET },
+	{ "g56","g56c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G56][AXIS_C], G56_C_OFFSET },
+
+	{ "g57","g57x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_X], G57_X_OFFSET },
+	{ "g57","g57y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_Y], G57_Y_OFFSET },
+	{ "g57","g57z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_Z], G57_Z_OFFSET },
+	{ "g57","g57a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_A], G57_A_OFFSET },
+	{ "g57","g57b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_B], G57_B_OFFSET },
+	{ "g57","g57c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G57][AXIS_C], G57_C_OFFSET },
+
+	{ "g58","g58x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_X], G58_X_OFFSET },
+	{ "g58","g58y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_Y], G58_Y_OFFSET },
+	{ "g58","g58z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_Z], G58_Z_OFFSET },
+	{ "g58","g58a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_A], G58_A_OFFSET },
+	{ "g58","g58b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_B], G58_B_OFFSET },
+	{ "g58","g58c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G58][AXIS_C], G58_C_OFFSET },
+
+	{ "g59","g59x",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_X], G59_X_OFFSET },
+	{ "g59","g59y",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_Y], G59_Y_OFFSET },
+	{ "g59","g59z",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_Z], G59_Z_OFFSET },
+	{ "g59","g59a",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_A], G59_A_OFFSET },
+	{ "g59","g59b",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_B], G59_B_OFFSET },
+	{ "g59","g59c",_fipc, 3, cm_print_cofs, get_flt, cm_set_ofs,(float *)&cm.offset[G59][AXIS_C], G59_C_OFFSET },
+
+#ifdef __TOOL_TABLE
+	// tool table: per-tool Z length offset (G43) and diameter
+	{ "tt1","tt1z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[1], 0 },
+	{ "tt1","tt1d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[1], 0 },
+	{ "tt2","tt2z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[2], 0 },
+	{ "tt2","tt2d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[2], 0 },
+	{ "tt3","tt3z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[3], 0 },
+	{ "tt3","tt3d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[3], 0 },
+	{ "tt4","tt4z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[4], 0 },
+	{ "tt4","tt4d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[4], 0 },
+	{ "tt5","tt5z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[5], 0 },
+	{ "tt5","tt5d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[5], 0 },
+	{ "tt6","tt6z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[6], 0 },
+	{ "tt6","tt6d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[6], 0 },
+	{ "tt7","tt7z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[7], 0 },
+	{ "tt7","tt7d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[7], 0 },
+	{ "tt8","tt8z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[8], 0 },
+	{ "tt8","tt8d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[8], 0 },
+	{ "tt9","tt9z",_fipc, 3, cm_print_ttl, get_flt, cm_set_tt,(float *)&cm.tt_length[9], 0 },
+	{ "tt9","tt9d",_fipc, 3, cm_print_ttd, get_flt, cm_set_tt,(float *)&cm.tt_diameter[9], 0 },
+#endif
+
 
 	{ "g92","g92x",_fi, 3, cm_print_cofs, get_flt, set_nul,(float *)&cm.gmx.origin_offset[AXIS_X], 0 },// G92 handled differently
 	{ "g92","g92y",_fi, 3, cm_print_cofs, get_flt, set_nul,(float *)&cm.gmx.origin_offset[AXIS_Y], 0 },
@@ -462,27 +671,79 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// System parameters
 	{ "sys","ja",  _fipnc,0, cm_print_ja,  get_flt,   set_flu,    (float *)&cm.junction_acceleration,JUNCTION_ACCELERATION },
 	{ "sys","ct",  _fipnc,4, cm_print_ct,  get_flt,   set_flu,    (float *)&cm.chordal_tolerance,	CHORDAL_TOLERANCE },
-	{ "sys","sl",  _fipn, 0, cm_print_sl,  get_ui8,   set_ui8,    (float *)&cm.soft_limit_enable,	SOFT_LIMIT_ENABLE },
+#ifdef __CHORD_BLEND
+	{ "sys","bt",  _fipnc,4, cm_print_bt,  get_flt,   set_flu,    (float *)&cm.blend_tolerance,		BLEND_TOLERANCE },
+#endif
+#ifdef __ADAPTIVE_SEGMENTS
+	{ "sys","sgl", _fipn, 0, mp_print_sgl, get_flt,   mp_set_sgl, (float *)&cm.segment_usec_min,	SEGMENT_USEC_MIN },
+	{ "sys","sgh", _fipn, 0, mp_print_sgh, get_flt,   mp_set_sgh, (float *)&cm.segment_usec_max,	SEGMENT_USEC_MAX },
+#ifdef __START_GATE
+	{ "sys","pst", _fipn, 0, mp_print_pst, get_flt,   mp_set_pst, (float *)&cm.planner_start_ms,	PLANNER_START_MS },
+#endif
+#ifdef __TRAP_PLAN
+	{ "sys","apm", _fipn, 0, mp_print_apm, get_ui8,   set_01,     (float *)&cm.plan_profile,		PLAN_PROFILE_JERK },
+#ifdef __INPUT_SHAPER
+	{ "sys","shm", _fipn, 0, mp_print_shm, get_ui8,   set_01,     (float *)&cm.shaper_mode,			SHAPER_MODE },
+#endif
+	{ "sys","amx", _fipn, 0, mp_print_amx, get_flt,   mp_set_amx, (float *)&cm.accel_max,			TRAP_ACCEL_MAX },
+#endif
+#endif
+	{ "sys","sl",  _fipn, 0, cm_print_sl,  get_ui8,   cm_set_sl,  (float *)&cm.soft_limit_enable,	SOFT_LIMIT_ENABLE },
 	{ "sys","st",  _fipn, 0, sw_print_st,  get_ui8,   sw_set_st,  (float *)&sw.switch_type,			SWITCH_TYPE },
+#ifdef __SW_EVENTS
+	{ "sys","sev", _fipn, 0, sw_print_sev, get_ui8,   set_ui8,    (float *)&sw.event_mask,				SW_EVENT_MASK },
+#endif
 	{ "sys","mt",  _fipn, 2, st_print_mt,  get_flt,   st_set_mt,  (float *)&st_cfg.motor_power_timeout,MOTOR_IDLE_TIMEOUT},
 	{ "sys","sa",  _fipn, 0, cm_print_sa,  get_ui8,   set_01,     (float *)&cm.gm.spindle_active_dir,	SPINDLE_ACTIVE_HIGH },
+#ifdef __SPINDLE_RPM
+	{ "sys","sppr",_fipn, 0, cm_print_sppr,get_ui8,   cm_set_sppr,(float *)&cm.spindle_pulses_per_rev,SPINDLE_PULSES_PER_REV },
+#endif
+#ifdef __HOLD_ACTIONS
+	{ "sys","fhz", _fipn, 3, cm_print_fhz, get_flt,   set_flu,    (float *)&cm.fh_z_retract,		FEEDHOLD_Z_RETRACT },
+	{ "sys","fhp", _fipn, 0, cm_print_fhp, get_ui8,   set_01,     (float *)&cm.fh_spindle_pause,	FEEDHOLD_SPINDLE_PAUSE },
+#endif
 	{ "",   "me",  _f0,   0, tx_print_str, st_set_me, st_set_me,  (float *)&cs.null, 0 },
 	{ "",   "md",  _f0,   0, tx_print_str, st_set_md, st_set_md,  (float *)&cs.null, 0 },
 
 	{ "sys","ej",  _fipn, 0, js_print_ej,  get_ui8,   set_01,     (float *)&cfg.comm_mode,			COMM_MODE },
 	{ "sys","jv",  _fipn, 0, js_print_jv,  get_ui8,   json_set_jv,(float *)&js.json_verbosity,		JSON_VERBOSITY },
 	{ "sys","js",  _fipn, 0, js_print_js,  get_ui8,   set_01,     (float *)&js.json_syntax, 		JSON_SYNTAX_MODE },
+#ifdef __ACK_WINDOW
+	{ "sys","aw",  _f0,   0, js_print_aw,  get_ui8,   json_set_aw,(float *)&js.ack_window,			0 },
+#endif
+#ifdef __TERSE_ACK
+	{ "sys","ta",  _f0,   0, js_print_ta,  get_ui8,   json_set_ta,(float *)&js.terse_ack,			0 },
+#endif
 	{ "sys","tv",  _fipn, 0, tx_print_tv,  get_ui8,   set_01,     (float *)&txt.text_verbosity,		TEXT_VERBOSITY },
+#ifdef __HOMING_CAL
+	{ "sys","hcp", _f0,   0, tx_print_nul, get_ui8,   set_ui8,    (float *)&cm.homing_cal_passes,	0 },	// homing cal latch repeats (0,1=off)
+#endif
 	{ "sys","qv",  _fipn, 0, qr_print_qv,  get_ui8,   set_0123,   (float *)&qr.queue_report_verbosity,QUEUE_REPORT_VERBOSITY },
+#ifdef __JOB_STATS
+	{ "sys","jse", _fipn, 0, jst_print_jse,get_ui8,   set_01,     (float *)&jst.summary_enable,		JOB_SUMMARY_ENABLE },
+#endif
 	{ "sys","sv",  _fipn, 0, sr_print_sv,  get_ui8,   set_012,    (float *)&sr.status_report_verbosity,STATUS_REPORT_VERBOSITY },
 	{ "sys","si",  _fipn, 0, sr_print_si,  get_int,   sr_set_si,  (float *)&sr.status_report_interval,STATUS_REPORT_INTERVAL_MS },
+#ifdef __SR_BINARY
+	{ "sys","sb",  _fipn, 0, sr_print_sb,  get_ui8,   set_01,     (float *)&sr.binary_report,		STATUS_REPORT_BINARY },
+#endif
+#ifdef __PLAN_EXPORT
+	{ "sys","pex", _fipn, 0, pex_print_pex,get_ui8,   pex_set_pex,(float *)&pex.enable,			PLAN_EXPORT_STREAM },
+#endif
 //	{ "sys","spi", _fipn, 0, xio_print_spi,get_ui8,   xio_set_spi,(float *)&xio.spi_state,			0 },
 
 	{ "sys","ec",  _fipn, 0, cfg_print_ec,  get_ui8,   set_ec,     (float *)&cfg.enable_cr,			COM_EXPAND_CR },
 	{ "sys","ee",  _fipn, 0, cfg_print_ee,  get_ui8,   set_ee,     (float *)&cfg.enable_echo,		COM_ENABLE_ECHO },
 	{ "sys","ex",  _fipn, 0, cfg_print_ex,  get_ui8,   set_ex,     (float *)&cfg.enable_flow_control,COM_ENABLE_FLOW_CONTROL },
+#ifdef __LINE_CRC
+	{ "sys","fr",  _fipn, 0, cfg_print_fr,  get_ui8,   set_fr,     (float *)&cfg.enable_line_crc,	COM_ENABLE_LINE_CRC },
+#endif
 	{ "sys","baud",_fn,   0, cfg_print_baud,get_ui8,   set_baud,   (float *)&cfg.usb_baud_rate,		XIO_BAUD_115200 },
 	{ "sys","net", _fipn, 0, cfg_print_net, get_ui8,   set_ui8,    (float *)&cs.network_mode,		NETWORK_MODE },
+#ifdef __SYNC_OUT
+	{ "sys","soax",_fipn, 0, tx_print_nul, get_ui8,    set_ui8,    (float *)&cfg.sync_out_axis,		SYNC_OUT_AXIS },
+	{ "sys","sobm",_fipn, 0, tx_print_nul, get_ui8,    set_ui8,    (float *)&cfg.sync_out_bitmask,	SYNC_OUT_BITMASK },
+#endif
 
 	// switch state readouts
 /*
@@ -539,6 +800,13 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "_te","_teb",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_B], 0 },
 	{ "_te","_tec",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target[AXIS_C], 0 },
 
+	{ "_pz","_pzi",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&mm.zoid_iterations, 0 },			// zoid iterations, last block
+	{ "_pz","_pzm",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&mm.zoid_iterations_max, 0 },		// zoid iterations high water mark
+#ifdef __ZOID_CACHE
+	{ "_pz","_pzch",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&mm.zoid_cache_hits, 0 },			// zoid profile cache hits
+	{ "_pz","_pzcm",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&mm.zoid_cache_misses, 0 },		// zoid profile cache misses
+#endif
+
 	{ "_tr","_trx",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.gm.target[AXIS_X], 0 },			// X target runtime
 	{ "_tr","_try",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.gm.target[AXIS_Y], 0 },
 	{ "_tr","_trz",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.gm.target[AXIS_Z], 0 },
@@ -549,54 +817,73 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #if (MOTORS >= 1)
 	{ "_ts","_ts1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_1], 0 },		// Motor 1 target steps
 	{ "_ps","_ps1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_1], 0 },	// Motor 1 position steps
-	{ "_cs","_cs1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_1], 0 },	// Motor 1 commanded steps (delayed steps)
-	{ "_es","_es1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_1], 0 },	// Motor 1 encoder steps
+	{ "_cs","_cs1",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_1], 0 },	// Motor 1 commanded steps (delayed steps)
+	{ "_es","_es1",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_1], 0 },	// Motor 1 encoder steps
 	{ "_xs","_xs1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_1].corrected_steps, 0 }, // Motor 1 correction steps applied
 	{ "_fe","_fe1",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_1], 0 },	// Motor 1 following error in steps
 #endif
 #if (MOTORS >= 2)
 	{ "_ts","_ts2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_2], 0 },
 	{ "_ps","_ps2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_2], 0 },
-	{ "_cs","_cs2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_2], 0 },
-	{ "_es","_es2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_2], 0 },
+	{ "_cs","_cs2",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_2], 0 },
+	{ "_es","_es2",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_2], 0 },
 	{ "_xs","_xs2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_2].corrected_steps, 0 },
 	{ "_fe","_fe2",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_2], 0 },
 #endif
 #if (MOTORS >= 3)
 	{ "_ts","_ts3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_3], 0 },
 	{ "_ps","_ps3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_3], 0 },
-	{ "_cs","_cs3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_3], 0 },
-	{ "_es","_es3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_3], 0 },
+	{ "_cs","_cs3",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_3], 0 },
+	{ "_es","_es3",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_3], 0 },
 	{ "_xs","_xs3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_3].corrected_steps, 0 },
 	{ "_fe","_fe3",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_3], 0 },
 #endif
 #if (MOTORS >= 4)
 	{ "_ts","_ts4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_4], 0 },
 	{ "_ps","_ps4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_4], 0 },
-	{ "_cs","_cs4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_4], 0 },
-	{ "_es","_es4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_4], 0 },
+	{ "_cs","_cs4",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_4], 0 },
+	{ "_es","_es4",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_4], 0 },
 	{ "_xs","_xs4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_4].corrected_steps, 0 },
 	{ "_fe","_fe4",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_4], 0 },
 #endif
 #if (MOTORS >= 5)
 	{ "_ts","_ts5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_5], 0 },
 	{ "_ps","_ps5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_5], 0 },
-	{ "_cs","_cs5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_5], 0 },
-	{ "_es","_es5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_5], 0 },
+	{ "_cs","_cs5",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_5], 0 },
+	{ "_es","_es5",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_5], 0 },
 	{ "_xs","_xs6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_6].corrected_steps, 0 },
 	{ "_fe","_fe5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_5], 0 },
 #endif
 #if (MOTORS >= 6)
 	{ "_ts","_ts6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.target_steps[MOTOR_6], 0 },
 	{ "_ps","_ps6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.position_steps[MOTOR_6], 0 },
-	{ "_cs","_cs6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.commanded_steps[MOTOR_6], 0 },
-	{ "_es","_es6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.encoder_steps[MOTOR_6], 0 },
+	{ "_cs","_cs6",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.commanded_steps[MOTOR_6], 0 },
+	{ "_es","_es6",_f0, 0, tx_print_flt, get_int32, set_nul,(float *)&mr.encoder_steps[MOTOR_6], 0 },
 	{ "_xs","_xs5",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&st_pre.mot[MOTOR_5].corrected_steps, 0 },
 	{ "_fe","_fe6",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&mr.following_error[MOTOR_6], 0 },
 #endif
 	{ "",   "_dam",_f0, 0, tx_print_nul, cm_dam,  cm_dam, (float *)&cs.null, 0 },	// dump active model
 #endif	//  __DIAGNOSTIC_PARAMETERS
 
+	// Instrumentation counters (see diagnostics.c)
+#ifdef __DIAG
+	{ "dia","diad",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&dia.dda_usec_max, 0 },	// max DDA ISR duration (uSec)
+	{ "dia","dial",_f0, 2, tx_print_flt, get_flt, set_nul,(float *)&dia.load_usec_max, 0 },	// max load duration (uSec)
+	{ "dia","diax",_f0, 1, tx_print_flt, get_flt, set_nul,(float *)&dia.exec_pct, 0 },		// exec/prep occupancy (%)
+	{ "dia","diaq",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.queue_min, 0 },		// planner buffer low water mark
+	{ "dia","diar",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.rx_max, 0 },		// RX queue high water mark
+#ifdef __HIGH_BAUD
+	{ "dia","diao",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.rx_overruns, 0 },	// RX chars lost to overruns since boot
+	{ "dia","diaf",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.rx_ferrs, 0 },		// RX framing errors since boot
+#endif
+#ifdef __STACK_WATERMARK
+	{ "dia","dias",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.stack_free, 0 },	// stack bytes never touched
+#endif
+#ifdef __PREP_AHEAD
+	{ "dia","diap",_f0, 0, tx_print_flt, get_flt, set_nul,(float *)&dia.prep_late, 0 },	// late preps absorbed by the staged segment
+#endif
+#endif	// __DIAG
+
 	// Persistence for status report - must be in sequence
 	// *** Count must agree with NV_STATUS_REPORT_LEN in config.h ***
 	{ "","se00",_fp, 0, tx_print_nul, get_int, set_int,(float *)&sr.status_report_list[0],0 },
@@ -636,6 +923,12 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	// *** START COUNTING FROM HERE ***
 	{ "","sys",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// system group
 	{ "","p1", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// PWM 1 group
+#ifdef __THC
+	{ "","th", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// torch height control group
+#endif
+#ifdef __ADAPTIVE_FEED
+	{ "","af", _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// adaptive feed control group
+#endif
 
 	{ "","1",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// motor groups
 	{ "","2",  _f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
@@ -662,6 +955,17 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","g57",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
 	{ "","g58",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
 	{ "","g59",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#ifdef __TOOL_TABLE
+	{ "","tt1",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt2",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt3",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt4",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt5",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt6",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt7",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt8",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+	{ "","tt9",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },
+#endif
 	{ "","g92",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// origin offsets
 	{ "","g28",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// g28 home position
 	{ "","g30",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// g30 home position
@@ -671,6 +975,9 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","ofs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// work offset group
 	{ "","hom",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis homing state group
 	{ "","prb",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// probing state group
+#ifdef __HOMING_CAL
+	{ "","hcl",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// homing calibration results group
+#endif
 	{ "","pwr",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// motor power enagled group
 	{ "","jog",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// axis jogging state group
 	{ "","jid",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// job ID group
@@ -689,6 +996,11 @@ const cfgItem_t cfgArray[] PROGMEM = {
 	{ "","_es",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// encoder steps group
 	{ "","_xs",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// correction steps group
 	{ "","_fe",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// following error group
+	{ "","_pz",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// zoid solver iteration group
+#endif
+
+#ifdef __DIAG
+	{ "","dia",_f0, 0, tx_print_nul, get_grp, set_grp,(float *)&cs.null,0 },	// instrumentation counters group
 #endif
 
 	// Uber-group (groups of groups, for text-mode displays only)
@@ -702,7 +1014,7 @@ const cfgItem_t cfgArray[] PROGMEM = {
 /***** Make sure these defines line up with any changes in the above table *****/
 
 #define NV_COUNT_UBER_GROUPS 	4 		// count of uber-groups, above
-#define STANDARD_GROUPS 		33		// count of standard groups, excluding diagnostic parameter groups
+#define STANDARD_GROUPS 		34		// count of standard groups, excluding diagnostic parameter groups
 
 #if (MOTORS >= 5)
 #define MOTOR_GROUP_5			1
@@ -717,11 +1029,17 @@ const cfgItem_t cfgArray[] PROGMEM = {
 #endif
 
 #ifdef __DIAGNOSTIC_PARAMETERS
-#define DIAGNOSTIC_GROUPS 		8		// count of diagnostic groups only
+#define DIAGNOSTIC_GROUPS 		9		// count of diagnostic groups only
 #else
 #define DIAGNOSTIC_GROUPS 		0
 #endif
-#define NV_COUNT_GROUPS 		(STANDARD_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + DIAGNOSTIC_GROUPS)
+
+#ifdef __DIAG
+#define DIAG_GROUP	 			1		// instrumentation counters group
+#else
+#define DIAG_GROUP 				0
+#endif
+#define NV_COUNT_GROUPS 		(STANDARD_GROUPS + MOTOR_GROUP_5 + MOTOR_GROUP_6 + DIAGNOSTIC_GROUPS + DIAG_GROUP)
 
 /* <DO NOT MESS WITH THESE DEFINES> */
 #define NV_INDEX_MAX (sizeof cfgArray / sizeof(cfgItem_t))
@@ -735,6 +1053,219 @@ uint8_t nv_index_is_single(index_t index) { return ((index <= NV_INDEX_END_SINGL
 uint8_t nv_index_is_group(index_t index) { return (((index >= NV_INDEX_START_GROUPS) && (index < NV_INDEX_START_UBER_GROUPS)) ? true : false);}
 uint8_t nv_index_lt_groups(index_t index) { return ((index <= NV_INDEX_START_GROUPS) ? true : false);}
 
+#ifdef __CFG_SORTED_INDEX
+/* Sorted index acceleration for nv_get_index()
+ *
+ * nv_index_init() builds a RAM permutation of cfgArray ordered by token string so
+ * nv_index_lookup() can binary search instead of scanning all ~NV_INDEX_MAX PROGMEM
+ * records. Costs NV_INDEX_MAX * sizeof(index_t) bytes of RAM and a one-time sort at
+ * config_init() time; lookups drop from O(n) to O(log n). Ties (duplicate tokens)
+ * preserve cfgArray order so lookup returns the same index the linear scan would.
+ *
+ * A first-character bucket table over the permutation narrows the search range
+ * before the binary search starts, so text and JSON token resolution touches a
+ * handful of records instead of bisecting the full table. Buckets are monotone
+ * in ASCII order (digits, then letters) to agree with the sort; characters
+ * outside [0-9a-z] collapse into the nearest bucket.
+ *
+ * nv_index_init()	 - build the sorted permutation (binary insertion sort)
+ * nv_index_lookup() - return cfgArray index for a full "group+token" key or NO_MATCH
+ */
+
+#define CFG_INDEX_BUCKETS 37				// 10 digits + gap + 26 letters
+
+static index_t cfg_sorted_index[NV_INDEX_MAX];
+static index_t cfg_bucket[CFG_INDEX_BUCKETS+1];	// bucket b spans [cfg_bucket[b], cfg_bucket[b+1])
+
+static int8_t _index_cmp(const char_t *key, index_t index)
+{
+#ifdef __AVR
+	int8_t diff = strncmp_P(key, (const char *)&cfgArray[index].token, TOKEN_LEN+1);
+#else
+	int8_t diff = strncmp(key, cfgArray[index].token, TOKEN_LEN+1);
+#endif
+	return ((diff > 0) - (diff < 0));
+}
+
+static uint8_t _index_bucket(char_t c)
+{
+	if (c < '0') return (0);
+	if (c <= '9') return (c - '0');
+	if (c < 'a') return (10);
+	if (c <= 'z') return (11 + c - 'a');
+	return (CFG_INDEX_BUCKETS-1);
+}
+
+void nv_index_init()
+{
+	index_t i, lo, hi, mid;
+	char_t key[TOKEN_LEN+1];
+
+	for (i=0; i < NV_INDEX_MAX; i++) {
+		GET_TOKEN_STRING(i, key);
+		lo = 0; hi = i;							// binary insertion into the sorted prefix
+		while (lo < hi) {
+			mid = (lo + hi) / 2;
+			if (_index_cmp(key, cfg_sorted_index[mid]) < 0) { hi = mid; } else { lo = mid+1; }
+		}
+		memmove(&cfg_sorted_index[lo+1], &cfg_sorted_index[lo], (i - lo) * sizeof(index_t));
+		cfg_sorted_index[lo] = i;
+	}
+
+	uint8_t b = 0;								// bucket boundaries over the sorted permutation
+	cfg_bucket[0] = 0;
+	for (i=0; i < NV_INDEX_MAX; i++) {
+		GET_TOKEN_STRING(cfg_sorted_index[i], key);
+		while (b < _index_bucket(key[0])) { cfg_bucket[++b] = i; }
+	}
+	while (b < CFG_INDEX_BUCKETS) { cfg_bucket[++b] = NV_INDEX_MAX; }
+}
+
+index_t nv_index_lookup(const char_t *str)
+{
+	uint8_t bucket = _index_bucket(str[0]);
+	index_t lo = cfg_bucket[bucket];
+	index_t hi = cfg_bucket[bucket+1];
+	index_t mid;
+	int8_t diff;
+
+	while (lo < hi) {
+		mid = (lo + hi) / 2;
+		if ((diff = _index_cmp(str, cfg_sorted_index[mid])) == 0) {
+			while ((mid > 0) && (_index_cmp(str, cfg_sorted_index[mid-1]) == 0)) { mid--; }
+			return (cfg_sorted_index[mid]);		// first match in cfgArray order
+		}
+		if (diff < 0) { hi = mid; } else { lo = mid+1; }
+	}
+	return (NO_MATCH);
+}
+#endif // __CFG_SORTED_INDEX
+
+#ifdef __CFG_GROUP_CACHE
+/* Group expansion acceleration for get_grp()
+ *
+ * nv_group_cache_init() records the span of cfgArray indices holding each group's
+ * member rows, so get_grp() walks just that span instead of scanning every single-
+ * valued row for every group request. Spans are keyed by group string and built in
+ * one pass at config_init() time. Group members are laid out in contiguous runs in
+ * cfgArray so most spans are tight; a group with interleaved foreign rows simply
+ * gets a wider span - get_grp() retains its membership test inside the span, so
+ * the cache can never change what a group expands to. If the table overflows the
+ * cache disables itself and get_grp() falls back to the full scan.
+ *
+ * nv_group_cache_init()	- build the group span table
+ * nv_group_cache_lookup()	- return the index span for a group, false if not cached
+ */
+
+#define CFG_GROUP_CACHE_MAX 56				// distinct group strings in cfgArray, with headroom
+
+static struct cfgGroupSpan {
+	char_t group[GROUP_LEN+1];				// group prefix string
+	index_t first;							// first member row in cfgArray
+	index_t last;							// last member row (inclusive)
+} cfg_group_span[CFG_GROUP_CACHE_MAX];
+static uint8_t cfg_group_spans;
+
+void nv_group_cache_init()
+{
+	index_t i;
+	uint8_t g = 0;
+	char_t group[GROUP_LEN+1];
+
+	cfg_group_spans = 0;
+	for (i=0; nv_index_is_single(i); i++) {
+		strcpy_P(group, cfgArray[i].group);
+		if (group[0] == NUL) { continue; }
+		if ((cfg_group_spans != 0) && (strcmp(group, cfg_group_span[g].group) == 0)) {
+			cfg_group_span[g].last = i;		// extend the current run
+			continue;
+		}
+		for (g=0; g < cfg_group_spans; g++) {		// resume a non-contiguous group
+			if (strcmp(group, cfg_group_span[g].group) == 0) {
+				cfg_group_span[g].last = i;
+				break;
+			}
+		}
+		if (g == cfg_group_spans) {					// open a new group
+			if (cfg_group_spans == CFG_GROUP_CACHE_MAX) {
+				cfg_group_spans = 0;				// overflow: disable the cache
+				return;
+			}
+			strcpy(cfg_group_span[g].group, group);
+			cfg_group_span[g].first = i;
+			cfg_group_span[g].last = i;
+			cfg_group_spans++;
+		}
+	}
+}
+
+uint8_t nv_group_cache_lookup(const char_t *group, index_t *first, index_t *last)
+{
+	for (uint8_t g=0; g < cfg_group_spans; g++) {
+		if (strcmp(group, cfg_group_span[g].group) == 0) {
+			*first = cfg_group_span[g].first;
+			*last = cfg_group_span[g].last;
+			return (true);
+		}
+	}
+	return (false);
+}
+#endif // __CFG_GROUP_CACHE
+
+#ifdef __CFG_RECORD_CACHE
+/* RAM cache of hot cfgArray record fields
+ *
+ * Every record access in config.c reads fields out of PROGMEM with LPM
+ * sequences - function pointer dispatch for get/set, the target pointer,
+ * flags, precision. The motor and axis records are resolved this way many
+ * times per second by reports and group expansions. nv_record() keeps the
+ * hot fields of recently-resolved records in a small direct-mapped RAM
+ * table so repeat accesses cost indexed RAM loads instead.
+ *
+ * The cached fields are the record's flash metadata, which never changes
+ * at runtime - the *value* lives at the target pointer and is always read
+ * fresh - so entries never go stale once filled. nv_record_cache_init()
+ * empties the table; it runs from config_init() so a reset starts clean.
+ * Collisions just refill the slot - worst case is PROGMEM speed, as before.
+ *
+ * nv_record_cache_init()	- empty the record cache
+ * nv_record()				- return the RAM record for a cfgArray index, filling on miss
+ */
+
+#define CFG_RECORD_CACHE_SIZE 32			// direct mapped; must be a power of 2
+
+static cfgRecord_t cfg_record_cache[CFG_RECORD_CACHE_SIZE];
+
+void nv_record_cache_init()
+{
+	for (uint8_t i=0; i < CFG_RECORD_CACHE_SIZE; i++) {
+		cfg_record_cache[i].index = NO_MATCH;
+	}
+}
+
+cfgRecord_t *nv_record(index_t index)
+{
+	cfgRecord_t *r = &cfg_record_cache[index & (CFG_RECORD_CACHE_SIZE-1)];
+	if (r->index != index) {				// miss - fill the slot from PROGMEM
+#ifdef __AVR
+		r->flags = pgm_read_byte(&cfgArray[index].flags);
+		r->precision = (int8_t)pgm_read_byte(&cfgArray[index].precision);
+		r->get = (fptrCmd)pgm_read_word(&cfgArray[index].get);
+		r->set = (fptrCmd)pgm_read_word(&cfgArray[index].set);
+		r->target = (float *)pgm_read_word(&cfgArray[index].target);
+#else
+		r->flags = cfgArray[index].flags;
+		r->precision = cfgArray[index].precision;
+		r->get = cfgArray[index].get;
+		r->set = cfgArray[index].set;
+		r->target = cfgArray[index].target;
+#endif
+		r->index = index;
+	}
+	return (r);
+}
+#endif // __CFG_RECORD_CACHE
+
 /***** APPLICATION SPECIFIC CONFIGS AND EXTENSIONS TO GENERIC FUNCTIONS *****/
 
 /*
@@ -900,16 +1431,24 @@ static stat_t set_ex(nvObj_t *nv)				// enable XON/XOFF or RTS/CTS flow control
 	return(_set_comm_helper(nv, XIO_XOFF, XIO_NOXOFF));
 }
 
+#ifdef __LINE_CRC
+static stat_t set_fr(nvObj_t *nv)				// enable CRC16 line framing (see xio.c)
+{
+	if (nv->value > true)
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+	cfg.enable_line_crc = (uint8_t)nv->value;
+	return(_set_comm_helper(nv, XIO_CRC, XIO_NOCRC));
+}
+#endif
+
 static stat_t get_rx(nvObj_t *nv)
 {
 #ifdef __AVR
-	nv->value = (float)xio_get_usb_rx_free();
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, xio_get_usb_rx_free());
 	return (STAT_OK);
 #endif
 #ifdef __ARM
-	nv->value = (float)254;				// ARM always says the serial buffer is available (max)
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, 254);				// ARM always says the serial buffer is available (max)
 	return (STAT_OK);
 #endif
 }
@@ -939,12 +1478,21 @@ static const char msg_baud3[] PROGMEM = "38400";
 static const char msg_baud4[] PROGMEM = "57600";
 static const char msg_baud5[] PROGMEM = "115200";
 static const char msg_baud6[] PROGMEM = "230400";
+#ifdef __HIGH_BAUD
+static const char msg_baud7[] PROGMEM = "460800";
+static const char *const msg_baud[] PROGMEM = { msg_baud0, msg_baud1, msg_baud2, msg_baud3, msg_baud4, msg_baud5, msg_baud6, msg_baud7 };
+#else
 static const char *const msg_baud[] PROGMEM = { msg_baud0, msg_baud1, msg_baud2, msg_baud3, msg_baud4, msg_baud5, msg_baud6 };
+#endif
 
 static stat_t set_baud(nvObj_t *nv)
 {
 	uint8_t baud = (uint8_t)nv->value;
+#ifdef __HIGH_BAUD
+	if ((baud < 1) || (baud > 7)) {
+#else
 	if ((baud < 1) || (baud > 6)) {
+#endif
 		nv_add_conditional_message((const char_t *)"*** WARNING *** Unsupported baud rate specified");
 //		nv_add_conditional_message(PSTR("*** WARNING *** Unsupported baud rate specified"));
 		return (STAT_INPUT_VALUE_RANGE_ERROR);
@@ -957,6 +1505,137 @@ static stat_t set_baud(nvObj_t *nv)
 	return (STAT_OK);
 }
 
+#ifdef __SYNC_OUT
+/*
+ * set_sot() - arm a position-triggered output change
+ *
+ *	$sot=N arms a GPIO change to fire after N units of travel on the $soax
+ *	axis, counted in steps by the DDA from this command's position in the
+ *	move stream. The sign selects the edge: positive sets the $sobm bits,
+ *	negative clears them. Queued as a pass-through command, so the toolpath
+ *	stays as unbroken blocks at full lookahead speed.
+ */
+static void _exec_sync_out(float *value, float *flag)
+{
+	st_arm_sync_out(value[0], cfg.sync_out_axis, cfg.sync_out_bitmask);
+}
+
+static stat_t set_sot(nvObj_t *nv)
+{
+	float value[AXES] = { (float)nv->value,0,0,0,0,0 };
+	mp_queue_passthru_command(_exec_sync_out, value, value);
+	return (STAT_OK);
+}
+#endif // __SYNC_OUT
+
+#ifdef __JOB_CHECKPOINT
+/*
+ * set_rsm() - restore the job checkpoint for resume
+ *
+ *	{"rsm":n} (any value) restores the last power-loss checkpoint written by
+ *	job_checkpoint_callback(): absolute position, modal state and feed rate.
+ *	The response carries the checkpointed line number so the host re-streams
+ *	the job from there. Only accepted with the cycle off. The token would be
+ *	"resume" but TOKEN_LEN caps mnemonics at 5 characters.
+ */
+static stat_t set_rsm(nvObj_t *nv)
+{
+	return (job_checkpoint_restore(nv));
+}
+#endif // __JOB_CHECKPOINT
+
+#ifdef __BULK_SET
+/*
+ * set_bset() - apply a bulk settings array
+ *
+ *	Input is a flat array of alternating index,value pairs, e.g.
+ *	{"bset":[25,620,27,1200.5]} - indexes are cfgArray indexes. Each value
+ *	is applied through the normal set and persist paths, so writes are
+ *	diffed against the NVM shadow and unchanged values never touch the
+ *	EEPROM. Stops at the first error. Group and uber-group indexes are
+ *	rejected. The response reports the number of values applied.
+ */
+static stat_t set_bset(nvObj_t *nv)
+{
+	char_t *str = (char_t *)*nv->stringp;
+	char_t *end;
+	uint16_t count = 0;
+	nvObj_t bnv;
+
+	while (*str != NUL) {
+		memset(&bnv, 0, sizeof(bnv));
+		bnv.index = (index_t)strtol(str, &end, 10);
+		if (end == str) { return (STAT_JSON_SYNTAX_ERROR); }
+		while (*end == ' ') { end++; }
+		if (*end != ',') { return (STAT_JSON_SYNTAX_ERROR); }
+		str = end+1;
+		bnv.value = (float)strtod(str, &end);
+		if (end == str) { return (STAT_JSON_SYNTAX_ERROR); }
+		while (*end == ' ') { end++; }
+		str = (*end == ',') ? end+1 : end;
+		if (nv_index_lt_groups(bnv.index) == false) { return (STAT_INTERNAL_RANGE_ERROR); }
+		bnv.valuetype = TYPE_FLOAT;
+		ritorno(nv_set(&bnv));
+		nv_persist(&bnv);
+		count++;
+	}
+	nv_store_int(nv, count);
+	return (STAT_OK);
+}
+#endif // __BULK_SET
+
+#ifdef __PROBE_GRID
+/*
+ * set_prbg() - run the grid probing cycle
+ *
+ *	{"prbg":[x0,y0,x1,y1,nx,ny,zclear,zmin,feed]} probes an nx x ny grid over
+ *	the x0/y0 - x1/y1 rectangle and returns all touches as one JSON array.
+ *	All nine values are required, in absolute machine coords and mm. The work
+ *	happens in cycle_probing.c - this just unpacks the array.
+ */
+static stat_t set_prbg(nvObj_t *nv)
+{
+	char_t *str = (char_t *)*nv->stringp;
+	char_t *end;
+	float v[9];
+
+	for (uint8_t i=0; i<9; i++) {
+		v[i] = (float)strtod(str, &end);
+		if (end == str) { return (STAT_JSON_SYNTAX_ERROR); }
+		while (*end == ' ') { end++; }
+		if (i < 8) {
+			if (*end != ',') { return (STAT_JSON_SYNTAX_ERROR); }
+			str = end+1;
+		} else if (*end != NUL) { return (STAT_JSON_SYNTAX_ERROR); }
+	}
+	return (cm_probe_grid_start(v[0], v[1], v[2], v[3],
+		(uint8_t)v[4], (uint8_t)v[5], v[6], v[7], v[8]));
+}
+#endif // __PROBE_GRID
+
+#ifdef __MESH_COMP
+/*
+ * get_mesh() - get mesh Z-compensation state
+ * set_mesh() - enable/disable mesh Z-compensation
+ *
+ *	A completed grid probe attaches and enables its map automatically;
+ *	{"mesh":0} turns compensation off and {"mesh":1} turns it back on.
+ *	Enabling is refused with no map attached, and toggling is refused
+ *	mid-cycle - the Z correction would step by the local map height.
+ */
+static stat_t get_mesh(nvObj_t *nv)
+{
+	nv_store_int(nv, kn_mesh_state());
+	return (STAT_OK);
+}
+
+static stat_t set_mesh(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	return (kn_mesh_enable(fp_NOT_ZERO(nv->value)));
+}
+#endif // __MESH_COMP
+
 stat_t set_baud_callback(void)
 {
 	if (cfg.usb_baud_flag == false)
@@ -977,13 +1656,23 @@ stat_t set_baud_callback(void)
 static const char fmt_ec[] PROGMEM = "[ec]  expand LF to CRLF on TX%6d [0=off,1=on]\n";
 static const char fmt_ee[] PROGMEM = "[ee]  enable echo%18d [0=off,1=on]\n";
 static const char fmt_ex[] PROGMEM = "[ex]  enable flow control%10d [0=off,1=XON/XOFF, 2=RTS/CTS]\n";
+#ifdef __LINE_CRC
+static const char fmt_fr[] PROGMEM = "[fr]  enable CRC line framing%6d [0=off,1=on]\n";
+#endif
+#ifdef __HIGH_BAUD
+static const char fmt_baud[] PROGMEM = "[baud] USB baud rate%15d [1=9600,2=19200,3=38400,4=57600,5=115200,6=230400,7=460800]\n";
+#else
 static const char fmt_baud[] PROGMEM = "[baud] USB baud rate%15d [1=9600,2=19200,3=38400,4=57600,5=115200,6=230400]\n";
+#endif
 static const char fmt_net[] PROGMEM = "[net] network mode%17d [0=master]\n";
 static const char fmt_rx[] PROGMEM = "rx:%d\n";
 
 void cfg_print_ec(nvObj_t *nv) { text_print_ui8(nv, fmt_ec);}
 void cfg_print_ee(nvObj_t *nv) { text_print_ui8(nv, fmt_ee);}
 void cfg_print_ex(nvObj_t *nv) { text_print_ui8(nv, fmt_ex);}
+#ifdef __LINE_CRC
+void cfg_print_fr(nvObj_t *nv) { text_print_ui8(nv, fmt_fr);}
+#endif
 void cfg_print_baud(nvObj_t *nv) { text_print_ui8(nv, fmt_baud);}
 void cfg_print_net(nvObj_t *nv) { text_print_ui8(nv, fmt_net);}
 void cfg_print_rx(nvObj_t *nv) { text_print_ui8(nv, fmt_rx);}
@@ -3,7 +3,7 @@
  * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2014 Alden S. Hart, Jr.
- * Copyright (c) 2013 - 2014 Robert Giseburt
+ * Copyright (c) 2013 - 2014 Robert Giseburt
  *
  * This file ("the software") is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License, version 2 as published by the
@@ -50,11 +50,19 @@ typedef struct cfgParameters {		// mostly communications variables at this point
 	uint8_t enable_cr;				// enable CR in CRFL expansion on TX
 	uint8_t enable_echo;			// enable text-mode echo
 	uint8_t enable_flow_control;	// enable XON/XOFF or RTS/CTS flow control
+#ifdef __LINE_CRC
+	uint8_t enable_line_crc;		// enable CRC16 line framing (see xio.c)
+#endif
 //	uint8_t ignore_crlf;			// ignore CR or LF on RX --- these 4 are shadow settings for XIO cntrl bits
 
 	uint8_t usb_baud_rate;			// see xio_usart.h for XIO_BAUD values
 	uint8_t usb_baud_flag;			// technically this belongs in the controller singleton
 
+#ifdef __SYNC_OUT
+	uint8_t sync_out_axis;			// axis whose travel is counted for position-triggered outputs
+	uint8_t sync_out_bitmask;		// GPIO bit(s) changed when a position trigger fires
+#endif
+
 	// user-defined data groups
 	uint32_t user_data_a[4];
 	uint32_t user_data_b[4];
@@ -88,6 +96,9 @@ uint8_t job_report_callback();
 	void cfg_print_ec(nvObj_t *nv);
 	void cfg_print_ee(nvObj_t *nv);
 	void cfg_print_ex(nvObj_t *nv);
+#ifdef __LINE_CRC
+	void cfg_print_fr(nvObj_t *nv);
+#endif
 	void cfg_print_baud(nvObj_t *nv);
 	void cfg_print_net(nvObj_t *nv);
 	void cfg_print_rx(nvObj_t *nv);
@@ -97,6 +108,9 @@ uint8_t job_report_callback();
 	#define cfg_print_ec tx_print_stub
 	#define cfg_print_ee tx_print_stub
 	#define cfg_print_ex tx_print_stub
+#ifdef __LINE_CRC
+	#define cfg_print_fr tx_print_stub
+#endif
 	#define cfg_print_baud tx_print_stub
 	#define cfg_print_net tx_print_stub
 	#define cfg_print_rx tx_print_stub
@@ -3,7 +3,7 @@
  * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
- * Copyright (c) 2013 - 2015 Robert Giseburt
+ * Copyright (c) 2013 - 2015 Robert Giseburt
  *
  * This file ("the software") is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License, version 2 as published by the
@@ -32,20 +32,32 @@
 #include "json_parser.h"
 #include "text_parser.h"
 #include "gcode_parser.h"
+#include "gcode_binary.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_spline.h"
 #include "planner.h"
 #include "stepper.h"
-
+
 #include "encoder.h"
 #include "hardware.h"
 #include "switch.h"
 #include "gpio.h"
+#include "network.h"
+#include "fw_update.h"
 #include "report.h"
+#include "persistence.h"
 #include "help.h"
+#include "test.h"
+#include "diagnostics.h"
+#include "afc.h"
 #include "util.h"
 #include "xio.h"
 
+#ifdef __AVR
+#include "xmega/xmega_crc.h"
+#endif
+
 #ifdef __ARM
 #include "Reset.h"
 #endif
@@ -68,6 +80,26 @@ static stat_t _system_assertions(void);
 static stat_t _sync_to_planner(void);
 static stat_t _sync_to_tx_buffer(void);
 static stat_t _command_dispatch(void);
+#ifdef __JOB_CHAIN
+static uint8_t _chain_next(void);
+#endif
+#ifdef __STARTUP_MACRO
+static stat_t _macro_record_line(void);
+#endif
+#ifdef __SRC_MUX
+static stat_t _control_dispatch(void);
+#endif
+#ifdef __PREPARSE
+static stat_t _json_preparse_callback(void);
+#endif
+#ifdef __FLASH_SCRUB
+#define FLASH_SCRUB_SLICE 256				// flash bytes CRC'd per idle pass
+static uint32_t scrub_addr = 0;				// next flash address to scrub
+static uint16_t scrub_crc = 0xFFFF;			// running CRC-16/CCITT for the pass in progress
+static uint16_t scrub_reference;			// CRC of the first complete pass after reset
+static uint8_t scrub_reference_valid = false;
+static stat_t _flash_scrub_callback(void);
+#endif
 
 // prep for export to other modules:
 stat_t hardware_hard_reset_handler(void);
@@ -146,8 +178,26 @@ void controller_run()
 		_controller_HSM();
 	}
 }
-
+
+/*
+ * The fixed order means a run of long housekeeping tasks - report serialization,
+ * persistence flushes, SD prefetch - can delay _command_dispatch() by the sum of
+ * their run times, which has been measured at 10 ms+ on busy passes. __LOOP_BUDGET
+ * bounds that: tasks marked DISPATCH_DEFERRABLE are simply skipped once the
+ * dispatch tail is overdue, so _sync_to_planner() / _command_dispatch() are
+ * guaranteed to get the CPU within LOOP_BUDGET_USEC of their last opportunity
+ * plus at most one task's run time. Deferrable tasks are all continuations with
+ * no real-time obligations - skipping a pass only delays them, never loses work.
+ */
 #define	DISPATCH(func) if (func == STAT_EAGAIN) return;
+#ifdef __LOOP_BUDGET
+#define LOOP_BUDGET_USEC 5000				// max housekeeping time between dispatch opportunities
+static uint32_t dispatch_due_us;			// dia_time_us() deadline for the next dispatch opportunity
+#define	DISPATCH_DEFERRABLE(func) \
+	if ((int32_t)(dia_time_us() - dispatch_due_us) < 0) { DISPATCH(func)}
+#else
+#define	DISPATCH_DEFERRABLE(func) DISPATCH(func)
+#endif
 static void _controller_HSM()
 {
 //----- Interrupt Service Routines are the highest priority controller functions ----//
@@ -163,29 +213,110 @@ static void _controller_HSM()
 
 	DISPATCH(cm_feedhold_sequencing_callback());// 6a. feedhold state machine runner
 	DISPATCH(mp_plan_hold_callback());			// 6b. plan a feedhold from line runtime
+#ifdef __SPINDLE_READY
+	DISPATCH(cm_spindle_ready_callback());		// 6c. release motion when the spindle reports at-speed
+#endif
+#ifdef __PLAN_THROTTLE
+#ifdef __PLAN_STAGING
+	DISPATCH(mp_staging_callback());			// 6d. promote staged blocks into freed planner buffers
+#endif
+	DISPATCH(mp_plan_queue_callback());			// 6e. run a deferred planner backward pass
+#endif
+#ifdef __START_GATE
+	DISPATCH(mp_start_gate_callback());			// 6f. release a timed-out launch gate
+#endif
+#ifdef __TIME_ESTIMATE
+	DISPATCH(mp_estimate_callback());			// 6g. drain the planner queue in estimation mode
+#endif
+#ifdef __ADAPTIVE_FEED
+	DISPATCH(afc_callback());					// 6h. apply a spindle-load feed override replan
+#endif
 	DISPATCH(_system_assertions());				// 7. system integrity assertions
+#ifdef __SRC_MUX
+	DISPATCH(_control_dispatch());				// 8. priority commands from the console while a job streams
+#endif
 
 //----- planner hierarchy for gcode and cycles ---------------------------------------//
 
 	DISPATCH(st_motor_power_callback());		// stepper motor power sequencing
+#ifdef __NET_SEGMENT_BUS
+	DISPATCH(net_slave_callback());				// stage received bus segments into the stepper prep buffer
+#endif
+#ifdef __AB_STAGING
+	DISPATCH(fw_update_callback());				// burn a staged firmware page when the steppers are quiet
+#endif
 //	DISPATCH(switch_debounce_callback());		// debounce switches
-	DISPATCH(sr_status_report_callback());		// conditionally send status report
-	DISPATCH(qr_queue_report_callback());		// conditionally send queue report
-	DISPATCH(rx_report_callback());             // conditionally send rx report
+#ifdef __TX_CHUNKED
+	DISPATCH(xio_tx_flush_callback());			// drain a parked response; holds off reports & dispatch until done
+#endif
+	DISPATCH_DEFERRABLE(sr_status_report_callback());		// conditionally send status report
+	DISPATCH_DEFERRABLE(qr_queue_report_callback());		// conditionally send queue report
+	DISPATCH_DEFERRABLE(rx_report_callback());             // conditionally send rx report
+#ifdef __SW_EVENTS
+	DISPATCH_DEFERRABLE(sev_report_callback());				// push switch edge event reports
+#endif
+#ifdef __JOB_STATS
+	DISPATCH_DEFERRABLE(rpt_job_summary_callback());		// end-of-job stats report
+#endif
+#ifdef __PLAN_EXPORT
+	DISPATCH_DEFERRABLE(pex_export_callback());				// stream planned velocity profile records
+#endif
+#ifdef __ACK_WINDOW
+	DISPATCH_DEFERRABLE(js_ack_flush_callback());			// emit a pending cumulative ack once the stream goes quiet
+#endif
+#ifdef __CONFIG_REPORT
+	DISPATCH_DEFERRABLE(cr_report_callback());				// push a changed config group to a subscribed host
+#endif
+#ifdef __BENCHMARK
+	DISPATCH_DEFERRABLE(bench_report_callback());			// conditionally send benchmark summary
+#endif
+#ifdef __DIAG
+	DISPATCH_DEFERRABLE(dia_callback());					// roll up the per-second diagnostic counters
+#endif
+#ifdef __ASYNC_COMMAND
+	DISPATCH_DEFERRABLE(nv_async_callback());				// poll parked async commands, emit deferred responses
+#endif
 	DISPATCH(cm_arc_callback());				// arc generation runs behind lines
+#ifdef __CUBIC_SPLINE
+	DISPATCH(cm_spline_callback());				// spline fallback segmentation runs likewise
+#endif
 	DISPATCH(cm_homing_callback());				// G28.2 continuation
+#ifdef __MPG_WHEEL
+	DISPATCH(cm_mpg_callback());				// poll the handwheel and steer the jog engine
+#endif
 	DISPATCH(cm_jogging_callback());			// jog function
 	DISPATCH(cm_probe_callback());				// G38.2 continuation
-	DISPATCH(cm_deferred_write_callback());		// persist G10 changes when not in machining cycle
+#ifdef __CANNED_CYCLES
+	DISPATCH(cm_canned_cycle_callback());		// G81/G82/G83 drilling cycle expansion
+#endif
+	DISPATCH_DEFERRABLE(cm_deferred_write_callback());		// persist G10 changes when not in machining cycle
+#ifdef __NVM_WRITEBACK
+	DISPATCH_DEFERRABLE(persistence_callback());			// background flush of dirty persistence values
+#endif
+#ifdef __JOB_CHECKPOINT
+	DISPATCH_DEFERRABLE(job_checkpoint_callback());		// trickle the power-loss resume checkpoint to EEPROM
+#endif
 
 //----- command readers and parsers --------------------------------------------------//
 
+#ifdef __SD_CARD
+	DISPATCH_DEFERRABLE(xio_sd_callback());				// fetch the next SD block while motion runs
+#endif
+#ifdef __PREPARSE
+	DISPATCH_DEFERRABLE(_json_preparse_callback());		// parse the next line while waiting on the planner
+#endif
+#ifdef __LOOP_BUDGET
+	dispatch_due_us = dia_time_us() + LOOP_BUDGET_USEC;	// the dispatch tail is getting its chance this pass
+#endif
 	DISPATCH(_sync_to_planner());				// ensure there is at least one free buffer in planning queue
 	DISPATCH(_sync_to_tx_buffer());				// sync with TX buffer (pseudo-blocking)
 #ifdef __AVR
 	DISPATCH(set_baud_callback());				// perform baud rate update (must be after TX sync)
 #endif
 	DISPATCH(_command_dispatch());				// read and execute next command
+#ifdef __FLASH_SCRUB
+	DISPATCH_DEFERRABLE(_flash_scrub_callback());			// flash CRC scrub - runs only on an empty planner
+#endif
 	DISPATCH(_normal_idler());					// blink LEDs slowly to show everything is OK
 }
 
@@ -200,57 +331,99 @@ static void _controller_HSM()
 
 static stat_t _command_dispatch()
 {
-#ifdef __AVR
-	stat_t status;
-
-	// read input line or return if not a completed line
-	// xio_gets() is a non-blocking workalike of fgets()
-	while (true) {
-		if ((status = xio_gets(cs.primary_src, cs.in_buf, sizeof(cs.in_buf))) == STAT_OK) {
-			cs.bufp = cs.in_buf;
-			break;
-		}
-		// handle end-of-file from file devices
-		if (status == STAT_EOF) {						// EOF can come from file devices only
-			if (cfg.comm_mode == TEXT_MODE) {
-				fprintf_P(stderr, PSTR("End of command file\n"));
-			} else {
-				rpt_exception(STAT_EOF);				// not really an exception
-			}
-			tg_reset_source();							// reset to default source
-		}
-		return (status);								// Note: STAT_EAGAIN, errors, etc. will drop through
-	}
-#endif // __AVR
-#ifdef __ARM
-	// detect USB connection and transition to disconnected state if it disconnected
-	if (SerialUSB.isConnected() == false) cs.state = CONTROLLER_NOT_CONNECTED;
-
-	// read input line and return if not a completed line
-	if (cs.state == CONTROLLER_READY) {
-		if (read_line(cs.in_buf, &cs.read_index, sizeof(cs.in_buf)) != STAT_OK) {
-			cs.bufp = cs.in_buf;
-			return (STAT_OK);	// This is an exception: returns OK for anything NOT OK, so the idler always runs
-		}
-	} else if (cs.state == CONTROLLER_NOT_CONNECTED) {
-		if (SerialUSB.isConnected() == false) return (STAT_OK);
-		cm_request_queue_flush();
-		rpt_print_system_ready_message();
-		cs.state = CONTROLLER_STARTUP;
-
-	} else if (cs.state == CONTROLLER_STARTUP) {		// run startup code
-		cs.state = CONTROLLER_READY;
-
-	} else {
-		return (STAT_OK);
-	}
-	cs.read_index = 0;
+#ifdef __AVR
+	stat_t status;
+
+#ifdef __STARTUP_MACRO
+	if (cs.state == CONTROLLER_STARTUP) {			// first pass after boot
+		cs.state = CONTROLLER_READY;
+		if (macro_store_length() != 0) {			// chain in the stored startup macro
+#ifdef __EVENT_MACRO
+			macro_select_startup();					// replay only the pre-label startup section
+#endif
+			xio_open(XIO_DEV_MACRO, NULL, PGM_FLAGS);
+			tg_set_primary_source(XIO_DEV_MACRO);
+		}
+	}
+#endif
+#ifdef __PREPARSE
+	if (json_preparse_staged()) {					// execute a line parsed while the planner was full
+		json_execute_staged();						// emits the response; linelen was set at read time
+		return (STAT_OK);
+	}
+#endif
+	// read input line or return if not a completed line
+	// xio_gets() is a non-blocking workalike of fgets()
+	while (true) {
+#ifdef __PREPARSE
+		if (cs.preparse_hold) {						// line was already read by _json_preparse_callback()
+			cs.preparse_hold = false;				// cs.bufp is still valid - nothing has read since
+			break;
+		}
+#endif
+#ifdef __XIO_ZERO_COPY
+		if ((status = xio_gets_zc(cs.primary_src, (char **)&cs.bufp)) == STAT_OK) {
+			break;								// cs.bufp points into the xio line region
+		}
+#else
+		if ((status = xio_gets(cs.primary_src, cs.in_buf, sizeof(cs.in_buf))) == STAT_OK) {
+			cs.bufp = cs.in_buf;
+			break;
+		}
+#endif
+		// handle end-of-file from file devices
+		if (status == STAT_EOF) {						// EOF can come from file devices only
+#ifdef __JOB_CHAIN
+			// chain to the next queued file and keep reading in this same pass, so
+			// its first blocks enter the planner while the previous file's final
+			// moves are still draining - no dead time between job phases
+			if (_chain_next() == true) { continue;}
+#endif
+			if (cfg.comm_mode == TEXT_MODE) {
+				fprintf_P(stderr, PSTR("End of command file\n"));
+			} else {
+				rpt_exception(STAT_EOF);				// not really an exception
+			}
+			tg_reset_source();							// reset to default source
+		}
+		return (status);								// Note: STAT_EAGAIN, errors, etc. will drop through
+	}
+#endif // __AVR
+#ifdef __ARM
+	// detect USB connection and transition to disconnected state if it disconnected
+	if (SerialUSB.isConnected() == false) cs.state = CONTROLLER_NOT_CONNECTED;
+
+	// read input line and return if not a completed line
+	if (cs.state == CONTROLLER_READY) {
+		if (read_line(cs.in_buf, &cs.read_index, sizeof(cs.in_buf)) != STAT_OK) {
+			cs.bufp = cs.in_buf;
+			return (STAT_OK);	// This is an exception: returns OK for anything NOT OK, so the idler always runs
+		}
+	} else if (cs.state == CONTROLLER_NOT_CONNECTED) {
+		if (SerialUSB.isConnected() == false) return (STAT_OK);
+		cm_request_queue_flush();
+		rpt_print_system_ready_message();
+		cs.state = CONTROLLER_STARTUP;
+
+	} else if (cs.state == CONTROLLER_STARTUP) {		// run startup code
+		cs.state = CONTROLLER_READY;
+
+	} else {
+		return (STAT_OK);
+	}
+	cs.read_index = 0;
 #endif // __ARM
 
-	// set up the buffers
-	cs.linelen = strlen(cs.in_buf)+1;					// linelen only tracks primary input
+	// set up the buffers
+	cs.linelen = strlen(cs.bufp)+1;						// linelen only tracks primary input
 	strncpy(cs.saved_buf, cs.bufp, SAVED_BUFFER_LEN-1);	// save input buffer for reporting
 
+#ifdef __STARTUP_MACRO
+	if (macro_store_recording() == true) {				// $mac=1 is in effect - capture, don't execute
+		return (_macro_record_line());
+	}
+#endif
+
 	// dispatch the new text line
 	switch (toupper(*cs.bufp)) {						// first char
 
@@ -266,7 +439,14 @@ static stat_t _command_dispatch()
 		}
 		case '$': case '?': case 'H': { 				// text mode input
 			cfg.comm_mode = TEXT_MODE;
+#ifdef __ASYNC_COMMAND
+			status = text_parser(cs.bufp);
+			if (status != STAT_ASYNC_PENDING) {			// async responses are deferred
+				text_response(status, cs.saved_buf);
+			}
+#else
 			text_response(text_parser(cs.bufp), cs.saved_buf);
+#endif
 			break;
 		}
 		case '{': { 									// JSON input
@@ -274,6 +454,20 @@ static stat_t _command_dispatch()
 			json_parser(cs.bufp);
 			break;
 		}
+#ifdef __JSON_BATCH
+		case '[': {										// multi-command JSON batch
+			cfg.comm_mode = JSON_MODE;
+			json_parser(cs.bufp);
+			break;
+		}
+#endif
+		case GC_BINARY_LEADIN: {						// precompiled binary gcode block
+			stat_t bin_status = gc_binary_parser(cs.bufp);
+			if (bin_status != STAT_OK) {				// binary mode is silent on success
+				rpt_exception(bin_status);
+			}
+			break;
+		}
 		default: {										// anything else must be Gcode
 			if (cfg.comm_mode == JSON_MODE) {			// run it as JSON...
 				strncpy(cs.out_buf, cs.bufp, INPUT_BUFFER_LEN -8);					// use out_buf as temp
@@ -287,7 +481,63 @@ static stat_t _command_dispatch()
 	return (STAT_OK);
 }
 
-
+#ifdef __STARTUP_MACRO
+/*
+ * _macro_record_line() - capture a console line into the startup macro
+ *
+ *	Entered for every line while a $mac=1 recording is in effect. Lines are
+ *	stored verbatim instead of being executed; a line containing only '%'
+ *	(the conventional gcode program terminator) seals the macro and ends the
+ *	recording. Each line is acknowledged in text mode so interactive entry
+ *	reads normally; JSON senders only hear about failures.
+ */
+static stat_t _macro_record_line()
+{
+	stat_t status = macro_store_line(cs.bufp);
+	if (cfg.comm_mode == TEXT_MODE) {
+		text_response(status, cs.saved_buf);
+	} else if (status != STAT_OK) {
+		rpt_exception(status);
+	}
+	return (STAT_OK);
+}
+#endif // __STARTUP_MACRO
+
+#ifdef __SRC_MUX
+/*
+ * _control_dispatch() - dispatch priority commands from the console while a job streams
+ *
+ *	When the primary source is a file/SPI/job device the console (default
+ *	source) is still polled every pass. xio_gets() binds its accumulation
+ *	state to the device, so a console line collects in cs.ctrl_buf across
+ *	passes while the primary line collects in its own buffer - the two
+ *	sources interleave complete lines with no xio_set_stdin() switching and
+ *	no save/restore of partial lines. Single character commands, JSON
+ *	commands (status report requests and config queries) and text commands
+ *	are accepted; bare Gcode is rejected so a supervisor cannot silently
+ *	splice motion into the middle of a streaming job.
+ */
+static stat_t _control_dispatch()
+{
+	if (cs.primary_src == cs.default_src) { return (STAT_NOOP);}	// single source - normal dispatch handles it
+	if (xio_gets(cs.default_src, cs.ctrl_buf, sizeof(cs.ctrl_buf)) != XIO_OK) { return (STAT_NOOP);}
+
+	switch (toupper(cs.ctrl_buf[0])) {
+		case '!': { cm_request_feedhold(); break; }
+		case '%': { cm_request_queue_flush(); break; }
+		case '~': { cm_request_cycle_start(); break; }
+		case NUL: { break; }						// blank line - ignore
+		case '{': { json_parser(cs.ctrl_buf); break; }
+#ifdef __JSON_BATCH
+		case '[': { json_parser(cs.ctrl_buf); break; }
+#endif
+		case '$': case '?': case 'H': { text_response(text_parser(cs.ctrl_buf), cs.ctrl_buf); break; }
+		default: { rpt_exception(STAT_COMMAND_NOT_ACCEPTED); }	// no Gcode on the control channel
+	}
+	return (STAT_OK);
+}
+#endif // __SRC_MUX
+
 /**** Local Utilities ********************************************************/
 /*
  * _shutdown_idler() - blink rapidly and prevent further activity from occurring
@@ -312,6 +562,9 @@ static stat_t _shutdown_idler()
 
 static stat_t _normal_idler()
 {
+#ifdef __STACK_WATERMARK
+	dia_stack_scan();				// creep the stack watermark scan forward
+#endif
 #ifdef __ARM
 	/*
 	 * S-curve heartbeat code. Uses forward-differencing math from the stepper code.
@@ -373,6 +626,68 @@ void tg_reset_source() { tg_set_primary_source(cs.default_src);}
 void tg_set_primary_source(uint8_t dev) { cs.primary_src = dev;}
 void tg_set_secondary_source(uint8_t dev) { cs.secondary_src = dev;}
 
+#ifdef __JOB_CHAIN
+/*
+ * tg_run_source() - run a file device now, or chain it behind the active one
+ * _chain_next()   - open the next chained file at EOF (helper for _command_dispatch)
+ *
+ *	Run commands ($test, $job, $sd) funnel through tg_run_source(). If no file
+ *	is streaming the device is opened and made the primary source immediately;
+ *	if one is, the request is queued and the device open is deferred until the
+ *	active file hits EOF, so queueing a PGM file can't re-open the device out
+ *	from under the file it is still reading. A chained file that validates
+ *	empty at open time (job erased, card pulled) is skipped with an exception
+ *	report and the chain moves on. Per-file EOF messages are suppressed while
+ *	chaining - only the final EOF of the chain reports.
+ */
+
+#define CHAIN_QUEUE_LEN 4				// pending file devices - engrave/drill/cut fits in 3
+
+static struct chainEntry {
+	uint8_t dev;						// XIO_DEV_PGM, _FLASH or _SD
+	const char *addr;					// PGM file address, NULL for fixed-region devices
+} chain_queue[CHAIN_QUEUE_LEN];
+static uint8_t chain_count = 0;
+
+stat_t tg_run_source(uint8_t dev, const char *addr)
+{
+	if (cs.primary_src != cs.default_src) {			// a file is streaming - chain behind it
+		if (chain_count == CHAIN_QUEUE_LEN) { return (STAT_BUFFER_FULL);}
+		chain_queue[chain_count].dev = dev;
+		chain_queue[chain_count].addr = addr;
+		chain_count++;
+		return (STAT_OK);
+	}
+	if (cm_get_runtime_busy() == true) {			// console motion in flight is not a chain
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	xio_open(dev, addr, PGM_FLAGS);
+	if (fs[dev - XIO_DEV_FILE_OFFSET].max_offset == 0) {
+		return (STAT_FILE_NOT_OPEN);				// nothing stored behind the device
+	}
+	tg_set_primary_source(dev);
+	return (STAT_OK);
+}
+
+static uint8_t _chain_next()
+{
+	while (chain_count != 0) {
+		uint8_t dev = chain_queue[0].dev;
+		const char *addr = chain_queue[0].addr;
+		chain_count--;
+		memmove(&chain_queue[0], &chain_queue[1], chain_count * sizeof(struct chainEntry));
+		xio_open(dev, addr, PGM_FLAGS);
+		if (fs[dev - XIO_DEV_FILE_OFFSET].max_offset == 0) {
+			rpt_exception(STAT_FILE_NOT_OPEN);		// vanished since it was chained - skip it
+			continue;
+		}
+		tg_set_primary_source(dev);
+		return (true);
+	}
+	return (false);
+}
+#endif // __JOB_CHAIN
+
 /*
  * _sync_to_tx_buffer() - return eagain if TX queue is backed up
  * _sync_to_planner() - return eagain if planner is not ready for a new command
@@ -388,12 +703,75 @@ static stat_t _sync_to_tx_buffer()
 
 static stat_t _sync_to_planner()
 {
+#ifdef __PLAN_STAGING
+	// the staging ring keeps accepting blocks after the planner pool fills
+	if ((mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) &&
+		(mp_staging_room() < STAGING_BUFFER_HEADROOM)) {
+		return (STAT_EAGAIN);
+	}
+#else
 	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) { // allow up to N planner buffers for this line
 		return (STAT_EAGAIN);
 	}
+#endif
 	return (STAT_OK);
 }
-
+
+#ifdef __PREPARSE
+/*
+ * _json_preparse_callback() - parse the next line while the planner is full
+ *
+ *	Runs just ahead of _sync_to_planner(). When the planner queue is full the
+ *	controller normally sits on the serial line, then serializes the parse
+ *	behind the next freed buffer. Instead, read and pre-parse the next JSON
+ *	line now so _command_dispatch() only has to execute it when the planner
+ *	opens up. Lines that can't be staged (text mode commands, single character
+ *	commands, overlong lines) are read but held unparsed, so execution order
+ *	is always preserved. See json_preparse() in json_parser.c for the stage.
+ */
+static stat_t _json_preparse_callback()
+{
+	if ((json_preparse_staged()) || (cs.preparse_hold)) { return (STAT_OK);}	// one line ahead, max
+	if (cfg.comm_mode != JSON_MODE) { return (STAT_OK);}
+	if (cs.primary_src != cs.default_src) { return (STAT_OK);}	// file devices need the EOF handling in _command_dispatch()
+	if (mp_get_planner_buffers_available() >= PLANNER_BUFFER_HEADROOM) { return (STAT_OK);}	// not blocked - dispatch will run
+
+	// read input line or return if not a completed line
+#ifdef __XIO_ZERO_COPY
+	if (xio_gets_zc(cs.primary_src, (char **)&cs.bufp) != STAT_OK) { return (STAT_OK);}
+#else
+	if (xio_gets(cs.primary_src, cs.in_buf, sizeof(cs.in_buf)) != STAT_OK) { return (STAT_OK);}
+	cs.bufp = cs.in_buf;
+#endif
+	cs.linelen = strlen(cs.bufp)+1;					// reported in the response footer at execution time
+
+	switch (toupper(*cs.bufp)) {					// first char - see _command_dispatch()
+
+		case '{': {									// JSON input - stage it
+			if (json_preparse(cs.bufp) == STAT_OK) { return (STAT_OK);}
+			break;									// too big for the stage - hold the raw line
+		}
+#ifdef __JSON_BATCH
+		case '[':									// batch - runs in one pass, too big to stage
+#endif
+		case '!': case '%': case '~': case NUL: 	// single character commands
+		case '$': case '?': case 'H': 				// text mode input
+		case GC_BINARY_LEADIN: {					// binary gcode block
+			break;									// not pre-parseable - hold for _command_dispatch()
+		}
+		default: {									// anything else must be Gcode - wrap it as JSON
+			if (strlen(cs.bufp) < PREPARSE_STRING_LEN) {	// guaranteed to fit the stage
+				strncpy(cs.out_buf, cs.bufp, INPUT_BUFFER_LEN -8);					// use out_buf as temp
+				sprintf((char *)cs.bufp,"{\"gc\":\"%s\"}\n", (char *)cs.out_buf);	// '-8' is used for JSON chars
+				if (json_preparse(cs.bufp) == STAT_OK) { return (STAT_OK);}
+			}
+		}
+	}
+	cs.preparse_hold = true;						// line is read but not staged - dispatch it unchanged
+	return (STAT_OK);
+}
+#endif // __PREPARSE
+
 /*
 static stat_t _sync_to_time()
 {
@@ -413,7 +791,7 @@ static stat_t _sync_to_time()
 static stat_t _limit_switch_handler(void)
 {
 	if (cm_get_machine_state() == MACHINE_ALARM) { return (STAT_NOOP);}
-
+
 	if (get_limit_switch_thrown() == false) return (STAT_NOOP);
 	return(cm_hard_alarm(STAT_LIMIT_SWITCH_HIT));
 	return (STAT_OK);
@@ -422,7 +800,7 @@ static stat_t _limit_switch_handler(void)
 /*
  * _system_assertions() - check memory integrity and other assertions
  */
-#define emergency___everybody_to_get_from_street(a) if((status_code=a) != STAT_OK) return (cm_hard_alarm(status_code));
+#define emergency___everybody_to_get_from_street(a) if((status_code=a) != STAT_OK) return (cm_hard_alarm(status_code));
 
 stat_t _system_assertions()
 {
@@ -435,3 +813,55 @@ stat_t _system_assertions()
 	emergency___everybody_to_get_from_street(xio_test_assertions());
 	return (STAT_OK);
 }
+
+#ifdef __FLASH_SCRUB
+/*
+ * _flash_scrub_callback() - idle-time CRC scrub of program flash
+ *
+ *	Walks the entire flash image - code and PROGMEM data including cfgArray -
+ *	in FLASH_SCRUB_SLICE chunks, but only when the planner is empty and the
+ *	runtime is quiet, so motion never pays for it. The CRC of the first
+ *	complete pass after reset is kept as the reference; any later pass that
+ *	disagrees means the image changed underneath us, and the machine is hard
+ *	alarmed the same way the RAM magic number checks do. Legitimate runtime
+ *	writers - job store uploads, profile burns, A/B staging - land inside the
+ *	scrubbed span and must call flash_scrub_rebase() after each page write. The CRC itself comes
+ *	from xmega_crc.c, which lands on the hardware CRC module when the part
+ *	has one.
+ */
+static stat_t _flash_scrub_callback()
+{
+	if (mp_get_planner_buffers_available() != PLANNER_BUFFER_POOL_SIZE) { return (STAT_NOOP);}
+	if (mp_get_runtime_busy() == true) { return (STAT_NOOP);}
+
+	uint32_t end = min((scrub_addr + FLASH_SCRUB_SLICE), ((uint32_t)FLASHEND+1));
+	scrub_crc = crc16_ccitt_flash(scrub_crc, scrub_addr, (uint16_t)(end - scrub_addr));
+	scrub_addr = end;
+	if (scrub_addr <= (uint32_t)FLASHEND) { return (STAT_OK);}	// pass still in progress
+
+	if (scrub_reference_valid == false) {			// first complete pass baselines the image
+		scrub_reference = scrub_crc;
+		scrub_reference_valid = true;
+	} else if (scrub_crc != scrub_reference) {
+		return (cm_hard_alarm(STAT_MEMORY_FAULT));
+	}
+	scrub_addr = 0;									// start the next pass
+	scrub_crc = 0xFFFF;
+	return (STAT_OK);
+}
+
+/*
+ * flash_scrub_rebase() - invalidate the scrub reference after a legitimate flash write
+ *
+ *	Restarts the pass in progress and drops the reference so the next complete
+ *	pass re-baselines the new image. Must be called after every runtime page
+ *	write or erase - scrub slices can interleave with streamed uploads, so a
+ *	single rebase at the start of an upload is not sufficient.
+ */
+void flash_scrub_rebase()
+{
+	scrub_addr = 0;
+	scrub_crc = 0xFFFF;
+	scrub_reference_valid = false;
+}
+#endif // __FLASH_SCRUB
@@ -2,7 +2,7 @@
  * controller.h - tinyg controller and main dispatch loop
  * This file is part of the TinyG project
  *
- * Copyright (c) 2010 - 2014 Alden S. Hart, Jr.
+ * Copyright (c) 2010 - 2014 Alden S. Hart, Jr.
  * Copyright (c) 2013 - 2014 Robert Giseburt
  *
  * This file ("the software") is free software: you can redistribute it and/or modify
@@ -34,6 +34,9 @@ extern "C"{
 
 #define INPUT_BUFFER_LEN 255			// text buffer size (255 max)
 #define SAVED_BUFFER_LEN 100			// saved buffer size (for reporting only)
+#ifdef __SRC_MUX
+#define CTRL_BUFFER_LEN 128				// control channel line buffer size
+#endif
 #define OUTPUT_BUFFER_LEN 512			// text buffer size
 // see also: tinyg.h MESSAGE_LEN and config.h NV_ lengths
 
@@ -54,9 +57,12 @@ typedef struct controllerSingleton {	// main TG controller struct
 	uint8_t secondary_src;				// secondary input source device
 	uint8_t default_src;				// default source device
 	uint8_t network_mode;				// 0=master, 1=repeater, 2=slave
-
+
 	uint16_t linelen;					// length of currently processing line
 	uint16_t read_index;				// length of line being read
+#ifdef __PREPARSE
+	uint8_t preparse_hold;				// line was read ahead but could not be pre-parsed
+#endif
 
 	// system state variables
 	uint8_t led_state;		// LEGACY	// 0=off, 1=on
@@ -76,6 +82,9 @@ typedef struct controllerSingleton {	// main TG controller struct
 	char_t in_buf[INPUT_BUFFER_LEN];	// primary input buffer
 	char_t out_buf[OUTPUT_BUFFER_LEN];	// output buffer
 	char_t saved_buf[SAVED_BUFFER_LEN];	// save the input buffer
+#ifdef __SRC_MUX
+	char_t ctrl_buf[CTRL_BUFFER_LEN];	// control channel accumulator (interleaves with primary input)
+#endif
 	magic_t magic_end;
 } controller_t;
 
@@ -100,6 +109,14 @@ void controller_run(void);
 void tg_reset_source(void);
 void tg_set_primary_source(uint8_t dev);
 void tg_set_secondary_source(uint8_t dev);
+#ifdef __JOB_CHAIN
+stat_t tg_run_source(uint8_t dev, const char *addr);	// run a file device now, or chain it behind the active one
+#endif
+#ifdef __FLASH_SCRUB
+void flash_scrub_rebase(void);						// called by every runtime flash write path
+#else
+#define flash_scrub_rebase()
+#endif
 
 #ifdef __cplusplus
 }
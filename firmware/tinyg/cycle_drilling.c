@@ -0,0 +1,276 @@
+/*
+ * cycle_drilling.c - canned drilling cycle extension to canonical_machine.c
+ * Part of TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	This module expands G81/G82/G83 drilling cycles into planner moves inside the
+ *	firmware, so one short block per hole replaces the four or five blocks a host
+ *	would otherwise have to stream. Expansion runs from a main loop continuation
+ *	(like arcs do): cm_canned_cycle() only captures the block, and the callback
+ *	queues one phase move per pass while planner buffers are available, returning
+ *	EAGAIN so no new command is parsed until the hole is fully queued.
+ */
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "diagnostics.h"
+#include "report.h"
+#include "util.h"
+
+#ifdef __CANNED_CYCLES
+
+/**** Drilling singleton structure ****/
+
+#define DRILL_PECK_CLEARANCE ((float)0.5)		// mm above the previous peck bottom to resume feeding
+
+struct drDrillingSingleton {					// persistent drilling cycle variables
+	stat_t (*func)();							// binding for callback function state machine
+	uint8_t run_state;							// MOVE_OFF when idle, MOVE_RUN while expanding a hole
+	uint8_t motion_mode;						// MOTION_MODE_CANNED_CYCLE_81, _82 or _83
+
+	// modal cycle parameters - these stick until the canned cycle is canceled
+	float retract_z;							// R - retract plane (absolute, prevailing units)
+	float bottom_z;								// Z - hole bottom (absolute, prevailing units)
+	float dwell_time;							// P - dwell at the bottom for G82, in seconds
+	float peck_depth;							// Q - peck increment for G83
+	uint8_t r_valid;							// R has been supplied since the cycle started
+	uint8_t z_valid;							// Z has been supplied since the cycle started
+
+	// per-hole state
+	float xy_target[AXES];						// hole location from the block's axis words
+	float xy_flags[AXES];						// which of those words were present
+	float next_bottom;							// bottom of the peck currently being cut (G83)
+};
+static struct drDrillingSingleton dr;
+
+/**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
+
+static stat_t _drill_move_to_r(void);
+static stat_t _drill_move_xy(void);
+static stat_t _drill_plunge(void);
+static stat_t _drill_peck_retract(void);
+static stat_t _drill_peck_return(void);
+static stat_t _drill_dwell(void);
+static stat_t _drill_retract(void);
+
+/**** HELPERS ***************************************************************************
+ * _set_dr_func() - a convenience for setting the next dispatch vector and exiting
+ * _drill_z_move() - queue a single-axis Z move and advance to the next phase
+ */
+
+static stat_t _set_dr_func(stat_t (*func)())
+{
+	dr.func = func;
+	return (STAT_EAGAIN);
+}
+
+static stat_t _drill_abort(stat_t status)
+{
+	dr.run_state = MOVE_OFF;
+	rpt_exception(status);						// surface the failure; the cycle is abandoned
+	return (status);
+}
+
+static stat_t _drill_z_move(uint8_t traverse, float z, stat_t (*next_func)())
+{
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_Z] = z;
+	flags[AXIS_Z] = true;
+
+	stat_t status;
+	if (traverse == true) {
+		status = cm_straight_traverse(target, flags);
+	} else {
+		status = cm_straight_feed(target, flags);
+	}
+	if ((status != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+		return (_drill_abort(status));			// zero-length phases are normal and are dropped
+	}
+	return (_set_dr_func(next_func));
+}
+
+/****************************************************************************************
+ * cm_canned_cycle() 			- G81, G82, G83 called once per drilling block
+ * cm_canned_cycle_callback()	- main loop callback for expanding the cycle
+ *
+ *	R, Z, P and Q are modal for the duration of the canned cycle and are refreshed
+ *	by any block that provides them. The first block after entering a canned motion
+ *	mode must provide both R and Z. Expansion follows NIST preliminary motion: the
+ *	tool retracts to the R plane, rapids to the hole XY, feeds to the bottom (in Q
+ *	increments with full retracts for G83), dwells for G82, and retracts to R.
+ *
+ *	Restrictions: absolute distance mode (G90), XY plane (G17) and units-per-minute
+ *	feed (G94) only. G98 initial-level return is not implemented - retraction is
+ *	always to the R plane as for G99.
+ */
+
+stat_t cm_canned_cycle(float target[], float flags[])
+{
+	// trap zero feed rate condition
+	if ((cm.gm.feed_rate_mode != UNITS_PER_MINUTE_MODE) || (fp_ZERO(cm.gm.feed_rate))) {
+		return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+	if ((cm.gm.distance_mode != ABSOLUTE_MODE) || (cm.gm.select_plane != CANON_PLANE_XY)) {
+		return (STAT_GCODE_COMMAND_UNSUPPORTED);
+	}
+
+	// entering canned cycle motion from another motion mode restarts the modal params
+	if ((cm.gm.motion_mode < MOTION_MODE_CANNED_CYCLE_81) ||
+		(cm.gm.motion_mode > MOTION_MODE_CANNED_CYCLE_89)) {
+		dr.r_valid = false;
+		dr.z_valid = false;
+		dr.dwell_time = 0;
+		dr.peck_depth = 0;
+	}
+	cm.gm.motion_mode = cm.gn.motion_mode;
+	dr.motion_mode = cm.gn.motion_mode;
+
+	// collect modal parameter updates from the block
+	if (cm.gf.arc_radius == true)	{ dr.retract_z = cm.gn.arc_radius; dr.r_valid = true;}
+	if (fp_TRUE(flags[AXIS_Z]))		{ dr.bottom_z = target[AXIS_Z]; dr.z_valid = true;}
+	if (cm.gf.parameter == true)	{ dr.dwell_time = cm.gn.parameter;}
+	if (cm.gf.q_parameter == true)	{ dr.peck_depth = cm.gn.q_parameter;}
+
+	if ((dr.r_valid == false) || (dr.z_valid == false)) {
+		return (STAT_GCODE_GENERIC_INPUT_ERROR);		// first block must carry R and Z
+	}
+	if (dr.retract_z <= dr.bottom_z) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);			// R plane must be above the hole bottom
+	}
+	if ((dr.motion_mode == MOTION_MODE_CANNED_CYCLE_83) && (dr.peck_depth < EPSILON)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);			// G83 requires a positive Q
+	}
+
+	// capture the hole location - Z is cycle data, not a position word
+	copy_vector(dr.xy_target, target);
+	copy_vector(dr.xy_flags, flags);
+	dr.xy_flags[AXIS_Z] = false;
+	uint8_t axis_present = false;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		if (fp_TRUE(flags[axis])) { axis_present = true;}
+	}
+	if (axis_present == false) { return (STAT_GCODE_AXIS_IS_MISSING);}
+
+	if (dr.motion_mode == MOTION_MODE_CANNED_CYCLE_83) {
+		dr.next_bottom = max(dr.bottom_z, (dr.retract_z - dr.peck_depth));
+	} else {
+		dr.next_bottom = dr.bottom_z;
+	}
+	dr.func = _drill_move_to_r;					// preliminary motion starts at the R plane
+	dr.run_state = MOVE_RUN;
+	return (STAT_OK);
+}
+
+stat_t cm_canned_cycle_callback(void)
+{
+	if (dr.run_state == MOVE_OFF) { return (STAT_NOOP);}
+#ifdef __COMMIT_BATCH
+	// run several expansion phases per pass, same as the arc callback - see
+	// cm_arc_callback() for the batching and time budget rationale
+#ifdef __DIAG
+	uint16_t start_ticks = dia_now();
+#endif
+	for (uint8_t batch = PLANNER_COMMIT_BATCH; batch > 0; batch--) {
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) { return (STAT_EAGAIN);}
+		stat_t status = dr.func();				// queue the next phase of the expansion
+		if (status != STAT_EAGAIN) { return (status);}	// cycle completed or aborted
+#ifdef __DIAG
+		if ((uint16_t)(dia_now() - start_ticks) > PLANNER_COMMIT_BUDGET_TICKS) { break;}
+#endif
+	}
+	return (STAT_EAGAIN);
+#else
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) { return (STAT_EAGAIN);}
+	return (dr.func());							// queue the next phase of the expansion
+#endif
+}
+
+/***** Expansion phases - one queued move per entry, as for all cycle callbacks *****/
+
+static stat_t _drill_move_to_r(void)			// retract (or descend) to the R plane
+{
+	return (_drill_z_move(true, dr.retract_z, _drill_move_xy));
+}
+
+static stat_t _drill_move_xy(void)				// rapid to the hole location at the R plane
+{
+	stat_t status = cm_straight_traverse(dr.xy_target, dr.xy_flags);
+	if ((status != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+		return (_drill_abort(status));
+	}
+	return (_set_dr_func(_drill_plunge));
+}
+
+static stat_t _drill_plunge(void)				// feed to the hole bottom, or the next peck bottom
+{
+	if (dr.next_bottom - dr.bottom_z > EPSILON) {
+		return (_drill_z_move(false, dr.next_bottom, _drill_peck_retract));
+	}
+	if ((dr.motion_mode == MOTION_MODE_CANNED_CYCLE_82) && (dr.dwell_time > EPSILON)) {
+		return (_drill_z_move(false, dr.bottom_z, _drill_dwell));
+	}
+	return (_drill_z_move(false, dr.bottom_z, _drill_retract));
+}
+
+static stat_t _drill_peck_retract(void)			// G83 - full retract to R to clear chips
+{
+	return (_drill_z_move(true, dr.retract_z, _drill_peck_return));
+}
+
+static stat_t _drill_peck_return(void)			// G83 - rapid back to just above the cut
+{
+	float clearance = DRILL_PECK_CLEARANCE;
+	if (cm.gm.units_mode == INCHES) { clearance /= MM_PER_INCH;}
+	float resume_z = min(dr.retract_z, (dr.next_bottom + clearance));
+	dr.next_bottom = max(dr.bottom_z, (dr.next_bottom - dr.peck_depth));
+	return (_drill_z_move(true, resume_z, _drill_plunge));
+}
+
+static stat_t _drill_dwell(void)				// G82 - dwell at the bottom of the hole
+{
+	cm_dwell(dr.dwell_time);
+	return (_set_dr_func(_drill_retract));
+}
+
+static stat_t _drill_retract(void)				// final retract to the R plane - hole is done
+{
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_Z] = dr.retract_z;
+	flags[AXIS_Z] = true;
+
+	stat_t status = cm_straight_traverse(target, flags);
+	if ((status != STAT_OK) && (status != STAT_MINIMUM_LENGTH_MOVE)) {
+		return (_drill_abort(status));
+	}
+	cm.gm.motion_mode = dr.motion_mode;			// restore the modal canned motion mode the
+	dr.run_state = MOVE_OFF;					//...phase moves overwrote, so bare XY blocks repeat
+	return (STAT_OK);
+}
+
+#endif // __CANNED_CYCLES
@@ -28,10 +28,13 @@
 #include "tinyg.h"
 #include "util.h"
 #include "config.h"
+#include "settings.h"
 #include "json_parser.h"
 #include "text_parser.h"
 #include "canonical_machine.h"
 #include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
 #include "switch.h"
 #include "report.h"
 
@@ -39,6 +42,12 @@
 extern "C"{
 #endif
 
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+#ifndef SQUARING_SWITCH_2
+#define SQUARING_SWITCH_2 SW_MIN_A	// input wired to the second gantry endstop (override in settings)
+#endif
+#endif
+
 /**** Homing singleton structure ****/
 
 struct hmHomingSingleton {			// persistent homing runtime variables
@@ -60,6 +69,26 @@ struct hmHomingSingleton {			// persistent homing runtime variables
 
 	uint8_t homing_closed;			// 0=open, 1=closed
 	uint8_t limit_closed;			// 0=open, 1=closed
+#ifdef __HOMING_OVERLAP
+	uint8_t seek_done;				// rough-seek has been run for this cycle
+	int8_t seek_passes;				// remaining move re-issues before the seek gives up
+#endif
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+	uint8_t square_armed;			// per-motor gating is live for the current search move
+	uint8_t square_hits;			// endstop closures seen during this search
+	uint8_t square_motor[2];		// the two motors mapped to the gantry axis
+	uint8_t square_sw[2];			// the endstop switch that gates each motor
+#endif
+#ifdef __HOMING_CAL
+	uint8_t cal_passes;				// latch repeats for this cycle (0,1 = normal homing)
+	uint8_t cal_pass;				// passes completed for the current axis
+	uint8_t cal_motor;				// motor whose encoder is sampled for the current axis
+	float cal_ref;					// first latch position - samples accumulate as offsets from it
+	float cal_min;					// latch position stats for the current axis, in mm
+	float cal_max;
+	float cal_sum;
+	float cal_sumsq;
+#endif
 	uint8_t set_coordinates;		// G28.4 flag. true = set coords to zero at the end of homing cycle
 	stat_t (*func)(int8_t axis);	// binding for callback function state machine
 
@@ -73,22 +102,40 @@ struct hmHomingSingleton {			// persistent homing runtime variables
 	float max_clear_backoff;		// maximum distance of switch clearing backoffs before erring out
 
 	// state saved from gcode model
+#ifndef __CYCLE_SNAPSHOT
 	uint8_t saved_units_mode;		// G20,G21 global setting
 	uint8_t saved_coord_system;		// G54 - G59 setting
 	uint8_t saved_distance_mode;	// G90,G91 global setting
 	uint8_t saved_feed_rate_mode;   // G93,G94 global setting
 	float saved_feed_rate;			// F setting
+#endif
 	float saved_jerk;				// saved and restored for each axis homed
 };
 static struct hmHomingSingleton hm;
 
+#ifdef __HOMING_CAL
+#define HOMING_CAL_PASSES_MAX 25	// bounds $hcp - enough samples for a stable sigma, bounded cycle time
+#endif
+
 /**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
 
 static stat_t _set_homing_func(stat_t (*func)(int8_t axis));
 static stat_t _homing_axis_start(int8_t axis);
+#ifdef __HOMING_OVERLAP
+static stat_t _homing_rough_seek(int8_t axis);
+#endif
 static stat_t _homing_axis_clear(int8_t axis);
 static stat_t _homing_axis_search(int8_t axis);
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+static void _squaring_arm(int8_t axis);
+#endif
 static stat_t _homing_axis_latch(int8_t axis);
+#ifdef __HOMING_CAL
+static stat_t _homing_cal_sample(int8_t axis);
+#endif
+#ifdef __INDEX_HOMING
+static stat_t _homing_axis_index(int8_t axis);
+#endif
 static stat_t _homing_axis_zero_backoff(int8_t axis);
 static stat_t _homing_axis_set_zero(int8_t axis);
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity);
@@ -156,11 +203,15 @@ static int8_t _get_next_axis(int8_t axis);
 stat_t cm_homing_cycle_start(void)
 {
 	// save relevant non-axis parameters from Gcode model
+#ifdef __CYCLE_SNAPSHOT
+	cm_cycle_save_state();
+#else
 	hm.saved_units_mode = cm_get_units_mode(ACTIVE_MODEL);
 	hm.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);
 	hm.saved_distance_mode = cm_get_distance_mode(ACTIVE_MODEL);
 	hm.saved_feed_rate_mode = cm_get_feed_rate_mode(ACTIVE_MODEL);
 	hm.saved_feed_rate = cm_get_feed_rate(ACTIVE_MODEL);
+#endif
 
 	// set working values
 	cm_set_units_mode(MILLIMETERS);
@@ -171,9 +222,16 @@ stat_t cm_homing_cycle_start(void)
 
 	hm.axis = -1;							// set to retrieve initial axis
 	hm.func = _homing_axis_start; 			// bind initial processing function
+#ifdef __HOMING_CAL
+	hm.cal_passes = min(cm.homing_cal_passes, HOMING_CAL_PASSES_MAX);
+#endif
+#ifdef __HOMING_OVERLAP
+	hm.seek_done = false;
+	hm.seek_passes = HOMING_AXES + 1;		// one re-issue per possible switch closure, plus margin
+#endif
 	cm.cycle_state = CYCLE_HOMING;
 	cm.homing_state = HOMING_NOT_HOMED;
-
+
 	return (STAT_OK);
 }
 
@@ -240,8 +298,19 @@ static stat_t _homing_axis_start(int8_t axis)
 			return (_homing_error_exit(-2, STAT_HOMING_ERROR_BAD_OR_NO_AXIS));
 		}
 	}
+#ifdef __HOMING_OVERLAP
+	// run one overlapped rough-seek before the first axis in the overlap set,
+	// so the serialized per-axis phases start on (or near) their switches
+	if ((hm.seek_done == false) && (HOMING_OVERLAP_AXES_bm & (1 << axis))) {
+		hm.seek_done = true;
+		return (_set_homing_func(_homing_rough_seek));		// re-enters here when the seek completes
+	}
+#endif
 	// clear the homed flag for axis so we'll be able to move w/o triggering soft limits
 	cm.homed[axis] = false;
+#ifdef __SOFT_LIMIT_CACHE
+	cm_update_soft_limits();
+#endif
 
 	// trap axis mis-configurations
 	if (fp_ZERO(cm.a[axis].search_velocity)) return (_homing_error_exit(axis, STAT_HOMING_ERROR_ZERO_SEARCH_VELOCITY));
@@ -268,6 +337,16 @@ static stat_t _homing_axis_start(int8_t axis)
 	hm.search_velocity = fabs(cm.a[axis].search_velocity);	// search velocity is always positive
 	hm.latch_velocity = fabs(cm.a[axis].latch_velocity);	// latch velocity is always positive
 
+#ifdef __HOMING_CAL
+	hm.cal_pass = 0;										// reset latch statistics for this axis
+	hm.cal_sum = 0;
+	hm.cal_sumsq = 0;
+	hm.cal_motor = MOTORS;									// resolve the motor to sample, if any
+	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+		if (st_cfg.mot[motor].motor_map == axis) { hm.cal_motor = motor; break;}
+	}
+#endif
+
 	// setup parameters homing to the minimum switch
 	if (hm.min_mode & SW_HOMING_BIT) {
 #ifndef __NEW_SWITCHES
@@ -327,6 +406,78 @@ static stat_t _homing_axis_start(int8_t axis)
 	return (_set_homing_func(_homing_axis_clear));			// start the clear
 }
 
+#ifdef __HOMING_OVERLAP
+/*
+ * _homing_rough_seek() - drive all overlap-eligible axes toward their switches at once
+ *
+ *	Runs once per cycle, before the first axis in HOMING_OVERLAP_AXES_bm begins its
+ *	normal sequence. Eligible axes are those requested in the G28.2 whose switch
+ *	config would pass _homing_axis_start(); axes already sitting on their switch
+ *	sit the seek out. A switch closure feedholds the combined move, after which
+ *	the seek re-issues the move for the axes still short of their switches until
+ *	all have closed or the pass budget runs out. The per-axis search/latch/backoff
+ *	phases that follow are unchanged - they just start on or near the switch, so
+ *	the serialized fine phases reduce to a few short moves.
+ *
+ *	The combined feed rate is scaled so no axis exceeds its own search velocity.
+ *	Axis jerk is left at the travel setting; only the per-axis search onward uses
+ *	the homing jerk, which keeps the jerk save/restore in _homing_axis_start() /
+ *	_homing_axis_set_zero() working unmodified.
+ */
+
+static stat_t _homing_rough_seek(int8_t axis)
+{
+	float vect[] = {0,0,0,0,0,0};
+	float origin[] = {0,0,0,0,0,0};
+	float flags[] = {false, false, false, false, false, false};
+	float feed_rate = 0;
+	uint8_t axes_moving = 0;
+
+	for (uint8_t a=0; a < HOMING_AXES; a++) {
+		if ((HOMING_OVERLAP_AXES_bm & (1 << a)) == 0) continue;
+		if (fp_FALSE(cm.gf.target[a])) continue;			// axis not requested in the G28.2
+		if (fp_ZERO(cm.a[a].search_velocity)) continue;		// leave misconfigurations to _homing_axis_start()
+
+		uint8_t min_mode = get_switch_mode(MIN_SWITCH(a));
+		uint8_t max_mode = get_switch_mode(MAX_SWITCH(a));
+		if (((min_mode & SW_HOMING_BIT) ^ (max_mode & SW_HOMING_BIT)) == 0) continue;
+
+		float travel = fabs(cm.a[a].travel_max - cm.a[a].travel_min) + cm.a[a].latch_backoff;
+		if (fp_ZERO(travel)) continue;
+
+		if (min_mode & SW_HOMING_BIT) {
+			if (sw.state[MIN_SWITCH(a)] == SW_CLOSED) continue;	// this axis has arrived
+			vect[a] = -travel;
+		} else {
+			if (sw.state[MAX_SWITCH(a)] == SW_CLOSED) continue;
+			vect[a] = travel;
+		}
+		cm.homed[a] = false;								// don't trip soft limits on the seek
+		flags[a] = true;
+		axes_moving++;
+	}
+#ifdef __SOFT_LIMIT_CACHE
+	cm_update_soft_limits();
+#endif
+	if ((axes_moving == 0) || (--hm.seek_passes < 0)) {		// all switches closed, or out of passes
+		return (_set_homing_func(_homing_axis_start));
+	}
+
+	// scale the feed rate so no axis exceeds its own search velocity
+	float length = get_axis_vector_length(vect, origin);
+	for (uint8_t a=0; a < HOMING_AXES; a++) {
+		if (fp_FALSE(flags[a])) continue;
+		float axis_feed = fabs(cm.a[a].search_velocity) * length / fabs(vect[a]);
+		if ((fp_ZERO(feed_rate)) || (axis_feed < feed_rate)) { feed_rate = axis_feed;}
+	}
+	cm.gm.feed_rate = feed_rate;
+	mp_flush_planner();										// don't use cm_request_queue_flush() here
+	cm_request_cycle_start();
+	ritorno(cm_straight_feed(vect, flags));
+	return (STAT_EAGAIN);									// re-enter the seek when the move stops
+}
+#endif // __HOMING_OVERLAP
+
 // Handle an initial switch closure by backing off the closed switch
 // NOTE: Relies on independent switches per axis (not shared)
 static stat_t _homing_axis_clear(int8_t axis)				// first clear move
@@ -349,15 +500,78 @@ static stat_t _homing_axis_clear(int8_t axis)				// first clear move
 	return (_set_homing_func(_homing_axis_search));
 }
 
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+/*
+ * _squaring_arm() - arm per-motor endstop gating if the axis is a dual-motor gantry
+ * cm_homing_squaring_switch() - handle an endstop closure during a squaring search (ISR context)
+ *
+ *	Auto-squaring homes both gantry motors in a single search pass. When an axis with
+ *	two motors mapped to it (e.g. Y1/Y2 on a dual-Y gantry) starts its search move,
+ *	each motor is assigned its own endstop: the axis' homing switch stops the first
+ *	mapped motor, and the input named by SQUARING_SWITCH_2 (wired to the second
+ *	gantry endstop) stops the second. The first closure gates only its motor at the
+ *	DDA level - the move keeps running so the partner motor continues seeking - and
+ *	the second closure ends the search through the normal feedhold, leaving the
+ *	gantry square. The latch and backoff phases then move both motors together,
+ *	which preserves the squareness set at the trip points.
+ *
+ *	Squaring only arms if exactly two motors map to the axis and the second endstop
+ *	input is enabled, so single-motor axes home exactly as before.
+ */
+
+static void _squaring_arm(int8_t axis)
+{
+	hm.square_armed = false;
+	hm.square_hits = 0;
+
+	uint8_t found = 0;
+	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+		if (st_cfg.mot[motor].motor_map == axis) {
+			if (found < 2) { hm.square_motor[found] = motor;}
+			found++;
+		}
+	}
+	if (found != 2) return;								// not a dual-motor gantry axis
+
+	hm.square_sw[0] = hm.homing_switch;					// the axis' own switch stops the first motor
+	hm.square_sw[1] = SQUARING_SWITCH_2;				// the paired input stops the second motor
+	if (hm.square_sw[1] == hm.square_sw[0]) return;		// no independent second endstop
+	if (get_switch_mode(hm.square_sw[1]) == SW_MODE_DISABLED) return;	// second input not enabled
+	hm.square_armed = true;
+}
+
+uint8_t cm_homing_squaring_switch(uint8_t sw_num)
+{
+	if (hm.square_armed == false) return (false);
+	if (sw_num == hm.square_sw[0]) {
+		st_gate_motor(hm.square_motor[0]);
+	} else if (sw_num == hm.square_sw[1]) {
+		st_gate_motor(hm.square_motor[1]);
+	} else {
+		return (false);									// not a squaring endstop - handle normally
+	}
+	if (++hm.square_hits < 2) return (true);			// partner still seeking - absorb the closure
+	hm.square_armed = false;							// both endstops closed - gantry is square
+	return (false);										// let the normal feedhold end the search
+}
+#endif // __DUAL_ENDSTOP && !__NEW_SWITCHES
+
 static stat_t _homing_axis_search(int8_t axis)				// start the search
 {
 	cm_set_axis_jerk(axis, cm.a[axis].jerk_homing);			// use the homing jerk for search onward
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+	_squaring_arm(axis);									// arm per-motor gating if this is a dual-motor gantry
+#endif
 	_homing_axis_move(axis, hm.search_travel, hm.search_velocity);
     return (_set_homing_func(_homing_axis_latch));
 }
 
 static stat_t _homing_axis_latch(int8_t axis)				// latch to switch open
 {
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+	st_ungate_motors();										// release the gates so the latch moves the whole gantry
+	hm.square_armed = false;								// covers searches ended by user feedhold
+#endif
 	// verify assumption that we arrived here because of homing switch closure
 	// rather than user-initiated feedhold or other disruption
 #ifndef __NEW_SWITCHES
@@ -366,11 +580,101 @@ static stat_t _homing_axis_latch(int8_t axis)				// latch to switch open
 #else
 	if (read_switch(hm.homing_switch_axis, hm.homing_switch_position) != SW_CLOSED)
 		return (_set_homing_func(_homing_abort));
+#endif
+#ifdef __INDEX_HOMING
+#ifdef __HOMING_CAL
+	if (hm.cal_passes <= 1)								// a calibration run still measures the switch
+#endif
+	if (st_cfg.mot[QDEC_MOTOR].motor_map == axis) {
+		// the index pulse is the reference - back off the switch and keep going
+		// one full motor revolution at search velocity so exactly one index is
+		// guaranteed to pass; the port interrupt latches the hardware count
+		en_arm_index();
+		float travel = hm.latch_backoff + ((hm.latch_backoff < 0) ?
+			-st_cfg.mot[QDEC_MOTOR].travel_rev : st_cfg.mot[QDEC_MOTOR].travel_rev);
+		_homing_axis_move(axis, travel, hm.search_velocity);
+		return (_set_homing_func(_homing_axis_index));
+	}
 #endif
 	_homing_axis_move(axis, hm.latch_backoff, hm.latch_velocity);
+#ifdef __HOMING_CAL
+	if ((hm.cal_passes > 1) && (hm.cal_motor < MOTORS)) {
+		return (_set_homing_func(_homing_cal_sample));
+	}
+#endif
 	return (_set_homing_func(_homing_axis_zero_backoff));
 }
 
+#ifdef __HOMING_CAL
+/*
+ * _homing_cal_sample() - record one latch position, then repeat the latch or report
+ *
+ *	Runs after each latch move stops, i.e. at the position where the switch
+ *	opened. The position is read from the axis motor's encoder - the planner
+ *	has drained by the time the homing callback runs, so the count is stable -
+ *	and converted to mm. Samples accumulate as offsets from the first latch so
+ *	the sum-of-squares math stays well conditioned in single precision. While
+ *	passes remain the search phase is re-entered to drive back onto the switch
+ *	and latch again; on the last pass min/max/sigma land in the hcl group and
+ *	are reported the same way probing reports prb. Homing then continues with
+ *	the normal zero backoff, so a calibration run still ends properly homed.
+ */
+static stat_t _homing_cal_sample(int8_t axis)
+{
+	float position = (float)en_read_encoder(hm.cal_motor) / st_cfg.mot[hm.cal_motor].steps_per_unit;
+	if (hm.cal_pass == 0) {
+		hm.cal_ref = position;
+		hm.cal_min = 0;
+		hm.cal_max = 0;
+	}
+	float offset = position - hm.cal_ref;
+	hm.cal_min = min(hm.cal_min, offset);
+	hm.cal_max = max(hm.cal_max, offset);
+	hm.cal_sum += offset;
+	hm.cal_sumsq += square(offset);
+
+	if (++hm.cal_pass < hm.cal_passes) {
+		return (_set_homing_func(_homing_axis_search));		// drive back onto the switch and latch again
+	}
+	float samples = (float)hm.cal_pass;
+	float mean = hm.cal_sum / samples;
+	float variance = (hm.cal_sumsq / samples) - square(mean);
+	if (variance < 0) { variance = 0;}						// guard the subtraction against rounding
+	cm.homing_cal_axis = (float)axis;
+	cm.homing_cal_count = samples;
+	cm.homing_cal_min = hm.cal_min - mean;					// reported relative to the mean latch position
+	cm.homing_cal_max = hm.cal_max - mean;
+	cm.homing_cal_sdev = sqrt(variance);
+	json_parser("{\"hcl\":null}");							// report the way probing reports prb
+	return (_set_homing_func(_homing_axis_zero_backoff));
+}
+#endif // __HOMING_CAL
+
+#ifdef __INDEX_HOMING
+/*
+ * _homing_axis_index() - land the zero backoff relative to the latched index pulse
+ *
+ *	Runs after the backoff-plus-one-revolution move stops. The port interrupt
+ *	latched the hardware count at the index pulse; the distance travelled since
+ *	is the current count minus the latch (int16 difference - wrap-safe well past
+ *	a revolution). The final move lands exactly zero_backoff from the index and
+ *	chains straight to _homing_axis_set_zero, so machine zero is referenced to
+ *	the index pulse. The switch only gates the coarse approach: its repeatability
+ *	drops out of the error budget and the slow latch pass is never run.
+ */
+static stat_t _homing_axis_index(int8_t axis)
+{
+	int16_t index_cnt;
+	if (en_take_index(&index_cnt) == false) {			// no index in a revolution - encoder fault
+		return (_homing_error_exit(axis, STAT_HOMING_CYCLE_FAILED));
+	}
+	int16_t counts = (int16_t)((int16_t)QDEC_TIMER.CNT - index_cnt);
+	float past_index = ((float)counts / QDEC_COUNTS_PER_STEP) / st_cfg.mot[QDEC_MOTOR].steps_per_unit;
+	_homing_axis_move(axis, hm.zero_backoff - past_index, hm.search_velocity);
+	return (_set_homing_func(_homing_axis_set_zero));
+}
+#endif // __INDEX_HOMING
+
 static stat_t _homing_axis_zero_backoff(int8_t axis)		// backoff to zero position
 {
 	_homing_axis_move(axis, hm.zero_backoff, hm.search_velocity);
@@ -382,6 +686,9 @@ static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 	if (hm.set_coordinates != false) {
 		cm_set_position(axis, 0);
 		cm.homed[axis] = true;
+#ifdef __SOFT_LIMIT_CACHE
+		cm_update_soft_limits();
+#endif
 	} else {
         // do not set axis if in G28.4 cycle
 		cm_set_position(axis, cm_get_work_position(RUNTIME, axis));
@@ -397,7 +704,7 @@ static stat_t _homing_axis_set_zero(int8_t axis)			// set zero and finish up
 }
 
 static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
-{
+{
 	float vect[] = {0,0,0,0,0,0};
 	float flags[] = {false, false, false, false, false, false};
 
@@ -416,6 +723,10 @@ static stat_t _homing_axis_move(int8_t axis, float target, float velocity)
 
 static stat_t _homing_abort(int8_t axis)
 {
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+	st_ungate_motors();
+	hm.square_armed = false;
+#endif
 	cm_set_axis_jerk(axis, hm.saved_jerk);					// restore the max jerk value
 #ifdef __NEW_SWITCHES
 	_restore_switch_settings(&sw.s[hm.homing_switch_axis][hm.homing_switch_position]);
@@ -456,12 +767,20 @@ static stat_t _homing_finalize_exit(int8_t axis)			// third part of return to ho
 {
 	mp_flush_planner(); 									// should be stopped, but in case of switch closure.
 															// don't use cm_request_queue_flush() here
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+	st_ungate_motors();										// belt and braces - no gate survives the cycle
+	hm.square_armed = false;
+#endif
 
+#ifdef __CYCLE_SNAPSHOT
+	cm_cycle_restore_state();								// restore coordinate system, units, distance & feed modes
+#else
 	cm_set_coord_system(hm.saved_coord_system);				// restore to work coordinate system
 	cm_set_units_mode(hm.saved_units_mode);
 	cm_set_distance_mode(hm.saved_distance_mode);
 	cm_set_feed_rate_mode(hm.saved_feed_rate_mode);
 	cm.gm.feed_rate = hm.saved_feed_rate;
+#endif
 	cm_set_motion_mode(MODEL, MOTION_MODE_CANCEL_MOTION_MODE);
 	cm_cycle_end();
 	cm.cycle_state = CYCLE_OFF;
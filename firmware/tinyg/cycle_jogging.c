@@ -31,6 +31,9 @@
 #include "canonical_machine.h"
 #include "planner.h"
 #include "util.h"
+#ifdef __MPG_WHEEL
+#include "encoder.h"
+#endif
 
 #ifdef __cplusplus
 extern "C"{
@@ -90,6 +93,16 @@ static stat_t _jogging_finalize_exit(int8_t axis);
 
 stat_t cm_jogging_cycle_start(uint8_t axis)
 {
+#ifdef __VELOCITY_JOG
+	// a jog already in flight just gets its bound moved - no flush, no replanning.
+	// An axis change or reversal starts a jerk-limited stop instead; the pendant's
+	// repeated command restarts cleanly in the new direction once stopped.
+	if ((cm.cycle_state == CYCLE_JOG) && (mp_jog_active())) {
+		if (mp_jog_extend(axis, cm_get_jogging_dest())) { return (STAT_OK);}
+		mp_jog_stop();
+		return (STAT_OK);
+	}
+#endif
 	// save relevant non-axis parameters from Gcode model
 	jog.saved_units_mode = cm_get_units_mode(ACTIVE_MODEL);
 	jog.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);
@@ -145,6 +158,33 @@ static stat_t _jogging_axis_start(int8_t axis)
 	return (_set_jogging_func(_jogging_axis_jog));		// register the callback for the jog move
 }
 
+#ifdef __VELOCITY_JOG
+
+static stat_t _jogging_wait_for_stop(int8_t axis);
+
+static stat_t _jogging_axis_jog(int8_t axis)			// run the jog as a velocity-mode move
+{
+	float start = cm_get_absolute_position(RUNTIME, axis);
+	float direction = (jog.dest_pos >= start) ? 1 : -1;
+
+	if (fabs(jog.dest_pos - start) < EPSILON) {
+		return (_set_jogging_func(_jogging_finalize_exit));
+	}
+	mp_flush_planner();									// don't use cm_request_queue_flush() here
+	cm_request_cycle_start();
+	mp_jog_start(axis, direction, jog.velocity_max, jog.dest_pos);
+	return (_set_jogging_func(_jogging_wait_for_stop));
+}
+
+static stat_t _jogging_wait_for_stop(int8_t axis)		// runs once the jog velocity reaches zero
+{
+	if (mp_jog_active()) { return (STAT_EAGAIN);}
+	cm_set_position(axis, cm_get_absolute_position(RUNTIME, axis));	// sync the model to where the jog ended
+	return (_set_jogging_func(_jogging_finalize_exit));
+}
+
+#else // not __VELOCITY_JOG
+
 static stat_t _jogging_axis_jog(int8_t axis)			// run the jog move
 {
 	float vect[] = {0,0,0,0,0,0};
@@ -191,6 +231,8 @@ static stat_t _jogging_axis_jog(int8_t axis)			// run the jog move
     return (_set_jogging_func(_jogging_finalize_exit));
 }
 
+#endif // __VELOCITY_JOG
+
 
 static stat_t _jogging_finalize_exit(int8_t axis)	// finish a jog
 {
@@ -209,6 +251,48 @@ static stat_t _jogging_finalize_exit(int8_t axis)	// finish a jog
 	return (STAT_OK);
 }
 
+#ifdef __MPG_WHEEL
+/*
+ * cm_mpg_callback() - poll the MPG handwheel and steer the jog engine
+ *
+ *	Runs from the controller dispatcher. Detents accumulated in hardware since
+ *	the last pass (see en_mpg_read_delta() in encoder.c) are scaled to distance
+ *	and applied as the position bound of a velocity-mode jog: a jog already in
+ *	flight just has its bound moved by cm_jogging_cycle_start(), a standing
+ *	machine starts one. Cranking against the motion direction triggers the jog
+ *	engine's jerk-limited stop and the next detents restart cleanly the other
+ *	way - exactly the pendant semantics hosts emulate today with {"jogx":...}
+ *	bursts, minus the protocol round trips and planner churn.
+ *
+ *	The wheel is drained but ignored while any other cycle runs (homing,
+ *	probing, a job) and while alarmed - detents turned during a job must not
+ *	queue up and replay when it ends.
+ */
+
+stat_t cm_mpg_callback(void)
+{
+	int16_t detents = en_mpg_read_delta();			// always drain the hardware count
+	if (detents == 0) { return (STAT_NOOP);}
+	if (cm.mpg_scale < EPSILON) { return (STAT_NOOP);}				// scale 0 disables the wheel
+	if ((cm.machine_state == MACHINE_ALARM) ||
+		(cm.machine_state == MACHINE_SHUTDOWN)) { return (STAT_NOOP);}
+	if ((cm.cycle_state != CYCLE_OFF) &&
+		(cm.cycle_state != CYCLE_JOG)) { return (STAT_NOOP);}			// wheel yields to any other cycle
+
+	uint8_t axis = cm.mpg_axis;
+	float dest;
+	if ((cm.cycle_state == CYCLE_JOG) && (mp_jog_active())) {
+		dest = cm_get_jogging_dest();				// move the bound of the jog in flight
+	} else {
+		dest = cm_get_absolute_position(RUNTIME, axis);
+	}
+	dest += (float)detents * cm.mpg_scale;
+	cm.jogging_dest = dest;
+	cm_jogging_cycle_start(axis);
+	return (STAT_OK);
+}
+#endif // __MPG_WHEEL
+
 /*
 static stat_t _jogging_error_exit(int8_t axis)
 {
@@ -34,6 +34,9 @@
 #include "switch.h"
 #include "util.h"
 #include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "kinematics.h"
 
 /**** Probe singleton structure ****/
 
@@ -55,8 +58,10 @@ struct pbProbingSingleton {						// persistent probing runtime variables
 #endif
 
 	// state saved from gcode model
+#ifndef __CYCLE_SNAPSHOT
 	uint8_t saved_distance_mode;				// G90,G91 global setting
 	uint8_t saved_coord_system;					// G54 - G59 setting
+#endif
 	float saved_jerk[AXES];						// saved and restored for each axis
 
 	// probe destination
@@ -66,6 +71,27 @@ struct pbProbingSingleton {						// persistent probing runtime variables
 };
 static struct pbProbingSingleton pb;
 
+#ifdef __PROBE_GRID
+
+#define PROBE_GRID_POINTS_MAX 100				// 10x10 - bounds the result buffer (400 bytes)
+
+struct pgGridSingleton {						// grid probing cycle runtime variables
+	uint8_t active;								// grid cycle in progress
+	uint8_t nx;									// points along X
+	uint8_t ny;									// points along Y
+	uint8_t ix;									// X index of the current row traversal (0 - nx-1)
+	uint8_t iy;									// current row
+	uint16_t misses;							// touches that bottomed out at z_min
+	float x0, y0;								// grid origin, absolute machine coords
+	float dx, dy;								// point pitch (0 if nx/ny == 1)
+	float z_clear;								// Z for the moves between points
+	float z_min;								// Z floor - a touch that gets here is a miss
+	float feed;									// probing feed rate
+	float z[PROBE_GRID_POINTS_MAX];				// probed Z per point, row-major from x0/y0
+};
+static struct pgGridSingleton pg;
+#endif
+
 /**** NOTE: global prototypes and other .h info is located in canonical_machine.h ****/
 
 static stat_t _probing_init();
@@ -73,6 +99,14 @@ static stat_t _probing_start();
 static stat_t _probing_finish();
 static stat_t _probing_finalize_exit();
 static stat_t _probing_error_exit(int8_t axis);
+#ifdef __PROBE_GRID
+static stat_t _grid_retract();
+static stat_t _grid_move_xy();
+static stat_t _grid_touch();
+static stat_t _grid_record();
+static stat_t _grid_report();
+static stat_t _grid_abort(stat_t status);
+#endif
 
 
 /**** HELPERS ***************************************************************************
@@ -198,8 +232,12 @@ static uint8_t _probing_init()
 #endif
 
 	// probe in absolute machine coords
+#ifdef __CYCLE_SNAPSHOT
+	cm_cycle_save_state();
+#else
 	pb.saved_coord_system = cm_get_coord_system(ACTIVE_MODEL);     //cm.gm.coord_system;
 	pb.saved_distance_mode = cm_get_distance_mode(ACTIVE_MODEL);   //cm.gm.distance_mode;
+#endif
 	cm_set_distance_mode(ABSOLUTE_MODE);
 	cm_set_coord_system(ABSOLUTE_COORDS);
 
@@ -221,6 +259,9 @@ static stat_t _probing_start()
 #endif
 
     if( probe==SW_OPEN ) {
+#ifdef __PROBE_LATCH
+		en_clear_probe_latch();				// discard a stale latch from a previous cycle
+#endif
         ritorno(cm_straight_feed(pb.target, pb.flags));
     }
 	return (_set_pb_func(_probing_finish));
@@ -247,6 +288,32 @@ static stat_t _probing_finish()
 		cm.probe_results[axis] = cm_get_absolute_position(ACTIVE_MODEL, axis);
 	}
 
+#ifdef __PROBE_LATCH
+	// Replace the probed-axis results with the position back-computed from the
+	// step counts the switch ISR latched at contact time. The loop above records
+	// where the machine came to rest, which includes the deceleration travel of
+	// the feedhold; the latch records where the switch actually closed.
+	int32_t contact_steps[MOTORS];
+	if ((cm.probe_state == PROBE_SUCCEEDED) && (en_take_probe_latch(contact_steps))) {
+		float joint[AXES];
+		for (uint8_t motor=0; motor<MOTORS; motor++) {
+			joint[st_cfg.mot[motor].motor_map] = contact_steps[motor] / st_cfg.mot[motor].steps_per_unit;
+		}
+#if (KINEMATICS == KINE_COREXY)
+		cm.probe_results[AXIS_X] = (joint[AXIS_X] + joint[AXIS_Y]) / 2;
+		cm.probe_results[AXIS_Y] = (joint[AXIS_X] - joint[AXIS_Y]) / 2;
+		cm.probe_results[AXIS_Z] = joint[AXIS_Z];
+#else
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (fp_NOT_ZERO(pb.flags[axis])) { cm.probe_results[axis] = joint[axis];}
+		}
+#endif
+	}
+#endif // __PROBE_LATCH
+
+#ifdef __PROBE_GRID
+	if (pg.active == false)						// grid touches report once, in bulk, at the end
+#endif
 	json_parser("{\"prb\":null}"); // TODO: verify that this is OK to do...
 	// printf_P(PSTR("{\"prb\":{\"e\":%i"), (int)cm.probe_state);
 	// if (pb.flags[AXIS_X]) printf_P(PSTR(",\"x\":%0.3f"), cm.probe_results[AXIS_X]);
@@ -285,8 +352,12 @@ static void _probe_restore_settings()
 		cm_set_axis_jerk(axis, pb.saved_jerk[axis]);
 
 	// restore coordinate system and distance mode
+#ifdef __CYCLE_SNAPSHOT
+	cm_cycle_restore_state();					// no-op on the early error exits - nothing was saved yet
+#else
 	cm_set_coord_system(pb.saved_coord_system);
 	cm_set_distance_mode(pb.saved_distance_mode);
+#endif
 
 	// update the model with actual position
 	cm_set_motion_mode(MODEL, MOTION_MODE_CANCEL_MOTION_MODE);
@@ -297,6 +368,12 @@ static void _probe_restore_settings()
 static stat_t _probing_finalize_exit()
 {
 	_probe_restore_settings();
+#ifdef __PROBE_GRID
+	if (pg.active == true) {					// the touch was one point of a grid cycle
+		cm.probe_state = PROBE_WAITING;			// keep the callback dispatching
+		return (_set_pb_func(_grid_record));
+	}
+#endif
 	return (STAT_OK);
 }
 
@@ -316,5 +393,179 @@ static stat_t _probing_error_exit(int8_t axis)
 
 	// clean up and exit
 	_probe_restore_settings();
+#ifdef __PROBE_GRID
+	if (pg.active == true) {
+		pg.active = false;
+		cm_cycle_restore_state();				// no-op if the touch restore already popped the grid slot
+	}
+#endif
 	return (STAT_PROBE_CYCLE_FAILED);
 }
+
+
+#ifdef __PROBE_GRID
+/****************************************************************************************
+ * Grid probing cycle - {"prbg":[x0,y0,x1,y1,nx,ny,zclear,zmin,feed]}
+ *
+ *	cm_probe_grid_start() - validate parameters and arm the grid cycle
+ *
+ *	Runs an nx x ny grid of G38.2 touches over the rectangle x0/y0 - x1/y1 without
+ *	host involvement: traverse to the point at zclear, probe down toward zmin at
+ *	the given feed, retract, next point. Each touch reuses the single-probe state
+ *	machine above - switch setup, jerk override, the encoder latch correction -
+ *	so a grid touch measures exactly like a hosted G38.2. Rows are walked
+ *	serpentine to halve the XY travel, but results land in the buffer in row-major
+ *	order from x0/y0 regardless.
+ *
+ *	All coordinates are absolute machine coords in mm (the same frame single
+ *	probes run in). Results are buffered in RAM and reported once, at the end,
+ *	as one JSON array:
+ *
+ *	  {"prbg":{"e":1,"nx":10,"ny":10,"m":0,"z":[...]}}
+ *
+ *	"e" is 1 if every touch made contact, "m" counts touches that bottomed out
+ *	at zmin (those report zmin in the array). With a host round trip per touch a
+ *	10x10 map is protocol-limited; buffered it is limited only by probing speed.
+ *	Needs __CYCLE_SNAPSHOT for the modal save/restore nesting.
+ */
+
+stat_t cm_probe_grid_start(float x0, float y0, float x1, float y1,
+						   uint8_t nx, uint8_t ny, float z_clear, float z_min, float feed)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if ((nx < 1) || (ny < 1) || (((uint16_t)nx * ny) > PROBE_GRID_POINTS_MAX)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	if ((z_clear - z_min) < MINIMUM_PROBE_TRAVEL) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	if (fp_ZERO(feed) || (feed < 0)) { return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);}
+
+#ifdef __MESH_COMP
+	kn_mesh_detach();							// the map buffer is about to be overwritten
+#endif
+	memset(&pg, 0, sizeof(pg));
+	pg.x0 = x0;
+	pg.y0 = y0;
+	pg.dx = (nx > 1) ? ((x1 - x0) / (nx - 1)) : 0;
+	pg.dy = (ny > 1) ? ((y1 - y0) / (ny - 1)) : 0;
+	pg.nx = nx;
+	pg.ny = ny;
+	pg.z_clear = z_clear;
+	pg.z_min = z_min;
+	pg.feed = feed;
+	pg.active = true;
+
+	cm_cycle_save_state();						// outer slot - each touch nests its own save
+	cm_set_units_mode(MILLIMETERS);
+	cm_set_distance_mode(ABSOLUTE_MODE);
+	cm_set_coord_system(ABSOLUTE_COORDS);
+	cm_set_feed_rate_mode(UNITS_PER_MINUTE_MODE);
+	cm_set_feed_rate(pg.feed);
+
+	cm.probe_state = PROBE_WAITING;				// wait for the planner to empty, then start
+	pb.func = _grid_retract;
+	return (STAT_OK);
+}
+
+/*
+ * _grid_retract()	- traverse Z to the clearance plane
+ * _grid_move_xy()	- traverse to the current grid point
+ * _grid_touch()	- run a single-probe touch down toward z_min
+ * _grid_record()	- buffer the touch result and advance to the next point
+ * _grid_report()	- emit the bulk result array and close out the cycle
+ * _grid_abort()	- unwind a grid cycle on a traverse or probe setup error
+ */
+
+static stat_t _grid_retract()
+{
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_Z] = pg.z_clear;
+	flags[AXIS_Z] = 1;
+	stat_t status = cm_straight_traverse(target, flags);
+	if (status != STAT_OK) { return (_grid_abort(status));}
+	cm.probe_state = PROBE_WAITING;				// keep the callback dispatching between touches
+	return (_set_pb_func(_grid_move_xy));
+}
+
+static stat_t _grid_move_xy()
+{
+	uint8_t gx = ((pg.iy & 1) == 0) ? pg.ix : (pg.nx - 1 - pg.ix);	// serpentine rows
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_X] = pg.x0 + (gx * pg.dx);
+	target[AXIS_Y] = pg.y0 + (pg.iy * pg.dy);
+	flags[AXIS_X] = 1;
+	flags[AXIS_Y] = 1;
+	stat_t status = cm_straight_traverse(target, flags);
+	if (status != STAT_OK) { return (_grid_abort(status));}
+	cm.probe_state = PROBE_WAITING;
+	return (_set_pb_func(_grid_touch));
+}
+
+static stat_t _grid_touch()
+{
+	float target[AXES], flags[AXES];
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_Z] = pg.z_min;
+	flags[AXIS_Z] = 1;
+	stat_t status = cm_straight_probe(target, flags);	// arms _probing_init; the chain returns via _grid_record
+	if (status != STAT_OK) { return (_grid_abort(status));}
+	return (status);
+}
+
+static stat_t _grid_record()
+{
+	uint8_t gx = ((pg.iy & 1) == 0) ? pg.ix : (pg.nx - 1 - pg.ix);
+	if (cm.probe_state == PROBE_SUCCEEDED) {
+		pg.z[(pg.iy * pg.nx) + gx] = cm.probe_results[AXIS_Z];
+	} else {
+		pg.z[(pg.iy * pg.nx) + gx] = pg.z_min;	// bottomed out - report the floor and count the miss
+		pg.misses++;
+	}
+	cm.probe_state = PROBE_WAITING;
+
+	if (++pg.ix >= pg.nx) {						// row done
+		pg.ix = 0;
+		if (++pg.iy >= pg.ny) { return (_set_pb_func(_grid_report));}
+	}
+	return (_set_pb_func(_grid_retract));
+}
+
+static stat_t _grid_report()
+{
+	float target[AXES], flags[AXES];			// leave the tool parked on the clearance plane
+	clear_vector(target);
+	clear_vector(flags);
+	target[AXIS_Z] = pg.z_clear;
+	flags[AXIS_Z] = 1;
+	cm_straight_traverse(target, flags);
+
+	fprintf_P(stderr, PSTR("{\"prbg\":{\"e\":%d,\"nx\":%d,\"ny\":%d,\"m\":%d,\"z\":["),
+		(pg.misses == 0), pg.nx, pg.ny, pg.misses);
+	uint16_t points = (uint16_t)pg.nx * pg.ny;
+	for (uint16_t i=0; i<points; i++) {
+		fprintf_P(stderr, PSTR("%s%0.3f"), ((i == 0) ? "" : ","), (double)pg.z[i]);
+	}
+	fprintf_P(stderr, PSTR("]}}\n"));
+
+#ifdef __MESH_COMP
+	kn_mesh_attach(pg.x0, pg.y0, pg.dx, pg.dy, pg.nx, pg.ny, pg.z,
+		(pg.misses == 0));						// auto-enable only a complete map
+#endif
+	pg.active = false;
+	cm_cycle_restore_state();					// pop the outer slot saved at grid start
+	cm.probe_state = PROBE_SUCCEEDED;
+	return (STAT_OK);
+}
+
+static stat_t _grid_abort(stat_t status)
+{
+	pg.active = false;
+	cm_cycle_restore_state();
+	cm.probe_state = PROBE_FAILED;
+	return (status);
+}
+#endif // __PROBE_GRID
@@ -0,0 +1,464 @@
+/*
+ * diagnostics.c - real-time instrumentation counters
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "diagnostics.h"
+#include "planner.h"
+#include "canonical_machine.h"
+#include "persistence.h"
+#include "xmega/xmega_eeprom.h"
+#include "hardware.h"
+#include "util.h"
+
+#ifdef __DIAG
+
+/*
+ * diagnostics_init()	- start the sample clock and open the first window
+ * dia_now()			- sample the diagnostic clock
+ * dia_sample_load()	- record one _load_move() interval
+ * dia_sample_exec()	- record one exec/prep interval and the queue depth
+ * dia_callback()		- roll the accumulators into the $dia snapshot once per second
+ *
+ *	Uses TIMER_5 free-running at CLKper/8 - 0.25 uSec per tick, 16.4 ms before
+ *	wrap - as the sample clock, shared with benchmark mode (test.c) which needs
+ *	the identical configuration. DDA ISR duration is read directly from
+ *	TIMER_DDA.CNT (CPU clocks) so it costs nothing extra in that ISR.
+ *	Interval arithmetic is done in uint16 so a single wrap between samples
+ *	still yields the right answer.
+ *
+ *	The window rollover resets the accumulators non-atomically; a sample
+ *	landing in the gap is lost, which doesn't matter for max/min tracking.
+ */
+
+#define TIMER_DIA			TIMER_5
+#define TIMER_DIA_OVF_ISR_vect TCC1_OVF_vect	// must agree with TIMER_5 in hardware.h
+#define DIA_TIMER_START		TC_CLKSEL_DIV8_gc	// 4 MHz sample clock
+#define DIA_TICKS_PER_USEC	4
+
+diaSingleton_t dia;
+
+#ifdef __CRASH_DUMP
+static diaCrash_t crash __attribute__ ((section (".noinit")));
+static void _crash_refresh(void);
+#endif
+
+static void _open_window(void)
+{
+	dia.dda_ticks_max = 0;
+	dia.load_ticks_max = 0;
+	dia.exec_ticks = 0;
+	dia.queue_lowater = PLANNER_BUFFER_POOL_SIZE;
+	dia.rx_hiwater = 0;
+#ifdef __PREP_AHEAD
+	dia.prep_lates = 0;
+#endif
+	dia.window_systick = SysTickTimer_getValue();
+}
+
+void diagnostics_init()
+{
+#ifdef __CRASH_DUMP
+	dia_crash_check();						// dump and re-arm before anything clears state
+#endif
+	memset(&dia, 0, sizeof(dia));
+	dia.queue_min = PLANNER_BUFFER_POOL_SIZE;
+	TIMER_DIA.CTRLA = DIA_TIMER_START;		// reclaims TIMER_5 from the boot timer (hardware.c)
+#ifdef __EVENT_TRACE
+	TIMER_DIA.INTCTRLA = TC_OVFINTLVL_LO_gc;	// overflow accumulation for dia_time_us()
+#endif
+	_open_window();
+}
+
+uint16_t dia_now() { return (TIMER_DIA.CNT);}
+
+void dia_sample_load(uint16_t start_ticks)
+{
+	uint16_t ticks = (uint16_t)(TIMER_DIA.CNT - start_ticks);
+	if (ticks > dia.load_ticks_max) { dia.load_ticks_max = ticks;}
+}
+
+void dia_sample_exec(uint16_t start_ticks)
+{
+	uint16_t ticks = (uint16_t)(TIMER_DIA.CNT - start_ticks);
+	dia.exec_ticks += ticks;
+	uint8_t available = mp_get_planner_buffers_available();
+	if (available < dia.queue_lowater) { dia.queue_lowater = available;}
+}
+
+stat_t dia_callback()
+{
+	uint32_t elapsed_ms = SysTickTimer_getValue() - dia.window_systick;
+	if (elapsed_ms < DIA_WINDOW_MS) { return (STAT_NOOP);}
+
+	dia.dda_usec_max = (float)dia.dda_ticks_max / (F_CPU / 1000000);	// CPU clocks to uSec
+	dia.load_usec_max = (float)dia.load_ticks_max / DIA_TICKS_PER_USEC;
+	dia.exec_pct = ((float)dia.exec_ticks / DIA_TICKS_PER_USEC) / (elapsed_ms * 10);	// uSec/ms = 0.1%
+	dia.queue_min = dia.queue_lowater;
+	dia.rx_max = dia.rx_hiwater;
+#ifdef __PREP_AHEAD
+	dia.prep_late = dia.prep_lates;
+#endif
+#ifdef __HIGH_BAUD
+	dia.rx_overruns = dia.rx_overrun_count;	// cumulative - these qualify a link, not a window
+	dia.rx_ferrs = dia.rx_ferr_count;
+#endif
+#ifdef __CRASH_DUMP
+	_crash_refresh();						// keep the post-mortem snapshot at most a window stale
+#endif
+	_open_window();
+	return (STAT_OK);
+}
+
+#ifdef __EVENT_TRACE
+/*
+ * dia_time_us()		- microseconds since startup (wraps every ~18 minutes)
+ * dia_trace_event()	- stamp one event into the trace ring (ISR safe)
+ * dia_trace_get()		- $det - print the event trace, oldest first
+ *
+ *	Extends the 16 bit sample clock to 32 bits by accumulating TIMER_DIA
+ *	overflows at low interrupt priority. The RTC's 10 ms ticks are far too
+ *	coarse to order switch hits, feedholds, queue starvation and serial
+ *	overruns against each other when chasing a mid-job stall; these stamps
+ *	put all four on one microsecond timeline.
+ *
+ *	dia_time_us() handles the race where an overflow is pending but its ISR
+ *	hasn't run yet. Events may be stamped from any interrupt level: a ring
+ *	slot is claimed with interrupts masked, then filled outside the critical
+ *	section, so a nested event can at worst print half-written - never lost.
+ *
+ *	$det dumps the ring as one strict-JSON line per event regardless of comm
+ *	mode (same rationale as the RX report - hosts log these, humans don't
+ *	type them) and returns the number of events held. The ring is not cleared
+ *	by reading so a follow-up query after a stall sees the same history.
+ */
+static volatile uint32_t dia_ticks_hi;		// accumulated timer overflows, in ticks
+#ifdef __CRASH_DUMP							// the ring must survive a watchdog reset -
+											//  dia_crash_check() clears it on a cold boot
+static volatile diaEvent_t dia_trace[DIA_TRACE_LEN] __attribute__ ((section (".noinit")));
+static volatile uint8_t dia_trace_next __attribute__ ((section (".noinit")));
+#else
+static volatile diaEvent_t dia_trace[DIA_TRACE_LEN];
+static volatile uint8_t dia_trace_next;
+#endif
+
+ISR(TIMER_DIA_OVF_ISR_vect)
+{
+	dia_ticks_hi += 0x10000UL;
+}
+
+uint32_t dia_time_us()
+{
+	uint8_t sreg = SREG;
+	cli();
+	uint16_t cnt = TIMER_DIA.CNT;
+	uint32_t ticks = dia_ticks_hi;
+	if ((TIMER_DIA.INTFLAGS & TC1_OVFIF_bm) && (cnt < 0x8000)) {
+		ticks += 0x10000UL;					// overflowed after the accumulator last ran
+	}
+	SREG = sreg;
+	return ((ticks + cnt) / DIA_TICKS_PER_USEC);
+}
+
+void dia_trace_event(uint8_t type, uint8_t data)
+{
+	uint8_t sreg = SREG;
+	cli();
+	volatile diaEvent_t *event = &dia_trace[dia_trace_next];
+	dia_trace_next = (dia_trace_next + 1) & (DIA_TRACE_LEN-1);
+	SREG = sreg;
+	event->stamp = dia_time_us();
+	event->type = type;
+	event->data = data;
+}
+
+stat_t dia_trace_get(nvObj_t *nv)
+{
+	uint8_t events = 0;
+	for (uint8_t i=0; i<DIA_TRACE_LEN; i++) {
+		volatile diaEvent_t *event = &dia_trace[(uint8_t)(dia_trace_next + i) & (DIA_TRACE_LEN-1)];
+		if (event->type == DIA_EVENT_NONE) { continue;}
+		fprintf(stderr, "{\"det\":{\"t\":%lu,\"ev\":%u,\"d\":%u}}\n",
+			(unsigned long)event->stamp, event->type, event->data);
+		events++;
+	}
+	nv_store_int(nv, events);
+	return (STAT_OK);
+}
+
+#ifdef __TRACE_RING
+/*
+ * trace_log()	- log one deferred-format record into the trace ring (ISR safe)
+ * trace_get()	- $dtr - format and print the trace ring, oldest first
+ *
+ *	Printf over the shared USART perturbs the timing it is trying to observe,
+ *	so hot paths log only a format id and up to two raw values - a few cycles
+ *	and no formatting. The PROGMEM format strings are applied at drain time,
+ *	when the host asks and the machine can afford it. Same slot-claim
+ *	discipline as dia_trace_event(): a nested record can at worst print
+ *	half-written, never be lost. The ring is not cleared by reading.
+ */
+static const char trace_fmt_exec[] PROGMEM = "exec qd:%u";
+static const char trace_fmt_prep[] PROGMEM = "prep %uus dda:%u";
+static const char trace_fmt_load[] PROGMEM = "load dda:%u";
+
+static const char *const trace_fmt_table[] PROGMEM = {
+	NULL,									// TRACE_FMT_NONE
+	trace_fmt_exec,
+	trace_fmt_prep,
+	trace_fmt_load
+};
+
+static volatile traceRecord_t trace_ring[TRACE_RING_LEN];
+static volatile uint8_t trace_next;
+
+void trace_log(uint8_t fmt, uint16_t a, uint16_t b)
+{
+	uint8_t sreg = SREG;
+	cli();
+	volatile traceRecord_t *record = &trace_ring[trace_next];
+	trace_next = (trace_next + 1) & (TRACE_RING_LEN-1);
+	SREG = sreg;
+	record->stamp = dia_time_us();
+	record->fmt = fmt;
+	record->a = a;
+	record->b = b;
+}
+
+stat_t trace_get(nvObj_t *nv)
+{
+	char fmt[32];
+	uint8_t records = 0;
+	for (uint8_t i=0; i<TRACE_RING_LEN; i++) {
+		volatile traceRecord_t *record = &trace_ring[(uint8_t)(trace_next + i) & (TRACE_RING_LEN-1)];
+		if ((record->fmt == TRACE_FMT_NONE) || (record->fmt >= (sizeof(trace_fmt_table)/sizeof(char *)))) {
+			continue;
+		}
+		strcpy_P(fmt, (PGM_P)pgm_read_word(&trace_fmt_table[record->fmt]));
+		fprintf_P(stderr, PSTR("{\"dtr\":{\"t\":%lu,\"m\":\""), (unsigned long)record->stamp);
+		fprintf(stderr, fmt, record->a, record->b);
+		fprintf_P(stderr, PSTR("\"}}\n"));
+		records++;
+	}
+	nv_store_int(nv, records);
+	return (STAT_OK);
+}
+#endif // __TRACE_RING
+#endif // __EVENT_TRACE
+
+#ifdef __CRASH_DUMP
+/*
+ * dia_crash_check()	- dump the snapshot to EEPROM after a watchdog reset, then re-arm
+ * dia_crash_get()		- $crash - read back the stored dump as strict JSON
+ * _crash_refresh()		- update the snapshot at the 1 Hz window rollover
+ *
+ *	The XMega watchdog has no early-warning interrupt, so nothing can run
+ *	between the timeout and the reset. Instead the forensic context lives in
+ *	.noinit RAM - a snapshot refreshed once per second plus the event trace
+ *	ring - which survives the reset, and diagnostics_init() copies it to the
+ *	reserved EEPROM area (NVM_CRASH_BASE, persistence.h) when RST.STATUS shows
+ *	a watchdog cause. A magic word guards against dumping cold-boot garbage.
+ *	The watchdog itself is expected to be fuse-enabled on fleet machines;
+ *	nothing here arms it.
+ *
+ *	$crash prints the stored dump - reset cause, line number, machine state,
+ *	planner queue indexes, last sampled PC and the stamped event ring - one
+ *	strict-JSON line per record in the $det style, and returns the record
+ *	count (0 if no dump is stored). The dump persists until the next watchdog
+ *	reset overwrites it.
+ */
+
+static void _crash_refresh()
+{
+	crash.linenum = cm.gm.linenum;
+	crash.combined_state = cm_get_combined_state();
+	crash.buffers_available = mp_get_planner_buffers_available();
+	crash.run_index = (uint8_t)(mb.r - mb.bf);
+	crash.write_index = (uint8_t)(mb.w - mb.bf);
+}
+
+static void _crash_dump_to_eeprom(uint8_t reset_status)
+{
+	uint16_t addr = NVM_CRASH_BASE;
+	uint16_t magic = CRASH_DUMP_MAGIC;
+	uint8_t events = 0;
+
+	(void)EEPROM_WriteBytes(addr, (int8_t *)&magic, 2); addr += 2;
+	EEPROM_WriteByte(addr++, reset_status);
+#ifdef __EVENT_TRACE
+	for (uint8_t i=0; i<DIA_TRACE_LEN; i++) {
+		if (dia_trace[i].type != DIA_EVENT_NONE) { events++;}
+	}
+#endif
+	EEPROM_WriteByte(addr++, events);
+	(void)EEPROM_WriteBytes(addr, (int8_t *)&crash, sizeof(crash)); addr += sizeof(crash);
+#ifdef __EVENT_TRACE
+	for (uint8_t i=0; i<DIA_TRACE_LEN; i++) {	// oldest first, as $det prints them
+		diaEvent_t event = *(diaEvent_t *)&dia_trace[(uint8_t)(dia_trace_next + i) & (DIA_TRACE_LEN-1)];
+		if (event.type == DIA_EVENT_NONE) { continue;}
+		(void)EEPROM_WriteBytes(addr, (int8_t *)&event, sizeof(event)); addr += sizeof(event);
+	}
+#endif
+}
+
+void dia_crash_check()
+{
+	if ((RST.STATUS & RST_WDRF_bm) && (crash.magic == CRASH_DUMP_MAGIC)) {
+		_crash_dump_to_eeprom(RST.STATUS);
+	}
+	RST.STATUS = RST_WDRF_bm;				// write-one-to-clear so the next boot sees a fresh cause
+	memset((void *)&crash, 0, sizeof(crash));
+	crash.magic = CRASH_DUMP_MAGIC;			// arm the snapshot
+#ifdef __EVENT_TRACE
+	memset((void *)dia_trace, 0, sizeof(dia_trace));	// .noinit - must be cleared by hand
+	dia_trace_next = 0;
+#endif
+}
+
+stat_t dia_crash_get(nvObj_t *nv)
+{
+	uint16_t addr = NVM_CRASH_BASE;
+	uint16_t magic;
+	diaCrash_t snap;
+
+	(void)EEPROM_ReadBytes(addr, (int8_t *)&magic, 2); addr += 2;
+	if (magic != CRASH_DUMP_MAGIC) {
+		nv_store_int(nv, 0);				// no dump stored
+		return (STAT_OK);
+	}
+	uint8_t reset_status = EEPROM_ReadByte(addr++);
+	uint8_t events = EEPROM_ReadByte(addr++);
+	(void)EEPROM_ReadBytes(addr, (int8_t *)&snap, sizeof(snap)); addr += sizeof(snap);
+	fprintf(stderr, "{\"crash\":{\"rst\":%u,\"line\":%lu,\"stat\":%u,\"qa\":%u,\"qr\":%u,\"qw\":%u"
+#ifdef __PC_PROFILE
+		",\"pc\":%u"
+#endif
+		"}}\n", reset_status, (unsigned long)snap.linenum, snap.combined_state,
+		snap.buffers_available, snap.run_index, snap.write_index
+#ifdef __PC_PROFILE
+		, snap.last_pc
+#endif
+		);
+#ifdef __EVENT_TRACE
+	for (uint8_t i=0; i<events; i++) {
+		diaEvent_t event;
+		(void)EEPROM_ReadBytes(addr, (int8_t *)&event, sizeof(event)); addr += sizeof(event);
+		fprintf(stderr, "{\"crev\":{\"t\":%lu,\"ev\":%u,\"d\":%u}}\n",
+			(unsigned long)event.stamp, event.type, event.data);
+	}
+#endif
+	nv_store_int(nv, events + 1);
+	return (STAT_OK);
+}
+#endif // __CRASH_DUMP
+
+#ifdef __STACK_WATERMARK
+/*
+ * dia_stack_paint()	- fill the free RAM gap with a known byte at init
+ * dia_stack_scan()		- incremental watermark scan, called from the idler
+ *
+ *	The XMega runs the main loop and all three interrupt levels on the single
+ *	hardware stack, so one watermark bounds their worst-case nesting - which
+ *	is the number that matters before enlarging the planner queue or any of
+ *	the static buffers. Painting covers &_end (first byte above .bss) up to
+ *	just below the stack pointer at init time; the scan walks up from the
+ *	bottom in DIA_STACK_SCAN_CHUNK steps and publishes the count of
+ *	never-touched bytes as $dias. A pass over 2K of free RAM takes ~64 idler
+ *	calls, so the figure converges within moments of going idle and ratchets
+ *	down if the stack later reaches deeper.
+ */
+extern uint8_t _end;						// linker symbol - first byte above .bss
+
+static uint8_t *stack_scan_p;				// scan resume point
+
+void dia_stack_paint()
+{
+	uint8_t *sp = (uint8_t *)SP;
+	for (uint8_t *p = &_end; p < (sp - 16); p++) { *p = DIA_STACK_PAINT;}
+	stack_scan_p = &_end;
+}
+
+void dia_stack_scan()
+{
+	uint8_t *limit = stack_scan_p + DIA_STACK_SCAN_CHUNK;
+	while (stack_scan_p < limit) {
+		if (*stack_scan_p != DIA_STACK_PAINT) {			// found the watermark -
+			dia.stack_free = (float)(stack_scan_p - &_end);	// publish and restart
+			stack_scan_p = &_end;
+			return;
+		}
+		stack_scan_p++;
+	}
+}
+#endif // __STACK_WATERMARK
+
+#ifdef __PC_PROFILE
+/*
+ * dia_profile_sample()	- bucket one interrupted PC (called from the RTC tick ISR)
+ * dia_profile_get()	- $pcd - dump and clear the PC sample histogram
+ *
+ *	A poor man's gprof: the 100 Hz RTC tick hands its return address - the
+ *	program counter it interrupted - to the sampler, which counts it into one
+ *	of PC_PROFILE_BUCKETS equal slices of the text segment. Over a minutes-long
+ *	job that's enough samples to see whether cycles go to the trapezoid math,
+ *	the serializer or the software float routines. avr-gcc reports the return
+ *	address as a 16 bit word address, so the histogram spans the first 128K of
+ *	flash, which holds all of the application text on this part.
+ *
+ *	$pcd prints each non-zero bucket as strict JSON - bucket start byte address
+ *	and sample count, resolution 2K - returns the total sample count, and
+ *	clears the histogram so successive dumps profile successive intervals.
+ *	Bucket counts saturate at 0xFFFF (about 11 minutes in one bucket).
+ */
+static volatile uint16_t pc_profile[PC_PROFILE_BUCKETS];
+
+void dia_profile_sample(void *pc)
+{
+	uint8_t bucket = (uint8_t)((uint16_t)pc >> 10);		// 64 buckets of 1K word addresses
+	if (pc_profile[bucket] != 0xFFFF) { pc_profile[bucket]++;}
+#ifdef __CRASH_DUMP
+	crash.last_pc = (uint16_t)pc;			// best proxy for where a hang is spinning
+#endif
+}
+
+stat_t dia_profile_get(nvObj_t *nv)
+{
+	uint32_t samples = 0;
+	for (uint8_t i=0; i<PC_PROFILE_BUCKETS; i++) {
+		uint16_t count = pc_profile[i];
+		pc_profile[i] = 0;
+		if (count == 0) { continue;}
+		fprintf(stderr, "{\"pcd\":{\"a\":%lu,\"n\":%u}}\n",
+			((uint32_t)i << 11), count);				// bucket start as a byte address
+		samples += count;
+	}
+	nv_store_int(nv, samples);
+	return (STAT_OK);
+}
+#endif // __PC_PROFILE
+
+#endif // __DIAG
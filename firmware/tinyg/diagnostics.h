@@ -0,0 +1,179 @@
+/*
+ * diagnostics.h - real-time instrumentation counters
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	The stepper budgets in stepper.h (10 uSec load window, 20 uSec between DDA
+ *	ticks) are hard limits but nothing in the firmware measures how close a
+ *	given machine runs to them. This module keeps a set of cheap counters that
+ *	the hot-path ISRs update, and rolls them into a per-second snapshot exposed
+ *	as the $dia group (see config_app.c). The $dia tokens are ordinary config
+ *	values so they can be added to a status report list for streaming.
+ */
+
+#ifndef DIAGNOSTICS_H_ONCE
+#define DIAGNOSTICS_H_ONCE
+
+#ifdef __DIAG
+
+#define DIA_WINDOW_MS 1000					// accumulation window for the $dia snapshot
+
+typedef struct diaSingleton {				// diagnostic counters
+
+	// window accumulators - written from ISRs, reset by dia_callback()
+	volatile uint16_t dda_ticks_max;		// worst DDA ISR duration seen this window (CPU clocks)
+	volatile uint16_t load_ticks_max;		// worst _load_move() duration this window (0.25 uSec ticks)
+	volatile uint32_t exec_ticks;			// time spent in exec/prep this window (0.25 uSec ticks)
+	volatile uint8_t queue_lowater;			// fewest planner buffers available this window
+	volatile uint16_t rx_hiwater;			// deepest RX queue occupancy this window (chars)
+#ifdef __PREP_AHEAD
+	volatile uint16_t prep_lates;			// preps that missed a segment boundary this window
+#endif
+#ifdef __HIGH_BAUD
+	volatile uint16_t rx_overrun_count;		// cumulative since boot - not reset by the window
+	volatile uint16_t rx_ferr_count;		// cumulative since boot - not reset by the window
+#endif
+#ifdef __JOB_STATS
+	// job-scoped accumulators - reset by rpt_job_stats_start() at cycle start
+	uint32_t job_segments;					// stepper segments prepped this job
+	uint16_t job_prep_lates;				// preps that missed a segment boundary this job
+	volatile float job_ferror_max;			// worst following error this job (motor steps)
+#endif
+	uint32_t window_systick;				// systick at which the current window started
+
+	// published snapshot - one float per $dia token, updated once per window
+	float dda_usec_max;						// diad - worst DDA ISR duration (uSec)
+	float load_usec_max;					// dial - worst load duration (uSec)
+	float exec_pct;							// diax - exec/prep occupancy (% of window)
+	float queue_min;						// diaq - planner buffer low water mark
+	float rx_max;							// diar - serial RX queue high water mark
+#ifdef __PREP_AHEAD
+	float prep_late;						// diap - late preps absorbed by the staged segment
+#endif
+#ifdef __STACK_WATERMARK
+	float stack_free;						// dias - stack bytes never touched since painting
+#endif
+#ifdef __HIGH_BAUD
+	float rx_overruns;						// diao - RX characters lost to overruns since boot
+	float rx_ferrs;							// diaf - RX framing errors since boot
+#endif
+} diaSingleton_t;
+
+extern diaSingleton_t dia;
+
+void diagnostics_init(void);
+uint16_t dia_now(void);
+void dia_sample_load(uint16_t start_ticks);
+void dia_sample_exec(uint16_t start_ticks);
+stat_t dia_callback(void);
+
+#ifdef __EVENT_TRACE
+
+#define DIA_TRACE_LEN 16					// stamped events retained - must be a power of 2
+
+enum diaEventType {
+	DIA_EVENT_NONE = 0,						// empty ring slot
+	DIA_EVENT_STARVED,						// planner queue ran dry during motion (data = count low byte)
+	DIA_EVENT_FEEDHOLD,						// feedhold requested (data = motion state)
+	DIA_EVENT_SWITCH,						// switch edge fired its ISR (data = switch number)
+	DIA_EVENT_RX_OVERRUN					// serial RX buffer overrun (data = dropped character)
+};
+
+typedef struct diaEvent {					// one stamped event
+	uint32_t stamp;							// dia_time_us() at the event
+	uint8_t type;							// diaEventType
+	uint8_t data;							// type-specific detail
+} diaEvent_t;
+
+uint32_t dia_time_us(void);
+void dia_trace_event(uint8_t type, uint8_t data);
+stat_t dia_trace_get(nvObj_t *nv);
+
+#ifdef __TRACE_RING
+
+#define TRACE_RING_LEN 32						// records retained - must be a power of 2
+
+enum traceFormat {							// indexes into the PROGMEM format table (see diagnostics.c)
+	TRACE_FMT_NONE = 0,						// empty ring slot
+	TRACE_FMT_EXEC,							// exec pass produced a segment (a = buffers available)
+	TRACE_FMT_PREP,							// prep staged a segment (a = segment uSec, b = dda ticks)
+	TRACE_FMT_LOAD							// loader moved a segment to the DDA (a = dda ticks)
+};
+
+typedef struct traceRecord {				// one deferred-format record
+	uint32_t stamp;							// dia_time_us() at the record
+	uint8_t fmt;							// traceFormat - selects the format string at drain time
+	uint16_t a;								// format arguments - meaning is per format
+	uint16_t b;
+} traceRecord_t;
+
+void trace_log(uint8_t fmt, uint16_t a, uint16_t b);
+stat_t trace_get(nvObj_t *nv);
+
+#endif // __TRACE_RING
+#endif // __EVENT_TRACE
+
+#ifdef __CRASH_DUMP
+
+#define CRASH_DUMP_MAGIC 0x4443				// 'CD' - marks a valid snapshot / stored dump
+
+typedef struct diaCrash {					// post-mortem snapshot - lives in .noinit
+	uint16_t magic;							// CRASH_DUMP_MAGIC while the snapshot is armed
+	uint32_t linenum;						// gcode line active at the last refresh
+	uint8_t combined_state;					// cm_get_combined_state() at the last refresh
+	uint8_t buffers_available;				// planner queue depth
+	uint8_t run_index;						// planner run buffer index
+	uint8_t write_index;					// planner write buffer index
+#ifdef __PC_PROFILE
+	uint16_t last_pc;						// most recent sampled PC (word address)
+#endif
+} diaCrash_t;
+
+void dia_crash_check(void);
+stat_t dia_crash_get(nvObj_t *nv);
+
+#endif // __CRASH_DUMP
+
+#ifdef __STACK_WATERMARK
+
+#define DIA_STACK_PAINT 0xA5				// fill byte for never-touched stack detection
+#define DIA_STACK_SCAN_CHUNK 32				// bytes examined per idler pass
+
+void dia_stack_paint(void);
+void dia_stack_scan(void);
+
+#endif // __STACK_WATERMARK
+
+#ifdef __PC_PROFILE
+
+#define PC_PROFILE_BUCKETS 64				// histogram buckets over the text segment - must be a power of 2
+
+void dia_profile_sample(void *pc);
+stat_t dia_profile_get(nvObj_t *nv);
+
+#endif // __PC_PROFILE
+
+#endif // __DIAG
+
+#endif // End of include guard: DIAGNOSTICS_H_ONCE
@@ -28,15 +28,23 @@
 #include "tinyg.h"
 #include "config.h"
 #include "encoder.h"
+#include "hardware.h"
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /**** Allocate Structures ****/
 
 enEncoders_t en;
 
+#ifdef __QDEC_ENCODER
+static void _init_qdec(void);
+#endif
+#ifdef __MPG_WHEEL
+static void _init_mpg(void);
+#endif
+
 /************************************************************************************
  **** CODE **************************************************************************
  ************************************************************************************/
@@ -49,6 +57,12 @@ void encoder_init()
 {
 	memset(&en, 0, sizeof(en));		// clear all values, pointers and status
 	encoder_init_assertions();
+#ifdef __QDEC_ENCODER
+	_init_qdec();
+#endif
+#ifdef __MPG_WHEEL
+	_init_mpg();
+#endif
 }
 
 /*
@@ -80,22 +94,202 @@ stat_t encoder_test_assertions()
 void en_set_encoder_steps(uint8_t motor, float steps)
 {
 	en.en[motor].encoder_steps = (int32_t)round(steps);
+#ifdef __QDEC_ENCODER
+	if (motor == QDEC_MOTOR) {			// re-base the hardware count on the new position
+		en.qdec_prev_cnt = (int16_t)QDEC_TIMER.CNT;
+		en.qdec_residue = 0;
+	}
+#endif
+}
+
+/*
+ * en_read_encoder()
+ *
+ *	The stepper ISR count steps into steps_run(). These values are accumulated to
+ *	encoder_position during LOAD (HI interrupt level). The encoder position is
+ *	therefore always stable. But be advised: the position lags target and position
+ *	valaues elsewherein the system becuase the sample is taken when the steps for
+ *	that segment are complete.
+ *
+ *	Returns native int32 steps. The encoder accumulates in integer step space
+ *	end-to-end; callers that need length units (reports, probes) convert on demand
+ *	rather than paying a float conversion in the per-segment exec path.
+ */
+
+int32_t en_read_encoder(uint8_t motor)
+{
+	return(en.en[motor].encoder_steps);
+}
+
+#ifdef __QDEC_ENCODER
+/*
+ * _init_qdec()     - set up hardware quadrature decode for the external encoder
+ * en_sample_qdec() - fold the hardware count into the encoder position
+ *
+ *	Event channel 0 decodes the phase pins (quadrature decode requires channel 0,
+ *	2 or 4 - channel 0 is unused here) and QDEC_TIMER counts the decoded events,
+ *	so between samples the position tracks in hardware at zero CPU cost.
+ *	en_sample_qdec() runs in place of the step accumulation for QDEC_MOTOR (see
+ *	ACCUMULATE_ENCODER) during LOAD at HI interrupt level. The int16 counter
+ *	difference is wrap-safe for anything under 32767 counts per segment - orders
+ *	of magnitude above any real rate. Counts that don't divide into a whole step
+ *	are carried in qdec_residue so truncation never accumulates.
+ */
+
+static void _init_qdec(void)
+{
+	QDEC_PORT.DIRCLR = (3 << QDEC_PHASE0_bp);		// phase A and B pins as inputs
+	(&QDEC_PORT.PIN0CTRL)[QDEC_PHASE0_bp]   = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	(&QDEC_PORT.PIN0CTRL)[QDEC_PHASE0_bp+1] = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	EVSYS.CH0MUX = QDEC_EVSYS_CHMUX;				// phase A pin is the event source
+	EVSYS.CH0CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_2SAMPLES_gc;
+	QDEC_TIMER.CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH0_gc;
+	QDEC_TIMER.PER = 0xFFFF;
+	QDEC_TIMER.CTRLA = TC_CLKSEL_DIV1_gc;
+	en.qdec_prev_cnt = (int16_t)QDEC_TIMER.CNT;
+#ifdef __INDEX_HOMING
+	QDEC_PORT.DIRCLR = (1 << QDEC_INDEX_bp);		// index pin as input - interrupt armed on demand
+	(&QDEC_PORT.PIN0CTRL)[QDEC_INDEX_bp] = PORT_ISC_RISING_gc | PORT_OPC_PULLUP_gc;
+#endif
+}
+
+void en_sample_qdec(void)
+{
+	int16_t cnt = (int16_t)QDEC_TIMER.CNT;
+	en.qdec_residue += (int16_t)(cnt - en.qdec_prev_cnt);
+	en.qdec_prev_cnt = cnt;
+	int16_t steps = en.qdec_residue / QDEC_COUNTS_PER_STEP;
+	en.qdec_residue -= steps * QDEC_COUNTS_PER_STEP;
+	en.en[QDEC_MOTOR].encoder_steps += steps;
+}
+
+#ifdef __INDEX_HOMING
+/*
+ * en_arm_index()  - arm a one-shot latch of the next index pulse
+ * en_take_index() - retrieve and consume the latch. Returns false if no index seen
+ *
+ *	The index pin fires a HI level port interrupt whose only work is to latch
+ *	QDEC_TIMER.CNT and mask itself, so exactly the first index after arming is
+ *	taken. Interrupt latency is the entire capture error: at a homing search
+ *	rate of ~16k counts/sec a 10 uSec response is 0.16 of a count, far inside
+ *	one quadrature count. A true hardware capture isn't available - the timer's
+ *	event action is already claimed by TC_EVACT_QDEC_gc and the XMega allows
+ *	only one EVACT per timer.
+ */
+
+void en_arm_index(void)
+{
+	en.index_hit = false;
+	QDEC_PORT.INTFLAGS = PORT_INT1IF_bm;			// clear any stale edge
+	QDEC_PORT.INT1MASK = (1 << QDEC_INDEX_bp);
+	QDEC_PORT.INTCTRL |= PORT_INT1LVL_HI_gc;
+}
+
+uint8_t en_take_index(int16_t *index_cnt)
+{
+	QDEC_PORT.INT1MASK = 0;							// disarm in case the index was never seen
+	if (en.index_hit == false) {
+		return (false);
+	}
+	*index_cnt = en.index_cnt;
+	en.index_hit = false;
+	return (true);
 }
-
-/*
- * en_read_encoder()
- *
- *	The stepper ISR count steps into steps_run(). These values are accumulated to
- *	encoder_position during LOAD (HI interrupt level). The encoder position is
- *	therefore always stable. But be advised: the position lags target and position
- *	valaues elsewherein the system becuase the sample is taken when the steps for
- *	that segment are complete.
- */
-
-float en_read_encoder(uint8_t motor)
-{
-	return((float)en.en[motor].encoder_steps);
-}
+
+ISR(QDEC_INDEX_ISR_vect)
+{
+	en.index_cnt = (int16_t)QDEC_TIMER.CNT;
+	en.index_hit = true;
+	QDEC_PORT.INT1MASK = 0;							// one-shot - masked until re-armed
+}
+#endif // __INDEX_HOMING
+#endif // __QDEC_ENCODER
+
+#ifdef __MPG_WHEEL
+/*
+ * _init_mpg()          - set up hardware quadrature decode for the MPG handwheel
+ * en_mpg_read_delta()  - return wheel detents turned since the last call
+ *
+ *	Same hardware pattern as _init_qdec(): event channel 2 decodes the phase
+ *	pins and MPG_TIMER counts the decoded events, so the wheel tracks in
+ *	hardware between polls. The digital filter is widened to 4 samples - a
+ *	hand-cranked wheel switches slowly and pendant cables pick up noise.
+ *	en_mpg_read_delta() is called from the main loop (cm_mpg_callback()), not
+ *	from an interrupt; the int16 counter difference is wrap-safe for anything
+ *	under 32767 counts between polls, orders of magnitude above any hand rate.
+ *	Counts that don't make a whole detent carry over in mpg_residue so slow
+ *	creep between detent clicks is never lost.
+ */
+
+static void _init_mpg(void)
+{
+	MPG_PORT.DIRCLR = (3 << MPG_PHASE0_bp);			// phase A and B pins as inputs
+	(&MPG_PORT.PIN0CTRL)[MPG_PHASE0_bp]   = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	(&MPG_PORT.PIN0CTRL)[MPG_PHASE0_bp+1] = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	EVSYS.CH2MUX = MPG_EVSYS_CHMUX;					// phase A pin is the event source
+	EVSYS.CH2CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_4SAMPLES_gc;
+	MPG_TIMER.CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH2_gc;
+	MPG_TIMER.PER = 0xFFFF;
+	MPG_TIMER.CTRLA = TC_CLKSEL_DIV1_gc;
+	en.mpg_prev_cnt = (int16_t)MPG_TIMER.CNT;
+}
+
+int16_t en_mpg_read_delta(void)
+{
+	int16_t cnt = (int16_t)MPG_TIMER.CNT;
+	en.mpg_residue += (int16_t)(cnt - en.mpg_prev_cnt);
+	en.mpg_prev_cnt = cnt;
+	int16_t detents = en.mpg_residue / MPG_COUNTS_PER_DETENT;
+	en.mpg_residue -= detents * MPG_COUNTS_PER_DETENT;
+	return (detents);
+}
+#endif // __MPG_WHEEL
+
+#ifdef __PROBE_LATCH
+/*
+ * en_latch_encoders()     - snapshot encoder counts at probe contact time
+ * en_clear_probe_latch()  - discard any stale latch before starting a probe move
+ * en_take_probe_latch()   - retrieve and consume the latch. Returns false if empty
+ *
+ *	en_latch_encoders() is called from the switch ISR (MED level) the instant the
+ *	probe makes contact. Unlike en_read_encoder() it includes steps_run, so the
+ *	count is current to the last DDA tick rather than the last segment boundary.
+ *	The DDA ISR (HI level) can preempt us mid-copy, so each motor is sampled
+ *	until two successive reads agree. The count advances at most once per DDA
+ *	tick (20 uSec) so this converges in one or two passes.
+ */
+
+static int32_t en_latch[MOTORS];		// snapshot of encoder counts at probe contact
+static uint8_t en_latched;				// true if the latch holds a contact sample
+
+void en_latch_encoders(void)
+{
+	for (uint8_t m=0; m<MOTORS; m++) {
+		volatile enEncoder_t *e = &en.en[m];
+		int32_t steps;
+		do {
+			steps = e->encoder_steps + e->steps_run;
+		} while (steps != (e->encoder_steps + e->steps_run));
+		en_latch[m] = steps;
+	}
+	en_latched = true;
+}
+
+void en_clear_probe_latch(void)
+{
+	en_latched = false;
+}
+
+uint8_t en_take_probe_latch(int32_t steps[])
+{
+	if (!en_latched) return (false);
+	for (uint8_t m=0; m<MOTORS; m++) {
+		steps[m] = en_latch[m];
+	}
+	en_latched = false;
+	return (true);
+}
+#endif // __PROBE_LATCH
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
@@ -111,6 +305,6 @@ float en_read_encoder(uint8_t motor)
 
 #endif // __TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
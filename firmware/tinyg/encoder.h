@@ -88,18 +88,82 @@
 #ifndef ENCODER_H_ONCE
 #define ENCODER_H_ONCE
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /**** Configs and Constants ****/
 
+#ifdef __QDEC_ENCODER
+/* External encoder channel (the "real encoders" case the module notes anticipate)
+ *
+ *	One externally wired quadrature encoder is decoded entirely in hardware: the two
+ *	phase pins feed an event system channel with quadrature decode enabled and
+ *	QDEC_TIMER counts the decoded edges - no ISR, no CPU cost. The counter is folded
+ *	into encoder_steps by en_sample_qdec() at segment accumulation time (LOAD, HI
+ *	interrupt level), so the measured count obeys the same sampling alignment as the
+ *	virtual encoders and feeds the existing __STEP_CORRECTION path unchanged. The
+ *	error term for QDEC_MOTOR then reflects actual shaft position, which makes the
+ *	step correction true closed loop and backs the stall alarm in st_prep_line().
+ *
+ *	Wiring: phase A on QDEC_PORT pin QDEC_PHASE0_bp, phase B on the next higher pin.
+ *	If the count runs against the motor's positive direction swap the phases (or set
+ *	INVEN on one pin). Scaling: QDEC_COUNTS_PER_STEP = (encoder lines * 4) / (motor
+ *	steps per rev * microsteps) and must come out a whole number - pick an encoder
+ *	whose edge count is an integer multiple of the configured step count.
+ */
+#define QDEC_MOTOR				MOTOR_1		// motor whose virtual encoder is replaced by the measured one
+#define QDEC_TIMER				TCF1		// the one TC not claimed in hardware.h
+#define QDEC_PORT				PORTB		// phase input port (PORTB is unused by the board proper)
+#define QDEC_PHASE0_bp			2			// phase A bit position - phase B is QDEC_PHASE0_bp+1
+#define QDEC_EVSYS_CHMUX		EVSYS_CHMUX_PORTB_PIN2_gc	// must agree with the two lines above
+#define QDEC_COUNTS_PER_STEP	4			// quadrature counts per configured motor step
+#define QDEC_STALL_THRESHOLD	32			// stall alarm when measured error exceeds this many steps
+#ifdef __INDEX_HOMING
+#define QDEC_INDEX_bp			(QDEC_PHASE0_bp+2)	// index pulse input - the pin above phase B
+#define QDEC_INDEX_ISR_vect		PORTB_INT1_vect		// index latch interrupt - must match QDEC_PORT
+#endif
+#endif
+
+#ifdef __MPG_WHEEL
+/* MPG pendant handwheel channel
+ *
+ *	A second hardware quadrature channel for an operator handwheel, decoded the
+ *	same way as __QDEC_ENCODER: the phase pins feed an event channel with
+ *	quadrature decode enabled and MPG_TIMER counts the decoded edges at zero CPU
+ *	cost. cm_mpg_callback() (cycle_jogging.c) polls the accumulated detents from
+ *	the main loop and steers the velocity-mode jog engine, so wheel-to-motion
+ *	latency is one callback pass plus one segment time and the planner never
+ *	sees micro-move spam.
+ *
+ *	The XMega has exactly one unclaimed timer (TCF1), so the wheel excludes
+ *	__QDEC_ENCODER and __SPINDLE_SYNC - a pendant rig doesn't carry a spindle
+ *	or shaft encoder. Wiring: phase A on MPG_PORT pin MPG_PHASE0_bp, phase B on
+ *	the next higher pin. Typical 100-detent wheels emit 4 quadrature counts per
+ *	detent click. Scaling to distance is runtime config ($mpga/$mpgs).
+ */
+#define MPG_TIMER				TCF1		// the one TC not claimed in hardware.h
+#define MPG_PORT				PORTB		// phase input port (PORTB is unused by the board proper)
+#define MPG_PHASE0_bp			0			// phase A bit position - phase B is MPG_PHASE0_bp+1
+#define MPG_EVSYS_CHMUX			EVSYS_CHMUX_PORTB_PIN0_gc	// must agree with the two lines above
+#define MPG_COUNTS_PER_DETENT	4			// quadrature counts per wheel detent click
+#endif
+
 /**** Macros ****/
 // used to abstract the encoder code out of the stepper so it can be managed in one place
 
 #define SET_ENCODER_STEP_SIGN(m,s)	en.en[m].step_sign = s;
 #define INCREMENT_ENCODER(m)		en.en[m].steps_run += en.en[m].step_sign;
+#ifdef __QDEC_ENCODER				// m is a constant at every call site so the branch folds away
+#define ACCUMULATE_ENCODER(m)		if (m == QDEC_MOTOR) { en_sample_qdec();} \
+									else { en.en[m].encoder_steps += en.en[m].steps_run;} \
+									en.en[m].steps_run = 0;
+#else
 #define ACCUMULATE_ENCODER(m)		en.en[m].encoder_steps += en.en[m].steps_run; en.en[m].steps_run = 0;
+#endif
+#ifdef __DDA_PULSE_CORE
+#define INCREMENT_ENCODER_MASKED(m,step) en.en[m].steps_run += (en.en[m].step_sign & -(int8_t)(step));
+#endif
 
 /**** Structures ****/
 
@@ -112,6 +176,18 @@ typedef struct enEncoder { 			// one real or virtual encoder per controlled moto
 typedef struct enEncoders {
 	magic_t magic_start;
 	enEncoder_t en[MOTORS];			// runtime encoder structures
+#ifdef __QDEC_ENCODER
+	int16_t qdec_prev_cnt;			// QDEC_TIMER count at the last sample
+	int16_t qdec_residue;			// quadrature counts that don't yet make a whole step
+#ifdef __INDEX_HOMING
+	volatile int16_t index_cnt;		// QDEC_TIMER count latched at the index pulse
+	volatile uint8_t index_hit;		// true once an armed index pulse has latched
+#endif
+#endif
+#ifdef __MPG_WHEEL
+	int16_t mpg_prev_cnt;			// MPG_TIMER count at the last poll
+	int16_t mpg_residue;			// quadrature counts that don't yet make a whole detent
+#endif
 	magic_t magic_end;
 } enEncoders_t;
 
@@ -124,11 +200,27 @@ void encoder_init(void);
 void encoder_init_assertions(void);
 stat_t encoder_test_assertions(void);
 
-void en_set_encoder_steps(uint8_t motor, float steps);
-float en_read_encoder(uint8_t motor);
+void en_set_encoder_steps(uint8_t motor, float steps);
+int32_t en_read_encoder(uint8_t motor);
+#ifdef __QDEC_ENCODER
+void en_sample_qdec(void);
+#ifdef __INDEX_HOMING
+void en_arm_index(void);
+uint8_t en_take_index(int16_t *index_cnt);
+#endif
+#endif
+#ifdef __MPG_WHEEL
+int16_t en_mpg_read_delta(void);
+#endif
+
+#ifdef __PROBE_LATCH
+void en_latch_encoders(void);
+void en_clear_probe_latch(void);
+uint8_t en_take_probe_latch(int32_t steps[]);
+#endif
 
 #endif	// End of include guard: ENCODER_H_ONCE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
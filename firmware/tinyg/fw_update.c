@@ -0,0 +1,238 @@
+/*
+ * fw_update.c - in-application firmware update staging via xboot
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	Fast firmware updates without the bootloader's serial protocol. The classic
+ *	path resets into xboot and uploads through its fixed-rate protocol with
+ *	per-page read-back - minutes per machine. This path instead receives the
+ *	new image over the application's own serial channel (already running at
+ *	the configured baud rate) on the binary block transport (gcode_binary.c),
+ *	stages it in the xboot app-temp region - the upper half of application
+ *	flash - and verifies the whole image with a single CRC16 pass:
+ *
+ *	  opcode 0x08 (FW_BEGIN)	start an image upload into the app-temp region
+ *	  opcode 0x09 (FW_DATA)		append payload bytes to the staged image
+ *	  opcode 0x0A (FW_COMMIT)	verify whole-image CRC16 and hand off to xboot
+ *
+ *	The COMMIT payload is the host-computed CRC16 (little endian, the avr-libc
+ *	_crc16_update polynomial, taken over the image padded with 0xFF to the
+ *	full app-temp size). On a match xboot_install_firmware() records the CRC
+ *	and a software reset hands off to the bootloader, which re-verifies and
+ *	copies the image into place at flash speed - no probe timeout, no serial
+ *	transfer in the bootloader at all. On any failure the running firmware is
+ *	untouched, since only the temp region was written.
+ *
+ *	Page writes go through the xboot jump table and stall the CPU for a few
+ *	ms each, so uploads are rejected while the machine is moving (same rule
+ *	as the job store) - unless __AB_STAGING is enabled. The app/app-temp
+ *	split already gives A/B slot semantics: the running image is slot A, the
+ *	temp region is slot B, and a slot is only ever activated by the verified
+ *	swap on reboot. With __AB_STAGING the upload proceeds while the machine
+ *	cuts: filled pages are handed to fw_update_callback(), which burns them
+ *	from the background loop only in instants when the stepper runtime is
+ *	quiet (between moves, in dwells, during holds), so the CPU stall never
+ *	lands under step generation. If a page is still waiting when the next
+ *	one fills, the DATA block is answered with STAT_EAGAIN and the host
+ *	retries it later - the serial link is the pacing mechanism. Only the
+ *	COMMIT still requires an idle machine, as it flushes synchronously and
+ *	ends in a reset request. Costs a second 512 byte page buffer.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "controller.h"
+#include "canonical_machine.h"
+#include "gcode_binary.h"
+#include "fw_update.h"
+#include "stepper.h"
+#include "hardware.h"
+#include "util.h"
+#include "xmega/xbootapi.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifdef __FAST_UPDATE
+
+static struct fwSingleton {
+	uint8_t uploading;				// true from FW_BEGIN to FW_COMMIT
+	uint16_t fill;					// bytes staged in the page buffer
+	uint32_t write_addr;			// app-temp offset for the next page write
+	uint8_t page[FW_UPDATE_PAGE];	// flash page staging buffer
+#ifdef __AB_STAGING
+	uint8_t staged;					// a filled page is waiting for the background writer
+	uint32_t staged_addr;			// app-temp offset of the waiting page
+	uint8_t staging[FW_UPDATE_PAGE];// page handed off to fw_update_callback()
+	stat_t status;					// sticky error from a failed background write
+#endif
+} fw;
+
+static stat_t _append(uint8_t c);
+static stat_t _exec_fw_begin(void);
+static stat_t _exec_fw_commit(uint8_t *payload, uint8_t len);
+
+/*
+ * fw_binary_block() - dispatch a firmware upload block from the binary channel
+ *
+ *	Payload excludes the opcode and trailing checksum (already verified).
+ */
+stat_t fw_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len)
+{
+	if ((opcode & 0x0F) == GC_BINARY_FW_BEGIN) {
+		return (_exec_fw_begin());
+	}
+	if (fw.uploading == false) {
+		return (STAT_COMMAND_NOT_ACCEPTED);		// DATA or COMMIT without BEGIN
+	}
+	if ((opcode & 0x0F) == GC_BINARY_FW_DATA) {
+#ifdef __AB_STAGING
+		if (fw.status != STAT_OK) {				// a background write failed
+			fw.uploading = false;
+			return (fw.status);
+		}
+		if ((fw.staged == true) && ((fw.fill + len) >= FW_UPDATE_PAGE)) {
+			return (STAT_EAGAIN);					// both buffers full - host retries the block
+		}
+#endif
+		for (uint8_t i=0; i<len; i++) {
+			ritorno(_append(payload[i]));
+		}
+		return (STAT_OK);
+	}
+	return (_exec_fw_commit(payload, len));
+}
+
+static stat_t _exec_fw_begin()
+{
+	uint8_t ver;
+
+#ifndef __AB_STAGING
+	if (cm_get_runtime_busy() == true) {		// page writes stall the CPU
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+#endif
+	if (xboot_get_api_version(&ver) != XB_SUCCESS) {
+		return (STAT_NO_SUCH_DEVICE);			// boot loader API not present
+	}
+	memset(&fw, 0, sizeof(fw));
+	fw.uploading = true;
+	return (STAT_OK);
+}
+
+static stat_t _append(uint8_t c)
+{
+	if (fw.write_addr + fw.fill >= XB_APP_TEMP_SIZE) {
+		fw.uploading = false;
+		return (STAT_FILE_SIZE_EXCEEDED);
+	}
+	fw.page[fw.fill++] = c;
+	if (fw.fill == FW_UPDATE_PAGE) {
+#ifdef __AB_STAGING
+		memcpy(fw.staging, fw.page, FW_UPDATE_PAGE);	// hand off to the background writer
+		fw.staged_addr = fw.write_addr;
+		fw.staged = true;
+#else
+		flash_scrub_rebase();
+		if (xboot_app_temp_write_page(fw.write_addr, fw.page, true) != XB_SUCCESS) {
+			fw.uploading = false;
+			return (STAT_INTERNAL_ERROR);
+		}
+#endif
+		fw.write_addr += FW_UPDATE_PAGE;
+		fw.fill = 0;
+	}
+	return (STAT_OK);
+}
+
+static stat_t _exec_fw_commit(uint8_t *payload, uint8_t len)
+{
+	uint16_t host_crc, image_crc;
+
+#ifdef __AB_STAGING
+	if (cm_get_runtime_busy() == true) {			// commit flushes synchronously
+		return (STAT_COMMAND_NOT_ACCEPTED);			// still uploading - host retries after the job
+	}
+#endif
+	fw.uploading = false;
+	if (len != sizeof(host_crc)) {
+		return (STAT_GCODE_GENERIC_INPUT_ERROR);	// COMMIT payload is the CRC16
+	}
+	memcpy(&host_crc, payload, sizeof(host_crc));	// little endian
+#ifdef __AB_STAGING
+	if (fw.staged == true) {						// drain the background writer first
+		fw.staged = false;
+		flash_scrub_rebase();
+		if (xboot_app_temp_write_page(fw.staged_addr, fw.staging, true) != XB_SUCCESS) {
+			return (STAT_INTERNAL_ERROR);
+		}
+	}
+	if (fw.status != STAT_OK) {
+		return (fw.status);
+	}
+#endif
+	if (fw.fill != 0) {								// flush the partial last page
+		memset(&fw.page[fw.fill], 0xFF, FW_UPDATE_PAGE - fw.fill);
+		flash_scrub_rebase();
+		if (xboot_app_temp_write_page(fw.write_addr, fw.page, true) != XB_SUCCESS) {
+			return (STAT_INTERNAL_ERROR);
+		}
+	}
+	if (xboot_app_temp_crc16(&image_crc) != XB_SUCCESS) {
+		return (STAT_INTERNAL_ERROR);
+	}
+	if (image_crc != host_crc) {
+		return (STAT_FIRMWARE_IMAGE_CRC_FAILED);	// running firmware is untouched
+	}
+	if (xboot_install_firmware(image_crc) != XB_SUCCESS) {
+		return (STAT_INTERNAL_ERROR);
+	}
+	hw_request_bootloader();		// reset; xboot re-verifies the CRC and installs
+	return (STAT_OK);
+}
+
+#ifdef __AB_STAGING
+/*
+ * fw_update_callback() - burn a staged page when the steppers are quiet
+ *
+ *	Runs from the controller background loop. The page write halts the CPU
+ *	for a few ms, so it is only issued when the stepper runtime is idle -
+ *	between moves, in dwells and during holds. Write failures are latched
+ *	in fw.status and reported on the next DATA or COMMIT block.
+ */
+stat_t fw_update_callback()
+{
+	if ((fw.staged == false) || (fw.status != STAT_OK)) {
+		return (STAT_NOOP);
+	}
+	if (st_runtime_isbusy() == true) {
+		return (STAT_NOOP);			// wait for a gap in step generation
+	}
+	flash_scrub_rebase();
+	if (xboot_app_temp_write_page(fw.staged_addr, fw.staging, true) != XB_SUCCESS) {
+		fw.status = STAT_INTERNAL_ERROR;
+	}
+	fw.staged = false;
+	return (STAT_OK);
+}
+#endif // __AB_STAGING
+
+#endif // __FAST_UPDATE
+
+#ifdef __cplusplus
+}
+#endif
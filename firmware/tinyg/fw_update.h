@@ -0,0 +1,45 @@
+/*
+ * fw_update.h - in-application firmware update staging via xboot
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef FW_UPDATE_H_ONCE
+#define FW_UPDATE_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define FW_UPDATE_PAGE 512				// app flash page size on the xmega ...A3 parts
+
+/*
+ * Global Scope Functions
+ */
+#ifdef __FAST_UPDATE
+
+stat_t fw_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len);
+#ifdef __AB_STAGING
+stat_t fw_update_callback(void);
+#endif
+
+#endif // __FAST_UPDATE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include guard: FW_UPDATE_H_ONCE
@@ -0,0 +1,178 @@
+/*
+ * gcode_binary.c - precompiled binary gcode block input
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Wire format
+ *
+ *	A binary block rides the existing line discipline: it is a "line" that starts
+ *	with SOH (0x01) and ends with the usual LF. The payload between the lead-in
+ *	and the LF is DLE-escaped so it can never contain NUL, LF, CR or DLE:
+ *	the host sends DLE (0x10) followed by (byte XOR 0x20) for those four values.
+ *
+ *	Unescaped payload layout:
+ *	  byte 0		opcode - 0 = G0, 1 = G1; with __RASTER, 2 and 3 are raster
+ *					scanline blocks handed to raster.c (see raster.c for layout);
+ *					with __JOB_STORE, 4..6 are job upload blocks handed to
+ *					job_store.c (see job_store.c for the upload protocol);
+ *					with __FAST_UPDATE, 8..10 are firmware upload blocks
+ *					handed to fw_update.c (see fw_update.c for the protocol)
+ *	  byte 1		word mask - bits 0..5 = X,Y,Z,A,B,C target words present,
+ *					bit 6 = F word present, bit 7 = line number present
+ *	  ...			for each set mask bit, in bit order: a packed little-endian
+ *					IEEE-754 float (line number is sent as a float as well)
+ *	  last byte		XOR checksum over all preceding payload bytes
+ *
+ *	Only straight-line motion is accepted - hosts pre-linearize arcs when
+ *	compiling a job to binary form. Everything else (tool, spindle, coolant,
+ *	offsets) still goes through the ASCII parsers, which remain fully available;
+ *	binary and ASCII blocks can be interleaved freely on the same link.
+ */
+
+#include "tinyg.h"			// #1
+#include "config.h"			// #2
+#include "controller.h"
+#include "gcode_parser.h"
+#include "gcode_binary.h"
+#include "raster.h"
+#include "job_store.h"
+#include "fw_update.h"
+#include "network.h"
+#include "canonical_machine.h"
+#include "util.h"
+#include "xio.h"			// for char definitions
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define GC_BINARY_WORDS (AXES+2)		// 6 axis words + F word + line number
+
+#if defined(__RASTER) || defined(__JOB_STORE) || defined(__FAST_UPDATE)
+#define GC_BINARY_BUF_SIZE 128			// sized for raster pixel / job / firmware upload chunks
+#else
+#define GC_BINARY_BUF_SIZE (2 + (GC_BINARY_WORDS * sizeof(float)) + 1)
+#endif
+
+static uint8_t _unescape(char_t *str, uint8_t *buf, uint8_t size);
+
+/*
+ * gc_binary_parser() - decode and execute a binary block
+ *
+ *	Entered from _command_dispatch() with the lead-in SOH still in place.
+ *	Returns status for the response handler; callers report errors the same
+ *	way they would for an ASCII gcode block.
+ */
+stat_t gc_binary_parser(char_t *block)
+{
+	uint8_t buf[GC_BINARY_BUF_SIZE];
+	uint8_t len, i, sum;
+	uint8_t opcode, mask;
+	uint8_t word = 2;					// offset of first packed word
+	float value;
+	float target[AXES];
+	float flags[AXES];
+	stat_t status;
+
+	// don't process gcode blocks if in alarmed state (same rule as gc_gcode_parser)
+	if (cm.machine_state == MACHINE_ALARM) return (STAT_MACHINE_ALARMED);
+
+	if ((len = _unescape(++block, buf, sizeof(buf))) < 3) {	// opcode + mask + checksum
+		return (STAT_GCODE_GENERIC_INPUT_ERROR);
+	}
+	for (i=0, sum=0; i < len-1; i++) { sum ^= buf[i]; }		// verify trailing checksum
+	if (sum != buf[len-1]) return (STAT_GCODE_GENERIC_INPUT_ERROR);
+
+	opcode = buf[0];
+	mask = buf[1];
+#ifdef __RASTER
+	if (((opcode & 0x0F) == GC_BINARY_RASTER_DATA) ||					// raster scanline blocks
+		((opcode & 0x0F) == GC_BINARY_RASTER_ARM)) {
+		return (raster_binary_block(opcode, &buf[1], len-2));
+	}
+#endif
+#ifdef __JOB_STORE
+	if (((opcode & 0x0F) >= GC_BINARY_JOB_BEGIN) &&						// job upload blocks
+		((opcode & 0x0F) <= GC_BINARY_JOB_COMMIT)) {
+		return (job_binary_block(opcode, &buf[1], len-2));
+	}
+#endif
+#ifdef __NET_SEGMENT_BUS
+	if ((opcode & 0x0F) == GC_BINARY_NET_SEG) {							// segment bus packets
+		return (net_binary_block(opcode, &buf[1], len-2));
+	}
+#endif
+#ifdef __FAST_UPDATE
+	if (((opcode & 0x0F) >= GC_BINARY_FW_BEGIN) &&						// firmware upload blocks
+		((opcode & 0x0F) <= GC_BINARY_FW_COMMIT)) {
+		return (fw_binary_block(opcode, &buf[1], len-2));
+	}
+#endif
+	if ((opcode & 0x0F) > 1) return (STAT_GCODE_COMMAND_UNSUPPORTED);	// G0/G1 only
+	for (i=0, sum=0; i < 8; i++) { if (mask & (1<<i)) sum++; }			// count packed words
+	if (len != (word + (sum * sizeof(float)) + 1)) {
+		return (STAT_GCODE_GENERIC_INPUT_ERROR);
+	}
+	clear_vector(target);
+	clear_vector(flags);
+
+	for (i=0; i < AXES; i++) {
+		if (mask & (1<<i)) {
+			memcpy(&target[i], &buf[word], sizeof(float));
+			flags[i] = true;
+			word += sizeof(float);
+		}
+	}
+	if (mask & (1<<AXES)) {									// F word
+		memcpy(&value, &buf[word], sizeof(float));
+		word += sizeof(float);
+		if ((status = cm_set_feed_rate(value)) != STAT_OK) return (status);
+	}
+	if (mask & (1<<(AXES+1))) {								// line number
+		memcpy(&value, &buf[word], sizeof(float));
+		cm_set_model_linenum((uint32_t)value);
+	}
+	if ((opcode & 0x0F) == 0) {
+		return (cm_straight_traverse(target, flags));		// G0
+	}
+	return (cm_straight_feed(target, flags));				// G1
+}
+
+/*
+ * _unescape() - undo DLE escaping in place into buf, return payload length
+ *
+ *	Stops at NUL (xio_gets strips the LF). Returns 0 on overrun or a
+ *	dangling escape so the caller rejects the block.
+ */
+static uint8_t _unescape(char_t *str, uint8_t *buf, uint8_t size)
+{
+	uint8_t len = 0;
+	uint8_t c;
+
+	while ((c = (uint8_t)*str++) != NUL) {
+		if (c == GC_BINARY_DLE) {
+			if ((c = (uint8_t)*str++) == NUL) return (0);
+			c ^= GC_BINARY_XOR;
+		}
+		if (len >= size) return (0);
+		buf[len++] = c;
+	}
+	return (len);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,66 @@
+/*
+ * gcode_binary.h - precompiled binary gcode block input
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Binary block input lets a host pre-translate straight-line gcode into packed
+ * records so the firmware skips _normalize_gcode_block() / _parse_gcode_block()
+ * entirely and calls the canonical machine directly. See gcode_binary.c for the
+ * wire format.
+ */
+
+#ifndef GCODE_BINARY_H_ONCE
+#define GCODE_BINARY_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define GC_BINARY_LEADIN 0x01			// SOH marks a binary block line
+#define GC_BINARY_DLE 0x10				// escape character
+#define GC_BINARY_XOR 0x20				// escape modifier
+
+#ifdef __RASTER
+#define GC_BINARY_RASTER_DATA 0x02		// opcode: append packed pixels to the raster staging buffer
+#define GC_BINARY_RASTER_ARM  0x03		// opcode: arm the staged scanline (payload = pixel pitch float)
+#endif
+
+#ifdef __JOB_STORE
+#define GC_BINARY_JOB_BEGIN  0x04		// opcode: invalidate the stored job and start an upload
+#define GC_BINARY_JOB_DATA   0x05		// opcode: append payload bytes to the job store
+#define GC_BINARY_JOB_COMMIT 0x06		// opcode: terminate, flush and validate the stored job
+#endif
+
+#ifdef __NET_SEGMENT_BUS
+#define GC_BINARY_NET_SEG    0x07		// opcode: synchronized motion segment from the bus master
+#endif
+
+#ifdef __FAST_UPDATE
+#define GC_BINARY_FW_BEGIN   0x08		// opcode: start a firmware upload into the app-temp region
+#define GC_BINARY_FW_DATA    0x09		// opcode: append payload bytes to the staged image
+#define GC_BINARY_FW_COMMIT  0x0A		// opcode: verify whole-image CRC16 and hand off to xboot
+#endif
+
+/*
+ * Global Scope Functions
+ */
+stat_t gc_binary_parser(char_t *block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include guard: GCODE_BINARY_H_ONCE
@@ -33,18 +33,195 @@ struct gcodeParserSingleton {	 	  // struct to manage globals
 	uint8_t modals[MODAL_GROUP_COUNT];// collects modal groups in a block
 }; struct gcodeParserSingleton gp;
 
+#ifdef __MODAL_COMPRESS
+static struct gcModalCache {		  // raw words from preceding compressible blocks
+	float feed_rate;				  // F word as given (pre-conversion units)
+	float spindle_speed;			  // S word as given
+	float target[AXES];				  // axis words as given
+	uint8_t feed_seen;				  // word has been cached since the last invalidation
+	uint8_t speed_seen;
+	uint8_t axis_seen[AXES];
+} mc;
+#endif
+
 // local helper functions and macros
+#ifdef __INLINE_NORMALIZE
+static void _process_comment(char_t *com);
+#else
 static void _normalize_gcode_block(char_t *str, char_t **com, char_t **msg, uint8_t *block_delete_flag);
+#endif
 static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value);
 static stat_t _point(float value);
 static stat_t _validate_gcode_block(void);
 static stat_t _parse_gcode_block(char_t *line);	// Parse the block into the GN/GF structs
 static stat_t _execute_gcode_block(void);		// Execute the gcode block
+#ifdef __MODAL_COMPRESS
+static void _compress_modal_block(void);		// Strip words that restate current modal values
+#endif
 
 #define SET_MODAL(m,parm,val) ({cm.gn.parm=val; cm.gf.parm=1; gp.modals[m]+=1; break;})
 #define SET_NON_MODAL(parm,val) ({cm.gn.parm=val; cm.gf.parm=1; break;})
 #define EXEC_FUNC(f,v) if((uint8_t)cm.gf.v != false) { status = f(cm.gn.v);}
 
+#ifdef __GC_TABLE
+#include <stddef.h>					// for offsetof()
+/*
+ *	G/M word dispatch tables
+ *
+ *	Every G and M word handler in this parser reduces to the same action: store
+ *	a value into one cm.gn field, raise the matching cm.gf flag, and count the
+ *	word against its modal group. So the switch chains collapse into a PROGMEM
+ *	table of (number, sub-number, modal group, value, field offset) rows and
+ *	dispatch becomes a bounded probe: rows are sorted by number and the scan
+ *	stops at the first row past the target. The decimal sub-number is only
+ *	isolated (float math in _point) when a candidate row actually discriminates
+ *	on it, which keeps G0/G1 - the common words - integer-only.
+ *
+ *	GC_POINT_ANY rows ignore the sub-number, preserving the old switch behavior
+ *	for words that never dispatched on one (e.g. G1.5 parses as G1).
+ *	GC_WORD_IGNORED rows accept and discard the word (G40, G49).
+ */
+
+#define GC_POINT_ANY	((uint8_t)0xFF)		// row matches any decimal sub-number
+#define GC_GROUP_NONE	((uint8_t)0xFF)		// non-modal word - no modal group to count
+#define GC_WORD_IGNORED	((uint16_t)0xFFFF)	// word is accepted and ignored
+#define GC_TABLE_END	((uint8_t)0xFF)		// terminates a table (no G or M number gets here)
+
+typedef struct gcDispatch {					// one G or M word dispatch row
+	uint8_t num;							// integer part of the G or M word
+	uint8_t point;							// decimal sub-number, or GC_POINT_ANY
+	uint8_t modal_group;					// modal group to count, or GC_GROUP_NONE
+	uint8_t set_value;						// value stored into the gn field
+	uint16_t gn_offset;						// offset of the target field in cm.gn (and its flag in cm.gf)
+} gcDispatch_t;
+
+#define GC_MODAL(num, pnt, group, parm, val) { num, pnt, group, val, offsetof(GCodeInput_t, parm) }
+#define GC_NON_MODAL(num, pnt, parm, val) { num, pnt, GC_GROUP_NONE, val, offsetof(GCodeInput_t, parm) }
+#define GC_IGNORED(num) { num, GC_POINT_ANY, GC_GROUP_NONE, 0, GC_WORD_IGNORED }
+
+static const gcDispatch_t gc_gword_table[] PROGMEM = {
+	GC_MODAL	( 0, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE),
+	GC_MODAL	( 1, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED),
+	GC_MODAL	( 2, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC),
+	GC_MODAL	( 3, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC),
+	GC_NON_MODAL( 4, GC_POINT_ANY, next_action, NEXT_ACTION_DWELL),
+#ifdef __CUBIC_SPLINE
+	GC_MODAL	( 5, 0, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CUBIC_SPLINE),
+	GC_MODAL	( 5, 1, MODAL_GROUP_G1, motion_mode, MOTION_MODE_QUADRATIC_SPLINE),
+#endif
+	GC_MODAL	(10, GC_POINT_ANY, MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA),
+	GC_MODAL	(17, GC_POINT_ANY, MODAL_GROUP_G2, select_plane, CANON_PLANE_XY),
+	GC_MODAL	(18, GC_POINT_ANY, MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ),
+	GC_MODAL	(19, GC_POINT_ANY, MODAL_GROUP_G2, select_plane, CANON_PLANE_YZ),
+	GC_MODAL	(20, GC_POINT_ANY, MODAL_GROUP_G6, units_mode, INCHES),
+	GC_MODAL	(21, GC_POINT_ANY, MODAL_GROUP_G6, units_mode, MILLIMETERS),
+	GC_MODAL	(28, 0, MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G28_POSITION),
+	GC_MODAL	(28, 1, MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G28_POSITION),
+	GC_NON_MODAL(28, 2, next_action, NEXT_ACTION_SEARCH_HOME),
+	GC_NON_MODAL(28, 3, next_action, NEXT_ACTION_SET_ABSOLUTE_ORIGIN),
+	GC_NON_MODAL(28, 4, next_action, NEXT_ACTION_HOMING_NO_SET),
+	GC_MODAL	(30, 0, MODAL_GROUP_G0, next_action, NEXT_ACTION_GOTO_G30_POSITION),
+	GC_MODAL	(30, 1, MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_G30_POSITION),
+#ifdef __SPINDLE_SYNC
+	GC_MODAL	(33, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_SPINDLE_SYNC_FEED),
+#endif
+	GC_NON_MODAL(38, 2, next_action, NEXT_ACTION_STRAIGHT_PROBE),
+	GC_IGNORED	(40),					// ignore cancel cutter radius compensation
+#ifdef __TOOL_TABLE
+	GC_MODAL	(43, GC_POINT_ANY, MODAL_GROUP_G8, tool_length_enable, true),
+	GC_MODAL	(49, GC_POINT_ANY, MODAL_GROUP_G8, tool_length_enable, false),
+#else
+	GC_IGNORED	(49),					// ignore cancel tool length offset comp.
+#endif
+	GC_NON_MODAL(53, GC_POINT_ANY, absolute_override, true),
+	GC_MODAL	(54, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G54),
+	GC_MODAL	(55, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G55),
+	GC_MODAL	(56, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G56),
+	GC_MODAL	(57, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G57),
+	GC_MODAL	(58, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G58),
+	GC_MODAL	(59, GC_POINT_ANY, MODAL_GROUP_G12, coord_system, G59),
+	GC_MODAL	(61, 0, MODAL_GROUP_G13, path_control, PATH_EXACT_PATH),
+	GC_MODAL	(61, 1, MODAL_GROUP_G13, path_control, PATH_EXACT_STOP),
+	GC_MODAL	(64, GC_POINT_ANY, MODAL_GROUP_G13, path_control, PATH_CONTINUOUS),
+#ifdef __G68_ROTATION
+	GC_MODAL	(68, GC_POINT_ANY, MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ROTATION),
+	GC_MODAL	(69, GC_POINT_ANY, MODAL_GROUP_G0, next_action, NEXT_ACTION_CANCEL_ROTATION),
+#endif
+	GC_MODAL	(80, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CANCEL_MOTION_MODE),
+#ifdef __CANNED_CYCLES
+	GC_MODAL	(81, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CANNED_CYCLE_81),
+	GC_MODAL	(82, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CANNED_CYCLE_82),
+	GC_MODAL	(83, GC_POINT_ANY, MODAL_GROUP_G1, motion_mode, MOTION_MODE_CANNED_CYCLE_83),
+#endif
+	GC_MODAL	(90, 0, MODAL_GROUP_G3, distance_mode, ABSOLUTE_MODE),
+	GC_MODAL	(90, 1, MODAL_GROUP_G3, arc_distance_mode, ABSOLUTE_MODE),
+	GC_MODAL	(91, 0, MODAL_GROUP_G3, distance_mode, INCREMENTAL_MODE),
+	GC_MODAL	(91, 1, MODAL_GROUP_G3, arc_distance_mode, INCREMENTAL_MODE),
+	GC_MODAL	(92, 0, MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ORIGIN_OFFSETS),
+	GC_NON_MODAL(92, 1, next_action, NEXT_ACTION_RESET_ORIGIN_OFFSETS),
+	GC_NON_MODAL(92, 2, next_action, NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS),
+	GC_NON_MODAL(92, 3, next_action, NEXT_ACTION_RESUME_ORIGIN_OFFSETS),
+	GC_MODAL	(93, GC_POINT_ANY, MODAL_GROUP_G5, feed_rate_mode, INVERSE_TIME_MODE),
+	GC_MODAL	(94, GC_POINT_ANY, MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_MINUTE_MODE),
+//	GC_MODAL	(95, GC_POINT_ANY, MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_REVOLUTION_MODE),
+#ifdef __SPINDLE_CSS
+	GC_MODAL	(96, GC_POINT_ANY, MODAL_GROUP_G14, spindle_speed_mode, SPINDLE_CSS_MODE),
+	GC_MODAL	(97, GC_POINT_ANY, MODAL_GROUP_G14, spindle_speed_mode, SPINDLE_RPM_MODE),
+#endif
+	{ GC_TABLE_END, 0, 0, 0, 0 }
+};
+
+static const gcDispatch_t gc_mword_table[] PROGMEM = {
+	GC_MODAL	( 0, GC_POINT_ANY, MODAL_GROUP_M4, program_flow, PROGRAM_STOP),
+	GC_MODAL	( 1, GC_POINT_ANY, MODAL_GROUP_M4, program_flow, PROGRAM_STOP),
+	GC_MODAL	( 2, GC_POINT_ANY, MODAL_GROUP_M4, program_flow, PROGRAM_END),
+	GC_MODAL	( 3, GC_POINT_ANY, MODAL_GROUP_M7, spindle_mode, SPINDLE_CW),
+	GC_MODAL	( 4, GC_POINT_ANY, MODAL_GROUP_M7, spindle_mode, SPINDLE_CCW),
+	GC_MODAL	( 5, GC_POINT_ANY, MODAL_GROUP_M7, spindle_mode, SPINDLE_OFF),
+	GC_NON_MODAL( 6, GC_POINT_ANY, tool_change, true),
+	GC_MODAL	( 7, GC_POINT_ANY, MODAL_GROUP_M8, mist_coolant, true),
+	GC_MODAL	( 8, GC_POINT_ANY, MODAL_GROUP_M8, flood_coolant, true),
+	GC_MODAL	( 9, GC_POINT_ANY, MODAL_GROUP_M8, flood_coolant, false),
+	GC_MODAL	(30, GC_POINT_ANY, MODAL_GROUP_M4, program_flow, PROGRAM_END),
+	GC_MODAL	(48, GC_POINT_ANY, MODAL_GROUP_M9, override_enables, true),
+	GC_MODAL	(49, GC_POINT_ANY, MODAL_GROUP_M9, override_enables, false),
+	GC_MODAL	(50, GC_POINT_ANY, MODAL_GROUP_M9, feed_rate_override_enable, true),	// conditionally true
+	GC_MODAL	(51, GC_POINT_ANY, MODAL_GROUP_M9, spindle_override_enable, true),		// conditionally true
+	GC_MODAL	(60, GC_POINT_ANY, MODAL_GROUP_M4, program_flow, PROGRAM_STOP),
+	{ GC_TABLE_END, 0, 0, 0, 0 }
+};
+
+/*
+ * _dispatch_word() - probe a dispatch table and apply the matching row
+ */
+
+static stat_t _dispatch_word(const gcDispatch_t *row, float value, stat_t fail_status)
+{
+	uint8_t num = (uint8_t)value;
+	uint8_t point = 0;
+	uint8_t point_isolated = false;
+
+	for ( ; ; row++) {
+		uint8_t row_num = pgm_read_byte(&row->num);
+		if (row_num > num) { return (fail_status);}		// sorted table - ran past the target (or hit GC_TABLE_END)
+		if (row_num != num) { continue;}
+		uint8_t row_point = pgm_read_byte(&row->point);
+		if (row_point != GC_POINT_ANY) {
+			if (!point_isolated) { point = _point(value); point_isolated = true;}
+			if (row_point != point) { continue;}
+		}
+		uint16_t offset = pgm_read_word(&row->gn_offset);
+		if (offset != GC_WORD_IGNORED) {
+			*((uint8_t *)&cm.gn + offset) = pgm_read_byte(&row->set_value);
+			*((uint8_t *)&cm.gf + offset) = true;
+		}
+		uint8_t group = pgm_read_byte(&row->modal_group);
+		if (group != GC_GROUP_NONE) { gp.modals[group] += 1;}
+		return (STAT_OK);
+	}
+}
+#endif // __GC_TABLE
+
 /*
  * gc_gcode_parser() - parse a block (line) of gcode
  *
@@ -52,6 +229,23 @@ static stat_t _execute_gcode_block(void);		// Execute the gcode block
  */
 stat_t gc_gcode_parser(char_t *block)
 {
+#ifdef __INLINE_NORMALIZE
+	// Normalization is folded into _get_next_gcode_word() - the block is parsed raw
+	// and each byte is classified once, as it is consumed. Comments and messages are
+	// processed by the tokenizer when it reaches them, so a message behind a
+	// malformed word is dropped with the rest of the block (the old separate pass
+	// queued it regardless).
+
+	// don't process Gcode blocks if in alarmed state
+	if (cm.machine_state == MACHINE_ALARM) return (STAT_MACHINE_ALARMED);
+
+	// Block delete omits the line if a / char is present in the first space
+	// For now this is unconditional and will always delete
+	if (*block == '/') {
+		return (STAT_NOOP);
+	}
+	return(_parse_gcode_block(block));
+#else
 	char_t *str = block;					// gcode command or NUL string
 	char_t none = NUL;
 	char_t *com = &none;					// gcode comment or NUL string
@@ -76,8 +270,10 @@ stat_t gc_gcode_parser(char_t *block)
 	}
 
 	return(_parse_gcode_block(block));
+#endif // __INLINE_NORMALIZE
 }
 
+#ifndef __INLINE_NORMALIZE
 /*
  * _normalize_gcode_block() - normalize a block (line) of gcode in place
  *
@@ -161,7 +357,92 @@ static void _normalize_gcode_block(char_t *str, char_t **com, char_t **msg, uint
 		}
 	}
 }
+#endif // __INLINE_NORMALIZE
+
+#ifdef __INLINE_NORMALIZE
+/*
+ * _get_next_gcode_word() - get gcode word consisting of a letter and a value
+ *
+ *	Normalizing tokenizer. The block arrives raw and each byte is classified once,
+ *	as it is consumed: letters are upper-cased at the point of use, whitespace and
+ *	invalid characters are skipped, and a comment terminates the command. The value
+ *	characters are compacted in place across any embedded whitespace - exactly the
+ *	squeeze the old rewrite pass performed - so strtof() sees one contiguous number.
+ *	'+' is stripped rather than kept, matching the old pass (so "X1+2" is 12 and
+ *	"1E+3" reads as "1E3"). The old G0X-reads-as-hexadecimal trap is gone by
+ *	construction: 'X' terminates the value region before strtof() can see "0X".
+ *	The old Octal-stripping pass was protecting against the same thing - strtof()
+ *	itself never treats leading zeros as Octal.
+ */
+static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value)
+{
+	char *rd = *pstr;
+
+	// find the next word letter, stripping invalid characters along the way
+	for (;; rd++) {
+		if (*rd == NUL) { *pstr = rd; return (STAT_COMPLETE);}	// no more words to process
+		if ((*rd == '(') || (*rd == ';')) {						// comment terminates the command
+			_process_comment(rd+1);
+			*pstr = rd;
+			return (STAT_COMPLETE);
+		}
+		if (isalpha(*rd)) { break;}
+		if ((isdigit(*rd)) || (*rd == '-') || (*rd == '.')) {	// a value with no letter to bind to
+			*pstr = rd;
+			return (STAT_INVALID_OR_MALFORMED_COMMAND);
+		}
+		// whitespace and all other characters are stripped (skipped)
+	}
+	*letter = toupper(*rd++);
+
+	// collect the value region, compacting it in place. Any letter but the
+	// exponent E - or a comment, or the end of the block - terminates the region
+	char *p = rd;								// start of the compacted value
+	char *wr = rd;
+	for (;; rd++) {
+		char c = *rd;
+		if ((isdigit(c)) || (c == '-') || (c == '.')) { *(wr++) = c;}
+		else if ((c == 'e') || (c == 'E')) { *(wr++) = 'E';}
+		else if ((c == NUL) || (c == '(') || (c == ';') || (isalpha(c))) { break;}
+		// whitespace and all other characters are stripped (skipped)
+	}
+
+	// get-value: terminate the compacted region so strtof() can't read past it
+	// into bytes the compaction left behind
+	char *end;
+	char saved = *wr;
+	*wr = NUL;
+#ifdef __FAST_ATOF
+	*value = fatof(p, &end);
+#else
+	*value = strtof(p, &end);
+#endif
+	*wr = saved;
+	if (end == p)
+        return(STAT_BAD_NUMBER_FORMAT); // more robust test then checking for value=0;
+	*pstr = (end == wr) ? rd : end;		// a partly-consumed region leaves its tail for the next word
+	return (STAT_OK);			// pointer points to next character after the word
+}
+
+/*
+ * _process_comment() - handle a comment and queue an embedded message, if any
+ */
+static void _process_comment(char_t *com)
+{
+	char_t *rd = com;
+	while (isspace(*rd)) { rd++; }			// skip any leading spaces before "msg"
+	if ((tolower(*rd) == 'm') && (tolower(*(rd+1)) == 's') && (tolower(*(rd+2)) == 'g')) {
+		char_t *msg = rd+3;
+		for (rd = msg; *rd != NUL; rd++) {
+			if (*rd == ')') { *rd = NUL; break;}	// NUL terminate on trailing parenthesis, if any
+		}
+		if (*msg != NUL) {
+			(void)cm_message(msg);			// queue the message
+		}
+	}
+}
 
+#else // not __INLINE_NORMALIZE
 /*
  * _get_next_gcode_word() - get gcode word consisting of a letter and a value
  *
@@ -189,12 +470,17 @@ static stat_t _get_next_gcode_word(char **pstr, char *letter, float *value)
 
 	// get-value general case
 	char *end;
+#ifdef __FAST_ATOF
+	*value = fatof(*pstr, &end);
+#else
 	*value = strtof(*pstr, &end);
+#endif
 	if(end == *pstr)
         return(STAT_BAD_NUMBER_FORMAT); // more robust test then checking for value=0;
 	*pstr = end;
 	return (STAT_OK);			// pointer points to next character after the word
 }
+#endif // __INLINE_NORMALIZE
 
 /*
  * _point() - isolate the decimal point value as an integer
@@ -256,12 +542,26 @@ static stat_t _parse_gcode_block(char_t *buf)
 	while((status = _get_next_gcode_word(&pstr, &letter, &value)) == STAT_OK) {
 		switch(letter) {
 			case 'G':
+#ifdef __GC_TABLE
+			status = _dispatch_word(gc_gword_table, value, STAT_GCODE_COMMAND_UNSUPPORTED);
+			break;
+#else
 			switch((uint8_t)value) {
 				case 0:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_TRAVERSE);
 				case 1:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_STRAIGHT_FEED);
 				case 2:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CW_ARC);
 				case 3:  SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CCW_ARC);
 				case 4:  SET_NON_MODAL (next_action, NEXT_ACTION_DWELL);
+#ifdef __CUBIC_SPLINE
+				case 5: {
+					switch (_point(value)) {
+						case 0: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_CUBIC_SPLINE);
+						case 1: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_QUADRATIC_SPLINE);
+						default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
+					}
+					break;
+				}
+#endif
 				case 10: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_COORD_DATA);
 				case 17: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XY);
 				case 18: SET_MODAL (MODAL_GROUP_G2, select_plane, CANON_PLANE_XZ);
@@ -287,6 +587,9 @@ static stat_t _parse_gcode_block(char_t *buf)
 					}
 					break;
 				}
+#ifdef __SPINDLE_SYNC
+				case 33: SET_MODAL (MODAL_GROUP_G1, motion_mode, MOTION_MODE_SPINDLE_SYNC_FEED);
+#endif
 				case 38: {
 					switch (_point(value)) {
 						case 2: SET_NON_MODAL (next_action, NEXT_ACTION_STRAIGHT_PROBE);
@@ -295,7 +598,12 @@ static stat_t _parse_gcode_block(char_t *buf)
 					break;
 				}
 				case 40: break;	// ignore cancel cutter radius compensation
+#ifdef __TOOL_TABLE
+				case 43: SET_MODAL (MODAL_GROUP_G8, tool_length_enable, true);
+				case 49: SET_MODAL (MODAL_GROUP_G8, tool_length_enable, false);
+#else
 				case 49: break;	// ignore cancel tool length offset comp.
+#endif
 				case 53: SET_NON_MODAL (absolute_override, true);
 				case 54: SET_MODAL (MODAL_GROUP_G12, coord_system, G54);
 				case 55: SET_MODAL (MODAL_GROUP_G12, coord_system, G55);
@@ -312,7 +620,16 @@ static stat_t _parse_gcode_block(char_t *buf)
 					break;
 				}
 				case 64: SET_MODAL (MODAL_GROUP_G13,path_control, PATH_CONTINUOUS);
+#ifdef __G68_ROTATION
+				case 68: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_SET_ROTATION);
+				case 69: SET_MODAL (MODAL_GROUP_G0, next_action, NEXT_ACTION_CANCEL_ROTATION);
+#endif
 				case 80: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANCEL_MOTION_MODE);
+#ifdef __CANNED_CYCLES
+				case 81: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_81);
+				case 82: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_82);
+				case 83: SET_MODAL (MODAL_GROUP_G1, motion_mode,  MOTION_MODE_CANNED_CYCLE_83);
+#endif
 //				case 90: SET_MODAL (MODAL_GROUP_G3, distance_mode, ABSOLUTE_MODE);
 //				case 91: SET_MODAL (MODAL_GROUP_G3, distance_mode, INCREMENTAL_MODE);
 				case 90: {
@@ -344,11 +661,20 @@ static stat_t _parse_gcode_block(char_t *buf)
 				case 93: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, INVERSE_TIME_MODE);
 				case 94: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_MINUTE_MODE);
 //				case 95: SET_MODAL (MODAL_GROUP_G5, feed_rate_mode, UNITS_PER_REVOLUTION_MODE);
+#ifdef __SPINDLE_CSS
+				case 96: SET_MODAL (MODAL_GROUP_G14, spindle_speed_mode, SPINDLE_CSS_MODE);
+				case 97: SET_MODAL (MODAL_GROUP_G14, spindle_speed_mode, SPINDLE_RPM_MODE);
+#endif
 				default: status = STAT_GCODE_COMMAND_UNSUPPORTED;
 			}
 			break;
+#endif // __GC_TABLE
 
 			case 'M':
+#ifdef __GC_TABLE
+			status = _dispatch_word(gc_mword_table, value, STAT_MCODE_COMMAND_UNSUPPORTED);
+			break;
+#else
 			switch((uint8_t)value) {
 				case 0: case 1: case 60:
 						SET_MODAL (MODAL_GROUP_M4, program_flow, PROGRAM_STOP);
@@ -368,11 +694,21 @@ static stat_t _parse_gcode_block(char_t *buf)
 				default: status = STAT_MCODE_COMMAND_UNSUPPORTED;
 			}
 			break;
+#endif // __GC_TABLE
 
 			case 'T': SET_NON_MODAL (tool_select, (uint8_t)trunc(value));
+#ifdef __TOOL_TABLE
+			case 'H': SET_NON_MODAL (h_number, (uint8_t)trunc(value));
+#endif
 			case 'F': SET_NON_MODAL (feed_rate, value);
 			case 'P': SET_NON_MODAL (parameter, value);				// used for dwell time, G10 coord select, rotations
+#ifdef __CANNED_CYCLES
+			case 'Q': SET_NON_MODAL (q_parameter, value);			// used for G83 peck depth
+#endif
 			case 'S': SET_NON_MODAL (spindle_speed, value);
+#ifdef __SPINDLE_CSS
+			case 'D': SET_NON_MODAL (css_max_rpm, value);		// RPM cap for G96
+#endif
 			case 'X': SET_NON_MODAL (target[AXIS_X], value);
 			case 'Y': SET_NON_MODAL (target[AXIS_Y], value);
 			case 'Z': SET_NON_MODAL (target[AXIS_Z], value);
@@ -394,9 +730,80 @@ static stat_t _parse_gcode_block(char_t *buf)
 	}
 	if ((status != STAT_OK) && (status != STAT_COMPLETE)) return (status);
 	ritorno(_validate_gcode_block());
+#ifdef __MODAL_COMPRESS
+	_compress_modal_block();				// strip words that restate current modal values
+#endif
 	return (_execute_gcode_block());		// if successful execute the block
 }
 
+#ifdef __MODAL_COMPRESS
+/*
+ * _compress_modal_block() - drop words that restate current modal values
+ *
+ *	CAM output commonly repeats the F word and unchanged axis coordinates on
+ *	every line. Raw words are compared against the previous blocks and their gf
+ *	flags cleared when nothing changed - the EXEC_FUNC and set_model_target
+ *	mechanics already skip unflagged words, so compression rides the existing
+ *	path and spares the state writes and per-axis offset/unit conversions in
+ *	the canonical machine.
+ *
+ *	Raw words are only comparable while their interpretation is stable. The
+ *	cache is restarted by any block that is not a plain straight motion in
+ *	absolute distance mode: units, distance mode, coordinate system, plane,
+ *	offsets, overrides, program stops/ends, homing, probes and G10/G92 all
+ *	invalidate it, as does inverse time mode (where F is per-block by
+ *	definition). Arcs are left uncompressed - their endpoint words interact
+ *	with radius-mode resolution.
+ */
+static void _compress_modal_block()
+{
+	if ((cm.gn.next_action != NEXT_ACTION_DEFAULT) ||
+		((cm.gn.motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) &&
+		 (cm.gn.motion_mode != MOTION_MODE_STRAIGHT_FEED)) ||
+		((cm.gf.units_mode | cm.gf.distance_mode | cm.gf.coord_system |
+		  cm.gf.select_plane | cm.gf.absolute_override | cm.gf.feed_rate_mode |
+		  cm.gf.program_flow | cm.gf.tool_change | cm.gf.override_enables |
+		  cm.gf.feed_rate_override_enable | cm.gf.traverse_override_enable |
+		  cm.gf.spindle_override_enable) != false) ||
+		((uint8_t)cm.gf.feed_rate_override_factor != false) ||
+		((uint8_t)cm.gf.traverse_override_factor != false) ||
+		((uint8_t)cm.gf.spindle_override_factor != false) ||
+		(cm_get_distance_mode(MODEL) != ABSOLUTE_MODE) ||
+		(cm_get_feed_rate_mode(MODEL) == INVERSE_TIME_MODE)) {
+		memset(&mc, 0, sizeof(mc));			// not a compressible block - restart the cache
+		return;
+	}
+	if ((uint8_t)cm.gf.feed_rate != false) {
+		if ((mc.feed_seen) && (fp_EQ(cm.gn.feed_rate, mc.feed_rate))) {
+			cm.gf.feed_rate = false;		// F restates the current rate - drop it
+		} else {
+			mc.feed_rate = cm.gn.feed_rate;
+			mc.feed_seen = true;
+		}
+	}
+#ifdef __SPINDLE_CSS
+	if ((uint8_t)cm.gf.spindle_speed_mode != false) { mc.speed_seen = false;}	// S changes meaning across G96/G97
+#endif
+	if ((uint8_t)cm.gf.spindle_speed != false) {
+		if ((mc.speed_seen) && (fp_EQ(cm.gn.spindle_speed, mc.spindle_speed))) {
+			cm.gf.spindle_speed = false;	// S restates the current speed - drop it
+		} else {
+			mc.spindle_speed = cm.gn.spindle_speed;
+			mc.speed_seen = true;
+		}
+	}
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if ((uint8_t)cm.gf.target[axis] == false) continue;
+		if ((mc.axis_seen[axis]) && (fp_EQ(cm.gn.target[axis], mc.target[axis]))) {
+			cm.gf.target[axis] = false;		// coordinate is unchanged - skip the axis
+		} else {
+			mc.target[axis] = cm.gn.target[axis];
+			mc.axis_seen[axis] = true;
+		}
+	}
+}
+#endif // __MODAL_COMPRESS
+
 /*
  * _execute_gcode_block() - execute parsed block
  *
@@ -445,6 +852,10 @@ static stat_t _execute_gcode_block()
 	EXEC_FUNC(cm_set_feed_rate, feed_rate);
 	EXEC_FUNC(cm_feed_rate_override_factor, feed_rate_override_factor);
 	EXEC_FUNC(cm_traverse_override_factor, traverse_override_factor);
+#ifdef __SPINDLE_CSS
+	EXEC_FUNC(cm_set_css_max_rpm, css_max_rpm);				// cap must precede the mode switch
+	EXEC_FUNC(cm_set_spindle_speed_mode, spindle_speed_mode);	// mode must precede the S word
+#endif
 	EXEC_FUNC(cm_set_spindle_speed, spindle_speed);
 	EXEC_FUNC(cm_spindle_override_factor, spindle_override_factor);
 	EXEC_FUNC(cm_select_tool, tool_select);					// tool_select is where it's written
@@ -463,9 +874,23 @@ static stat_t _execute_gcode_block()
 	EXEC_FUNC(cm_select_plane, select_plane);
 	EXEC_FUNC(cm_set_units_mode, units_mode);
 	//--> cutter radius compensation goes here
+#ifdef __TOOL_TABLE
+	if (cm.gf.tool_length_enable == true) {					// G43 Hn / G49 tool length compensation
+		uint8_t h = (cm.gf.h_number == true) ? cm.gn.h_number :
+			((cm.gf.tool_select == true) ? cm.gn.tool_select : cm.gm.tool);
+		ritorno(cm_set_tool_length_offset(cm.gn.tool_length_enable, h));
+	}
+#else
 	//--> cutter length compensation goes here
+#endif
 	EXEC_FUNC(cm_set_coord_system, coord_system);
 	EXEC_FUNC(cm_set_path_control, path_control);
+#ifdef __PATH_CONTROL
+	if ((cm.gf.path_control == true) && (cm.gn.path_control == PATH_CONTINUOUS)) {
+		// G64 P<tol> sets the blend tolerance; a bare G64 resets it (see cm_set_path_tolerance)
+		ritorno(cm_set_path_tolerance((cm.gf.parameter == true) ? cm.gn.parameter : 0));
+	}
+#endif
 	EXEC_FUNC(cm_set_distance_mode, distance_mode);
 	//--> set retract mode goes here
 
@@ -486,6 +911,11 @@ static stat_t _execute_gcode_block()
 		case NEXT_ACTION_RESET_ORIGIN_OFFSETS: { status = cm_reset_origin_offsets(); break;}
 		case NEXT_ACTION_SUSPEND_ORIGIN_OFFSETS: { status = cm_suspend_origin_offsets(); break;}
 		case NEXT_ACTION_RESUME_ORIGIN_OFFSETS: { status = cm_resume_origin_offsets(); break;}
+#ifdef __G68_ROTATION
+		case NEXT_ACTION_SET_ROTATION:																			// G68
+			{ status = cm_set_rotation(cm.gn.arc_radius, fp_TRUE(cm.gf.arc_radius), cm.gn.target, cm.gf.target); break;}
+		case NEXT_ACTION_CANCEL_ROTATION: { status = cm_cancel_rotation(); break;}									// G69
+#endif
 
 		case NEXT_ACTION_DEFAULT: {
 			cm_set_absolute_override(MODEL, cm.gn.absolute_override);	// apply override setting to gm struct
@@ -497,6 +927,23 @@ static stat_t _execute_gcode_block()
 					// gf.radius sets radius mode if radius was collected in gn
 					{ status = cm_arc_feed(cm.gn.target, cm.gf.target, cm.gn.arc_offset[0], cm.gn.arc_offset[1],
 										   cm.gn.arc_offset[2], cm.gn.arc_radius, cm.gn.motion_mode); break;}
+#ifdef __CUBIC_SPLINE
+				case MOTION_MODE_CUBIC_SPLINE: case MOTION_MODE_QUADRATIC_SPLINE:
+					// I,J offset the first control point from the start; P,Q offset the second from the end (G5 only)
+					{ status = cm_spline_feed(cm.gn.target, cm.gf.target, cm.gn.arc_offset[0], cm.gn.arc_offset[1],
+											  cm.gn.parameter, cm.gn.q_parameter, cm.gn.motion_mode); break;}
+#endif
+#ifdef __SPINDLE_SYNC
+				case MOTION_MODE_SPINDLE_SYNC_FEED:
+					// the pitch is the K word - required on every G33 block
+					{ status = cm_spindle_sync_feed(cm.gn.target, cm.gf.target, cm.gn.arc_offset[2]); break;}
+#endif
+#ifdef __CANNED_CYCLES
+				case MOTION_MODE_CANNED_CYCLE_81:
+				case MOTION_MODE_CANNED_CYCLE_82:
+				case MOTION_MODE_CANNED_CYCLE_83:
+					{ status = cm_canned_cycle(cm.gn.target, cm.gf.target); break;}
+#endif
 			}
 		}
 	}
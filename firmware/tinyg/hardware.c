@@ -35,14 +35,23 @@
 #include "switch.h"
 #include "controller.h"
 #include "text_parser.h"
+#ifdef __WARM_RESET
+#include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "gpio.h"
+#include "report.h"
+#include "xio.h"
+#endif
 #ifdef __AVR
 #include "xmega/xmega_init.h"
 #include "xmega/xmega_rtc.h"
 #endif
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /*
  * _port_bindings  - bind XMEGA ports to hardware - these changed at board revision 7
@@ -80,11 +89,38 @@ void hardware_init()
 {
 #ifdef __AVR
 	xmega_init();							// set system clock
+#ifdef __BOOT_TIME
+	hw_boot_timer_start();					// start measuring as soon as the clock is up
+#endif
 	_port_bindings(TINYG_HARDWARE_VERSION);
 	rtc_init();								// real time counter
 #endif
 }
 
+#ifdef __BOOT_TIME
+/*
+ * hw_boot_timer_start() - start the boot timer
+ * hw_boot_time_ms()	 - return elapsed time since hw_boot_timer_start() in ms
+ *
+ *	Uses TIMER_5 free-running at CLKper/1024 (31.25 KHz). The RTC can't measure
+ *	boot time as its ticks only advance once interrupts are enabled, which is
+ *	the last step of init. 16 bits at this rate wrap at ~2 sec, which bounds
+ *	the measurable boot time - a boot that slow is its own report.
+ *	TIMER_5 is reclaimed afterwards as the diagnostics sample clock (see
+ *	diagnostics.c), which is why diagnostics_init() must follow the ready message.
+ */
+void hw_boot_timer_start()
+{
+	TIMER_5.CNT = 0;
+	TIMER_5.CTRLA = TC_CLKSEL_DIV1024_gc;
+}
+
+uint32_t hw_boot_time_ms()
+{
+	return (((uint32_t)TIMER_5.CNT * 4) / 125);	// 31.25 ticks per ms
+}
+#endif // __BOOT_TIME
+
 /*
  * _get_id() - get a human readable signature
  *
@@ -153,9 +189,57 @@ static void _get_id(char_t *id)
  * hw_request_hard_reset()
  * hw_hard_reset()			- hard reset using watchdog timer
  * hw_hard_reset_handler()	- controller's rest handler
+ *
+ * The warm reset path re-initializes motion state in place instead of tripping
+ * the watchdog. The config image already lives in RAM, so there is nothing a
+ * trip through the bootloader and an EEPROM re-read would tell us that the
+ * magic number assertions can't - if they all pass the image is intact and the
+ * machine can be back at READY in one controller pass. Any violation falls
+ * back to the cold path, which remains the only safe answer to real corruption.
  */
 void hw_request_hard_reset() { cs.hard_reset_requested = true; }
 
+#ifdef __WARM_RESET
+
+static uint8_t _ram_image_valid(void)
+{
+	if (config_test_assertions() != STAT_OK) 			return (false);
+	if (controller_test_assertions() != STAT_OK) 		return (false);
+	if (canonical_machine_test_assertions() != STAT_OK)	return (false);
+	if (planner_test_assertions() != STAT_OK) 			return (false);
+	if (stepper_test_assertions() != STAT_OK) 			return (false);
+	if (encoder_test_assertions() != STAT_OK) 			return (false);
+	if (xio_test_assertions() != STAT_OK) 				return (false);
+	return (true);
+}
+
+static void _warm_reset(void)
+{
+	cli();								// same interrupt discipline as _application_init()
+	stepper_init();						// kills any step generation in flight
+	encoder_init();
+	planner_init();
+#ifdef __PLAN_STAGING
+	mp_flush_staging();					// planner_init() doesn't know about the staging ring
+#endif
+	canonical_machine_init();			// gcode defaults from the RAM config; spindle off
+	sei();
+
+	// cold reset semantics: position and homing state do not survive a ^X
+	cm.homing_state = HOMING_NOT_HOMED;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		cm.homed[axis] = false;
+		cm_set_position(axis, 0);
+	}
+	gpio_set_bit_off(MIST_COOLANT_BIT);	// cm_spindle_init() covered the spindle bit
+
+	xio_reset_usb_rx_buffers();			// drop whatever was streaming when the ^X arrived
+	cs.linelen = 0;
+	cs.hard_reset_requested = false;
+	rpt_print_system_ready_message();	// same announcement as a cold boot so hosts re-sync
+}
+#endif // __WARM_RESET
+
 void hw_hard_reset(void)			// software hard reset using the watchdog timer
 {
 #ifdef __AVR
@@ -168,6 +252,12 @@ stat_t hw_hard_reset_handler(void)
 {
 	if (cs.hard_reset_requested == false)
         return (STAT_NOOP);
+#ifdef __WARM_RESET
+	if (_ram_image_valid() == true) {
+		_warm_reset();				// near-instant - config and comms setup are preserved
+		return (STAT_EAGAIN);
+	}
+#endif
 	hw_hard_reset();				// hard reset - identical to hitting RESET button
 	return (STAT_EAGAIN);
 }
@@ -257,6 +347,6 @@ void hw_print_id(nvObj_t *nv) { text_print_str(nv, fmt_id);}
 
 #endif //__TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
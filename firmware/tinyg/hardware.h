@@ -1,11 +1,11 @@
 /*
- * hardware.h - system hardware configuration
- *				THIS FILE IS HARDWARE PLATFORM SPECIFIC - AVR Xmega version
- *
- * This file is part of the TinyG project
- *
- * Copyright (c) 2013 - 2015 Alden S. Hart, Jr.
- * Copyright (c) 2013 - 2015 Robert Giseburt
+ * hardware.h - system hardware configuration
+ *				THIS FILE IS HARDWARE PLATFORM SPECIFIC - AVR Xmega version
+ *
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2013 - 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2013 - 2015 Robert Giseburt
  *
  * This file ("the software") is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License, version 2 as published by the
@@ -48,34 +48,34 @@
 #ifndef HARDWARE_H_ONCE
 #define HARDWARE_H_ONCE
 
-/*--- Hardware platform enumerations ---*/
-
-enum hwPlatform {
-	HM_PLATFORM_NONE = 0,
-
-	HW_PLATFORM_TINYG_XMEGA,	// TinyG code base on Xmega boards.
-								//	hwVersion 7 = TinyG v7 and earlier
-								//	hwVersion 8 = TinyG v8
-
-	HW_PLATFORM_G2_DUE,			// G2 code base on native Arduino Due
-
-	HW_PLATFORM_TINYG_V9		// G2 code base on v9 boards
-								//  hwVersion 0 = v9c
-								//  hwVersion 1 = v9d
-								//  hwVersion 2 = v9f
-								//  hwVersion 3 = v9h
-								//  hwVersion 4 = v9i
-};
-
-#define HW_VERSION_TINYGV6		6
-#define HW_VERSION_TINYGV7		7
-#define HW_VERSION_TINYGV8		8
-
-#define HW_VERSION_TINYGV9C		0
-#define HW_VERSION_TINYGV9D		1
-#define HW_VERSION_TINYGV9F		2
-#define HW_VERSION_TINYGV9H		3
-#define HW_VERSION_TINYGV9I		4
+/*--- Hardware platform enumerations ---*/
+
+enum hwPlatform {
+	HM_PLATFORM_NONE = 0,
+
+	HW_PLATFORM_TINYG_XMEGA,	// TinyG code base on Xmega boards.
+								//	hwVersion 7 = TinyG v7 and earlier
+								//	hwVersion 8 = TinyG v8
+
+	HW_PLATFORM_G2_DUE,			// G2 code base on native Arduino Due
+
+	HW_PLATFORM_TINYG_V9		// G2 code base on v9 boards
+								//  hwVersion 0 = v9c
+								//  hwVersion 1 = v9d
+								//  hwVersion 2 = v9f
+								//  hwVersion 3 = v9h
+								//  hwVersion 4 = v9i
+};
+
+#define HW_VERSION_TINYGV6		6
+#define HW_VERSION_TINYGV7		7
+#define HW_VERSION_TINYGV8		8
+
+#define HW_VERSION_TINYGV9C		0
+#define HW_VERSION_TINYGV9D		1
+#define HW_VERSION_TINYGV9F		2
+#define HW_VERSION_TINYGV9H		3
+#define HW_VERSION_TINYGV9I		4
 
 ////////////////////////////
 /////// AVR VERSION ////////
@@ -86,14 +86,14 @@ enum hwPlatform {
 #include "xmega/xmega_rtc.h"			// Xmega only. Goes away with RTC refactoring
 
 // uncomment once motate Xmega port is available
-//#include "motatePins.h"
-//#include "motateTimers.h"				// for Motate::timer_number
+//#include "motatePins.h"
+//#include "motateTimers.h"				// for Motate::timer_number
 
 /*************************
  * Global System Defines *
  *************************/
 
-#undef F_CPU							// CPU clock - set for delays
+#undef F_CPU							// CPU clock - set for delays
 #define F_CPU 32000000UL				// should always precede <avr/delay.h>
 #define MILLISECONDS_PER_TICK 1			// MS for system tick (systick * N)
 #define SYS_ID_LEN 12					// length of system ID string from sys_get_id()
@@ -197,7 +197,7 @@ enum cfgPortBits {			// motor control port bit positions
 #define TIMER_DWELL	 		TCD0		// Dwell timer	(see stepper.h)
 #define TIMER_LOAD			TCE0		// Loader timer	(see stepper.h)
 #define TIMER_EXEC			TCF0		// Exec timer	(see stepper.h)
-#define TIMER_5				TCC1		// unallocated timer
+#define TIMER_5				TCC1		// boot timer, then diagnostics/benchmark sample clock
 #define TIMER_PWM1			TCD1		// PWM timer #1 (see pwm.c)
 #define TIMER_PWM2			TCE1		// PWM timer #2	(see pwm.c)
 
@@ -205,6 +205,10 @@ enum cfgPortBits {			// motor control port bit positions
 
 #define FREQUENCY_DDA 		(float)50000	// DDA frequency in hz.
 #define FREQUENCY_DWELL		(float)10000	// Dwell count frequency in hz.
+#ifdef __PRECISE_DWELL
+#define DWELL_TIMER_ENABLE	5				// turn timer clock on at F_CPU/64 (500 KHz)
+#define DWELL_TICKS_PER_USEC (float)0.5		// dwell timer ticks per microsecond at F_CPU/64
+#endif
 #define LOAD_TIMER_PERIOD 	100				// cycles you have to shut off SW interrupt
 #define EXEC_TIMER_PERIOD 	100				// cycles you have to shut off SW interrupt
 #define EXEC_TIMER_PERIOD_LONG 100			// cycles you have to shut off SW interrupt
@@ -236,6 +240,13 @@ enum cfgPortBits {			// motor control port bit positions
 #define TIMER_LOAD_INTLVL	TIMER_OVFINTLVL_HI
 #define TIMER_EXEC_INTLVL	TIMER_OVFINTLVL_LO
 
+#ifdef __STEP_PULSE_TIMER
+#define STEP_PULSE_WIDTH_US	(float)2.5			// step pulse width measured from the last leading edge
+#define STEP_PULSE_TICKS	(uint16_t)(STEP_PULSE_WIDTH_US * (F_CPU/1000000))	// width in DDA timer counts
+#define TIMER_DDA_CCA_ISR_vect	TCC0_CCA_vect	// trailing edge compare - must agree with TIMER_DDA
+#define TIMER_DDA_CCAINTLVL	3					// CCAINTLVL field of INTCTRLB (3=hi)
+#endif
+
 
 /**** Device singleton - global structure to allow iteration through similar devices ****/
 /*
@@ -261,6 +272,10 @@ hwSingleton_t hw;
 /*** function prototypes ***/
 
 void hardware_init(void);			// master hardware init
+#ifdef __BOOT_TIME
+void hw_boot_timer_start(void);
+uint32_t hw_boot_time_ms(void);
+#endif
 void hw_request_hard_reset();
 void hw_hard_reset(void);
 stat_t hw_hard_reset_handler(void);
@@ -290,4 +305,4 @@ stat_t hw_get_id(nvObj_t *nv);
 
 #endif // __TEXT_MODE
 
-#endif	// end of include guard: HARDWARE_H_ONCE
+#endif	// end of include guard: HARDWARE_H_ONCE
@@ -21,6 +21,7 @@
 #include "config.h"		// #2
 #include "report.h"
 #include "help.h"
+#include "strpack.h"
 
 #ifdef __cplusplus
 extern "C"{
@@ -34,18 +35,18 @@ stat_t help_stub(nvObj_t *nv) {return (STAT_OK);}
 
 static void _status_report_advisory()
 {
-fprintf_P(stderr, PSTR("\n\
+fprintf_packed(stderr, PSTR("\n\
 Note: TinyG generates automatic status reports by default\n\
-This can be disabled by entering $sv=0\n\
-See the wiki below for more details.\n\
+Th" D_IS_ "can be disabled by entering $sv=0\n\
+See " D_THE_ "wiki below " D_FOR_ "more details.\n\
 "));
 }
 
 static void _postscript()
 {
-fprintf_P(stderr, PSTR("\n\
-For detailed TinyG info see: https://github.com/synthetos/TinyG/wiki/\n\
-For the latest firmware see: https://github.com/synthetos/TinyG\n\
+fprintf_packed(stderr, PSTR("\n\
+For detailed TinyG info see: " D_HTTPS_GITHUB_COM_SYNTHETOS D_TINYG "/wiki/\n\
+For " D_THE_ "la" D_TEST_ "firmware see: " D_HTTPS_GITHUB_COM_SYNTHETOS D_TINYG "\n\
 Please log any issues at http://www.synthetos.com/forums\n\
 Have fun\n"));
 }
@@ -55,20 +56,20 @@ Have fun\n"));
  */
 uint8_t help_general(nvObj_t *nv)
 {
-fprintf_P(stderr, PSTR("\n\n\n### TinyG Help ###\n"));
-fprintf_P(stderr, PSTR("\
-These commands are active from the command line:\n\
+fprintf_packed(stderr, PSTR("\n\n\n" D_TINYG_ D_HELP "\n"));
+fprintf_packed(stderr, PSTR("\
+" D_THESE_COMMANDS_ARE_ACTIVE_ "from " D_THE_ D_COMMAND_ "line:\n\
  ^x             Reset (control x) - software reset\n\
-  ?             Machine position and gcode model state\n\
-  $             Show and set configuration settings\n\
+  ?             Machine " D_POSITION_ "and gcode model state\n\
+" D_SYM "             " D_SHOW_ "and set " D_CONFIGURATION_ D_SETTINGS "\n\
   !             Feedhold - stop motion without losing position\n\
   ~             Cycle Start - restart from feedhold\n\
-  h             Show this help screen\n\
-  $h            Show configuration help screen\n\
-  $test         List self-tests\n\
-  $test=N       Run self-test N\n\
-  $home=1       Run a homing cycle\n\
-  $defa=1       Restore all settings to \"factory\" defaults\n\
+  h             " D_SHOW_ "th" D_IS_ D_HELP_SCREEN "\n\
+" D_SYM "h            " D_SHOW_ D_CONFIGURATION_ D_HELP_SCREEN "\n\
+" D_TEST "         List self-" D_TEST2 "s\n\
+" D_TEST "=N       Run self-" D_TEST_ "N\n\
+" D_SYM "home=1       Run a homing cycle\n\
+" D_SYM "defa=1       Restore " D_ALL_ D_SETTINGS " " D_TO_ "\"factory\" defaults\n\
 "));
 _status_report_advisory();
 _postscript();
@@ -81,28 +82,28 @@ return(STAT_OK);
  */
 stat_t help_config(nvObj_t *nv)
 {
-fprintf_P(stderr, PSTR("\n\n\n### TinyG CONFIGURATION Help ###\n"));
-fprintf_P(stderr, PSTR("\
-These commands are active for configuration:\n\
-  $sys Show system (general) settings\n\
-  $1   Show motor 1 settings (or whatever motor you want 1,2,3,4)\n\
-  $x   Show X axis settings (or whatever axis you want x,y,z,a,b,c)\n\
-  $m   Show all motor settings\n\
-  $q   Show all axis settings\n\
-  $o   Show all offset settings\n\
-  $$   Show all settings\n\
-  $h   Show this help screen\n\n\
+fprintf_packed(stderr, PSTR("\n\n\n" D_TINYG_ "CONFIGURATION " D_HELP "\n"));
+fprintf_packed(stderr, PSTR("\
+" D_THESE_COMMANDS_ARE_ACTIVE_ D_FOR_ "configuration:\n\
+" D_SYM "sys " D_SHOW_ D_SYSTEM_ "(general) " D_SETTINGS "\n\
+" D_SYM "1   " D_SHOW_ "motor 1 " D_SETTINGS " (or whatever motor you want 1,2,3,4)\n\
+" D_SYM "x   " D_SHOW_ "X ax" D_IS_ D_SETTINGS " (or whatever ax" D_IS_ "you want x,y,z,a,b,c)\n\
+" D_SYM "m   " D_SHOW_ D_ALL_ "motor " D_SETTINGS "\n\
+" D_SYM "q   " D_SHOW_ D_ALL_ "ax" D_IS_ D_SETTINGS "\n\
+" D_SYM "o   " D_SHOW_ D_ALL_ "offset " D_SETTINGS "\n\
+" D_SYM "$   " D_SHOW_ D_ALL_ D_SETTINGS "\n\
+" D_SYM "h   " D_SHOW_ "th" D_IS_ D_HELP_SCREEN "\n\n\
 "));
 
-fprintf_P(stderr, PSTR("\
-Each $ command above also displays the token for each setting in [ ] brackets\n\
-To view settings enter a token:\n\n\
-  $<token>\n\n\
-For example $yfr to display the Y max feed rate\n\n\
-To update settings enter token equals value:\n\n\
-  $<token>=<value>\n\n\
-For example $yfr=800 to set the Y max feed rate to 800 mm/minute\n\
-For configuration details see: https://github.com/synthetos/TinyG/wiki/TinyG-Configuration\n\
+fprintf_packed(stderr, PSTR("\
+Each $ " D_COMMAND_ "above also displays " D_THE_ "token " D_FOR_ "each setting in [ ] brackets\n\
+To view " D_SETTINGS " " D_ENTER_ "a token:\n\n\
+" D_SYM "<token>\n\n\
+For example $yfr " D_TO_ "display " D_THE_ "Y max feed rate\n\n\
+To update " D_SETTINGS " " D_ENTER_ "token equals value:\n\n\
+" D_SYM "<token>=<value>\n\n\
+For example $yfr=800 " D_TO_ "set " D_THE_ "Y max feed rate " D_TO_ "800 mm/minute\n\
+For " D_CONFIGURATION_ "details see: " D_HTTPS_GITHUB_COM_SYNTHETOS D_TINYG "/wiki" D_TINYG "-Configuration\n\
 "));
 _status_report_advisory();
 _postscript();
@@ -114,27 +115,27 @@ return(STAT_OK);
  */
 stat_t help_test(nvObj_t *nv)
 {
-fprintf_P(stderr, PSTR("\n\n\n### TinyG SELF TEST Help ###\n"));
-fprintf_P(stderr, PSTR("\
-Invoke self test by entering $test=N where N is one of:\n\
-  $test=1  smoke test\n\
-  $test=2  homing test   (you must trip homing switches)\n\
-  $test=3  square test   (a series of squares)\n\
-  $test=4  arc test      (some large circles)\n\
-  $test=5  dwell test    (moves spaced by 1 second dwells)\n\
-  $test=6  feedhold test (enter ! and ~ to hold and restart, respectively)\n\
-  $test=7  M codes test  (M codes intermingled with moves)\n\
-  $test=8  JSON test     (motion test run using JSON commands)\n\
-  $test=9  inverse time test\n\
-  $test=10 rotary motion test\n\
-  $test=11 small moves test\n\
-  $test=12 slow moves test\n\
-  $test=13 coordinate system offset test (G92, G54-G59)\n\
+fprintf_packed(stderr, PSTR("\n\n\n" D_TINYG_ "SELF TEST " D_HELP "\n"));
+fprintf_packed(stderr, PSTR("\
+Invoke self " D_TEST_ "by entering $" D_TEST2 "=N where N " D_IS_ "one of:\n\
+" D_TEST "=1  smoke " D_TEST2 "\n\
+" D_TEST "=2  homing " D_TEST_ "  (you must trip homing switches)\n\
+" D_TEST "=3  square " D_TEST_ "  (a series of squares)\n\
+" D_TEST "=4  arc " D_TEST_ "     (some large circles)\n\
+" D_TEST "=5  dwell " D_TEST_ "   (moves spaced by 1 second dwells)\n\
+" D_TEST "=6  feedhold " D_TEST_ "(" D_ENTER_ "! and ~ " D_TO_ "hold and restart, respectively)\n\
+" D_TEST "=7  M codes " D_TEST_ " (M codes intermingled with moves)\n\
+" D_TEST "=8  " D_JSON_ D_TEST_ "    (motion " D_TEST_ "run using " D_JSON_ "commands)\n\
+" D_TEST "=9  inverse time " D_TEST2 "\n\
+" D_TEST "=10 rotary motion " D_TEST2 "\n\
+" D_TEST "=11 sm" D_ALL_ "moves " D_TEST2 "\n\
+" D_TEST "=12 slow moves " D_TEST2 "\n\
+" D_TEST "=13 coordinate " D_SYSTEM_ "offset " D_TEST_ "(G92, G54-G59)\n\
 \n\
-Tests assume a centered XY origin and at least 80mm clearance in all directions\n\
+Tests assume a centered XY origin and at least 80mm clearance in " D_ALL_ "directions\n\
 Tests assume Z has at least 40mm posiitive clearance\n\
 Tests start with a G0 X0 Y0 Z0 move\n\
-Homing is the exception. No initial position or clearance is assumed\n\
+Homing " D_IS_ D_THE_ "exception. No initial " D_POSITION_ "or clearance " D_IS_ "assumed\n\
 "));
 _postscript();
 return(STAT_OK);
@@ -145,10 +146,10 @@ return(STAT_OK);
  */
 stat_t help_defa(nvObj_t *nv)
 {
-fprintf_P(stderr, PSTR("\n\n\n### TinyG RESTORE DEFAULTS Help ###\n"));
-fprintf_P(stderr, PSTR("\
-Enter $defa=1 to reset the system to the factory default values.\n\
-This will overwrite any changes you have made.\n"));
+fprintf_packed(stderr, PSTR("\n\n\n" D_TINYG_ "RESTORE DEFAULTS " D_HELP "\n"));
+fprintf_packed(stderr, PSTR("\
+Enter $defa=1 " D_TO_ "reset " D_THE_ D_SYSTEM_ D_TO_ D_THE_ "factory default values.\n\
+Th" D_IS_ "will overwrite any changes you have made.\n"));
 _postscript();
 return(STAT_OK);
 }
@@ -158,9 +159,9 @@ return(STAT_OK);
  */
 stat_t help_boot_loader(nvObj_t *nv)
 {
-fprintf_P(stderr, PSTR("\n\n\n### TinyG BOOT LOADER Help ###\n"));
-fprintf_P(stderr, PSTR("\
-Enter $boot=1 to enter the boot loader.\n"));
+fprintf_packed(stderr, PSTR("\n\n\n" D_TINYG_ "BOOT LOADER " D_HELP "\n"));
+fprintf_packed(stderr, PSTR("\
+Enter $boot=1 " D_TO_ D_ENTER_ D_THE_ "boot loader.\n"));
 _postscript();
 return(STAT_OK);
 }
@@ -0,0 +1,204 @@
+/*
+ * job_store.c - gcode job storage in application flash
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Operation
+ *
+ *	The job store lets a host stream a job once and replay it many times at
+ *	memory speed, instead of re-streaming the same file over the serial link
+ *	for every cycle (repetitive production jobs spend more time transferring
+ *	than cutting). The job is uploaded through the binary block channel
+ *	(see gcode_binary.c for the framing):
+ *
+ *	  opcode 0x04 (JOB_BEGIN)	invalidate the stored job and start an upload
+ *	  opcode 0x05 (JOB_DATA)	append payload bytes (plain gcode text)
+ *	  opcode 0x06 (JOB_COMMIT)	terminate, flush, and write the header
+ *
+ *	Bytes are staged in a RAM page buffer and written a flash page at a time
+ *	through the xboot jump table. The header page is erased first and written
+ *	last, so a power loss mid-upload can never leave a stale job looking valid.
+ *	Flash programming stalls the CPU for a few ms per page, so uploads are
+ *	rejected while the machine is moving.
+ *
+ *	Replay is started with $job=1 (or {"job":1}), which opens the XIO_DEV_FLASH
+ *	device on the stored text and makes it the primary input source - the same
+ *	mechanism the canned tests use for PROGMEM files. $job with no value reports
+ *	the stored job size in bytes, 0 if none. The stored text runs through the
+ *	normal parsers, so it may itself contain binary blocks (SOH lines) for a
+ *	denser encoding of long moves.
+ */
+
+#include "tinyg.h"				// #1
+#include "config.h"				// #2
+#include "controller.h"
+#include "canonical_machine.h"
+#include "gcode_binary.h"
+#include "job_store.h"
+#include "util.h"
+#include "xio.h"
+#include "xmega/xbootapi.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifdef __JOB_STORE
+
+static struct jbSingleton {
+	uint8_t uploading;				// true from JOB_BEGIN to JOB_COMMIT
+	uint16_t fill;					// bytes staged in the page buffer
+	uint32_t write_addr;			// flash address for the next page write
+	uint32_t length;				// job bytes received so far
+	uint8_t page[JOB_STORE_PAGE];	// flash page staging buffer
+} jb;
+
+static stat_t _append(uint8_t c);
+static stat_t _exec_job_begin(void);
+static stat_t _exec_job_commit(void);
+
+/*
+ * job_binary_block() - dispatch a job upload block from the binary channel
+ *
+ *	Payload excludes the opcode and trailing checksum (already verified).
+ */
+stat_t job_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len)
+{
+	if ((opcode & 0x0F) == GC_BINARY_JOB_BEGIN) {
+		return (_exec_job_begin());
+	}
+	if (jb.uploading == false) {
+		return (STAT_COMMAND_NOT_ACCEPTED);		// DATA or COMMIT without BEGIN
+	}
+	if ((opcode & 0x0F) == GC_BINARY_JOB_DATA) {
+		for (uint8_t i=0; i<len; i++) {
+			ritorno(_append(payload[i]));
+		}
+		return (STAT_OK);
+	}
+	return (_exec_job_commit());
+}
+
+static stat_t _exec_job_begin()
+{
+	if (cm_get_runtime_busy() == true) {		// page writes stall the CPU
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	// kill the header first so an interrupted upload can't replay a stale job
+	flash_scrub_rebase();
+	if (xboot_erase_application_page(JOB_STORE_BASE) != XB_SUCCESS) {
+		return (STAT_NO_SUCH_DEVICE);			// boot loader API not present
+	}
+	memset(&jb, 0, sizeof(jb));
+	jb.write_addr = JOB_STORE_DATA;
+	jb.uploading = true;
+	return (STAT_OK);
+}
+
+static stat_t _append(uint8_t c)
+{
+	if (jb.write_addr + jb.fill >= JOB_STORE_END) {
+		jb.uploading = false;
+		return (STAT_FILE_SIZE_EXCEEDED);
+	}
+	jb.page[jb.fill++] = c;
+	if (jb.fill == JOB_STORE_PAGE) {
+		flash_scrub_rebase();
+		if (xboot_write_application_page(jb.write_addr, jb.page, true) != XB_SUCCESS) {
+			jb.uploading = false;
+			return (STAT_INTERNAL_ERROR);
+		}
+		jb.write_addr += JOB_STORE_PAGE;
+		jb.fill = 0;
+	}
+	jb.length++;
+	return (STAT_OK);
+}
+
+static stat_t _exec_job_commit()
+{
+	uint32_t length = jb.length;
+
+	ritorno(_append(NUL));						// terminate for the line reader
+	if (jb.fill != 0) {							// flush the partial last page
+		memset(&jb.page[jb.fill], 0xFF, JOB_STORE_PAGE - jb.fill);
+		flash_scrub_rebase();
+		if (xboot_write_application_page(jb.write_addr, jb.page, true) != XB_SUCCESS) {
+			jb.uploading = false;
+			return (STAT_INTERNAL_ERROR);
+		}
+	}
+	// the header write is what makes the job valid - it must be last
+	memset(jb.page, 0xFF, JOB_STORE_PAGE);
+	uint32_t magic = JOB_STORE_MAGIC;
+	memcpy(&jb.page[0], &magic, sizeof(magic));
+	memcpy(&jb.page[4], &length, sizeof(length));
+	flash_scrub_rebase();
+	if (xboot_write_application_page(JOB_STORE_BASE, jb.page, true) != XB_SUCCESS) {
+		jb.uploading = false;
+		return (STAT_INTERNAL_ERROR);
+	}
+	jb.uploading = false;
+	return (STAT_OK);
+}
+
+/*
+ * job_store_length() - return stored job size in bytes, 0 if no valid job
+ */
+uint32_t job_store_length()
+{
+	if (pgm_read_dword_far(JOB_STORE_BASE) != JOB_STORE_MAGIC) { return (0);}
+	uint32_t length = pgm_read_dword_far(JOB_STORE_BASE + 4);
+	if (length > (JOB_STORE_END - JOB_STORE_DATA)) { return (0);}	// corrupt header
+	return (length);
+}
+
+/*
+ * job_get_job() - get stored job size for $job / {"job":n}
+ * job_run_job() - replay the stored job ($job=1)
+ */
+stat_t job_get_job(nvObj_t *nv)
+{
+	nv->value = (float)job_store_length();
+	nv->valuetype = TYPE_FLOAT;
+	nv->precision = 0;
+	return (STAT_OK);
+}
+
+stat_t job_run_job(nvObj_t *nv)
+{
+#ifdef __JOB_CHAIN
+	if (jb.uploading == true) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if (fp_ZERO(nv->value)) { return (STAT_OK);}	// $job=0 is a no-op
+	if (job_store_length() == 0) { return (STAT_FILE_NOT_OPEN);}
+	return (tg_run_source(XIO_DEV_FLASH, NULL));	// runs now, or chains behind a streaming file
+#else
+	if ((jb.uploading == true) || (cm_get_runtime_busy() == true)) {
+		return (STAT_COMMAND_NOT_ACCEPTED);
+	}
+	if (fp_ZERO(nv->value)) { return (STAT_OK);}	// $job=0 is a no-op
+	if (job_store_length() == 0) { return (STAT_FILE_NOT_OPEN);}
+	xio_open(XIO_DEV_FLASH, NULL, PGM_FLAGS);
+	tg_set_primary_source(XIO_DEV_FLASH);
+	return (STAT_OK);
+#endif
+}
+
+#endif // __JOB_STORE
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/*
+ * job_store.h - gcode job storage in application flash
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef JOB_STORE_H_ONCE
+#define JOB_STORE_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* Flash region
+ *
+ *	The job store occupies the top 64K of the application section, well above
+ *	the firmware image (currently ~100K of the 192K app section - check the
+ *	linker map if the build grows). The first page is a header; gcode text
+ *	starts at JOB_STORE_DATA and is NUL terminated. All flash programming goes
+ *	through the resident xboot jump table (see xmega/xbootapi.h) since SPM
+ *	must execute from the boot section on the xmega.
+ */
+#ifdef __HEADLESS
+#define JOB_STORE_BASE	0x1C000UL			// header page address (112K) - console flash freed below covers the difference
+#else
+#define JOB_STORE_BASE	0x20000UL			// header page address (128K)
+#endif
+#define JOB_STORE_END	0x30000UL			// first address past the store (end of app section)
+#define JOB_STORE_PAGE	512					// app flash page size on the xmega ...A3 parts
+#define JOB_STORE_DATA	(JOB_STORE_BASE + JOB_STORE_PAGE)
+#define JOB_STORE_MAGIC	0x544a4f42UL		// "BOJT" - marks a committed job header
+
+/*
+ * Global Scope Functions
+ */
+#ifdef __JOB_STORE
+
+stat_t job_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len);
+uint32_t job_store_length(void);
+stat_t job_get_job(nvObj_t *nv);
+stat_t job_run_job(nvObj_t *nv);
+
+#endif // __JOB_STORE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // End of include guard: JOB_STORE_H_ONCE
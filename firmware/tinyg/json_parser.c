@@ -1,53 +1,63 @@
 /*
  * json_parser.c - JSON parser for TinyG
- * This file is part of the TinyG project
- *
- * Copyright (c) 2011 - 2015 Alden S. Hart, Jr.
- *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2011 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "tinyg.h"
 #include "config.h"					// JSON sits on top of the config system
 #include "controller.h"
-#include "json_parser.h"
+#include "json_parser.h"
 #include "text_parser.h"
 #include "canonical_machine.h"
+#include "planner.h"				// planned-time depth for the footer flow advisory
+#include "hardware.h"				// systick for the windowed ack idle flush
 #include "report.h"
 #include "util.h"
 #include "xio.h"					// for char definitions
-
-#ifdef __cplusplus
-extern "C"{
-#endif
-
-/**** Allocation ****/
-
-jsSingleton_t js;
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/**** Allocation ****/
+
+jsSingleton_t js;
 
 /**** local scope stuff ****/
 
 static stat_t _json_parser_kernal(char_t *str);
+#ifdef __JSON_BATCH
+static void _json_batch(char_t *str);
+#endif
+static stat_t _json_parse(char_t *str);
+static stat_t _json_execute(void);
 static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth);
 static stat_t _normalize_json_string(char_t *str, uint16_t size);
+#ifdef __GC_TOKENIZER
+static stat_t _tokenize_gc(char_t *str, nvObj_t *nv);
+#endif
 
 /****************************************************************************
  * json_parser() - exposed part of JSON parser
@@ -89,12 +99,24 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size);
 
 void json_parser(char_t *str)
 {
+#ifdef __JSON_BATCH
+	if (*str == '[') { _json_batch(str+1); return;}	// multi-command batch - combined response
+#endif
 	stat_t status = _json_parser_kernal(str);
+#ifdef __ASYNC_COMMAND
+	if (status == STAT_ASYNC_PENDING) { return;}	// response is deferred to nv_async_callback()
+#endif
 	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
 	sr_request_status_report(SR_IMMEDIATE_REQUEST); // generate incremental status report to show any changes
 }
 
 static stat_t _json_parser_kernal(char_t *str)
+{
+	ritorno(_json_parse(str));						// populate the nv list from the string
+	return (_json_execute());
+}
+
+static stat_t _json_parse(char_t *str)
 {
 	stat_t status;
 	int8_t depth;
@@ -102,6 +124,11 @@ static stat_t _json_parser_kernal(char_t *str)
 	char_t group[GROUP_LEN+1] = {""};				// group identifier - starts as NUL
 	int8_t i = NV_BODY_LEN;
 
+#ifdef __GC_TOKENIZER
+	if (js.json_syntax == JSON_SYNTAX_STRICT) {		// try the single-pass gcode line tokenizer first
+		if ((status = _tokenize_gc(str, nv)) != STAT_EAGAIN) { return (status);}
+	}
+#endif
 	ritorno(_normalize_json_string(str, JSON_OUTPUT_STRING_MAX));	// return if error
 
 	// parse the JSON command into the nv body
@@ -118,9 +145,9 @@ static stat_t _json_parser_kernal(char_t *str)
 		if (group[0] != NUL) {
 			strncpy(nv->group, group, GROUP_LEN);	// copy the parent's group to this child
 		}
-		// validate the token and get the index
+		// validate the token and get the index
 		if ((nv->index = nv_get_index(nv->group, nv->token)) == NO_MATCH) {
-			return (STAT_UNRECOGNIZED_NAME);
+			return (STAT_UNRECOGNIZED_NAME);
 		}
 		if ((nv_index_is_group(nv->index)) && (nv_group_is_prefixed(nv->token))) {
 			strncpy(group, nv->token, GROUP_LEN);	// record the group ID
@@ -128,20 +155,151 @@ static stat_t _json_parser_kernal(char_t *str)
 		if ((nv = nv->nx) == NULL)
             return (STAT_JSON_TOO_MANY_PAIRS);      // Not supposed to encounter a NULL
 	} while (status != STAT_OK);					// breaks when parsing is complete
+	return (STAT_OK);
+}
 
+static stat_t _json_execute()
+{
 	// execute the command
-	nv = nv_body;
+	nvObj_t *nv = nv_body;
 	if (nv->valuetype == TYPE_NULL){				// means GET the value
 		ritorno(nv_get(nv));						// ritorno returns w/status on any errors
 	} else {
-		if (cm.machine_state == MACHINE_ALARM)
-            return (STAT_MACHINE_ALARMED);
+		if (cm.machine_state == MACHINE_ALARM)
+            return (STAT_MACHINE_ALARMED);
 		ritorno(nv_set(nv));						// set value or call a function (e.g. gcode)
 		nv_persist(nv);
 	}
 	return (STAT_OK);								// only successful commands exit through this point
 }
 
+#ifdef __JSON_BATCH
+/*
+ * _json_batch() - execute a multi-command array in one dispatch pass
+ *
+ *	Accepts [{"1tr":1.25},{"2tr":1.25},...] - each element is an independent
+ *	command run through the normal parse and execute paths in arrival order,
+ *	so sets are validated, persisted and diffed against the NVM shadow exactly
+ *	as they would be line by line. Execution stops at the first error. One
+ *	combined response is emitted: the count of commands completed in the body
+ *	and the status of the stopping element in the footer, so a host locates a
+ *	failure by position. Get results are not individually serialized - the
+ *	array form is for setup bursts, not queries.
+ */
+static void _json_batch(char_t *str)
+{
+	stat_t status = STAT_OK;
+	uint16_t count = 0;
+
+	while (status == STAT_OK) {
+		while ((*str == ' ') || (*str == ',')) { str++;}
+		if ((*str == NUL) || (*str == ']')) { break;}
+		if (*str != '{') { status = STAT_JSON_SYNTAX_ERROR; break;}
+
+		char_t *element = str;						// scan to the matching close brace
+		int8_t depth = 0;
+		uint8_t in_string = false;
+		for (; *str != NUL; str++) {
+			if (*str == '"') { in_string = !in_string;}
+			if (in_string) { continue;}
+			if (*str == '{') { depth++;}
+			if ((*str == '}') && (--depth == 0)) { break;}
+		}
+		if (*str == NUL) { status = STAT_JSON_SYNTAX_ERROR; break;}
+		str++;										// past the close brace
+		if (*str != NUL) { *str++ = NUL;}			// terminate the element in place
+		status = _json_parser_kernal(element);
+#ifdef __ASYNC_COMMAND
+		if (status == STAT_ASYNC_PENDING) { status = STAT_OK;}	// async completion responds on its own
+#endif
+		if (status == STAT_OK) { count++;}
+	}
+	nvObj_t *nv = nv_reset_nv_list();				// combined response: completed count + first error
+	strcpy(nv->token, "batch");
+	nv_store_int(nv, count);
+	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+	sr_request_status_report(SR_IMMEDIATE_REQUEST);
+}
+#endif // __JSON_BATCH
+
+#ifdef __PREPARSE
+/*
+ * json_preparse()		  - parse a line ahead of execution and stage the result
+ * json_preparse_staged() - true if a staged line is waiting to execute
+ * json_execute_staged()  - execute a staged line and emit its response
+ *
+ *	Parse time and plan time are normally serialized: the controller won't
+ *	read a line until the planner can accept it. These functions let the
+ *	controller parse the next JSON line while the planner is still full (see
+ *	_json_preparse_callback() in controller.c), so a freed planner buffer is
+ *	refilled immediately instead of waiting out a parse.
+ *
+ *	The parsed body is copied out of the shared nv list because status and
+ *	queue reports reset that list between pre-parse and execution. The stage
+ *	is sized for streaming traffic - a typical {"gc":"..."} line is one pair
+ *	with one string. Lines that don't fit are not staged (returns STAT_EAGAIN)
+ *	and fall back to the normal parse-on-dispatch path. Parse errors stage
+ *	normally so the error response is emitted in order.
+ */
+
+static struct jsonPreparse {			// sizes are set in json_parser.h
+	uint8_t staged;						// true if a parsed line is waiting for the planner
+	uint8_t count;						// number of staged nv pairs
+	stat_t parse_status;				// result of the staged parse
+	nvObj_t body[PREPARSE_MAX_PAIRS];
+	char_t string[PREPARSE_STRING_LEN];
+} jp;
+
+uint8_t json_preparse_staged() { return (jp.staged);}
+
+stat_t json_preparse(char_t *str)
+{
+	jp.parse_status = _json_parse(str);
+
+	// copy the parsed body out of the shared nv list
+	uint8_t i = 0;
+	uint8_t have_string = false;
+	for (nvObj_t *nv = nv_body; nv != NULL; nv = nv->nx) {
+		if (nv->valuetype == TYPE_EMPTY) { break;}
+		if (i == PREPARSE_MAX_PAIRS) { return (STAT_EAGAIN);}		// doesn't fit - don't stage
+#ifdef __BULK_SET
+		if (nv->valuetype == TYPE_ARRAY) { return (STAT_EAGAIN);}	// bset isn't streaming traffic - don't stage
+#endif
+		if (nv->valuetype == TYPE_STRING) {
+			if ((have_string) || (strlen((char_t *)*nv->stringp) >= PREPARSE_STRING_LEN)) {
+				return (STAT_EAGAIN);
+			}
+			strcpy(jp.string, (char_t *)*nv->stringp);
+			have_string = true;
+		}
+		jp.body[i++] = *nv;
+	}
+	jp.count = i;
+	jp.staged = true;
+	return (STAT_OK);
+}
+
+void json_execute_staged()
+{
+	nvObj_t *nv = nv_reset_nv_list();
+	for (uint8_t i=0; i<jp.count; i++) {
+		nvObj_t *pv = nv->pv;			// restore staged pairs, preserving the list links
+		nvObj_t *nx = nv->nx;
+		*nv = jp.body[i];
+		nv->pv = pv;
+		nv->nx = nx;
+		if (nv->valuetype == TYPE_STRING) { nv_copy_string(nv, jp.string);}
+		nv = nv->nx;
+	}
+	jp.staged = false;
+
+	stat_t status = jp.parse_status;
+	if (status == STAT_OK) { status = _json_execute();}
+	nv_print_list(status, TEXT_NO_PRINT, JSON_RESPONSE_FORMAT);
+	sr_request_status_report(SR_IMMEDIATE_REQUEST);
+}
+#endif // __PREPARSE
+
 /*
  * _normalize_json_string - normalize a JSON string in place
  *
@@ -194,14 +352,14 @@ static stat_t _normalize_json_string(char_t *str, uint16_t size)
 /*	RELAXED RULES
  *
  *	Quotes are accepted but not needed on names
- *	Quotes are required for string values
- *
+ *	Quotes are required for string values
+ *
  *	See build 406.xx or earlier for strict JSON parser - deleted in 407.03
- */
-
-#define MAX_PAD_CHARS 8
-#define MAX_NAME_CHARS 32
-
+ */
+
+#define MAX_PAD_CHARS 8
+#define MAX_NAME_CHARS 32
+
 static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 {
 	uint8_t i;
@@ -216,36 +374,36 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 	// --- Process name part ---
 	// Find, terminate and set pointers for the name. Allow for leading and trailing name quotes.
 	char_t * name = *pstr;
-	for (i=0; true; i++, (*pstr)++) {
-		if (strchr(leaders, (int)**pstr) == NULL) { 		// find leading character of name
-			name = (*pstr)++;
-			break;
-		}
-		if (i == MAX_PAD_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
-
-	// Find the end of name, NUL terminate and copy token
-	for (i=0; true; i++, (*pstr)++) {
-		if (strchr(separators, (int)**pstr) != NULL) {
+	for (i=0; true; i++, (*pstr)++) {
+		if (strchr(leaders, (int)**pstr) == NULL) { 		// find leading character of name
+			name = (*pstr)++;
+			break;
+		}
+		if (i == MAX_PAD_CHARS)
+            return (STAT_JSON_SYNTAX_ERROR);
+	}
+
+	// Find the end of name, NUL terminate and copy token
+	for (i=0; true; i++, (*pstr)++) {
+		if (strchr(separators, (int)**pstr) != NULL) {
 			*(*pstr)++ = NUL;
 			strncpy(nv->token, name, TOKEN_LEN+1);			// copy the string to the token
-			break;
-		}
-		if (i == MAX_NAME_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
-
-	// --- Process value part ---  (organized from most to least frequently encountered)
-
-	// Find the start of the value part
-	for (i=0; true; i++, (*pstr)++) {
-		if (isalnum((int)**pstr)) break;
-		if (strchr(value, (int)**pstr) != NULL) break;
-		if (i == MAX_PAD_CHARS)
-            return (STAT_JSON_SYNTAX_ERROR);
-	}
-
+			break;
+		}
+		if (i == MAX_NAME_CHARS)
+            return (STAT_JSON_SYNTAX_ERROR);
+	}
+
+	// --- Process value part ---  (organized from most to least frequently encountered)
+
+	// Find the start of the value part
+	for (i=0; true; i++, (*pstr)++) {
+		if (isalnum((int)**pstr)) break;
+		if (strchr(value, (int)**pstr) != NULL) break;
+		if (i == MAX_PAD_CHARS)
+            return (STAT_JSON_SYNTAX_ERROR);
+	}
+
 	// nulls (gets)
 	if ((**pstr == 'n') || ((**pstr == '\"') && (*(*pstr+1) == '\"'))) { // process null value
 		nv->valuetype = TYPE_NULL;
@@ -253,7 +411,11 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 
 	// numbers
 	} else if (isdigit(**pstr) || (**pstr == '-')) {// value is a number
-		nv->value = (float)strtod(*pstr, &tmp);	// tmp is the end pointer
+#ifdef __FAST_ATOF
+		nv->value = fatof(*pstr, &tmp);			// tmp is the end pointer
+#else
+		nv->value = (float)strtod(*pstr, &tmp);	// tmp is the end pointer
+#endif
 		if(tmp == *pstr)
             return (STAT_BAD_NUMBER_FORMAT);
 		nv->valuetype = TYPE_FLOAT;
@@ -273,17 +435,17 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
             return (STAT_JSON_SYNTAX_ERROR);    // find the end of the string
 		*tmp = NUL;
 
-		// if string begins with 0x it might be data, needs to be at least 3 chars long
-		if( strlen(*pstr)>=3 && (*pstr)[0]=='0' && (*pstr)[1]=='x')
-		{
-			uint32_t *v = (uint32_t*)&nv->value;
-			*v = strtoul((const char *)*pstr, 0L, 0);
-			nv->valuetype = TYPE_DATA;
-		} else {
-			ritorno(nv_copy_string(nv, *pstr));
-		}
-
-		*pstr = ++tmp;
+		// if string begins with 0x it might be data, needs to be at least 3 chars long
+		if( strlen(*pstr)>=3 && (*pstr)[0]=='0' && (*pstr)[1]=='x')
+		{
+			uint32_t *v = (uint32_t*)&nv->value;
+			*v = strtoul((const char *)*pstr, 0L, 0);
+			nv->valuetype = TYPE_DATA;
+		} else {
+			ritorno(nv_copy_string(nv, *pstr));
+		}
+
+		*pstr = ++tmp;
 
 	// boolean true/false
 	} else if (**pstr == 't') {
@@ -296,8 +458,21 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 	// arrays
 	} else if (**pstr == '[') {
 		nv->valuetype = TYPE_ARRAY;
+#ifdef __BULK_SET
+		if (strcmp(nv->token, "bset") == 0) {	// the only token that accepts an input array
+			if ((tmp = strchr(*pstr, ']')) == NULL)
+				return (STAT_JSON_SYNTAX_ERROR);
+			*tmp = NUL;
+			ritorno(nv_copy_string(nv, (*pstr)+1));	// copy array contents w/o the brackets
+			*pstr = ++tmp;
+		} else {
+			ritorno(nv_copy_string(nv, *pstr));	// copy array into string for error displays
+			return (STAT_UNSUPPORTED_TYPE);		// only bset takes input arrays
+		}
+#else
 		ritorno(nv_copy_string(nv, *pstr));		// copy array into string for error displays
 		return (STAT_UNSUPPORTED_TYPE);	        // return error as the parser doesn't do input arrays yet
+#endif
 
 	// general error condition
 	} else {
@@ -319,6 +494,56 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
 	return (STAT_OK);							// signal that parsing is complete
 }
 
+#ifdef __GC_TOKENIZER
+/*
+ * _tokenize_gc() - single-pass tokenizer for strict {"gc":"..."} lines
+ *
+ *	The general parser costs several passes per line: a normalization pass,
+ *	strchr scans for the name and string delimiters, and a strpbrk for the
+ *	terminator. Streaming traffic is almost entirely gcode wrappers, so match
+ *	that one form directly: one scan over the line with no backtracking, about
+ *	8 cycles/byte on the xmega plus the copy into the string pool (~5), versus
+ *	roughly 40 cycles/byte for normalize + _get_nv_pair(). Only runs in strict
+ *	syntax mode ($js=1) - the form is matched literally, lowercase, no padding.
+ *
+ *	Returns STAT_EAGAIN if the line is not a strict gcode wrapper, leaving the
+ *	string untouched so the general parser can take it from the top. The gcode
+ *	itself is passed through unnormalized - gc_gcode_parser() normalizes its
+ *	own block, exactly as it does for text mode input.
+ */
+
+static stat_t _tokenize_gc(char_t *str, nvObj_t *nv)
+{
+	static index_t gc_index = NO_MATCH;			// one-time lookup of the "gc" token
+
+	if (strncmp(str, "{\"gc\":\"", 7) != 0) { return (STAT_EAGAIN);}
+	char_t *value = str + 7;
+
+	char_t *end = value;						// scan for the closing quote
+	while (*end != '\"') {
+		if (*end == NUL) { return (STAT_EAGAIN);}	// no closing quote - not our form
+		end++;
+	}
+	str = end + 1;								// validate the tail before altering the string
+	if (*str++ != '}') { return (STAT_EAGAIN);}
+	while (*str != NUL) {
+		if (*str > ' ') { return (STAT_EAGAIN);}	// only trailing whitespace allowed
+		str++;
+	}
+	if (gc_index == NO_MATCH) {
+		gc_index = nv_get_index((const char_t *)"", (const char_t *)"gc");
+		if (gc_index == NO_MATCH) { return (STAT_EAGAIN);}	// no gc entry in the config table
+	}
+	*end = NUL;									// terminate and stage the gcode block
+	ritorno(nv_copy_string(nv, value));
+	nv->index = gc_index;
+	nv->valuetype = TYPE_STRING;
+	strcpy(nv->token, "gc");
+	nv->group[0] = NUL;							// list reset doesn't clear group fields
+	return (STAT_OK);
+}
+#endif // __GC_TOKENIZER
+
 /****************************************************************************
  * json_serialize() - make a JSON object string from JSON object array
  *
@@ -352,17 +577,17 @@ static stat_t _get_nv_pair(nvObj_t *nv, char_t **pstr, int8_t *depth)
  */
 
 #define BUFFER_MARGIN 8			// safety margin to avoid buffer overruns during footer checksum generation
-
-uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size)
-{
-#ifdef __SILENCE_JSON_RESPONSES
-	return (0);
-#else
+
+uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size)
+{
+#ifdef __SILENCE_JSON_RESPONSES
+	return (0);
+#else
 	char_t *str = out_buf;
 	char_t *str_max = out_buf + size - BUFFER_MARGIN;
 	int8_t initial_depth = nv->depth;
 	int8_t prev_depth = 0;
-	uint8_t need_a_comma = false;
+	uint8_t need_a_comma = false;
 
 	*str++ = '{'; 								// write opening curly
 
@@ -370,25 +595,31 @@ uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size)
 		if (nv->valuetype != TYPE_EMPTY) {
 			if (need_a_comma) { *str++ = ',';}
 			need_a_comma = true;
-			if (js.json_syntax == JSON_SYNTAX_RELAXED) {		// write name
-				str += sprintf((char *)str, "%s:", nv->token);
+			if (js.json_syntax == JSON_SYNTAX_RELAXED) {		// write name
+				str += sprintf((char *)str, "%s:", nv->token);
 			} else {
 				str += sprintf((char *)str, "\"%s\":", nv->token);
-			}
-
-			// check for illegal float values
-			if (nv->valuetype == TYPE_FLOAT) {
-				if (isnan((double)nv->value) || isinf((double)nv->value)) { nv->value = 0;}
-			}
-
-			// serialize output value
+			}
+
+			// check for illegal float values
+			if (nv->valuetype == TYPE_FLOAT) {
+				if (isnan((double)nv->value) || isinf((double)nv->value)) { nv->value = 0;}
+			}
+
+			// serialize output value
 			if		(nv->valuetype == TYPE_NULL)		{ str += (char_t)sprintf((char *)str, "null");} // Note that that "" is NOT null.
 			else if (nv->valuetype == TYPE_INTEGER)	{
+#ifdef __TYPED_CONFIG
+				str += (char_t)sprintf((char *)str, "%ld", (long)nv->value_int);	// native - no float formatting
+#elif defined(__FAST_FNTOA)
+				str += fntoa(str, nv->value, 0);	// integers are stored as floats
+#else
 				str += (char_t)sprintf((char *)str, "%1.0f", (double)nv->value);
+#endif
 			}
-			else if (nv->valuetype == TYPE_DATA)	{
-				uint32_t *v = (uint32_t*)&nv->value;
-				str += (char_t)sprintf((char *)str, "\"0x%lx\"", *v);
+			else if (nv->valuetype == TYPE_DATA)	{
+				uint32_t *v = (uint32_t*)&nv->value;
+				str += (char_t)sprintf((char *)str, "\"0x%lx\"", *v);
 			}
 			else if (nv->valuetype == TYPE_STRING)	{ str += (char_t)sprintf((char *)str, "\"%s\"",(char *)*nv->stringp);}
 			else if (nv->valuetype == TYPE_ARRAY)	{ str += (char_t)sprintf((char *)str, "[%s]",  (char *)*nv->stringp);}
@@ -419,9 +650,9 @@ uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size)
 	while (prev_depth-- > initial_depth) { *str++ = '}';}
 	str += sprintf((char *)str, "}\n");	// using sprintf for this last one ensures a NUL termination
 	if (str > out_buf + size) { return (-1);}
-	return (str - out_buf);
-#endif
-}
+	return (str - out_buf);
+#endif
+}
 
 /*
  * json_print_object() - serialize and print the nvObj array directly (w/o header & footer)
@@ -431,27 +662,31 @@ uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size)
  *	Object list should be terminated by nv->nx == NULL
  */
 void json_print_object(nvObj_t *nv)
-{
-#ifdef __SILENCE_JSON_RESPONSES
-	return;
-#endif
+{
+#ifdef __SILENCE_JSON_RESPONSES
+	return;
+#endif
 
-	json_serialize(nv, cs.out_buf, sizeof(cs.out_buf));
-	fprintf(stderr, "%s", (char *)cs.out_buf);
+	uint16_t strcount = json_serialize(nv, cs.out_buf, sizeof(cs.out_buf));
+#if defined(__USART_TX_DMA) && !defined(__REPORT_USART)
+	xio_write_usb(cs.out_buf, strcount);	// DMA block transmit (falls back to stdio)
+#else
+	fprintf(REPORT_STREAM, "%s", (char *)cs.out_buf);	// report traffic - see report.h for routing
+#endif
+}
+
+/*
+ * json_print_list() - command to select and produce a JSON formatted output
+ */
+
+void json_print_list(stat_t status, uint8_t flags)
+{
+	switch (flags) {
+		case JSON_NO_PRINT: { break; }
+		case JSON_OBJECT_FORMAT: { json_print_object(nv_body); break; }
+		case JSON_RESPONSE_FORMAT: { json_print_response(status); break; }
+	}
 }
-
-/*
- * json_print_list() - command to select and produce a JSON formatted output
- */
-
-void json_print_list(stat_t status, uint8_t flags)
-{
-	switch (flags) {
-		case JSON_NO_PRINT: { break; }
-		case JSON_OBJECT_FORMAT: { json_print_object(nv_body); break; }
-		case JSON_RESPONSE_FORMAT: { json_print_response(status); break; }
-	}
-}
 
 /*
  * json_print_response() - JSON responses with headers, footers and observing JSON verbosity
@@ -470,17 +705,129 @@ void json_print_list(stat_t status, uint8_t flags)
  *	which you may or may not want to display. This is followed by zero or more displayable objects.
  *	Then if you want a gcode line number you add that here to the end. Finally, a footer goes
  *	on all the (non-silent) responses.
+ *
+ *	__FOOTER_FLOW appends a flow-control advisory to the footer (revision 2):
+ *	free RX buffer bytes and planned time in the queue in milliseconds. A sender
+ *	can size its in-flight window from these instead of guessing - stop sending
+ *	when rx_free gets low, send faster when plan_ms runs down toward starvation.
  */
 #define MAX_TAIL_LEN 8
 
+#ifdef __ACK_WINDOW
+/*
+ * _js_print_ack() - emit a cumulative ack for the lines accepted so far
+ *
+ *	Windowed ack mode ($aw=N, negotiated by the host at connect) replaces the
+ *	per-line {r:{},f:[...]} response with one {ack:n,f:[...]} every N accepted
+ *	lines, where n is the highest contiguous line accepted (the N word, or a
+ *	running count for unnumbered streams). Errors and full responses flush the
+ *	pending ack first, so everything before the failing line is known-accepted
+ *	and the error attributes exactly. The idle flush callback covers the tail
+ *	of a stream that ends mid-window.
+ */
+static void _js_print_ack()
+{
+	if (js.ack_pending == false) { return;}
+	js.ack_pending = false;
+	js.ack_count = 0;
+
+#ifdef __FOOTER_FLOW
+	uint16_t n = sprintf((char *)cs.out_buf,
+		(js.json_syntax == JSON_SYNTAX_RELAXED) ? "{ack:%lu,f:[%d,%d,%d,%u,%lu," : "{\"ack\":%lu,\"f\":[%d,%d,%d,%u,%lu,",
+		js.ack_line, FOOTER_REVISION, STAT_OK, 0,
+		(uint16_t)xio_get_usb_rx_free(),
+		(uint32_t)(mp_get_planned_time() * 60000));			// planned time in the queue, in ms
+#else
+	uint16_t n = sprintf((char *)cs.out_buf,
+		(js.json_syntax == JSON_SYNTAX_RELAXED) ? "{ack:%lu,f:[%d,%d,%d," : "{\"ack\":%lu,\"f\":[%d,%d,%d,",
+		js.ack_line, FOOTER_REVISION, STAT_OK, 0);
+#endif
+	n += sprintf((char *)cs.out_buf + n, "%d]}\n", compute_checksum(cs.out_buf, n-1));
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(true);							// the ack must not wait behind queued report traffic
+#endif
+#ifdef __USART_TX_DMA
+	xio_write_usb(cs.out_buf, n);							// DMA block transmit (falls back to stdio)
+#else
+	fprintf(stderr, "%s", cs.out_buf);
+#endif
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(false);
+#endif
+}
+
+/*
+ * js_ack_flush_callback() - emit a pending ack once the stream goes quiet
+ * json_set_aw() - $aw - settle the old window before resizing it
+ */
+stat_t js_ack_flush_callback()
+{
+	if (js.ack_pending == false) { return (STAT_NOOP);}
+	if (SysTickTimer_getValue() < js.ack_systick) { return (STAT_NOOP);}
+	_js_print_ack();
+	return (STAT_OK);
+}
+
+stat_t json_set_aw(nvObj_t *nv)
+{
+	_js_print_ack();										// no-op unless an ack is pending
+	return (set_ui8(nv));
+}
+#endif // __ACK_WINDOW
+
+#ifdef __TERSE_ACK
+/*
+ * json_set_ta() - $ta - enter or leave terse ack mode
+ *
+ *	The acknowledgment of the $ta command itself is sent in the newly set mode,
+ *	so a host switching to terse should expect a token back, not JSON.
+ */
+stat_t json_set_ta(nvObj_t *nv)
+{
+#ifdef __ACK_WINDOW
+	if (js.ack_pending == true) { _js_print_ack();}			// settle any windowed acks first
+#endif
+	js.terse_line = 0;
+	return (set_01(nv));
+}
+#endif // __TERSE_ACK
+
 void json_print_response(uint8_t status)
-{
-#ifdef __SILENCE_JSON_RESPONSES
-	return;
-#endif
+{
+#ifdef __SILENCE_JSON_RESPONSES
+	return;
+#endif
 
 	if (js.json_verbosity == JV_SILENT) return;			// silent responses
 
+#ifdef __TERSE_ACK
+	// Terse ack mode ($ta=1, negotiated by the host at connect) replaces the
+	// response entirely with a fixed-form token "*<status>:<line>" - no echo,
+	// no footer, no nv list serialization. Cuts response bytes roughly 5x and
+	// reduces serialization to two integer conversions and one short write.
+	// The line counter is the N word when present, else a running count.
+	if (js.terse_ack == true) {
+#ifdef __ACK_WINDOW
+		if (js.ack_pending == true) { _js_print_ack();}		// settle acks issued before the switch
+#endif
+		js.terse_line = (cm.gm.linenum != 0) ? cm.gm.linenum : js.terse_line + 1;
+		cs.linelen = 0;
+		uint16_t n = sprintf((char *)cs.out_buf, "*%u:%lu\n", (uint16_t)status, js.terse_line);
+#ifdef __TX_PRIORITY
+		xio_set_tx_priority_usb(true);						// the ack must not wait behind queued report traffic
+#endif
+#ifdef __USART_TX_DMA
+		xio_write_usb(cs.out_buf, n);						// DMA block transmit (falls back to stdio)
+#else
+		fprintf(stderr, "%s", cs.out_buf);
+#endif
+#ifdef __TX_PRIORITY
+		xio_set_tx_priority_usb(false);
+#endif
+		return;
+	}
+#endif // __TERSE_ACK
+
 	// Body processing
 	nvObj_t *nv = nv_body;
 	if (status == STAT_JSON_SYNTAX_ERROR) {
@@ -491,7 +838,12 @@ void json_print_response(uint8_t status)
 		uint8_t nv_type;
 		do {
 			if ((nv_type = nv_get_type(nv)) == NV_TYPE_NULL) break;
-
+#ifdef __JV_MASK
+			if ((js.echo_suppress_mask & (1 << nv_type)) ||
+				((nv_type == NV_TYPE_LINENUM) && (fp_ZERO(nv->value)))) {	// never report line number 0
+				nv->valuetype = TYPE_EMPTY;
+			}
+#else
 			if (nv_type == NV_TYPE_GCODE) {
 				if (js.echo_json_gcode_block == false) {	// kill command echo if not enabled
 					nv->valuetype = TYPE_EMPTY;
@@ -512,9 +864,64 @@ void json_print_response(uint8_t status)
 					nv->valuetype = TYPE_EMPTY;
 				}
 			}
+#endif	// __JV_MASK
 		} while ((nv = nv->nx) != NULL);
 	}
 
+#ifdef __FAST_ACK
+	// Fast ack path. In the streaming case the echo suppression above empties the
+	// body entirely and the response reduces to a fixed shell around the footer.
+	// Emit it with two sprintf's instead of serializing the nv list, computing the
+	// checksum over the same characters json_serialize() would have produced.
+	if (js.json_footer_depth == 0) {
+		nvObj_t *scan = nv_body;
+		while ((scan != NULL) && (scan->valuetype == TYPE_EMPTY)) { scan = scan->nx;}
+		if (scan == NULL) {									// nothing to report but the footer
+#ifdef __ACK_WINDOW
+			if (js.ack_window > 1) {
+				if (status == STAT_OK) {					// accumulate instead of acking every line
+					js.ack_line = (cm.gm.linenum != 0) ? cm.gm.linenum : js.ack_line + 1;
+					js.ack_pending = true;
+					js.ack_systick = SysTickTimer_getValue() + ACK_WINDOW_FLUSH_MS;
+					cs.linelen = 0;
+					if (++js.ack_count >= js.ack_window) { _js_print_ack();}
+					return;
+				}
+				_js_print_ack();	// error: ack the lines accepted before it, then report it normally
+			}
+#endif
+#ifdef __FOOTER_FLOW
+			uint16_t n = sprintf((char *)cs.out_buf,
+				(js.json_syntax == JSON_SYNTAX_RELAXED) ? "{r:{},f:[%d,%d,%d,%u,%lu," : "{\"r\":{},\"f\":[%d,%d,%d,%u,%lu,",
+				FOOTER_REVISION, status, cs.linelen,
+				(uint16_t)xio_get_usb_rx_free(),
+				(uint32_t)(mp_get_planned_time() * 60000));	// planned time in the queue, in ms
+#else
+			uint16_t n = sprintf((char *)cs.out_buf,
+				(js.json_syntax == JSON_SYNTAX_RELAXED) ? "{r:{},f:[%d,%d,%d," : "{\"r\":{},\"f\":[%d,%d,%d,",
+				FOOTER_REVISION, status, cs.linelen);
+#endif
+			cs.linelen = 0;									// reset linelen so it's only reported once
+			n += sprintf((char *)cs.out_buf + n, "%d]}\n", compute_checksum(cs.out_buf, n-1));
+#ifdef __TX_PRIORITY
+			xio_set_tx_priority_usb(true);					// the ack must not wait behind queued report traffic
+#endif
+#ifdef __USART_TX_DMA
+			xio_write_usb(cs.out_buf, n);					// DMA block transmit (falls back to stdio)
+#else
+			fprintf(stderr, "%s", cs.out_buf);
+#endif
+#ifdef __TX_PRIORITY
+			xio_set_tx_priority_usb(false);
+#endif
+			return;
+		}
+	}
+#endif // __FAST_ACK
+
+#ifdef __ACK_WINDOW
+	if (js.ack_pending == true) { _js_print_ack();}			// a full response must not reorder around pending acks
+#endif
 	// Footer processing
 	while(nv->valuetype != TYPE_EMPTY) {					// find a free nvObj at end of the list...
 		if ((nv = nv->nx) == NULL) {						//...or hit the NULL and return w/o a footer
@@ -523,7 +930,13 @@ void json_print_response(uint8_t status)
 		}
 	}
 	char_t footer_string[NV_FOOTER_LEN];
+#ifdef __FOOTER_FLOW
+	sprintf((char *)footer_string, "%d,%d,%d,%u,%lu,0", FOOTER_REVISION, status, cs.linelen,
+		(uint16_t)xio_get_usb_rx_free(),
+		(uint32_t)(mp_get_planned_time() * 60000));			// planned time in the queue, in ms
+#else
 	sprintf((char *)footer_string, "%d,%d,%d,0", FOOTER_REVISION, status, cs.linelen);
+#endif
 	cs.linelen = 0;											// reset linelen so it's only reported once
 
 	nv_copy_string(nv, footer_string);						// link string to nv object
@@ -545,66 +958,99 @@ void json_print_response(uint8_t status)
 
 	while (cs.out_buf[strcount2] != ',') { strcount2--; }// find start of checksum
 	sprintf((char *)cs.out_buf + strcount2 + 1, "%d%s", compute_checksum(cs.out_buf, strcount2), tail);
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(true);					// the response must not wait behind queued report traffic
+#endif
+#ifdef __USART_TX_DMA
+	xio_write_usb(cs.out_buf, strlen(cs.out_buf));	// DMA block transmit (falls back to stdio)
+#else
 	fprintf(stderr, "%s", cs.out_buf);
+#endif
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(false);
+#endif
+}
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+/*
+ * json_set_jv()
+ */
+
+stat_t json_set_jv(nvObj_t *nv)
+{
+	if (nv->value > JV_VERBOSE)
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+	js.json_verbosity = nv->value;
+
+	js.echo_json_footer = false;
+	js.echo_json_messages = false;
+	js.echo_json_configs = false;
+	js.echo_json_linenum = false;
+	js.echo_json_gcode_block = false;
+
+	if (nv->value >= JV_FOOTER) 	{ js.echo_json_footer = true;}
+	if (nv->value >= JV_MESSAGES)	{ js.echo_json_messages = true;}
+	if (nv->value >= JV_CONFIGS)	{ js.echo_json_configs = true;}
+	if (nv->value >= JV_LINENUM)	{ js.echo_json_linenum = true;}
+	if (nv->value >= JV_VERBOSE)	{ js.echo_json_gcode_block = true;}
+
+#ifdef __JV_MASK
+	// compile the policy into a per-type suppress mask so the response loop
+	// tests one bit per object instead of walking the flag chain
+	js.echo_suppress_mask = 0;
+	if (!js.echo_json_gcode_block)	{ js.echo_suppress_mask |= (1 << NV_TYPE_GCODE);}
+	if (!js.echo_json_messages)		{ js.echo_suppress_mask |= (1 << NV_TYPE_MESSAGE);}
+	if (!js.echo_json_linenum)		{ js.echo_suppress_mask |= (1 << NV_TYPE_LINENUM);}
+#endif
+
+	return(STAT_OK);
+}
+
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+/*
+ * js_print_ej()
+ * js_print_jv()
+ * js_print_j2()
+ * js_print_fs()
+ * js_print_aw()
+ * js_print_ta()
+ */
+
+static const char fmt_ej[] PROGMEM = "[ej]  enable json mode%13d [0=text,1=JSON]\n";
+static const char fmt_jv[] PROGMEM = "[jv]  json verbosity%15d [0=silent,1=footer,2=messages,3=configs,4=linenum,5=verbose]\n";
+static const char fmt_js[] PROGMEM = "[js]  json serialize style%9d [0=relaxed,1=strict]\n";
+static const char fmt_fs[] PROGMEM = "[fs]  footer style%17d [0=new,1=old]\n";
+#ifdef __ACK_WINDOW
+static const char fmt_aw[] PROGMEM = "[aw]  ack window%19d [0,1=ack every line]\n";
+#endif
+#ifdef __TERSE_ACK
+static const char fmt_ta[] PROGMEM = "[ta]  terse ack mode%15d [0=JSON,1=terse]\n";
+#endif
+
+void js_print_ej(nvObj_t *nv) { text_print_ui8(nv, fmt_ej);}
+void js_print_jv(nvObj_t *nv) { text_print_ui8(nv, fmt_jv);}
+void js_print_js(nvObj_t *nv) { text_print_ui8(nv, fmt_js);}
+void js_print_fs(nvObj_t *nv) { text_print_ui8(nv, fmt_fs);}
+#ifdef __ACK_WINDOW
+void js_print_aw(nvObj_t *nv) { text_print_ui8(nv, fmt_aw);}
+#endif
+#ifdef __TERSE_ACK
+void js_print_ta(nvObj_t *nv) { text_print_ui8(nv, fmt_ta);}
+#endif
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
 }
-
-/***********************************************************************************
- * CONFIGURATION AND INTERFACE FUNCTIONS
- * Functions to get and set variables from the cfgArray table
- ***********************************************************************************/
-
-/*
- * json_set_jv()
- */
-
-stat_t json_set_jv(nvObj_t *nv)
-{
-	if (nv->value > JV_VERBOSE)
-        return (STAT_INPUT_VALUE_RANGE_ERROR);
-	js.json_verbosity = nv->value;
-
-	js.echo_json_footer = false;
-	js.echo_json_messages = false;
-	js.echo_json_configs = false;
-	js.echo_json_linenum = false;
-	js.echo_json_gcode_block = false;
-
-	if (nv->value >= JV_FOOTER) 	{ js.echo_json_footer = true;}
-	if (nv->value >= JV_MESSAGES)	{ js.echo_json_messages = true;}
-	if (nv->value >= JV_CONFIGS)	{ js.echo_json_configs = true;}
-	if (nv->value >= JV_LINENUM)	{ js.echo_json_linenum = true;}
-	if (nv->value >= JV_VERBOSE)	{ js.echo_json_gcode_block = true;}
-
-	return(STAT_OK);
-}
-
-
-/***********************************************************************************
- * TEXT MODE SUPPORT
- * Functions to print variables from the cfgArray table
- ***********************************************************************************/
-
-#ifdef __TEXT_MODE
-
-/*
- * js_print_ej()
- * js_print_jv()
- * js_print_j2()
- * js_print_fs()
- */
-
-static const char fmt_ej[] PROGMEM = "[ej]  enable json mode%13d [0=text,1=JSON]\n";
-static const char fmt_jv[] PROGMEM = "[jv]  json verbosity%15d [0=silent,1=footer,2=messages,3=configs,4=linenum,5=verbose]\n";
-static const char fmt_js[] PROGMEM = "[js]  json serialize style%9d [0=relaxed,1=strict]\n";
-static const char fmt_fs[] PROGMEM = "[fs]  footer style%17d [0=new,1=old]\n";
-
-void js_print_ej(nvObj_t *nv) { text_print_ui8(nv, fmt_ej);}
-void js_print_jv(nvObj_t *nv) { text_print_ui8(nv, fmt_jv);}
-void js_print_js(nvObj_t *nv) { text_print_ui8(nv, fmt_js);}
-void js_print_fs(nvObj_t *nv) { text_print_ui8(nv, fmt_fs);}
-
-#endif // __TEXT_MODE
-
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+#endif // __cplusplus
@@ -28,9 +28,9 @@
 #ifndef _JSON_PARSER_H_ONCE
 #define _JSON_PARSER_H_ONCE
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /**** Configs, Definitions and Structures ****/
 
@@ -38,10 +38,19 @@ extern "C"{
 // for now there is only one JSON array in use - the footer
 // if you add these make sure there are no collisions w/present or past numbers
 
+#ifdef __FOOTER_FLOW
+#define FOOTER_REVISION 2	// footer is [revision, status, linelen, rx_free, plan_ms, checksum]
+#else
 #define FOOTER_REVISION 1
-
+#endif
+
 #define JSON_OUTPUT_STRING_MAX (OUTPUT_BUFFER_LEN)
 
+#ifdef __PREPARSE
+#define PREPARSE_MAX_PAIRS 6			// staged nv pairs (> needed for a gc line + linenum)
+#define PREPARSE_STRING_LEN 128			// staged string storage (one string value per line)
+#endif
+
 enum jsonVerbosity {
 	JV_SILENT = 0,					// no response is provided for any command
 	JV_FOOTER,						// returns footer only (no command echo, gcode blocks or messages)
@@ -62,6 +71,10 @@ enum jsonSyntaxMode {
 	JSON_SYNTAX_STRICT				// requires quotes on names
 };
 
+#ifdef __ACK_WINDOW
+#define ACK_WINDOW_FLUSH_MS 50			// emit a pending cumulative ack after this much line silence
+#endif
+
 typedef struct jsSingleton {
 
 	/*** config values (PUBLIC) ***/
@@ -69,6 +82,12 @@ typedef struct jsSingleton {
 	uint8_t json_footer_depth;		// 0=footer is peer to response 'r', 1=child of response 'r'
 //	uint8_t json_footer_style;		// select footer style
 	uint8_t json_syntax;			// 0=relaxed syntax, 1=strict syntax
+#ifdef __ACK_WINDOW
+	uint8_t ack_window;				// $aw - ack every N streamed lines; 0 or 1 = ack per line
+#endif
+#ifdef __TERSE_ACK
+	uint8_t terse_ack;				// $ta - emit fixed-form acks instead of JSON responses
+#endif
 
 	uint8_t echo_json_footer;		// flags for JSON responses serialization
 	uint8_t echo_json_messages;
@@ -78,6 +97,19 @@ typedef struct jsSingleton {
 
 	/*** runtime values (PRIVATE) ***/
 
+#ifdef __JV_MASK
+	uint8_t echo_suppress_mask;		// nvType bits to blank per response - compiled by json_set_jv()
+#endif
+#ifdef __ACK_WINDOW
+	uint8_t ack_count;				// accepted lines accumulated in the current window
+	uint8_t ack_pending;			// an unsent cumulative ack is outstanding
+	uint32_t ack_line;				// highest contiguous line accepted (N word, or a running count)
+	uint32_t ack_systick;			// systick deadline for the idle flush
+#endif
+#ifdef __TERSE_ACK
+	uint32_t terse_line;			// line counter for terse acks (N word, or a running count)
+#endif
+
 } jsSingleton_t;
 
 /**** Externs - See report.c for allocation ****/
@@ -87,12 +119,24 @@ extern jsSingleton_t js;
 /**** Function Prototypes ****/
 
 void json_parser(char_t *str);
+#ifdef __PREPARSE
+stat_t json_preparse(char_t *str);
+uint8_t json_preparse_staged(void);
+void json_execute_staged(void);
+#endif
 uint16_t json_serialize(nvObj_t *nv, char_t *out_buf, uint16_t size);
 void json_print_object(nvObj_t *nv);
 void json_print_response(uint8_t status);
 void json_print_list(stat_t status, uint8_t flags);
 
 stat_t json_set_jv(nvObj_t *nv);
+#ifdef __ACK_WINDOW
+stat_t json_set_aw(nvObj_t *nv);
+stat_t js_ack_flush_callback(void);		// called by controller dispatcher
+#endif
+#ifdef __TERSE_ACK
+stat_t json_set_ta(nvObj_t *nv);
+#endif
 
 #ifdef __TEXT_MODE
 
@@ -100,6 +144,12 @@ stat_t json_set_jv(nvObj_t *nv);
 	void js_print_jv(nvObj_t *nv);
 	void js_print_js(nvObj_t *nv);
 	void js_print_fs(nvObj_t *nv);
+#ifdef __ACK_WINDOW
+	void js_print_aw(nvObj_t *nv);
+#endif
+#ifdef __TERSE_ACK
+	void js_print_ta(nvObj_t *nv);
+#endif
 
 #else
 
@@ -107,11 +157,17 @@ stat_t json_set_jv(nvObj_t *nv);
 	#define js_print_jv tx_print_stub
 	#define js_print_js tx_print_stub
 	#define js_print_fs tx_print_stub
+#ifdef __ACK_WINDOW
+	#define js_print_aw tx_print_stub
+#endif
+#ifdef __TERSE_ACK
+	#define js_print_ta tx_print_stub
+#endif
 
 #endif // __TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
 
 #endif // End of include guard: JSON_PARSER_H_ONCE
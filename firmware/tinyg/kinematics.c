@@ -24,24 +24,119 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-
+
 #include "tinyg.h"
 #include "config.h"
+#include "settings.h"			// machine profiles may override the KINEMATICS selection
 #include "canonical_machine.h"
 #include "stepper.h"
 #include "kinematics.h"
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __MESH_COMP
+/* Mesh Z-compensation
+ *
+ *	A grid probing cycle (cycle_probing.c) leaves a height map behind; with a map
+ *	attached every Z target gets a bilinearly interpolated correction added on
+ *	its way to motor space, so a warped sheet is followed without the host
+ *	rewriting the toolpath. The correction is applied here - in the per-segment
+ *	inverse kinematics - which keeps it continuous along a move for a few
+ *	multiplies per segment. The map itself stays in the probing cycle's buffer;
+ *	this module only borrows a pointer, and the cycle detaches it before
+ *	reusing the buffer for a new grid.
+ *
+ *	Targets outside the probed rectangle are clamped to the edge of the map -
+ *	extrapolating a warp measurement is guesswork, holding the edge value is not.
+ */
+
+typedef struct knMesh {
+	uint8_t active;					// compensation is being applied
+	uint8_t nx;						// map columns
+	uint8_t ny;						// map rows
+	float x0, y0;					// map origin, absolute machine coords
+	float dx, dy;					// point pitch (0 if a dimension is degenerate)
+	const float *z;					// row-major height map, borrowed from the grid cycle
+} knMesh_t;
+static knMesh_t mesh;
+
+void kn_mesh_attach(float x0, float y0, float dx, float dy,
+					uint8_t nx, uint8_t ny, const float *z, uint8_t enable)
+{
+	mesh.x0 = x0;
+	mesh.y0 = y0;
+	mesh.dx = dx;
+	mesh.dy = dy;
+	mesh.nx = nx;
+	mesh.ny = ny;
+	mesh.z = z;
+	mesh.active = ((z != NULL) && enable);
+}
+
+void kn_mesh_detach()
+{
+	mesh.active = false;
+	mesh.z = NULL;
+}
+
+stat_t kn_mesh_enable(uint8_t enable)
+{
+	if ((enable == true) && (mesh.z == NULL)) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	mesh.active = ((mesh.z != NULL) && enable);
+	return (STAT_OK);
+}
+
+uint8_t kn_mesh_state() { return (mesh.active);}
 
-//static void _inverse_kinematics(float travel[], float joint[]);
+static float _mesh_z_offset(float x, float y)
+{
+	float gx = 0;
+	float gy = 0;
+	uint8_t ix = 0;
+	uint8_t iy = 0;
+
+	if (mesh.nx > 1) {
+		gx = (x - mesh.x0) / mesh.dx;
+		if (gx < 0) { gx = 0;} else if (gx > (mesh.nx - 1)) { gx = mesh.nx - 1;}
+		ix = (uint8_t)gx;
+		if (ix > (uint8_t)(mesh.nx - 2)) { ix = mesh.nx - 2;}	// interpolate within the last cell
+		gx -= ix;
+	}
+	if (mesh.ny > 1) {
+		gy = (y - mesh.y0) / mesh.dy;
+		if (gy < 0) { gy = 0;} else if (gy > (mesh.ny - 1)) { gy = mesh.ny - 1;}
+		iy = (uint8_t)gy;
+		if (iy > (uint8_t)(mesh.ny - 2)) { iy = mesh.ny - 2;}
+		gy -= iy;
+	}
+	const float *z00 = &mesh.z[(iy * mesh.nx) + ix];
+	float zx0 = z00[0];										// interpolate along X on both rows...
+	float zx1 = zx0;
+	if (mesh.nx > 1) { zx0 += gx * (z00[1] - z00[0]);}
+	if (mesh.ny > 1) {
+		const float *z01 = z00 + mesh.nx;
+		zx1 = z01[0];
+		if (mesh.nx > 1) { zx1 += gx * (z01[1] - z01[0]);}
+	}
+	return (zx0 + (gy * (zx1 - zx0)));						// ...then along Y between them
+}
+#endif // __MESH_COMP
+
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /*
- * ik_kinematics() - wrapper routine for inverse kinematics
+ * ik_kinematics() - inverse kinematics, specialized at compile time (see kinematics.h)
  *
- *	Calls kinematics function(s).
- *	Performs axis mapping & conversion of length units to steps (and deals with inhibited axes)
+ *	Transforms axis travel to joint (motor) space, performs axis mapping and converts
+ *	length units to steps (and deals with inhibited axes).
+ *
+ *	This function runs during the _exec() portion of the cycle and is called once per
+ *	interpolation segment, so it has a hard time budget. The total time for the segment
+ *	load, including the kinematics transformation, cannot exceed the segment time, and
+ *	ideally should be no more than 25-50% of the segment time. Currently segments run
+ *	every 5 ms. This is why the specialization is done with the preprocessor rather
+ *	than a transform function pointer: the dominant (cartesian) case reduces to one
+ *	indexed multiply per motor with no transform, loop, or call overhead.
  *
  *	The reason steps are returned as floats (as opposed to, say, uint32_t) is to accommodate
  *	fractional DDA steps. The DDA deals with fractional step values as fixed-point binary in
@@ -49,61 +144,93 @@ extern "C"{
  *	as floats and converted to fixed-point binary during queue loading. See stepper.c for details.
  */
 
-void ik_kinematics(const float travel[], float steps[])
-{
-	float joint[AXES];
-
-//	_inverse_kinematics(travel, joint);				// you can insert inverse kinematics transformations here
-	memcpy(joint, travel, sizeof(float)*AXES);		//...or just do a memcpy for Cartesian machines
-
-	// Map motors to axes and convert length units to steps
-	// Most of the conversion math has already been done in during config in steps_per_unit()
-	// which takes axis travel, step angle and microsteps into account.
-	for (uint8_t axis=0; axis<AXES; axis++) {
-		if (cm.a[axis].axis_mode == AXIS_INHIBITED) { joint[axis] = 0;}
-		if (st_cfg.mot[MOTOR_1].motor_map == axis) { steps[MOTOR_1] = joint[axis] * st_cfg.mot[MOTOR_1].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_2].motor_map == axis) { steps[MOTOR_2] = joint[axis] * st_cfg.mot[MOTOR_2].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_3].motor_map == axis) { steps[MOTOR_3] = joint[axis] * st_cfg.mot[MOTOR_3].steps_per_unit;}
-		if (st_cfg.mot[MOTOR_4].motor_map == axis) { steps[MOTOR_4] = joint[axis] * st_cfg.mot[MOTOR_4].steps_per_unit;}
+#ifdef __CONST_PROFILE
+
+// Fixed-configuration build: motor mapping and steps-per-unit come from the
+// profile constants (settings_const.h), so each indexed multiply folds to a
+// load of a precomputed value instead of chasing through st_cfg. Axis inhibit
+// is still read live - it's an operational state, not machine geometry.
+static const uint8_t motor_map_ct[MOTORS] = MOTOR_MAP_CT;
+static const float steps_per_unit_ct[MOTORS] = STEPS_PER_UNIT_CT;
+
+#define _joint_steps(joint, motor) \
+	((cm.a[motor_map_ct[motor]].axis_mode == AXIS_INHIBITED) ? 0 : \
+	 (joint)[motor_map_ct[motor]] * steps_per_unit_ct[motor])
+
+#else
+
+// Map one motor to its axis and convert length units to steps. Most of the conversion
+// math has already been done during config in steps_per_unit(), which takes axis
+// travel, step angle and microsteps into account. The axis a motor tracks is indexed
+// directly off its motor_map instead of scanning all axes against all motors.
+#define _joint_steps(joint, motor) \
+	((cm.a[st_cfg.mot[motor].motor_map].axis_mode == AXIS_INHIBITED) ? 0 : \
+	 (joint)[st_cfg.mot[motor].motor_map] * st_cfg.mot[motor].steps_per_unit)
+
+#endif	// __CONST_PROFILE
+
+#define _map_motors(joint, steps) \
+	steps[MOTOR_1] = _joint_steps(joint, MOTOR_1); \
+	steps[MOTOR_2] = _joint_steps(joint, MOTOR_2); \
+	steps[MOTOR_3] = _joint_steps(joint, MOTOR_3); \
+	steps[MOTOR_4] = _joint_steps(joint, MOTOR_4); \
+	_map_motor_5(joint, steps) \
+	_map_motor_6(joint, steps)
+
 #if (MOTORS >= 5)
-		if (st_cfg.mot[MOTOR_5].motor_map == axis) { steps[MOTOR_5] = joint[axis] * st_cfg.mot[MOTOR_5].steps_per_unit;}
+#define _map_motor_5(joint, steps) steps[MOTOR_5] = _joint_steps(joint, MOTOR_5);
+#else
+#define _map_motor_5(joint, steps)
 #endif
 #if (MOTORS >= 6)
-		if (st_cfg.mot[MOTOR_6].motor_map == axis) { steps[MOTOR_6] = joint[axis] * st_cfg.mot[MOTOR_6].steps_per_unit;}
+#define _map_motor_6(joint, steps) steps[MOTOR_6] = _joint_steps(joint, MOTOR_6);
+#else
+#define _map_motor_6(joint, steps)
 #endif
-	}
 
-/* The above is a loop unrolled version of this:
-	for (uint8_t axis=0; axis<AXES; axis++) {
-		for (uint8_t motor=0; motor<MOTORS; motor++) {
-			if (st_cfg.mot[motor].motor_map == axis) {
-				steps[motor] = joint[axis] * st_cfg.mot[motor].steps_per_unit;
-			}
-		}
+#if (KINEMATICS == KINE_CARTESIAN)
+
+void ik_kinematics(const float travel[], float steps[])
+{
+#ifdef __MESH_COMP
+	if (mesh.active) {
+		float adjusted[AXES];
+		for (uint8_t i=0; i<AXES; i++) { adjusted[i] = travel[i];}
+		adjusted[AXIS_Z] += _mesh_z_offset(travel[AXIS_X], travel[AXIS_Y]);
+		_map_motors(adjusted, steps);
+		return;
 	}
-*/
+#endif
+	_map_motors(travel, steps);			// cartesian - no joint transform, use travel directly
 }
 
-/*
- * _inverse_kinematics() - inverse kinematics - example is for a cartesian machine
- *
- *	You can glue in inverse kinematics here, but be aware of time budget constrants.
- *	This function is run during the _exec() portion of the cycle and will therefore
- *	be run once per interpolation segment. The total time for the segment load,
- *	including the inverse kinematics transformation cannot exceed the segment time,
- *	and ideally should be no more than 25-50% of the segment time. Currently segments
- *	run avery 5 ms, but this might be lowered. To profile this time look at the
- *	time it takes to complete the mp_exec_move() function.
- */
-/*
-static void _inverse_kinematics(float travel[], float joint[])
+#elif (KINEMATICS == KINE_COREXY)
+
+void ik_kinematics(const float travel[], float steps[])
 {
-	for (uint8_t i=0; i<AXES; i++) {
-		joint[i] = travel[i];
-	}
+	float joint[AXES];					// belt transform on the motors mapped to X and Y
+
+	joint[AXIS_X] = travel[AXIS_X] + travel[AXIS_Y];	// A motor
+	joint[AXIS_Y] = travel[AXIS_X] - travel[AXIS_Y];	// B motor
+#ifdef __MESH_COMP
+	joint[AXIS_Z] = travel[AXIS_Z] +
+		((mesh.active) ? _mesh_z_offset(travel[AXIS_X], travel[AXIS_Y]) : 0);
+#else
+	joint[AXIS_Z] = travel[AXIS_Z];
+#endif
+	joint[AXIS_A] = travel[AXIS_A];
+	joint[AXIS_B] = travel[AXIS_B];
+	joint[AXIS_C] = travel[AXIS_C];
+
+	_map_motors(joint, steps);
 }
-*/
 
-#ifdef __cplusplus
-}
-#endif
+#elif (KINEMATICS == KINE_ROTARY_DELTA)
+#error rotary delta kinematics are not implemented yet
+#else
+#error unrecognized KINEMATICS setting
+#endif
+
+#ifdef __cplusplus
+}
+#endif
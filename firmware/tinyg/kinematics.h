@@ -28,9 +28,25 @@
 #ifndef KINEMATICS_H_ONCE
 #define KINEMATICS_H_ONCE
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+/* Kinematics selection
+ *
+ *	Kinematics are selected at compile time so the cartesian case - which is
+ *	in the per-segment exec path - compiles down to straight multiplies with
+ *	no transform or loop overhead. Machine profiles (settings_xxx.h) may
+ *	override KINEMATICS; it defaults to cartesian.
+ */
+
+#define KINE_CARTESIAN		0		// no joint transform - motors track mapped axes directly
+#define KINE_COREXY			1		// A = x+y, B = x-y belt transform on the X and Y motors
+#define KINE_ROTARY_DELTA	2		// placeholder - not implemented yet
+
+#ifndef KINEMATICS
+#define KINEMATICS KINE_CARTESIAN
+#endif
 
 /*
  * Global Scope Functions
@@ -38,12 +54,20 @@ extern "C"{
 
 void ik_kinematics(const float travel[], float steps[]);
 
+#ifdef __MESH_COMP
+void kn_mesh_attach(float x0, float y0, float dx, float dy,	// bind a probed height map (see cycle_probing.c)
+					uint8_t nx, uint8_t ny, const float *z, uint8_t enable);
+void kn_mesh_detach(void);							// drop the map and disable compensation
+stat_t kn_mesh_enable(uint8_t enable);				// {mesh:1|0} - toggle an attached map
+uint8_t kn_mesh_state(void);						// 0=off, 1=compensating
+#endif
+
 //#ifdef __UNIT_TESTS
 //void ik_unit_tests(void);
 //#endif
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
 
 #endif // End of include Guard: KINEMATICS_H_ONCE
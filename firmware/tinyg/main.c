@@ -1,9 +1,9 @@
 /*
  * main.c - TinyG - An embedded rs274/ngc CNC controller
- * This file is part of the TinyG project.
- *
- * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
- * Copyright (c) 2013 - 2015 Robert Giseburt
+ * This file is part of the TinyG project.
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2013 - 2015 Robert Giseburt
  *
  * This file ("the software") is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License, version 2 as published by the
@@ -33,7 +33,12 @@
 #include "network.h"
 #include "switch.h"
 #include "test.h"
+#include "diagnostics.h"
+#include "strpack.h"
 #include "pwm.h"
+#include "raster.h"
+#include "thc.h"
+#include "afc.h"
 #include "xio.h"
 
 #ifdef __AVR
@@ -42,80 +47,84 @@
 #endif // __AVR
 
 #ifdef __ARM
-#include "MotateTimers.h"
-using Motate::delay;
+#include "MotateTimers.h"
+using Motate::delay;
 
-#ifdef __cplusplus
-extern "C"{
-#endif // __cplusplus
+#ifdef __cplusplus
+extern "C"{
+#endif // __cplusplus
 
-void _init() __attribute__ ((weak));
+void _init() __attribute__ ((weak));
 void _init() {;}
 
-void __libc_init_array(void);
+void __libc_init_array(void);
 
-#ifdef __cplusplus
-}
-#endif // __cplusplus
+#ifdef __cplusplus
+}
+#endif // __cplusplus
 #endif // __ARM
 
-/******************** Application Code ************************/
-
-#ifdef __ARM
-const Motate::USBSettings_t Motate::USBSettings = {
-	/*gVendorID         = */ 0x1d50,
-	/*gProductID        = */ 0x606d,
-	/*gProductVersion   = */ TINYG_FIRMWARE_VERSION,
-	/*gAttributes       = */ kUSBConfigAttributeSelfPowered,
-	/*gPowerConsumption = */ 500
-};
-	/*gProductVersion   = */ //0.1,
-
-Motate::USBDevice< Motate::USBCDC > usb;
-//Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
-
-typeof usb._mixin_0_type::Serial &SerialUSB = usb._mixin_0_type::Serial;
-//typeof usb._mixin_1_type::Serial &SerialUSB1 = usb._mixin_1_type::Serial;
-
-MOTATE_SET_USB_VENDOR_STRING( {'S' ,'y', 'n', 't', 'h', 'e', 't', 'o', 's'} )
-MOTATE_SET_USB_PRODUCT_STRING( {'T', 'i', 'n', 'y', 'G', ' ', 'v', '2'} )
-MOTATE_SET_USB_SERIAL_NUMBER_STRING( {'0','0','1'} )
-
-Motate::SPI<kSocket4_SPISlaveSelectPinNumber> spi;
-#endif
+/******************** Application Code ************************/
+
+#ifdef __ARM
+const Motate::USBSettings_t Motate::USBSettings = {
+	/*gVendorID         = */ 0x1d50,
+	/*gProductID        = */ 0x606d,
+	/*gProductVersion   = */ TINYG_FIRMWARE_VERSION,
+	/*gAttributes       = */ kUSBConfigAttributeSelfPowered,
+	/*gPowerConsumption = */ 500
+};
+	/*gProductVersion   = */ //0.1,
+
+Motate::USBDevice< Motate::USBCDC > usb;
+//Motate::USBDevice< Motate::USBCDC, Motate::USBCDC > usb;
+
+typeof usb._mixin_0_type::Serial &SerialUSB = usb._mixin_0_type::Serial;
+//typeof usb._mixin_1_type::Serial &SerialUSB1 = usb._mixin_1_type::Serial;
+
+MOTATE_SET_USB_VENDOR_STRING( {'S' ,'y', 'n', 't', 'h', 'e', 't', 'o', 's'} )
+MOTATE_SET_USB_PRODUCT_STRING( {'T', 'i', 'n', 'y', 'G', ' ', 'v', '2'} )
+MOTATE_SET_USB_SERIAL_NUMBER_STRING( {'0','0','1'} )
+
+Motate::SPI<kSocket4_SPISlaveSelectPinNumber> spi;
+#endif
 
 /*
  * _system_init()
  */
 
-void _system_init(void)
-{
-#ifdef __ARM
-	SystemInit();
-
-	// Disable watchdog
-	WDT->WDT_MR = WDT_MR_WDDIS;
-
-	// Initialize C library
-	__libc_init_array();
-
-	usb.attach();					// USB setup
-	delay(1000);
-#endif
-}
+void _system_init(void)
+{
+#ifdef __ARM
+	SystemInit();
+
+	// Disable watchdog
+	WDT->WDT_MR = WDT_MR_WDDIS;
+
+	// Initialize C library
+	__libc_init_array();
+
+	usb.attach();					// USB setup
+	delay(1000);
+#endif
+}
 
 /*
  * _application_init()
  */
 
-static void _application_init(void)
+static void _application_init(void)
 {
 	// There are a lot of dependencies in the order of these inits.
 	// Don't change the ordering unless you understand this.
 
 	cli();
 
-	// do these first
+#ifdef __STACK_WATERMARK
+	dia_stack_paint();				// paint free RAM before anything deepens the stack
+#endif
+
+	// do these first
 	hardware_init();				// system hardware setup 			- must be first
 	persistence_init();				// set up EEPROM or other NVM		- must be second
 	rtc_init();						// real time counter
@@ -127,6 +136,15 @@ static void _application_init(void)
 	switch_init();					// switches
 //	gpio_init();					// parallel IO
 	pwm_init();						// pulse width modulation drivers	- must follow gpio_init()
+#ifdef __RASTER
+	raster_init();					// laser raster engraving mode		- must follow pwm_init()
+#endif
+#ifdef __THC
+	thc_init();						// torch height control ADC loop
+#endif
+#ifdef __ADAPTIVE_FEED
+	afc_init();						// adaptive feed control ADC loop
+#endif
 
 	controller_init(STD_IN, STD_OUT, STD_ERR);// must be first app init; reqs xio_init()
 	config_init();					// config records from eeprom 		- must be next app init
@@ -141,6 +159,9 @@ static void _application_init(void)
 	PMIC_EnableLowLevel();
 	sei();							// enable global interrupts
 	rpt_print_system_ready_message();// (LAST) announce system is ready
+#ifdef __DIAG
+	diagnostics_init();				// takes over TIMER_5 - must follow the ready message (boot time)
+#endif
 }
 
 /*
@@ -149,18 +170,18 @@ static void _application_init(void)
 
 int main(void)
 {
-	// system initialization
-	_system_init();
+	// system initialization
+	_system_init();
 
 	// TinyG application setup
-	_application_init();
+	_application_init();
 	run_canned_startup();			// run any pre-loaded commands
 
-	// main loop
-	for (;;) {
-		controller_run( );			// single pass through the controller
-	}
-	return 0;
+	// main loop
+	for (;;) {
+		controller_run( );			// single pass through the controller
+	}
+	return 0;
 }
 
 
@@ -190,7 +211,7 @@ static const char stat_05[] PROGMEM = "Terminated";
 static const char stat_06[] PROGMEM = "Hard reset";
 static const char stat_07[] PROGMEM = "End of line";
 static const char stat_08[] PROGMEM = "End of file";
-static const char stat_09[] PROGMEM = "File not open";
+static const char stat_09[] PROGMEM = "File " D_NOT_ "open";
 
 static const char stat_10[] PROGMEM = "Max file size exceeded";
 static const char stat_11[] PROGMEM = "No such device";
@@ -199,26 +220,34 @@ static const char stat_13[] PROGMEM = "Buffer full";
 static const char stat_14[] PROGMEM = "Buffer full - fatal";
 static const char stat_15[] PROGMEM = "Initializing";
 static const char stat_16[] PROGMEM = "Entering boot loader";
-static const char stat_17[] PROGMEM = "Function is stubbed";
+static const char stat_17[] PROGMEM = "Function " D_IS_ "stubbed";
+#ifdef __ASYNC_COMMAND
+static const char stat_18[] PROGMEM = "Async " D_COMMAND_ "pending";
+#else
 static const char stat_18[] PROGMEM = "18";
+#endif
+#ifdef __QDEC_ENCODER
+static const char stat_19[] PROGMEM = "St" D_ALL_ "detected";
+#else
 static const char stat_19[] PROGMEM = "19";
+#endif
 
-static const char stat_20[] PROGMEM = "Internal error";
-static const char stat_21[] PROGMEM = "Internal range error";
-static const char stat_22[] PROGMEM = "Floating point error";
+static const char stat_20[] PROGMEM = "Internal " D_ERROR;
+static const char stat_21[] PROGMEM = "Internal range " D_ERROR;
+static const char stat_22[] PROGMEM = "Floating point " D_ERROR;
 static const char stat_23[] PROGMEM = "Divide by zero";
 static const char stat_24[] PROGMEM = "Invalid Address";
 static const char stat_25[] PROGMEM = "Read-only address";
 static const char stat_26[] PROGMEM = "Initialization failure";
 static const char stat_27[] PROGMEM = "System alarm - shutting down";
-static const char stat_28[] PROGMEM = "Failed to get planner buffer";
-static const char stat_29[] PROGMEM = "Generic exception report";
-
-static const char stat_30[] PROGMEM = "Move time is infinite";
-static const char stat_31[] PROGMEM = "Move time is NAN";
-static const char stat_32[] PROGMEM = "Float is infinite";
-static const char stat_33[] PROGMEM = "Float is NAN";
-static const char stat_34[] PROGMEM = "Persistence error";
+static const char stat_28[] PROGMEM = "Failed " D_TO_ "get planner buffer";
+static const char stat_29[] PROGMEM = D_GENERIC_ "exception report";
+
+static const char stat_30[] PROGMEM = "Move time " D_IS_ "infinite";
+static const char stat_31[] PROGMEM = "Move time " D_IS_ "NAN";
+static const char stat_32[] PROGMEM = "Float " D_IS_ "infinite";
+static const char stat_33[] PROGMEM = "Float " D_IS_ "NAN";
+static const char stat_34[] PROGMEM = "Persistence " D_ERROR;
 static const char stat_35[] PROGMEM = "Bad status report setting";
 static const char stat_36[] PROGMEM = "36";
 static const char stat_37[] PROGMEM = "37";
@@ -242,7 +271,11 @@ static const char stat_53[] PROGMEM = "53";
 static const char stat_54[] PROGMEM = "54";
 static const char stat_55[] PROGMEM = "55";
 static const char stat_56[] PROGMEM = "56";
+#ifdef __SPINDLE_READY
+static const char stat_57[] PROGMEM = D_SPINDLE_ "at-speed timeout";
+#else
 static const char stat_57[] PROGMEM = "57";
+#endif
 static const char stat_58[] PROGMEM = "58";
 static const char stat_59[] PROGMEM = "59";
 static const char stat_60[] PROGMEM = "60";
@@ -276,32 +309,32 @@ static const char stat_87[] PROGMEM = "87";
 static const char stat_88[] PROGMEM = "88";
 static const char stat_89[] PROGMEM = "89";
 
-static const char stat_90[] PROGMEM = "Config sub-system assertion failure";
-static const char stat_91[] PROGMEM = "IO sub-system assertion failure";
-static const char stat_92[] PROGMEM = "Encoder assertion failure";
-static const char stat_93[] PROGMEM = "Stepper assertion failure";
-static const char stat_94[] PROGMEM = "Planner assertion failure";
-static const char stat_95[] PROGMEM = "Canonical machine assertion failure";
-static const char stat_96[] PROGMEM = "Controller assertion failure";
+static const char stat_90[] PROGMEM = "Config sub-" D_SYSTEM_ D_ASSERTION_FAILURE;
+static const char stat_91[] PROGMEM = "IO sub-" D_SYSTEM_ D_ASSERTION_FAILURE;
+static const char stat_92[] PROGMEM = "Encoder " D_ASSERTION_FAILURE;
+static const char stat_93[] PROGMEM = "Stepper " D_ASSERTION_FAILURE;
+static const char stat_94[] PROGMEM = "Planner " D_ASSERTION_FAILURE;
+static const char stat_95[] PROGMEM = "Canonical machine " D_ASSERTION_FAILURE;
+static const char stat_96[] PROGMEM = "Controller " D_ASSERTION_FAILURE;
 static const char stat_97[] PROGMEM = "Stack overflow detected";
 static const char stat_98[] PROGMEM = "Memory fault detected";
-static const char stat_99[] PROGMEM = "Generic assertion failure";
+static const char stat_99[] PROGMEM = D_GENERIC_ D_ASSERTION_FAILURE;
 
-static const char stat_100[] PROGMEM = "Unrecognized command or config name";
+static const char stat_100[] PROGMEM = "Unrecognized " D_COMMAND_ "or config name";
 static const char stat_101[] PROGMEM = "Invalid or malformed command";
 static const char stat_102[] PROGMEM = "Bad number format";
-static const char stat_103[] PROGMEM = "Unsupported number or JSON type";
-static const char stat_104[] PROGMEM = "Parameter is read-only";
-static const char stat_105[] PROGMEM = "Parameter cannot be read";
-static const char stat_106[] PROGMEM = "Command not accepted at this time";
-static const char stat_107[] PROGMEM = "Input exceeds max length";
-static const char stat_108[] PROGMEM = "Input less than minimum value";
-static const char stat_109[] PROGMEM = "Input exceeds maximum value";
-
-static const char stat_110[] PROGMEM = "Input value range error";
-static const char stat_111[] PROGMEM = "JSON syntax error";
-static const char stat_112[] PROGMEM = "JSON input has too many pairs";
-static const char stat_113[] PROGMEM = "JSON string too long";
+static const char stat_103[] PROGMEM = "Unsupported number or " D_JSON_ "type";
+static const char stat_104[] PROGMEM = "Parameter " D_IS_ "read-only";
+static const char stat_105[] PROGMEM = "Parameter " D_CANNOT_BE_ "read";
+static const char stat_106[] PROGMEM = "Command " D_NOT_ "accepted at th" D_IS_ "time";
+static const char stat_107[] PROGMEM = D_INPUT_ "exceeds max length";
+static const char stat_108[] PROGMEM = D_INPUT_ D_LESS_THAN_MINIMUM_ "value";
+static const char stat_109[] PROGMEM = D_INPUT_ "exceeds maximum value";
+
+static const char stat_110[] PROGMEM = D_INPUT_ "value range " D_ERROR;
+static const char stat_111[] PROGMEM = D_JSON_ "syntax " D_ERROR;
+static const char stat_112[] PROGMEM = D_JSON_ "input has too many pairs";
+static const char stat_113[] PROGMEM = D_JSON_ "string too long";
 static const char stat_114[] PROGMEM = "114";
 static const char stat_115[] PROGMEM = "115";
 static const char stat_116[] PROGMEM = "116";
@@ -320,60 +353,60 @@ static const char stat_127[] PROGMEM = "127";
 static const char stat_128[] PROGMEM = "128";
 static const char stat_129[] PROGMEM = "129";
 
-static const char stat_130[] PROGMEM = "Generic Gcode input error";
-static const char stat_131[] PROGMEM = "Gcode command unsupported";
+static const char stat_130[] PROGMEM = D_GENERIC_ "Gcode input " D_ERROR;
+static const char stat_131[] PROGMEM = "Gcode " D_COMMAND_ "unsupported";
 static const char stat_132[] PROGMEM = "M code unsupported";
 static const char stat_133[] PROGMEM = "Gcode modal group violation";
-static const char stat_134[] PROGMEM = "Axis word missing";
-static const char stat_135[] PROGMEM = "Axis cannot be present";
-static const char stat_136[] PROGMEM = "Axis is invalid for this command";
-static const char stat_137[] PROGMEM = "Axis is disabled";
-static const char stat_138[] PROGMEM = "Axis target position is missing";
-static const char stat_139[] PROGMEM = "Axis target position is invalid";
-
-static const char stat_140[] PROGMEM = "Selected plane is missing";
-static const char stat_141[] PROGMEM = "Selected plane is invalid";
-static const char stat_142[] PROGMEM = "Feedrate not specified";
-static const char stat_143[] PROGMEM = "Inverse time mode cannot be used with this command";
-static const char stat_144[] PROGMEM = "Rotary axes cannot be used with this command";
-static const char stat_145[] PROGMEM = "G0 or G1 must be active for G53";
-static const char stat_146[] PROGMEM = "Requested velocity exceeds limits";
-static const char stat_147[] PROGMEM = "Cutter compensation cannot be enabled";
+static const char stat_134[] PROGMEM = "Ax" D_IS_ "word " D_MISSING;
+static const char stat_135[] PROGMEM = "Ax" D_IS_ D_CANNOT_BE_ "present";
+static const char stat_136[] PROGMEM = "Ax" D_IS_ D_IS_ D_INVALID " " D_FOR_ D_THIS_COMMAND;
+static const char stat_137[] PROGMEM = "Ax" D_IS_ D_IS_ "disabled";
+static const char stat_138[] PROGMEM = "Ax" D_IS_ "target " D_POSITION_ D_IS_ D_MISSING;
+static const char stat_139[] PROGMEM = "Ax" D_IS_ "target " D_POSITION_ D_IS_ D_INVALID;
+
+static const char stat_140[] PROGMEM = "Selected plane " D_IS_ D_MISSING;
+static const char stat_141[] PROGMEM = "Selected plane " D_IS_ D_INVALID;
+static const char stat_142[] PROGMEM = "Feedrate " D_NOT_ "specified";
+static const char stat_143[] PROGMEM = "Inverse time mode " D_CANNOT_BE_ "used with " D_THIS_COMMAND;
+static const char stat_144[] PROGMEM = "Rotary axes " D_CANNOT_BE_ "used with " D_THIS_COMMAND;
+static const char stat_145[] PROGMEM = "G0 or G1 must be active " D_FOR_ "G53";
+static const char stat_146[] PROGMEM = "Requested " D_VELOCITY_ "exceeds limits";
+static const char stat_147[] PROGMEM = "Cutter compensation " D_CANNOT_BE_ "enabled";
 static const char stat_148[] PROGMEM = "Programmed point same as current point";
-static const char stat_149[] PROGMEM = "Spindle speed below minimum";
-
-static const char stat_150[] PROGMEM = "Spindle speed exceeded maximum";
-static const char stat_151[] PROGMEM = "Spindle S word is missing";
-static const char stat_152[] PROGMEM = "Spindle S word is invalid";
-static const char stat_153[] PROGMEM = "Spindle must be off for this command";
-static const char stat_154[] PROGMEM = "Spindle must be turning for this command";
-static const char stat_155[] PROGMEM = "Arc specification error";
-static const char stat_156[] PROGMEM = "Arc specification error - missing axis(es)";
-static const char stat_157[] PROGMEM = "Arc specification error - missing offset(s)";
-static const char stat_158[] PROGMEM = "Arc specification error - radius arc out of tolerance";	// current longest message: 56 chard
-static const char stat_159[] PROGMEM = "Arc specification error - endpoint is starting point";
-
-static const char stat_160[] PROGMEM = "P word is missing";
-static const char stat_161[] PROGMEM = "P word is invalid";
-static const char stat_162[] PROGMEM = "P word is zero";
-static const char stat_163[] PROGMEM = "P word is negative";
-static const char stat_164[] PROGMEM = "P word is not an integer";
-static const char stat_165[] PROGMEM = "P word is not a valid tool number";
-static const char stat_166[] PROGMEM = "D word is missing";
-static const char stat_167[] PROGMEM = "D word is invalid";
-static const char stat_168[] PROGMEM = "E word is missing";
-static const char stat_169[] PROGMEM = "E word is invalid";
-
-static const char stat_170[] PROGMEM = "H word is missing";
-static const char stat_171[] PROGMEM = "H word is invalid";
-static const char stat_172[] PROGMEM = "L word is missing";
-static const char stat_173[] PROGMEM = "L word is invalid";
-static const char stat_174[] PROGMEM = "Q word is missing";
-static const char stat_175[] PROGMEM = "Q word is invalid";
-static const char stat_176[] PROGMEM = "R word is missing";
-static const char stat_177[] PROGMEM = "R word is invalid";
-static const char stat_178[] PROGMEM = "T word is missing";
-static const char stat_179[] PROGMEM = "T word is invalid";
+static const char stat_149[] PROGMEM = D_SPINDLE_ "speed below minimum";
+
+static const char stat_150[] PROGMEM = D_SPINDLE_ "speed exceeded maximum";
+static const char stat_151[] PROGMEM = D_SPINDLE_ "S " D_WORD_IS_ D_MISSING;
+static const char stat_152[] PROGMEM = D_SPINDLE_ "S " D_WORD_IS_ D_INVALID;
+static const char stat_153[] PROGMEM = D_SPINDLE_ "must be off " D_FOR_ D_THIS_COMMAND;
+static const char stat_154[] PROGMEM = D_SPINDLE_ "must be turning " D_FOR_ D_THIS_COMMAND;
+static const char stat_155[] PROGMEM = "Arc specification " D_ERROR;
+static const char stat_156[] PROGMEM = D_ARC_SPECIFICATION_ERROR_ D_MISSING " axis(es)";
+static const char stat_157[] PROGMEM = D_ARC_SPECIFICATION_ERROR_ D_MISSING " offset(s)";
+static const char stat_158[] PROGMEM = D_ARC_SPECIFICATION_ERROR_ "radius arc out of tolerance";	// current longest message: 56 chard
+static const char stat_159[] PROGMEM = D_ARC_SPECIFICATION_ERROR_ "endpoint " D_IS_ "starting point";
+
+static const char stat_160[] PROGMEM = "P " D_WORD_IS_ D_MISSING;
+static const char stat_161[] PROGMEM = "P " D_WORD_IS_ D_INVALID;
+static const char stat_162[] PROGMEM = "P " D_WORD_IS_ "zero";
+static const char stat_163[] PROGMEM = "P " D_WORD_IS_ "negative";
+static const char stat_164[] PROGMEM = "P " D_WORD_IS_ D_NOT_ "an integer";
+static const char stat_165[] PROGMEM = "P " D_WORD_IS_ D_NOT_ "a valid tool number";
+static const char stat_166[] PROGMEM = "D " D_WORD_IS_ D_MISSING;
+static const char stat_167[] PROGMEM = "D " D_WORD_IS_ D_INVALID;
+static const char stat_168[] PROGMEM = "E " D_WORD_IS_ D_MISSING;
+static const char stat_169[] PROGMEM = "E " D_WORD_IS_ D_INVALID;
+
+static const char stat_170[] PROGMEM = "H " D_WORD_IS_ D_MISSING;
+static const char stat_171[] PROGMEM = "H " D_WORD_IS_ D_INVALID;
+static const char stat_172[] PROGMEM = "L " D_WORD_IS_ D_MISSING;
+static const char stat_173[] PROGMEM = "L " D_WORD_IS_ D_INVALID;
+static const char stat_174[] PROGMEM = "Q " D_WORD_IS_ D_MISSING;
+static const char stat_175[] PROGMEM = "Q " D_WORD_IS_ D_INVALID;
+static const char stat_176[] PROGMEM = "R " D_WORD_IS_ D_MISSING;
+static const char stat_177[] PROGMEM = "R " D_WORD_IS_ D_INVALID;
+static const char stat_178[] PROGMEM = "T " D_WORD_IS_ D_MISSING;
+static const char stat_179[] PROGMEM = "T " D_WORD_IS_ D_INVALID;
 
 static const char stat_180[] PROGMEM = "180";
 static const char stat_181[] PROGMEM = "181";
@@ -397,13 +430,13 @@ static const char stat_197[] PROGMEM = "197";
 static const char stat_198[] PROGMEM = "198";
 static const char stat_199[] PROGMEM = "199";
 
-static const char stat_200[] PROGMEM = "Generic TinyG error";
-static const char stat_201[] PROGMEM = "Move less than minimum length";
-static const char stat_202[] PROGMEM = "Move less than minimum time";
-static const char stat_203[] PROGMEM = "Machine is alarmed - Command not processed";	// current longest message 43 chars (including NUL)
+static const char stat_200[] PROGMEM = D_GENERIC_ "TinyG " D_ERROR;
+static const char stat_201[] PROGMEM = "Move " D_LESS_THAN_MINIMUM_ "length";
+static const char stat_202[] PROGMEM = "Move " D_LESS_THAN_MINIMUM_ "time";
+static const char stat_203[] PROGMEM = "Machine " D_IS_ "alarmed - Command " D_NOT_ "processed";	// current longest message 43 chars (including NUL)
 static const char stat_204[] PROGMEM = "Limit switch hit - Shutdown occurred";
-static const char stat_205[] PROGMEM = "Trapezoid planner failed to converge";
-static const char stat_206[] PROGMEM = "206";
+static const char stat_205[] PROGMEM = "Trapezoid planner failed " D_TO_ "converge";
+static const char stat_206[] PROGMEM = "Firmware image CRC failed";
 static const char stat_207[] PROGMEM = "207";
 static const char stat_208[] PROGMEM = "208";
 static const char stat_209[] PROGMEM = "209";
@@ -420,18 +453,18 @@ static const char stat_218[] PROGMEM = "218";
 static const char stat_219[] PROGMEM = "219";
 
 static const char stat_220[] PROGMEM = "Soft limit exceeded";
-static const char stat_221[] PROGMEM = "Soft limit exceeded - X min";
-static const char stat_222[] PROGMEM = "Soft limit exceeded - X max";
-static const char stat_223[] PROGMEM = "Soft limit exceeded - Y min";
-static const char stat_224[] PROGMEM = "Soft limit exceeded - Y max";
-static const char stat_225[] PROGMEM = "Soft limit exceeded - Z min";
-static const char stat_226[] PROGMEM = "Soft limit exceeded - Z max";
-static const char stat_227[] PROGMEM = "Soft limit exceeded - A min";
-static const char stat_228[] PROGMEM = "Soft limit exceeded - A max";
-static const char stat_229[] PROGMEM = "Soft limit exceeded - B min";
-static const char stat_230[] PROGMEM = "Soft limit exceeded - B max";
-static const char stat_231[] PROGMEM = "Soft limit exceeded - C min";
-static const char stat_232[] PROGMEM = "Soft limit exceeded - C max";
+static const char stat_221[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "X min";
+static const char stat_222[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "X max";
+static const char stat_223[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "Y min";
+static const char stat_224[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "Y max";
+static const char stat_225[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "Z min";
+static const char stat_226[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "Z max";
+static const char stat_227[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "A min";
+static const char stat_228[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "A max";
+static const char stat_229[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "B min";
+static const char stat_230[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "B max";
+static const char stat_231[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "C min";
+static const char stat_232[] PROGMEM = D_SOFT_LIMIT_EXCEEDED_ "C max";
 static const char stat_233[] PROGMEM = "233";
 static const char stat_234[] PROGMEM = "234";
 static const char stat_235[] PROGMEM = "235";
@@ -440,20 +473,20 @@ static const char stat_237[] PROGMEM = "237";
 static const char stat_238[] PROGMEM = "238";
 static const char stat_239[] PROGMEM = "239";
 
-static const char stat_240[] PROGMEM = "Homing cycle failed";
-static const char stat_241[] PROGMEM = "Homing Error - Bad or no axis specified";
-static const char stat_242[] PROGMEM = "Homing Error - Search velocity is zero";
-static const char stat_243[] PROGMEM = "Homing Error - Latch velocity is zero";
-static const char stat_244[] PROGMEM = "Homing Error - Travel min & max are the same";
-static const char stat_245[] PROGMEM = "Homing Error - Negative latch backoff";
-static const char stat_246[] PROGMEM = "Homing Error - Homing switches misconfigured";
+static const char stat_240[] PROGMEM = "Homing " D_CYCLE_FAILED;
+static const char stat_241[] PROGMEM = D_HOMING_ERROR_ "Bad or no ax" D_IS_ "specified";
+static const char stat_242[] PROGMEM = D_HOMING_ERROR_ "Search " D_VELOCITY_ D_IS_ "zero";
+static const char stat_243[] PROGMEM = D_HOMING_ERROR_ "Latch " D_VELOCITY_ D_IS_ "zero";
+static const char stat_244[] PROGMEM = D_HOMING_ERROR_ "Travel min & max are " D_THE_ "same";
+static const char stat_245[] PROGMEM = D_HOMING_ERROR_ "Negative latch backoff";
+static const char stat_246[] PROGMEM = D_HOMING_ERROR_ "Homing switches misconfigured";
 static const char stat_247[] PROGMEM = "247";
 static const char stat_248[] PROGMEM = "248";
 static const char stat_249[] PROGMEM = "249";
 
-static const char stat_250[] PROGMEM = "Probe cycle failed";
-static const char stat_251[] PROGMEM = "Probe endpoint is starting point";
-static const char stat_252[] PROGMEM = "Jogging cycle failed";
+static const char stat_250[] PROGMEM = "Probe " D_CYCLE_FAILED;
+static const char stat_251[] PROGMEM = "Probe endpoint " D_IS_ "starting point";
+static const char stat_252[] PROGMEM = "Jogging " D_CYCLE_FAILED;
 
 static const char *const stat_msg[] PROGMEM = {
 	stat_00, stat_01, stat_02, stat_03, stat_04, stat_05, stat_06, stat_07, stat_08, stat_09,
@@ -486,5 +519,9 @@ static const char *const stat_msg[] PROGMEM = {
 
 char *get_status_message(stat_t status)
 {
+#ifdef __PACKED_STRINGS
+	return (txt_unpack(global_string_buf, (const char *)pgm_read_word(&stat_msg[status]), MESSAGE_LEN));
+#else
 	return ((char *)GET_TEXT_ITEM(stat_msg, status));
+#endif
 }
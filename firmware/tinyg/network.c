@@ -24,20 +24,23 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-/* 	This module is really nothing mre than a placeholder at this time.
- * 	"Networking" refers to a planned RS485 broadcast network to support
- *	multi-board configs and external RS485 devices such as extruders.
- *	Basic operation of RS485 on the TinyG hardware has been verified
- *	using what's in this file, but you won;t find much more.
+/* 	"Networking" refers to the RS485 broadcast network supporting multi-board
+ *	configs and external RS485 devices such as extruders. Basic RS485 operation
+ *	is verified by the tests at the bottom of this file. With __NET_SEGMENT_BUS
+ *	the module also implements the segment bus - see the doc block further down.
  */
 
+#include <string.h>					// for memcpy()
 #include <util/delay.h>				// for tests
 
 #include "tinyg.h"
 #include "network.h"
 #include "controller.h"
+#include "gcode_binary.h"
 #include "gpio.h"
 #include "hardware.h"
+#include "stepper.h"
+#include "util.h"
 #include "xio.h"
 
 /*
@@ -62,6 +65,184 @@ void net_forward(unsigned char c)
 	xio_putc(XIO_DEV_RS485, c);	// write to RS485 port
 }
 
+#ifdef __NET_SEGMENT_BUS
+/* Segment bus - synchronized motion over RS485
+ *
+ *	The master broadcasts every segment it preps for its own steppers as a
+ *	binary block on the RS485 channel (net_master_send_segment(), called from
+ *	st_prep_line()). Slaves run with network_mode = NETWORK_SLAVE, which
+ *	re-points their primary input to RS485 (see network_init()), so packets
+ *	arrive through the ordinary line discipline and the SOH binary block
+ *	dispatch in gcode_binary.c - no planner, exec or parser is involved on
+ *	the slave; received segments go straight into st_prep_line() and the
+ *	loader. A slave mirrors the master's motor channels one-for-one: wire the
+ *	second Y of a dual-Y gantry to the same socket number on the slave and
+ *	disable the channels it shouldn't drive with $1pm=0 (etc).
+ *
+ *	Packet payload (unescaped, between the SOH opcode framing and the XOR
+ *	checksum that gc_binary_parser() verifies):
+ *	  byte 0		opcode GC_BINARY_NET_SEG
+ *	  byte 1		sequence number (detects lost packets)
+ *	  bytes 2-5		start tick - position of this segment on the master's
+ *					DDA-tick timeline, little-endian uint32
+ *	  then			MOTORS packed floats - fractional travel steps per channel
+ *	  then			segment time in minutes, packed float
+ *
+ *	Clock sync: both boards derive dda_ticks from the same packed float with
+ *	the same expression (see st_prep_line()), so the timelines advance in
+ *	lockstep from crystal-driven DDA timers. The slave accumulates the ticks
+ *	it has actually prepped and compares against each packet's start tick;
+ *	residual error (packet loss, rounding after an elastic correction) is
+ *	worked off by stretching or shrinking segments a few DDA ticks at a time
+ *	(NET_SEG_MAX_CORRECTION). A start-tick jump beyond NET_SEG_RESYNC_TICKS
+ *	means the master's motion paused (dwell, planner gap, job boundary) - the
+ *	slave re-seeds its timeline instead of trying to correct across the gap.
+ *	Rate is thereby held to the tick; absolute phase at the start of a motion
+ *	burst is bounded by the master's prep-to-load pipeline lead and RS485
+ *	transit, and holds constant for the burst.
+ *
+ *	Escaping on transmit covers the binary block set (NUL, LF, CR, DLE) plus
+ *	the characters the RS485 RX ISR traps as signals (CAN, '!', '~') so a
+ *	payload byte can never fire a feedhold on the slaves. gc_binary_parser()'s
+ *	unescape is value-agnostic and needs no change.
+ */
+
+static struct netSingleton {
+	// master state
+	uint8_t tx_seq;						// next sequence number to send
+	uint32_t tx_tick;					// master timeline (DDA ticks prepped so far)
+
+	// slave state
+	uint8_t rx_seq;						// next sequence number expected
+	uint32_t rx_tick;					// slave timeline (DDA ticks prepped so far)
+	uint8_t head;						// segment queue indices (head = next free)
+	uint8_t tail;
+	uint8_t count;
+	netSegment_t queue[NET_SEG_QUEUE_SIZE];
+
+	// diagnostics
+	uint16_t lost;						// sequence gaps seen (lost or rejected packets)
+	uint16_t overruns;					// segments dropped because the queue was full
+} net;
+
+/*
+ * _net_put() - transmit one payload byte, escaped if it's unsafe on the wire
+ */
+static void _net_put(uint8_t c)
+{
+	if ((c == NUL) || (c == LF) || (c == CR) || (c == GC_BINARY_DLE) ||
+		(c == CHAR_RESET) || (c == CHAR_FEEDHOLD) || (c == CHAR_CYCLE_START)) {
+		xio_putc(XIO_DEV_NET, GC_BINARY_DLE);
+		c ^= GC_BINARY_XOR;				// see gcode_binary.c wire format
+	}
+	xio_putc(XIO_DEV_NET, c);
+}
+
+/*
+ * net_master_send_segment() - broadcast a prepped segment on the bus
+ *
+ *	Called from st_prep_line() after a successful prep; no-op unless in
+ *	NETWORK_MASTER mode. Runs at the exec interrupt level, so the RS485
+ *	device must stay non-blocking (it is - see RS485_FLAGS). A TX overrun
+ *	corrupts one frame, which the slaves reject by checksum and recover
+ *	from as a sequence gap.
+ */
+void net_master_send_segment(float travel_steps[], float segment_time)
+{
+	if (cs.network_mode != NETWORK_MASTER) { return;}
+
+	uint8_t payload[2 + sizeof(uint32_t) + (MOTORS * sizeof(float)) + sizeof(float)];
+	uint8_t i = 0;
+	uint8_t sum = 0;
+
+	payload[i++] = GC_BINARY_NET_SEG;
+	payload[i++] = net.tx_seq++;
+	memcpy(&payload[i], &net.tx_tick, sizeof(uint32_t));			i += sizeof(uint32_t);
+	memcpy(&payload[i], travel_steps, MOTORS * sizeof(float));		i += MOTORS * sizeof(float);
+	memcpy(&payload[i], &segment_time, sizeof(float));				i += sizeof(float);
+
+	xio_putc(XIO_DEV_NET, GC_BINARY_LEADIN);
+	for (uint8_t j=0; j<i; j++) {
+		sum ^= payload[j];
+		_net_put(payload[j]);
+	}
+	_net_put(sum);
+	xio_putc(XIO_DEV_NET, LF);
+
+	net.tx_tick += (uint32_t)(segment_time * 60 * FREQUENCY_DDA);	// must match st_prep_line()
+}
+
+/*
+ * net_binary_block() - receive a segment packet (called from gc_binary_parser)
+ *
+ *	The checksum has already been verified. Queues the segment and tries to
+ *	stage it immediately so a free prep buffer is never left waiting for the
+ *	next controller pass.
+ */
+stat_t net_binary_block(uint8_t opcode, uint8_t *buf, uint8_t len)
+{
+	if (len != (1 + sizeof(uint32_t) + (MOTORS * sizeof(float)) + sizeof(float))) {
+		return (STAT_GCODE_GENERIC_INPUT_ERROR);
+	}
+	if (net.count >= NET_SEG_QUEUE_SIZE) {	// master outran the DDA - drop and count
+		net.overruns++;
+		return (STAT_OK);
+	}
+	netSegment_t *seg = &net.queue[net.head];
+	uint8_t i = 0;
+
+	seg->seq = buf[i++];
+	memcpy(&seg->start_tick, &buf[i], sizeof(uint32_t));			i += sizeof(uint32_t);
+	memcpy(seg->steps, &buf[i], MOTORS * sizeof(float));			i += MOTORS * sizeof(float);
+	memcpy(&seg->segment_time, &buf[i], sizeof(float));
+
+	net.head = (net.head+1) % NET_SEG_QUEUE_SIZE;
+	net.count++;
+	net_slave_callback();						// stage it now if the prep buffer is free
+	return (STAT_OK);
+}
+
+/*
+ * net_slave_callback() - stage the next queued segment into the prep buffer
+ *
+ *	Runs from the controller loop (and opportunistically on packet arrival).
+ *	Applies the timeline discipline described in the doc block above.
+ */
+stat_t net_slave_callback()
+{
+	if ((cs.network_mode != NETWORK_SLAVE) || (net.count == 0)) { return (STAT_NOOP);}
+	if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) { return (STAT_NOOP);}	// prep staging busy
+
+	netSegment_t *seg = &net.queue[net.tail];
+	net.tail = (net.tail+1) % NET_SEG_QUEUE_SIZE;
+	net.count--;
+
+	if (seg->seq != net.rx_seq) {				// lost packet(s) - re-seed the timeline
+		net.lost++;
+		net.rx_tick = seg->start_tick;
+	}
+	net.rx_seq = seg->seq + 1;
+
+	float segment_time = seg->segment_time;
+	int32_t delta = (int32_t)(seg->start_tick - net.rx_tick);
+	if ((delta > NET_SEG_RESYNC_TICKS) || (delta < -NET_SEG_RESYNC_TICKS)) {
+		net.rx_tick = seg->start_tick;			// timeline break - master's motion paused
+	} else if (delta != 0) {					// work off residual error a few ticks at a time
+		int32_t correction = max(-NET_SEG_MAX_CORRECTION, min(NET_SEG_MAX_CORRECTION, delta));
+		segment_time += (float)correction / (60 * FREQUENCY_DDA);
+	}
+
+	stat_t status = st_prep_line(seg->steps, segment_time);
+	if (status == STAT_OK) {
+		net.rx_tick += (uint32_t)(segment_time * 60 * FREQUENCY_DDA);	// must match st_prep_line()
+		st_request_load_move();					// kick the loader if the runtime is idle
+	} else {									// segment was rejected (e.g. minimum time move)
+		net.rx_tick = seg->start_tick;			// hold the timeline where the master stamped it
+	}
+	return (STAT_OK);
+}
+#endif // __NET_SEGMENT_BUS
+
 /*
  * net_test_rxtx() - test transmission from master to slave
  * net_test_loopback() - test transmission from master to slave and looping back
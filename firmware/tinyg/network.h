@@ -45,4 +45,25 @@ uint8_t net_test_loopback(uint8_t c);
 #define XIO_DEV_NET XIO_DEV_RS485	// define the network channel
 //#define net_forward(c) (xio_putc(XIO_DEV_NET,c))
 
+#ifdef __NET_SEGMENT_BUS
+/*
+ * Segment bus - synchronized motion over RS485 (see network.c for the protocol)
+ */
+
+#define NET_SEG_QUEUE_SIZE 4			// received segments buffered ahead of the prep layer
+#define NET_SEG_MAX_CORRECTION 4		// elastic timeline correction per segment (DDA ticks)
+#define NET_SEG_RESYNC_TICKS 1000		// timeline break threshold - re-seed instead of correcting
+
+typedef struct netSegment {				// one received bus segment awaiting prep
+	uint8_t seq;						// master sequence number
+	uint32_t start_tick;				// position on the master timeline (DDA ticks)
+	float steps[MOTORS];				// fractional travel steps per motor channel
+	float segment_time;					// segment duration in minutes
+} netSegment_t;
+
+void net_master_send_segment(float travel_steps[], float segment_time);
+stat_t net_binary_block(uint8_t opcode, uint8_t *buf, uint8_t len);
+stat_t net_slave_callback(void);
+#endif // __NET_SEGMENT_BUS
+
 #endif
@@ -1,5 +1,5 @@
 /*
- * persistence.c - persistence functions
+ * persistence.c - persistence functions
  * This file is part of the TinyG project
  *
  * Copyright (c) 2013 - 2015 Alden S. Hart Jr.
@@ -28,10 +28,17 @@
 #include "persistence.h"
 #include "report.h"
 #include "canonical_machine.h"
+#include "planner.h"
+#include "hardware.h"
+#include "controller.h"
+#include "xio.h"
 #include "util.h"
 
 #ifdef __AVR
 #include "xmega/xmega_eeprom.h"
+#ifdef __SETTINGS_PROFILES
+#include "xmega/xbootapi.h"
+#endif
 #endif
 
 /***********************************************************************************
@@ -54,6 +61,14 @@ void persistence_init()
 #ifdef __AVR
 	nvm.base_addr = NVM_BASE_ADDR;
 	nvm.profile_base = 0;
+#ifdef __SETTINGS_PROFILES
+	nvm.active_profile = 0;				// always boot on the EEPROM image
+#endif
+#ifdef __NVM_SHADOW
+	// Bulk-load the RAM shadow image. This is the only EEPROM read the system
+	// performs; all subsequent reads are served from RAM at memory speed.
+	(void)EEPROM_ReadBytes(nvm.profile_base, (int8_t *)nvm.shadow, NVM_SHADOW_ENTRIES * NVM_VALUE_LEN);
+#endif
 #endif
 	return;
 }
@@ -63,11 +78,38 @@ void persistence_init()
  * write_persistent_value() - write to NVM by index, but only if the value has changed
  *
  *	It's the responsibility of the caller to make sure the index does not exceed range
+ *
+ *	__NVM_SHADOW serves reads from a RAM image of the NVM area that is bulk-loaded
+ *	once in persistence_init(). Boot-time config restore and $defa change comparisons
+ *	run at memory speed, and the EEPROM wait-state hardware is never touched during
+ *	operation except to commit an actual value change. Writes update the image in
+ *	place so it never goes stale.
+ *
+ *	Command-time code never reads through this function: runtime accessors
+ *	(coordinate offsets, G28/G30 positions, axis and motor settings) read the
+ *	RAM copies bound into cfgArray or held in the canonical machine. The shadow
+ *	must therefore cover the entire singles region - config_test_assertions()
+ *	alarms if the config table outgrows NVM_SHADOW_ENTRIES, rather than letting
+ *	reads quietly degrade to EEPROM.
  */
 
 #ifdef __AVR
 stat_t read_persistent_value(nvObj_t *nv)
 {
+#ifdef __NVM_WRITEBACK
+	for (uint8_t i=0; i<nvm.cache_count; i++) {		// read-through the write-back cache
+		if (nvm.cache_index[i] == nv->index) {
+			nv->value = nvm.cache_value[i];
+			return (STAT_OK);
+		}
+	}
+#endif
+#ifdef __NVM_SHADOW
+	if (nv->index < NVM_SHADOW_ENTRIES) {			// serve the read from the shadow image
+		nv->value = nvm.shadow[nv->index];
+		return (STAT_OK);
+	}
+#endif
 	nvm.address = nvm.profile_base + (nv->index * NVM_VALUE_LEN);
 	(void)EEPROM_ReadBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
 	memcpy(&nv->value, &nvm.byte_array, NVM_VALUE_LEN);
@@ -84,6 +126,96 @@ stat_t read_persistent_value(nvObj_t *nv)
 #endif // __ARM
 
 #ifdef __AVR
+#ifdef __NVM_WRITEBACK
+/*
+ * _write_value_to_nvm() - write one value to EEPROM if it differs from the stored value
+ * write_persistent_value() - queue a dirty value in the write-back cache
+ * persistence_callback()   - background flush of dirty values (called from controller)
+ *
+ *	Dirty values accumulate in a RAM cache and are flushed from the background
+ *	loop, a page-sized batch (NVM_FLUSH_CHUNK values) per pass, so settings
+ *	writes no longer stall the caller for EEPROM write time. Repeated writes
+ *	to the same index coalesce in the cache, which is where the wear savings
+ *	come from on machines reconfigured per-job. Reads go through the cache so
+ *	unflushed values are never stale. If the cache is full (e.g. a $defa mass
+ *	restore) writes fall back to the legacy synchronous path.
+ */
+#define NVM_FLUSH_CHUNK 8				// values per flush pass - one EEPROM page worth
+
+static void _write_value_to_nvm(index_t index, float value)
+{
+	float stored;
+
+#ifdef __SETTINGS_PROFILES
+	if (nvm.active_profile != 0) {				// flash profile active - changes are RAM-only
+		if (index < NVM_SHADOW_ENTRIES) {		// until burned with $profs; EEPROM keeps image 0
+			nvm.shadow[index] = value;
+		}
+		return;
+	}
+#endif
+	nvm.address = nvm.profile_base + (index * NVM_VALUE_LEN);
+#ifdef __NVM_SHADOW
+	if (index < NVM_SHADOW_ENTRIES) {			// compare against the shadow - no EEPROM read
+		stored = nvm.shadow[index];
+		if ((isnan((double)stored)) || (isinf((double)stored)) || (fp_NE(stored, value))) {
+			nvm.shadow[index] = value;			// keep the shadow coherent with the write
+			memcpy(&nvm.byte_array, &value, NVM_VALUE_LEN);
+			(void)EEPROM_WriteBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
+		}
+		return;
+	}
+#endif
+	(void)EEPROM_ReadBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
+	memcpy(&stored, &nvm.byte_array, NVM_VALUE_LEN);
+	if ((isnan((double)stored)) || (isinf((double)stored)) || (fp_NE(stored, value))) {
+		memcpy(&nvm.byte_array, &value, NVM_VALUE_LEN);
+		(void)EEPROM_WriteBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
+	}
+}
+
+stat_t write_persistent_value(nvObj_t *nv)
+{
+	float value = nv_flt_value(nv);					// NVM image stays float for typed values
+
+	for (uint8_t i=0; i<nvm.cache_count; i++) {		// coalesce repeated writes to an index
+		if (nvm.cache_index[i] == nv->index) {
+			nvm.cache_value[i] = value;
+			return (STAT_OK);
+		}
+	}
+	if (nvm.cache_count < NVM_CACHE_LEN) {
+		nvm.cache_index[nvm.cache_count] = nv->index;
+		nvm.cache_value[nvm.cache_count] = value;
+		nvm.cache_count++;
+		return (STAT_OK);
+	}
+	// cache full - legacy synchronous write
+	if (cm.cycle_state != CYCLE_OFF)
+        return(rpt_exception(STAT_FILE_NOT_OPEN));	// can't write when machine is moving
+	_write_value_to_nvm(nv->index, value);
+	return (STAT_OK);
+}
+
+stat_t persistence_callback()
+{
+	if (nvm.cache_count == 0)
+		return (STAT_NOOP);
+	if (cm.cycle_state != CYCLE_OFF)
+		return (STAT_NOOP);							// EEPROM writes are locked out while moving
+
+	uint8_t chunk = min(nvm.cache_count, NVM_FLUSH_CHUNK);
+	for (uint8_t i=0; i<chunk; i++) {
+		_write_value_to_nvm(nvm.cache_index[i], nvm.cache_value[i]);
+	}
+	nvm.cache_count -= chunk;						// compact remaining entries to the front
+	memmove(&nvm.cache_index[0], &nvm.cache_index[chunk], nvm.cache_count * sizeof(index_t));
+	memmove(&nvm.cache_value[0], &nvm.cache_value[chunk], nvm.cache_count * sizeof(float));
+	return (STAT_OK);
+}
+
+#else // not __NVM_WRITEBACK
+
 stat_t write_persistent_value(nvObj_t *nv)
 {
 	if (cm.cycle_state != CYCLE_OFF)
@@ -95,16 +227,459 @@ stat_t write_persistent_value(nvObj_t *nv)
 		if (isinf((double)nv->value)) return(rpt_exception(STAT_FLOAT_IS_INFINITE));// bad floating point value
 	}
 */
-	nvm.tmp_value = nv->value;
+	nvm.tmp_value = nv_flt_value(nv);				// NVM image stays float for typed values
+#ifdef __SETTINGS_PROFILES
+	if (nvm.active_profile != 0) {					// flash profile active - changes are RAM-only
+#ifdef __NVM_SHADOW
+		if (nv->index < NVM_SHADOW_ENTRIES) {		// until burned with $profs; EEPROM keeps image 0
+			nvm.shadow[nv->index] = nvm.tmp_value;
+		}
+#endif
+		return (STAT_OK);
+	}
+#endif
 	ritorno(read_persistent_value(nv));
 	if ((isnan((double)nv->value)) || (isinf((double)nv->value)) || (fp_NE(nv->value, nvm.tmp_value))) {
+#ifdef __NVM_SHADOW
+		if (nv->index < NVM_SHADOW_ENTRIES) {	// keep the shadow coherent with the write
+			nvm.shadow[nv->index] = nvm.tmp_value;
+		}
+#endif
 		memcpy(&nvm.byte_array, &nvm.tmp_value, NVM_VALUE_LEN);
 		nvm.address = nvm.profile_base + (nv->index * NVM_VALUE_LEN);
 		(void)EEPROM_WriteBytes(nvm.address, nvm.byte_array, NVM_VALUE_LEN);
 	}
+#ifdef __TYPED_CONFIG
+	if (nv->valuetype == TYPE_INTEGER) { nv->value_int = (int32_t)nvm.tmp_value;}	// restore typed
+	else { nv->value = nvm.tmp_value;}
+#else
 	nv->value =nvm.tmp_value;		// always restore value
+#endif
+	return (STAT_OK);
+}
+#endif // __NVM_WRITEBACK
+
+#ifdef __JOB_CHECKPOINT
+/*
+ * job_checkpoint_callback() - stage and trickle a job checkpoint to EEPROM
+ * job_checkpoint_restore()  - {"rsm":n} - restore the checkpoint, return its line number
+ *
+ *	Every JOB_CHECKPOINT_MS during a machining cycle the runtime line number,
+ *	absolute position and active modal state (coordinate system, units,
+ *	distance mode, plane, feed rate) are staged in RAM and trickled to a
+ *	reserved region at the top of EEPROM, one 4 byte cell per controller pass.
+ *	A cell write only starts when the NVM controller is idle so the callback
+ *	never busy-waits - this is why checkpointing is exempt from the
+ *	writes-locked-out-while-moving rule the settings cache observes. Slot 0
+ *	holds a checksum sealed with NVM_CHECKPOINT_SEAL and is written last, so
+ *	a checkpoint torn by the power loss it guards against fails validation.
+ *
+ *	Restore is only accepted with the cycle off. It rebuilds the modal state
+ *	through the canonical machine setters, sets the absolute position, and
+ *	returns the checkpointed line number so the host can re-stream from
+ *	there. Spindle and coolant are deliberately not restored - restarting
+ *	the spindle is the host's (or operator's) explicit call. Position is
+ *	exact if power was lost at rest; during motion the machine stops short
+ *	of the checkpoint, so jobs needing full accuracy should still re-home.
+ */
+
+stat_t job_checkpoint_callback()
+{
+	if (nvm.ckp_pending == 0) {					// nothing in flight - see if a new checkpoint is due
+		if (cm.cycle_state != CYCLE_MACHINING) { return (STAT_NOOP);}	// machining cycles only
+		uint32_t linenum = cm_get_linenum(RUNTIME);
+		if (linenum == nvm.ckp_linenum) { return (STAT_NOOP);}		// no progress since last checkpoint
+		if ((SysTickTimer_getValue() - nvm.ckp_systick) < JOB_CHECKPOINT_MS) { return (STAT_NOOP);}
+
+		nvm.ckp_image[1] = (float)linenum;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			nvm.ckp_image[2+axis] = cm_get_absolute_position(RUNTIME, axis);
+		}
+		nvm.ckp_image[8] = (float)cm_get_coord_system(RUNTIME);
+		nvm.ckp_image[9] = (float)cm_get_units_mode(RUNTIME);
+		nvm.ckp_image[10] = (float)cm_get_distance_mode(RUNTIME);
+		nvm.ckp_image[11] = (float)cm_get_select_plane(RUNTIME);
+		nvm.ckp_image[12] = cm_get_feed_rate(RUNTIME);
+
+		float seal = NVM_CHECKPOINT_SEAL;
+		for (uint8_t slot=1; slot<NVM_CHECKPOINT_SLOTS; slot++) { seal += nvm.ckp_image[slot];}
+		nvm.ckp_image[0] = seal;
+		nvm.ckp_linenum = linenum;
+		nvm.ckp_systick = SysTickTimer_getValue();
+		nvm.ckp_pending = NVM_CHECKPOINT_SLOTS;
+		return (STAT_OK);
+	}
+	if (NVM.STATUS & NVM_NVMBUSY_bm) { return (STAT_NOOP);}	// previous cell still burning - retry next pass
+	uint8_t slot = nvm.ckp_pending - 1;			// slots are written high to low so the seal lands last
+	memcpy(&nvm.byte_array, &nvm.ckp_image[slot], NVM_VALUE_LEN);
+	(void)EEPROM_WriteBytes(NVM_CHECKPOINT_BASE + (slot * NVM_VALUE_LEN), nvm.byte_array, NVM_VALUE_LEN);
+	nvm.ckp_pending--;
+	return (STAT_OK);
+}
+
+stat_t job_checkpoint_restore(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) { return (STAT_COMMAND_NOT_ACCEPTED);}
+
+	float image[NVM_CHECKPOINT_SLOTS];
+	(void)EEPROM_ReadBytes(NVM_CHECKPOINT_BASE, (int8_t *)image, NVM_CHECKPOINT_SLOTS * NVM_VALUE_LEN);
+	float seal = NVM_CHECKPOINT_SEAL;
+	for (uint8_t slot=1; slot<NVM_CHECKPOINT_SLOTS; slot++) { seal += image[slot];}
+	if (fp_NE(seal, image[0])) { return (STAT_PERSISTENCE_ERROR);}	// empty, torn or stale layout
+
+	cm_set_units_mode((uint8_t)image[9]);
+	cm_set_distance_mode((uint8_t)image[10]);
+	cm_select_plane((uint8_t)image[11]);
+	cm_set_coord_system((uint8_t)image[8]);
+	cm_set_feed_rate(image[12]);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		cm_set_position(axis, image[2+axis]);
+	}
+	cm_set_model_linenum((uint32_t)image[1]);
+	nv_store_int(nv, image[1]);					// line number to re-stream from
 	return (STAT_OK);
 }
+#endif // __JOB_CHECKPOINT
+
+#ifdef __STARTUP_MACRO
+/*
+ * Startup macro storage
+ *
+ *	A short gcode sequence (units, offsets, spindle warmup and the like) kept
+ *	in the free EEPROM region between the config singles and the checkpoint
+ *	slots, and replayed through the XIO_DEV_MACRO pseudo-device when the
+ *	controller leaves CONTROLLER_STARTUP - so the machine initializes itself
+ *	without waiting for a host to connect and stream the same lines.
+ *
+ *	Recording is started with $mac=1. Each following console line is stored
+ *	verbatim instead of being executed, until a line containing only '%' (the
+ *	conventional gcode program terminator) seals the header and ends the
+ *	recording. The header is invalidated before recording starts, so a torn
+ *	recording can never replay a stale or partial macro. $mac=0 erases the
+ *	macro, $mac=2 replays it on demand, and $mac alone reports its size.
+ *
+ * macro_store_length()	   - return stored macro size in bytes, 0 if none
+ * macro_store_read()	   - text reads for the XIO_DEV_MACRO device driver
+ * macro_store_recording() - true while console lines are being captured
+ * macro_store_line()	   - store one line; a lone '%' ends the recording
+ * macro_get_macro()	   - get stored macro size for $mac / {"mac":n}
+ * macro_set_macro()	   - $mac=1 record, $mac=0 erase, $mac=2 run now
+ */
+
+static struct {
+	uint8_t recording;					// true from $mac=1 to the '%' terminator
+	uint16_t length;					// macro bytes stored so far while recording
+#ifdef __EVENT_MACRO
+	uint16_t window_start;				// replay window - set by the trigger before the device opens
+	uint16_t window_end;
+#endif
+} mac;
+
+uint16_t macro_store_length()
+{
+	uint16_t header[2];
+	(void)EEPROM_ReadBytes(NVM_MACRO_BASE, (int8_t *)header, sizeof(header));
+	if (header[0] != NVM_MACRO_MAGIC) { return (0);}
+	if (header[1] > NVM_MACRO_SIZE) { return (0);}	// corrupt header
+	return (header[1]);
+}
+
+void macro_store_read(uint16_t offset, int8_t *buf, uint16_t size)
+{
+	(void)EEPROM_ReadBytes(NVM_MACRO_DATA + offset, buf, size);
+}
+
+uint8_t macro_store_recording() { return (mac.recording);}
+
+static void _macro_erase()
+{
+	uint16_t header[2] = { 0xFFFF, 0 };				// killing the magic invalidates the macro
+	(void)EEPROM_WriteBytes(NVM_MACRO_BASE, (int8_t *)header, sizeof(header));
+}
+
+stat_t macro_store_line(char *line)
+{
+	if ((line[0] == '%') && (line[1] == NUL)) {		// seal the header - this makes the macro valid
+		uint16_t header[2] = { NVM_MACRO_MAGIC, mac.length };
+		(void)EEPROM_WriteBytes(NVM_MACRO_BASE, (int8_t *)header, sizeof(header));
+		mac.recording = false;
+		return (STAT_OK);
+	}
+	uint16_t len = strlen(line);
+	if ((mac.length + len + 1) > NVM_MACRO_SIZE) {
+		mac.recording = false;						// abandon - the header still says invalid
+		return (STAT_FILE_SIZE_EXCEEDED);
+	}
+	(void)EEPROM_WriteBytes((NVM_MACRO_DATA + mac.length), (int8_t *)line, len);
+	mac.length += len;
+	int8_t newline = '\n';							// line separator for the device reader
+	(void)EEPROM_WriteBytes((NVM_MACRO_DATA + mac.length++), &newline, 1);
+	return (STAT_OK);
+}
+
+stat_t macro_get_macro(nvObj_t *nv)
+{
+	nv->value = (float)macro_store_length();
+	nv->valuetype = TYPE_FLOAT;
+	nv->precision = 0;
+	return (STAT_OK);
+}
+
+stat_t macro_set_macro(nvObj_t *nv)
+{
+	if (cm.cycle_state != CYCLE_OFF) {
+		return (STAT_COMMAND_NOT_ACCEPTED);			// EEPROM writes are locked out while moving
+	}
+	if (fp_ZERO(nv->value)) {						// $mac=0 erases the stored macro
+		_macro_erase();
+		return (STAT_OK);
+	}
+	if (fp_EQ(nv->value, 1)) {						// $mac=1 starts a recording
+		_macro_erase();								// a stale macro must not survive a torn recording
+		mac.length = 0;
+		mac.recording = true;
+		return (STAT_OK);
+	}
+	if (fp_EQ(nv->value, 2)) {						// $mac=2 replays the stored macro now
+		if (macro_store_length() == 0) { return (STAT_FILE_NOT_OPEN);}
+#ifdef __EVENT_MACRO
+		macro_select_startup();						// labeled sections only replay on their events
+#endif
+		xio_open(XIO_DEV_MACRO, NULL, PGM_FLAGS);
+		tg_set_primary_source(XIO_DEV_MACRO);
+		return (STAT_OK);
+	}
+	return (STAT_INPUT_VALUE_RANGE_ERROR);
+}
+
+#ifdef __EVENT_MACRO
+/*
+ * Event macros
+ *
+ *	The stored macro text may contain labeled sections. A label is a line
+ *	beginning with ':' (":m6", ":start", ":end"); everything from the label
+ *	to the next label - or the end of the macro - is that event's sequence.
+ *	Text before the first label remains the startup section, so macros
+ *	recorded before labels existed replay exactly as they always have.
+ *
+ *	Events replay through the same XIO_DEV_MACRO device switch as the
+ *	startup macro: the trigger selects a replay window and makes the macro
+ *	device the primary input source, so the section's lines parse and queue
+ *	like any console input while the host's stream waits in the RX buffer.
+ *	The section's blocks queue BEHIND the triggering block - an ":m6"
+ *	sequence runs after the M6 that fired it. A macro cannot trigger
+ *	another macro - events raised during a replay are dropped.
+ *
+ * macro_select_startup()	  - set the replay window to the startup section
+ * macro_run_event()		  - replay one labeled section, if present
+ * macro_window_start()/end() - replay window accessors for xio_macro.c
+ */
+
+static uint16_t _macro_next_line(uint16_t offset, uint16_t length)
+{
+	int8_t c;
+	while (offset < length) {
+		macro_store_read(offset++, &c, 1);
+		if (c == '\n') { break;}
+	}
+	return (offset);
+}
+
+static uint8_t _macro_label_match(uint16_t offset, uint16_t length, const char *label)
+{
+	int8_t c;
+	while (*label != NUL) {
+		if (offset >= length) { return (false);}
+		macro_store_read(offset++, &c, 1);
+		if (tolower(c) != *label++) { return (false);}
+	}
+	macro_store_read(offset, &c, 1);			// label must be the whole line
+	return ((c == '\n') || (c == '\r'));
+}
+
+static uint8_t _macro_find_section(const char *label, uint16_t *start, uint16_t *end)
+{
+	uint16_t length = macro_store_length();
+	uint16_t offset = 0;
+	uint8_t found = false;
+	int8_t c;
+
+	while (offset < length) {					// offset walks the line starts
+		macro_store_read(offset, &c, 1);
+		if (c == ':') {
+			if (found == true) { *end = offset; return (true);}	// next label closes the section
+			if (_macro_label_match(offset+1, length, label) == true) {
+				found = true;
+				*start = _macro_next_line(offset, length);		// section starts on the next line
+			}
+		}
+		offset = _macro_next_line(offset, length);
+	}
+	if (found == true) { *end = length;}		// last section runs to the end of the macro
+	return (found);
+}
+
+void macro_select_startup()
+{
+	uint16_t length = macro_store_length();
+	uint16_t offset = 0;
+	int8_t c;
+
+	mac.window_start = 0;
+	mac.window_end = length;					// no labels - the whole macro is startup text
+	while (offset < length) {
+		macro_store_read(offset, &c, 1);
+		if (c == ':') {							// first label ends the startup section
+			mac.window_end = offset;
+			break;
+		}
+		offset = _macro_next_line(offset, length);
+	}
+}
+
+uint16_t macro_window_start() { return (mac.window_start);}
+uint16_t macro_window_end() { return (mac.window_end);}
+
+stat_t macro_run_event(const char *label)
+{
+	if (cs.primary_src == XIO_DEV_MACRO) { return (STAT_NOOP);}	// a replay cannot trigger a replay
+	if (mac.recording == true) { return (STAT_NOOP);}			// the store is mid-rewrite
+	if (_macro_find_section(label, &mac.window_start, &mac.window_end) == false) {
+		return (STAT_NOOP);						// no such section - the event is not customized
+	}
+	xio_open(XIO_DEV_MACRO, NULL, PGM_FLAGS);
+	tg_set_primary_source(XIO_DEV_MACRO);
+	return (STAT_OK);
+}
+#endif // __EVENT_MACRO
+#endif // __STARTUP_MACRO
+
+#ifdef __SETTINGS_PROFILES
+/************************************************************************************
+ * Settings profiles - named complete settings images in application flash
+ *
+ *	Machines that swap between tooling setups (e.g. aluminum vs foam) push ~80
+ *	settings through the serial link and the EEPROM on every changeover. A
+ *	profile stores the complete config image - the same floats the EEPROM
+ *	config region holds - in an app flash slot, so a changeover becomes: load
+ *	the slot into the NVM RAM shadow, then re-run the same token-by-token
+ *	apply loop config_init() uses. Every value goes through its normal setter,
+ *	so the dependent recomputations (steps/unit, jerk terms, the flat axis
+ *	table) happen as side effects, and no EEPROM traffic is involved.
+ *
+ *	  $prof		report the active profile (0 = the EEPROM image)
+ *	  $prof=n	activate profile n; $prof=0 returns to the EEPROM image
+ *	  $profs=n	burn the current settings into flash slot n (1..NVM_PROFILE_SLOTS)
+ *
+ *	While a flash profile is active, settings changes update the RAM shadow
+ *	only - the EEPROM keeps the image 0 values - so changes are volatile until
+ *	burned with $profs, and a reboot always comes up on the EEPROM image.
+ *	Flash programming goes through the resident xboot jump table (see
+ *	xmega/xbootapi.h) and stalls the CPU for a few ms per page, so activation
+ *	and saves are rejected while the machine is moving.
+ */
+
+static uint8_t pf_page[NVM_PROFILE_PAGE];		// flash page staging buffer
+
+static uint32_t _profile_addr(uint8_t slot)
+{
+	return (NVM_PROFILE_BASE + ((uint32_t)(slot-1) * NVM_PROFILE_SIZE));
+}
+
+static uint8_t _profile_valid(uint8_t slot)
+{
+	if (pgm_read_dword_far(_profile_addr(slot)) != NVM_PROFILE_MAGIC) { return (false);}
+	if (pgm_read_dword_far(_profile_addr(slot)+4) != NVM_SHADOW_ENTRIES) { return (false);}	// stale layout
+	return (true);
+}
+
+#ifdef __NVM_WRITEBACK
+static void _flush_writeback_cache()			// settle pending writes against the outgoing image
+{
+	for (uint8_t i=0; i<nvm.cache_count; i++) {
+		_write_value_to_nvm(nvm.cache_index[i], nvm.cache_value[i]);
+	}
+	nvm.cache_count = 0;
+}
+#endif
+
+stat_t profile_get_profile(nvObj_t *nv)
+{
+	nv->value = (float)nvm.active_profile;
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t profile_set_profile(nvObj_t *nv)
+{
+	uint8_t slot = (uint8_t)nv->value;
+
+	if (slot > NVM_PROFILE_SLOTS) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	if (cm_get_runtime_busy() == true) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if ((slot != 0) && (_profile_valid(slot) == false)) { return (STAT_FILE_NOT_OPEN);}	// no stored image
+#ifdef __NVM_WRITEBACK
+	_flush_writeback_cache();
+#endif
+	if (slot == 0) {							// reload the EEPROM image
+		(void)EEPROM_ReadBytes(nvm.profile_base, (int8_t *)nvm.shadow, NVM_SHADOW_ENTRIES * NVM_VALUE_LEN);
+	} else {									// load the flash image into the shadow
+		uint32_t addr = _profile_addr(slot) + NVM_PROFILE_HEADER;
+		uint8_t *image = (uint8_t *)nvm.shadow;
+		for (uint16_t i=0; i < (NVM_SHADOW_ENTRIES * NVM_VALUE_LEN); i++) {
+			image[i] = pgm_read_byte_far(addr + i);
+		}
+	}
+	nvm.active_profile = slot;
+	config_apply_persistent(nv);				// nv is consumed by the apply loop
+	nv->value = (float)slot;					// restore so the response displays cleanly
+	nv->valuetype = TYPE_INTEGER;
+	return (STAT_OK);
+}
+
+stat_t profile_save_profile(nvObj_t *nv)
+{
+	uint8_t slot = (uint8_t)nv->value;
+
+	if ((slot == 0) || (slot > NVM_PROFILE_SLOTS)) { return (STAT_INPUT_VALUE_RANGE_ERROR);}
+	if (cm_get_runtime_busy() == true) { return (STAT_COMMAND_NOT_ACCEPTED);}	// page writes stall the CPU
+#ifdef __NVM_WRITEBACK
+	_flush_writeback_cache();					// the shadow must be current before it is burned
+#endif
+	uint32_t base = _profile_addr(slot);
+	uint8_t *image = (uint8_t *)nvm.shadow;
+	uint16_t image_len = NVM_SHADOW_ENTRIES * NVM_VALUE_LEN;
+
+	// kill the magic first so a power loss mid-burn can't leave a half-written
+	// image looking valid (same discipline as the job store header)
+	flash_scrub_rebase();
+	if (xboot_erase_application_page(base) != XB_SUCCESS) {
+		return (STAT_NO_SUCH_DEVICE);			// boot loader API not present
+	}
+	for (uint8_t page=1; page < (NVM_PROFILE_SIZE / NVM_PROFILE_PAGE); page++) {
+		uint16_t offset = (page * NVM_PROFILE_PAGE) - NVM_PROFILE_HEADER;	// image offset of this page
+		memset(pf_page, 0xFF, NVM_PROFILE_PAGE);
+		if (offset < image_len) {
+			memcpy(pf_page, &image[offset], min(NVM_PROFILE_PAGE, image_len - offset));
+		}
+		flash_scrub_rebase();
+		if (xboot_write_application_page(base + ((uint32_t)page * NVM_PROFILE_PAGE), pf_page, true) != XB_SUCCESS) {
+			return (STAT_INTERNAL_ERROR);
+		}
+	}
+	// the header page carries the magic - writing it last is what commits the save
+	uint32_t magic = NVM_PROFILE_MAGIC;
+	uint32_t count = NVM_SHADOW_ENTRIES;
+	memset(pf_page, 0xFF, NVM_PROFILE_PAGE);
+	memcpy(&pf_page[0], &magic, sizeof(magic));
+	memcpy(&pf_page[4], &count, sizeof(count));
+	memcpy(&pf_page[NVM_PROFILE_HEADER], image, NVM_PROFILE_PAGE - NVM_PROFILE_HEADER);
+	flash_scrub_rebase();
+	if (xboot_write_application_page(base, pf_page, true) != XB_SUCCESS) {
+		return (STAT_INTERNAL_ERROR);
+	}
+	return (STAT_OK);
+}
+#endif // __SETTINGS_PROFILES
 #endif // __AVR
 
 #ifdef __ARM
@@ -123,7 +698,7 @@ stat_t write_persistent_value(nvObj_t *nv)
 }
 #endif // __ARM
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
 
@@ -2,28 +2,28 @@
  * persistence.h - persistence code
  * This file is part of the TinyG project
  *
- * Copyright (c) 2013 - 2014 Alden S. Hart Jr.
- *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
- */
+ * Copyright (c) 2013 - 2014 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
 
 #ifndef PERSISTENCE_H_ONCE
 #define PERSISTENCE_H_ONCE
@@ -33,14 +33,84 @@
 #define NVM_VALUE_LEN 4					// NVM value length (float, fixed length)
 #define NVM_BASE_ADDR 0x0000			// base address of usable NVM
 
+#ifdef __NVM_WRITEBACK
+#define NVM_CACHE_LEN 32				// dirty-value write-back cache entries (~200b RAM)
+#endif
+
+#ifdef __NVM_SHADOW
+#define NVM_SHADOW_ENTRIES 450			// values covered by the RAM shadow image (~1.8Kb RAM)
+										// must be >= the count of single-valued cfgArray entries
+										// (NV_INDEX_END_SINGLES in config_app.c). Out-of-range
+										// indexes fall back to direct EEPROM access
+#endif
+
+#ifdef __JOB_CHECKPOINT
+#define NVM_CHECKPOINT_SLOTS 13			// seal, linenum, position[AXES], coord, units, distance, plane, feed
+#define NVM_CHECKPOINT_BASE (2048 - (NVM_CHECKPOINT_SLOTS * NVM_VALUE_LEN))
+										// top of the 2K EEPROM - the config region below must stay clear of it
+#define NVM_CHECKPOINT_SEAL ((float)8675309)	// folded into the slot 0 checksum
+#define JOB_CHECKPOINT_MS 5000			// minimum interval between staged checkpoints
+#endif
+
+#ifdef __CRASH_DUMP
+#define NVM_CRASH_SIZE 128				// magic + reset cause + snapshot + event ring
+#ifdef __JOB_CHECKPOINT
+#define NVM_CRASH_BASE (NVM_CHECKPOINT_BASE - NVM_CRASH_SIZE)	// below the checkpoint slots
+#else
+#define NVM_CRASH_BASE (2048 - NVM_CRASH_SIZE)
+#endif
+#endif
+
+#ifdef __STARTUP_MACRO
+#define NVM_MACRO_BASE 1800				// byte address above the config singles region (450 * NVM_VALUE_LEN)
+#if defined (__CRASH_DUMP)
+#define NVM_MACRO_TOP NVM_CRASH_BASE		// macro region ends where the crash dump area begins
+#elif defined (__JOB_CHECKPOINT)
+#define NVM_MACRO_TOP NVM_CHECKPOINT_BASE	// macro region ends where the checkpoint slots begin
+#else
+#define NVM_MACRO_TOP 2048
+#endif
+#define NVM_MACRO_HEADER 4				// uint16 magic + uint16 length
+#define NVM_MACRO_DATA (NVM_MACRO_BASE + NVM_MACRO_HEADER)
+#define NVM_MACRO_SIZE (NVM_MACRO_TOP - NVM_MACRO_DATA)	// ~330 bytes of startup macro text
+#define NVM_MACRO_MAGIC 0x4D47			// 'GM' - a valid startup macro is stored
+#endif
+
+#ifdef __SETTINGS_PROFILES
+#define NVM_PROFILE_SLOTS 3				// flash profile slots ($prof 1..3; 0 is the EEPROM image)
+#define NVM_PROFILE_PAGE 512			// app flash page size on the xmega ...A3 parts
+#define NVM_PROFILE_SIZE 2048			// 4 pages per slot: 8 byte header + 416 value image
+#define NVM_PROFILE_TOP 0x20000UL		// profiles sit directly below the job store (JOB_STORE_BASE)
+#define NVM_PROFILE_BASE (NVM_PROFILE_TOP - ((uint32_t)NVM_PROFILE_SLOTS * NVM_PROFILE_SIZE))
+#define NVM_PROFILE_HEADER 8			// uint32 magic + uint32 value count
+#define NVM_PROFILE_MAGIC 0x464f5250UL	// "PROF" - marks a valid stored image
+#endif
+
 //**** persistence singleton ****
 
 typedef struct nvmSingleton {
 	uint16_t base_addr;					// NVM base address
 	uint16_t profile_base;				// NVM base address of current profile]
+#ifdef __SETTINGS_PROFILES
+	uint8_t active_profile;				// 0 = EEPROM image, 1..NVM_PROFILE_SLOTS = flash image
+#endif
 	uint16_t address;
 	float tmp_value;
 	int8_t byte_array[NVM_VALUE_LEN];
+#ifdef __NVM_WRITEBACK
+	index_t cache_index[NVM_CACHE_LEN];	// indexes of dirty values awaiting flush
+	float cache_value[NVM_CACHE_LEN];	// dirty values awaiting flush
+	uint8_t cache_count;				// number of dirty values
+#endif
+#ifdef __NVM_SHADOW
+	float shadow[NVM_SHADOW_ENTRIES];	// RAM image of the NVM area, loaded once at boot
+#endif
+#ifdef __JOB_CHECKPOINT
+	float ckp_image[NVM_CHECKPOINT_SLOTS];	// staged checkpoint awaiting trickle to EEPROM
+	uint8_t ckp_pending;				// cells left to write - counts down so the slot 0 seal lands last
+	uint32_t ckp_linenum;				// line number of the last staged checkpoint
+	uint32_t ckp_systick;				// systick at which the last checkpoint was staged
+#endif
 } nvmSingleton_t;
 
 //**** persistence function prototypes ****
@@ -48,5 +118,32 @@ typedef struct nvmSingleton {
 void persistence_init(void);
 stat_t read_persistent_value(nvObj_t *nv);
 stat_t write_persistent_value(nvObj_t *nv);
+#ifdef __NVM_WRITEBACK
+stat_t persistence_callback(void);
+#endif
+#ifdef __JOB_CHECKPOINT
+stat_t job_checkpoint_callback(void);
+stat_t job_checkpoint_restore(nvObj_t *nv);
+#endif
+#ifdef __STARTUP_MACRO
+uint16_t macro_store_length(void);
+void macro_store_read(uint16_t offset, int8_t *buf, uint16_t size);
+uint8_t macro_store_recording(void);
+stat_t macro_store_line(char *line);
+stat_t macro_get_macro(nvObj_t *nv);			// $mac handlers (see config_app.c)
+stat_t macro_set_macro(nvObj_t *nv);
+#ifdef __EVENT_MACRO
+void macro_select_startup(void);				// set the replay window to the startup section
+stat_t macro_run_event(const char *label);		// replay one labeled section, if present
+uint16_t macro_window_start(void);				// replay window accessors for xio_macro.c
+uint16_t macro_window_end(void);
+#endif
+#endif
+
+#ifdef __SETTINGS_PROFILES
+stat_t profile_get_profile(nvObj_t *nv);		// $prof / $profs handlers (see config_app.c)
+stat_t profile_set_profile(nvObj_t *nv);
+stat_t profile_save_profile(nvObj_t *nv);
+#endif
 
 #endif // End of include guard: PERSISTENCE_H_ONCE
@@ -26,6 +26,7 @@
 #include "canonical_machine.h"
 #include "plan_arc.h"
 #include "planner.h"
+#include "diagnostics.h"
 #include "util.h"
 
 // Allocate arc planner singleton structure
@@ -33,6 +34,11 @@
 arc_t arc;
 
 // Local functions
+#ifdef __ARC_NATIVE
+static uint8_t _native_arc_possible(void);
+static stat_t _queue_native_arc(void);
+#endif
+static stat_t _queue_arc_segment(void);
 static stat_t _compute_arc(void);
 static stat_t _compute_arc_offsets_from_radius(void);
 static void _estimate_arc_time(void);
@@ -75,6 +81,14 @@ stat_t cm_arc_feed(float target[], float flags[],       // arc endpoints
     	return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
 	}
 
+#ifdef __G68_ROTATION
+	if (cm.gmx.rotation_active == true) {			// G68 - rotate the center offset vector to match
+		float ir = i;								//  the (already rotated) endpoints. K lies along
+		i = (cm.gmx.rot_cos * ir) - (cm.gmx.rot_sin * j);	// Z and is unaffected by a Z-axis rotation
+		j = (cm.gmx.rot_sin * ir) + (cm.gmx.rot_cos * j);
+	}
+#endif
+
     // set radius mode flag and do simple test(s)
 	bool radius_f = fp_NOT_ZERO(cm.gf.arc_radius);			    // set true if radius arc
     if ((radius_f) && (cm.gn.arc_radius < MIN_ARC_RADIUS)) {    // radius value must be + and > minimum radius
@@ -157,8 +171,16 @@ stat_t cm_arc_feed(float target[], float flags[],       // arc endpoints
 
 	arc.rotations = floor(fabs(cm.gn.parameter));   // P must be a positive integer - force it if not
 
-	// determine if this is a full circle arc. Evaluates true if no target is set
+	// determine if this is a full circle arc. Evaluates true if no target is set,
+	// or if the programmed endpoint lands back on the starting point (center format
+	// only - the same-point case was trapped above for radius arcs). CAM posts
+	// commonly write the endpoint out explicitly when they mean a full circle.
 	arc.full_circle = (fp_ZERO(flags[arc.plane_axis_0]) & fp_ZERO(flags[arc.plane_axis_1]));
+	if ((!arc.full_circle) && (!radius_f) &&
+		(fp_EQ(cm.gm.target[arc.plane_axis_0], arc.position[arc.plane_axis_0])) &&
+		(fp_EQ(cm.gm.target[arc.plane_axis_1], arc.position[arc.plane_axis_1]))) {
+		arc.full_circle = true;
+	}
 
 	// compute arc runtime values
 	ritorno(_compute_arc());
@@ -175,12 +197,101 @@ stat_t cm_arc_feed(float target[], float flags[],       // arc endpoints
     	return (cm_soft_alarm(status));
 	}
 */
+#ifdef __ARC_NATIVE
+	// Queue the whole arc as one planner buffer - see _queue_native_arc(). Falls
+	// back to plan-time segmentation when the planner is congested, which also
+	// preserves block order behind anything already staged.
+	if (_native_arc_possible()) {
+        return (_queue_native_arc());
+    }
+#endif
 	cm_cycle_start();						// if not already started
 	arc.run_state = MOVE_RUN;				// enable arc to be run from the callback
 	cm_finalize_move();
 	return (STAT_OK);
 }
 
+#ifdef __ARC_NATIVE
+/*
+ * _native_arc_possible() - can this arc be queued as a single native buffer?
+ * _queue_native_arc() - hand the computed arc to the planner as one MOVE_TYPE_ARC buffer
+ *
+ *	Plan-time segmentation burns dozens of planner buffers per arc on chord
+ *	storage, so arc-dense jobs run with a fraction of the configured lookahead.
+ *	A native arc occupies one buffer: the geometry computed by _compute_arc()
+ *	is handed to mp_arc_aline() and segments are generated along the curve at
+ *	execution time (see plan_exec.c). The full lookahead window then stays
+ *	available for velocity planning across the arc's neighbors.
+ *
+ *	Segmentation remains as the fallback: if staging is engaged the arc must
+ *	flow through the staging tier to preserve block order, and if the planner
+ *	has no headroom the callback-driven generator is the path that knows how
+ *	to wait. Both generators produce the same toolpath, so mixing them within
+ *	a job is harmless.
+ */
+static uint8_t _native_arc_possible()
+{
+#ifdef __PLAN_STAGING
+	if (mp_staging_engaged()) {
+        return (false);                             // keep block order behind staged blocks
+    }
+#endif
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+        return (false);                             // no headroom - the callback generator knows how to wait
+    }
+	return (true);
+}
+
+static stat_t _queue_native_arc()
+{
+	mpArcPlan_t plan;
+
+	plan.length = arc.length;
+	plan.planar_travel = fabs(arc.planar_travel);
+	plan.linear_travel = arc.linear_travel;
+	plan.radius = arc.radius;
+	plan.theta_per_mm = arc.angular_travel / arc.length;
+	plan.linear_per_mm = arc.linear_travel / arc.length;
+	plan.center_0 = arc.center_0;
+	plan.center_1 = arc.center_1;
+	plan.plane_axis_0 = arc.plane_axis_0;
+	plan.plane_axis_1 = arc.plane_axis_1;
+	plan.linear_axis = arc.linear_axis;
+
+	// Tangents: position = center + (sin(theta), cos(theta)) * radius, so the
+	// path direction is (cos(theta), -sin(theta)) * radius * dtheta/ds, which
+	// combines with the helix depth rate into a unit vector by construction.
+	float planar_rate = arc.radius * plan.theta_per_mm;     // signed planar fraction of the path
+	float theta_end = arc.theta + arc.angular_travel;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		plan.entry_unit[axis] = 0;
+		plan.exit_unit[axis] = 0;
+	}
+	plan.entry_unit[arc.plane_axis_0] = fast_cos(arc.theta) * planar_rate;
+	plan.entry_unit[arc.plane_axis_1] = -fast_sin(arc.theta) * planar_rate;
+	plan.entry_unit[arc.linear_axis] = plan.linear_per_mm;
+	plan.exit_unit[arc.plane_axis_0] = fast_cos(theta_end) * planar_rate;
+	plan.exit_unit[arc.plane_axis_1] = -fast_sin(theta_end) * planar_rate;
+	plan.exit_unit[arc.linear_axis] = plan.linear_per_mm;
+
+	arc.gm.move_time = arc.arc_time;                // whole-arc time - _compute_arc() left the segment time here
+	arc.gm.target[arc.linear_axis] = arc.position[arc.linear_axis] + arc.linear_travel; // _compute_arc() reset this for the segment generator
+
+	// minimum_time mirrors the rate-limit floor _calc_move_times() provides for lines
+	float minimum_time = plan.planar_travel / cm.a[arc.plane_axis_0].feedrate_max;
+	minimum_time = max(minimum_time, plan.planar_travel / cm.a[arc.plane_axis_1].feedrate_max);
+	if (fabs(arc.linear_travel) > 0) {
+		minimum_time = max(minimum_time, fabs(arc.linear_travel / cm.a[arc.linear_axis].feedrate_max));
+	}
+	arc.gm.minimum_time = minimum_time;
+
+	ritorno(mp_arc_aline(&arc.gm, &plan));
+	cm_cycle_start();                               // if not already started
+	cm_finalize_move();
+	return (STAT_OK);
+}
+#endif // __ARC_NATIVE
+
 /*
  * cm_arc_callback() - generate an arc
  *
@@ -195,12 +306,63 @@ stat_t cm_arc_callback()
 	if (arc.run_state == MOVE_OFF)
         return (STAT_NOOP);
 
+#ifdef __COMMIT_BATCH
+	// Commit up to PLANNER_COMMIT_BATCH segments per pass so short-segment arcs
+	// keep the queue topped up with a single pass's overhead instead of one
+	// controller loop per segment. Each commit still honors the buffer headroom
+	// test, and under __DIAG the pass is also time budgeted so batching cannot
+	// hold off the rest of the controller loop.
+#ifdef __DIAG
+	uint16_t start_ticks = dia_now();
+#endif
+	for (uint8_t batch = PLANNER_COMMIT_BATCH; batch > 0; batch--) {
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM)
+			return (STAT_EAGAIN);
+		stat_t status = _queue_arc_segment();
+		if (status != STAT_EAGAIN)
+			return (status);							// arc is done
+#ifdef __DIAG
+		if ((uint16_t)(dia_now() - start_ticks) > PLANNER_COMMIT_BUDGET_TICKS)
+			break;
+#endif
+	}
+	return (STAT_EAGAIN);
+#else
 	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM)
         return (STAT_EAGAIN);
 
+	return (_queue_arc_segment());
+#endif
+}
+
+/*
+ * _queue_arc_segment() - compute and queue the next arc segment
+ *
+ *	Returns STAT_EAGAIN while segments remain, STAT_OK on the last one.
+ */
+
+static stat_t _queue_arc_segment()
+{
 	arc.theta += arc.arc_segment_theta;
-	arc.gm.target[arc.plane_axis_0] = arc.center_0 + sin(arc.theta) * arc.radius;
-	arc.gm.target[arc.plane_axis_1] = arc.center_1 + cos(arc.theta) * arc.radius;
+#ifdef __ARC_INCREMENTAL_ROTATION
+	// rotate the center-to-position vector by the segment angle using the angle sum
+	// identities - two multiplies and two adds per axis instead of sin()/cos() calls.
+	// Resync against the accumulated theta periodically to cancel rounding drift.
+	if (--arc.renorm_count == 0) {
+		arc.renorm_count = ARC_RENORM_SEGMENTS;
+		arc.vector_0 = fast_sin(arc.theta) * arc.radius;
+		arc.vector_1 = fast_cos(arc.theta) * arc.radius;
+	} else {
+		float vector_0 = arc.vector_0;
+		arc.vector_0 = vector_0 * arc.arc_segment_cos + arc.vector_1 * arc.arc_segment_sin;
+		arc.vector_1 = arc.vector_1 * arc.arc_segment_cos - vector_0 * arc.arc_segment_sin;
+	}
+	arc.gm.target[arc.plane_axis_0] = arc.center_0 + arc.vector_0;
+	arc.gm.target[arc.plane_axis_1] = arc.center_1 + arc.vector_1;
+#else
+	arc.gm.target[arc.plane_axis_0] = arc.center_0 + fast_sin(arc.theta) * arc.radius;
+	arc.gm.target[arc.plane_axis_1] = arc.center_1 + fast_cos(arc.theta) * arc.radius;
+#endif
 	arc.gm.target[arc.linear_axis] += arc.arc_segment_linear_travel;
 	mp_aline(&arc.gm);								// run the line
 	copy_vector(arc.position, arc.gm.target);		// update arc current position
@@ -243,32 +405,32 @@ void cm_abort_arc()
 static stat_t _compute_arc()
 {
 	// Compute radius. A non-zero radius value indicates a radius arc
-    if (fp_NOT_ZERO(arc.radius)) {                  // indicates a radius arc
-        _compute_arc_offsets_from_radius();
-    } else {                                        // compute start radius
-        arc.radius = hypotf(-arc.offset[arc.plane_axis_0], -arc.offset[arc.plane_axis_1]);
-    }
-
-    // Test arc specification for correctness according to:
-    // http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
-    // "It is an error if: when the arc is projected on the selected plane, the distance from
-    //  the current point to the center differs from the distance from the end point to the
-    //  center by more than (.05 inch/.5 mm) OR ((.0005 inch/.005mm) AND .1% of radius)."
-
-    // Compute end radius from the center of circle (offsets) to target endpoint
-    float end_0 = arc.gm.target[arc.plane_axis_0] - arc.position[arc.plane_axis_0] - arc.offset[arc.plane_axis_0];
-    float end_1 = arc.gm.target[arc.plane_axis_1] - arc.position[arc.plane_axis_1] - arc.offset[arc.plane_axis_1];
-    float err = fabs(hypotf(end_0, end_1) - arc.radius);   // end radius - start radius
-    if ( (err > ARC_RADIUS_ERROR_MAX) || 
-        ((err < ARC_RADIUS_ERROR_MIN) && 
-         (err > arc.radius * ARC_RADIUS_TOLERANCE)) ) {
-//        return (STAT_ARC_HAS_IMPOSSIBLE_CENTER_POINT);
-        return (STAT_ARC_SPECIFICATION_ERROR);
-    }
+    if (fp_NOT_ZERO(arc.radius)) {                  // indicates a radius arc
+        _compute_arc_offsets_from_radius();
+    } else {                                        // compute start radius
+        arc.radius = hypotf(-arc.offset[arc.plane_axis_0], -arc.offset[arc.plane_axis_1]);
+    }
+
+    // Test arc specification for correctness according to:
+    // http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
+    // "It is an error if: when the arc is projected on the selected plane, the distance from
+    //  the current point to the center differs from the distance from the end point to the
+    //  center by more than (.05 inch/.5 mm) OR ((.0005 inch/.005mm) AND .1% of radius)."
+
+    // Compute end radius from the center of circle (offsets) to target endpoint
+    float end_0 = arc.gm.target[arc.plane_axis_0] - arc.position[arc.plane_axis_0] - arc.offset[arc.plane_axis_0];
+    float end_1 = arc.gm.target[arc.plane_axis_1] - arc.position[arc.plane_axis_1] - arc.offset[arc.plane_axis_1];
+    float err = fabs(hypotf(end_0, end_1) - arc.radius);   // end radius - start radius
+    if ( (err > ARC_RADIUS_ERROR_MAX) || 
+        ((err < ARC_RADIUS_ERROR_MIN) && 
+         (err > arc.radius * ARC_RADIUS_TOLERANCE)) ) {
+//        return (STAT_ARC_HAS_IMPOSSIBLE_CENTER_POINT);
+        return (STAT_ARC_SPECIFICATION_ERROR);
+    }
 
 	// Calculate the theta (angle) of the current point (position)
 	// arc.theta is angular starting point for the arc (also needed later for calculating center point)
-    arc.theta = atan2(-arc.offset[arc.plane_axis_0], -arc.offset[arc.plane_axis_1]);
+    arc.theta = atan2(-arc.offset[arc.plane_axis_0], -arc.offset[arc.plane_axis_1]);
 
     // g18_correction is used to invert G18 XZ plane arcs for proper CW orientation
     float g18_correction = (cm.gm.select_plane == CANON_PLANE_XZ) ? -1 : 1;
@@ -295,11 +457,18 @@ static stat_t _compute_arc()
         }
 	}
 
-    // Add in travel for rotations
+    // Add in travel for rotations. P counts total turns (LinuxCNC semantics):
+    // P=1 (or omitted) is the programmed arc alone and each extra count adds one
+    // full turn. Full circles start from zero angular travel, so there the count
+    // maps to whole circles directly.
+    float rotations = arc.rotations;
+    if ((!arc.full_circle) && (rotations >= 1)) {
+        rotations -= 1;
+    }
     if (cm.gm.motion_mode == MOTION_MODE_CW_ARC) {
-        arc.angular_travel += (2*M_PI * arc.rotations * g18_correction);
+        arc.angular_travel += (2*M_PI * rotations * g18_correction);
     } else {
-        arc.angular_travel -= (2*M_PI * arc.rotations * g18_correction);
+        arc.angular_travel -= (2*M_PI * rotations * g18_correction);
     }
 
 	// Calculate travel in the depth axis of the helix and compute the time it should take to perform the move
@@ -310,7 +479,10 @@ static stat_t _compute_arc()
 	_estimate_arc_time();	// get an estimate of execution time to inform arc_segment calculation
 
 	// Find the minimum number of arc_segments that meets these constraints...
-	float arc_segments_for_chordal_accuracy = arc.length / sqrt(4*cm.chordal_tolerance * (2 * arc.radius - cm.chordal_tolerance));
+	// Chordal accuracy only depends on the angle subtended in the arc plane, so size
+	// that constraint from the planar travel. Using the full helix length here would
+	// over-segment helical moves with a long linear component and flood the queue.
+	float arc_segments_for_chordal_accuracy = fabs(arc.planar_travel) / fast_sqrt(4*cm.chordal_tolerance * (2 * arc.radius - cm.chordal_tolerance));
 	float arc_segments_for_minimum_distance = arc.length / cm.arc_segment_len;
 	float arc_segments_for_minimum_time = arc.arc_time * MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC;
 
@@ -323,8 +495,15 @@ static stat_t _compute_arc()
 	arc.arc_segment_count = (int32_t)arc.arc_segments;
 	arc.arc_segment_theta = arc.angular_travel / arc.arc_segments;
 	arc.arc_segment_linear_travel = arc.linear_travel / arc.arc_segments;
-    arc.center_0 = arc.position[arc.plane_axis_0] - sin(arc.theta) * arc.radius;
-    arc.center_1 = arc.position[arc.plane_axis_1] - cos(arc.theta) * arc.radius;
+    arc.center_0 = arc.position[arc.plane_axis_0] - fast_sin(arc.theta) * arc.radius;
+    arc.center_1 = arc.position[arc.plane_axis_1] - fast_cos(arc.theta) * arc.radius;
+#ifdef __ARC_INCREMENTAL_ROTATION
+	arc.arc_segment_sin = fast_sin(arc.arc_segment_theta);	// per-arc rotation constants
+	arc.arc_segment_cos = fast_cos(arc.arc_segment_theta);
+	arc.vector_0 = fast_sin(arc.theta) * arc.radius;			// center-to-position starting vector
+	arc.vector_1 = fast_cos(arc.theta) * arc.radius;
+	arc.renorm_count = ARC_RENORM_SEGMENTS;
+#endif
 	arc.gm.target[arc.linear_axis] = arc.position[arc.linear_axis];	// initialize the linear target
 	return (STAT_OK);
 }
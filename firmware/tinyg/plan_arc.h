@@ -16,15 +16,15 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-
+
 #ifndef PLAN_ARC_H_ONCE
 #define PLAN_ARC_H_ONCE
 
-// Arc radius tests. See http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
-//#define ARC_RADIUS_ERROR_MAX    ((float)0.5)        // max allowable mm between start and end radius
-#define ARC_RADIUS_ERROR_MAX    ((float)1.0)        // max allowable mm between start and end radius
-#define ARC_RADIUS_ERROR_MIN    ((float)0.005)      // min mm where 1% rule applies
-#define ARC_RADIUS_TOLERANCE    ((float)0.001)      // 0.1% radius variance test
+// Arc radius tests. See http://linuxcnc.org/docs/html/gcode/gcode.html#sec:G2-G3-Arc
+//#define ARC_RADIUS_ERROR_MAX    ((float)0.5)        // max allowable mm between start and end radius
+#define ARC_RADIUS_ERROR_MAX    ((float)1.0)        // max allowable mm between start and end radius
+#define ARC_RADIUS_ERROR_MIN    ((float)0.005)      // min mm where 1% rule applies
+#define ARC_RADIUS_TOLERANCE    ((float)0.001)      // 0.1% radius variance test
 
 // See planner.h for MM_PER_ARC_SEGMENT and other arc setting #defines
 
@@ -56,6 +56,13 @@ typedef struct arArcSingleton {	    // persistent planner and runtime variables
 	float arc_segment_linear_travel;// linear motion per segment
 	float center_0;				    // center of circle at plane axis 0 (e.g. X for G17)
 	float center_1;				    // center of circle at plane axis 1 (e.g. Y for G17)
+#ifdef __ARC_INCREMENTAL_ROTATION
+	float arc_segment_sin;			// sin/cos of segment angle - rotation constants
+	float arc_segment_cos;
+	float vector_0;					// center-to-position vector, rotated incrementally
+	float vector_1;
+	uint8_t renorm_count;			// segments until next exact sin/cos resync
+#endif
 
 	GCodeState_t gm;			    // Gcode state struct is passed for each arc segment. Usage:
 //	uint32_t linenum;			    // line number of the arc feed move - same for each segment
@@ -68,6 +75,10 @@ typedef struct arArcSingleton {	    // persistent planner and runtime variables
 extern arc_t arc;
 
 
+#ifdef __ARC_INCREMENTAL_ROTATION
+#define ARC_RENORM_SEGMENTS 32	// segments between exact sin/cos resyncs (bounds drift well below chordal tolerance)
+#endif
+
 /* arc function prototypes */	// NOTE: See canonical_machine.h for cm_arc_feed() prototype
 
 void cm_arc_init(void);
@@ -1,29 +1,29 @@
 /*
  * plan_exec.c - execution function for acceleration managed lines
- * This file is part of the TinyG project
+ * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
  * Copyright (c) 2012 - 2015 Rob Giseburt
  *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "tinyg.h"
@@ -34,6 +34,13 @@
 #include "encoder.h"
 #include "report.h"
 #include "util.h"
+#include "thc.h"
+#if defined(__SPINDLE_READY) || defined(__SPINDLE_SYNC) || defined(__SPINDLE_CSS)
+#include "spindle.h"
+#endif
+#ifdef __SPINDLE_SYNC
+#include "settings.h"
+#endif
 /*
 #ifdef __cplusplus
 extern "C"{
@@ -44,11 +51,83 @@ static stat_t _exec_aline_head(void);
 static stat_t _exec_aline_body(void);
 static stat_t _exec_aline_tail(void);
 static stat_t _exec_aline_segment(void);
+#ifdef __ARC_NATIVE
+static void _init_arc_runtime(mpBuf_t *bf);
+static void _arc_waypoint(float s, float target[]);
+static void _arc_segment_target(float segment_length);
+#endif
+#ifdef __CUBIC_SPLINE
+static void _init_spline_runtime(mpBuf_t *bf);
+static float _spline_rate(float t);
+static float _spline_march(float t, float s);
+static void _spline_target(float t, float target[]);
+static void _spline_segment_target(float segment_length);
+#endif
 
 #ifndef __JERK_EXEC
 static void _init_forward_diffs(float Vi, float Vt);
 #endif
 
+#ifdef __VELOCITY_JOG
+static stat_t _exec_velocity_jog(void);
+
+static struct mpJogRuntime {		// velocity-mode jog - see mp_jog_start()
+	volatile uint8_t active;		// true while the jog is generating segments
+	uint8_t axis;
+	float direction;				// +1 or -1 along the axis
+	float velocity;					// current segment velocity (always >= 0)
+	float accel;					// current acceleration (signed)
+	float jerk;						// axis jerk, in mm/min^3
+	float cruise_velocity;			// velocity the jog runs at when held
+	volatile float target_velocity;	// velocity being slewed toward; 0 = stopping
+	volatile float limit_pos;		// absolute position bound for the jog
+	uint8_t exact;					// land exactly on limit_pos instead of stopping inside it
+} jr;
+
+#define JOG_LANDING_VELOCITY ((float)300)	// mm/min crawl for the exact-landing approach (see mp_jog_to)
+#endif
+
+#ifdef __SPINDLE_SYNC
+static stat_t _exec_spindle_sync_segment(mpBuf_t *bf);
+
+static struct mpSyncRuntime {		// spindle-synchronized feed - see _exec_spindle_sync_segment()
+	uint8_t active;					// true while the run buffer is a G33 move
+	uint8_t tracking;				// true once the index pulse has been caught
+	int16_t prev_cnt;				// last sampled spindle encoder count
+	float mm_per_count;				// thread pitch / encoder counts per revolution
+	float distance;					// distance traveled along the move so far
+} sy;
+#endif
+
+#ifdef __INPUT_SHAPER
+static stat_t _exec_shaper_flush(void);
+static void _shaper_engage(void);
+static void _shaper_push(const float pos[]);
+static float _shaper_sample(uint8_t axis, float q);
+static void _shape_target(const float target[], float shaped[]);
+
+#define SHAPER_RING 16				// command history samples - must be a power of 2
+#define SHAPER_MAX_IMPULSES 3		// ZVD is the longest shaper supported
+#define SHAPER_MAX_DELAY ((SHAPER_RING - 1) * NOM_SEGMENT_TIME)
+									// history depth at the segment time floor - the longest
+									//  impulse delay a shaped axis can be allowed (~75 ms)
+
+static struct mpShaperRuntime {		// input shaper - see _shaper_engage()
+	uint8_t engaged;				// history is live and the step stream is being shaped
+	uint8_t impulses;				// 2 for ZV, 3 for ZVD
+	uint8_t axis_on[AXES];			// axis participates in shaping
+	float A[AXES][SHAPER_MAX_IMPULSES];	// impulse amplitudes (sum to 1)
+	float d[AXES][SHAPER_MAX_IMPULSES];	// impulse delays, in minutes (d[0] = 0)
+	float max_delay;				// longest delay of any axis - the flush horizon
+	float t;						// command-stream time at the head of the history
+	float last_input_t;				// time of the last planner (non-flush) segment
+	uint8_t head;					// next history slot to write
+	uint8_t count;					// valid history entries
+	float htime[SHAPER_RING];		// end-of-segment times
+	float hpos[SHAPER_RING][AXES];	// planner targets at those times
+} sh;
+#endif
+
 /*************************************************************************
  * mp_exec_move() - execute runtime functions to prep move for steppers
  *
@@ -60,19 +139,463 @@ stat_t mp_exec_move()
 {
 	mpBuf_t *bf;
 
+#ifdef __TIME_ESTIMATE
+	if (mp_estimate_active()) {							// the stepper layer is detached -
+		st_prep_null();									//  mp_estimate_callback() drains the queue
+		return (STAT_NOOP);
+	}
+#endif
+#ifdef __INPUT_SHAPER
+	if ((sh.engaged) && (mr.move_state == MOVE_OFF)) {	// the stream paused - settle the delayed
+		if ((cm.hold_state == FEEDHOLD_HOLD) ||			//  steps onto the planner position before
+			((bf = mp_get_run_buffer()) == NULL) ||			//  holding, draining or running a non-aline
+			(bf->move_type != MOVE_TYPE_ALINE)) {
+			return (_exec_shaper_flush());
+		}
+	}
+#endif
+#ifdef __VELOCITY_JOG
+	if (jr.active) { return (_exec_velocity_jog());}	// jog generates segments directly
+#endif
 	if ((bf = mp_get_run_buffer()) == NULL) {			// NULL means nothing's running
+#ifdef __QR_LOOKAHEAD_TIME
+		if (cm.motion_state == MOTION_RUN) { qr_record_starvation();}	// queue ran dry mid-motion
+#endif
 		st_prep_null();
 		return (STAT_NOOP);
-	}
-	// Manage cycle and motion state transitions
-	if (bf->move_type == MOVE_TYPE_ALINE) { 			// cycle auto-start for lines only
-		if (cm.motion_state == MOTION_STOP) cm_set_motion_state(MOTION_RUN);
-	}
-	if (bf->bf_func == NULL)
-        return(cm_hard_alarm(STAT_INTERNAL_ERROR));     // never supposed to get here
+	}
+#ifdef __SPINDLE_READY
+	if ((MOVE_TYPE_IS_MOTION(bf->move_type)) && (cm_spindle_ready_gating())) {
+		st_prep_null();									// motion is gated until the spindle reports
+		return (STAT_NOOP);								//  at-speed - see cm_spindle_ready_callback()
+	}
+#endif
+#ifdef __PLAN_THROTTLE
+	if ((MOVE_TYPE_IS_MOTION(bf->move_type)) && (bf->plan_pending)) {
+		st_prep_null();									// the deferred backward pass hasn't reached
+		return (STAT_NOOP);								//  this block yet - see mp_plan_queue_callback()
+	}
+#endif
+#ifdef __START_GATE
+	if ((MOVE_TYPE_IS_MOTION(bf->move_type)) && (mp_start_gate_holding())) {
+		st_prep_null();									// launch waits for planned-time depth -
+		return (STAT_NOOP);								//  see mp_start_gate_callback()
+	}
+#endif
+	// Manage cycle and motion state transitions
+	if (MOVE_TYPE_IS_MOTION(bf->move_type)) { 			// cycle auto-start for motion only
+		if (cm.motion_state == MOTION_STOP) cm_set_motion_state(MOTION_RUN);
+	}
+	if (bf->bf_func == NULL)
+        return(cm_hard_alarm(STAT_INTERNAL_ERROR));     // never supposed to get here
 
 	return (bf->bf_func(bf)); 							// run the move callback in the planner buffer
-}
+}
+
+#ifdef __VELOCITY_JOG
+/*************************************************************************
+ * VELOCITY-MODE JOG
+ *
+ *	A jog is a single open-ended "move" that exists only in the runtime:
+ *	_exec_velocity_jog() generates nominal-time segments directly, slewing
+ *	the segment velocity toward the commanded velocity with jerk-limited
+ *	acceleration. There is no planned move and nothing in the buffer queue,
+ *	so extending the jog (pendant still held) is just a variable update,
+ *	and a stop starts taking effect at the next segment boundary instead
+ *	of after a queue drain.
+ *
+ *	The jog runs until the velocity slews to zero - either because
+ *	mp_jog_stop() zeroed the target or because the position bound passed
+ *	to mp_jog_start() is within stopping distance. The caller owns cycle
+ *	state and model position sync (see cycle_jogging.c). Requires an idle
+ *	planner - callers flush first, same as the queued jog did.
+ *
+ * mp_jog_start()  - begin a jog along one axis toward limit_pos
+ * mp_jog_to()     - begin a jog that lands exactly on a target position
+ * mp_jog_extend() - move the position bound of a jog in flight; returns
+ *					 false on an axis or direction mismatch
+ * mp_jog_stop()   - begin a jerk-limited stop
+ * mp_jog_active() - true from start until the velocity reaches zero
+ */
+void mp_jog_start(uint8_t axis, float direction, float velocity, float limit_pos)
+{
+	jr.axis = axis;
+	jr.direction = direction;
+	jr.velocity = 0;
+	jr.accel = 0;
+	jr.jerk = cm.a[axis].jerk_max * JERK_MULTIPLIER;
+	jr.cruise_velocity = velocity;
+	jr.target_velocity = velocity;
+	jr.limit_pos = limit_pos;
+	jr.exact = false;
+	jr.active = true;
+	cm_set_motion_state(MOTION_RUN);
+	st_request_exec_move();
+}
+
+/*
+ * mp_jog_to() - run a jog that lands exactly on target_pos
+ *
+ *	Same engine as mp_jog_start(), but the bound is a landing point: instead of
+ *	stopping anywhere inside the stopping distance the jog crawls the last of
+ *	the approach at JOG_LANDING_VELOCITY and the final segment is clamped onto
+ *	target_pos. Used by the feedhold park actions, which must put the tool back
+ *	on the hold point exactly before the program resumes. Returns false (and
+ *	starts nothing) if the axis is already on target.
+ */
+uint8_t mp_jog_to(uint8_t axis, float velocity, float target_pos)
+{
+	if (fabs(target_pos - mr.position[axis]) < EPSILON) { return (false);}
+	mp_jog_start(axis, (target_pos >= mr.position[axis]) ? 1 : -1, velocity, target_pos);
+	jr.exact = true;
+	return (true);
+}
+
+uint8_t mp_jog_extend(uint8_t axis, float limit_pos)
+{
+	if ((!jr.active) || (axis != jr.axis)) { return (false);}
+	if (((limit_pos - mr.position[jr.axis]) * jr.direction) <= 0) {	// behind us - that's a reversal
+		return (false);
+	}
+	jr.limit_pos = limit_pos;
+	jr.target_velocity = jr.cruise_velocity;	// un-stop if a stop was in progress
+	return (true);
+}
+
+void mp_jog_stop()
+{
+	jr.target_velocity = 0;
+}
+
+uint8_t mp_jog_active()
+{
+	return (jr.active);
+}
+
+/*
+ * _exec_velocity_jog() - generate one jog segment (called from the exec interrupt)
+ *
+ *	Velocity slewing runs an S-curve on two state variables: acceleration
+ *	moves by at most jerk*T per segment, and ramps back to zero as the
+ *	velocity closes on the target (the velocity picked up while unwinding
+ *	an acceleration a is a^2/2j). The stop starts when the remaining
+ *	distance to limit_pos drops under the jerk-limited stopping distance
+ *	v*sqrt(v/j), padded because deceleration may begin mid-acceleration.
+ *	Segment prep mirrors _exec_aline_segment().
+ */
+static stat_t _exec_velocity_jog()
+{
+	uint8_t i;
+	float travel_steps[MOTORS];
+	float dt = NOM_SEGMENT_TIME;
+
+	// start stopping if the position bound is within stopping distance
+	float remaining = (jr.limit_pos - mr.position[jr.axis]) * jr.direction;
+	if (remaining <= (1.25 * jr.velocity * fast_sqrt(jr.velocity / jr.jerk))) {
+		jr.target_velocity = 0;
+	}
+
+	// jerk-limited velocity slewing
+	float dv = jr.target_velocity - jr.velocity;
+	float da = jr.jerk * dt;
+	if (dv >= 0) {
+		if ((jr.accel > 0) && (dv <= (square(jr.accel) / (2 * jr.jerk)))) {
+			jr.accel = max(jr.accel - da, 0);			// unwind to land on target
+		} else {
+			jr.accel += da;
+		}
+	} else {
+		if ((jr.accel < 0) && (-dv <= (square(jr.accel) / (2 * jr.jerk)))) {
+			jr.accel = min(jr.accel + da, 0);
+		} else {
+			jr.accel -= da;
+		}
+	}
+	jr.velocity = max(jr.velocity + (jr.accel * dt), 0);	// jogs never run backwards
+
+	uint8_t landing = false;
+	if (jr.exact) {				// exact landing - crawl the tail of the approach
+		jr.velocity = max(jr.velocity, min(JOG_LANDING_VELOCITY, remaining / dt));
+		landing = (remaining <= (jr.velocity * dt));		// bound is within this segment
+	}
+
+	if ((!jr.exact) && (jr.target_velocity == 0) && (jr.velocity <= da * dt)) {	// down to the last quantum
+		jr.active = false;
+		cm_set_motion_state(MOTION_STOP);
+		st_prep_null();
+		return (STAT_NOOP);
+	}
+
+	// prep the segment - same mechanics as _exec_aline_segment()
+	for (i=0; i<AXES; i++) { mr.gm.target[i] = mr.position[i];}
+	mr.gm.target[jr.axis] += (jr.velocity * dt * jr.direction);
+	if (landing) { mr.gm.target[jr.axis] = jr.limit_pos;}	// clamp the final segment onto the bound
+
+	for (i=0; i<MOTORS; i++) {
+		mr.commanded_steps[i] = (int32_t)round(mr.position_steps[i]);
+		mr.position_steps[i] = mr.target_steps[i];
+		mr.encoder_steps[i] = en_read_encoder(i);
+	}
+	ik_kinematics(mr.gm.target, mr.target_steps);
+	for (i=0; i<MOTORS; i++) {
+		travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
+	}
+	ritorno(st_prep_line(travel_steps, dt));
+	copy_vector(mr.position, mr.gm.target);
+	mr.segment_velocity = jr.velocity;					// keep velocity reporting honest
+	if (landing) {										// the segment just prepped lands on the bound
+		jr.velocity = 0;
+		jr.active = false;
+		cm_set_motion_state(MOTION_STOP);
+	}
+	return (STAT_EAGAIN);
+}
+#endif // __VELOCITY_JOG
+
+#ifdef __INPUT_SHAPER
+/*
+ * Input shaping - convolve the segment stream with a ZV or ZVD impulse train
+ *
+ *	Shaping runs between the planner and the step converter: each segment's
+ *	cartesian target is replaced by a weighted sum of time-delayed samples of
+ *	the command history before ik_kinematics() sees it. The impulse train is
+ *	chosen so its spectrum has a zero at the machine's resonant frequency, so
+ *	the residual vibration excited by the shaped command largely cancels and
+ *	accelerations can be raised well past where an unshaped machine rings.
+ *	The planner, mr.position and all reporting remain unshaped - like __THC,
+ *	only the step conversion is adjusted - so shaping composes with arcs,
+ *	splines, mesh compensation and feed override without touching them.
+ *
+ *	_shaper_engage() captures the per-axis impulse trains from the axis config
+ *	($_shf resonant frequency, $_shz damping ratio) at the first machining
+ *	move of a cycle, so edits mid-cycle take effect at the next cycle. With
+ *	K = e^(-zeta*pi/sqrt(1-zeta^2)) and Td the damped period:
+ *
+ *	  ZV  ($shm=0): A = { 1, K } / (1+K)          at t = { 0, Td/2 }
+ *	  ZVD ($shm=1): A = { 1, 2K, K^2 } / (1+K)^2  at t = { 0, Td/2, Td }
+ *
+ *	ZVD trades twice the command delay for a much wider notch - use it when
+ *	the resonant frequency shifts with carriage position or load. The delayed
+ *	terms are read from a small ring of (time, target) history samples with
+ *	linear interpolation, so the ~5-10ms segment quantization does not limit
+ *	frequency resolution. Shaping delays the physical motion by up to Td
+ *	behind the planner; _exec_shaper_flush() pads the history and keeps
+ *	prepping segments whenever the stream pauses (feedhold, queue drain, or a
+ *	dwell/command buffer next), so the machine always settles exactly onto
+ *	the planner position before anything observes it.
+ */
+
+static void _shaper_push(const float pos[])
+{
+	sh.htime[sh.head] = sh.t;
+	copy_vector(sh.hpos[sh.head], pos);
+	sh.head = (sh.head + 1) & (SHAPER_RING - 1);
+	if (sh.count < SHAPER_RING) { sh.count++;}
+}
+
+static void _shaper_engage()
+{
+	float max_delay = 0;
+	uint8_t any = false;
+
+	sh.impulses = (cm.shaper_mode == SHAPER_ZVD) ? 3 : 2;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		sh.axis_on[axis] = false;
+		float freq = cm.a[axis].shaper_freq;
+		if (freq < EPSILON) { continue;}				// 0 disables the axis
+		float zeta = min(max(cm.a[axis].shaper_zeta, 0), (float)0.9);
+		float K = exp(-zeta * M_PI / sqrt(1 - square(zeta)));
+		float Td = 1 / (freq * 60 * sqrt(1 - square(zeta)));	// damped period, in minutes
+		if (sh.impulses == 3) {							// ZVD
+			float norm = 1 / square(1 + K);
+			sh.A[axis][0] = norm;
+			sh.A[axis][1] = 2 * K * norm;
+			sh.A[axis][2] = square(K) * norm;
+			sh.d[axis][2] = Td;
+		} else {										// ZV
+			float norm = 1 / (1 + K);
+			sh.A[axis][0] = norm;
+			sh.A[axis][1] = K * norm;
+		}
+		sh.d[axis][0] = 0;
+		sh.d[axis][1] = Td / 2;
+		if (sh.d[axis][sh.impulses-1] > SHAPER_MAX_DELAY) {	// the longest tap outruns the history ring
+			continue;										//  (~7 Hz ZV, ~14 Hz ZVD) - rather than shape
+		}													//  off-frequency, leave the axis unshaped
+		max_delay = max(max_delay, sh.d[axis][sh.impulses-1]);
+		sh.axis_on[axis] = true;
+		any = true;
+	}
+	if (!any) { return;}								// no axis configured - run unshaped
+
+	sh.t = 0;
+	sh.last_input_t = 0;
+	sh.head = 0;
+	sh.count = 0;
+	sh.max_delay = max_delay;
+	_shaper_push(mr.position);							// seed the history at the start position
+	sh.engaged = true;
+}
+
+/*
+ * _shaper_sample() - axis position at command-stream time q, from the history ring
+ *
+ *	Walks back from the newest sample and interpolates linearly between the
+ *	bracketing entries. Times beyond either end clamp to the end sample: past
+ *	the newest during flush (the command is holding still) and past the oldest
+ *	right after engage (the machine was at rest at the seed position).
+ */
+
+static float _shaper_sample(uint8_t axis, float q)
+{
+	uint8_t idx = (sh.head - 1) & (SHAPER_RING - 1);	// newest sample
+
+	if (q >= sh.htime[idx]) { return (sh.hpos[idx][axis]);}
+	for (uint8_t i=1; i<sh.count; i++) {
+		uint8_t prev = (idx - 1) & (SHAPER_RING - 1);
+		if (q >= sh.htime[prev]) {						// q is bracketed - interpolate
+			float span = sh.htime[idx] - sh.htime[prev];
+			if (span < EPSILON) { return (sh.hpos[idx][axis]);}
+			return (sh.hpos[prev][axis] +
+				   ((q - sh.htime[prev]) / span) * (sh.hpos[idx][axis] - sh.hpos[prev][axis]));
+		}
+		idx = prev;
+	}
+	return (sh.hpos[idx][axis]);
+}
+
+static void _shape_target(const float target[], float shaped[])
+{
+	sh.t += mr.segment_time;
+	sh.last_input_t = sh.t;
+	_shaper_push(target);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (!sh.axis_on[axis]) {
+			shaped[axis] = target[axis];
+			continue;
+		}
+		float s = sh.A[axis][0] * target[axis];			// d[0] = 0 - the sample just pushed
+		for (uint8_t i=1; i<sh.impulses; i++) {
+			s += sh.A[axis][i] * _shaper_sample(axis, sh.t - sh.d[axis][i]);
+		}
+		shaped[axis] = s;
+	}
+}
+
+/*
+ * _exec_shaper_flush() - drain the shaper delay line when the stream pauses
+ *
+ *	Generates nominal-time segments holding the planner position while the
+ *	delayed impulse terms catch up, then disengages. Clamping in
+ *	_shaper_sample() makes convergence exact - once every delay tap reads the
+ *	held position the steps land on mr.position and travel goes to zero.
+ */
+
+static stat_t _exec_shaper_flush()
+{
+	uint8_t i;
+	float adjusted[AXES];
+	float travel_steps[MOTORS];
+
+	sh.t += NOM_SEGMENT_TIME;							// the command holds the planner position
+	_shaper_push(mr.position);
+	uint8_t done = ((sh.t - sh.last_input_t) >= sh.max_delay);
+
+	copy_vector(adjusted, mr.position);
+	if (!done) {
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (!sh.axis_on[axis]) { continue;}
+			float s = 0;
+			for (i=0; i<sh.impulses; i++) {
+				s += sh.A[axis][i] * _shaper_sample(axis, sh.t - sh.d[axis][i]);
+			}
+			adjusted[axis] = s;
+		}
+	}
+	for (i=0; i<MOTORS; i++) {							// segment mechanics match _exec_aline_segment()
+		mr.commanded_steps[i] = (int32_t)round(mr.position_steps[i]);
+		mr.position_steps[i] = mr.target_steps[i];
+		mr.encoder_steps[i] = en_read_encoder(i);
+	}
+	ik_kinematics(adjusted, mr.target_steps);
+	for (i=0; i<MOTORS; i++) {
+		travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
+	}
+	ritorno(st_prep_line(travel_steps, NOM_SEGMENT_TIME));
+	if (done) { sh.engaged = false;}					// steps have converged on the planner position
+	return (STAT_EAGAIN);
+}
+#endif // __INPUT_SHAPER
+
+#ifdef __SPINDLE_SYNC
+/*
+ * _exec_spindle_sync_segment() - run one segment of a G33 move paced by the spindle
+ *
+ *	Runs in place of the head/body/tail sections for MOTION_MODE_SPINDLE_SYNC_FEED
+ *	buffers (see the dispatcher in mp_exec_aline()). Until the index pulse arrives
+ *	the steppers are fed dwell segments - at most one spindle revolution of
+ *	latency - so every pass engages the thread at the same spindle angle. From
+ *	then on each nominal-time segment advances along the move unit vector by
+ *	exactly the distance the spindle turned since the last sample (encoder count
+ *	delta x pitch / counts-per-rev). Position-domain slaving self-corrects: a
+ *	segment that lags is made up by the next one, so pitch error never
+ *	accumulates. The planned velocity profile is ignored - it only served to
+ *	validate the move - and feed override does not apply (plan_line.c already
+ *	excludes non-G1 moves). Segment mechanics match _exec_velocity_jog().
+ */
+
+static stat_t _exec_spindle_sync_segment(mpBuf_t *bf)
+{
+	uint8_t i;
+	float travel_steps[MOTORS];
+	float dt = NOM_SEGMENT_TIME;
+
+	if (!sy.tracking) {
+		if (!cm_spindle_sync_index_seen()) {			// idle until the index pulse arrives
+			st_prep_dwell((uint32_t)NOM_SEGMENT_USEC);
+			return (STAT_EAGAIN);
+		}
+		sy.tracking = true;
+		sy.prev_cnt = cm_spindle_sync_index_count();
+	}
+	int16_t cnt = cm_spindle_sync_count();
+	int16_t delta = (int16_t)(cnt - sy.prev_cnt);
+	sy.prev_cnt = cnt;
+	if (delta < 0) { delta = -delta;}					// M4 spindles count down
+
+	float travel = delta * sy.mm_per_count;
+	if (travel < EPSILON) {								// spindle stalled or still accelerating
+		st_prep_dwell((uint32_t)NOM_SEGMENT_USEC);		//  - mark time without moving
+		return (STAT_EAGAIN);
+	}
+	if ((sy.distance + travel) >= bf->length) {			// land exactly on the move target;
+		travel = bf->length - sy.distance;				//  overshoot counts are discarded
+		sy.active = false;
+	}
+	sy.distance += travel;
+
+	// prep the segment - same mechanics as _exec_aline_segment()
+	for (i=0; i<AXES; i++) { mr.gm.target[i] = mr.position[i] + (mr.unit[i] * travel);}
+
+	for (i=0; i<MOTORS; i++) {
+		mr.commanded_steps[i] = (int32_t)round(mr.position_steps[i]);
+		mr.position_steps[i] = mr.target_steps[i];
+		mr.encoder_steps[i] = en_read_encoder(i);
+	}
+	ik_kinematics(mr.gm.target, mr.target_steps);
+	for (i=0; i<MOTORS; i++) {
+		travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
+	}
+	stat_t status = st_prep_line(travel_steps, dt);
+	if (status != STAT_OK) {
+		sy.active = false;								// errors end the move (see mp_exec_aline())
+		return (status);
+	}
+	copy_vector(mr.position, mr.gm.target);
+	mr.segment_velocity = travel / dt;					// keep velocity reporting honest
+	return (sy.active ? STAT_EAGAIN : STAT_OK);
+}
+#endif // __SPINDLE_SYNC
 
 /*************************************************************************/
 /**** ALINE EXECUTION ROUTINES *******************************************/
@@ -153,30 +676,38 @@ stat_t mp_exec_move()
 
 stat_t mp_exec_aline(mpBuf_t *bf)
 {
-	if (bf->move_state == MOVE_OFF)
-        return (STAT_NOOP);
-
+	if (bf->move_state == MOVE_OFF)
+        return (STAT_NOOP);
+
 	// start a new move by setting up local context (singleton)
 	if (mr.move_state == MOVE_OFF) {
 		if (cm.hold_state == FEEDHOLD_HOLD)
             return (STAT_NOOP);	                        // stops here if holding
 
-		// initialization to process the new incoming bf buffer (Gcode block)
-		memcpy(&mr.gm, &(bf->gm), sizeof(GCodeState_t));// copy in the gcode model state
+		// initialization to process the new incoming bf buffer (Gcode block)
+		cm_core_to_state(&mr.gm, &bf->gm);				// expand the compacted gcode model state
 		bf->replannable = false;
-														// too short lines have already been removed
+														// too short lines have already been removed
 		if (fp_ZERO(bf->length)) {						// ...looks for an actual zero here
 			mr.move_state = MOVE_OFF;					// reset mr buffer
 			mr.section_state = SECTION_OFF;
 			bf->nx->replannable = false;				// prevent overplanning (Note 2)
 			st_prep_null();								// call this to keep the loader happy
-			if (mp_free_run_buffer()) cm_cycle_end();	// free buffer & end cycle if planner is empty
+			if (mp_free_run_buffer()) cm_cycle_end();	// free buffer & end cycle if planner is empty
 			return (STAT_NOOP);
 		}
 		bf->move_state = MOVE_RUN;
 		mr.move_state = MOVE_RUN;
 		mr.section = SECTION_HEAD;
-		mr.section_state = SECTION_NEW;
+		mr.section_state = SECTION_NEW;
+#ifdef __THC
+		mr.thc_active = ((thc.enable != 0) && (mr.gm.spindle_mode != SPINDLE_OFF));
+#endif
+#ifdef __INPUT_SHAPER
+		if ((sh.engaged == false) && (cm.cycle_state == CYCLE_MACHINING)) {
+			_shaper_engage();							// no-op unless an axis has $_shf set
+		}
+#endif
 		mr.jerk = bf->jerk;
 #ifdef __JERK_EXEC
 		mr.jerk_div2 = bf->jerk/2;						// only needed by __JERK_EXEC
@@ -188,35 +719,86 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		mr.entry_velocity = bf->entry_velocity;
 		mr.cruise_velocity = bf->cruise_velocity;
 		mr.exit_velocity = bf->exit_velocity;
+#ifdef __PLAN_EXPORT
+		pex_record_block(bf);							// capture the planned profile for $pex streaming
+#endif
 
 		copy_vector(mr.unit, bf->unit);
 		copy_vector(mr.target, bf->gm.target);			// save the final target of the move
-
-		// generate the waypoints for position correction at section ends
-		for (uint8_t axis=0; axis<AXES; axis++) {
-			mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.head_length;
-			mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length);
-			mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length + mr.tail_length);
-		}
+
+		// generate the waypoints for position correction at section ends
+#if defined(__ARC_NATIVE) || defined(__CUBIC_SPLINE)
+#ifdef __ARC_NATIVE
+		mr.arc_active = false;
+#endif
+#ifdef __CUBIC_SPLINE
+		mr.spline_active = false;
+#endif
+#ifdef __ARC_NATIVE
+		if (bf->move_type == MOVE_TYPE_ARC) {
+			_init_arc_runtime(bf);						// also generates the arc waypoints
+		} else
+#endif
+#ifdef __CUBIC_SPLINE
+		if (bf->move_type == MOVE_TYPE_SPLINE) {
+			_init_spline_runtime(bf);					// also generates the spline waypoints
+		} else
+#endif
+		{
+			for (uint8_t axis=0; axis<AXES; axis++) {
+				mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.head_length;
+				mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length);
+				mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length + mr.tail_length);
+			}
+		}
+#else
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			mr.waypoint[SECTION_HEAD][axis] = mr.position[axis] + mr.unit[axis] * mr.head_length;
+			mr.waypoint[SECTION_BODY][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length);
+			mr.waypoint[SECTION_TAIL][axis] = mr.position[axis] + mr.unit[axis] * (mr.head_length + mr.body_length + mr.tail_length);
+		}
+#endif
+#ifdef __SPINDLE_SYNC
+		if (mr.gm.motion_mode == MOTION_MODE_SPINDLE_SYNC_FEED) {	// G33 - slave execution to the spindle
+			sy.active = true;
+			sy.tracking = false;
+			sy.distance = 0;
+			sy.mm_per_count = mr.gm.parameter / SPINDLE_SYNC_COUNTS_PER_REV;
+			cm_spindle_sync_arm();						// catch the next index pulse
+		}
+#endif
 	}
 	// NB: from this point on the contents of the bf buffer do not affect execution
 
 	//**** main dispatcher to process segments ***
 	stat_t status = STAT_OK;
-	if (mr.section == SECTION_HEAD) { status = _exec_aline_head();} else
+#ifdef __SPINDLE_SYNC
+	if (sy.active) { status = _exec_spindle_sync_segment(bf);} else
+#endif
+	if (mr.section == SECTION_HEAD) { status = _exec_aline_head();} else
 	if (mr.section == SECTION_BODY) { status = _exec_aline_body();} else
-	if (mr.section == SECTION_TAIL) { status = _exec_aline_tail();} else
+	if (mr.section == SECTION_TAIL) { status = _exec_aline_tail();} else
 	if (mr.move_state == MOVE_SKIP_BLOCK) { status = STAT_OK;}
-	else { return(cm_hard_alarm(STAT_INTERNAL_ERROR));}	// never supposed to get here
+	else { return(cm_hard_alarm(STAT_INTERNAL_ERROR));}	// never supposed to get here
+
+#ifdef __STOP_PLAN
+	if (status == STAT_EAGAIN) { mp_update_stop_plan(bf);}	// keep the feedhold stop plan current
+#endif
 
 	// Feedhold processing. Refer to canonical_machine.h for state machine
-	// Catch the feedhold request and start the planning the hold
+	// Catch the feedhold request and start the planning the hold.
+	// Spindle-synchronized moves finish the pass first - a hold planned over a
+	// G33 would break the thread, so the transition waits for the move to end
+#ifdef __SPINDLE_SYNC
+	if ((cm.hold_state == FEEDHOLD_SYNC) && (!sy.active)) { cm.hold_state = FEEDHOLD_PLAN;}
+#else
 	if (cm.hold_state == FEEDHOLD_SYNC) { cm.hold_state = FEEDHOLD_PLAN;}
+#endif
 
 	// Look for the end of the decel to go into HOLD state
 	if ((cm.hold_state == FEEDHOLD_DECEL) && (status == STAT_OK)) {
 		cm.hold_state = FEEDHOLD_HOLD;
-		cm_set_motion_state(MOTION_HOLD);
+		cm_set_motion_state(MOTION_HOLD);
 		sr_request_status_report(SR_IMMEDIATE_REQUEST);
 	}
 
@@ -234,7 +816,12 @@ stat_t mp_exec_aline(mpBuf_t *bf)
 		mr.section_state = SECTION_OFF;
 		bf->nx->replannable = false;					// prevent overplanning (Note 2)
 		if (bf->move_state == MOVE_RUN) {
-			if (mp_free_run_buffer()) cm_cycle_end();	// free buffer & end cycle if planner is empty
+			if (mp_free_run_buffer()) {					// free buffer & end cycle if planner is empty
+#ifdef __QR_LOOKAHEAD_TIME
+				qr_record_starvation();					// queue drained at a move boundary - see report.c
+#endif
+				cm_cycle_end();
+			}
 		}
 	}
 	return (status);
@@ -341,6 +928,28 @@ stat_t mp_exec_aline(mpBuf_t *bf)
  *
  *  Note that with our current control points, D and E are actually 0.
  */
+#ifdef __ADAPTIVE_SEGMENTS
+/*
+ * _segment_usec() - queue-depth-adaptive nominal segment time
+ *
+ *	Scales linearly from $sgl with the planner queue nearly empty to $sgh with
+ *	the queue full. A deep queue means lookahead is not at risk, so longer
+ *	segments shed per-segment EXEC/PREP overhead on long constant-velocity runs;
+ *	a shallow queue (short-segment gcode, serial starvation) drops back to short
+ *	segments so the queue drains as slowly as possible. Sampled once per move
+ *	section, so all segments within a section remain identical.
+ */
+static float _segment_usec(void)
+{
+	float span = cm.segment_usec_max - cm.segment_usec_min;
+	if (span < 0) { span = 0;}					// guard against $sgl set above $sgh
+	float fill = (float)(PLANNER_BUFFER_POOL_SIZE - mp_get_planner_buffers_available()) / PLANNER_BUFFER_POOL_SIZE;
+	return (cm.segment_usec_min + (span * fill));
+}
+#else
+#define _segment_usec() NOM_SEGMENT_USEC
+#endif // __ADAPTIVE_SEGMENTS
+
 #ifndef __JERK_EXEC
 
 static void _init_forward_diffs(float Vi, float Vt)
@@ -393,12 +1002,12 @@ static stat_t _exec_aline_head()
 {
 	if (mr.section_state == SECTION_NEW) {							// initialize the move singleton (mr)
 		if (fp_ZERO(mr.head_length)) {
-			mr.section = SECTION_BODY;
+			mr.section = SECTION_BODY;
 			return(_exec_aline_body());								// skip ahead to the body generator
-		}
+		}
 		mr.midpoint_velocity = (mr.entry_velocity + mr.cruise_velocity) / 2;
 		mr.gm.move_time = mr.head_length / mr.midpoint_velocity;	// time for entire accel region
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * NOM_SEGMENT_USEC)); // # of segments in *each half*
+		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * _segment_usec())); // # of segments in *each half*
 		mr.segment_time = mr.gm.move_time / (2 * mr.segments);
 		mr.accel_time = 2 * sqrt((mr.cruise_velocity - mr.entry_velocity) / mr.jerk);
 		mr.midpoint_acceleration = 2 * (mr.cruise_velocity - mr.entry_velocity) / mr.accel_time;
@@ -410,7 +1019,7 @@ static stat_t _exec_aline_head()
 		mr.section = SECTION_HEAD;
 		mr.section_state = SECTION_1st_HALF;
 	}
-	if (mr.section_state == SECTION_1st_HALF) {						// FIRST HALF (concave part of accel curve)
+	if (mr.section_state == SECTION_1st_HALF) {						// FIRST HALF (concave part of accel curve)
 		mr.segment_velocity = mr.entry_velocity + (square(mr.elapsed_accel_time) * mr.jerk_div2);
 		if (_exec_aline_segment() == STAT_OK) { 					// set up for second half
 			mr.segment_count = (uint32_t)mr.segments;
@@ -424,8 +1033,8 @@ static stat_t _exec_aline_head()
 			(mr.elapsed_accel_time * mr.midpoint_acceleration) -
 			(square(mr.elapsed_accel_time) * mr.jerk_div2);
 		if (_exec_aline_segment() == STAT_OK) {						// OK means this section is done
-			if ((fp_ZERO(mr.body_length)) && (fp_ZERO(mr.tail_length)))
-                return(STAT_OK);                                    // ends the move
+			if ((fp_ZERO(mr.body_length)) && (fp_ZERO(mr.tail_length)))
+                return(STAT_OK);                                    // ends the move
 			mr.section = SECTION_BODY;
 			mr.section_state = SECTION_NEW;
 		}
@@ -438,11 +1047,11 @@ static stat_t _exec_aline_head()
 {
 	if (mr.section_state == SECTION_NEW) {							// initialize the move singleton (mr)
 		if (fp_ZERO(mr.head_length)) {
-			mr.section = SECTION_BODY;
+			mr.section = SECTION_BODY;
 			return(_exec_aline_body());								// skip ahead to the body generator
-		}
+		}
 		mr.gm.move_time = 2*mr.head_length / (mr.entry_velocity + mr.cruise_velocity);// time for entire accel region
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = ceil(uSec(mr.gm.move_time) / _segment_usec());// # of segments for the section
 		mr.segment_time = mr.gm.move_time / mr.segments;
 		_init_forward_diffs(mr.entry_velocity, mr.cruise_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
@@ -453,7 +1062,7 @@ static stat_t _exec_aline_head()
 	}
 	// For forward differencing we should have one segment in SECTION_1st_HALF
 	// However, if it returns from that as STAT_OK, then there was only one segment in this section.
-	if (mr.section_state == SECTION_1st_HALF) {						// FIRST HALF (concave part of accel curve)
+	if (mr.section_state == SECTION_1st_HALF) {						// FIRST HALF (concave part of accel curve)
 		if (_exec_aline_segment() == STAT_OK) { 					// set up for second half
 			mr.section = SECTION_BODY;
 			mr.section_state = SECTION_NEW;
@@ -528,19 +1137,37 @@ static stat_t _exec_aline_body()
 			return(_exec_aline_tail());						// skip ahead to tail periods
 		}
 		mr.gm.move_time = mr.body_length / mr.cruise_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);
+		mr.segments = ceil(uSec(mr.gm.move_time) / _segment_usec());
 		mr.segment_time = mr.gm.move_time / mr.segments;
 		mr.segment_velocity = mr.cruise_velocity;
 		mr.segment_count = (uint32_t)mr.segments;
 		if (mr.segment_time < MIN_SEGMENT_TIME)
             return(STAT_MINIMUM_TIME_MOVE);                 // exit without advancing position
+#ifdef __EXEC_SEGMENT_BATCH
+#ifdef __MESH_COMP
+		// Mesh compensation varies with XY position, so constant precomputed
+		// segment steps would freeze the Z correction for the whole body -
+		// send those moves through the per-segment kinematics path instead
+		mr.mesh_bypass = ((kn_mesh_state() == true) &&
+			(fp_NOT_ZERO(mr.unit[AXIS_X]) || fp_NOT_ZERO(mr.unit[AXIS_Y])));
+		if (mr.mesh_bypass == false) {
+#endif
+		// Body segments are all identical, so hoist the per-segment target and
+		// kinematics math out of the segment runner - see _exec_aline_segment()
+		float segment_length = mr.segment_velocity * mr.segment_time;
+		for (uint8_t i=0; i<AXES; i++) { mr.segment_delta[i] = mr.unit[i] * segment_length; }
+		ik_kinematics(mr.segment_delta, mr.segment_steps);
+#ifdef __MESH_COMP
+		}
+#endif
+#endif
 		mr.section = SECTION_BODY;
 		mr.section_state = SECTION_2nd_HALF;				// uses PERIOD_2 so last segment detection works
 	}
 	if (mr.section_state == SECTION_2nd_HALF) {				// straight part (period 3)
 		if (_exec_aline_segment() == STAT_OK) {				// OK means this section is done
-			if (fp_ZERO(mr.tail_length))
-                return(STAT_OK);	                        // ends the move
+			if (fp_ZERO(mr.tail_length))
+                return(STAT_OK);	                        // ends the move
 			mr.section = SECTION_TAIL;
 			mr.section_state = SECTION_NEW;
 		}
@@ -561,12 +1188,12 @@ static stat_t _exec_aline_tail()
             return(STAT_OK);			                            // end the move
 		mr.midpoint_velocity = (mr.cruise_velocity + mr.exit_velocity) / 2;
 		mr.gm.move_time = mr.tail_length / mr.midpoint_velocity;
-		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * NOM_SEGMENT_USEC));// # of segments in *each half*
+		mr.segments = ceil(uSec(mr.gm.move_time) / (2 * _segment_usec()));// # of segments in *each half*
 		mr.segment_time = mr.gm.move_time / (2 * mr.segments);		// time to advance for each segment
 		mr.accel_time = 2 * sqrt((mr.cruise_velocity - mr.exit_velocity) / mr.jerk);
 		mr.midpoint_acceleration = 2 * (mr.cruise_velocity - mr.exit_velocity) / mr.accel_time;
 		mr.segment_accel_time = mr.accel_time / (2 * mr.segments);	// time to advance for each segment
-		mr.elapsed_accel_time = mr.segment_accel_time / 2;			//compute time from midpoint of segment
+		mr.elapsed_accel_time = mr.segment_accel_time / 2;			//compute time from midpoint of segment
 		mr.segment_count = (uint32_t)mr.segments;
 		if (mr.segment_time < MIN_SEGMENT_TIME)
             return(STAT_MINIMUM_TIME_MOVE);                         // exit without advancing position
@@ -579,7 +1206,7 @@ static stat_t _exec_aline_tail()
 			mr.segment_count = (uint32_t)mr.segments;
 			mr.section_state = SECTION_2nd_HALF;
 			mr.elapsed_accel_time = mr.segment_accel_time / 2;		// start time from midpoint of segment
-		}
+		}
 		return(STAT_EAGAIN);
 	}
 	if (mr.section_state == SECTION_2nd_HALF) {						// SECOND HALF - concave part (period 5)
@@ -599,7 +1226,7 @@ static stat_t _exec_aline_tail()
 		if (fp_ZERO(mr.tail_length))
             return(STAT_OK);                                        // end the move
 		mr.gm.move_time = 2*mr.tail_length / (mr.cruise_velocity + mr.exit_velocity); // len/avg. velocity
-		mr.segments = ceil(uSec(mr.gm.move_time) / NOM_SEGMENT_USEC);// # of segments for the section
+		mr.segments = ceil(uSec(mr.gm.move_time) / _segment_usec());// # of segments for the section
 		mr.segment_time = mr.gm.move_time / mr.segments;			// time to advance for each segment
 		_init_forward_diffs(mr.cruise_velocity, mr.exit_velocity);
 		mr.segment_count = (uint32_t)mr.segments;
@@ -669,69 +1296,350 @@ static stat_t _exec_aline_tail()
 }
 #endif // __JERK_EXEC
 
+#ifdef __ARC_NATIVE
+/*
+ * _init_arc_runtime() - set up runtime state for a native arc (MOVE_TYPE_ARC)
+ * _arc_waypoint() - evaluate the arc position at path distance s (exact sin/cos)
+ * _arc_segment_target() - advance the arc by one segment (incremental rotation)
+ *
+ *	A native arc block carries its geometry instead of pre-segmented chords -
+ *	see mp_arc_aline() and the __ARC_NATIVE notes in plan_arc.c. The velocity
+ *	profile machinery is untouched: head/body/tail run exactly as for a line,
+ *	only the conversion from path distance to axis targets changes. The angle
+ *	state is (re)derived from the current position and the stored center, so
+ *	holds and replans that trim the block's length need no special casing.
+ *
+ *	Per-segment targets use a third-order small-angle rotation of the center-
+ *	to-position vector - the same idea as __ARC_INCREMENTAL_ROTATION at plan
+ *	time, but the segment angle varies with velocity so the rotation constants
+ *	cannot be precomputed. The vector is resynced with exact sin/cos from the
+ *	accumulated angle every ARC_EXEC_RENORM segments and at every section
+ *	waypoint, which bounds rounding drift well below a step.
+ */
+#define ARC_EXEC_RENORM 32				// segments between exact sin/cos resyncs
+
+static void _init_arc_runtime(mpBuf_t *bf)
+{
+	mr.arc_active = true;
+	mr.arc_plane_0 = bf->arc_plane_0;
+	mr.arc_plane_1 = bf->arc_plane_1;
+	mr.arc_linear_axis = bf->arc_linear_axis;
+	mr.arc_center_0 = bf->arc_center_0;
+	mr.arc_center_1 = bf->arc_center_1;
+	mr.arc_radius = bf->arc_radius;
+	mr.arc_theta_per_mm = bf->arc_theta_per_mm;
+	mr.arc_linear_per_mm = bf->arc_linear_per_mm;
+	mr.arc_vector_0 = mr.position[mr.arc_plane_0] - mr.arc_center_0;
+	mr.arc_vector_1 = mr.position[mr.arc_plane_1] - mr.arc_center_1;
+	mr.arc_theta = atan2(mr.arc_vector_0, mr.arc_vector_1);	// position = center + (sin, cos) * radius
+	mr.arc_renorm_count = ARC_EXEC_RENORM;
+
+	float s = mr.head_length;								// generate the section waypoints
+	mr.arc_waypoint_theta[SECTION_HEAD] = mr.arc_theta + (s * mr.arc_theta_per_mm);
+	_arc_waypoint(s, mr.waypoint[SECTION_HEAD]);
+	s += mr.body_length;
+	mr.arc_waypoint_theta[SECTION_BODY] = mr.arc_theta + (s * mr.arc_theta_per_mm);
+	_arc_waypoint(s, mr.waypoint[SECTION_BODY]);
+	s += mr.tail_length;
+	mr.arc_waypoint_theta[SECTION_TAIL] = mr.arc_theta + (s * mr.arc_theta_per_mm);
+	copy_vector(mr.waypoint[SECTION_TAIL], mr.target);		// land exactly on the block target
+}
+
+static void _arc_waypoint(float s, float target[])			// only valid at move initialization
+{
+	float theta = mr.arc_theta + (s * mr.arc_theta_per_mm);
+	for (uint8_t axis=0; axis<AXES; axis++) {				// non-participating axes land immediately
+		target[axis] = mr.target[axis];						// (copy_vector can't size a pointer parameter)
+	}
+	target[mr.arc_plane_0] = mr.arc_center_0 + fast_sin(theta) * mr.arc_radius;
+	target[mr.arc_plane_1] = mr.arc_center_1 + fast_cos(theta) * mr.arc_radius;
+	target[mr.arc_linear_axis] = mr.position[mr.arc_linear_axis] + (s * mr.arc_linear_per_mm);
+}
+
+static void _arc_segment_target(float segment_length)
+{
+	float dtheta = segment_length * mr.arc_theta_per_mm;
+	mr.arc_theta += dtheta;
+	if (--mr.arc_renorm_count == 0) {						// exact resync cancels accumulated rounding
+		mr.arc_renorm_count = ARC_EXEC_RENORM;
+		mr.arc_vector_0 = fast_sin(mr.arc_theta) * mr.arc_radius;
+		mr.arc_vector_1 = fast_cos(mr.arc_theta) * mr.arc_radius;
+	} else {
+		float sin_d = dtheta * (1 - (dtheta * dtheta) / 6);	// third-order small angle terms
+		float cos_d = 1 - (dtheta * dtheta) / 2;
+		float vector_0 = mr.arc_vector_0;
+		mr.arc_vector_0 = vector_0 * cos_d + mr.arc_vector_1 * sin_d;
+		mr.arc_vector_1 = mr.arc_vector_1 * cos_d - vector_0 * sin_d;
+	}
+	copy_vector(mr.gm.target, mr.target);					// non-participating axes land immediately
+	mr.gm.target[mr.arc_plane_0] = mr.arc_center_0 + mr.arc_vector_0;
+	mr.gm.target[mr.arc_plane_1] = mr.arc_center_1 + mr.arc_vector_1;
+	mr.gm.target[mr.arc_linear_axis] = mr.position[mr.arc_linear_axis] + (segment_length * mr.arc_linear_per_mm);
+}
+#endif // __ARC_NATIVE
+
+#ifdef __CUBIC_SPLINE
+/*
+ * _init_spline_runtime() - set up runtime state for a native spline (MOVE_TYPE_SPLINE)
+ * _spline_rate() - |dB/dt| at parameter t (curve mm per unit of parameter)
+ * _spline_march() - advance the parameter by path distance s (waypoint placement)
+ * _spline_target() - evaluate the curve at t into an axis target
+ * _spline_segment_target() - advance the spline by one segment
+ *
+ *	A native spline block carries its Bezier control points - see
+ *	mp_spline_aline() and the notes in plan_spline.c. As with native arcs the
+ *	velocity profile machinery is untouched; only the conversion from path
+ *	distance to axis targets changes. The control points are converted to
+ *	power basis coefficients here, so each segment target costs one Horner
+ *	evaluation per plane axis. The parameter advances by ds / |dB/dt| -
+ *	first order in the segment length - and every target lies exactly on the
+ *	curve, so the only error is a slight longitudinal redistribution of the
+ *	planned velocity profile. The parameter is resynced at every section
+ *	waypoint and pinned to t=1 at the block target.
+ *
+ *	The coefficients come from the control points carried in the buffer, not
+ *	from the current position, and the starting parameter is recovered by
+ *	projecting the position onto the curve - so a hold that re-runs the
+ *	trimmed companion block mid-curve reconstructs the same curve and picks
+ *	up where motion stopped (the analog of the arc's angle re-derivation).
+ */
+#define SPLINE_MARCH_STEPS 8			// integration steps per section when placing waypoints
+#define SPLINE_LOCATE_STEPS 16			// samples scanned when recovering t from a mid-curve position
+
+static void _init_spline_runtime(mpBuf_t *bf)
+{
+	// power basis from the Bezier control points: p(t) = ((c[0]*t + c[1])*t + c[2])*t + c[3]
+	float p0 = bf->spl_p0_x;
+	float p3 = mr.target[AXIS_X];
+	mr.spl_coeff_x[0] = p3 - p0 + 3*(bf->spl_p1_x - bf->spl_p2_x);
+	mr.spl_coeff_x[1] = 3*(p0 - 2*bf->spl_p1_x + bf->spl_p2_x);
+	mr.spl_coeff_x[2] = 3*(bf->spl_p1_x - p0);
+	mr.spl_coeff_x[3] = p0;
+	p0 = bf->spl_p0_y;
+	p3 = mr.target[AXIS_Y];
+	mr.spl_coeff_y[0] = p3 - p0 + 3*(bf->spl_p1_y - bf->spl_p2_y);
+	mr.spl_coeff_y[1] = 3*(p0 - 2*bf->spl_p1_y + bf->spl_p2_y);
+	mr.spl_coeff_y[2] = 3*(bf->spl_p1_y - p0);
+	mr.spl_coeff_y[3] = p0;
+
+	mr.spline_active = true;
+	// |dB/dt| integrates to the path length over t=[0,1], so a tenth of the
+	// length only engages as a floor near a degenerate (cusp) tangent
+	float length = mr.head_length + mr.body_length + mr.tail_length;
+	mr.spl_min_rate = max(length / 10, EPSILON);
+
+	mr.spl_t = 0;
+	if ((fabs(mr.position[AXIS_X] - bf->spl_p0_x) > EPSILON) ||
+		(fabs(mr.position[AXIS_Y] - bf->spl_p0_y) > EPSILON)) {
+		// re-entry mid-curve (hold) - recover t by scanning for the nearest sample
+		float best = 0;
+		float best_dist = 3.40282e+38;					// FLT_MAX
+		float probe[AXES];
+		for (uint8_t i=0; i<=SPLINE_LOCATE_STEPS; i++) {
+			float t = (float)i / SPLINE_LOCATE_STEPS;
+			_spline_target(t, probe);
+			float dist = square(probe[AXIS_X] - mr.position[AXIS_X]) +
+						 square(probe[AXIS_Y] - mr.position[AXIS_Y]);
+			if (dist < best_dist) { best_dist = dist; best = t;}
+		}
+		mr.spl_t = best;
+	}
+
+	float t = _spline_march(mr.spl_t, mr.head_length);		// generate the section waypoints
+	mr.spl_waypoint_t[SECTION_HEAD] = t;
+	_spline_target(t, mr.waypoint[SECTION_HEAD]);
+	t = _spline_march(t, mr.body_length);
+	mr.spl_waypoint_t[SECTION_BODY] = t;
+	_spline_target(t, mr.waypoint[SECTION_BODY]);
+	mr.spl_waypoint_t[SECTION_TAIL] = 1;
+	copy_vector(mr.waypoint[SECTION_TAIL], mr.target);		// land exactly on the block target
+}
+
+static float _spline_rate(float t)
+{
+	float dx = (3*mr.spl_coeff_x[0]*t + 2*mr.spl_coeff_x[1])*t + mr.spl_coeff_x[2];
+	float dy = (3*mr.spl_coeff_y[0]*t + 2*mr.spl_coeff_y[1])*t + mr.spl_coeff_y[2];
+	return (max(hypotf(dx, dy), mr.spl_min_rate));
+}
+
+static float _spline_march(float t, float s)
+{
+	float ds = s / SPLINE_MARCH_STEPS;
+	for (uint8_t i=0; i<SPLINE_MARCH_STEPS; i++) {
+		t += ds / _spline_rate(t);
+	}
+	return (min(t, 1));
+}
+
+static void _spline_target(float t, float target[])
+{
+	for (uint8_t axis=0; axis<AXES; axis++) {				// non-participating axes land immediately
+		target[axis] = mr.target[axis];						// (copy_vector can't size a pointer parameter)
+	}
+	target[AXIS_X] = ((mr.spl_coeff_x[0]*t + mr.spl_coeff_x[1])*t + mr.spl_coeff_x[2])*t + mr.spl_coeff_x[3];
+	target[AXIS_Y] = ((mr.spl_coeff_y[0]*t + mr.spl_coeff_y[1])*t + mr.spl_coeff_y[2])*t + mr.spl_coeff_y[3];
+}
+
+static void _spline_segment_target(float segment_length)
+{
+	float t = mr.spl_t + (segment_length / _spline_rate(mr.spl_t));
+	mr.spl_t = min(t, 1);									// pinned - overshoot would leave the curve
+	_spline_target(mr.spl_t, mr.gm.target);
+}
+#endif // __CUBIC_SPLINE
+
 /*********************************************************************************************
  * _exec_aline_segment() - segment runner helper
  *
- * NOTES ON STEP ERROR CORRECTION:
- *
- *	The commanded_steps are the target_steps delayed by one more segment.
+ * NOTES ON STEP ERROR CORRECTION:
+ *
+ *	The commanded_steps are the target_steps delayed by one more segment.
  *	This lines them up in time with the encoder readings so a following error can be generated
  *
- *	The following_error term is positive if the encoder reading is greater than (ahead of)
- *	the commanded steps, and negative (behind) if the encoder reading is less than the
- *	commanded steps. The following error is not affected by the direction of movement -
- *	it's purely a statement of relative position. Examples:
- *
- *    Encoder Commanded   Following Err
- *	  	  100	     90	       +10		encoder is 10 steps ahead of commanded steps
- *	      -90	   -100	       +10		encoder is 10 steps ahead of commanded steps
- *		   90	    100	       -10		encoder is 10 steps behind commanded steps
- *	     -100	    -90	       -10		encoder is 10 steps behind commanded steps
+ *	The following_error term is positive if the encoder reading is greater than (ahead of)
+ *	the commanded steps, and negative (behind) if the encoder reading is less than the
+ *	commanded steps. The following error is not affected by the direction of movement -
+ *	it's purely a statement of relative position. Examples:
+ *
+ *    Encoder Commanded   Following Err
+ *	  	  100	     90	       +10		encoder is 10 steps ahead of commanded steps
+ *	      -90	   -100	       +10		encoder is 10 steps ahead of commanded steps
+ *		   90	    100	       -10		encoder is 10 steps behind commanded steps
+ *	     -100	    -90	       -10		encoder is 10 steps behind commanded steps
  */
 
 static stat_t _exec_aline_segment()
 {
-	uint8_t i;
+	uint8_t i;
 	float travel_steps[MOTORS];
-
-	// Set target position for the segment
-	// If the segment ends on a section waypoint synchronize to the head, body or tail end
-	// Otherwise if not at a section waypoint compute target from segment time and velocity
-	// Don't do waypoint correction if you are going into a hold.
-
+#ifdef __EXEC_SEGMENT_BATCH
+	uint8_t batch = false;
+#endif
+
+	// Set target position for the segment
+	// If the segment ends on a section waypoint synchronize to the head, body or tail end
+	// Otherwise if not at a section waypoint compute target from segment time and velocity
+	// Don't do waypoint correction if you are going into a hold.
+
 	if ((--mr.segment_count == 0) && (mr.section_state == SECTION_2nd_HALF) &&
-		(cm.motion_state == MOTION_RUN) && (cm.cycle_state == CYCLE_MACHINING)) {
-		copy_vector(mr.gm.target, mr.waypoint[mr.section]);
-	} else {
+		(cm.motion_state == MOTION_RUN) && (cm.cycle_state == CYCLE_MACHINING)) {
+		copy_vector(mr.gm.target, mr.waypoint[mr.section]);
+#ifdef __ARC_NATIVE
+		if (mr.arc_active == true) {					// resync the rotation state to the waypoint
+			mr.arc_theta = mr.arc_waypoint_theta[mr.section];
+			mr.arc_vector_0 = mr.gm.target[mr.arc_plane_0] - mr.arc_center_0;
+			mr.arc_vector_1 = mr.gm.target[mr.arc_plane_1] - mr.arc_center_1;
+		}
+#endif
+#ifdef __CUBIC_SPLINE
+		if (mr.spline_active == true) {					// resync the parameter to the waypoint
+			mr.spl_t = mr.spl_waypoint_t[mr.section];
+		}
+#endif
+#ifdef __ARC_NATIVE
+	} else if (mr.arc_active == true) {					// targets follow the curve, not the unit vector
+		_arc_segment_target(mr.segment_velocity * mr.segment_time);
+#endif
+#ifdef __CUBIC_SPLINE
+	} else if (mr.spline_active == true) {				// targets follow the curve, not the unit vector
+		_spline_segment_target(mr.segment_velocity * mr.segment_time);
+#endif
+#ifdef __EXEC_SEGMENT_BATCH
+#if defined(__MESH_COMP) && defined(__THC)
+	} else if ((mr.section == SECTION_BODY) &&			// cruise fast path
+		(mr.mesh_bypass == false) && (mr.thc_active == false)) {
+#elif defined(__MESH_COMP)
+	} else if ((mr.section == SECTION_BODY) && (mr.mesh_bypass == false)) {	// cruise fast path
+#elif defined(__THC)
+	} else if ((mr.section == SECTION_BODY) && (mr.thc_active == false)) {	// cruise fast path
+#else
+	} else if (mr.section == SECTION_BODY) {	// cruise fast path - precomputed increments
+#endif
+		batch = true;							// also skips the kinematics call, below
+		for (i=0; i<AXES; i++) {
+			mr.gm.target[i] = mr.position[i] + mr.segment_delta[i];
+		}
+#endif
+	} else {
 		float segment_length = mr.segment_velocity * mr.segment_time;
-		for (i=0; i<AXES; i++) {
+		for (i=0; i<AXES; i++) {
 			mr.gm.target[i] = mr.position[i] + (mr.unit[i] * segment_length);
-		}
-	}
-
-	// Convert target position to steps
-	// Bucket-brigade the old target down the chain before getting the new target from kinematics
-	//
-	// NB: The direct manipulation of steps to compute travel_steps only works for Cartesian kinematics.
+		}
+	}
+#ifdef __SPINDLE_CSS
+	cm_spindle_css_update(fabs(mr.gm.target[AXIS_X] - mr.gm.work_offset[AXIS_X]));	// G96 - RPM follows the X radius
+#endif
+
+	float *kin_target = mr.gm.target;					// what the step conversion reads below -
+#ifdef __INPUT_SHAPER									//  mr position/target stay planner-true
+	float shaped_target[AXES];
+	if (sh.engaged) {
+		_shape_target(mr.gm.target, shaped_target);
+		kin_target = shaped_target;
+#ifdef __EXEC_SEGMENT_BATCH
+		batch = false;									// precomputed steps would bypass the shaper
+#endif
+	}
+#endif
+
+	// Convert target position to steps
+	// Bucket-brigade the old target down the chain before getting the new target from kinematics
+	//
+	// NB: The direct manipulation of steps to compute travel_steps only works for Cartesian kinematics.
 	//	   Other kinematics may require transforming travel distance as opposed to simply subtracting steps.
-
-	for (i=0; i<MOTORS; i++) {
-		mr.commanded_steps[i] = mr.position_steps[i];		// previous segment's position, delayed by 1 segment
+
+	for (i=0; i<MOTORS; i++) {
+		mr.commanded_steps[i] = (int32_t)round(mr.position_steps[i]);	// previous segment's position, delayed by 1 segment
 		mr.position_steps[i] = mr.target_steps[i];			// previous segment's target becomes position
-		mr.encoder_steps[i] = en_read_encoder(i);			// get current encoder position (time aligns to commanded_steps)
-		mr.following_error[i] = mr.encoder_steps[i] - mr.commanded_steps[i];
-	}
-	ik_kinematics(mr.gm.target, mr.target_steps);			// now determine the target steps...
-	for (i=0; i<MOTORS; i++) {								// and compute the distances to be traveled
+		mr.encoder_steps[i] = en_read_encoder(i);			// get current encoder position (time aligns to commanded_steps)
+	}													// the following error is evaluated in st_prep_line() - in integer steps
+#ifdef __EXEC_SEGMENT_BATCH
+	if (batch) {											// cruise fast path - kinematics are precomputed
+		for (i=0; i<MOTORS; i++) {
+			mr.target_steps[i] = mr.position_steps[i] + mr.segment_steps[i];
+			travel_steps[i] = mr.segment_steps[i];
+		}
+	} else {
+#ifdef __THC
+		if (mr.thc_active == true) {						// inject the torch height correction -
+			float adjusted[AXES];							// steps only, mr position is not disturbed
+			copy_vector(adjusted, kin_target);
+			adjusted[AXIS_Z] += thc_z_offset();
+			ik_kinematics(adjusted, mr.target_steps);
+		} else {
+			ik_kinematics(kin_target, mr.target_steps);		// now determine the target steps...
+		}
+#else
+		ik_kinematics(kin_target, mr.target_steps);		// now determine the target steps...
+#endif
+		for (i=0; i<MOTORS; i++) {							// and compute the distances to be traveled
+			travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
+		}
+	}
+#else
+#ifdef __THC
+	if (mr.thc_active == true) {							// inject the torch height correction -
+		float adjusted[AXES];								// steps only, mr position is not disturbed
+		copy_vector(adjusted, kin_target);
+		adjusted[AXIS_Z] += thc_z_offset();
+		ik_kinematics(adjusted, mr.target_steps);
+	} else {
+		ik_kinematics(kin_target, mr.target_steps);			// now determine the target steps...
+	}
+#else
+	ik_kinematics(kin_target, mr.target_steps);				// now determine the target steps...
+#endif
+	for (i=0; i<MOTORS; i++) {								// and compute the distances to be traveled
 		travel_steps[i] = mr.target_steps[i] - mr.position_steps[i];
-	}
-
-	// Call the stepper prep function
-
-	ritorno(st_prep_line(travel_steps, mr.following_error, mr.segment_time));
-	copy_vector(mr.position, mr.gm.target); 				// update position from target
-#ifdef __JERK_EXEC
-	mr.elapsed_accel_time += mr.segment_accel_time;			// this is needed by jerk-based exec (NB: ignored if running the body)
+	}
+#endif
+
+	// Call the stepper prep function
+
+	ritorno(st_prep_line(travel_steps, mr.segment_time));
+	copy_vector(mr.position, mr.gm.target); 				// update position from target
+#ifdef __JERK_EXEC
+	mr.elapsed_accel_time += mr.segment_accel_time;			// this is needed by jerk-based exec (NB: ignored if running the body)
 #endif
 	if (mr.segment_count == 0) return (STAT_OK);			// this section has run all its segments
 	return (STAT_EAGAIN);									// this section still has more segments to run
@@ -1,29 +1,29 @@
 /*
  * plan_line.c - acceleration managed line planning and motion execution
- * This file is part of the TinyG project
+ * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
  * Copyright (c) 2012 - 2015 Rob Giseburt
  *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "tinyg.h"
@@ -33,17 +33,79 @@
 #include "planner.h"
 #include "stepper.h"
 #include "report.h"
+#include "test.h"
 #include "util.h"
+#include "settings.h"		// profile jerk constants for __CONST_PROFILE builds
 
 // aline planner routines / feedhold planning
 //static void _calc_move_times(GCodeState_t *gms, const float position[]);
 static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[]);
 static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag);
 static float _get_junction_vmax(const float a_unit[], const float b_unit[]);
+#ifdef __PATH_CONTROL
+static float _get_path_control_vmax(const float a_unit[], const float b_unit[], float junction_velocity);
+#endif
 static void _reset_replannable_list(void);
-
-/* Runtime-specific setters and getters
- *
+#ifdef __PLAN_THROTTLE
+static void _clear_plan_pending(void);
+#endif
+#ifdef __CHORD_BLEND
+static void _blend_chord(GCodeState_t *gm_in);
+static float blend_dev_pending = 0;	// deviation carried into the next committed buffer after a merge
+#endif
+
+#ifdef __CONST_PROFILE
+// Fixed-configuration build: per-axis jerk terms come from the profile
+// constants (settings_const.h) instead of cm.a[], so the jerk-limit axis
+// scan reads a flat precomputed table. See tinyg.h.
+static const float jerk_max_ct[AXES] = JERK_MAX_CT;
+static const float recip_jerk_ct[AXES] = RECIP_JERK_CT;
+#endif
+
+#ifdef __AXIS_TABLE
+/*
+ * Struct-of-arrays mirror of the per-axis planning constraints, rebuilt by
+ * mp_update_axis_table() whenever axis config changes (axis mode, velocity
+ * and feedrate max, jerk - see the cm_set_* config setters). The constraint
+ * loops below run to active_axes (highest non-disabled axis + 1) instead of
+ * AXES, so a 3-axis machine doesn't iterate rotary axes that can never move,
+ * the rate-limit divides become multiplies by precomputed reciprocals, and
+ * the indexed loads walk flat float arrays instead of striding cfgAxis_t
+ * records. Axes at or above active_axes always have zero axis_length - a
+ * disabled axis's target is never moved off the planner position.
+ */
+typedef struct mpAxisTable {
+	uint8_t active_axes;				// constraint loop bound: highest enabled axis + 1
+	float recip_velocity_max[AXES];		// 1/velocity_max - traverse rate limits
+	float recip_feedrate_max[AXES];		// 1/feedrate_max - feed rate limits
+	float recip_jerk[AXES];				// jerk terms (duplicates cm.a[] for flat access)
+	float jerk_max[AXES];
+#ifdef __TRAVERSE_JERK
+	float recip_jerk_traverse[AXES];	// traverse (G0) jerk terms - see __TRAVERSE_JERK
+	float jerk_traverse[AXES];
+#endif
+} mpAxisTable_t;
+static mpAxisTable_t ax;
+
+void mp_update_axis_table()
+{
+	ax.active_axes = 0;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (cm.a[axis].axis_mode != AXIS_DISABLED) { ax.active_axes = axis+1;}
+		ax.recip_velocity_max[axis] = 1/cm.a[axis].velocity_max;	// misconfigured 0 yields INF,
+		ax.recip_feedrate_max[axis] = 1/cm.a[axis].feedrate_max;	// same as the divides did
+		ax.recip_jerk[axis] = cm.a[axis].recip_jerk;
+		ax.jerk_max[axis] = cm.a[axis].jerk_max;
+#ifdef __TRAVERSE_JERK
+		ax.recip_jerk_traverse[axis] = cm.a[axis].recip_jerk_traverse;
+		ax.jerk_traverse[axis] = cm.a[axis].jerk_traverse;
+#endif
+	}
+}
+#endif // __AXIS_TABLE
+
+/* Runtime-specific setters and getters
+ *
  * mp_zero_segment_velocity() 		- correct velocity in last segment for reporting purposes
  * mp_get_runtime_velocity() 		- returns current velocity (aggregate)
  * mp_get_runtime_machine_position()- returns current axis position in machine coordinates
@@ -51,7 +113,7 @@ static void _reset_replannable_list(void);
  * mp_get_runtime_work_position() 	- returns current axis position in work coordinates
  *									  that were in effect at move planning time
  */
-
+
 void mp_zero_segment_velocity() { mr.segment_velocity = 0;}
 float mp_get_runtime_velocity(void) { return (mr.segment_velocity);}
 float mp_get_runtime_absolute_position(uint8_t axis) { return (mr.position[axis]);}
@@ -70,7 +132,158 @@ uint8_t mp_get_runtime_busy()
 	if ((st_runtime_isbusy() == true) || (mr.move_state == MOVE_RUN)) return (true);
 	return (false);
 }
-
+
+
+#ifdef __PLAN_STAGING
+/**** SECOND-TIER STAGING RING ********************************************
+ * mp_staging_engaged()	 - true if new blocks must enter the staging ring
+ * mp_staging_room()	 - staged records still free
+ * mp_flush_staging()	 - empty the ring (queue flush / alarm path)
+ * mp_stage_command()	 - stage a synchronous command behind staged moves
+ * mp_stage_dwell()		 - stage a dwell behind staged moves
+ * mp_staging_callback() - promote staged records into freed planner buffers
+ *
+ *	A planner buffer carries the full planning and runtime state for a block,
+ *	so the pool is the RAM limit on lookahead depth. Far-future blocks don't
+ *	need any of that yet - all mp_aline() consumes is the compact gcode core
+ *	state it would store in the buffer anyway. The staging ring holds raw
+ *	blocks at that size and replays them through the normal queue functions
+ *	as planner buffers free up, so lookahead input extends well past the pool
+ *	for a fraction of the per-buffer cost.
+ *
+ *	Ordering is the critical invariant: once anything is staged, every new
+ *	block - moves, synchronous commands and dwells alike - must stage behind
+ *	it. The queue functions test mp_staging_engaged() on entry and divert to
+ *	the ring, and the promotion callback sets stg.promoting so its own calls
+ *	back into those functions take the direct path. Promotion happens in the
+ *	controller loop ahead of the planning pass, so a promoted block is planned
+ *	in the same pass, and it re-runs the unmodified queue functions in FIFO
+ *	order - a staged block plans exactly as it would have planned had a buffer
+ *	been free when it arrived. Zero-length and minimum-time rejections are
+ *	detected at promotion and dropped silently (the status returns STAT_OK at
+ *	staging time, before those tests can run).
+ */
+
+#define STAGED_MOVE_ALINE ((uint8_t)0)		// staged mp_aline() block
+#define STAGED_MOVE_COMMAND ((uint8_t)1)	// staged mp_queue_command()
+#define STAGED_MOVE_PASSTHRU ((uint8_t)2)	// staged mp_queue_passthru_command()
+#define STAGED_MOVE_DWELL ((uint8_t)3)		// staged mp_dwell() - seconds ride in value[0]
+
+typedef struct mpStagedMove {
+	uint8_t move_type;						// one of the STAGED_MOVE_ types
+	union {
+		GCodeStateCore_t gm;				// STAGED_MOVE_ALINE
+		struct {							// commands and dwells
+			void (*cm_exec)(float[], float[]);	// canonical machine execution callback
+			float value[AXES];
+			float flag[AXES];
+		} cmd;
+	} u;
+} mpStagedMove_t;
+
+typedef struct mpStagingRing {
+	uint8_t read_idx;						// next record to promote
+	uint8_t write_idx;						// next record to fill
+	uint8_t count;							// records in the ring
+	uint8_t promoting;						// promotion in progress - queue functions take the direct path
+	mpStagedMove_t move[STAGING_BUFFER_POOL_SIZE];
+} mpStagingRing_t;
+
+static mpStagingRing_t stg;
+
+static stat_t _aline(GCodeState_t *gm_in);	// the direct (single-tier) mp_aline() body
+
+uint8_t mp_staging_engaged()
+{
+	if (stg.promoting == true) return (false);
+	if (stg.count != 0) return (true);		// preserve order behind already-staged blocks
+	return (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM);
+}
+
+uint8_t mp_staging_room() { return (STAGING_BUFFER_POOL_SIZE - stg.count);}
+
+void mp_flush_staging()
+{
+	stg.read_idx = 0;
+	stg.write_idx = 0;
+	stg.count = 0;
+}
+
+static mpStagedMove_t *_stage_next(uint8_t move_type)
+{
+	if (stg.count == STAGING_BUFFER_POOL_SIZE) return (NULL);
+	mpStagedMove_t *sm = &stg.move[stg.write_idx];
+	if (++stg.write_idx == STAGING_BUFFER_POOL_SIZE) { stg.write_idx = 0;}
+	stg.count++;
+	sm->move_type = move_type;
+	return (sm);
+}
+
+void mp_stage_command(uint8_t passthru, void(*cm_exec)(float[], float[]), float *value, float *flag)
+{
+	mpStagedMove_t *sm;
+
+	// Never supposed to fail as staging room was checked upstream in the controller
+	if ((sm = _stage_next(passthru ? STAGED_MOVE_PASSTHRU : STAGED_MOVE_COMMAND)) == NULL) {
+		cm_hard_alarm(STAT_BUFFER_FULL_FATAL);
+		return;
+	}
+	sm->u.cmd.cm_exec = cm_exec;
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		sm->u.cmd.value[axis] = value[axis];
+		sm->u.cmd.flag[axis] = flag[axis];
+	}
+}
+
+void mp_stage_dwell(float seconds)
+{
+	mpStagedMove_t *sm;
+
+	if ((sm = _stage_next(STAGED_MOVE_DWELL)) == NULL) {
+		cm_hard_alarm(STAT_BUFFER_FULL_FATAL);			// not ever supposed to fail
+		return;
+	}
+	sm->u.cmd.value[0] = seconds;
+}
+
+static stat_t _stage_aline(GCodeState_t *gm_in)
+{
+	mpStagedMove_t *sm;
+
+	if ((sm = _stage_next(STAGED_MOVE_ALINE)) == NULL)
+		return (cm_hard_alarm(STAT_BUFFER_FULL_FATAL));	// not ever supposed to fail
+	cm_state_to_core(&sm->u.gm, gm_in);					// snapshot before _calc_move_times() can mutate it
+	return (STAT_OK);
+}
+
+stat_t mp_staging_callback()
+{
+	static GCodeState_t staged_state;					// static - too large for the AVR stack
+
+	while ((stg.count != 0) && (mp_get_planner_buffers_available() >= PLANNER_BUFFER_HEADROOM)) {
+		mpStagedMove_t *sm = &stg.move[stg.read_idx];
+		if (++stg.read_idx == STAGING_BUFFER_POOL_SIZE) { stg.read_idx = 0;}
+		stg.count--;
+		stg.promoting = true;			// calls below must take the direct path, not re-stage
+		switch (sm->move_type) {
+			case STAGED_MOVE_ALINE: {
+				cm_core_to_state(&staged_state, &sm->u.gm);
+				_aline(&staged_state);
+				break;
+			}
+			case STAGED_MOVE_DWELL: { mp_dwell(sm->u.cmd.value[0]); break;}
+			case STAGED_MOVE_PASSTHRU: {
+				mp_queue_passthru_command(sm->u.cmd.cm_exec, sm->u.cmd.value, sm->u.cmd.flag);
+				break;
+			}
+			default: { mp_queue_command(sm->u.cmd.cm_exec, sm->u.cmd.value, sm->u.cmd.flag);}
+		}
+		stg.promoting = false;
+	}
+	return (STAT_OK);
+}
+#endif // __PLAN_STAGING
+
 /****************************************************************************************
  * mp_aline() - plan a line with acceleration / deceleration
  *
@@ -87,33 +300,139 @@ uint8_t mp_get_runtime_busy()
  *	exceeds the minimums.
  */
 /*
-#define axis_length bf->body_length
-#define axis_velocity bf->cruise_velocity
-#define axis_tail bf->tail_length
-#define longest_tail bf->head_length
+#define axis_length bf->body_length
+#define axis_velocity bf->cruise_velocity
+#define axis_tail bf->tail_length
+#define longest_tail bf->head_length
 */
-stat_t mp_aline(GCodeState_t *gm_in)
+#ifdef __ARC_NATIVE
+static mpArcPlan_t *arc_plan = NULL;	// non-NULL only while _aline() plans a native arc
+
+/*
+ * mp_arc_aline() - plan an entire arc into a single planner buffer
+ *
+ *	Thin wrapper that parks the arc geometry where the aline body can see it.
+ *	The aline body does all the real work - jerk selection, junction and move
+ *	time math, queue replanning - with a handful of arc-aware overrides: path
+ *	length instead of chord length, tangent vectors for the junctions, and a
+ *	centripetal cap on the cruise velocity. Bypasses the staging tier -
+ *	cm_arc_feed() only queues a native arc when staging is not engaged, so
+ *	block order is preserved.
+ */
+stat_t mp_arc_aline(GCodeState_t *gm_in, mpArcPlan_t *plan)
+{
+	arc_plan = plan;
+#ifdef __PLAN_STAGING
+	stat_t status = _aline(gm_in);
+#else
+	stat_t status = mp_aline(gm_in);
+#endif
+	arc_plan = NULL;
+	return (status);
+}
+#endif // __ARC_NATIVE
+
+#ifdef __CUBIC_SPLINE
+static mpSplinePlan_t *spline_plan = NULL;	// non-NULL only while _aline() plans a native spline
+
+/*
+ * mp_spline_aline() - plan an entire Bezier curve into a single planner buffer
+ *
+ *	Same arrangement as mp_arc_aline(): the curve geometry is parked where the
+ *	aline body can see it and the body plans the block normally, with the
+ *	path length, tangents and centripetal cap substituted for their chord
+ *	equivalents. Bypasses the staging tier - cm_spline_feed() only queues a
+ *	native spline when staging is not engaged, so block order is preserved.
+ */
+stat_t mp_spline_aline(GCodeState_t *gm_in, mpSplinePlan_t *plan)
+{
+	spline_plan = plan;
+#ifdef __PLAN_STAGING
+	stat_t status = _aline(gm_in);
+#else
+	stat_t status = mp_aline(gm_in);
+#endif
+	spline_plan = NULL;
+	return (status);
+}
+#endif // __CUBIC_SPLINE
+
+#if defined(__ARC_NATIVE) || defined(__CUBIC_SPLINE)
+static uint8_t _curve_plan()			// true while _aline() is planning a native arc or spline
+{
+#ifdef __ARC_NATIVE
+	if (arc_plan != NULL) { return (true);}
+#endif
+#ifdef __CUBIC_SPLINE
+	if (spline_plan != NULL) { return (true);}
+#endif
+	return (false);
+}
+#endif
+
+#ifdef __PLAN_STAGING
+stat_t mp_aline(GCodeState_t *gm_in)
 {
+	if (mp_staging_engaged())			// planner pool congested, or blocks already staged ahead
+		return (_stage_aline(gm_in));
+	return (_aline(gm_in));
+}
+
+static stat_t _aline(GCodeState_t *gm_in)
+#else
+stat_t mp_aline(GCodeState_t *gm_in)
+#endif
+{
+#ifdef __BENCHMARK
+	uint16_t bench_start = bench_now();
+#endif
 	mpBuf_t *bf; 						// current move pointer
 	float exact_stop = 0;				// preset this value OFF
 	float junction_velocity;
 	uint8_t mr_flag = false;
 
-	// compute some reusable terms
-	float axis_length[AXES];
-	float axis_square[AXES];
-	float length_square = 0;
-
-	for (uint8_t axis=0; axis<AXES; axis++) {
-		axis_length[axis] = gm_in->target[axis] - mm.position[axis];
-		axis_square[axis] = square(axis_length[axis]);
-		length_square += axis_square[axis];
-	}
-	float length = sqrt(length_square);
+#ifdef __CHORD_BLEND
+	_blend_chord(gm_in);				// may pop the previous block and back up mm.position
+										// so the combined chord replans through the code below
+#endif
+	// compute some reusable terms
+	float axis_length[AXES];
+	float axis_square[AXES];
+	float length_square = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		axis_length[axis] = gm_in->target[axis] - mm.position[axis];
+		axis_square[axis] = square(axis_length[axis]);
+		length_square += axis_square[axis];
+	}
+	float length = fast_sqrt(length_square);
 
-	if (fp_ZERO(length)) {
-//		sr_request_status_report();
-		return (STAT_OK);
+#ifdef __ARC_NATIVE
+	if (arc_plan != NULL) {				// arc: plan on path length, not the chord
+		length = arc_plan->length;
+		length_square = square(length);
+		for (uint8_t axis=0; axis<AXES; axis++) { axis_length[axis] = 0;}
+		// a plane axis moves at up to the full planar rate somewhere along the
+		// arc, so both rank at full planar participation for jerk selection
+		axis_length[arc_plan->plane_axis_0] = arc_plan->planar_travel;
+		axis_length[arc_plan->plane_axis_1] = arc_plan->planar_travel;
+		axis_length[arc_plan->linear_axis] = arc_plan->linear_travel;
+		for (uint8_t axis=0; axis<AXES; axis++) { axis_square[axis] = square(axis_length[axis]);}
+	}
+#endif
+#ifdef __CUBIC_SPLINE
+	if (spline_plan != NULL) {			// spline: plan on path length, not the chord
+		length = spline_plan->length;
+		length_square = square(length);
+		for (uint8_t axis=0; axis<AXES; axis++) { axis_length[axis] = 0;}
+		axis_length[AXIS_X] = spline_plan->axis_length_x;	// integrated per-axis travel ranks
+		axis_length[AXIS_Y] = spline_plan->axis_length_y;	// jerk participation honestly
+		for (uint8_t axis=0; axis<AXES; axis++) { axis_square[axis] = square(axis_length[axis]);}
+	}
+#endif
+	if (fp_ZERO(length)) {
+//		sr_request_status_report();
+		return (STAT_OK);
 	}
 
 	// If _calc_move_times() says the move will take less than the minimum move time
@@ -125,9 +444,19 @@ stat_t mp_aline(GCodeState_t *gm_in)
 	//	(2) Previous block is optimally planned. Vi = previous block's exit_velocity
 	//	(3) Previous block is not optimally planned. Vi <= previous block's entry_velocity + delta_velocity
 
-	_calc_move_times(gm_in, axis_length, axis_square);						// set move time and minimum time in the state
+#if defined(__ARC_NATIVE) || defined(__CUBIC_SPLINE)
+	if (_curve_plan() == false) {											// curve times were set by the caller
+		_calc_move_times(gm_in, axis_length, axis_square);					// set move time and minimum time in the state
+	}
+#else
+	_calc_move_times(gm_in, axis_length, axis_square);						// set move time and minimum time in the state
+#endif
 	if (gm_in->move_time < MIN_BLOCK_TIME) {
+#ifdef __PV_TABLE
+		float delta_velocity = mp_pow23(length) * mm.cbrt_jerk;				// max velocity change for this move
+#else
 		float delta_velocity = pow(length, 0.66666666) * mm.cbrt_jerk;		// max velocity change for this move
+#endif
 		float entry_velocity = 0;											// pre-set as if no previous block
 		if ((bf = mp_get_run_buffer()) != NULL) {
 			if (bf->replannable == true) {									// not optimally planned
@@ -136,7 +465,7 @@ stat_t mp_aline(GCodeState_t *gm_in)
 				entry_velocity = bf->exit_velocity;
 			}
 		}
-		float move_time = (2 * length) / (2*entry_velocity + delta_velocity);// compute execution time for this move
+		float move_time = (2 * length) / (2*entry_velocity + delta_velocity);// compute execution time for this move
 		if (move_time < MIN_BLOCK_TIME)
 			return (STAT_MINIMUM_TIME_MOVE);
 	}
@@ -145,76 +474,107 @@ stat_t mp_aline(GCodeState_t *gm_in)
 	if ((bf = mp_get_write_buffer()) == NULL)
         return(cm_hard_alarm(STAT_BUFFER_FULL_FATAL));                  // never supposed to fail
 	bf->bf_func = mp_exec_aline;										// register the callback to the exec function
-	bf->length = length;
-	memcpy(&bf->gm, gm_in, sizeof(GCodeState_t));						// copy model state into planner buffer
-
-	// Compute the unit vector and find the right jerk to use (combined operations)
-	// To determine the jerk value to use for the block we want to find the axis for which
-	// the jerk cannot be exceeded - the 'jerk-limit' axis. This is the axis for which
-	// the time to decelerate from the target velocity to zero would be the longest.
-	//
-	//	We can determine the "longest" deceleration in terms of time or distance.
-	//
-	//  The math for time-to-decelerate T from speed S to speed E with constant
-	//  jerk J is:
-	//
-	//		T = 2*sqrt((S-E)/J[n])
-	//
-	//	Since E is always zero in this calculation, we can simplify:
-	//		T = 2*sqrt(S/J[n])
-	//
-	//	The math for distance-to-decelerate l from speed S to speed E with constant
-	//  jerk J is:
-	//
-	//		l = (S+E)*sqrt((S-E)/J)
-	//
-	//	Since E is always zero in this calculation, we can simplify:
-	//		l = S*sqrt(S/J)
-	//
-	//  The final value we want is to know which one is *longest*, compared to the others,
-	//	so we don't need the actual value. This means that the scale of the value doesn't
-	//	matter, so for T we can remove the "2 *" and For L we can remove the "S*".
-	//	This leaves both to be simply "sqrt(S/J)". Since we don't need the scale,
-	//	it doesn't matter what speed we're coming from, so S can be replaced with 1.
-	//
-	//  However, we *do* need to compensate for the fact that each axis contributes
-	//	differently to the move, so we will scale each contribution C[n] by the
-	//	proportion of the axis movement length D[n] to the total length of the move L.
-	//	Using that, we construct the following, with these definitions:
-	//
-	//		J[n] = max_jerk for axis n
-	//		D[n] = distance traveled for this move for axis n
-	//		L = total length of the move in all axes
-	//		C[n] = "axis contribution" of axis n
-	//
-	// For each axis n: C[n] = sqrt(1/J[n]) * (D[n]/L)
-	//
-	//	Keeping in mind that we only need a rank compared to the other axes, we can further
-	//	optimize the calculations::
-	//
-	//	Square the expression to remove the square root:
-	//		C[n]^2 = (1/J[n]) * (D[n]/L)^2	(We don't care the C is squared, we'll use it that way.)
-	//
-	//	Re-arranged to optimize divides for pre-calculated values, we create a value
-	//  M that we compute once:
-	//		M = (1/(L^2))
-	//  Then we use it in the calculations for every axis:
-	//		C[n] = (1/J[n]) * D[n]^2 * M
-	//
-	//  Also note that we already have (1/J[n]) calculated for each axis, which simplifies it further.
-	//
-	// Finally, the selected jerk term needs to be scaled by the reciprocal of the absolute value
-	// of the jerk-limit axis's unit vector term. This way when the move is finally decomposed into
-	// its constituent axes for execution the jerk for that axis will be at it's maximum value.
-
-	float C;					// contribution term. C = T * a
-	float maxC = 0;
-	float recip_L2 = 1/length_square;
-
+	bf->length = length;
+	cm_state_to_core(&bf->gm, gm_in);									// compact model state into planner buffer
+#ifdef __CHORD_BLEND
+	bf->blend_dev = blend_dev_pending;									// non-zero only if _blend_chord() merged
+	blend_dev_pending = 0;
+#endif
+
+	// Compute the unit vector and find the right jerk to use (combined operations)
+	// To determine the jerk value to use for the block we want to find the axis for which
+	// the jerk cannot be exceeded - the 'jerk-limit' axis. This is the axis for which
+	// the time to decelerate from the target velocity to zero would be the longest.
+	//
+	//	We can determine the "longest" deceleration in terms of time or distance.
+	//
+	//  The math for time-to-decelerate T from speed S to speed E with constant
+	//  jerk J is:
+	//
+	//		T = 2*sqrt((S-E)/J[n])
+	//
+	//	Since E is always zero in this calculation, we can simplify:
+	//		T = 2*sqrt(S/J[n])
+	//
+	//	The math for distance-to-decelerate l from speed S to speed E with constant
+	//  jerk J is:
+	//
+	//		l = (S+E)*sqrt((S-E)/J)
+	//
+	//	Since E is always zero in this calculation, we can simplify:
+	//		l = S*sqrt(S/J)
+	//
+	//  The final value we want is to know which one is *longest*, compared to the others,
+	//	so we don't need the actual value. This means that the scale of the value doesn't
+	//	matter, so for T we can remove the "2 *" and For L we can remove the "S*".
+	//	This leaves both to be simply "sqrt(S/J)". Since we don't need the scale,
+	//	it doesn't matter what speed we're coming from, so S can be replaced with 1.
+	//
+	//  However, we *do* need to compensate for the fact that each axis contributes
+	//	differently to the move, so we will scale each contribution C[n] by the
+	//	proportion of the axis movement length D[n] to the total length of the move L.
+	//	Using that, we construct the following, with these definitions:
+	//
+	//		J[n] = max_jerk for axis n
+	//		D[n] = distance traveled for this move for axis n
+	//		L = total length of the move in all axes
+	//		C[n] = "axis contribution" of axis n
+	//
+	// For each axis n: C[n] = sqrt(1/J[n]) * (D[n]/L)
+	//
+	//	Keeping in mind that we only need a rank compared to the other axes, we can further
+	//	optimize the calculations::
+	//
+	//	Square the expression to remove the square root:
+	//		C[n]^2 = (1/J[n]) * (D[n]/L)^2	(We don't care the C is squared, we'll use it that way.)
+	//
+	//	Re-arranged to optimize divides for pre-calculated values, we create a value
+	//  M that we compute once:
+	//		M = (1/(L^2))
+	//  Then we use it in the calculations for every axis:
+	//		C[n] = (1/J[n]) * D[n]^2 * M
+	//
+	//  Also note that we already have (1/J[n]) calculated for each axis, which simplifies it further.
+	//
+	// Finally, the selected jerk term needs to be scaled by the reciprocal of the absolute value
+	// of the jerk-limit axis's unit vector term. This way when the move is finally decomposed into
+	// its constituent axes for execution the jerk for that axis will be at it's maximum value.
+
+	float C;					// contribution term. C = T * a
+	float maxC = 0;
+	float recip_L2 = 1/length_square;
+
+#if defined(__TRAVERSE_JERK) && !defined(__CONST_PROFILE)
+	// Rapids ramp at the traverse jerk. A G0 carries no cut, so its ramps need
+	// not be held to the cutting-feed jerk - the jerk-limit axis is ranked and
+	// scaled against the traverse values instead. __CONST_PROFILE compiles the
+	// jerk terms to constants and takes precedence when enabled.
+	const uint8_t traverse = (gm_in->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE);
+#ifdef __AXIS_TABLE
+	const float *recip_jerk_tab = traverse ? ax.recip_jerk_traverse : ax.recip_jerk;
+	const float *jerk_tab = traverse ? ax.jerk_traverse : ax.jerk_max;
+#endif
+#endif
+
+#ifdef __AXIS_TABLE
+	for (uint8_t axis=0; axis<ax.active_axes; axis++) {
+#else
 	for (uint8_t axis=0; axis<AXES; axis++) {
+#endif
 		if (fabs(axis_length[axis]) > 0) {								// You cannot use the fp_XXX comparisons here!
 			bf->unit[axis] = axis_length[axis] / bf->length;			// compute unit vector term (zeros are already zero)
+#if defined(__CONST_PROFILE)
+			C = axis_square[axis] * recip_L2 * recip_jerk_ct[axis];		// squaring axis_length ensures it's positive
+#elif defined(__AXIS_TABLE) && defined(__TRAVERSE_JERK)
+			C = axis_square[axis] * recip_L2 * recip_jerk_tab[axis];	// table selected above for feed or traverse
+#elif defined(__AXIS_TABLE)
+			C = axis_square[axis] * recip_L2 * ax.recip_jerk[axis];		// squaring axis_length ensures it's positive
+#elif defined(__TRAVERSE_JERK)
+			C = axis_square[axis] * recip_L2 *
+				(traverse ? cm.a[axis].recip_jerk_traverse : cm.a[axis].recip_jerk);
+#else
 			C = axis_square[axis] * recip_L2 * cm.a[axis].recip_jerk;	// squaring axis_length ensures it's positive
+#endif
 			if (C > maxC) {
 				maxC = C;
 				bf->jerk_axis = axis;						// also needed for junction vmax calculation
@@ -222,15 +582,79 @@ stat_t mp_aline(GCodeState_t *gm_in)
 		}
 	}
 	// set up and pre-compute the jerk terms needed for this round of planning
+#if defined(__CONST_PROFILE)
+	bf->jerk = jerk_max_ct[bf->jerk_axis] * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);	// scale the jerk
+#elif defined(__AXIS_TABLE) && defined(__TRAVERSE_JERK)
+	bf->jerk = jerk_tab[bf->jerk_axis] * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);		// scale the jerk
+#elif defined(__AXIS_TABLE)
+	bf->jerk = ax.jerk_max[bf->jerk_axis] * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);	// scale the jerk
+#elif defined(__TRAVERSE_JERK)
+	bf->jerk = (traverse ? cm.a[bf->jerk_axis].jerk_traverse : cm.a[bf->jerk_axis].jerk_max)
+				* JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);							// scale the jerk
+#else
 	bf->jerk = cm.a[bf->jerk_axis].jerk_max * JERK_MULTIPLIER / fabs(bf->unit[bf->jerk_axis]);	// scale the jerk
+#endif
+
+	if (fabs(bf->jerk - mm.jerk) > JERK_MATCH_PRECISION) {	// specialized comparison for tolerance of delta
+		mm.jerk = bf->jerk;									// used before this point next time around
+		mm.recip_jerk = 1/bf->jerk;							// compute cached jerk terms used by planning
+		mm.cbrt_jerk = fast_cbrt(bf->jerk);
+	}
+	bf->recip_jerk = mm.recip_jerk;
+	bf->cbrt_jerk = mm.cbrt_jerk;
 
-	if (fabs(bf->jerk - mm.jerk) > JERK_MATCH_PRECISION) {	// specialized comparison for tolerance of delta
-		mm.jerk = bf->jerk;									// used before this point next time around
-		mm.recip_jerk = 1/bf->jerk;							// compute cached jerk terms used by planning
-		mm.cbrt_jerk = cbrt(bf->jerk);
-	}
-	bf->recip_jerk = mm.recip_jerk;
-	bf->cbrt_jerk = mm.cbrt_jerk;
+#ifdef __RAMP_CHAIN
+	// Detect a collinear continuation of the last committed block. The trapezoid
+	// uses this to slew velocity across single-segment blocks instead of plateauing
+	// at each boundary (see the B" case in mp_calculate_trapezoid()).
+	bf->collinear = false;
+	if ((bf->pv->move_type == MOVE_TYPE_ALINE) &&
+		(fabs(bf->jerk - bf->pv->jerk) < JERK_MATCH_PRECISION)) {
+		bf->collinear = true;
+		for (uint8_t axis=0; axis<AXES; axis++) {
+			if (fabs(bf->unit[axis] - bf->pv->unit[axis]) > UNIT_MATCH_PRECISION) {
+				bf->collinear = false;
+				break;
+			}
+		}
+	}
+#endif
+
+#ifdef __ARC_NATIVE
+	if (arc_plan != NULL) {
+		// the stored unit is the exit tangent - it seeds the next block's
+		// junction velocity. The entry junction is computed explicitly below.
+		copy_vector(bf->unit, arc_plan->exit_unit);
+		bf->arc_plane_0 = arc_plan->plane_axis_0;
+		bf->arc_plane_1 = arc_plan->plane_axis_1;
+		bf->arc_linear_axis = arc_plan->linear_axis;
+		bf->arc_center_0 = arc_plan->center_0;
+		bf->arc_center_1 = arc_plan->center_1;
+		bf->arc_radius = arc_plan->radius;
+		bf->arc_theta_per_mm = arc_plan->theta_per_mm;
+		bf->arc_linear_per_mm = arc_plan->linear_per_mm;
+#ifdef __RAMP_CHAIN
+		bf->collinear = false;			// an arc is never a straight continuation
+#endif
+	}
+#endif
+
+#ifdef __CUBIC_SPLINE
+	if (spline_plan != NULL) {
+		// the stored unit is the exit tangent - it seeds the next block's
+		// junction velocity. The entry junction is computed explicitly below.
+		copy_vector(bf->unit, spline_plan->exit_unit);
+		bf->spl_p0_x = mm.position[AXIS_X];
+		bf->spl_p0_y = mm.position[AXIS_Y];
+		bf->spl_p1_x = spline_plan->p1_x;
+		bf->spl_p1_y = spline_plan->p1_y;
+		bf->spl_p2_x = spline_plan->p2_x;
+		bf->spl_p2_y = spline_plan->p2_y;
+#ifdef __RAMP_CHAIN
+		bf->collinear = false;			// a curve is never a straight continuation
+#endif
+	}
+#endif
 
 	// finish up the current block variables
 	if (cm_get_path_control(MODEL) != PATH_EXACT_STOP) { 	// exact stop cases already zeroed
@@ -238,136 +662,282 @@ stat_t mp_aline(GCodeState_t *gm_in)
 		exact_stop = 8675309;								// an arbitrarily large floating point number
 	}
 	bf->cruise_vmax = bf->length / bf->gm.move_time;		// target velocity requested
-	junction_velocity = _get_junction_vmax(bf->pv->unit, bf->unit);
+#if defined(__ARC_NATIVE) || defined(__CUBIC_SPLINE)
+	const float *junction_unit = bf->unit;
+#ifdef __ARC_NATIVE
+	if (arc_plan != NULL) {									// continuous cornering - cap the cruise
+		junction_unit = arc_plan->entry_unit;				// velocity by the centripetal limit for
+															// the radius (same model junctions use)
+		bf->cruise_vmax = min(bf->cruise_vmax, fast_sqrt(arc_plan->radius * cm.junction_acceleration));
+	}
+#endif
+#ifdef __CUBIC_SPLINE
+	if (spline_plan != NULL) {								// centripetal cap uses the tightest
+		junction_unit = spline_plan->entry_unit;			// radius found along the curve
+		bf->cruise_vmax = min(bf->cruise_vmax, fast_sqrt(spline_plan->min_radius * cm.junction_acceleration));
+	}
+#endif
+#else
+	const float *junction_unit = bf->unit;
+#endif
+	junction_velocity = _get_junction_vmax(bf->pv->unit, junction_unit);
+#ifdef __PATH_CONTROL
+	if ((cm_get_path_control(MODEL) == PATH_EXACT_PATH) || (cm.path_tolerance > 0)) {
+		junction_velocity = _get_path_control_vmax(bf->pv->unit, junction_unit, junction_velocity);
+	}
+#endif
+	bf->junction_vmax = min(junction_velocity, exact_stop);	// kept for feed override replans
 	bf->entry_vmax = min3(bf->cruise_vmax, junction_velocity, exact_stop);
 	bf->delta_vmax = mp_get_target_velocity(0, bf->length, bf);
 	bf->exit_vmax = min3(bf->cruise_vmax, (bf->entry_vmax + bf->delta_vmax), exact_stop);
 	bf->braking_velocity = bf->delta_vmax;
 
-	// Note: these next lines must remain in exact order. Position must update before committing the buffer.
-	_plan_block_list(bf, &mr_flag);				// replan block list
+	// Note: these next lines must remain in exact order. Position must update before committing the buffer.
+#ifdef __PLAN_THROTTLE
+	// Amortize the backward pass: a burst of arriving blocks is planned once per
+	// PLAN_THROTTLE_BATCH commits, or at the next controller pass, whichever is
+	// first - see mp_plan_queue_callback(). Deferral requires enough planned
+	// queue depth that the runtime cannot reach an unplanned block; the exec
+	// declines pending blocks regardless, as a backstop (see mp_exec_move()).
+	bf->plan_pending = true;
+	mm.plan_bf = bf;
+	mm.plan_pending++;
+	uint8_t planned_depth = PLANNER_BUFFER_POOL_SIZE - mp_get_planner_buffers_available() - mm.plan_pending;
+	if ((mm.plan_pending >= PLAN_THROTTLE_BATCH) || (planned_depth < PLAN_THROTTLE_MIN_DEPTH)) {
+		_plan_block_list(bf, &mr_flag);			// replan block list
+		_clear_plan_pending();
+	}
+#else
+	_plan_block_list(bf, &mr_flag);				// replan block list
+#endif
 	copy_vector(mm.position, bf->gm.target);	// set the planner position
-	mp_commit_write_buffer(MOVE_TYPE_ALINE); 	// commit current block (must follow the position update)
+#if defined(__ARC_NATIVE) || defined(__CUBIC_SPLINE)
+	uint8_t commit_type = MOVE_TYPE_ALINE;
+#ifdef __ARC_NATIVE
+	if (arc_plan != NULL) { commit_type = MOVE_TYPE_ARC;}
+#endif
+#ifdef __CUBIC_SPLINE
+	if (spline_plan != NULL) { commit_type = MOVE_TYPE_SPLINE;}
+#endif
+	mp_commit_write_buffer(commit_type);		// commit block (must follow the position update)
+#else
+	mp_commit_write_buffer(MOVE_TYPE_ALINE); 	// commit current block (must follow the position update)
+#endif
+#ifdef __BENCHMARK
+	bench_sample_plan(bench_start);				// zero-length early returns are not counted
+#endif
 	return (STAT_OK);
 }
 
 /***** ALINE HELPERS *****
- * _calc_move_times()
+ * _blend_chord()
+ * _calc_move_times()
  * _plan_block_list()
  * _get_junction_vmax()
+ * _get_path_control_vmax()
  * _reset_replannable_list()
  */
 
-/*
- * _calc_move_times() - compute optimal and minimum move times into the gcode_state
- *
- *	"Minimum time" is the fastest the move can be performed given the velocity constraints on each
- *	participating axis - regardless of the feed rate requested. The minimum time is the time limited
- *	by the rate-limiting axis. The minimum time is needed to compute the optimal time and is
- *	recorded for possible feed override computation..
- *
- *	"Optimal time" is either the time resulting from the requested feed rate or the minimum time if
- *	the requested feed rate is not achievable. Optimal times for traverses are always the minimum time.
- *
- *	The gcode state must have targets set prior by having cm_set_target(). Axis modes are taken into
- *	account by this.
- *
- *	The following times are compared and the longest is returned:
- *	  -	G93 inverse time (if G93 is active)
- *	  -	time for coordinated move at requested feed rate
- *	  -	time that the slowest axis would require for the move
- *
- *	Sets the following variables in the gcode_state struct
- *	  - move_time is set to optimal time
- *	  - minimum_time is set to minimum time
- */
-/* --- NIST RS274NGC_v3 Guidance ---
- *
- *	The following is verbatim text from NIST RS274NGC_v3. As I interpret A for moves that
- *	combine both linear and rotational movement, the feed rate should apply to the XYZ
- *	movement, with the rotational axis (or axes) timed to start and end at the same time
- *	the linear move is performed. It is possible under this case for the rotational move
- *	to rate-limit the linear move.
- *
- * 	2.1.2.5 Feed Rate
- *
- *	The rate at which the controlled point or the axes move is nominally a steady rate
- *	which may be set by the user. In the Interpreter, the interpretation of the feed
- *	rate is as follows unless inverse time feed rate mode is being used in the
- *	RS274/NGC view (see Section 3.5.19). The canonical machining functions view of feed
- *	rate, as described in Section 4.3.5.1, has conditions under which the set feed rate
- *	is applied differently, but none of these is used in the Interpreter.
- *
- *	A. 	For motion involving one or more of the X, Y, and Z axes (with or without
- *		simultaneous rotational axis motion), the feed rate means length units per
- *		minute along the programmed XYZ path, as if the rotational axes were not moving.
- *
- *	B.	For motion of one rotational axis with X, Y, and Z axes not moving, the
- *		feed rate means degrees per minute rotation of the rotational axis.
- *
- *	C.	For motion of two or three rotational axes with X, Y, and Z axes not moving,
- *		the rate is applied as follows. Let dA, dB, and dC be the angles in degrees
- *		through which the A, B, and C axes, respectively, must move.
- *		Let D = sqrt(dA^2 + dB^2 + dC^2). Conceptually, D is a measure of total
- *		angular motion, using the usual Euclidean metric. Let T be the amount of
- *		time required to move through D degrees at the current feed rate in degrees
- *		per minute. The rotational axes should be moved in coordinated linear motion
- *		so that the elapsed time from the start to the end of the motion is T plus
- *		any time required for acceleration or deceleration.
+#ifdef __CHORD_BLEND
+/*
+ * _blend_chord() - merge a collinear-within-tolerance G1 move into the previous block
+ *
+ *	CAM posts commonly emit curves as polylines of short G1 facets. Each facet lands in its
+ *	own planner buffer, so junction velocity limits and per-block overhead throttle feed
+ *	rates on paths that are geometrically almost straight. If the blend tolerance ($bt) is
+ *	non-zero this function checks whether the incoming straight feed extends the last
+ *	committed buffer such that the dropped vertex stays within the tolerance of the combined
+ *	chord. If so, the committed buffer is popped off the queue, the planner position is
+ *	backed up to its start point, and mp_aline() replans the combined chord through the
+ *	normal code path - reusing all of the unit vector, jerk and move time math.
+ *
+ *	Deviation is measured from the chord that runs from the victim's start point to the
+ *	incoming target. The victim's own accumulated deviation (blend_dev) is added in so a
+ *	long gentle curve cannot creep away from the programmed path one tolerance at a time;
+ *	every dropped vertex remains within $bt of the chord that finally executes.
+ *
+ *	Merging is restricted to straight feeds in units-per-minute mode with matching feed rate
+ *	and spindle speed. The victim is only popped if both it and its predecessor are still
+ *	MP_BUFFER_QUEUED. The exec interrupt can promote the buffer following the run buffer, so
+ *	requiring the predecessor to be QUEUED means the exec must first execute an entire
+ *	intervening move (milliseconds) before it could touch the victim, while the pop below
+ *	completes in microseconds - the two cannot race.
+ */
+static void _blend_chord(GCodeState_t *gm_in)
+{
+	float tolerance = cm.blend_tolerance;
+#ifdef __PATH_CONTROL
+	if (cm_get_path_control(MODEL) != PATH_CONTINUOUS) return;			// G61/G61.1 - the path is exact
+	if (cm.path_tolerance > 0) { tolerance = cm.path_tolerance;}		// G64 P overrides $bt
+#endif
+	if (fp_ZERO(tolerance)) return;										// blending disabled
+	if (gm_in->motion_mode != MOTION_MODE_STRAIGHT_FEED) return;
+	if (gm_in->feed_rate_mode != UNITS_PER_MINUTE_MODE) return;			// don't blend inverse time moves
+
+	mpBuf_t *bf = mb.q->pv;												// last committed buffer
+	if ((bf->buffer_state != MP_BUFFER_QUEUED) ||
+		(bf->pv->buffer_state != MP_BUFFER_QUEUED)) return;				// see exec shield note, above
+	if ((bf->move_type != MOVE_TYPE_ALINE) ||
+		(bf->gm.motion_mode != MOTION_MODE_STRAIGHT_FEED)) return;
+	if (fp_NE(bf->gm.feed_rate, gm_in->feed_rate)) return;
+	if (fp_NE(bf->gm.spindle_speed, gm_in->spindle_speed)) return;
+
+	// The chord runs from the victim's start point to the incoming target.
+	// The victim's endpoint is the vertex that would be dropped.
+	float start[AXES], chord[AXES], vertex[AXES];
+	float chord_square = 0;
+	float vertex_square = 0;
+	float dot = 0;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		start[axis] = bf->gm.target[axis] - (bf->unit[axis] * bf->length);
+		chord[axis] = gm_in->target[axis] - start[axis];
+		vertex[axis] = bf->gm.target[axis] - start[axis];
+		chord_square += square(chord[axis]);
+		vertex_square += square(vertex[axis]);
+		dot += chord[axis] * vertex[axis];
+	}
+	if ((dot < EPSILON) || (dot > chord_square)) return;				// must extend the chord forward, not reverse or overshoot
+
+	float deviation = fast_sqrt(max(0, vertex_square - (square(dot) / chord_square))) + bf->blend_dev;
+	if (deviation > tolerance) return;
+
+	// Pop the victim off the queue and back the planner position up to its start point.
+	// The write and queue pointers advance in lockstep so both rewind to the victim,
+	// and the deviation is carried into the replanned buffer via blend_dev_pending.
+	mb.q = bf;
+	mb.w = bf;
+	mp_clear_buffer(bf);												// clears to MP_BUFFER_EMPTY
+	mb.buffers_available++;
+	qr_request_queue_report(-1);										// back out the victim's commit
+	copy_vector(mm.position, start);
+	blend_dev_pending = deviation;
+}
+#endif // __CHORD_BLEND
+
+/*
+ * _calc_move_times() - compute optimal and minimum move times into the gcode_state
+ *
+ *	"Minimum time" is the fastest the move can be performed given the velocity constraints on each
+ *	participating axis - regardless of the feed rate requested. The minimum time is the time limited
+ *	by the rate-limiting axis. The minimum time is needed to compute the optimal time and is
+ *	recorded for possible feed override computation..
+ *
+ *	"Optimal time" is either the time resulting from the requested feed rate or the minimum time if
+ *	the requested feed rate is not achievable. Optimal times for traverses are always the minimum time.
+ *
+ *	The gcode state must have targets set prior by having cm_set_target(). Axis modes are taken into
+ *	account by this.
+ *
+ *	The following times are compared and the longest is returned:
+ *	  -	G93 inverse time (if G93 is active)
+ *	  -	time for coordinated move at requested feed rate
+ *	  -	time that the slowest axis would require for the move
+ *
+ *	Sets the following variables in the gcode_state struct
+ *	  - move_time is set to optimal time
+ *	  - minimum_time is set to minimum time
+ */
+/* --- NIST RS274NGC_v3 Guidance ---
+ *
+ *	The following is verbatim text from NIST RS274NGC_v3. As I interpret A for moves that
+ *	combine both linear and rotational movement, the feed rate should apply to the XYZ
+ *	movement, with the rotational axis (or axes) timed to start and end at the same time
+ *	the linear move is performed. It is possible under this case for the rotational move
+ *	to rate-limit the linear move.
+ *
+ * 	2.1.2.5 Feed Rate
+ *
+ *	The rate at which the controlled point or the axes move is nominally a steady rate
+ *	which may be set by the user. In the Interpreter, the interpretation of the feed
+ *	rate is as follows unless inverse time feed rate mode is being used in the
+ *	RS274/NGC view (see Section 3.5.19). The canonical machining functions view of feed
+ *	rate, as described in Section 4.3.5.1, has conditions under which the set feed rate
+ *	is applied differently, but none of these is used in the Interpreter.
+ *
+ *	A. 	For motion involving one or more of the X, Y, and Z axes (with or without
+ *		simultaneous rotational axis motion), the feed rate means length units per
+ *		minute along the programmed XYZ path, as if the rotational axes were not moving.
+ *
+ *	B.	For motion of one rotational axis with X, Y, and Z axes not moving, the
+ *		feed rate means degrees per minute rotation of the rotational axis.
+ *
+ *	C.	For motion of two or three rotational axes with X, Y, and Z axes not moving,
+ *		the rate is applied as follows. Let dA, dB, and dC be the angles in degrees
+ *		through which the A, B, and C axes, respectively, must move.
+ *		Let D = sqrt(dA^2 + dB^2 + dC^2). Conceptually, D is a measure of total
+ *		angular motion, using the usual Euclidean metric. Let T be the amount of
+ *		time required to move through D degrees at the current feed rate in degrees
+ *		per minute. The rotational axes should be moved in coordinated linear motion
+ *		so that the elapsed time from the start to the end of the motion is T plus
+ *		any time required for acceleration or deceleration.
  */
 
-static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[])
-										// gms = Gcode model state
-{
-	float inv_time=0;				// inverse time if doing a feed in G93 mode
-	float xyz_time=0;				// coordinated move linear part at requested feed rate
-	float abc_time=0;				// coordinated move rotary part at requested feed rate
-	float max_time=0;				// time required for the rate-limiting axis
-	float tmp_time=0;				// used in computation
-	gms->minimum_time = 8675309;	// arbitrarily large number
-
-	// compute times for feed motion
-	if (gms->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
-		if (gms->feed_rate_mode == INVERSE_TIME_MODE) {
-			inv_time = gms->feed_rate;	// NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
-			gms->feed_rate_mode = UNITS_PER_MINUTE_MODE;
-		} else {
-			// compute length of linear move in millimeters. Feed rate is provided as mm/min
-			xyz_time = sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / gms->feed_rate;
-
-			// if no linear axes, compute length of multi-axis rotary move in degrees. Feed rate is provided as degrees/min
-			if (fp_ZERO(xyz_time)) {
-				abc_time = sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / gms->feed_rate;
-			}
-		}
-	}
-	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-		if (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
-			tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
-		} else { // MOTION_MODE_STRAIGHT_FEED
-			tmp_time = fabs(axis_length[axis]) / cm.a[axis].feedrate_max;
-		}
-		max_time = max(max_time, tmp_time);
-
-		if (tmp_time > 0) { 	// collect minimum time if this axis is not zero
-			gms->minimum_time = min(gms->minimum_time, tmp_time);
-		}
-	}
-	gms->move_time = max4(inv_time, max_time, xyz_time, abc_time);
+static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const float axis_square[])
+										// gms = Gcode model state
+{
+	float inv_time=0;				// inverse time if doing a feed in G93 mode
+	float xyz_time=0;				// coordinated move linear part at requested feed rate
+	float abc_time=0;				// coordinated move rotary part at requested feed rate
+	float max_time=0;				// time required for the rate-limiting axis
+	float tmp_time=0;				// used in computation
+	gms->minimum_time = 8675309;	// arbitrarily large number
+
+	// compute times for feed motion
+	if (gms->motion_mode != MOTION_MODE_STRAIGHT_TRAVERSE) {
+		if (gms->feed_rate_mode == INVERSE_TIME_MODE) {
+			inv_time = gms->feed_rate;	// NB: feed rate was un-inverted to minutes by cm_set_feed_rate()
+			gms->feed_rate_mode = UNITS_PER_MINUTE_MODE;
+		} else {
+			// compute length of linear move in millimeters. Feed rate is provided as mm/min
+			xyz_time = fast_sqrt(axis_square[AXIS_X] + axis_square[AXIS_Y] + axis_square[AXIS_Z]) / gms->feed_rate;
+
+			// if no linear axes, compute length of multi-axis rotary move in degrees. Feed rate is provided as degrees/min
+			if (fp_ZERO(xyz_time)) {
+				abc_time = fast_sqrt(axis_square[AXIS_A] + axis_square[AXIS_B] + axis_square[AXIS_C]) / gms->feed_rate;
+			}
+		}
+	}
+#ifdef __AXIS_TABLE
+	const float *recip_rate = (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) ?
+		ax.recip_velocity_max : ax.recip_feedrate_max;	// hoist the mode test out of the loop
+	for (uint8_t axis = AXIS_X; axis < ax.active_axes; axis++) {
+		tmp_time = fabs(axis_length[axis]) * recip_rate[axis];
+		max_time = max(max_time, tmp_time);
+
+		if (tmp_time > 0) { 	// collect minimum time if this axis is not zero
+			gms->minimum_time = min(gms->minimum_time, tmp_time);
+		}
+	}
+#else
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		if (gms->motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+			tmp_time = fabs(axis_length[axis]) / cm.a[axis].velocity_max;
+		} else { // MOTION_MODE_STRAIGHT_FEED
+			tmp_time = fabs(axis_length[axis]) / cm.a[axis].feedrate_max;
+		}
+		max_time = max(max_time, tmp_time);
+
+		if (tmp_time > 0) { 	// collect minimum time if this axis is not zero
+			gms->minimum_time = min(gms->minimum_time, tmp_time);
+		}
+	}
+#endif
+	gms->move_time = max4(inv_time, max_time, xyz_time, abc_time);
 }
 
-/* _plan_block_list() - plans the entire block list
- *
- *	The block list is the circular buffer of planner buffers (bf's). The block currently
- *	being planned is the "bf" block. The "first block" is the next block to execute;
- *	queued immediately behind the currently executing block, aka the "running" block.
- *	In some cases there is no first block because the list is empty or there is only
- *	one block and it is already running.
- *
- *	If blocks following the first block are already optimally planned (non replannable)
- *	the first block that is not optimally planned becomes the effective first block.
- *
- *	_plan_block_list() plans all blocks between and including the (effective) first block
+/* _plan_block_list() - plans the entire block list
+ *
+ *	The block list is the circular buffer of planner buffers (bf's). The block currently
+ *	being planned is the "bf" block. The "first block" is the next block to execute;
+ *	queued immediately behind the currently executing block, aka the "running" block.
+ *	In some cases there is no first block because the list is empty or there is only
+ *	one block and it is already running.
+ *
+ *	If blocks following the first block are already optimally planned (non replannable)
+ *	the first block that is not optimally planned becomes the effective first block.
+ *
+ *	_plan_block_list() plans all blocks between and including the (effective) first block
  *	and the bf. It sets entry, exit and cruise v's from vmax's then calls trapezoid generation.
  *
  *	Variables that must be provided in the mpBuffers that will be processed:
@@ -421,7 +991,7 @@ static void _calc_move_times(GCodeState_t *gms, const float axis_length[], const
  *		list can be recomputed regardless of exact stops and previous replanning
  *		optimizations.
  *
- *	[2] The mr_flag is used to tell replan to account for mr buffer's exit velocity (Vx)
+ *	[2] The mr_flag is used to tell replan to account for mr buffer's exit velocity (Vx)
  *		mr's Vx is always found in the provided bf buffer. Used to replan feedholds
  */
 static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
@@ -437,27 +1007,47 @@ static void _plan_block_list(mpBuf_t *bf, uint8_t *mr_flag)
 
 	// forward planning pass - recomputes trapezoids in the list from the first block to the bf block.
 	while ((bp = mp_get_next_buffer(bp)) != bf) {
+		float entry_velocity;
+		float exit_velocity;
+
 		if ((bp->pv == bf) || (*mr_flag == true))  {
-			bp->entry_velocity = bp->entry_vmax;		// first block in the list
+			entry_velocity = bp->entry_vmax;			// first block in the list
 			*mr_flag = false;
 		} else {
-			bp->entry_velocity = bp->pv->exit_velocity;	// other blocks in the list
+			entry_velocity = bp->pv->exit_velocity;		// other blocks in the list
 		}
-		bp->cruise_velocity = bp->cruise_vmax;
-		bp->exit_velocity = min4( bp->exit_vmax,
-								  bp->nx->entry_vmax,
-								  bp->nx->braking_velocity,
-								 (bp->entry_velocity + bp->delta_vmax) );
+		exit_velocity = min4( bp->exit_vmax,
+							  bp->nx->entry_vmax,
+							  bp->nx->braking_velocity,
+							 (entry_velocity + bp->delta_vmax) );
 
-		mp_calculate_trapezoid(bp);
+		// Skip trapezoid regeneration if nothing feeding it actually changed.
+		// This bounds replanning cost - the backward pass may walk a long chain
+		// but only blocks whose velocities moved get the expensive zoid math.
+		if ((fp_EQ(entry_velocity, bp->entry_velocity)) &&
+			(fp_EQ(exit_velocity, bp->exit_velocity)) &&
+			(fp_EQ(bp->cruise_vmax, bp->cruise_velocity))) {
+			// stored velocities and trapezoid are still valid
+		} else {
+			bp->entry_velocity = entry_velocity;
+			bp->cruise_velocity = bp->cruise_vmax;
+			bp->exit_velocity = exit_velocity;
+#ifdef __CMD_PASSTHRU
+			if (MOVE_TYPE_IS_MOTION(bp->move_type)) {	// pass-through commands are zero-length links - no trapezoid
+				mp_calculate_trapezoid(bp);
+			}
+#else
+			mp_calculate_trapezoid(bp);
+#endif
+		}
 
 		// test for optimally planned trapezoids - only need to check various exit conditions
-		if  ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
-				(fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
-			  ( (bp->pv->replannable == false) &&
-				(fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) {
-			bp->replannable = false;
-		}
+		if  ( ( (fp_EQ(bp->exit_velocity, bp->exit_vmax)) ||
+				(fp_EQ(bp->exit_velocity, bp->nx->entry_vmax)) ) ||
+			  ( (bp->pv->replannable == false) &&
+				(fp_EQ(bp->exit_velocity, (bp->entry_velocity + bp->delta_vmax))) ) ) {
+			bp->replannable = false;
+		}
 	}
 	// finish up the last block move
 	bp->entry_velocity = bp->pv->exit_velocity;
@@ -479,6 +1069,91 @@ static void _reset_replannable_list()
 	} while (((bp = mp_get_next_buffer(bp)) != bf) && (bp->move_state != MOVE_OFF));
 }
 
+#ifdef __PLAN_THROTTLE
+/*
+ * mp_plan_queue_callback() - run a deferred backward pass from the controller loop
+ * _clear_plan_pending()    - mark the deferred chain as planned
+ *
+ *	mp_aline() batches backward passes while blocks stream in faster than they
+ *	execute, bounding planning work per block to amortized O(1) instead of one
+ *	full-chain pass per commit. This callback catches the remainder: a burst
+ *	that ends short of PLAN_THROTTLE_BATCH commits is planned on the next
+ *	controller pass. The exec restart covers the backstop case where
+ *	mp_exec_move() declined a still-pending block. The batched plan converges
+ *	to the same trapezoids as per-commit planning - pruning boundaries and
+ *	velocity propagation are identical - it just skips the intermediate
+ *	plan-to-zero results that each arriving block would have invalidated.
+ */
+static void _clear_plan_pending(void)
+{
+	mpBuf_t *bp = mm.plan_bf;
+	for (uint8_t i=0; i < mm.plan_pending; i++) {
+		bp->plan_pending = false;
+		bp = mp_get_prev_buffer(bp);
+	}
+	mm.plan_pending = 0;
+}
+
+stat_t mp_plan_queue_callback(void)
+{
+	if (mm.plan_pending == 0) { return (STAT_NOOP);}
+	uint8_t mr_flag = false;
+	_plan_block_list(mm.plan_bf, &mr_flag);
+	_clear_plan_pending();
+	st_request_exec_move();						// restart the exec if it declined a pending block
+	return (STAT_OK);
+}
+#endif // __PLAN_THROTTLE
+
+/*
+ * mp_feed_rate_override() - replan the queue for a new feed override factor
+ *
+ *	Applies the override factor to every queued (not yet running) aline buffer
+ *	and replans from the running buffer forward. The running buffer is frozen
+ *	(not replannable) so the runtime is never disturbed; the first queued block
+ *	picks up its entry velocity from the running block's exit velocity.
+ *
+ *	The override is absolute, not cumulative: cruise_vmax is recomputed from
+ *	the block's original target velocity (length / move_time) each time, and
+ *	the junction limit captured at mp_aline() time (junction_vmax) re-bounds
+ *	the entry velocity. Replanning cost is bounded by the unchanged-velocity
+ *	test in _plan_block_list() - blocks whose velocities don't actually change
+ *	skip trapezoid regeneration.
+ */
+stat_t mp_feed_rate_override(uint8_t flag, float override_factor)
+{
+	mpBuf_t *bf;							// last queued buffer (end of replan list)
+	mpBuf_t *bp;
+	uint8_t mr_flag = false;
+	float factor = (flag == true) ? override_factor : 1.0;
+
+	if ((factor < FEED_OVERRIDE_MIN_FACTOR) || (factor > FEED_OVERRIDE_MAX_FACTOR)) {
+		return (STAT_INPUT_VALUE_RANGE_ERROR);
+	}
+	if ((bp = mp_get_run_buffer()) == NULL) { return (STAT_OK); }	// nothing queued - nothing to do
+
+	bp->replannable = false;				// freeze the running block
+	bf = bp;
+	while ((bp = mp_get_next_buffer(bp)) != mp_get_run_buffer()) {
+		if (bp->buffer_state < MP_BUFFER_QUEUED) { break; }
+		if (MOVE_TYPE_IS_MOTION(bp->move_type)) {
+			bp->cruise_vmax = factor * (bp->length / bp->gm.move_time);
+			bp->entry_vmax = min(bp->cruise_vmax, bp->junction_vmax);
+			bp->delta_vmax = mp_get_target_velocity(0, bp->length, bp);
+			bp->exit_vmax = min(bp->cruise_vmax, (bp->entry_vmax + bp->delta_vmax));
+			bp->braking_velocity = bp->delta_vmax;
+			bp->replannable = true;
+		}
+		bf = bp;
+	}
+	if (bf == mp_get_run_buffer()) { return (STAT_OK); }	// no queued alines to replan
+	_plan_block_list(bf, &mr_flag);
+#ifdef __PLAN_THROTTLE
+	_clear_plan_pending();						// the full replan covered any deferred blocks
+#endif
+	return (STAT_OK);
+}
+
 /*
  * _get_junction_vmax() - Sonny's algorithm - simple
  *
@@ -537,6 +1212,26 @@ static void _reset_replannable_list()
  *	 	d		Delta of sums			(Dx*Ux+DY*UY)/Usum
  */
 
+#ifdef __JUNCTION_VMAX_CACHE
+/*	The cache is direct-mapped and keyed on the quantized unit vector pair. Pocketing
+ *	and raster toolpaths repeat the same few junction angles thousands of times, so a
+ *	handful of entries is enough to skip the three sqrt()'s on the vast majority of
+ *	junctions. Components are quantized to ~1/64, which can alias junctions differing
+ *	by less than about a degree onto one entry - the resulting vmax error is well under
+ *	the accuracy of the deviation model itself. The config signature folds the junction
+ *	deviations and junction acceleration into one float so a config change flushes the
+ *	cache. Zeroed keys can never match (a unit vector pair always has a component
+ *	above 1/sqrt(AXES)), so flushing is just clearing the keys.
+ */
+#define JVC_CACHE_SIZE 16				// direct-mapped entries - must be a power of 2
+
+static struct jvCacheSingleton {
+	float config_signature;				// junction devs + junction accel when keys were cached
+	int8_t key[JVC_CACHE_SIZE][2*AXES];	// quantized unit vector pairs
+	float vmax[JVC_CACHE_SIZE];			// cached _get_junction_vmax() results
+} jvc;
+#endif
+
 static float _get_junction_vmax(const float a_unit[], const float b_unit[])
 {
 	float costheta = - (a_unit[AXIS_X] * b_unit[AXIS_X])
@@ -549,6 +1244,47 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
 	if (costheta < -0.99) { return (10000000); } 		// straight line cases
 	if (costheta > 0.99)  { return (0); } 				// reversal cases
 
+#ifdef __JUNCTION_VMAX_CACHE
+	float signature = cm.junction_acceleration;
+	for (uint8_t i=0; i<AXES; i++) { signature += cm.a[i].junction_dev;}
+	if (fp_NE(signature, jvc.config_signature)) {
+		memset(jvc.key, 0, sizeof(jvc.key));			// flush on config change
+		jvc.config_signature = signature;
+	}
+	int8_t key[2*AXES];
+	uint8_t hash = 0;
+	for (uint8_t i=0; i<AXES; i++) {
+		key[i] = (int8_t)(a_unit[i] * 63);
+		key[AXES+i] = (int8_t)(b_unit[i] * 63);
+		hash = (uint8_t)((hash << 1) | (hash >> 7)) ^ (uint8_t)key[i] ^ (uint8_t)(key[AXES+i] << 2);
+	}
+	uint8_t slot = hash & (JVC_CACHE_SIZE-1);
+	if (memcmp(jvc.key[slot], key, sizeof(key)) == 0) {
+		return (jvc.vmax[slot]);
+	}
+#endif
+#ifdef __JUNCTION_PLANE_DEV
+	// Resolve the deviation circle in the plane of the two unit vectors. The
+	// deviation excursion from the programmed corner points along the turn
+	// bisector (b - a, normalized), so the per-axis deviation limits map onto
+	// the excursion as delta <= dev[i] / |bisector[i]| for every axis the
+	// excursion actually moves. An axis that passes straight through the
+	// corner (equal components in a and b) drops out of the bisector and no
+	// longer constrains it, where the unit-weighted fusing below charged such
+	// axes against delta - measurably conservative on shallow XY junctions
+	// with Z travel. |b - a| comes straight from costheta, so the exact form
+	// costs one divide and no new trig. Every axis still stays within its
+	// own junction deviation, so the higher corner speeds hold the same
+	// machine limits.
+	float recip_norm = fast_rsqrt(2 * (1 + costheta));	// 1/|b - a|, nonzero - straight lines returned above
+	float delta = cm.a[AXIS_X].junction_dev / max(fabs(b_unit[AXIS_X] - a_unit[AXIS_X]) * recip_norm, 0.001);
+	for (uint8_t axis=AXIS_Y; axis<AXES; axis++) {
+		float excursion = fabs(b_unit[axis] - a_unit[axis]) * recip_norm;
+		if (excursion > 0.001) {
+			delta = min(delta, cm.a[axis].junction_dev / excursion);
+		}
+	}
+#else
 	// Fuse the junction deviations into a vector sum
 	float a_delta = square(a_unit[AXIS_X] * cm.a[AXIS_X].junction_dev);
 	a_delta += square(a_unit[AXIS_Y] * cm.a[AXIS_Y].junction_dev);
@@ -564,14 +1300,58 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
 	b_delta += square(b_unit[AXIS_B] * cm.a[AXIS_B].junction_dev);
 	b_delta += square(b_unit[AXIS_C] * cm.a[AXIS_C].junction_dev);
 
-	float delta = (sqrt(a_delta) + sqrt(b_delta))/2;
-	float sintheta_over2 = sqrt((1 - costheta)/2);
+	float delta = (fast_sqrt(a_delta) + fast_sqrt(b_delta))/2;
+#endif
+	float sintheta_over2 = fast_sqrt((1 - costheta)/2);
 	float radius = delta * sintheta_over2 / (1-sintheta_over2);
-	float velocity = sqrt(radius * cm.junction_acceleration);
+	float velocity = fast_sqrt(radius * cm.junction_acceleration);
 //	printf ("v:%f\n", velocity);	//+++++
+#ifdef __JUNCTION_VMAX_CACHE
+	memcpy(jvc.key[slot], key, sizeof(key));
+	jvc.vmax[slot] = velocity;
+#endif
 	return (velocity);
 }
 
+#ifdef __PATH_CONTROL
+/*
+ * _get_path_control_vmax() - apply G61 / G64 P<tol> to the junction velocity
+ *
+ *	G61 (exact path) runs the programmed segments exactly: any real change of
+ *	direction brings the corner velocity to zero so the machine hits the
+ *	vertex, while collinear continuations pass at full speed ("hits corners
+ *	but does not stop if it does not need to"). G61.1 is handled upstream by
+ *	the exact_stop term in mp_aline().
+ *
+ *	G64 with a non-zero P substitutes the programmed tolerance for the fused
+ *	junction deviations as the delta in Sonny's algorithm (see
+ *	_get_junction_vmax() above), so the gcode chooses the deviation circle:
+ *	a loose tolerance on contour work corners faster than the machine
+ *	defaults, a tight one holds the path closer. Centripetal acceleration is
+ *	still bounded by the junction acceleration setting, so machine limits
+ *	hold at any tolerance.
+ */
+static float _get_path_control_vmax(const float a_unit[], const float b_unit[], float junction_velocity)
+{
+	float costheta = - (a_unit[AXIS_X] * b_unit[AXIS_X])
+					 - (a_unit[AXIS_Y] * b_unit[AXIS_Y])
+					 - (a_unit[AXIS_Z] * b_unit[AXIS_Z])
+					 - (a_unit[AXIS_A] * b_unit[AXIS_A])
+					 - (a_unit[AXIS_B] * b_unit[AXIS_B])
+					 - (a_unit[AXIS_C] * b_unit[AXIS_C]);
+
+	if (costheta < -0.99) { return (junction_velocity);}	// straight line - no corner to treat
+	if (cm_get_path_control(MODEL) == PATH_EXACT_PATH) {
+		return (0);											// G61 hits the corner
+	}
+	if (costheta > 0.99) { return (junction_velocity);}		// reversal - already zeroed
+
+	float sintheta_over2 = fast_sqrt((1 - costheta)/2);
+	float radius = cm.path_tolerance * sintheta_over2 / (1 - sintheta_over2);
+	return (fast_sqrt(radius * cm.junction_acceleration));
+}
+#endif // __PATH_CONTROL
+
 /*************************************************************************
  * feedholds - functions for performing holds
  *
@@ -590,7 +1370,7 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *
  *	  - Hold state == SYNC tells the aline exec routine to execute the next aline
  *		segment then set hold_state to PLAN. This gives the planner sufficient
- *		time to replan the block list for the hold before the next aline segment
+ *		time to replan the block list for the hold before the next aline segment
  *		needs to be processed.
  *
  *	  - Hold state == PLAN tells the planner to replan the mr buffer, the current
@@ -598,7 +1378,7 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *		hold. Hold planning replans the planner buffer queue down to zero and then
  *		back up from zero. Hold state is set to DECEL when planning is complete.
  *
- *	  - Hold state == DECEL persists until the aline execution runs to zero
+ *	  - Hold state == DECEL persists until the aline execution runs to zero
  *		velocity, at which point hold state transitions to HOLD.
  *
  *	  - Hold state == HOLD persists until the cycle is restarted. A cycle start
@@ -606,9 +1386,9 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *		occur any time after the hold is requested - either before or after
  *		motion stops.
  *
- *	  - mp_end_hold() is executed from cm_feedhold_sequencing_callback() once the
- *		hold state == HOLD and a cycle_start has been requested.This sets the hold
- *		state to OFF which enables _exec_aline() to continue processing. Move
+ *	  - mp_end_hold() is executed from cm_feedhold_sequencing_callback() once the
+ *		hold state == HOLD and a cycle_start has been requested.This sets the hold
+ *		state to OFF which enables _exec_aline() to continue processing. Move
  *		execution begins with the first buffer after the hold.
  *
  *	Terms used:
@@ -627,7 +1407,7 @@ static float _get_junction_vmax(const float a_unit[], const float b_unit[])
  *		  code in this module, but the code is so complicated I just left it
  *		  organized for clarity and hoped for the best from compiler optimization.
  */
-
+
 static float _compute_next_segment_velocity()
 {
 	if (mr.section == SECTION_BODY) return (mr.segment_velocity);
@@ -638,6 +1418,23 @@ static float _compute_next_segment_velocity()
 #endif
 }
 
+#ifdef __STOP_PLAN
+/*
+ * mp_update_stop_plan() - keep the precomputed stop plan current
+ *
+ *	Called once per segment from mp_exec_aline(). Records the velocity the next
+ *	segment will run and the jerk-limited braking distance to zero from it, so
+ *	mp_plan_hold_callback() engages from cached values instead of computing
+ *	lengths at hold time. One target-length evaluation per segment buys a
+ *	single-segment hold engagement latency.
+ */
+void mp_update_stop_plan(const mpBuf_t *bf)
+{
+	mr.stop_velocity = _compute_next_segment_velocity();
+	mr.stop_braking_length = mp_get_target_length(mr.stop_velocity, 0, bf);
+}
+#endif
+
 stat_t mp_plan_hold_callback()
 {
 	if (cm.hold_state != FEEDHOLD_PLAN)
@@ -647,7 +1444,9 @@ stat_t mp_plan_hold_callback()
 	if ((bp = mp_get_run_buffer()) == NULL)
         return (STAT_NOOP);                     // Oops! nothing's running
 
+#ifndef __STOP_PLAN
 	uint8_t mr_flag = true;                     // used to tell replan to account for mr buffer Vx
+#endif
 	float mr_available_length;                  // available length left in mr buffer for deceleration
 	float braking_velocity;                     // velocity left to shed to brake to zero
 	float braking_length;                       // distance required to brake to zero from braking_velocity
@@ -663,13 +1462,18 @@ stat_t mp_plan_hold_callback()
 			  square(mr.endpoint[AXIS_B] - mr.position[AXIS_B]) +
 			  square(mr.endpoint[AXIS_C] - mr.position[AXIS_C])));
 
-*/
+*/
 
-	// compute next_segment velocity
-//	braking_velocity = mr.segment_velocity;
+	// compute next_segment velocity
+//	braking_velocity = mr.segment_velocity;
 //	if (mr.section != SECTION_BODY) { braking_velocity += mr.forward_diff_1;}
-	braking_velocity = _compute_next_segment_velocity();
+#ifdef __STOP_PLAN
+	braking_velocity = mr.stop_velocity;		// cached by mp_update_stop_plan() as segments execute
+	braking_length = mr.stop_braking_length;
+#else
+	braking_velocity = _compute_next_segment_velocity();
 	braking_length = mp_get_target_length(braking_velocity, 0, bp); // bp is OK to use here
+#endif
 
 	// Hack to prevent Case 2 moves for perfect-fit decels. Happens in homing situations
 	// The real fix: The braking velocity cannot simply be the mr.segment_velocity as this
@@ -695,8 +1499,15 @@ stat_t mp_plan_hold_callback()
 		bp->entry_vmax = 0;						// set bp+0 as hold point
 		bp->move_state = MOVE_NEW;				// tell _exec to re-use the bf buffer
 
+#ifdef __STOP_PLAN
+		mb.hold_replan_deferred = true;			// queue behind the hold point replans at cycle start
+#else
 		_reset_replannable_list();				// make it replan all the blocks
 		_plan_block_list(mp_get_last_buffer(), &mr_flag);
+#ifdef __PLAN_THROTTLE
+		_clear_plan_pending();					// the full replan covered any deferred blocks
+#endif
+#endif
 		cm.hold_state = FEEDHOLD_DECEL;			// set state to decelerate and exit
 		return (STAT_OK);
 	}
@@ -715,7 +1526,7 @@ stat_t mp_plan_hold_callback()
 	bp->move_state = MOVE_NEW;					// tell _exec to re-use buffer
 	for (uint8_t i=0; i<PLANNER_BUFFER_POOL_SIZE; i++) {// a safety to avoid wraparound
 		mp_copy_buffer(bp, bp->nx);				// copy bp+1 into bp+0 (and onward...)
-		if (bp->move_type != MOVE_TYPE_ALINE) {	// skip any non-move buffers
+		if (MOVE_TYPE_IS_MOTION(bp->move_type) == false) {	// skip any non-move buffers
 			bp = mp_get_next_buffer(bp);		// point to next buffer
 			continue;
 		}
@@ -741,8 +1552,15 @@ stat_t mp_plan_hold_callback()
 	bp->delta_vmax = mp_get_target_velocity(0, bp->length, bp);
 	bp->exit_vmax = bp->delta_vmax;
 
+#ifdef __STOP_PLAN
+	mb.hold_replan_deferred = true;				// queue behind the hold point replans at cycle start
+#else
 	_reset_replannable_list();					// make it replan all the blocks
 	_plan_block_list(mp_get_last_buffer(), &mr_flag);
+#ifdef __PLAN_THROTTLE
+	_clear_plan_pending();						// the full replan covered any deferred blocks
+#endif
+#endif
 	cm.hold_state = FEEDHOLD_DECEL;				// set state to decelerate and exit
 	return (STAT_OK);
 }
@@ -756,9 +1574,23 @@ stat_t mp_end_hold()
 		cm.hold_state = FEEDHOLD_OFF;
 		mpBuf_t *bf;
 		if ((bf = mp_get_run_buffer()) == NULL) {	// NULL means nothing's running
+#ifdef __STOP_PLAN
+			mb.hold_replan_deferred = false;	// nothing queued - nothing to replan
+#endif
 			cm_set_motion_state(MOTION_STOP);
 			return (STAT_NOOP);
 		}
+#ifdef __STOP_PLAN
+		if (mb.hold_replan_deferred) {			// replanning was skipped at hold time - do it now,
+			mb.hold_replan_deferred = false;	// while the machine is stopped and latency is free
+			uint8_t mr_flag = false;			// mr is at zero velocity - nothing to account for
+			_reset_replannable_list();
+			_plan_block_list(mp_get_last_buffer(), &mr_flag);
+#ifdef __PLAN_THROTTLE
+			_clear_plan_pending();				// the full replan covered any deferred blocks
+#endif
+		}
+#endif
 		cm.motion_state = MOTION_RUN;
 		st_request_exec_move();					// restart the steppers
 	}
@@ -0,0 +1,448 @@
+/*
+ * plan_spline.c - cubic spline (G5/G5.1) planning and motion execution
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* This module follows the arrangement of plan_arc.c: the canonical machine entry
+ * point validates and computes the curve, then either hands the whole curve to
+ * the planner as a single MOVE_TYPE_SPLINE buffer (the native path) or falls
+ * back to queuing chord segments from the controller callback. CAM systems that
+ * emit curved paths as G5 blocks get one planner buffer per curve instead of
+ * hundreds of micro-lines, so the serial link, parser and planner all run at
+ * block rate while the per-segment math happens at execution time.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "plan_spline.h"
+#include "planner.h"
+#include "diagnostics.h"
+#include "util.h"
+
+#ifdef __CUBIC_SPLINE
+
+// Allocate spline planner singleton structure
+
+spline_t spl;
+
+// Local functions
+static uint8_t _native_spline_possible(void);
+static stat_t _queue_native_spline(void);
+static stat_t _queue_spline_segment(void);
+static stat_t _compute_spline(void);
+static void _estimate_spline_time(void);
+static float _bezier_point(const float c[4], float t);
+static float _bezier_first(const float c[4], float t);
+static float _bezier_second(const float c[4], float t);
+static float _spline_rate(float t);
+static void _spline_tangent(float t, float unit[]);
+
+/*****************************************************************************
+ * Canonical Machining spline functions (spline prep for planning and runtime)
+ *
+ * cm_spline_init()	    - initialize splines
+ * cm_spline_feed() 	- canonical machine entry point for G5/G5.1
+ * cm_spline_callback() - main-loop callback for the fallback segment generator
+ * cm_abort_spline()	- stop a spline in process
+ */
+
+/*
+ * cm_spline_init() - initialize spline structures
+ */
+void cm_spline_init()
+{
+	spl.magic_start = MAGICNUM;
+	spl.magic_end = MAGICNUM;
+}
+
+/*
+ * cm_spline_feed() - canonical machine entry point for cubic and quadratic splines
+ *
+ *	G5 programs a cubic Bezier in the XY plane: I,J offset the first control
+ *	point from the start of the move and P,Q offset the second control point
+ *	from its end. G5.1 programs a quadratic with a single I,J control point,
+ *	which is degree-elevated to an exactly equivalent cubic so there is one
+ *	execution path. The LinuxCNC shorthand that infers I,J on a chained G5
+ *	from the previous block's P,Q is not supported - all offsets are required.
+ */
+stat_t cm_spline_feed(float target[], float flags[],    // curve endpoints
+					  float i, float j,                 // first control point offset from start
+					  float p, float q,                 // second control point offset from end (G5 only)
+					  uint8_t motion_mode)              // defined motion mode
+{
+	// trap missing feed rate
+	if ((cm.gm.feed_rate_mode != INVERSE_TIME_MODE) && (fp_ZERO(cm.gm.feed_rate))) {
+    	return (STAT_GCODE_FEEDRATE_NOT_SPECIFIED);
+	}
+
+	// splines are defined in the XY plane only (G17)
+	if (cm.gm.select_plane != CANON_PLANE_XY) {
+    	return (STAT_GCODE_COMMAND_UNSUPPORTED);
+	}
+
+	// only X and Y axis words may be present
+	if (fp_NOT_ZERO(flags[AXIS_Z]) || fp_NOT_ZERO(flags[AXIS_A]) ||
+		fp_NOT_ZERO(flags[AXIS_B]) || fp_NOT_ZERO(flags[AXIS_C])) {
+    	return (STAT_GCODE_AXIS_CANNOT_BE_PRESENT);
+	}
+
+	// both first control point offsets are required
+	if (!(fp_NOT_ZERO(cm.gf.arc_offset[0]) && fp_NOT_ZERO(cm.gf.arc_offset[1]))) {
+    	return (STAT_ARC_OFFSETS_MISSING_FOR_SELECTED_PLANE);
+	}
+
+	if (motion_mode == MOTION_MODE_CUBIC_SPLINE) {      // G5 requires the second control point
+    	if (fp_ZERO(cm.gf.parameter)) { return (STAT_P_WORD_IS_MISSING);}
+    	if (fp_ZERO(cm.gf.q_parameter)) { return (STAT_Q_WORD_IS_MISSING);}
+	} else {                                            // G5.1 takes I,J only
+    	if (fp_NOT_ZERO(cm.gf.parameter) || fp_NOT_ZERO(cm.gf.q_parameter)) {
+        	return (STAT_GCODE_COMMAND_UNSUPPORTED);
+        }
+	}
+
+	// set values in the Gcode model state & copy it (linenum was already captured)
+	cm_set_model_target(target, flags);
+
+	cm.gm.motion_mode = motion_mode;
+	cm_set_work_offsets(&cm.gm);					// capture the fully resolved offsets to gm
+	memcpy(&spl.gm, &cm.gm, sizeof(GCodeState_t));	// copy GCode context to spline singleton - some will be overwritten to run segments
+	copy_vector(spl.position, cm.gmx.position);		// set initial spline position from gcode model
+
+	// Control points in absolute machine coordinates (canonical mm). A G5.1
+	// control point degree-elevates exactly to a cubic:
+	//   P1 = start + 2/3 * (C - start),  P2 = end + 2/3 * (C - end)
+	spl.control_x[0] = spl.position[AXIS_X];
+	spl.control_y[0] = spl.position[AXIS_Y];
+	spl.control_x[3] = spl.gm.target[AXIS_X];
+	spl.control_y[3] = spl.gm.target[AXIS_Y];
+	if (motion_mode == MOTION_MODE_CUBIC_SPLINE) {
+		spl.control_x[1] = spl.control_x[0] + _to_millimeters(i);
+		spl.control_y[1] = spl.control_y[0] + _to_millimeters(j);
+		spl.control_x[2] = spl.control_x[3] + _to_millimeters(p);
+		spl.control_y[2] = spl.control_y[3] + _to_millimeters(q);
+	} else {
+		float c_x = spl.control_x[0] + _to_millimeters(i);
+		float c_y = spl.control_y[0] + _to_millimeters(j);
+		spl.control_x[1] = spl.control_x[0] + (2 * (c_x - spl.control_x[0]) / 3);
+		spl.control_y[1] = spl.control_y[0] + (2 * (c_y - spl.control_y[0]) / 3);
+		spl.control_x[2] = spl.control_x[3] + (2 * (c_x - spl.control_x[3]) / 3);
+		spl.control_y[2] = spl.control_y[3] + (2 * (c_y - spl.control_y[3]) / 3);
+	}
+
+	// compute spline runtime values
+	ritorno(_compute_spline());
+
+	if (fp_ZERO(spl.length)) {
+        return (STAT_MINIMUM_LENGTH_MOVE);          // trap zero length curves
+    }
+
+	// Queue the whole curve as one planner buffer - see _queue_native_spline().
+	// Falls back to plan-time segmentation when the planner is congested, which
+	// also preserves block order behind anything already staged.
+	if (_native_spline_possible()) {
+        return (_queue_native_spline());
+    }
+	cm_cycle_start();						// if not already started
+	spl.run_state = MOVE_RUN;				// enable spline to be run from the callback
+	cm_finalize_move();
+	return (STAT_OK);
+}
+
+/*
+ * _native_spline_possible() - can this curve be queued as a single native buffer?
+ * _queue_native_spline() - hand the computed curve to the planner as one MOVE_TYPE_SPLINE buffer
+ *
+ *	Same reasoning as _queue_native_arc(): a native spline occupies one buffer
+ *	and its segments are generated along the curve at execution time (see
+ *	plan_exec.c), so the full lookahead window stays available for velocity
+ *	planning. Segmentation remains as the fallback: if staging is engaged the
+ *	curve must flow through the staging tier to preserve block order, and if
+ *	the planner has no headroom the callback-driven generator is the path that
+ *	knows how to wait. Both generators produce the same toolpath.
+ */
+static uint8_t _native_spline_possible()
+{
+#ifdef __PLAN_STAGING
+	if (mp_staging_engaged()) {
+        return (false);                             // keep block order behind staged blocks
+    }
+#endif
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+        return (false);                             // no headroom - the callback generator knows how to wait
+    }
+	return (true);
+}
+
+static stat_t _queue_native_spline()
+{
+	mpSplinePlan_t plan;
+
+	plan.length = spl.length;
+	plan.axis_length_x = spl.axis_length_x;
+	plan.axis_length_y = spl.axis_length_y;
+	plan.min_radius = spl.min_radius;
+	plan.p1_x = spl.control_x[1];
+	plan.p1_y = spl.control_y[1];
+	plan.p2_x = spl.control_x[2];
+	plan.p2_y = spl.control_y[2];
+
+	_spline_tangent(0, plan.entry_unit);
+	_spline_tangent(1, plan.exit_unit);
+
+	spl.gm.move_time = spl.spline_time;             // whole-curve time - _compute_spline() left the segment time here
+
+	// minimum_time mirrors the rate-limit floor _calc_move_times() provides for lines
+	float minimum_time = spl.axis_length_x / cm.a[AXIS_X].feedrate_max;
+	minimum_time = max(minimum_time, spl.axis_length_y / cm.a[AXIS_Y].feedrate_max);
+	spl.gm.minimum_time = minimum_time;
+
+	ritorno(mp_spline_aline(&spl.gm, &plan));
+	cm_cycle_start();                               // if not already started
+	cm_finalize_move();
+	return (STAT_OK);
+}
+
+/*
+ * cm_spline_callback() - generate a spline from chord segments (fallback path)
+ *
+ *	Called from the controller main loop, exactly like cm_arc_callback(). Each
+ *	time it's called it queues as many chord segments (lines) as it can before
+ *	it blocks, then returns.
+ */
+
+stat_t cm_spline_callback()
+{
+	if (spl.run_state == MOVE_OFF)
+        return (STAT_NOOP);
+
+#ifdef __COMMIT_BATCH
+	// Commit up to PLANNER_COMMIT_BATCH segments per pass - see cm_arc_callback()
+	// for the batching and budget rationale.
+#ifdef __DIAG
+	uint16_t start_ticks = dia_now();
+#endif
+	for (uint8_t batch = PLANNER_COMMIT_BATCH; batch > 0; batch--) {
+		if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM)
+			return (STAT_EAGAIN);
+		stat_t status = _queue_spline_segment();
+		if (status != STAT_EAGAIN)
+			return (status);							// spline is done
+#ifdef __DIAG
+		if ((uint16_t)(dia_now() - start_ticks) > PLANNER_COMMIT_BUDGET_TICKS)
+			break;
+#endif
+	}
+	return (STAT_EAGAIN);
+#else
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM)
+        return (STAT_EAGAIN);
+
+	return (_queue_spline_segment());
+#endif
+}
+
+/*
+ * _queue_spline_segment() - compute and queue the next spline chord segment
+ *
+ *	The parameter advances by the chord length over |dB/dt| - first order in
+ *	the segment length - and each target is evaluated exactly on the curve.
+ *	Returns STAT_EAGAIN while segments remain, STAT_OK on the last one.
+ */
+
+static stat_t _queue_spline_segment()
+{
+	if (spl.segment_count > 1) {
+		spl.t = min(spl.t + (spl.segment_length / _spline_rate(spl.t)), 1);
+		spl.gm.target[AXIS_X] = _bezier_point(spl.control_x, spl.t);
+		spl.gm.target[AXIS_Y] = _bezier_point(spl.control_y, spl.t);
+	} else {
+		spl.gm.target[AXIS_X] = spl.control_x[3];	// land the last segment exactly on the endpoint
+		spl.gm.target[AXIS_Y] = spl.control_y[3];
+	}
+	mp_aline(&spl.gm);								// run the line
+	copy_vector(spl.position, spl.gm.target);		// update spline current position
+
+	if (--spl.segment_count > 0)
+        return (STAT_EAGAIN);
+	spl.run_state = MOVE_OFF;
+	return (STAT_OK);
+}
+
+/*
+ * cm_abort_spline() - stop spline movement without maintaining position
+ *
+ *	OK to call if no spline is running
+ */
+
+void cm_abort_spline()
+{
+	spl.run_state = MOVE_OFF;
+}
+
+/*
+ * _compute_spline() - integrate the curve and set up runtime values
+ *
+ *	Walks the Bezier with SPLINE_PLAN_SAMPLES chords to integrate the path
+ *	length, the unsigned per-axis travel (which ranks jerk participation for
+ *	planning) and the tightest radius of curvature (which sets the centripetal
+ *	velocity cap and sizes the fallback chords). Also computes the segment
+ *	sizing for the fallback generator, mirroring _compute_arc(): chordal
+ *	accuracy, minimum segment distance and minimum segment time constraints.
+ */
+
+static stat_t _compute_spline()
+{
+	float prev_x = spl.control_x[0];
+	float prev_y = spl.control_y[0];
+	spl.length = 0;
+	spl.axis_length_x = 0;
+	spl.axis_length_y = 0;
+	spl.min_radius = SPLINE_RADIUS_MAX;
+
+	for (uint8_t i=1; i<=SPLINE_PLAN_SAMPLES; i++) {
+		float t = (float)i / SPLINE_PLAN_SAMPLES;
+		float x = _bezier_point(spl.control_x, t);
+		float y = _bezier_point(spl.control_y, t);
+		spl.length += hypotf(x - prev_x, y - prev_y);
+		spl.axis_length_x += fabs(x - prev_x);
+		spl.axis_length_y += fabs(y - prev_y);
+		prev_x = x;
+		prev_y = y;
+
+		// curvature at the chord midpoint: |x'y" - y'x"| / (x'^2 + y'^2)^(3/2)
+		float tm = t - ((float)0.5 / SPLINE_PLAN_SAMPLES);
+		float dx = _bezier_first(spl.control_x, tm);
+		float dy = _bezier_first(spl.control_y, tm);
+		float speed_square = square(dx) + square(dy);
+		if (speed_square > EPSILON) {
+			float ddx = _bezier_second(spl.control_x, tm);
+			float ddy = _bezier_second(spl.control_y, tm);
+			float kappa = fabs(dx*ddy - dy*ddx) / (speed_square * fast_sqrt(speed_square));
+			if (kappa > (1/SPLINE_RADIUS_MAX)) {
+				spl.min_radius = min(spl.min_radius, 1/kappa);
+			}
+		}
+	}
+
+	if (fp_ZERO(spl.length)) {
+        return (STAT_OK);                           // caller traps the zero length move
+    }
+	_estimate_spline_time();	// get an estimate of execution time to inform segment calculation
+
+	// Find the minimum number of segments that meets these constraints...
+	// The chord is sized from the tightest radius found along the curve, which
+	// is conservative everywhere else on it.
+	float chord = fast_sqrt(4*cm.chordal_tolerance * (2 * spl.min_radius - cm.chordal_tolerance));
+	float segments_for_chordal_accuracy = spl.length / chord;
+	float segments_for_minimum_distance = spl.length / cm.arc_segment_len;
+	float segments_for_minimum_time = spl.spline_time * MICROSECONDS_PER_MINUTE / MIN_ARC_SEGMENT_USEC;
+
+	float segments = floor(min3(segments_for_chordal_accuracy,
+							    segments_for_minimum_distance,
+							    segments_for_minimum_time));
+
+	segments = max(segments, 1);                    //...but is at least 1 segment
+	spl.gm.move_time = spl.spline_time / segments;  // gcode state struct gets segment time, not spline time
+	spl.segment_count = (int32_t)segments;
+	spl.segment_length = spl.length / segments;
+	spl.t = 0;
+	return (STAT_OK);
+}
+
+/*
+ * _estimate_spline_time()
+ *
+ *	Same estimate as _estimate_arc_time(): the move time is computed not to
+ *	exceed the time taken in the slowest dimension, using the integrated
+ *	per-axis travel against each axis' maximum feed rate.
+ */
+static void _estimate_spline_time ()
+{
+	// Determine move time at requested feed rate
+	if (cm.gm.feed_rate_mode == INVERSE_TIME_MODE) {
+		spl.spline_time = cm.gm.feed_rate;	            // inverse feed rate has been normalized to minutes
+		cm.gm.feed_rate = 0;                            // reset feed rate so next block requires an explicit feed rate setting
+		cm.gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
+	} else {
+		spl.spline_time = spl.length / cm.gm.feed_rate;
+	}
+
+	// Downgrade the time if there is a rate-limiting axis
+	spl.spline_time = max(spl.spline_time, spl.axis_length_x/cm.a[AXIS_X].feedrate_max);
+	spl.spline_time = max(spl.spline_time, spl.axis_length_y/cm.a[AXIS_Y].feedrate_max);
+}
+
+/*
+ * _bezier_point() - evaluate a cubic Bezier component at parameter t
+ * _bezier_first() - first derivative with respect to t
+ * _bezier_second() - second derivative with respect to t
+ * _spline_rate() - |dB/dt|, floored so a degenerate (cusp) tangent cannot stall t
+ * _spline_tangent() - unit path tangent at an endpoint, for junction planning
+ */
+
+static float _bezier_point(const float c[4], float t)
+{
+	float u = 1 - t;
+	return (u*u*u*c[0] + 3*u*u*t*c[1] + 3*u*t*t*c[2] + t*t*t*c[3]);
+}
+
+static float _bezier_first(const float c[4], float t)
+{
+	float u = 1 - t;
+	return (3 * (u*u*(c[1]-c[0]) + 2*u*t*(c[2]-c[1]) + t*t*(c[3]-c[2])));
+}
+
+static float _bezier_second(const float c[4], float t)
+{
+	return (6 * ((1-t)*(c[2] - 2*c[1] + c[0]) + t*(c[3] - 2*c[2] + c[1])));
+}
+
+static float _spline_rate(float t)
+{
+	float dx = _bezier_first(spl.control_x, t);
+	float dy = _bezier_first(spl.control_y, t);
+	return (max(hypotf(dx, dy), spl.length / 10));
+}
+
+static void _spline_tangent(float t, float unit[])
+{
+	// A control point coincident with its endpoint makes the true derivative
+	// vanish there, so fall back through the control polygon.
+	float dx = _bezier_first(spl.control_x, t);
+	float dy = _bezier_first(spl.control_y, t);
+	if (hypotf(dx, dy) < EPSILON) {
+		if (t < 0.5) {
+			dx = spl.control_x[2] - spl.control_x[0];
+			dy = spl.control_y[2] - spl.control_y[0];
+		} else {
+			dx = spl.control_x[3] - spl.control_x[1];
+			dy = spl.control_y[3] - spl.control_y[1];
+		}
+	}
+	if (hypotf(dx, dy) < EPSILON) {
+		dx = spl.control_x[3] - spl.control_x[0];
+		dy = spl.control_y[3] - spl.control_y[0];
+	}
+	float magnitude = max(hypotf(dx, dy), EPSILON);
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		unit[axis] = 0;
+	}
+	unit[AXIS_X] = dx / magnitude;
+	unit[AXIS_Y] = dy / magnitude;
+}
+
+#endif // __CUBIC_SPLINE
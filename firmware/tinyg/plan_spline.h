@@ -0,0 +1,60 @@
+/*
+ * plan_spline.h - cubic spline (G5/G5.1) planning and motion execution
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLAN_SPLINE_H_ONCE
+#define PLAN_SPLINE_H_ONCE
+
+#define SPLINE_PLAN_SAMPLES     16              // chords integrated for length, axis travel and curvature
+#define SPLINE_RADIUS_MAX       ((float)1000000)// min_radius for a straight curve - effectively uncapped
+
+typedef struct splSingleton {	    // persistent planner and runtime variables
+	magic_t magic_start;
+	uint8_t run_state;			    // runtime state for the fallback segment generator
+
+	float position[AXES];		    // accumulating runtime position
+	float control_x[4];			    // Bezier control points in the XY plane, absolute mm
+	float control_y[4];			    // [0]=start, [1] and [2]=interior points, [3]=end
+
+	float length;				    // integrated path length in mm
+	float axis_length_x;		    // unsigned per-axis path travel (for jerk ranking)
+	float axis_length_y;
+	float min_radius;			    // tightest radius of curvature found along the curve
+	float spline_time;				// total running time for spline (derived)
+
+	float t;						// curve parameter for the fallback segment generator
+	int32_t segment_count;			// count of running segments
+	float segment_length;			// path mm per fallback segment
+
+	GCodeState_t gm;			    // Gcode state struct is passed for each spline segment. Usage:
+//	uint32_t linenum;			    // line number of the spline feed move - same for each segment
+//	float target[AXES];			    // segment target
+//	float work_offset[AXES];	    // offset from machine coord system for reporting (same for each segment)
+//	float move_time;			    // segment_time: constant time per aline segment
+
+	magic_t magic_end;
+} spline_t;
+extern spline_t spl;
+
+/* spline function prototypes */	// NOTE: See canonical_machine.h for cm_spline_feed() prototype
+
+void cm_spline_init(void);
+stat_t cm_spline_callback(void);
+void cm_abort_spline(void);
+
+#endif	// End of include guard: PLAN_SPLINE_H_ONCE
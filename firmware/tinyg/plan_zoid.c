@@ -1,29 +1,29 @@
 /*
  * plan_zoid.c - acceleration managed line planning and motion execution - trapezoid planner
- * This file is part of the TinyG project
+ * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
  * Copyright (c) 2012 - 2015 Rob Giseburt
  *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
 #include "tinyg.h"
@@ -35,13 +35,13 @@
 /*
  * mp_calculate_trapezoid() - calculate trapezoid parameters
  *
- *	This rather brute-force and long-ish function sets section lengths and velocities
- *	based on the line length and velocities requested. It modifies the incoming
- *	bf buffer and returns accurate head, body and tail lengths, and accurate or
+ *	This rather brute-force and long-ish function sets section lengths and velocities
+ *	based on the line length and velocities requested. It modifies the incoming
+ *	bf buffer and returns accurate head, body and tail lengths, and accurate or
  *	reasonably approximate velocities. We care about accuracy on lengths, less
- *	so for velocity (as long as velocity err's on the side of too slow).
- *
- *	Note: We need the velocities to be set even for zero-length sections
+ *	so for velocity (as long as velocity err's on the side of too slow).
+ *
+ *	Note: We need the velocities to be set even for zero-length sections
  *	(Note: sections, not moves) so we can compute entry and exits for adjacent sections.
  *
  *	Inputs used are:
@@ -60,32 +60,32 @@
  *	  bf->body_length		- bf->length allocated to body
  *	  bf->tail_length		- bf->length allocated to tail
  *
- *	Note: The following conditions must be met on entry:
- *		bf->length must be non-zero (filter these out upstream)
+ *	Note: The following conditions must be met on entry:
+ *		bf->length must be non-zero (filter these out upstream)
  *		bf->entry_velocity <= bf->cruise_velocity >= bf->exit_velocity
  */
-/*	Classes of moves:
+/*	Classes of moves:
  *
- *	  Requested-Fit - The move has sufficient length to achieve the target velocity
- *		(cruise velocity). I.e: it will accommodate the acceleration / deceleration
- *		profile in the given length.
+ *	  Requested-Fit - The move has sufficient length to achieve the target velocity
+ *		(cruise velocity). I.e: it will accommodate the acceleration / deceleration
+ *		profile in the given length.
  *
  *	  Rate-Limited-Fit - The move does not have sufficient length to achieve target
- *		velocity. In this case the cruise velocity will be set lower than the requested
+ *		velocity. In this case the cruise velocity will be set lower than the requested
  *		velocity (incoming bf->cruise_velocity). The entry and exit velocities are satisfied.
  *
  *	  Degraded-Fit - The move does not have sufficient length to transition from
  *		the entry velocity to the exit velocity in the available length. These
  *		velocities are not negotiable, so a degraded solution is found.
  *
- *	  	In worst cases the move cannot be executed as the required execution time is
- *		less than the minimum segment time. The first degradation is to reduce the
- *		move to a body-only segment with an average velocity. If that still doesn't
- *		fit then the move velocity is reduced so it fits into a minimum segment.
- *		This will reduce the velocities in that region of the planner buffer as the
- *		moves are replanned to that worst-case move.
+ *	  	In worst cases the move cannot be executed as the required execution time is
+ *		less than the minimum segment time. The first degradation is to reduce the
+ *		move to a body-only segment with an average velocity. If that still doesn't
+ *		fit then the move velocity is reduced so it fits into a minimum segment.
+ *		This will reduce the velocities in that region of the planner buffer as the
+ *		moves are replanned to that worst-case move.
  *
- *	Various cases handled (H=head, B=body, T=tail)
+ *	Various cases handled (H=head, B=body, T=tail)
  *
  *	  Requested-Fit cases
  *	  	HBT	Ve<Vt>Vx	sufficient length exists for all parts (corner case: HBT')
@@ -95,23 +95,23 @@
  *	  	H	Ve<Vx		perfect fit H (common, results from planning)
  *	  	T	Ve>Vx		perfect fit T (common, results from planning)
  *	  	B	Ve=Vt=Vx	Velocities are close to each other and within matching tolerance
- *
+ *
  *	  Rate-Limited cases - Ve and Vx can be satisfied but Vt cannot
  *	  	HT	(Ve=Vx)<Vt	symmetric case. Split the length and compute Vt.
  *	  	HT'	(Ve!=Vx)<Vt	asymmetric case. Find H and T by successive approximation.
  *		HBT'			body length < min body length - treated as an HT case
  *		H'				body length < min body length - subsume body into head length
  *		T'				body length < min body length - subsume body into tail length
- *
+ *
  *	  Degraded fit cases - line is too short to satisfy both Ve and Vx
  *	    H"	Ve<Vx		Ve is degraded (velocity step). Vx is met
  *	  	T"	Ve>Vx		Ve is degraded (velocity step). Vx is met
  *	  	B"	<short>		line is very short but drawable; is treated as a body only
- *		F	<too short>	force fit: This block is slowed down until it can be executed
+ *		F	<too short>	force fit: This block is slowed down until it can be executed
  */
-/*	NOTE: The order of the cases/tests in the code is pretty important. Start with the
- *	  shortest cases first and work up. Not only does this simplify the order of the tests,
- *	  but it reduces execution time when you need it most - when tons of pathologically
+/*	NOTE: The order of the cases/tests in the code is pretty important. Start with the
+ *	  shortest cases first and work up. Not only does this simplify the order of the tests,
+ *	  but it reduces execution time when you need it most - when tons of pathologically
  *	  short Gcode blocks are being thrown at you.
  */
 
@@ -122,8 +122,59 @@
 #define MIN_TAIL_LENGTH (MIN_SEGMENT_TIME_PLUS_MARGIN * (bf->cruise_velocity + bf->exit_velocity))
 #define MIN_BODY_LENGTH (MIN_SEGMENT_TIME_PLUS_MARGIN * bf->cruise_velocity)
 
+static void _fit_trapezoid(mpBuf_t *bf);
+
+#ifdef __ZOID_CACHE
+/*
+ *	Planned-profile cache for the fitting cases below. Repetitive jobs (pick
+ *	and place, engraving rasters) present the same few blocks thousands of
+ *	times, and replanning re-derives the same profile for each of them on
+ *	every pass. The solution is fully determined by the six values in the
+ *	key, so an entry can simply replay the stored split. Keys match on exact
+ *	binary equality - repeated identical sequences reproduce their floats
+ *	bit-for-bit, and an exact match guarantees the cached answer is the one
+ *	the solver would have produced, so caching cannot alter planning.
+ *	The cheap early-out cases (F, B", B) stay in front of the cache - a
+ *	lookup would cost as much as solving them. Direct mapped; jerk and
+ *	cruise_vmax ride in the key so config changes displace stale entries
+ *	naturally. Hit/miss counts are surfaced in the _pz diagnostic group.
+ */
+#define ZOID_CACHE_SIZE 4				// entries - must be a power of 2
+
+typedef struct zoidCacheEntry {
+	float length;						// key - inputs to the fitting cases
+	float entry_velocity;
+	float cruise_velocity;
+	float exit_velocity;
+	float cruise_vmax;
+	float jerk;
+	float out_entry;					// stored solution
+	float out_cruise;
+	float out_exit;
+	float out_head;
+	float out_body;
+	float out_tail;
+} zoidCacheEntry_t;
+
+static zoidCacheEntry_t zc[ZOID_CACHE_SIZE];	// zeroed keys have length 0 and can never match
+
+static uint8_t _zoid_cache_slot(const mpBuf_t *bf)
+{
+	union { float f; uint32_t u; } k;
+	uint32_t hash;
+
+	k.f = bf->length;			hash  = k.u;
+	k.f = bf->entry_velocity;	hash ^= (k.u << 1);	// stagger so symmetric moves don't cancel
+	k.f = bf->exit_velocity;	hash ^= (k.u << 2);
+	k.f = bf->cruise_velocity;	hash ^= (k.u << 3);
+	hash ^= (hash >> 16);
+	hash ^= (hash >> 8);
+	return (hash & (ZOID_CACHE_SIZE-1));
+}
+#endif // __ZOID_CACHE
+
 void mp_calculate_trapezoid(mpBuf_t *bf)
-{
+{
 	//********************************************
 	//********************************************
 	//**   RULE #1 of mp_calculate_trapezoid()  **
@@ -135,49 +186,113 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 	// Force block into a single segment body with limited velocities
 	// Accept the entry velocity, limit the cruise, and go for the best exit velocity
 	// you can get given the delta_vmax (maximum velocity slew) supportable.
-
-	bf->naiive_move_time = 2 * bf->length / (bf->entry_velocity + bf->exit_velocity); // average
-
-	if (bf->naiive_move_time < MIN_SEGMENT_TIME_PLUS_MARGIN) {
+
+	bf->naiive_move_time = 2 * bf->length / (bf->entry_velocity + bf->exit_velocity); // average
+
+	if (bf->naiive_move_time < MIN_SEGMENT_TIME_PLUS_MARGIN) {
 		bf->cruise_velocity = bf->length / MIN_SEGMENT_TIME_PLUS_MARGIN;
 		bf->exit_velocity = max(0.0, min(bf->cruise_velocity, (bf->entry_velocity - bf->delta_vmax)));
 		bf->body_length = bf->length;
-		bf->head_length = 0;
+		bf->head_length = 0;
 		bf->tail_length = 0;
 		// We are violating the jerk value but since it's a single segment move we don't use it.
 		return;
-	}
-
+	}
+
 	// B" case: Block is short, but fits into a single body segment
-
-	if (bf->naiive_move_time <= NOM_SEGMENT_TIME) {
-		bf->entry_velocity = bf->pv->exit_velocity;
-		if (fp_NOT_ZERO(bf->entry_velocity)) {
-			bf->cruise_velocity = bf->entry_velocity;
-			bf->exit_velocity = bf->entry_velocity;
-		} else {
-			bf->cruise_velocity = bf->delta_vmax / 2;
-			bf->exit_velocity = bf->delta_vmax;
+
+	if (bf->naiive_move_time <= NOM_SEGMENT_TIME) {
+		bf->entry_velocity = bf->pv->exit_velocity;
+		if (fp_NOT_ZERO(bf->entry_velocity)) {
+#ifdef __RAMP_CHAIN
+			// A collinear continuation keeps the velocity granted by forward planning
+			// so a chain of single-segment blocks ramps as one long move instead of
+			// plateauing at every boundary. The slew is capped at delta_vmax; as with
+			// the other single-segment cases the jerk value is not used in execution.
+			if (bf->collinear) {
+				bf->exit_velocity = min(bf->exit_velocity, (bf->entry_velocity + bf->delta_vmax));
+				bf->cruise_velocity = (bf->entry_velocity + bf->exit_velocity)/2;
+			} else {
+				bf->cruise_velocity = bf->entry_velocity;
+				bf->exit_velocity = bf->entry_velocity;
+			}
+#else
+			bf->cruise_velocity = bf->entry_velocity;
+			bf->exit_velocity = bf->entry_velocity;
+#endif
+		} else {
+			bf->cruise_velocity = bf->delta_vmax / 2;
+			bf->exit_velocity = bf->delta_vmax;
 		}
 		bf->body_length = bf->length;
-		bf->head_length = 0;
+		bf->head_length = 0;
 		bf->tail_length = 0;
 		// We are violating the jerk value but since it's a single segment move we don't use it.
 		return;
-	}
-
-	// B case:  Velocities all match (or close enough)
-	//			This occurs frequently in normal gcode files with lots of short lines
+	}
+
+	// B case:  Velocities all match (or close enough)
+	//			This occurs frequently in normal gcode files with lots of short lines
 	//			This case is not really necessary, but saves lots of processing time
-
-	if (((bf->cruise_velocity - bf->entry_velocity) < TRAPEZOID_VELOCITY_TOLERANCE) &&
-	((bf->cruise_velocity - bf->exit_velocity) < TRAPEZOID_VELOCITY_TOLERANCE)) {
+
+	if (((bf->cruise_velocity - bf->entry_velocity) < TRAPEZOID_VELOCITY_TOLERANCE) &&
+	((bf->cruise_velocity - bf->exit_velocity) < TRAPEZOID_VELOCITY_TOLERANCE)) {
 		bf->body_length = bf->length;
-		bf->head_length = 0;
+		bf->head_length = 0;
 		bf->tail_length = 0;
 		return;
 	}
 
+	// All remaining cases require real solving - try the profile cache first
+
+#ifdef __ZOID_CACHE
+	zoidCacheEntry_t *zp = &zc[_zoid_cache_slot(bf)];
+	if ((zp->length == bf->length) &&					// exact binary equality by design
+		(zp->entry_velocity == bf->entry_velocity) &&
+		(zp->cruise_velocity == bf->cruise_velocity) &&
+		(zp->exit_velocity == bf->exit_velocity) &&
+		(zp->cruise_vmax == bf->cruise_vmax) &&
+		(zp->jerk == bf->jerk)) {
+		bf->entry_velocity = zp->out_entry;
+		bf->cruise_velocity = zp->out_cruise;
+		bf->exit_velocity = zp->out_exit;
+		bf->head_length = zp->out_head;
+		bf->body_length = zp->out_body;
+		bf->tail_length = zp->out_tail;
+		mm.zoid_cache_hits++;
+		return;
+	}
+	zp->length = bf->length;							// miss - record the key, solve, then
+	zp->entry_velocity = bf->entry_velocity;			// store the solution on the way out
+	zp->cruise_velocity = bf->cruise_velocity;
+	zp->exit_velocity = bf->exit_velocity;
+	zp->cruise_vmax = bf->cruise_vmax;
+	zp->jerk = bf->jerk;
+	mm.zoid_cache_misses++;
+
+	_fit_trapezoid(bf);
+
+	zp->out_entry = bf->entry_velocity;
+	zp->out_cruise = bf->cruise_velocity;
+	zp->out_exit = bf->exit_velocity;
+	zp->out_head = bf->head_length;
+	zp->out_body = bf->body_length;
+	zp->out_tail = bf->tail_length;
+#else
+	_fit_trapezoid(bf);
+#endif // __ZOID_CACHE
+}
+
+/*
+ * _fit_trapezoid() - the real solving cases of mp_calculate_trapezoid()
+ *
+ *	Everything from the head/tail short-line cases down. Split out so the
+ *	profile cache can wrap it; the inputs and outputs are exactly the bf
+ *	fields enumerated above.
+ */
+
+static void _fit_trapezoid(mpBuf_t *bf)
+{
 	// Head-only and tail-only short-line cases
 	//	 H" and T" degraded-fit cases
 	//	 H' and T' requested-fit cases where the body residual is less than MIN_BODY_LENGTH
@@ -192,7 +307,7 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 			}
 			bf->cruise_velocity = bf->entry_velocity;
 			bf->tail_length = bf->length;
-			bf->head_length = 0;
+			bf->head_length = 0;
 			return;
 		}
 
@@ -202,11 +317,11 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 			}
 			bf->cruise_velocity = bf->exit_velocity;
 			bf->head_length = bf->length;
-			bf->tail_length = 0;
+			bf->tail_length = 0;
 			return;
 		}
-	}
-
+	}
+
 	// Set head and tail lengths for evaluating the next cases
 	bf->head_length = mp_get_target_length(bf->entry_velocity, bf->cruise_velocity, bf);
 	bf->tail_length = mp_get_target_length(bf->exit_velocity, bf->cruise_velocity, bf);
@@ -231,15 +346,19 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 				// Average the entry speed and computed best cruise-speed
 				bf->cruise_velocity = (bf->entry_velocity + bf->cruise_velocity)/2;
 				bf->entry_velocity = bf->cruise_velocity;
-				bf->exit_velocity = bf->cruise_velocity;
+				bf->exit_velocity = bf->cruise_velocity;
 			}
 			return;
 		}
 
 		// Asymmetric HT' rate-limited case. This is relatively expensive but it's not called very often
-		// iteration trap: uint8_t i=0;
-		// iteration trap: if (++i > TRAPEZOID_ITERATION_MAX) { fprintf_P(stderr,PSTR("_calculate_trapezoid() failed to converge"));}
-
+		// The iteration count is hard-capped at TRAPEZOID_ITERATION_MAX so trapezoid
+		// generation has a deterministic worst-case latency (the solution converges
+		// monotonically, so capping just accepts the current approximation). Iteration
+		// counts are recorded in mm.zoid_iterations / mm.zoid_iterations_max and
+		// surfaced as the _pz diagnostic group for planning-time tuning.
+
+		uint8_t iterations = 0;
 		float computed_velocity = bf->cruise_vmax;
 		do {
 			bf->cruise_velocity = computed_velocity;	// initialize from previous iteration
@@ -252,9 +371,12 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 				bf->tail_length = (bf->tail_length / (bf->head_length + bf->tail_length)) * bf->length;
 				computed_velocity = mp_get_target_velocity(bf->exit_velocity, bf->tail_length, bf);
 			}
-			// insert iteration trap here if needed
-		} while ((fabs(bf->cruise_velocity - computed_velocity) / computed_velocity) > TRAPEZOID_ITERATION_ERROR_PERCENT);
-
+		} while ((++iterations < TRAPEZOID_ITERATION_MAX) &&
+				 ((fabs(bf->cruise_velocity - computed_velocity) / computed_velocity) > TRAPEZOID_ITERATION_ERROR_PERCENT));
+
+		mm.zoid_iterations = iterations;
+		if (iterations > mm.zoid_iterations_max) { mm.zoid_iterations_max = iterations; }
+
 		// set velocity and clean up any parts that are too short
 		bf->cruise_velocity = computed_velocity;
 		bf->head_length = mp_get_target_length(bf->entry_velocity, bf->cruise_velocity, bf);
@@ -300,6 +422,15 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
  * mp_get_target_length()	  - derive accel/decel length from delta V and jerk
  * mp_get_target_velocity() - derive velocity achievable from delta V and length
  *
+ *	With $apm=1 (__TRAP_PLAN) both reduce to the closed-form constant-acceleration
+ *	relations L = |Vf^2 - Vi^2| / 2a and Vf = sqrt(Vi^2 + 2aL) - two multiplies and
+ *	a scale against cached 2a terms, no roots-of-jerk math and no iteration. Servo
+ *	drives that shape their own motion profiles don't benefit from third-order
+ *	planning and skip its cost this way. Section execution is unchanged: the
+ *	forward-difference exec eases velocity within each section either way, and its
+ *	mean velocity over a section is (Vi+Vf)/2 - the same as the trapezoid's - so
+ *	section lengths and times agree with the plan.
+ *
  *	This set of functions returns the fourth thing knowing the other three.
  *
  * 	  Jm = the given maximum jerk
@@ -341,8 +472,13 @@ void mp_calculate_trapezoid(mpBuf_t *bf)
 
 float mp_get_target_length(const float Vi, const float Vf, const mpBuf_t *bf)
 {
+#ifdef __TRAP_PLAN
+	if (cm.plan_profile == PLAN_PROFILE_TRAPEZOID) {
+		return (fabs(Vf*Vf - Vi*Vi) * cm.recip_accel_2x);	// L = |Vf^2 - Vi^2| / 2a
+	}
+#endif
 //	return (Vi + Vf) * sqrt(fabs(Vf - Vi) * bf->recip_jerk);		// new formula
-	return (fabs(Vi-Vf) * sqrt(fabs(Vi-Vf) * bf->recip_jerk));		// old formula
+	return (fabs(Vi-Vf) * fast_sqrt(fabs(Vi-Vf) * bf->recip_jerk));		// old formula
 }
 
 /* Regarding mp_get_target_velocity:
@@ -369,10 +505,10 @@ float mp_get_target_length(const float Vi, const float Vf, const mpBuf_t *bf)
  *  OR
  *
  *      J from L, Vi, and Vf
- *      J = ((Vf - Vi) (Vi + Vf)�) / L�
+ *      J = ((Vf - Vi) (Vi + Vf)�) / L�
  *  Replacing Vf with x, and subtracting the known J:
- *      0 = ((x - Vi) (Vi + x)�) / L� - J
- *      Z(x) = ((x - Vi) (Vi + x)�) / L� - J
+ *      0 = ((x - Vi) (Vi + x)�) / L� - J
+ *      Z(x) = ((x - Vi) (Vi + x)�) / L� - J
  *
  *  L doesn't resolve to the value very quickly (it graphs near-vertical).
  *  So, we'll use J, which resolves in < 10 iterations, often in only two or three
@@ -386,14 +522,63 @@ float mp_get_target_length(const float Vi, const float Vf, const mpBuf_t *bf)
  *  SqrtDeltaOverJ = sqrt((x-Vi) / J)
  *  L'(x) = SqrtDeltaOverJ + (Vi + x) / (2*J) + (Vi + x) / (2*SqrtDeltaJ)
  *
- *  J'(x) = (2*Vi*x - Vi� + 3*x�) / L�
+ *  J'(x) = (2*Vi*x - Vi� + 3*x�) / L�
  */
 
+#ifdef __PV_TABLE
+/*
+ * mp_pow23() - fast x^(2/3) for peak-velocity-from-length calculations
+ *
+ *	mp_get_target_velocity() reduces to Vf = L^(2/3)*cbrt(J) + Vi, and the
+ *	pow() call is essentially its entire cost. The planner pays it at least
+ *	once per committed block (delta_vmax) and again in the short-line cases
+ *	of the trapezoid, which is exactly where micro-move jobs spend their
+ *	planning time. Split x into mantissa and exponent, interpolate m^(2/3)
+ *	from a 33-entry flash table over [0.5,1), and reassemble the power of
+ *	two exactly - 2^(2e/3) factors into a whole power of two times one of
+ *	three constants. Worst-case relative error is under 3e-5, far inside
+ *	the planner's velocity tolerances. The mantissa table is independent of
+ *	the jerk settings (cbrt_jerk carries those), so there is nothing to
+ *	rebuild when they change.
+ */
+static const float pow23_m[] PROGMEM = {
+	0.6299605, 0.6430173, 0.6559428, 0.6687422, 0.6814202, 0.6939814,
+	0.7064299, 0.7187697, 0.7310044, 0.7431376, 0.7551726, 0.7671124,
+	0.7789600, 0.7907181, 0.8023895, 0.8139766, 0.8254818, 0.8369074,
+	0.8482555, 0.8595282, 0.8707275, 0.8818552, 0.8929131, 0.9039030,
+	0.9148264, 0.9256851, 0.9364804, 0.9472138, 0.9578868, 0.9685006,
+	0.9790566, 0.9895560, 1.0000000 };
+static const float pow23_e[3] PROGMEM = { 1.0, 1.5874011, 2.5198421 };	// 2^(2r/3) for r = 0,1,2
+
+float mp_pow23(float x)
+{
+	if (x < EPSILON) { return (0);}					// pow(0) is 0; negative lengths do not occur
+	int e;
+	float m = frexp(x, &e);							// x = m * 2^e with m in [0.5,1)
+	float f = (m - 0.5) * 64;
+	uint8_t i = (uint8_t)f;
+	f -= i;
+	float p = pgm_read_float(&pow23_m[i]);
+	p += (pgm_read_float(&pow23_m[i+1]) - p) * f;
+	int q = (e >= 0) ? (e / 3) : -((2 - e) / 3);	// floored e/3 so the remainder is 0..2
+	return (ldexp(p * pgm_read_float(&pow23_e[e - 3*q]), 2*q));
+}
+#endif // __PV_TABLE
+
 #define GET_VELOCITY_ITERATIONS 0		// must be 0, 1, or 2
 float mp_get_target_velocity(const float Vi, const float L, const mpBuf_t *bf)
 {
+#ifdef __TRAP_PLAN
+	if (cm.plan_profile == PLAN_PROFILE_TRAPEZOID) {
+		return (fast_sqrt((Vi*Vi) + (L * cm.accel_2x)));	// Vf = sqrt(Vi^2 + 2aL)
+	}
+#endif
+#ifdef __PV_TABLE
+    float estimate = mp_pow23(L) * bf->cbrt_jerk + Vi;
+#else
     // 0 iterations (a reasonable estimate)
     float estimate = pow(L, 0.66666666) * bf->cbrt_jerk + Vi;
+#endif
 
 #if (GET_VELOCITY_ITERATIONS >= 1)
     // 1st iteration
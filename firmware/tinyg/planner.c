@@ -1,29 +1,29 @@
 /*
  * planner.c - Cartesian trajectory planning and motion execution
- * This file is part of the TinyG project
+ * This file is part of the TinyG project
  *
  * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
- * Copyright (c) 2012 - 2015 Rob Giseburt
- *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ * Copyright (c) 2012 - 2015 Rob Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 /* --- Planner Notes ----
  *
@@ -50,16 +50,18 @@
  *
  *	Lower-level models should never use data from upper-level models as the data
  *	may have changed and lead to unpredictable results.
- */
+ */
 #include "tinyg.h"
 #include "config.h"
 #include "canonical_machine.h"
 #include "plan_arc.h"
+#include "plan_spline.h"
 #include "planner.h"
 #include "kinematics.h"
 #include "stepper.h"
 #include "encoder.h"
 #include "report.h"
+#include "text_parser.h"
 #include "util.h"
 /*
 #ifdef __cplusplus
@@ -67,68 +69,82 @@ extern "C"{
 #endif
 */
 // Allocate planner structures
-
+
 mpBufferPool_t mb;				// move buffer queue
 mpMoveMasterSingleton_t mm;		// context for line planning
-mpMoveRuntimeSingleton_t mr;	// context for line runtime
+mpMoveRuntimeSingleton_t mr;	// context for line runtime
 
 /*
  * Local Scope Data and Functions
  */
 #define _bump(a) ((a<PLANNER_BUFFER_POOL_SIZE-1)?(a+1):0) // buffer incr & wrap
 #define spindle_speed move_time	// local alias for spindle_speed to the time variable
-#define value_vector gm.target	// alias for vector of values
-#define flag_vector unit		// alias for vector of flags
+#define value_vector gm.target	// alias for vector of values
+#define flag_vector unit		// alias for vector of flags
 
 // execution routines (NB: These are all called from the LO interrupt)
-static stat_t _exec_dwell(mpBuf_t *bf);
-static stat_t _exec_command(mpBuf_t *bf);
+static stat_t _exec_dwell(mpBuf_t *bf);
+static stat_t _exec_command(mpBuf_t *bf);
 
 /*
  * planner_init()
  */
 void planner_init()
 {
-// If you know all memory has been zeroed by a hard reset you don't need these next 2 lines
+// If you know all memory has been zeroed by a hard reset you don't need these next 2 lines
 	memset(&mr, 0, sizeof(mr));	// clear all values, pointers and status
-	memset(&mm, 0, sizeof(mm));	// clear all values, pointers and status
-	planner_init_assertions();
+	memset(&mm, 0, sizeof(mm));	// clear all values, pointers and status
+#ifdef __ADAPTIVE_SEGMENTS
+	cm.segment_usec_min = SEGMENT_USEC_MIN;		// seed sane bounds in case the exec runs
+	cm.segment_usec_max = SEGMENT_USEC_MAX;		// before config loads the persisted values
+#endif
+	planner_init_assertions();
 	mp_init_buffers();
 }
-
-/*
- * planner_init_assertions()
- * planner_test_assertions() - test assertions, return error code if violation exists
- */
-void planner_init_assertions()
-{
-	mm.magic_start = MAGICNUM;
-	mm.magic_end = MAGICNUM;
-	mr.magic_start = MAGICNUM;
-	mr.magic_end = MAGICNUM;
-}
-
-stat_t planner_test_assertions()
-{
-	if ((mm.magic_start  != MAGICNUM) || (mm.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
-	if ((mb.magic_start  != MAGICNUM) || (mb.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
-	if ((mr.magic_start  != MAGICNUM) || (mr.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
-	return (STAT_OK);
-}
+
+/*
+ * planner_init_assertions()
+ * planner_test_assertions() - test assertions, return error code if violation exists
+ */
+void planner_init_assertions()
+{
+	mm.magic_start = MAGICNUM;
+	mm.magic_end = MAGICNUM;
+	mr.magic_start = MAGICNUM;
+	mr.magic_end = MAGICNUM;
+}
+
+stat_t planner_test_assertions()
+{
+	if ((mm.magic_start  != MAGICNUM) || (mm.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
+	if ((mb.magic_start  != MAGICNUM) || (mb.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
+	if ((mr.magic_start  != MAGICNUM) || (mr.magic_end 	 != MAGICNUM)) return (STAT_PLANNER_ASSERTION_FAILURE);
+	return (STAT_OK);
+}
 
 /*
  * mp_flush_planner() - flush all moves in the planner and all arcs
  *
- *	Does not affect the move currently running in mr.
- *	Does not affect mm or gm model positions
+ *	Does not affect the move currently running in mr.
+ *	Does not affect mm or gm model positions
  *	This function is designed to be called during a hold to reset the planner
  *	This function should not generally be called; call cm_queue_flush() instead
  */
 void mp_flush_planner()
 {
 	cm_abort_arc();
-	mp_init_buffers();
-	cm_set_motion_state(MOTION_STOP);
+#ifdef __CUBIC_SPLINE
+	cm_abort_spline();
+#endif
+#ifdef __PLAN_STAGING
+	mp_flush_staging();
+#endif
+#ifdef __FAST_FLUSH
+	mp_reset_buffers();
+#else
+	mp_init_buffers();
+#endif
+	cm_set_motion_state(MOTION_STOP);
 }
 
 /*
@@ -149,14 +165,14 @@ void mp_flush_planner()
  *	 - mr.target	- target position of runtime segment
  *	 - mr.endpoint	- final target position of runtime segment
  *
- *	Note that position is set immediately when called and may not be not an accurate representation
+ *	Note that position is set immediately when called and may not be not an accurate representation
  *	of the tool position. The motors are still processing the action and the real tool position is
  *	still close to the starting point.
- */
-
-void mp_set_planner_position(uint8_t axis, const float position) { mm.position[axis] = position; }
+ */
+
+void mp_set_planner_position(uint8_t axis, const float position) { mm.position[axis] = position; }
 void mp_set_runtime_position(uint8_t axis, const float position) { mr.position[axis] = position; }
-
+
 void mp_set_steps_to_runtime_position()
 {
 	float step_position[MOTORS];
@@ -164,7 +180,7 @@ void mp_set_steps_to_runtime_position()
 	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 		mr.target_steps[motor] = step_position[motor];
 		mr.position_steps[motor] = step_position[motor];
-		mr.commanded_steps[motor] = step_position[motor];
+		mr.commanded_steps[motor] = (int32_t)round(step_position[motor]);
 		en_set_encoder_steps(motor, step_position[motor]);	// write steps to encoder register
 
 		// These must be zero:
@@ -172,63 +188,128 @@ void mp_set_steps_to_runtime_position()
 		st_pre.mot[motor].corrected_steps = 0;
 	}
 }
-
+
 /************************************************************************************
- * mp_queue_command() - queue a synchronous Mcode, program control, or other command
- * _exec_command() 	  - callback to execute command
- *
- *	How this works:
+ * mp_queue_command() - queue a synchronous Mcode, program control, or other command
+ * _exec_command() 	  - callback to execute command
+ *
+ *	How this works:
  *	  - The command is called by the Gcode interpreter (cm_<command>, e.g. an M code)
- *	  - cm_ function calls mp_queue_command which puts it in the planning queue (bf buffer).
- *		This involves setting some parameters and registering a callback to the
+ *	  - cm_ function calls mp_queue_command which puts it in the planning queue (bf buffer).
+ *		This involves setting some parameters and registering a callback to the
  *		execution function in the canonical machine
  *	  - the planning queue gets to the function and calls _exec_command()
  *	  - ...which puts a pointer to the bf buffer in the prep stratuc (st_pre)
- *	  - When the runtime gets to the end of the current activity (sending steps, counting a dwell)
- *		if executes mp_runtime_command...
- *	  - ...which uses the callback function in the bf and the saved parameters in the vectors
- *	  - To finish up mp_runtime_command() needs to free the bf buffer
+ *	  - When the runtime gets to the end of the current activity (sending steps, counting a dwell)
+ *		if executes mp_runtime_command...
+ *	  - ...which uses the callback function in the bf and the saved parameters in the vectors
+ *	  - To finish up mp_runtime_command() needs to free the bf buffer
  *
  *	Doing it this way instead of synchronizing on queue empty simplifies the
- *	handling of feedholds, feed overrides, buffer flushes, and thread blocking,
+ *	handling of feedholds, feed overrides, buffer flushes, and thread blocking,
  *	and makes keeping the queue full much easier - therefore avoiding Q starvation
  */
-
+
 void mp_queue_command(void(*cm_exec)(float[], float[]), float *value, float *flag)
 {
 	mpBuf_t *bf;
-
+
+#ifdef __PLAN_STAGING
+	if (mp_staging_engaged()) {							// preserve order behind staged blocks
+		mp_stage_command(false, cm_exec, value, flag);
+		return;
+	}
+#endif
+	// Never supposed to fail as buffer availability was checked upstream in the controller
+	if ((bf = mp_get_write_buffer()) == NULL) {
+		cm_hard_alarm(STAT_BUFFER_FULL_FATAL);
+		return;
+	}
+
+	bf->move_type = MOVE_TYPE_COMMAND;
+	bf->bf_func = _exec_command;						// callback to planner queue exec function
+	bf->cm_func = cm_exec;								// callback to canonical machine exec function
+
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		bf->value_vector[axis] = value[axis];
+		bf->flag_vector[axis] = flag[axis];
+	}
+	mp_commit_write_buffer(MOVE_TYPE_COMMAND);			// must be final operation before exit
+}
+
+#ifdef __CMD_PASSTHRU
+/*
+ * mp_queue_passthru_command() - queue a command that does not synchronize motion
+ *
+ *	Same execution path as mp_queue_command(), but the buffer is planned as a
+ *	zero-length link instead of a momentary hold. It inherits the preceding
+ *	move's unit vector (so the junction math sees a straight line) and its
+ *	exit velocity cap, so the lookahead chain plans straight through it and
+ *	the command still executes exactly when the runtime reaches its place in
+ *	the queue. Only use this for commands that don't affect motion geometry
+ *	(e.g. coolant). Falls back to the synchronizing form when there is no
+ *	committed predecessor to link to (queue empty, or predecessor frozen).
+ */
+void mp_queue_passthru_command(void(*cm_exec)(float[], float[]), float *value, float *flag)
+{
+	mpBuf_t *bf;
+
+#ifdef __PLAN_STAGING
+	if (mp_staging_engaged()) {							// preserve order behind staged blocks
+		mp_stage_command(true, cm_exec, value, flag);
+		return;
+	}
+#endif
 	// Never supposed to fail as buffer availability was checked upstream in the controller
-	if ((bf = mp_get_write_buffer()) == NULL) {
-		cm_hard_alarm(STAT_BUFFER_FULL_FATAL);
-		return;
-	}
-
-	bf->move_type = MOVE_TYPE_COMMAND;
-	bf->bf_func = _exec_command;						// callback to planner queue exec function
-	bf->cm_func = cm_exec;								// callback to canonical machine exec function
-
-	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
-		bf->value_vector[axis] = value[axis];
-		bf->flag_vector[axis] = flag[axis];
-	}
-	mp_commit_write_buffer(MOVE_TYPE_COMMAND);			// must be final operation before exit
+	if ((bf = mp_get_write_buffer()) == NULL) {
+		cm_hard_alarm(STAT_BUFFER_FULL_FATAL);
+		return;
+	}
+
+	bf->move_type = MOVE_TYPE_COMMAND;
+	bf->bf_func = _exec_command;						// callback to planner queue exec function
+	bf->cm_func = cm_exec;								// callback to canonical machine exec function
+
+	for (uint8_t axis = AXIS_X; axis < AXES; axis++) {
+		bf->value_vector[axis] = value[axis];
+		bf->flag_vector[axis] = flag[axis];
+	}
+
+	// Link to the predecessor so the planner passes through. The predecessor
+	// must still be committed-but-not-running and in the replannable chain -
+	// otherwise this command executes from a stop anyway and the cleared
+	// (synchronizing) buffer fields are the correct plan.
+	mpBuf_t *pv = bf->pv;
+	if ((pv->buffer_state == MP_BUFFER_QUEUED) && (pv->replannable == true) &&
+		((MOVE_TYPE_IS_MOTION(pv->move_type)) ||
+		((pv->move_type == MOVE_TYPE_COMMAND) && (fp_NOT_ZERO(pv->exit_vmax))))) {
+		copy_vector(bf->unit, pv->unit);
+		bf->entry_vmax = pv->exit_vmax;
+		bf->exit_vmax = pv->exit_vmax;
+		bf->braking_velocity = pv->exit_vmax;
+		bf->replannable = true;
+	}
+	mp_commit_write_buffer(MOVE_TYPE_COMMAND);			// must be final operation before exit
 }
+#endif // __CMD_PASSTHRU
 
 static stat_t _exec_command(mpBuf_t *bf)
-{
-	st_prep_command(bf);
-	return (STAT_OK);
+{
+#ifdef __CMD_PASSTHRU
+	bf->replannable = false;				// freeze the chain at a running pass-through command
+#endif
+	st_prep_command(bf);
+	return (STAT_OK);
 }
 
 stat_t mp_runtime_command(mpBuf_t *bf)
-{
-	bf->cm_func(bf->value_vector, bf->flag_vector);		// 2 vectors used by callbacks
-	if (mp_free_run_buffer())
-		cm_cycle_end();									// free buffer & perform cycle_end if planner is empty
-	return (STAT_OK);
+{
+	bf->cm_func(bf->value_vector, bf->flag_vector);		// 2 vectors used by callbacks
+	if (mp_free_run_buffer())
+		cm_cycle_end();									// free buffer & perform cycle_end if planner is empty
+	return (STAT_OK);
 }
-
+
 /*************************************************************************
  * mp_dwell() 	 - queue a dwell
  * _exec_dwell() - dwell execution
@@ -241,12 +322,18 @@ stat_t mp_dwell(float seconds)
 {
 	mpBuf_t *bf;
 
+#ifdef __PLAN_STAGING
+	if (mp_staging_engaged()) {							// preserve order behind staged blocks
+		mp_stage_dwell(seconds);
+		return (STAT_OK);
+	}
+#endif
 	if ((bf = mp_get_write_buffer()) == NULL)			// get write buffer or fail
-		return(cm_hard_alarm(STAT_BUFFER_FULL_FATAL));	// not ever supposed to fail
+		return(cm_hard_alarm(STAT_BUFFER_FULL_FATAL));	// not ever supposed to fail
 
 	bf->bf_func = _exec_dwell;							// register callback to dwell start
-	bf->gm.move_time = seconds;							// in seconds, not minutes
-	bf->move_state = MOVE_NEW;
+	bf->gm.move_time = seconds;							// in seconds, not minutes
+	bf->move_state = MOVE_NEW;
 	mp_commit_write_buffer(MOVE_TYPE_DWELL);			// must be final operation before exit
 	return (STAT_OK);
 }
@@ -254,9 +341,138 @@ stat_t mp_dwell(float seconds)
 static stat_t _exec_dwell(mpBuf_t *bf)
 {
 	st_prep_dwell((uint32_t)(bf->gm.move_time * 1000000));// convert seconds to uSec
-	if (mp_free_run_buffer()) cm_cycle_end();			// free buffer & perform cycle_end if planner is empty
+	if (mp_free_run_buffer()) cm_cycle_end();			// free buffer & perform cycle_end if planner is empty
+	return (STAT_OK);
+}
+
+#ifdef __TIME_ESTIMATE
+/**** JOB TIME ESTIMATION ************************************************
+ * mp_set_estimate()	  - enter / leave estimation mode ({est:1} ... {est:0})
+ * mp_estimate_add()	  - accumulate one freed run buffer into the totals
+ * mp_estimate_callback() - drain planned buffers in place of the stepper layer
+ * mp_estimate_active()	  - true while estimation mode is on
+ *
+ *	Estimation mode runs a job through the parser and the planner at full CPU
+ *	speed without moving the machine: mp_exec_move() declines all work while
+ *	the mode is on, and the callback below frees run buffers once the queue is
+ *	deep enough that the backward pass has converged on final trapezoids.
+ *	Durations are accumulated in mp_free_run_buffer() rather than here so the
+ *	host simulator - which executes moves for real - shares the same totals by
+ *	setting est.accumulate alone. {est:0} drains whatever is still queued and
+ *	reports the totals as JSON in the $bench style.
+ */
+
+mpEstimate_t est;
+
+static float _estimate_block_seconds(mpBuf_t *bf)
+{
+	float minutes = 0;						// lengths are mm, velocities are mm/min
+	if (bf->head_length > 0) { minutes += (2 * bf->head_length) / (bf->entry_velocity + bf->cruise_velocity);}
+	if (bf->body_length > 0) { minutes += bf->body_length / bf->cruise_velocity;}
+	if (bf->tail_length > 0) { minutes += (2 * bf->tail_length) / (bf->cruise_velocity + bf->exit_velocity);}
+	return (minutes * 60);
+}
+
+uint8_t mp_estimate_active() { return (est.active);}
+
+void mp_estimate_add(mpBuf_t *bf)
+{
+	if (est.accumulate == false) {				// real execution - job progress accounting
+		if (MOVE_TYPE_IS_MOTION(bf->move_type)) {
+			est.executed_seconds += _estimate_block_seconds(bf);
+		} else if (bf->move_type == MOVE_TYPE_DWELL) {
+			est.executed_seconds += bf->gm.move_time;
+		}
+		return;
+	}
+	if (MOVE_TYPE_IS_MOTION(bf->move_type)) {
+		est.lines++;
+		if (bf->gm.motion_mode == MOTION_MODE_STRAIGHT_TRAVERSE) {
+			est.traverse_seconds += _estimate_block_seconds(bf);
+		} else {
+			est.feed_seconds += _estimate_block_seconds(bf);
+		}
+	} else if (bf->move_type == MOVE_TYPE_DWELL) {
+		est.dwell_seconds += bf->gm.move_time;	// dwells store seconds, not minutes
+	} else if (bf->move_type != MOVE_TYPE_NULL) {
+		est.commands++;
+	}
+}
+
+stat_t mp_estimate_callback()
+{
+	if (est.active == false) { return (STAT_NOOP);}
+	uint8_t drained = false;
+
+	while (mp_get_planner_buffers_available() < PLANNER_BUFFER_HEADROOM) {
+		mpBuf_t *bf;
+		if ((bf = mp_get_run_buffer()) == NULL) { break;}
+#ifdef __PLAN_THROTTLE
+		if (bf->plan_pending == true) { break;}	// not planned yet - mp_plan_queue_callback() runs first
+#endif
+		if (mp_free_run_buffer()) { cm_cycle_end();}
+		drained = true;
+	}
+	return (drained ? STAT_OK : STAT_NOOP);
+}
+
+stat_t mp_set_estimate(nvObj_t *nv)
+{
+	if (fp_NOT_ZERO(nv->value)) {				// {est:1} - enter estimation mode
+		memset(&est, 0, sizeof(est));
+		est.active = true;
+		est.accumulate = true;
+		return (STAT_OK);
+	}
+	if (est.active == false) { return (STAT_OK);}	// {est:0} while not estimating
+#ifdef __PLAN_THROTTLE
+	mp_plan_queue_callback();					// flush a deferred backward pass first
+#endif
+	while (mp_get_run_buffer() != NULL) {		// drain anything still queued
+		if (mp_free_run_buffer()) { cm_cycle_end();}
+	}
+	est.active = false;
+	est.accumulate = false;
+	est.job_seconds = est.feed_seconds + est.traverse_seconds + est.dwell_seconds;
+	est.executed_seconds = 0;					// arm progress tracking for the real run
+	fprintf_P(stderr, PSTR("{\"est\":{\"sec\":%1.2f,\"feed_sec\":%1.2f,\"traverse_sec\":%1.2f,"
+			"\"dwell_sec\":%1.2f,\"lines\":%lu,\"commands\":%lu}}\n"),
+		est.feed_seconds + est.traverse_seconds + est.dwell_seconds,
+		est.feed_seconds, est.traverse_seconds, est.dwell_seconds,
+		(unsigned long)est.lines, (unsigned long)est.commands);
+	return (STAT_OK);
+}
+
+/*
+ * mp_get_prog() - get percent complete of the current job ({prog:n})
+ * mp_get_eta()  - get estimated seconds remaining in the current job ({eta:n})
+ *
+ *	Both require a job total from a prior estimation run ({est:1} ... {est:0})
+ *	and report 0 until one exists. Executed time accumulates in
+ *	mp_estimate_add() as run buffers are freed - the same per-block arithmetic
+ *	estimation mode uses, so percent-complete is time-true on mixed
+ *	rapid/feed jobs where line counting is not.
+ */
+
+stat_t mp_get_prog(nvObj_t *nv)
+{
+	nv->value = 0;
+	if (est.job_seconds > 0) {
+		nv->value = min(100, (est.executed_seconds * 100) / est.job_seconds);
+	}
+	nv->precision = 1;
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t mp_get_eta(nvObj_t *nv)
+{
+	nv->value = max(0, est.job_seconds - est.executed_seconds);
+	nv->precision = 1;
+	nv->valuetype = TYPE_FLOAT;
 	return (STAT_OK);
 }
+#endif	// __TIME_ESTIMATE
 
 /**** PLANNER BUFFERS *****************************************************
  *
@@ -290,9 +506,9 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  *
  * mp_commit_write_buffer()	Commit the next write buffer to the queue
  *							Advances write pointer & changes buffer state
- *							WARNING: The calling routine must not use the write buffer
- *							once it has been queued as it may be processed and freed (wiped)
- *							before mp_queue_write_buffer() returns.
+ *							WARNING: The calling routine must not use the write buffer
+ *							once it has been queued as it may be processed and freed (wiped)
+ *							before mp_queue_write_buffer() returns.
  *
  * mp_get_run_buffer()		Get pointer to the next or current run buffer
  *							Returns a new run buffer if prev buf was ENDed
@@ -300,8 +516,8 @@ static stat_t _exec_dwell(mpBuf_t *bf)
  *							Returns NULL if no buffer available
  *							The behavior supports continuations (iteration)
  *
- * mp_free_run_buffer()		Release the run buffer & return to buffer pool.
- *							Returns true if queue is empty, false otherwise.
+ * mp_free_run_buffer()		Release the run buffer & return to buffer pool.
+ *							Returns true if queue is empty, false otherwise.
  *							This is useful for doing queue empty / end move functions.
  *
  * mp_get_prev_buffer(bf)	Returns pointer to prev buffer in linked list
@@ -314,14 +530,84 @@ static stat_t _exec_dwell(mpBuf_t *bf)
 
 uint8_t mp_get_planner_buffers_available(void) { return (mb.buffers_available);}
 
+#ifdef __QR_LOOKAHEAD_TIME
+/*
+ * mp_get_planned_time() - return planned time in the queue, in minutes
+ *
+ *	Sums the move times of all occupied buffers. The running buffer is counted
+ *	in full, so the result overstates the true lookahead by however much of the
+ *	current move has already executed - at most one move time. Called at queue
+ *	report rate, so the walk over the pool is not in any hot path.
+ */
+float mp_get_planned_time(void)
+{
+	float time = 0;
+	for (uint8_t i=0; i < PLANNER_BUFFER_POOL_SIZE; i++) {
+		if (mb.bf[i].buffer_state != MP_BUFFER_EMPTY) {
+			time += mb.bf[i].gm.move_time;
+		}
+	}
+	return (time);
+}
+#endif
+
+#ifdef __START_GATE
+/*
+ * mp_start_gate_holding()  - true while first motion should wait for queue depth
+ * mp_start_gate_callback() - release a timed-out gate once input has gone quiet
+ *
+ *	Without the gate the first block starts executing as soon as it hits the
+ *	run position, the queue starves right behind it, and launch stutters on
+ *	slow links. The gate keeps the launch parked (the exec returns NOOP, same
+ *	mechanics as the spindle-ready gate) until $pst milliseconds of planned
+ *	time are queued - or until $pst milliseconds pass on the wall clock, so a
+ *	job shorter than the gate or a link too slow to ever fill it still starts,
+ *	and the gate never costs more latency than the depth it is buying. The
+ *	RELEASED state persists until motion actually runs so a timeout release
+ *	cannot re-arm while the launch is still spinning up. Only machining
+ *	launches are gated - homing, probing and feedhold resumes are not.
+ */
+uint8_t mp_start_gate_holding(void)
+{
+	if ((cm.planner_start_ms < EPSILON) ||
+		(cm.cycle_state != CYCLE_MACHINING) ||
+		(cm.motion_state != MOTION_STOP) ||
+		(cm.hold_state != FEEDHOLD_OFF)) {
+		mb.start_gate = START_GATE_IDLE;		// not a gated launch (or launch complete)
+		return (false);
+	}
+	if (mb.start_gate == START_GATE_RELEASED) { return (false);}
+	if (mb.start_gate == START_GATE_IDLE) {		// arm on first sight of a waiting launch
+		mb.start_gate = START_GATE_HOLDING;
+		mb.start_gate_systick = SysTickTimer_getValue() + (uint32_t)cm.planner_start_ms;
+	}
+	if (((mp_get_planned_time() * (float)60000) >= cm.planner_start_ms) ||
+		(SysTickTimer_getValue() >= mb.start_gate_systick)) {
+		mb.start_gate = START_GATE_RELEASED;
+		return (false);
+	}
+	return (true);
+}
+
+stat_t mp_start_gate_callback(void)
+{
+	if (mb.start_gate != START_GATE_HOLDING) { return (STAT_NOOP);}
+	if (mp_start_gate_holding() == false) {		// released on depth or timeout
+		st_request_exec_move();					// restart the exec the gate put to sleep
+		return (STAT_OK);
+	}
+	return (STAT_NOOP);
+}
+#endif // __START_GATE
+
 void mp_init_buffers(void)
 {
 	mpBuf_t *pv;
 	uint8_t i;
-
+
 	memset(&mb, 0, sizeof(mb));		// clear all values, pointers and status
-	mb.magic_start = MAGICNUM;
-	mb.magic_end = MAGICNUM;
+	mb.magic_start = MAGICNUM;
+	mb.magic_end = MAGICNUM;
 
 	mb.w = &mb.bf[0];				// init write and read buffer pointers
 	mb.q = &mb.bf[0];
@@ -335,6 +621,34 @@ void mp_init_buffers(void)
 	mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
 }
 
+#ifdef __FAST_FLUSH
+/*
+ * mp_reset_buffers() - reclaim all planner buffers without reinitializing the ring
+ *
+ *	The nx/pv ring links are set once by mp_init_buffers() and never change, and
+ *	mp_get_write_buffer() clears a buffer's contents when it is claimed, so a
+ *	flush only needs to mark every buffer empty and rewind the three ring
+ *	pointers - stale contents in empty buffers are already normal (see
+ *	mp_unget_write_buffer()). This replaces the multi-KB memset and full ring
+ *	relink on the job abort path, so flushing a deep queue completes in
+ *	microseconds. Only call from a hold - motion has stopped, so nothing is
+ *	walking the ring.
+ */
+void mp_reset_buffers(void)
+{
+	for (uint8_t i=0; i < PLANNER_BUFFER_POOL_SIZE; i++) {
+		mb.bf[i].buffer_state = MP_BUFFER_EMPTY;
+	}
+	mb.w = &mb.bf[0];
+	mb.q = &mb.bf[0];
+	mb.r = &mb.bf[0];
+#ifdef __STOP_PLAN
+	mb.hold_replan_deferred = false;
+#endif
+	mb.buffers_available = PLANNER_BUFFER_POOL_SIZE;
+}
+#endif	// __FAST_FLUSH
+
 mpBuf_t * mp_get_write_buffer() 				// get & clear a buffer
 {
 	if (mb.w->buffer_state == MP_BUFFER_EMPTY) {
@@ -348,8 +662,8 @@ mpBuf_t * mp_get_write_buffer() 				// get & clear a buffer
 		mb.buffers_available--;
 		mb.w = w->nx;
 		return (w);
-	}
-	rpt_exception(STAT_FAILED_TO_GET_PLANNER_BUFFER);
+	}
+	rpt_exception(STAT_FAILED_TO_GET_PLANNER_BUFFER);
 	return (NULL);
 }
 
@@ -359,10 +673,10 @@ void mp_unget_write_buffer()
 	mb.w->buffer_state = MP_BUFFER_EMPTY; 		// not loading anymore
 	mb.buffers_available++;
 }
-
-/*** WARNING: The routine calling mp_commit_write_buffer() must not use the write buffer
-			  once it has been queued. Action may start on the buffer immediately,
-			  invalidating its contents ***/
+
+/*** WARNING: The routine calling mp_commit_write_buffer() must not use the write buffer
+			  once it has been queued. Action may start on the buffer immediately,
+			  invalidating its contents ***/
 
 void mp_commit_write_buffer(const uint8_t move_type)
 {
@@ -370,9 +684,9 @@ void mp_commit_write_buffer(const uint8_t move_type)
 	mb.q->move_state = MOVE_NEW;
 	mb.q->buffer_state = MP_BUFFER_QUEUED;
 	mb.q = mb.q->nx;							// advance the queued buffer pointer
-	qr_request_queue_report(+1);				// request a QR and add to the "added buffers" count
-	st_request_exec_move();						// requests an exec if the runtime is not busy
-												// NB: BEWARE! the exec may result in the planner buffer being
+	qr_request_queue_report(+1);				// request a QR and add to the "added buffers" count
+	st_request_exec_move();						// requests an exec if the runtime is not busy
+												// NB: BEWARE! the exec may result in the planner buffer being
 												// processed immediately and then freed - invalidating the contents
 }
 
@@ -392,15 +706,18 @@ mpBuf_t * mp_get_run_buffer()
 
 uint8_t mp_free_run_buffer()					// EMPTY current run buf & adv to next
 {
+#ifdef __TIME_ESTIMATE
+	mp_estimate_add(mb.r);						// accumulate totals before the clear (no-op unless enabled)
+#endif
 	mp_clear_buffer(mb.r);						// clear it out (& reset replannable)
 //	mb.r->buffer_state = MP_BUFFER_EMPTY;		// redundant after the clear, above
 	mb.r = mb.r->nx;							// advance to next run buffer
 	if (mb.r->buffer_state == MP_BUFFER_QUEUED) {// only if queued...
 		mb.r->buffer_state = MP_BUFFER_PENDING;	// pend next buffer
 	}
-	mb.buffers_available++;
-	qr_request_queue_report(-1);				// request a QR and add to the "removed buffers" count
-	return ((mb.w == mb.r) ? true : false); 	// return true if the queue emptied
+	mb.buffers_available++;
+	qr_request_queue_report(-1);				// request a QR and add to the "removed buffers" count
+	return ((mb.w == mb.r) ? true : false); 	// return true if the queue emptied
 }
 
 mpBuf_t * mp_get_first_buffer(void)
@@ -461,19 +778,106 @@ uint8_t mp_get_buffer_index(mpBuf_t *bf)
 }
 */
 
-/****************************
- * END OF PLANNER FUNCTIONS *
- ****************************/
-
-/***********************************************************************************
- * CONFIGURATION AND INTERFACE FUNCTIONS
- * Functions to get and set variables from the cfgArray table
- ***********************************************************************************/
-
-/***********************************************************************************
- * TEXT MODE SUPPORT
- * Functions to print variables from the cfgArray table
- ***********************************************************************************/
+/****************************
+ * END OF PLANNER FUNCTIONS *
+ ****************************/
+
+/***********************************************************************************
+ * CONFIGURATION AND INTERFACE FUNCTIONS
+ * Functions to get and set variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __ADAPTIVE_SEGMENTS
+/*
+ * mp_set_sgl() - set adaptive segment time lower bound (uSec)
+ * mp_set_sgh() - set adaptive segment time upper bound (uSec)
+ *
+ *	Both are clamped to [SEGMENT_USEC_MIN, SEGMENT_USEC_MAX]. Both clamps are
+ *	load bearing: DDA_SUBSTEPS is computed from SEGMENT_USEC_MAX, so a longer
+ *	segment would overflow the DDA accumulator, and a bound below the nominal
+ *	time can produce sections that trip the minimum-time-move rejection.
+ */
+
+stat_t mp_set_sgl(nvObj_t *nv)
+{
+	cm.segment_usec_min = min(SEGMENT_USEC_MAX, max(nv->value, SEGMENT_USEC_MIN));
+	return (STAT_OK);
+}
+
+stat_t mp_set_sgh(nvObj_t *nv)
+{
+	cm.segment_usec_max = min(SEGMENT_USEC_MAX, max(nv->value, SEGMENT_USEC_MIN));
+	return (STAT_OK);
+}
+#endif // __ADAPTIVE_SEGMENTS
+
+#ifdef __START_GATE
+/*
+ * mp_set_pst() - set launch gate planned-time depth, in ms (0 disables)
+ */
+stat_t mp_set_pst(nvObj_t *nv)
+{
+	cm.planner_start_ms = min(PLANNER_START_MS_MAX, max(nv->value, 0));
+	return (STAT_OK);
+}
+#endif // __START_GATE
+
+#ifdef __TRAP_PLAN
+/*
+ * mp_set_amx() - set trapezoid path acceleration and cache its 2a terms
+ */
+stat_t mp_set_amx(nvObj_t *nv)
+{
+	cm.accel_max = max(nv->value, TRAP_ACCEL_MIN);
+	cm.accel_2x = 2 * cm.accel_max;
+	cm.recip_accel_2x = 1 / cm.accel_2x;
+	return (STAT_OK);
+}
+#endif // __TRAP_PLAN
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+#ifdef __ADAPTIVE_SEGMENTS
+
+static const char fmt_sgl[] PROGMEM = "[sgl] segment time minimum%11.0f uSec\n";
+static const char fmt_sgh[] PROGMEM = "[sgh] segment time maximum%11.0f uSec\n";
+void mp_print_sgl(nvObj_t *nv) { text_print_flt(nv, fmt_sgl);}
+void mp_print_sgh(nvObj_t *nv) { text_print_flt(nv, fmt_sgh);}
+
+#endif // __ADAPTIVE_SEGMENTS
+#ifdef __INPUT_SHAPER
+
+static const char fmt_shm[] PROGMEM = "[shm] input shaper mode%12d [0=ZV,1=ZVD]\n";
+void mp_print_shm(nvObj_t *nv) { text_print_ui8(nv, fmt_shm);}
+
+#endif // __INPUT_SHAPER
+#ifdef __START_GATE
+
+static const char fmt_pst[] PROGMEM = "[pst] planner start depth%12.0f ms [0=disabled]\n";
+void mp_print_pst(nvObj_t *nv) { text_print_flt(nv, fmt_pst);}
+
+#endif // __START_GATE
+#ifdef __TRAP_PLAN
+
+static const char fmt_apm[] PROGMEM = "[apm] accel planning profile%8d [0=jerk,1=trapezoid]\n";
+static const char fmt_amx[] PROGMEM = "[amx] max acceleration%16.0f mm/min^2\n";
+void mp_print_apm(nvObj_t *nv) { text_print_ui8(nv, fmt_apm);}
+void mp_print_amx(nvObj_t *nv) { text_print_flt(nv, fmt_amx);}
+
+#endif // __TRAP_PLAN
+#ifdef __TIME_ESTIMATE
+
+static const char fmt_prog[] PROGMEM = "Job complete:%14.1f %%\n";
+static const char fmt_eta[]  PROGMEM = "Job remaining:%13.1f seconds\n";
+void mp_print_prog(nvObj_t *nv) { text_print_flt(nv, fmt_prog);}
+void mp_print_eta(nvObj_t *nv) { text_print_flt(nv, fmt_eta);}
+
+#endif // __TIME_ESTIMATE
+#endif // __TEXT_MODE
 /*
 #ifdef __cplusplus
 }
@@ -1,236 +1,448 @@
-/*
- * planner.h - cartesian trajectory planning and motion execution
- * This file is part of the TinyG project
- *
- * Copyright (c) 2013 - 2015 Alden S. Hart, Jr.
- * Copyright (c) 2013 - 2015 Robert Giseburt
- *
- * This file ("the software") is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License, version 2 as published by the
- * Free Software Foundation. You should have received a copy of the GNU General Public
- * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
- *
- * As a special exception, you may use this file as part of a software library without
- * restriction. Specifically, if other files instantiate templates or use macros or
- * inline functions from this file, or you compile this file and link it with  other
- * files to produce an executable, this file does not by itself cause the resulting
- * executable to be covered by the GNU General Public License. This exception does not
- * however invalidate any other reasons why the executable file might be covered by the
- * GNU General Public License.
- *
- * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
- * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
- * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
- * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
- * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
- * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
- */
-
-#ifndef PLANNER_H_ONCE
-#define PLANNER_H_ONCE
-
-#include "canonical_machine.h"	// used for GCodeState_t
-/*
-#ifdef __cplusplus
-extern "C"{
-#endif
-*/
-enum moveType {				// bf->move_type values
-	MOVE_TYPE_NULL = 0,		// null move - does a no-op
-	MOVE_TYPE_ALINE,		// acceleration planned line
-	MOVE_TYPE_DWELL,		// delay with no movement
-	MOVE_TYPE_COMMAND,		// general command
-	MOVE_TYPE_TOOL,			// T command
-	MOVE_TYPE_SPINDLE_SPEED,// S command
-	MOVE_TYPE_STOP,			// program stop
-	MOVE_TYPE_END			// program end
-};
-
-enum moveState {
-	MOVE_OFF = 0,			// move inactive (MUST BE ZERO)
-	MOVE_NEW,				// general value if you need an initialization
-	MOVE_RUN,				// general run state (for non-acceleration moves)
-	MOVE_SKIP_BLOCK			// mark a skipped block
-};
-
-enum moveSection {
-	SECTION_HEAD = 0,		// acceleration
-	SECTION_BODY,			// cruise
-	SECTION_TAIL			// deceleration
-};
-#define SECTIONS 3
-
-enum sectionState {
-	SECTION_OFF = 0,		// section inactive
-	SECTION_NEW,			// uninitialized section
-	SECTION_1st_HALF,		// first half of S curve
-	SECTION_2nd_HALF		// second half of S curve or running a BODY (cruise)
-};
-
-/*** Most of these factors are the result of a lot of tweaking. Change with caution.***/
-
-#define ARC_SEGMENT_LENGTH      ((float)0.1)		// Arc segment size (mm).(0.03)
-#define MIN_ARC_RADIUS          ((float)0.1)
-
-#define JERK_MULTIPLIER         ((float)1000000)
-#define JERK_MATCH_PRECISION    ((float)1000)		// precision to which jerk must match to be considered effectively the same
-
+/*
+ * planner.h - cartesian trajectory planning and motion execution
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2013 - 2015 Alden S. Hart, Jr.
+ * Copyright (c) 2013 - 2015 Robert Giseburt
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PLANNER_H_ONCE
+#define PLANNER_H_ONCE
+
+#include "canonical_machine.h"	// used for GCodeState_t
+/*
+#ifdef __cplusplus
+extern "C"{
+#endif
+*/
+enum moveType {				// bf->move_type values
+	MOVE_TYPE_NULL = 0,		// null move - does a no-op
+	MOVE_TYPE_ALINE,		// acceleration planned line
+	MOVE_TYPE_DWELL,		// delay with no movement
+	MOVE_TYPE_COMMAND,		// general command
+	MOVE_TYPE_TOOL,			// T command
+	MOVE_TYPE_SPINDLE_SPEED,// S command
+	MOVE_TYPE_STOP,			// program stop
+	MOVE_TYPE_END			// program end
+#ifdef __ARC_NATIVE
+	,MOVE_TYPE_ARC			// native arc - one buffer, segments generated at execution time
+#endif
+#ifdef __CUBIC_SPLINE
+	,MOVE_TYPE_SPLINE		// native spline - one buffer, segments generated at execution time
+#endif
+};
+
+// Arcs and splines plan and execute through the aline machinery, so most
+// move_type tests want "is this a motion block" rather than strictly
+// MOVE_TYPE_ALINE.
+#if defined(__ARC_NATIVE) && defined(__CUBIC_SPLINE)
+#define MOVE_TYPE_IS_MOTION(t) (((t) == MOVE_TYPE_ALINE) || ((t) == MOVE_TYPE_ARC) || ((t) == MOVE_TYPE_SPLINE))
+#elif defined(__ARC_NATIVE)
+#define MOVE_TYPE_IS_MOTION(t) (((t) == MOVE_TYPE_ALINE) || ((t) == MOVE_TYPE_ARC))
+#elif defined(__CUBIC_SPLINE)
+#define MOVE_TYPE_IS_MOTION(t) (((t) == MOVE_TYPE_ALINE) || ((t) == MOVE_TYPE_SPLINE))
+#else
+#define MOVE_TYPE_IS_MOTION(t) ((t) == MOVE_TYPE_ALINE)
+#endif
+
+enum moveState {
+	MOVE_OFF = 0,			// move inactive (MUST BE ZERO)
+	MOVE_NEW,				// general value if you need an initialization
+	MOVE_RUN,				// general run state (for non-acceleration moves)
+	MOVE_SKIP_BLOCK			// mark a skipped block
+};
+
+enum moveSection {
+	SECTION_HEAD = 0,		// acceleration
+	SECTION_BODY,			// cruise
+	SECTION_TAIL			// deceleration
+};
+#define SECTIONS 3
+
+enum sectionState {
+	SECTION_OFF = 0,		// section inactive
+	SECTION_NEW,			// uninitialized section
+	SECTION_1st_HALF,		// first half of S curve
+	SECTION_2nd_HALF		// second half of S curve or running a BODY (cruise)
+};
+
+/*** Most of these factors are the result of a lot of tweaking. Change with caution.***/
+
+#define ARC_SEGMENT_LENGTH      ((float)0.1)		// Arc segment size (mm).(0.03)
+#define MIN_ARC_RADIUS          ((float)0.1)
+
+#define JERK_MULTIPLIER         ((float)1000000)
+#define JERK_MATCH_PRECISION    ((float)1000)		// precision to which jerk must match to be considered effectively the same
+#ifdef __RAMP_CHAIN
+#define UNIT_MATCH_PRECISION    ((float)0.0001)		// per-term unit vector tolerance for collinear continuation
+#endif
+
 #define NOM_SEGMENT_USEC        ((float)5000)		// nominal segment time
 #define MIN_SEGMENT_USEC        ((float)2500)		// minimum segment time / minimum move time
 #define MIN_ARC_SEGMENT_USEC    ((float)10000)		// minimum arc segment time
-
-#define NOM_SEGMENT_TIME        (NOM_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
-#define MIN_SEGMENT_TIME        (MIN_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
-#define MIN_ARC_SEGMENT_TIME    (MIN_ARC_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
-#define MIN_TIME_MOVE           MIN_SEGMENT_TIME 	// minimum time a move can be is one segment
+
+#define NOM_SEGMENT_TIME        (NOM_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
+#define MIN_SEGMENT_TIME        (MIN_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
+#define MIN_ARC_SEGMENT_TIME    (MIN_ARC_SEGMENT_USEC / MICROSECONDS_PER_MINUTE)
+#define MIN_TIME_MOVE           MIN_SEGMENT_TIME 	// minimum time a move can be is one segment
 #define MIN_BLOCK_TIME          MIN_SEGMENT_TIME	// factor for minimum size Gcode block to process
-
-#define MIN_SEGMENT_TIME_PLUS_MARGIN ((MIN_SEGMENT_USEC+1) / MICROSECONDS_PER_MINUTE)
-
-/* PLANNER_STARTUP_DELAY_SECONDS
- *	Used to introduce a short dwell before planning an idle machine.
- *  If you don't do this the first block will always plan to zero as it will
- *	start executing before the next block arrives from the serial port.
- *	This causes the machine to stutter once on startup.
- */
-//#define PLANNER_STARTUP_DELAY_SECONDS ((float)0.05)	// in seconds
-
-/* PLANNER_BUFFER_POOL_SIZE
- *	Should be at least the number of buffers requires to support optimal
- *	planning in the case of very short lines or arc segments.
- *	Suggest 12 min. Limit is 255
- */
-#define PLANNER_BUFFER_POOL_SIZE 32
-#define PLANNER_BUFFER_HEADROOM 4			// buffers to reserve in planner before processing new input line
-
-/* Some parameters for _generate_trapezoid()
- * TRAPEZOID_ITERATION_MAX	 				Max iterations for convergence in the HT asymmetric case.
- * TRAPEZOID_ITERATION_ERROR_PERCENT		Error percentage for iteration convergence. As percent - 0.01 = 1%
- * TRAPEZOID_LENGTH_FIT_TOLERANCE			Tolerance for "exact fit" for H and T cases
- * TRAPEZOID_VELOCITY_TOLERANCE				Adaptive velocity tolerance term
- */
-#define TRAPEZOID_ITERATION_MAX				10
-#define TRAPEZOID_ITERATION_ERROR_PERCENT	((float)0.10)
-#define TRAPEZOID_LENGTH_FIT_TOLERANCE		((float)0.0001)	// allowable mm of error in planning phase
-#define TRAPEZOID_VELOCITY_TOLERANCE		(max(2,bf->entry_velocity/100))
-
-/*
- *	Macros and typedefs
- */
-
-typedef void (*cm_exec_t)(float[], float[]);	// callback to canonical_machine execution function
-
-/*
- *	Planner structures
- */
-
-// All the enums that equal zero must be zero. Don't change this
-
-enum mpBufferState {				// bf->buffer_state values
-	MP_BUFFER_EMPTY = 0,			// struct is available for use (MUST BE 0)
-	MP_BUFFER_LOADING,				// being written ("checked out")
-	MP_BUFFER_QUEUED,				// in queue
-	MP_BUFFER_PENDING,				// marked as the next buffer to run
-	MP_BUFFER_RUNNING				// current running buffer
-};
-
-typedef struct mpBuffer {			// See Planning Velocity Notes for variable usage
-	struct mpBuffer *pv;			// static pointer to previous buffer
-	struct mpBuffer *nx;			// static pointer to next buffer
-	stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
-	cm_exec_t cm_func;				// callback to canonical machine execution function
-
-	float naiive_move_time;
-
-	uint8_t buffer_state;			// used to manage queuing/dequeuing
-	uint8_t move_type;				// used to dispatch to run routine
-	uint8_t move_code;				// byte that can be used by used exec functions
-	uint8_t move_state;				// move state machine sequence
-	uint8_t replannable;			// TRUE if move can be re-planned
-
-	float unit[AXES];				// unit vector for axis scaling & planning
-
-	float length;					// total length of line or helix in mm
-	float head_length;
-	float body_length;
-	float tail_length;
-									// *** SEE NOTES ON THESE VARIABLES, in aline() ***
-	float entry_velocity;			// entry velocity requested for the move
-	float cruise_velocity;			// cruise velocity requested & achieved
-	float exit_velocity;			// exit velocity requested for the move
-
-	float entry_vmax;				// max junction velocity at entry of this move
-	float cruise_vmax;				// max cruise velocity requested for move
-	float exit_vmax;				// max exit velocity possible (redundant)
-	float delta_vmax;				// max velocity difference for this move
-	float braking_velocity;			// current value for braking velocity
-
-	uint8_t jerk_axis;				// rate limiting axis used to compute jerk for the move
-	float jerk;						// maximum linear jerk term for this move
-	float recip_jerk;				// 1/Jm used for planning (computed and cached)
-	float cbrt_jerk;				// cube root of Jm used for planning (computed and cached)
-
-	GCodeState_t gm;				// Gode model state - passed from model, used by planner and runtime
-
-} mpBuf_t;
-
-typedef struct mpBufferPool {		// ring buffer for sub-moves
-	magic_t magic_start;			// magic number to test memory integrity
-	uint8_t buffers_available;		// running count of available buffers
-	mpBuf_t *w;						// get_write_buffer pointer
-	mpBuf_t *q;						// queue_write_buffer pointer
-	mpBuf_t *r;						// get/end_run_buffer pointer
-	mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
-	magic_t magic_end;
-} mpBufferPool_t;
-
-typedef struct mpMoveMasterSingleton { // common variables for planning (move master)
-	magic_t magic_start;			// magic number to test memory integrity
-	float position[AXES];			// final move position for planning purposes
-
-	float jerk;						// jerk values cached from previous block
-	float recip_jerk;
-	float cbrt_jerk;
-
-	magic_t magic_end;
-} mpMoveMasterSingleton_t;
-
-typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
-//	uint8_t (*run_move)(struct mpMoveRuntimeSingleton *m); // currently running move - left in for reference
-	magic_t magic_start;			// magic number to test memory integrity
-	uint8_t move_state;				// state of the overall move
-	uint8_t section;				// what section is the move in?
-	uint8_t section_state;			// state within a move section
-
-	float unit[AXES];				// unit vector for axis scaling & planning
-	float target[AXES];				// final target for bf (used to correct rounding errors)
-	float position[AXES];			// current move position
-	float position_c[AXES];			// for Kahan summation in _exec_aline_segment()
-	float waypoint[SECTIONS][AXES];	// head/body/tail endpoints for correction
-
-	float target_steps[MOTORS];		// current MR target (absolute target as steps)
-	float position_steps[MOTORS];	// current MR position (target from previous segment)
-	float commanded_steps[MOTORS];	// will align with next encoder sample (target from 2nd previous segment)
-	float encoder_steps[MOTORS];	// encoder position in steps - ideally the same as commanded_steps
-	float following_error[MOTORS];	// difference between encoder_steps and commanded steps
-
-	float head_length;				// copies of bf variables of same name
-	float body_length;
-	float tail_length;
-
-	float entry_velocity;
-	float cruise_velocity;
-	float exit_velocity;
-
-	float segments;					// number of segments in line (also used by arc generation)
-	uint32_t segment_count;			// count of running segments
-	float segment_velocity;			// computed velocity for aline segment
-	float segment_time;				// actual time increment per aline segment
+
+#define MIN_SEGMENT_TIME_PLUS_MARGIN ((MIN_SEGMENT_USEC+1) / MICROSECONDS_PER_MINUTE)
+
+#ifdef __PLAN_THROTTLE
+// Deferred backward-pass batching - see mp_plan_queue_callback() in plan_line.c.
+// PLAN_THROTTLE_MIN_DEPTH planned buffers give the runtime well over 10 times
+// more runway than a controller pass, so the exec never reaches a deferred block.
+#define PLAN_THROTTLE_BATCH     4					// plan once per this many commits at most
+#define PLAN_THROTTLE_MIN_DEPTH 8					// never defer below this much planned queue depth
+#endif
+
+#ifdef __ADAPTIVE_SEGMENTS
+// Bounds for queue-depth-adaptive segment time - see _segment_usec() in plan_exec.c.
+// SEGMENT_USEC_MIN is floored at NOM_SEGMENT_USEC: segment time for a section can
+// fall to half the nominal value after the ceil() in the section initializers, so
+// anything below 2x MIN_SEGMENT_USEC would trip the minimum-time-move rejection.
+// SEGMENT_USEC_MAX is a hard ceiling as well as the $sgh default: DDA_SUBSTEPS in
+// stepper.h is computed from it, so longer segments would overflow the DDA accumulator.
+#define SEGMENT_USEC_MIN        NOM_SEGMENT_USEC	// $sgl default and hard floor
+#define SEGMENT_USEC_MAX        ((float)10000)		// $sgh default and hard ceiling
+#define MAX_SEGMENT_TIME        (SEGMENT_USEC_MAX / MICROSECONDS_PER_MINUTE)
+#endif
+
+#ifdef __INPUT_SHAPER
+#define SHAPER_ZV				0				// 2-impulse zero-vibration shaper
+#define SHAPER_ZVD				1				// 3-impulse ZV-derivative - wider notch, longer delay
+#endif
+
+/* PLANNER_STARTUP_DELAY_SECONDS
+ *	Used to introduce a short dwell before planning an idle machine.
+ *  If you don't do this the first block will always plan to zero as it will
+ *	start executing before the next block arrives from the serial port.
+ *	This causes the machine to stutter once on startup.
+ */
+//#define PLANNER_STARTUP_DELAY_SECONDS ((float)0.05)	// in seconds
+
+#ifdef __START_GATE
+// The launch gate is the working version of the startup delay above: motion
+// release waits until $pst milliseconds of planned time are in the queue, or
+// until the same interval passes on the wall clock (so a job shorter than the
+// gate, or a link too slow to ever fill it, still starts). 0 disables.
+#define PLANNER_START_MS ((float)250)	// $pst default - planned-time depth to buffer before first motion
+#define PLANNER_START_MS_MAX ((float)5000)
+
+#define START_GATE_IDLE 0				// no launch waiting
+#define START_GATE_HOLDING 1			// launch gated - building planned-time depth
+#define START_GATE_RELEASED 2			// gate released - motion may start
+#endif
+
+#ifdef __TRAP_PLAN
+#define PLAN_PROFILE_JERK 0				// $apm=0 - third-order jerk-limited S-curve planning (default)
+#define PLAN_PROFILE_TRAPEZOID 1		// $apm=1 - constant-acceleration trapezoid planning
+#define TRAP_ACCEL_MAX ((float)3600000)	// $amx default - path acceleration in mm/min^2 (1000 mm/s^2)
+#define TRAP_ACCEL_MIN ((float)36000)	// $amx floor - 10 mm/s^2; keeps the reciprocals sane
+#endif
+
+/* PLANNER_BUFFER_POOL_SIZE
+ *	Should be at least the number of buffers requires to support optimal
+ *	planning in the case of very short lines or arc segments.
+ *	Suggest 12 min. Limit is 255
+ *
+ *	The pool was raised from 32 to 48 when mpBuf_t was slimmed to carry a
+ *	GCodeStateCore_t instead of a full GCodeState_t. Deeper lookahead keeps
+ *	short-segment (high curvature) paths from starving and decelerating
+ *	mid-curve. 64 does not fit the XMega RAM map alongside everything else.
+ */
+#ifdef __HEADLESS
+#define PLANNER_BUFFER_POOL_SIZE 50		// headless banks part of the console RAM in lookahead depth
+#else
+#define PLANNER_BUFFER_POOL_SIZE 48
+#endif
+#define PLANNER_BUFFER_HEADROOM 4			// buffers to reserve in planner before processing new input line
+
+#ifdef __PLAN_STAGING
+#ifdef __HEADLESS
+#define STAGING_BUFFER_POOL_SIZE 24			// staged records are compact - the cheapest place to add depth
+#else
+#define STAGING_BUFFER_POOL_SIZE 16			// compact raw-block records held behind the planner pool
+#endif
+#define STAGING_BUFFER_HEADROOM 4			// staged records to reserve before processing new input line
+#endif
+
+#ifdef __COMMIT_BATCH
+#define PLANNER_COMMIT_BATCH 4				// max buffers an internal move producer may commit per callback pass
+#define PLANNER_COMMIT_BUDGET_TICKS 8000	// per-pass time budget on the __DIAG sample clock - 2 ms at 4 MHz
+#endif
+
+#define FEED_OVERRIDE_MIN_FACTOR 0.10		// lowest feed override factor allowed (M50.1 P)
+#define FEED_OVERRIDE_MAX_FACTOR 2.00		// highest feed override factor allowed
+
+/* Some parameters for _generate_trapezoid()
+ * TRAPEZOID_ITERATION_MAX	 				Max iterations for convergence in the HT asymmetric case.
+ * TRAPEZOID_ITERATION_ERROR_PERCENT		Error percentage for iteration convergence. As percent - 0.01 = 1%
+ * TRAPEZOID_LENGTH_FIT_TOLERANCE			Tolerance for "exact fit" for H and T cases
+ * TRAPEZOID_VELOCITY_TOLERANCE				Adaptive velocity tolerance term
+ */
+#define TRAPEZOID_ITERATION_MAX				10	// hard cap - bounds HT' solve to 10 passes
+												// (~2 sqrt + 1 pow each) for deterministic latency
+#define TRAPEZOID_ITERATION_ERROR_PERCENT	((float)0.10)
+#define TRAPEZOID_LENGTH_FIT_TOLERANCE		((float)0.0001)	// allowable mm of error in planning phase
+#define TRAPEZOID_VELOCITY_TOLERANCE		(max(2,bf->entry_velocity/100))
+
+/*
+ *	Macros and typedefs
+ */
+
+typedef void (*cm_exec_t)(float[], float[]);	// callback to canonical_machine execution function
+
+/*
+ *	Planner structures
+ */
+
+// All the enums that equal zero must be zero. Don't change this
+
+enum mpBufferState {				// bf->buffer_state values
+	MP_BUFFER_EMPTY = 0,			// struct is available for use (MUST BE 0)
+	MP_BUFFER_LOADING,				// being written ("checked out")
+	MP_BUFFER_QUEUED,				// in queue
+	MP_BUFFER_PENDING,				// marked as the next buffer to run
+	MP_BUFFER_RUNNING				// current running buffer
+};
+
+typedef struct mpBuffer {			// See Planning Velocity Notes for variable usage
+	struct mpBuffer *pv;			// static pointer to previous buffer
+	struct mpBuffer *nx;			// static pointer to next buffer
+	stat_t (*bf_func)(struct mpBuffer *bf); // callback to buffer exec function
+	cm_exec_t cm_func;				// callback to canonical machine execution function
+
+	float naiive_move_time;
+
+	uint8_t buffer_state;			// used to manage queuing/dequeuing
+	uint8_t move_type;				// used to dispatch to run routine
+	uint8_t move_code;				// byte that can be used by used exec functions
+	uint8_t move_state;				// move state machine sequence
+	uint8_t replannable;			// TRUE if move can be re-planned
+#ifdef __PLAN_THROTTLE
+	uint8_t plan_pending;			// TRUE if the commit was deferred - block is not yet planned
+#endif
+#ifdef __RAMP_CHAIN
+	uint8_t collinear;				// TRUE if this block continues the previous block's direction
+#endif
+
+	float unit[AXES];				// unit vector for axis scaling & planning
+#ifdef __ARC_NATIVE
+	uint8_t arc_plane_0;			// MOVE_TYPE_ARC only: arc plane and helix depth axes
+	uint8_t arc_plane_1;
+	uint8_t arc_linear_axis;
+	float arc_center_0;				// arc center in absolute machine coordinates
+	float arc_center_1;
+	float arc_radius;
+	float arc_theta_per_mm;			// signed plane angle advance per mm of path
+	float arc_linear_per_mm;		// helix depth advance per mm of path
+#endif
+#ifdef __CUBIC_SPLINE
+	float spl_p0_x;					// MOVE_TYPE_SPLINE only: Bezier control points in
+	float spl_p0_y;					// absolute machine mm. The start point is carried so
+	float spl_p1_x;					// a hold that re-runs the trimmed block mid-curve
+	float spl_p1_y;					// still reconstructs the same curve (the end point
+	float spl_p2_x;					// is gm.target)
+	float spl_p2_y;
+#endif
+
+	float length;					// total length of line or helix in mm
+#ifdef __CHORD_BLEND
+	float blend_dev;				// accumulated chord deviation if this block absorbed blended moves
+#endif
+	float head_length;
+	float body_length;
+	float tail_length;
+									// *** SEE NOTES ON THESE VARIABLES, in aline() ***
+	float entry_velocity;			// entry velocity requested for the move
+	float cruise_velocity;			// cruise velocity requested & achieved
+	float exit_velocity;			// exit velocity requested for the move
+
+	float entry_vmax;				// max junction velocity at entry of this move
+	float cruise_vmax;				// max cruise velocity requested for move
+	float exit_vmax;				// max exit velocity possible (redundant)
+	float delta_vmax;				// max velocity difference for this move
+	float junction_vmax;			// junction/exact-stop limit - kept for feed override replans
+	float braking_velocity;			// current value for braking velocity
+
+	uint8_t jerk_axis;				// rate limiting axis used to compute jerk for the move
+	float jerk;						// maximum linear jerk term for this move
+	float recip_jerk;				// 1/Jm used for planning (computed and cached)
+	float cbrt_jerk;				// cube root of Jm used for planning (computed and cached)
+
+	GCodeStateCore_t gm;			// compacted gcode model state - see cm_state_to_core()
+
+} mpBuf_t;
+
+#ifdef __ARC_NATIVE
+typedef struct mpArcPlan {			// arc geometry handed from plan_arc.c to mp_arc_aline()
+	float length;					// total helix path length in mm
+	float planar_travel;			// unsigned travel in the arc plane (|angular_travel| * radius)
+	float linear_travel;			// signed travel in the helix depth axis
+	float radius;
+	float theta_per_mm;				// signed plane angle advance per mm of path
+	float linear_per_mm;			// helix depth advance per mm of path
+	float center_0;					// arc center in absolute machine coordinates
+	float center_1;
+	float entry_unit[AXES];			// path tangent at the arc entry (for the entry junction)
+	float exit_unit[AXES];			// path tangent at the arc exit (for the next block's junction)
+	uint8_t plane_axis_0;
+	uint8_t plane_axis_1;
+	uint8_t linear_axis;
+} mpArcPlan_t;
+#endif
+
+#ifdef __CUBIC_SPLINE
+typedef struct mpSplinePlan {		// spline geometry handed from plan_spline.c to mp_spline_aline()
+	float length;					// integrated path length in mm
+	float axis_length_x;			// unsigned per-axis path travel (for jerk ranking)
+	float axis_length_y;
+	float min_radius;				// tightest radius of curvature found along the curve
+	float p1_x;						// interior Bezier control points, absolute machine mm
+	float p1_y;						// (the start and end points are implicit)
+	float p2_x;
+	float p2_y;
+	float entry_unit[AXES];			// path tangent at the curve entry (for the entry junction)
+	float exit_unit[AXES];			// path tangent at the curve exit (for the next block's junction)
+} mpSplinePlan_t;
+#endif
+
+typedef struct mpBufferPool {		// ring buffer for sub-moves
+	magic_t magic_start;			// magic number to test memory integrity
+	uint8_t buffers_available;		// running count of available buffers
+#ifdef __STOP_PLAN
+	uint8_t hold_replan_deferred;	// queue replan was deferred at hold time - run it in mp_end_hold()
+#endif
+#ifdef __START_GATE
+	uint8_t start_gate;				// launch gate state - see mp_start_gate_holding()
+	uint32_t start_gate_systick;	// systick at which a holding gate times out and releases
+#endif
+	mpBuf_t *w;						// get_write_buffer pointer
+	mpBuf_t *q;						// queue_write_buffer pointer
+	mpBuf_t *r;						// get/end_run_buffer pointer
+	mpBuf_t bf[PLANNER_BUFFER_POOL_SIZE];// buffer storage
+	magic_t magic_end;
+} mpBufferPool_t;
+
+typedef struct mpMoveMasterSingleton { // common variables for planning (move master)
+	magic_t magic_start;			// magic number to test memory integrity
+	float position[AXES];			// final move position for planning purposes
+
+	float jerk;						// jerk values cached from previous block
+	float recip_jerk;
+	float cbrt_jerk;
+
+	float zoid_iterations;			// HT' solver iterations for the last planned block
+	float zoid_iterations_max;		// high-water mark - see _pz diagnostic group
+#ifdef __ZOID_CACHE
+	float zoid_cache_hits;			// trapezoid profile cache counters - see _pz diagnostic group
+	float zoid_cache_misses;
+#endif
+
+#ifdef __PLAN_THROTTLE
+	mpBuf_t *plan_bf;				// newest deferred-plan buffer (end of the pending chain)
+	uint8_t plan_pending;			// commits accumulated since the last backward pass
+#endif
+
+	magic_t magic_end;
+} mpMoveMasterSingleton_t;
+
+typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
+//	uint8_t (*run_move)(struct mpMoveRuntimeSingleton *m); // currently running move - left in for reference
+	magic_t magic_start;			// magic number to test memory integrity
+	uint8_t move_state;				// state of the overall move
+	uint8_t section;				// what section is the move in?
+	uint8_t section_state;			// state within a move section
+
+	float unit[AXES];				// unit vector for axis scaling & planning
+	float target[AXES];				// final target for bf (used to correct rounding errors)
+	float position[AXES];			// current move position
+	float position_c[AXES];			// for Kahan summation in _exec_aline_segment()
+	float waypoint[SECTIONS][AXES];	// head/body/tail endpoints for correction
+
+	float target_steps[MOTORS];		// current MR target (absolute target as steps)
+	float position_steps[MOTORS];	// current MR position (target from previous segment)
+	int32_t commanded_steps[MOTORS];// will align with next encoder sample (rounded target from 2nd previous segment)
+	int32_t encoder_steps[MOTORS];	// encoder position in steps - ideally the same as commanded_steps
+	float following_error[MOTORS];	// step error that triggered the most recent correction (diagnostic)
+
+	float head_length;				// copies of bf variables of same name
+	float body_length;
+	float tail_length;
+
+	float entry_velocity;
+	float cruise_velocity;
+	float exit_velocity;
+
+	float segments;					// number of segments in line (also used by arc generation)
+	uint32_t segment_count;			// count of running segments
+	float segment_velocity;			// computed velocity for aline segment
+	float segment_time;				// actual time increment per aline segment
 	float jerk;						// max linear jerk
-
+#ifdef __STOP_PLAN
+	float stop_velocity;			// velocity the next segment will run (stop plan cache)
+	float stop_braking_length;		// jerk-limited distance to brake to zero from stop_velocity
+#endif
+#ifdef __EXEC_SEGMENT_BATCH
+	float segment_delta[AXES];		// precomputed per-segment travel for cruise (body) segments
+	float segment_steps[MOTORS];	// precomputed per-segment travel in steps
+#ifdef __MESH_COMP
+	uint8_t mesh_bypass;			// mesh varies along this move - skip the batch fast path
+#endif
+#endif
+#ifdef __THC
+	uint8_t thc_active;				// inject the THC Z offset into this move's segments
+#endif
+#ifdef __ARC_NATIVE
+	uint8_t arc_active;				// this move is an arc - targets come from the rotation state
+	uint8_t arc_plane_0;			// copies of bf variables of same name
+	uint8_t arc_plane_1;
+	uint8_t arc_linear_axis;
+	uint8_t arc_renorm_count;		// segments until the next exact sin/cos resync
+	float arc_center_0;
+	float arc_center_1;
+	float arc_radius;
+	float arc_theta;				// accumulated plane angle at the current position
+	float arc_theta_per_mm;
+	float arc_linear_per_mm;
+	float arc_vector_0;				// center-to-position vector, rotated incrementally
+	float arc_vector_1;
+	float arc_waypoint_theta[SECTIONS];	// plane angle at each section waypoint (for resync)
+#endif
+#ifdef __CUBIC_SPLINE
+	uint8_t spline_active;			// this move is a spline - targets come from the curve state
+	float spl_t;					// curve parameter at the current position
+	float spl_coeff_x[4];			// power basis: x(t) = ((c[0]*t + c[1])*t + c[2])*t + c[3]
+	float spl_coeff_y[4];
+	float spl_min_rate;				// floor for |dB/dt| so a degenerate tangent cannot stall t
+	float spl_waypoint_t[SECTIONS];	// curve parameter at each section waypoint (for resync)
+#endif
+
 #ifdef __JERK_EXEC					// values used exclusively by computed jerk acceleration
-	float jerk_div2;				// cached value for efficiency
-	float midpoint_velocity;		// velocity at accel/decel midpoint
+	float jerk_div2;				// cached value for efficiency
+	float midpoint_velocity;		// velocity at accel/decel midpoint
 	float midpoint_acceleration;	//
 	float accel_time;				//
 	float segment_accel_time;		//
@@ -241,90 +453,206 @@ typedef struct mpMoveRuntimeSingleton {	// persistent runtime variables
 	float forward_diff_3;			// forward difference level 3
 	float forward_diff_4;			// forward difference level 4
 	float forward_diff_5;			// forward difference level 5
-#ifdef __KAHAN
+#ifdef __KAHAN
 	float forward_diff_1_c;			// forward difference level 1 floating-point compensation
 	float forward_diff_2_c;			// forward difference level 2 floating-point compensation
 	float forward_diff_3_c;			// forward difference level 3 floating-point compensation
 	float forward_diff_4_c;			// forward difference level 4 floating-point compensation
 	float forward_diff_5_c;			// forward difference level 5 floating-point compensation
-#endif
-#endif
-
-	GCodeState_t gm;				// gcode model state currently executing
-
-	magic_t magic_end;
-} mpMoveRuntimeSingleton_t;
-
-// Reference global scope structures
-extern mpBufferPool_t mb;				// move buffer queue
-extern mpMoveMasterSingleton_t mm;		// context for line planning
-extern mpMoveRuntimeSingleton_t mr;		// context for line runtime
-
-/*
- * Global Scope Functions
- */
-
-void planner_init(void);
-void planner_init_assertions(void);
-stat_t planner_test_assertions(void);
-
-void mp_flush_planner(void);
-void mp_set_planner_position(uint8_t axis, const float position);
-void mp_set_runtime_position(uint8_t axis, const float position);
+#endif
+#endif
+
+	GCodeState_t gm;				// gcode model state currently executing
+
+	magic_t magic_end;
+} mpMoveRuntimeSingleton_t;
+
+#ifdef __TIME_ESTIMATE
+typedef struct mpEstimate {			// job time estimation totals - see $est in planner.c
+	uint8_t active;					// estimation mode is on - the stepper layer is detached
+	uint8_t accumulate;				// accumulate totals as run buffers are freed
+	uint32_t lines;					// ALINE blocks accumulated
+	uint32_t commands;				// synchronous commands accumulated
+	float feed_seconds;				// planned time in feed moves
+	float traverse_seconds;			// planned time in traverses
+	float dwell_seconds;			// time spent in dwells
+	float job_seconds;				// total from the last completed estimation run
+	float executed_seconds;			// planned time of blocks executed so far - see {prog:n}/{eta:n}
+} mpEstimate_t;
+#endif
+
+// Reference global scope structures
+extern mpBufferPool_t mb;				// move buffer queue
+extern mpMoveMasterSingleton_t mm;		// context for line planning
+extern mpMoveRuntimeSingleton_t mr;		// context for line runtime
+#ifdef __TIME_ESTIMATE
+extern mpEstimate_t est;				// job time estimation totals
+#endif
+
+/*
+ * Global Scope Functions
+ */
+
+void planner_init(void);
+void planner_init_assertions(void);
+stat_t planner_test_assertions(void);
+
+void mp_flush_planner(void);
+void mp_set_planner_position(uint8_t axis, const float position);
+void mp_set_runtime_position(uint8_t axis, const float position);
 void mp_set_steps_to_runtime_position(void);
-
-void mp_queue_command(void(*cm_exec_t)(float[], float[]), float *value, float *flag);
+
+void mp_queue_command(void(*cm_exec_t)(float[], float[]), float *value, float *flag);
+#ifdef __CMD_PASSTHRU
+void mp_queue_passthru_command(void(*cm_exec_t)(float[], float[]), float *value, float *flag);
+#else
+#define mp_queue_passthru_command mp_queue_command
+#endif
 stat_t mp_runtime_command(mpBuf_t *bf);
-
-stat_t mp_dwell(const float seconds);
-void mp_end_dwell(void);
-
-stat_t mp_aline(GCodeState_t *gm_in);
-
-stat_t mp_plan_hold_callback(void);
-stat_t mp_end_hold(void);
-stat_t mp_feed_rate_override(uint8_t flag, float parameter);
-
-// planner buffer handlers
+
+stat_t mp_dwell(const float seconds);
+void mp_end_dwell(void);
+
+stat_t mp_aline(GCodeState_t *gm_in);
+#ifdef __ARC_NATIVE
+stat_t mp_arc_aline(GCodeState_t *gm_in, mpArcPlan_t *plan);
+#endif
+#ifdef __CUBIC_SPLINE
+stat_t mp_spline_aline(GCodeState_t *gm_in, mpSplinePlan_t *plan);
+#endif
+#ifdef __PLAN_STAGING
+uint8_t mp_staging_engaged(void);
+uint8_t mp_staging_room(void);
+void mp_stage_command(uint8_t passthru, void(*cm_exec_t)(float[], float[]), float *value, float *flag);
+void mp_stage_dwell(float seconds);
+void mp_flush_staging(void);
+stat_t mp_staging_callback(void);
+#endif
+#ifdef __AXIS_TABLE
+void mp_update_axis_table(void);	// rebuild the flat axis constraint table from cm.a[]
+#endif
+stat_t mp_feed_rate_override(uint8_t flag, float override_factor);
+
+stat_t mp_plan_hold_callback(void);
+#ifdef __PLAN_THROTTLE
+stat_t mp_plan_queue_callback(void);
+#endif
+#ifdef __TIME_ESTIMATE
+uint8_t mp_estimate_active(void);
+void mp_estimate_add(mpBuf_t *bf);
+stat_t mp_set_estimate(nvObj_t *nv);
+stat_t mp_estimate_callback(void);
+stat_t mp_get_prog(nvObj_t *nv);
+stat_t mp_get_eta(nvObj_t *nv);
+#ifdef __TEXT_MODE
+	void mp_print_prog(nvObj_t *nv);
+	void mp_print_eta(nvObj_t *nv);
+#else
+	#define mp_print_prog tx_print_stub
+	#define mp_print_eta tx_print_stub
+#endif // __TEXT_MODE
+#endif
+stat_t mp_end_hold(void);
+#ifdef __STOP_PLAN
+void mp_update_stop_plan(const mpBuf_t *bf);
+#endif
+stat_t mp_feed_rate_override(uint8_t flag, float parameter);
+
+// planner buffer handlers
 uint8_t mp_get_planner_buffers_available(void);
-void mp_init_buffers(void);
-mpBuf_t * mp_get_write_buffer(void);
-void mp_unget_write_buffer(void);
-void mp_commit_write_buffer(const uint8_t move_type);
-
-mpBuf_t * mp_get_run_buffer(void);
-uint8_t mp_free_run_buffer(void);
-mpBuf_t * mp_get_first_buffer(void);
-mpBuf_t * mp_get_last_buffer(void);
-
+#ifdef __QR_LOOKAHEAD_TIME
+float mp_get_planned_time(void);
+#ifdef __START_GATE
+uint8_t mp_start_gate_holding(void);
+stat_t mp_start_gate_callback(void);	// called by controller dispatcher
+stat_t mp_set_pst(nvObj_t *nv);
+#endif
+#ifdef __TRAP_PLAN
+stat_t mp_set_amx(nvObj_t *nv);
+#endif
+#endif
+void mp_init_buffers(void);
+void mp_reset_buffers(void);
+mpBuf_t * mp_get_write_buffer(void);
+void mp_unget_write_buffer(void);
+void mp_commit_write_buffer(const uint8_t move_type);
+
+mpBuf_t * mp_get_run_buffer(void);
+uint8_t mp_free_run_buffer(void);
+mpBuf_t * mp_get_first_buffer(void);
+mpBuf_t * mp_get_last_buffer(void);
+
 //mpBuf_t * mp_get_prev_buffer(const mpBuf_t *bf);
 //mpBuf_t * mp_get_next_buffer(const mpBuf_t *bf);
-#define mp_get_prev_buffer(b) ((mpBuf_t *)(b->pv))	// use the macro instead
-#define mp_get_next_buffer(b) ((mpBuf_t *)(b->nx))
-
-void mp_clear_buffer(mpBuf_t *bf);
-void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp);
-
-// plan_line.c functions
-float mp_get_runtime_velocity(void);
-float mp_get_runtime_work_position(uint8_t axis);
-float mp_get_runtime_absolute_position(uint8_t axis);
-void mp_set_runtime_work_offset(float offset[]);
-void mp_zero_segment_velocity(void);
-uint8_t mp_get_runtime_busy(void);
+#define mp_get_prev_buffer(b) ((mpBuf_t *)(b->pv))	// use the macro instead
+#define mp_get_next_buffer(b) ((mpBuf_t *)(b->nx))
+
+void mp_clear_buffer(mpBuf_t *bf);
+void mp_copy_buffer(mpBuf_t *bf, const mpBuf_t *bp);
+
+// plan_line.c functions
+float mp_get_runtime_velocity(void);
+float mp_get_runtime_work_position(uint8_t axis);
+float mp_get_runtime_absolute_position(uint8_t axis);
+void mp_set_runtime_work_offset(float offset[]);
+void mp_zero_segment_velocity(void);
+uint8_t mp_get_runtime_busy(void);
 float* mp_get_planner_position_vector(void);
-
+
 // plan_zoid.c functions
 void mp_calculate_trapezoid(mpBuf_t *bf);
+#ifdef __PV_TABLE
+float mp_pow23(float x);
+#endif
 float mp_get_target_length(const float Vi, const float Vf, const mpBuf_t *bf);
 float mp_get_target_velocity(const float Vi, const float L, const mpBuf_t *bf);
-
-// plan_exec.c functions
-stat_t mp_exec_move(void);
-stat_t mp_exec_aline(mpBuf_t *bf);
-/*
-#ifdef __cplusplus
-}
-#endif
-*/
-#endif	// End of include Guard: PLANNER_H_ONCE
+
+// plan_exec.c functions
+stat_t mp_exec_move(void);
+stat_t mp_exec_aline(mpBuf_t *bf);
+
+#ifdef __VELOCITY_JOG
+void mp_jog_start(uint8_t axis, float direction, float velocity, float limit_pos);
+uint8_t mp_jog_to(uint8_t axis, float velocity, float target_pos);
+uint8_t mp_jog_extend(uint8_t axis, float limit_pos);
+void mp_jog_stop(void);
+uint8_t mp_jog_active(void);
+#endif
+
+#ifdef __ADAPTIVE_SEGMENTS
+stat_t mp_set_sgl(nvObj_t *nv);
+stat_t mp_set_sgh(nvObj_t *nv);
+#ifdef __TEXT_MODE
+	void mp_print_sgl(nvObj_t *nv);
+#ifdef __INPUT_SHAPER
+	void mp_print_shm(nvObj_t *nv);
+#endif
+	void mp_print_sgh(nvObj_t *nv);
+#ifdef __START_GATE
+	void mp_print_pst(nvObj_t *nv);
+#endif
+#ifdef __TRAP_PLAN
+	void mp_print_apm(nvObj_t *nv);
+	void mp_print_amx(nvObj_t *nv);
+#endif
+#else
+	#define mp_print_sgl tx_print_stub
+#ifdef __INPUT_SHAPER
+	#define mp_print_shm tx_print_stub
+#endif
+	#define mp_print_sgh tx_print_stub
+#ifdef __START_GATE
+	#define mp_print_pst tx_print_stub
+#endif
+#ifdef __TRAP_PLAN
+	#define mp_print_apm tx_print_stub
+	#define mp_print_amx tx_print_stub
+#endif
+#endif // __TEXT_MODE
+#endif // __ADAPTIVE_SEGMENTS
+/*
+#ifdef __cplusplus
+}
+#endif
+*/
+#endif	// End of include Guard: PLANNER_H_ONCE
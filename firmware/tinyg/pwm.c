@@ -36,14 +36,22 @@
 #include <avr/interrupt.h>
 #endif
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 /***** PWM defines, structures and memory allocation *****/
 
 pwmSingleton_t pwm;
 
+#ifdef __PWM_DUTY_TABLE
+static struct pwmDutyTable {			// speed-to-compare-value lookup - see pwm_rebuild_duty_table()
+	float speed_lo[2];					// lower speed bound per direction [PWM_CW, PWM_CCW]
+	float speed_to_index[2];			// scales (speed - speed_lo) to a table index
+	uint16_t compare[2][PWM_DUTY_TABLE_SIZE+1]; // precomputed timer compare (CCB) values
+} tab;									// starts zeroed, so reads duty-off until first rebuild
+#endif
+
 // defines common to all PWM channels
 //#define PWM_TIMER_TYPE	TC1_struct	// PWM uses TC1's
 #define PWM_TIMER_t	TC1_t				// PWM uses TC1's
@@ -169,14 +177,17 @@ stat_t pwm_set_freq(uint8_t chan, float freq)
 	}
 #endif // __AVR
 
-#ifdef __ARM
-	if (chan == PWM_1) {
-		spindle_pwm_pin.setFrequency(freq);
-	} else if (chan == PWM_2) {
-		secondary_pwm_pin.setFrequency(freq);
-	}
-#endif // __ARM
+#ifdef __ARM
+	if (chan == PWM_1) {
+		spindle_pwm_pin.setFrequency(freq);
+	} else if (chan == PWM_2) {
+		secondary_pwm_pin.setFrequency(freq);
+	}
+#endif // __ARM
 
+#ifdef __PWM_DUTY_TABLE
+	pwm_rebuild_duty_table(chan);		// the period changed, so the table is stale
+#endif
 	return (STAT_OK);
 }
 
@@ -205,24 +216,83 @@ stat_t pwm_set_duty(uint8_t chan, float duty)
 	pwm.p[chan].timer->CCB = (uint16_t)(period_scalar * duty) + 1;
 	#endif // __AVR
 
-	#ifdef __ARM
-	if (chan == PWM_1) {
-		spindle_pwm_pin = duty;
-	} else if (chan == PWM_2) {
-		secondary_pwm_pin = duty;
-	}
-	#endif // __ARM
+	#ifdef __ARM
+	if (chan == PWM_1) {
+		spindle_pwm_pin = duty;
+	} else if (chan == PWM_2) {
+		secondary_pwm_pin = duty;
+	}
+	#endif // __ARM
 
 	return (STAT_OK);
 }
 
+#ifdef __PWM_DUTY_TABLE
+/*
+ * pwm_rebuild_duty_table() - precompute the speed-to-compare-value table
+ * pwm_set_duty_for_speed() - set duty cycle for a spindle speed via the table
+ *
+ *	The table maps spindle speed directly to the timer compare value, so a
+ *	per-move speed update is one multiply, a table read and a register write -
+ *	cheap enough to call from the load phase or an interrupt callback. The
+ *	table only goes stale when the timer period changes (pwm_set_freq) or a
+ *	P1 config value changes (pwm_set_cfg), and is rebuilt from those paths.
+ *
+ *	Out-of-range speeds clamp to the table ends, preserving the speed_lo/hi
+ *	clamping of the computed path. Only PWM_1 is tabled - it's the spindle
+ *	channel, and the table costs SRAM.
+ */
+void pwm_rebuild_duty_table(uint8_t chan)
+{
+	if (chan != PWM_1) { return;}
+#ifdef __AVR
+	float period = pwm.p[chan].timer->PER;
+	for (uint8_t dir=PWM_CW; dir<=PWM_CCW; dir++) {
+		float speed_lo = (dir == PWM_CW) ? pwm.c[chan].cw_speed_lo : pwm.c[chan].ccw_speed_lo;
+		float speed_hi = (dir == PWM_CW) ? pwm.c[chan].cw_speed_hi : pwm.c[chan].ccw_speed_hi;
+		float phase_lo = (dir == PWM_CW) ? pwm.c[chan].cw_phase_lo : pwm.c[chan].ccw_phase_lo;
+		float phase_hi = (dir == PWM_CW) ? pwm.c[chan].cw_phase_hi : pwm.c[chan].ccw_phase_hi;
+		tab.speed_lo[dir] = speed_lo;
+		tab.speed_to_index[dir] = (speed_hi > speed_lo) ? (PWM_DUTY_TABLE_SIZE / (speed_hi - speed_lo)) : 0;
+		for (uint8_t i=0; i<=PWM_DUTY_TABLE_SIZE; i++) {
+			float phase = phase_lo + (((phase_hi - phase_lo) * i) / PWM_DUTY_TABLE_SIZE);
+			tab.compare[dir][i] = (uint16_t)(period * phase) + 1;	// same math as pwm_set_duty()
+		}
+	}
+#endif // __AVR
+}
+
+stat_t pwm_set_duty_for_speed(uint8_t chan, uint8_t direction, float speed)
+{
+	if (chan != PWM_1) { return (STAT_NO_SUCH_DEVICE);}
+#ifdef __AVR
+	float index = (speed - tab.speed_lo[direction]) * tab.speed_to_index[direction];
+	if (index < 0) { index = 0;}
+	if (index > PWM_DUTY_TABLE_SIZE) { index = PWM_DUTY_TABLE_SIZE;}
+	pwm.p[chan].timer->CCB = tab.compare[direction][(uint8_t)index];
+#endif // __AVR
+	return (STAT_OK);
+}
+#endif // __PWM_DUTY_TABLE
 
 /***********************************************************************************
  * CONFIGURATION AND INTERFACE FUNCTIONS
  * Functions to get and set variables from the cfgArray table
  ***********************************************************************************/
 
+#ifdef __PWM_DUTY_TABLE
+/*
+ * pwm_set_cfg() - set a P1 config value and rebuild the duty table from it
+ */
+stat_t pwm_set_cfg(nvObj_t *nv)
+{
+	stat_t status = set_flt(nv);
+	pwm_rebuild_duty_table(PWM_1);
+	return (status);
+}
+#else
 // none
+#endif
 
 
 /***********************************************************************************
@@ -256,6 +326,6 @@ void pwm_print_p1pof(nvObj_t *nv) { text_print_flt(nv, fmt_p1pof);}
 
 #endif //__TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
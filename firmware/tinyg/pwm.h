@@ -28,9 +28,9 @@
 #ifndef PWM_H_ONCE
 #define PWM_H_ONCE
 
-#ifdef __cplusplus
-extern "C"{
-#endif
+#ifdef __cplusplus
+extern "C"{
+#endif
 
 typedef struct pwmConfigChannel {
 	float frequency;				// base frequency for PWM driver, in Hz
@@ -59,12 +59,26 @@ typedef struct pwmSingleton {
 
 extern pwmSingleton_t pwm;
 
+#ifdef __PWM_DUTY_TABLE
+#define PWM_DUTY_TABLE_SIZE 64			// speed steps per direction (+1 entry for the top end)
+#define PWM_CW	0						// duty table direction indices
+#define PWM_CCW	1
+#endif
+
 /*** function prototypes ***/
 
 void pwm_init(void);
 stat_t pwm_set_freq(uint8_t channel, float freq);
 stat_t pwm_set_duty(uint8_t channel, float duty);
 
+#ifdef __PWM_DUTY_TABLE
+void pwm_rebuild_duty_table(uint8_t channel);
+stat_t pwm_set_duty_for_speed(uint8_t channel, uint8_t direction, float speed);
+stat_t pwm_set_cfg(nvObj_t *nv);
+#else
+#define pwm_set_cfg set_flt				// P1 values revert to plain config writes
+#endif
+
 #ifdef __TEXT_MODE
 
 	void pwm_print_p1frq(nvObj_t *nv);
@@ -93,8 +107,8 @@ stat_t pwm_set_duty(uint8_t channel, float duty);
 
 #endif // __TEXT_MODE
 
-#ifdef __cplusplus
-}
-#endif
+#ifdef __cplusplus
+}
+#endif
 
-#endif	// End of include guard: PWM_H_ONCE
+#endif	// End of include guard: PWM_H_ONCE
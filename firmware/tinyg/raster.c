@@ -0,0 +1,176 @@
+/*
+ * raster.c - laser raster engraving mode
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Operation
+ *
+ *	Raster mode engraves a packed 1-bit scanline during a single constant-speed
+ *	traverse. The planner path caps power changes at a few hundred blocks per
+ *	second; here the DDA ISR writes the PWM compare register per step position
+ *	(raster_dda_tick in raster.h), so pixel rates track the step rate itself.
+ *
+ *	Scanlines ride the binary block channel (see gcode_binary.c for framing):
+ *
+ *	  opcode 0x02	append packed pixel bytes to the staging buffer
+ *	  opcode 0x03	arm the scanline - payload is the pixel pitch in mm
+ *					as a packed little-endian float
+ *
+ *	The arm is queued through the planner like a spindle command, so it
+ *	executes in block order - typically between the G0 that positions the
+ *	head and the G1 that traverses the line. At exec time the current PWM
+ *	compare value is latched as the "on" power (set speed with S/M3 first)
+ *	and phase_off as the "off" power, and pixel 0 is driven immediately.
+ *	Steps of RASTER_MOTOR then clock out the scanline; when it is exhausted
+ *	the spindle duty is restored and the buffer clears for the next line.
+ *
+ *	Pixels consume in buffer order regardless of travel direction - for
+ *	bidirectional rastering the host streams every other scanline reversed.
+ *	Spindle off/stop disarms (see spindle.c), as does reset.
+ */
+
+#include "tinyg.h"			// #1
+#include "config.h"			// #2
+#include "hardware.h"
+#include "stepper.h"
+#include "planner.h"
+#include "pwm.h"
+#include "gcode_binary.h"
+#include "raster.h"
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+rsSingleton_t rs;
+
+#ifdef __RASTER
+
+static void _exec_raster_arm(float *value, float *flag);
+
+/*
+ * raster_init() - clear raster state at startup / reset
+ */
+void raster_init()
+{
+	memset(&rs, 0, sizeof(rsSingleton_t));
+}
+
+/*
+ * raster_disarm() - stop modulating and drop any staged scanline
+ */
+void raster_disarm()
+{
+	rs.armed = false;
+	rs.length_px = 0;
+}
+
+/*
+ * raster_binary_block() - dispatch a raster opcode from the binary channel
+ *
+ *	Entered from gc_binary_parser() with the checksum already verified.
+ *	payload/len exclude the opcode and checksum bytes.
+ */
+stat_t raster_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len)
+{
+	if (opcode == GC_BINARY_RASTER_DATA) {
+		if (rs.armed) { return (STAT_COMMAND_NOT_ACCEPTED);}	// scanline is still engraving
+		if (((rs.length_px >> 3) + len) > RASTER_BUFFER_SIZE) {
+			return (STAT_INPUT_EXCEEDS_MAX_LENGTH);
+		}
+		memcpy(&rs.buffer[rs.length_px >> 3], payload, len);
+		rs.length_px += (len << 3);
+		return (STAT_OK);
+	}
+	if (opcode == GC_BINARY_RASTER_ARM) {
+		float pitch;
+		if (len != sizeof(float)) { return (STAT_GCODE_GENERIC_INPUT_ERROR);}
+		if (rs.armed) { return (STAT_COMMAND_NOT_ACCEPTED);}
+		if (rs.length_px == 0) { return (STAT_COMMAND_NOT_ACCEPTED);}	// nothing staged
+		memcpy(&pitch, payload, sizeof(float));
+		if (pitch <= 0) { return (STAT_INPUT_LESS_THAN_MIN_VALUE);}
+
+		float value[AXES] = { pitch, 0,0,0,0,0 };
+		mp_queue_command(_exec_raster_arm, value, value);	// arm in block order
+		return (STAT_OK);
+	}
+	return (STAT_GCODE_COMMAND_UNSUPPORTED);
+}
+
+/*
+ * raster_pixel_advance() - cross a pixel boundary; called from the DDA ISR
+ *
+ *	Entered from RASTER_DDA_TICK() (raster.h) when the step accumulator
+ *	reaches the pixel pitch. The while() absorbs pitches finer than one step.
+ */
+void raster_pixel_advance()
+{
+	while (rs.step_accum >= rs.steps_per_pixel) {
+		rs.step_accum -= rs.steps_per_pixel;
+		if (++rs.pixel >= rs.length_px) {			// scanline complete
+			rs.armed = false;
+			rs.length_px = 0;						// consume the scanline
+			TIMER_PWM1.CCB = rs.on_compare;			// restore the running spindle duty
+			return;
+		}
+	}
+	uint16_t px = rs.pixel;
+	if (rs.buffer[px >> 3] & (0x80 >> (px & 0x07))) {
+		TIMER_PWM1.CCB = rs.on_compare;
+	} else {
+		TIMER_PWM1.CCB = rs.off_compare;
+	}
+}
+
+/*
+ * _exec_raster_arm() - arm the staged scanline (planner exec callback)
+ *
+ *	Latches the on/off compare values and starts modulation at pixel 0.
+ *	Runs at interrupt level between the neighboring moves, so the laser
+ *	never carries a pixel's power into the wrong block.
+ */
+static void _exec_raster_arm(float *value, float *flag)
+{
+	float steps_per_pixel = value[0] * st_cfg.mot[RASTER_MOTOR].steps_per_unit;
+	if (steps_per_pixel < 0) { steps_per_pixel = -steps_per_pixel;}
+
+	rs.steps_per_pixel = (uint32_t)(steps_per_pixel * 256);	// to 1/256 step fixed point
+	if (rs.steps_per_pixel == 0) { rs.steps_per_pixel = 1;}
+	rs.pixel = 0;
+	rs.step_accum = 0;
+	rs.on_compare = TIMER_PWM1.CCB;							// current spindle duty is "on" power
+	rs.off_compare = (uint16_t)(TIMER_PWM1.PER * pwm.c[PWM_1].phase_off) + 1; // same math as pwm_set_duty()
+	if (rs.buffer[0] & 0x80) {								// drive pixel 0 now
+		TIMER_PWM1.CCB = rs.on_compare;
+	} else {
+		TIMER_PWM1.CCB = rs.off_compare;
+	}
+	rs.armed = true;
+}
+
+#endif // __RASTER
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+/*
+ * raster.h - laser raster engraving mode
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef RASTER_H_ONCE
+#define RASTER_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define RASTER_MOTOR MOTOR_1			// motor whose steps advance the scanline (the X gantry)
+#define RASTER_BUFFER_SIZE 250			// packed scanline bytes, 8 pixels per byte (2000 pixels)
+
+typedef struct rsSingleton {			// see raster.c for operation
+	volatile uint8_t armed;				// true while a scanline is consuming steps
+	uint16_t length_px;					// pixels staged / armed
+	volatile uint16_t pixel;			// current pixel index
+	uint32_t steps_per_pixel;			// pixel pitch in 1/256 step fixed point
+	volatile uint32_t step_accum;		// step accumulator, same fixed point
+	uint16_t on_compare;				// PWM compare value for lit pixels
+	uint16_t off_compare;				// PWM compare value for dark pixels
+	uint8_t buffer[RASTER_BUFFER_SIZE];	// packed scanline, MSB-first within each byte
+} rsSingleton_t;
+
+extern rsSingleton_t rs;
+
+/*** function prototypes ***/
+
+#ifdef __RASTER
+
+void raster_init(void);
+void raster_disarm(void);
+void raster_pixel_advance(void);
+stat_t raster_binary_block(uint8_t opcode, uint8_t *payload, uint8_t len);
+
+/*
+ * RASTER_DDA_TICK() - per-step scanline clocking; placed in the DDA ISR
+ *
+ *	Expanded on every step of RASTER_MOTOR, in the style of INCREMENT_ENCODER
+ *	(encoder.h). The disarmed cost is one test; the per-step cost while armed
+ *	is a fixed point add and compare. Pixel boundary work - picking the bit
+ *	and writing the PWM compare register - happens in raster_pixel_advance().
+ */
+#define RASTER_DDA_TICK() if ((rs.armed) && ((rs.step_accum += 256) >= rs.steps_per_pixel)) { raster_pixel_advance();}
+
+#endif // __RASTER
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// End of include guard: RASTER_H_ONCE
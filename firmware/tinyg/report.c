@@ -24,7 +24,7 @@
  * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
-
+
 #include "tinyg.h"
 #include "config.h"
 #include "report.h"
@@ -33,6 +33,9 @@
 #include "text_parser.h"
 #include "planner.h"
 #include "settings.h"
+#include "hardware.h"
+#include "switch.h"
+#include "diagnostics.h"
 #include "util.h"
 #include "xio.h"
 
@@ -45,6 +48,15 @@ extern "C"{
 srSingleton_t sr;
 qrSingleton_t qr;
 rxSingleton_t rx;
+#ifdef __JOB_STATS
+jobStatsSingleton_t jst;
+#endif
+#ifdef __PLAN_EXPORT
+pexSingleton_t pex;
+#endif
+#ifdef __CONFIG_REPORT
+crSingleton_t cr;
+#endif
 
 /**** Exception Reports ************************************************************
  * rpt_exception() - generate an exception message - always in JSON format
@@ -54,19 +66,77 @@ rxSingleton_t rx;
  * WARNING: Do not call this function from MED or HI interrupts (LO is OK)
  *			or there is a potential for deadlock in the TX buffer.
  */
+#ifdef __ER_RING
+/*
+ *	__ER_RING replaces formatting-at-fault-time with a ring of compact records:
+ *	status code, systick timestamp and the active Gcode line number. Capture is
+ *	a handful of stores with interrupts briefly masked to claim the slot, so it
+ *	costs microseconds and cannot be dropped by a congested TX buffer. The
+ *	message text stays interned in PROGMEM (the status message table) and is
+ *	only expanded when the host fetches the ring with $erd. The ring holds the
+ *	last ER_RING_LEN exceptions and is not cleared by reading, so a follow-up
+ *	query sees the same history.
+ */
+typedef struct erRecord {
+	uint32_t tick;							// SysTickTimer value (ms) at capture
+	uint32_t linenum;						// active Gcode line number at capture
+	uint8_t status;							// stat_t code, 0 = empty slot
+} erRecord_t;
+
+static volatile erRecord_t er_ring[ER_RING_LEN];
+static volatile uint8_t er_ring_next;
+
+stat_t rpt_exception(uint8_t status)
+{
+	if (status != STAT_OK) {	// makes it possible to call exception reports w/o checking status value
+		uint8_t sreg = SREG;
+		cli();									// claim a slot; fill it outside the critical section
+		volatile erRecord_t *er = &er_ring[er_ring_next];
+		er_ring_next = (er_ring_next + 1) & (ER_RING_LEN-1);
+		SREG = sreg;
+		er->tick = SysTickTimer_getValue();
+		er->linenum = cm_get_linenum(ACTIVE_MODEL);
+		er->status = status;
+	}
+	return (status);			// makes it possible to inline, e.g: return(rpt_exception(status));
+}
+
+/*
+ * rpt_er_get() - $erd - print the exception ring, oldest first; returns record count
+ *
+ *	Always strict JSON - hosts log these, humans don't type them.
+ */
+stat_t rpt_er_get(nvObj_t *nv)
+{
+	uint8_t records = 0;
+	for (uint8_t i=0; i<ER_RING_LEN; i++) {
+		volatile erRecord_t *er = &er_ring[(uint8_t)(er_ring_next + i) & (ER_RING_LEN-1)];
+		if (er->status == STAT_OK) { continue;}
+		fprintf_P(stderr, PSTR("{\"erd\":{\"t\":%lu,\"st\":%u,\"n\":%lu,\"msg\":\"%s\"}}\n"),
+			(unsigned long)er->tick, er->status, (unsigned long)er->linenum,
+			get_status_message(er->status));
+		records++;
+	}
+	nv_store_int(nv, records);
+	return (STAT_OK);
+}
+
+#else // not __ER_RING
+
 stat_t rpt_exception(uint8_t status)
 {
 	if (status != STAT_OK) {	// makes it possible to call exception reports w/o checking status value
 		if (js.json_syntax == JSON_SYNTAX_RELAXED) {
-			printf_P(PSTR("{er:{fb:%0.2f,st:%d,msg:\"%s\"}}\n"),
+			fprintf_P(REPORT_STREAM, PSTR("{er:{fb:%0.2f,st:%d,msg:\"%s\"}}\n"),
 				TINYG_FIRMWARE_BUILD, status, get_status_message(status));
 		} else {
-			printf_P(PSTR("{\"er\":{\"fb\":%0.2f,\"st\":%d,\"msg\":\"%s\"}}\n"),
+			fprintf_P(REPORT_STREAM, PSTR("{\"er\":{\"fb\":%0.2f,\"st\":%d,\"msg\":\"%s\"}}\n"),
 				TINYG_FIRMWARE_BUILD, status, get_status_message(status));
 		}
 	}
 	return (status);			// makes it possible to inline, e.g: return(rpt_exception(status));
 }
+#endif // __ER_RING
 
 /*
  * rpt_er()	- send a bogus exception report for testing purposes (it's not real)
@@ -85,7 +155,7 @@ stat_t rpt_er(nvObj_t *nv)
  */
 
 //void _startup_helper(stat_t status, const char_t *msg)
-void _startup_helper(stat_t status, const char *msg)
+void _startup_helper(stat_t status, const char *msg)	// msg is a RAM string
 {
 #ifndef __SUPPRESS_STARTUP_MESSAGES
 	js.json_footer_depth = JSON_FOOTER_DEPTH;	//++++ temporary until changeover is complete
@@ -95,24 +165,28 @@ void _startup_helper(stat_t status, const char *msg)
 	nv_add_object((const char_t *)"hp");		// hardware platform
 	nv_add_object((const char_t *)"hv");		// hardware version
 	nv_add_object((const char_t *)"id");		// hardware ID
-	nv_add_string((const char_t *)"msg", pstr2str(msg));	// startup message
+	nv_add_string((const char_t *)"msg", (const char_t *)msg);	// startup message
 	json_print_response(status);
 #endif
 }
 
 void rpt_print_initializing_message(void)
 {
-	_startup_helper(STAT_INITIALIZING, PSTR(INIT_MESSAGE));
+	_startup_helper(STAT_INITIALIZING, pstr2str(PSTR(INIT_MESSAGE)));
 }
 
 void rpt_print_loading_configs_message(void)
 {
-	_startup_helper(STAT_INITIALIZING, PSTR("Loading configs from EEPROM"));
+	_startup_helper(STAT_INITIALIZING, pstr2str(PSTR("Loading configs from EEPROM")));
 }
 
 void rpt_print_system_ready_message(void)
 {
-	_startup_helper(STAT_OK, PSTR("SYSTEM READY"));
+	char *msg = pstr2str(PSTR("SYSTEM READY"));
+#ifdef __BOOT_TIME
+	sprintf_P(msg + strlen(msg), PSTR(" (%lu ms)"), hw_boot_time_ms());	// reset-to-ready time
+#endif
+	_startup_helper(STAT_OK, msg);
 	if (cfg.comm_mode == TEXT_MODE)
         text_response(STAT_OK, (char_t *)"");   // prompt
 }
@@ -161,6 +235,12 @@ void rpt_print_system_ready_message(void)
  */
 static stat_t _populate_unfiltered_status_report(void);
 static uint8_t _populate_filtered_status_report(void);
+#ifdef __SR_COMPILED
+static void _sr_compile(void);
+#endif
+#ifdef __SR_BINARY
+static stat_t _send_binary_status_report(void);
+#endif
 
 uint8_t _is_stat(nvObj_t *nv)
 {
@@ -184,6 +264,9 @@ void sr_init_status_report()
 	char_t sr_defaults[NV_STATUS_REPORT_LEN][TOKEN_LEN+1] = { STATUS_REPORT_DEFAULTS };	// see settings.h
 	nv->index = nv_get_index((const char_t *)"", (const char_t *)"se00");	// set first SR persistence index
 	sr.stat_index = 0;
+#ifdef __SR_DEADBAND
+	memset(sr.field_deadband, 0, sizeof(sr.field_deadband));	// defaults report exact changes
+#endif
 
 	for (uint8_t i=0; i < NV_STATUS_REPORT_LEN ; i++) {
 		if (sr_defaults[i][0] == NUL) break;				// quit on first blank array entry
@@ -199,7 +282,35 @@ void sr_init_status_report()
 		nv_persist(nv);										// conditionally persist - automatic by nv_persist()
 		nv->index++;										// increment SR NVM index
 	}
+#ifdef __SR_COMPILED
+	_sr_compile();										// rebuild the compiled field cache
+#endif
+}
+
+#ifdef __SR_COMPILED
+/*
+ * _sr_compile() - precompute the status report field layout
+ *
+ *	Runs whenever the SR list changes (init or $sr set). Resolves each field's
+ *	stripped group and token once and stores the flattened key text and the
+ *	get() binding, so report population does not touch the PROGMEM config
+ *	strings or re-run the group-strip logic on every report.
+ */
+static void _sr_compile()
+{
+	nvObj_t *nv = nv_reset_nv_list();		// scratch use of the body - not emitted
+	sr.field_count = 0;
+
+	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+		if ((nv->index = sr.status_report_list[i]) == 0) { break;}
+		nv_get_nvObj(nv);									// resolves stripped group & token
+		strcpy(sr.field_key[i], nv->group);					// flatten group+token into the key
+		strcat(sr.field_key[i], nv->token);
+		sr.field_get[i] = (fptrCmd)GET_TABLE_WORD(get);
+		sr.field_count++;
+	}
 }
+#endif // __SR_COMPILED
 
 /*
  * sr_set_status_report() - interpret an SR setup string and return current report
@@ -215,6 +326,11 @@ stat_t sr_set_status_report(nvObj_t *nv)
 	memset(status_report_list, 0, sizeof(status_report_list));
 	index_t sr_start = nv_get_index((const char_t *)"",(const char_t *)"se00");// set first SR persistence index
 
+#ifdef __SR_DEADBAND
+	float deadband_list[NV_STATUS_REPORT_LEN];
+	memset(deadband_list, 0, sizeof(deadband_list));
+#endif
+
 	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
 		if (((nv = nv->nx) == NULL) || (nv->valuetype == TYPE_EMPTY)) break;
 		if ((nv->valuetype == TYPE_BOOL) && (fp_TRUE(nv->value))) {
@@ -223,6 +339,15 @@ stat_t sr_set_status_report(nvObj_t *nv)
 			nv->index = sr_start + i;						// index of the SR persistence location
 			nv_persist(nv);
 			elements++;
+#ifdef __SR_DEADBAND
+		} else if ((nv->valuetype == TYPE_FLOAT) && (nv->value > 0)) {
+			status_report_list[i] = nv->index;				// a positive float enrolls the field...
+			deadband_list[i] = nv->value;					//...with a change deadband (not persisted)
+			nv->value = nv->index;							// persist the index as the value
+			nv->index = sr_start + i;						// index of the SR persistence location
+			nv_persist(nv);
+			elements++;
+#endif
 		} else {
 			return (STAT_UNRECOGNIZED_NAME);
 		}
@@ -230,21 +355,49 @@ stat_t sr_set_status_report(nvObj_t *nv)
 	if (elements == 0)
         return (STAT_INVALID_OR_MALFORMED_COMMAND);
 	memcpy(sr.status_report_list, status_report_list, sizeof(status_report_list));
+#ifdef __SR_DEADBAND
+	memcpy(sr.field_deadband, deadband_list, sizeof(deadband_list));
+#endif
+#ifdef __SR_COMPILED
+	_sr_compile();										// rebuild the compiled field cache
+#endif
 	return(_populate_unfiltered_status_report());			// return current values
 }
 
 /*
  * sr_request_status_report()	- request a status report to run after minimum interval
+ *
+ *	__SR_ADAPTIVE varies the timed interval with machine activity: reports run
+ *	at a quarter interval while the runtime is accelerating or decelerating
+ *	(the data operators actually watch), at the configured interval during
+ *	cruise, and decay up to 8x the interval while consecutive filtered
+ *	reports find nothing changed. State transitions (hold entry, stop) are
+ *	already reported immediately via SR_IMMEDIATE_REQUEST callers, and
+ *	cm_set_motion_state() now requests one on every motion state change.
  * sr_status_report_callback()	- main loop callback to send a report if one is ready
  *
  *	Status reports can be request from a number of sources including:
  *	  - direct request from command line in the form of ? or {"sr:""}
  *	  - timed requests during machining cycle
  *	  - filtered request after each Gcode block
- *
+ *
  *	Status reports are generally returned with minimal delay (from the controller callback),
  *	but will not be provided more frequently than the status report interval
  */
+#ifdef __SR_ADAPTIVE
+static uint32_t _adaptive_interval(void)
+{
+	if (cm.motion_state == MOTION_RUN) {
+		sr.quiet_reports = 0;
+		if (mr.section != SECTION_BODY) {			// accelerating or decelerating - sample fast
+			return (max(sr.status_report_interval >> 2, STATUS_REPORT_MIN_MS));
+		}
+		return (sr.status_report_interval);			// cruise - configured rate
+	}
+	return (sr.status_report_interval << min(sr.quiet_reports, 3));	// quiesce while idle
+}
+#endif
+
 stat_t sr_request_status_report(uint8_t request_type)
 {
 #ifdef __ARM
@@ -252,7 +405,11 @@ stat_t sr_request_status_report(uint8_t request_type)
 		sr.status_report_systick = SysTickTimer.getValue();
 	}
 	if ((request_type == SR_TIMED_REQUEST) && (sr.status_report_requested == false)) {
+#ifdef __SR_ADAPTIVE
+		sr.status_report_systick = SysTickTimer.getValue() + _adaptive_interval();
+#else
 		sr.status_report_systick = SysTickTimer.getValue() + sr.status_report_interval;
+#endif
 	}
 #endif
 #ifdef __AVR
@@ -260,7 +417,11 @@ stat_t sr_request_status_report(uint8_t request_type)
 		sr.status_report_systick = SysTickTimer_getValue();
 	}
 	if ((request_type == SR_TIMED_REQUEST) && (sr.status_report_requested == false)) {
+#ifdef __SR_ADAPTIVE
+		sr.status_report_systick = SysTickTimer_getValue() + _adaptive_interval();
+#else
 		sr.status_report_systick = SysTickTimer_getValue() + sr.status_report_interval;
+#endif
 	}
 #endif
 	sr.status_report_requested = true;
@@ -288,16 +449,41 @@ stat_t sr_status_report_callback() 		// called by controller dispatcher
         return (STAT_NOOP);
 #endif
 
+#ifdef __REPORT_COALESCE
+	if (xio_get_usb_tx_free() < REPORT_COALESCE_TX_MIN) {	// link congested - hold the request;
+		return (STAT_OK);					// a held report serializes the latest state when room opens
+	}
+#endif
 	sr.status_report_requested = false;		// disable reports until requested again
 
+#ifdef __SR_BINARY
+	if (sr.binary_report == true) {
+		return (_send_binary_status_report());
+	}
+#endif
+#ifdef __NV_ARENAS
+	uint8_t arena = nv_select_arena(NV_ARENA_REPORT);	// don't disturb a command list in flight
+#endif
 	if (sr.status_report_verbosity == SR_VERBOSE) {
 		_populate_unfiltered_status_report();
 	} else {
 		if (_populate_filtered_status_report() == false) {	// no new data
+#ifdef __SR_ADAPTIVE
+			if (sr.quiet_reports < 3) { sr.quiet_reports++;}	// decay the idle report rate
+#endif
+#ifdef __NV_ARENAS
+			nv_select_arena(arena);
+#endif
 			return (STAT_OK);
 		}
+#ifdef __SR_ADAPTIVE
+		sr.quiet_reports = 0;							// something changed - back to full rate
+#endif
 	}
 	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
+#ifdef __NV_ARENAS
+	nv_select_arena(arena);
+#endif
 	return (STAT_OK);
 }
 
@@ -306,12 +492,18 @@ stat_t sr_status_report_callback() 		// called by controller dispatcher
  */
 stat_t sr_run_text_status_report()
 {
+#ifdef __NV_ARENAS
+	uint8_t arena = nv_select_arena(NV_ARENA_REPORT);
+#endif
 	_populate_unfiltered_status_report();
 	nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_RESPONSE_FORMAT);
+#ifdef __NV_ARENAS
+	nv_select_arena(arena);
+#endif
 	return (STAT_OK);
 }
 
-/*
+/*
  * _populate_unfiltered_status_report() - populate nvObj body with status values
  *
  *	Designed to be run as a response; i.e. have a "r" header and a footer.
@@ -319,7 +511,9 @@ stat_t sr_run_text_status_report()
 static stat_t _populate_unfiltered_status_report()
 {
 	const char_t sr_str[] = "sr";
+#ifndef __SR_COMPILED
 	char_t tmp[TOKEN_LEN+1];
+#endif
 	nvObj_t *nv = nv_reset_nv_list();		// sets *nv to the start of the body
 
 	nv->valuetype = TYPE_PARENT; 			// setup the parent object (no length checking required)
@@ -329,12 +523,16 @@ static stat_t _populate_unfiltered_status_report()
 
 	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
 		if ((nv->index = sr.status_report_list[i]) == 0) { break;}
+#ifdef __SR_COMPILED
+		sr.field_get[i](nv);			// populate the value through the compiled binding
+		strcpy(nv->token, sr.field_key[i]);	// pre-flattened key - no PROGMEM string traffic
+#else
 		nv_get_nvObj(nv);
 
 		strcpy(tmp, nv->group);			// flatten out groups - WARNING - you cannot use strncpy here...
 		strcat(tmp, nv->token);
 		strcpy(nv->token, tmp);			//...or here.
-
+#endif
 		if ((nv = nv->nx) == NULL)
 			return (cm_hard_alarm(STAT_BUFFER_FULL_FATAL));	// should never be NULL unless SR length exceeds available buffer array
 	}
@@ -346,7 +544,7 @@ static stat_t _populate_unfiltered_status_report()
  *
  *	Designed to be displayed as a JSON object; i;e; no footer or header
  *	Returns 'true' if the report has new data, 'false' if there is nothing to report.
- *
+ *
  *	NOTE: Unlike sr_populate_unfiltered_status_report(), this function does NOT set
  *	the SR index, which is a relatively expensive operation. In current use this
  *	doesn't matter, but if the caller assumes its set it may lead to a side-effect (bug)
@@ -358,7 +556,9 @@ static uint8_t _populate_filtered_status_report()
 {
 	const char_t sr_str[] = "sr";
 	uint8_t has_data = false;
+#ifndef __SR_COMPILED
 	char_t tmp[TOKEN_LEN+1];
+#endif
 	nvObj_t *nv = nv_reset_nv_list();		// sets nv to the start of the body
 
 	nv->valuetype = TYPE_PARENT; 			// setup the parent object (no need to length check the copy)
@@ -369,10 +569,38 @@ static uint8_t _populate_filtered_status_report()
 	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
 		if ((nv->index = sr.status_report_list[i]) == 0) { break;}
 
+#ifdef __SR_COMPILED
+		sr.field_get[i](nv);			// populate the value through the compiled binding
+#else
 		nv_get_nvObj(nv);
+#endif
 		// do not report values that have not changed...
 		// ...except for stat=3 (STOP), which is an exception
+#ifdef __TYPED_CONFIG
+		// typed integers compare exactly as bit images - no float math per field
+		uint8_t unchanged;
+		if (nv->valuetype == TYPE_INTEGER) {
+			unchanged = (nv->value_int == *(int32_t *)&sr.status_report_value[i]);
+		} else {
+#ifdef __SR_DEADBAND
+			float deadband = (sr.field_deadband[i] > EPSILON) ? sr.field_deadband[i] : EPSILON;
+			unchanged = (fabs(nv->value - sr.status_report_value[i]) < deadband);
+#else
+			unchanged = fp_EQ(nv->value, sr.status_report_value[i]);
+#endif
+		}
+		if (unchanged) {
+#else
+#ifdef __SR_DEADBAND
+		// fields enrolled with a deadband only report once the change from the
+		// last *reported* value exceeds the threshold, so position fields stop
+		// flapping on every segment. Zero deadband preserves fp_EQ behavior.
+		float deadband = (sr.field_deadband[i] > EPSILON) ? sr.field_deadband[i] : EPSILON;
+		if (fabs(nv->value - sr.status_report_value[i]) < deadband) {
+#else
 		if (fp_EQ(nv->value, sr.status_report_value[i])) {
+#endif
+#endif // __TYPED_CONFIG
 //			if (nv->index != sr.stat_index) {
 //				if (fp_EQ(nv->value, COMBINED_PROGRAM_STOP)) {
 					nv->valuetype = TYPE_EMPTY;
@@ -381,10 +609,19 @@ static uint8_t _populate_filtered_status_report()
 //			}
 			// report anything that has changed
 		} else {
+#ifdef __SR_COMPILED
+			strcpy(nv->token, sr.field_key[i]);	// pre-flattened key - no PROGMEM string traffic
+#else
 			strcpy(tmp, nv->group);		// flatten out groups - WARNING - you cannot use strncpy here...
 			strcat(tmp, nv->token);
 			strcpy(nv->token, tmp);		//...or here.
+#endif
+#ifdef __TYPED_CONFIG
+			// store the bit image so typed integers round-trip exactly
+			*(int32_t *)&sr.status_report_value[i] = nv->value_int;
+#else
 			sr.status_report_value[i] = nv->value;
+#endif
 			if ((nv = nv->nx) == NULL) return (false); // should never be NULL unless SR length exceeds available buffer array
 			has_data = true;
 		}
@@ -409,6 +646,71 @@ stat_t sr_set_si(nvObj_t *nv)
 	return(STAT_OK);
 }
 
+#if defined(__SR_BINARY) || defined(__PLAN_EXPORT)
+/*
+ * _crc8() - CRC-8 with polynomial 0x07, no reflection, init 0
+ *
+ *	Check byte shared by the binary frame emitters ($sb status frames and
+ *	$pex planner export records).
+ */
+
+static uint8_t _crc8(const char *buf, uint8_t len)
+{
+	uint8_t crc = 0;
+	for (uint8_t i=0; i<len; i++) {
+		crc ^= (uint8_t)buf[i];
+		for (uint8_t j=0; j<8; j++) {
+			crc = (crc & 0x80) ? ((crc << 1) ^ 0x07) : (crc << 1);
+		}
+	}
+	return (crc);
+}
+#endif
+
+#ifdef __SR_BINARY
+/*
+ * _send_binary_status_report() - emit a packed binary SR frame
+ *
+ *	Frame layout: 0xA5 marker byte, payload length byte (field count * 4),
+ *	packed little-endian floats in $sr list order, CRC8 over the length and
+ *	payload bytes. The field keys are implied by the configured $sr order,
+ *	which a logging host reads once via {"sr":null} before enabling frames.
+ *	One frame is ~6 + 4n bytes and serialization is a straight value copy
+ *	instead of printf-style formatting. Always emits the full (unfiltered)
+ *	list so the layout is fixed for the decoder.
+ *
+ *	NB: frames contain arbitrary byte values, so the host link must not
+ *	interpret XON/XOFF characters while $sb=1 ($ex=2 hardware flow control
+ *	or no flow control).
+ */
+#define SR_BINARY_MARKER ((char)0xA5)
+
+static stat_t _send_binary_status_report()
+{
+	char frame[2 + (NV_STATUS_REPORT_LEN * sizeof(float)) + 1];
+	uint8_t n = 2;
+	nvObj_t nv_local;
+	nvObj_t *nv = &nv_local;
+	memset(nv, 0, sizeof(nvObj_t));			// stack object - not part of the nv list
+
+	for (uint8_t i=0; i<NV_STATUS_REPORT_LEN; i++) {
+		if ((nv->index = sr.status_report_list[i]) == 0) { break;}
+#ifdef __SR_COMPILED
+		sr.field_get[i](nv);				// populate the value through the compiled binding
+#else
+		nv_get_nvObj(nv);
+#endif
+		memcpy(&frame[n], &nv->value, sizeof(float));	// AVR floats are little-endian
+		n += sizeof(float);
+	}
+	frame[0] = SR_BINARY_MARKER;
+	frame[1] = n - 2;						// payload length in bytes
+	frame[n] = _crc8(&frame[1], n - 1);		// CRC covers length + payload
+	fwrite(frame, 1, n + 1, REPORT_STREAM);
+	return (STAT_OK);
+}
+#endif // __SR_BINARY
+
 /*********************
  * TEXT MODE SUPPORT *
  *********************/
@@ -416,10 +718,22 @@ stat_t sr_set_si(nvObj_t *nv)
 
 static const char fmt_si[] PROGMEM = "[si]  status interval%14.0f ms\n";
 static const char fmt_sv[] PROGMEM = "[sv]  status report verbosity%6d [0=off,1=filtered,2=verbose]\n";
+#ifdef __SR_BINARY
+static const char fmt_sb[] PROGMEM = "[sb]  status report binary%9d [0=json,1=binary frames]\n";
+#endif
+#ifdef __PLAN_EXPORT
+static const char fmt_pex[] PROGMEM = "[pex] planner export stream%8d [0=off,1=binary records]\n";
+#endif
 
 void sr_print_sr(nvObj_t *nv) { _populate_unfiltered_status_report();}
 void sr_print_si(nvObj_t *nv) { text_print_flt(nv, fmt_si);}
 void sr_print_sv(nvObj_t *nv) { text_print_ui8(nv, fmt_sv);}
+#ifdef __SR_BINARY
+void sr_print_sb(nvObj_t *nv) { text_print_ui8(nv, fmt_sb);}
+#endif
+#ifdef __PLAN_EXPORT
+void pex_print_pex(nvObj_t *nv) { text_print_ui8(nv, fmt_pex);}
+#endif
 
 #endif // __TEXT_MODE
 
@@ -463,12 +777,21 @@ void qr_request_queue_report(int8_t buffers)
 {
 	// get buffer depth and added/removed count
 	qr.buffers_available = mp_get_planner_buffers_available();
+#ifdef __PLAN_STAGING
+	qr.buffers_available += mp_staging_room();	// report both tiers - this is what the host may stream against
+#endif
 	if (buffers > 0) {
 		qr.buffers_added += buffers;
 	} else {
 		qr.buffers_removed -= buffers;
 	}
-
+#ifdef __JOB_STATS
+	if (jst.job_running == true) {
+		if (buffers < 0) { jst.blocks++;}
+		if (qr.buffers_available < jst.queue_min) { jst.queue_min = qr.buffers_available;}
+	}
+#endif
+
 	// time-throttle requests while generating arcs
 	qr.motion_mode = cm_get_motion_mode(ACTIVE_MODEL);
 	if ((qr.motion_mode == MOTION_MODE_CW_ARC) || (qr.motion_mode == MOTION_MODE_CCW_ARC)) {
@@ -500,29 +823,56 @@ stat_t qr_queue_report_callback() 		// called by controller dispatcher
 	if (qr.queue_report_requested == false)
         return (STAT_NOOP);
 
+#ifdef __REPORT_COALESCE
+	if (xio_get_usb_tx_free() < REPORT_COALESCE_TX_MIN) {	// congested - newer data overwrites in place
+		return (STAT_OK);
+	}
+#endif
 	qr.queue_report_requested = false;
 
+#ifdef __QR_LOOKAHEAD_TIME
+	uint32_t planned_ms = (uint32_t)(mp_get_planned_time() * 60000);	// minutes --> milliseconds
+#endif
+
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(true);		// qr paces the sender - it must not wait behind queued report traffic
+#endif
 	if (cfg.comm_mode == TEXT_MODE) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "qr:%d\n", qr.buffers_available);
+			fprintf(REPORT_STREAM, "qr:%d\n", qr.buffers_available);
 		} else  {
-			fprintf(stderr, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
+#ifdef __QR_LOOKAHEAD_TIME
+			fprintf(REPORT_STREAM, "qr:%d, qi:%d, qo:%d, qt:%lu, qs:%u\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed, planned_ms, qr.starvation_count);
+#else
+			fprintf(REPORT_STREAM, "qr:%d, qi:%d, qo:%d\n", qr.buffers_available,qr.buffers_added,qr.buffers_removed);
+#endif
 		}
 
 	} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "{qr:%d}\n", qr.buffers_available);
+			fprintf(REPORT_STREAM, "{qr:%d}\n", qr.buffers_available);
 		} else {
-			fprintf(stderr, "{qr:%d,qi:%d,qo:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+#ifdef __QR_LOOKAHEAD_TIME
+			fprintf(REPORT_STREAM, "{qr:%d,qi:%d,qo:%d,qt:%lu,qs:%u}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed, planned_ms, qr.starvation_count);
+#else
+			fprintf(REPORT_STREAM, "{qr:%d,qi:%d,qo:%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+#endif
 		}
 
 	} else {
 		if (qr.queue_report_verbosity == QR_SINGLE) {
-			fprintf(stderr, "{\"qr\":%d}\n", qr.buffers_available);
+			fprintf(REPORT_STREAM, "{\"qr\":%d}\n", qr.buffers_available);
 		} else {
-			fprintf(stderr, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+#ifdef __QR_LOOKAHEAD_TIME
+			fprintf(REPORT_STREAM, "{\"qr\":%d,\"qi\":%d,\"qo\":%d,\"qt\":%lu,\"qs\":%u}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed, planned_ms, qr.starvation_count);
+#else
+			fprintf(REPORT_STREAM, "{\"qr\":%d,\"qi\":%d,\"qo\":%d}\n", qr.buffers_available, qr.buffers_added,qr.buffers_removed);
+#endif
 		}
 	}
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(false);
+#endif
 	qr_init_queue_report();
 	return (STAT_OK);
 }
@@ -544,10 +894,106 @@ stat_t rx_report_callback(void) {
 
     rx.rx_report_requested = false;
 
-    fprintf(stderr, "{\"rx\":%d}\n", rx.space_available);
+#ifdef __TX_PRIORITY
+    xio_set_tx_priority_usb(true);		// rx reports pace the sender the same way qr does
+    fprintf(REPORT_STREAM, "{\"rx\":%d}\n", rx.space_available);
+    xio_set_tx_priority_usb(false);
+#else
+    fprintf(REPORT_STREAM, "{\"rx\":%d}\n", rx.space_available);
+#endif
     return (STAT_OK);
 }
 
+#ifdef __SW_EVENTS
+/*
+ * sev_report_callback() - drain switch edge events as push reports
+ *
+ *	Each edge the switch ISR stamped is emitted as its own JSON line carrying
+ *	the switch number, the state read at the edge, and the microsecond stamp
+ *	from dia_time_us(). An overflow report marks any gap where the ring filled
+ *	between drains, so the host never mistakes dropped edges for a quiet input.
+ */
+stat_t sev_report_callback(void)
+{
+	if (sw.event_r == sw.event_w) { return (STAT_NOOP);}
+
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(true);		// edge reports are time-critical like qr/rx
+#endif
+	while (sw.event_r != sw.event_w) {
+		uint8_t r = sw.event_r;
+		fprintf(REPORT_STREAM, "{\"sev\":{\"n\":%d,\"st\":%d,\"t\":%lu}}\n",
+			sw.event_sw[r], sw.event_state[r], (unsigned long)sw.event_stamp[r]);
+		sw.event_r = (r + 1) & (SW_EVENT_RING - 1);
+	}
+	if (sw.event_overflow) {
+		sw.event_overflow = false;
+		fprintf(REPORT_STREAM, "{\"sev\":{\"ovf\":1}}\n");
+	}
+#ifdef __TX_PRIORITY
+	xio_set_tx_priority_usb(false);
+#endif
+	return (STAT_OK);
+}
+#endif // __SW_EVENTS
+
+#ifdef __JOB_STATS
+/*
+ * rpt_job_stats_start() - open a job stats window at cycle start
+ * rpt_request_job_summary() - close the window and schedule the summary report
+ * rpt_job_summary_callback() - emit the end-of-job summary
+ *
+ *	Aggregates the margin counters for one job and reports them when the
+ *	program ends: elapsed time, blocks and segments processed, the planner
+ *	queue low water mark, starvations, near-miss preps, the worst following
+ *	error (motor steps) and the RX queue high water mark. Trended across a
+ *	fleet these show which jobs run with shrinking margins before they
+ *	turn into stalls.
+ */
+void rpt_job_stats_start()
+{
+	if ((jst.summary_enable == false) || (jst.job_running == true)) { return;}
+	jst.job_running = true;
+	jst.start_systick = SysTickTimer_getValue();
+	jst.blocks = 0;
+	jst.queue_min = PLANNER_BUFFER_POOL_SIZE;
+	jst.rx_max = 0;
+#ifdef __QR_LOOKAHEAD_TIME
+	jst.starvation_base = qr.starvation_count;
+#endif
+	dia.job_segments = 0;
+	dia.job_prep_lates = 0;
+	dia.job_ferror_max = 0;
+}
+
+void rpt_request_job_summary()
+{
+	if (jst.job_running == false) { return;}	// M2 without a cycle, or $jse off - nothing aggregated
+	jst.job_running = false;
+	jst.summary_requested = true;
+}
+
+stat_t rpt_job_summary_callback()
+{
+	if ((jst.job_running) || (jst.summary_requested)) {		// the $dia window resets every second - sample each pass
+		if (dia.rx_hiwater > jst.rx_max) { jst.rx_max = dia.rx_hiwater;}
+	}
+	if (jst.summary_requested == false) { return (STAT_NOOP);}
+	jst.summary_requested = false;
+
+	float elapsed = (float)(SysTickTimer_getValue() - jst.start_systick) / 1000;
+#ifdef __QR_LOOKAHEAD_TIME
+	uint16_t starvations = (uint16_t)(qr.starvation_count - jst.starvation_base);
+#else
+	uint16_t starvations = 0;
+#endif
+	fprintf(REPORT_STREAM, "{\"job\":{\"time\":%0.1f,\"blk\":%lu,\"seg\":%lu,\"qmin\":%d,\"qs\":%u,\"late\":%u,\"fe\":%0.0f,\"rxm\":%u}}\n",
+		elapsed, (unsigned long)jst.blocks, (unsigned long)dia.job_segments, jst.queue_min,
+		starvations, dia.job_prep_lates, dia.job_ferror_max, jst.rx_max);
+	return (STAT_OK);
+}
+#endif // __JOB_STATS
+
 /* Alternate Formulation for a Single report - using nvObj list
 
 	// get a clean nv object
@@ -558,12 +1004,177 @@ stat_t rx_report_callback(void) {
 
 	// make a qr object and print it
 	sprintf_P(nv->token, PSTR("qr"));
-	nv->value = qr.buffers_available;
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, qr.buffers_available);
 	nv_print_list(STAT_OK, TEXT_INLINE_PAIRS, JSON_OBJECT_FORMAT);
 	return (STAT_OK);
 */
 
+
+#ifdef __PLAN_EXPORT
+/*****************************************************************************
+ * PLANNER VELOCITY PROFILE EXPORT
+ *
+ *	Tuning jerk and junction settings is guesswork without seeing what the
+ *	planner actually decided. With $pex=1 every executed block emits a compact
+ *	binary record of its planned trapezoid - the entry/cruise/exit velocities
+ *	and head/body/tail lengths left by mp_calculate_trapezoid() - plus the
+ *	Gcode line number to key it back to the program. A host logs the stream
+ *	through a real job and can then pinpoint which junctions limit cycle time
+ *	and quantify a tuning change block by block against the same file.
+ *
+ *	Records are captured at exec start (pex_record_block - interrupt level, a
+ *	straight struct copy into a ring) once replanning of the block has ceased,
+ *	so the values are what actually ran. The controller loop drains one record
+ *	per pass (pex_export_callback) as a framed binary record: 0xA6 marker,
+ *	payload length byte, the record little-endian, CRC8 over length and
+ *	payload - the same framing and CRC as $sb status frames. If the host
+ *	falls behind the ring drops whole records rather than stalling the exec;
+ *	drops are counted so a logging session knows it has gaps.
+ *
+ *	NB: the $sb flow control caveat applies - frames contain arbitrary byte
+ *	values, so the link must not interpret XON/XOFF while $pex=1.
+ */
+#define PEX_MARKER ((char)0xA6)
+
+void pex_record_block(mpBuf_t *bf)
+{
+	if (pex.enable == false) { return;}
+	uint8_t next = (pex.head + 1) & (PEX_RING_LEN-1);
+	if (next == pex.tail) { pex.dropped++; return;}	// ring full - drop, never stall the exec
+	pexRecord_t *r = &pex.ring[pex.head];
+	r->linenum = bf->gm.linenum;
+	r->entry_velocity = bf->entry_velocity;
+	r->cruise_velocity = bf->cruise_velocity;
+	r->exit_velocity = bf->exit_velocity;
+	r->head_length = bf->head_length;
+	r->body_length = bf->body_length;
+	r->tail_length = bf->tail_length;
+	pex.head = next;
+}
+
+stat_t pex_export_callback()
+{
+	if (pex.tail == pex.head) { return (STAT_NOOP);}
+	char frame[2 + sizeof(pexRecord_t) + 1];
+	frame[0] = PEX_MARKER;
+	frame[1] = sizeof(pexRecord_t);
+	memcpy(&frame[2], (char *)&pex.ring[pex.tail], sizeof(pexRecord_t));
+	frame[2 + sizeof(pexRecord_t)] = _crc8(&frame[1], sizeof(pexRecord_t) + 1);
+	fwrite(frame, 1, sizeof(frame), REPORT_STREAM);
+	pex.tail = (pex.tail + 1) & (PEX_RING_LEN-1);
+	return (STAT_OK);						// one record per pass bounds time spent here
+}
+
+stat_t pex_set_pex(nvObj_t *nv)				// $pex - enable/disable the export stream
+{
+	stat_t status = set_01(nv);
+	pex.head = 0;							// drop any stale records on an enable change
+	pex.tail = 0;
+	pex.dropped = 0;
+	return (status);
+}
+#endif // __PLAN_EXPORT
+
+#ifdef __CONFIG_REPORT
+/*****************************************************************************
+ * CONFIG CHANGE REPORT
+ *
+ *	Hosts that mirror machine configuration poll their groups of interest
+ *	every second and diff the responses, paying the group expansion and
+ *	serialization cost at steady state just to notice the occasional change
+ *	made at the console. A config report inverts this: the host subscribes
+ *	to groups once and the firmware pushes a group report only when one of
+ *	its values actually changes.
+ *
+ *	  {cr:{x:t,sys:t}}	subscribe to up to CONFIG_REPORT_MAX_GROUPS groups
+ *	  {cr:""}			clear all subscriptions
+ *	  $cr				report the number of subscribed groups
+ *
+ *	Every successful write through nv_set() marks its group dirty if it is
+ *	subscribed (cr_mark_group_changed - a couple of string compares, and a
+ *	single test when there are no subscriptions). The controller callback
+ *	then emits one dirty group per pass through the normal group expansion,
+ *	in the same {x:{...}} shape a manual group query returns. Repeated
+ *	changes to a group coalesce into one report. Subscriptions are host
+ *	session state - they are volatile and clear on reset.
+ *
+ * cr_set_config_report() - interpret a CR setup object ({cr:{x:t,...}})
+ * cr_mark_group_changed() - called from nv_set() on each successful write
+ * cr_report_callback() - send a group report for one dirty group per pass
+ */
+
+static stat_t _cr_set_config_report(nvObj_t *nv)
+{
+	uint8_t groups = 0;
+	char group[CONFIG_REPORT_MAX_GROUPS][GROUP_LEN+1];
+	memset(group, 0, sizeof(group));
+
+	for (uint8_t i=0; i<CONFIG_REPORT_MAX_GROUPS; i++) {
+		if (((nv = nv->nx) == NULL) || (nv->valuetype == TYPE_EMPTY)) break;
+		if ((nv->valuetype != TYPE_BOOL) || (fp_FALSE(nv->value)) ||
+			(nv_index_is_group(nv->index) == false)) {
+			return (STAT_UNRECOGNIZED_NAME);		// children must be groups set true
+		}
+		strncpy(group[groups], nv->token, GROUP_LEN);
+		groups++;
+	}
+	memcpy(cr.group, group, sizeof(group));			// an empty object clears all subscriptions
+	cr.group_count = groups;
+	cr.dirty = 0;
+	return (STAT_OK);
+}
+
+void cr_mark_group_changed(index_t index)
+{
+	char group[GROUP_LEN+1];
+
+	if (cr.group_count == 0) { return;}				// the only cost when unsubscribed
+	if (nv_index_is_single(index) == false) { return;}
+	strcpy_P(group, cfgArray[index].group);
+	if (group[0] == NUL) { return;}					// ungrouped tokens (gc, commands) don't report
+	for (uint8_t i=0; i<cr.group_count; i++) {
+		if (strcmp(cr.group[i], group) == 0) {
+			cr.dirty |= (1 << i);
+			return;
+		}
+	}
+}
+
+stat_t cr_report_callback()
+{
+	if (cr.dirty == 0) { return (STAT_NOOP);}
+#ifdef __NV_ARENAS
+	uint8_t arena = nv_select_arena(NV_ARENA_REPORT);	// don't disturb a command list in flight
+#endif
+	for (uint8_t i=0; i<cr.group_count; i++) {
+		if ((cr.dirty & (1 << i)) == 0) { continue;}
+		cr.dirty &= ~(1 << i);
+		nvObj_t *nv = nv_reset_nv_list();
+		strncpy(nv->token, cr.group[i], GROUP_LEN);
+		nv->index = nv_get_index((const char_t *)"", nv->token);
+		get_grp(nv);
+		nv_print_list(STAT_OK, TEXT_MULTILINE_FORMATTED, JSON_OBJECT_FORMAT);
+		break;										// one group per pass bounds the pass time
+	}
+#ifdef __NV_ARENAS
+	nv_select_arena(arena);
+#endif
+	return (STAT_OK);
+}
+
+/*
+ * cr_get() - report the number of subscribed groups
+ * cr_set() - subscribe to config change reports
+ */
+stat_t cr_get(nvObj_t *nv)
+{
+	nv_store_int(nv, cr.group_count);
+	return (STAT_OK);
+}
+
+stat_t cr_set(nvObj_t *nv) { return (_cr_set_config_report(nv));}
+#endif // __CONFIG_REPORT
+
 /*
  * Wrappers and Setters - for calling from cfgArray table
  *
@@ -573,27 +1184,60 @@ stat_t rx_report_callback(void) {
  */
 stat_t qr_get(nvObj_t *nv)
 {
-	nv->value = (float)mp_get_planner_buffers_available(); // ensure that manually requested QR count is always up to date
-	nv->valuetype = TYPE_INTEGER;
+#ifdef __PLAN_STAGING
+	nv_store_int(nv, mp_get_planner_buffers_available() + mp_staging_room()); // both tiers, freshly sampled
+#else
+	nv_store_int(nv, mp_get_planner_buffers_available()); // ensure that manually requested QR count is always up to date
+#endif
 	return (STAT_OK);
 }
 
 stat_t qi_get(nvObj_t *nv)
 {
-	nv->value = (float)qr.buffers_added;
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, qr.buffers_added);
 	qr.buffers_added = 0;				// reset it
 	return (STAT_OK);
 }
 
 stat_t qo_get(nvObj_t *nv)
 {
-	nv->value = (float)qr.buffers_removed;
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, qr.buffers_removed);
 	qr.buffers_removed = 0;				// reset it
 	return (STAT_OK);
 }
 
+#ifdef __QR_LOOKAHEAD_TIME
+/*
+ * qr_record_starvation() - called from the exec when the queue runs dry during motion
+ * qt_get() - planned time in the queue in milliseconds
+ * qs_get() - starvation count
+ *
+ *	The starvation count is cumulative since power-up so a host can take deltas
+ *	between reports without losing events to a dropped report. Note that a job
+ *	whose last motion is not followed by a program end (M2/M30) records one
+ *	starvation when its final move drains the queue.
+ */
+void qr_record_starvation()
+{
+	qr.starvation_count++;
+#ifdef __EVENT_TRACE
+	dia_trace_event(DIA_EVENT_STARVED, (uint8_t)qr.starvation_count);
+#endif
+}
+
+stat_t qt_get(nvObj_t *nv)
+{
+	nv_store_int(nv, floor(mp_get_planned_time() * 60000));	// minutes --> milliseconds
+	return (STAT_OK);
+}
+
+stat_t qs_get(nvObj_t *nv)
+{
+	nv_store_int(nv, qr.starvation_count);
+	return (STAT_OK);
+}
+#endif // __QR_LOOKAHEAD_TIME
+
 /*****************************************************************************
  * JOB ID REPORTS
  *
@@ -655,9 +1299,9 @@ uint8_t job_report_callback()
 	if (cfg.comm_mode == TEXT_MODE) {
 		// no-op, job_ids are client app state
 	} else if (js.json_syntax == JSON_SYNTAX_RELAXED) {
-		fprintf(stderr, "{job:[%lu,%lu,%lu,%lu]}\n", cs.job_id[0], cs.job_id[1], cs.job_id[2], cs.job_id[3] );
+		fprintf(REPORT_STREAM, "{job:[%lu,%lu,%lu,%lu]}\n", cs.job_id[0], cs.job_id[1], cs.job_id[2], cs.job_id[3] );
 	} else {
-		fprintf(stderr, "{\"job\":[%lu,%lu,%lu,%lu]}\n", cs.job_id[0], cs.job_id[1], cs.job_id[2], cs.job_id[3] );
+		fprintf(REPORT_STREAM, "{\"job\":[%lu,%lu,%lu,%lu]}\n", cs.job_id[0], cs.job_id[1], cs.job_id[2], cs.job_id[3] );
 		//job_clear_report();
 	}
 	return (STAT_OK);
@@ -675,12 +1319,24 @@ void job_print_job(nvObj_t *nv) { job_populate_job_report();}
 static const char fmt_qr[] PROGMEM = "qr:%d\n";
 static const char fmt_qi[] PROGMEM = "qi:%d\n";
 static const char fmt_qo[] PROGMEM = "qo:%d\n";
+#ifdef __QR_LOOKAHEAD_TIME
+static const char fmt_qt[] PROGMEM = "qt:%d\n";
+static const char fmt_qs[] PROGMEM = "qs:%d\n";
+#endif
 static const char fmt_qv[] PROGMEM = "[qv]  queue report verbosity%7d [0=off,1=single,2=triple]\n";
 
 void qr_print_qr(nvObj_t *nv) { text_print_int(nv, fmt_qr);}
 void qr_print_qi(nvObj_t *nv) { text_print_int(nv, fmt_qi);}
 void qr_print_qo(nvObj_t *nv) { text_print_int(nv, fmt_qo);}
+#ifdef __QR_LOOKAHEAD_TIME
+void qr_print_qt(nvObj_t *nv) { text_print_int(nv, fmt_qt);}
+void qr_print_qs(nvObj_t *nv) { text_print_int(nv, fmt_qs);}
+#endif
 void qr_print_qv(nvObj_t *nv) { text_print_ui8(nv, fmt_qv);}
+#ifdef __JOB_STATS
+static const char fmt_jse[] PROGMEM = "[jse] job summary enable%11d [0=off,1=on]\n";
+void jst_print_jse(nvObj_t *nv) { text_print_ui8(nv, fmt_jse);}
+#endif
 
 #endif // __TEXT_MODE
 
@@ -38,8 +38,27 @@ extern "C"{
 //		- The NV_STATUS_REPORT_LEN define is in config.h
 //		- The status report defaults can be found in settings.h
 
+/* Report routing. Status reports, queue reports and exception reports are
+ * asynchronous traffic - hosts consume them but never wait on them, unlike the
+ * response (ack) a command is blocked on. With __REPORT_USART they are routed
+ * out the second USART (the RS485 port) so raising report rates costs the
+ * command channel nothing and an ack can never queue behind report text.
+ * The RS485 device opens non-blocking, so a saturated telemetry link drops
+ * report characters rather than stalling motion. Command responses, prompts
+ * and text-mode output stay on the primary channel either way.
+ */
+#ifdef __REPORT_USART
+#define REPORT_STREAM (&ds[XIO_DEV_RS485].file)	// reports own the second USART
+#else
+#define REPORT_STREAM stderr					// reports share the command channel
+#endif
+
 #define MIN_ARC_QR_INTERVAL 200					// minimum interval between QRs during arc generation (in system ticks)
 
+#ifdef __REPORT_COALESCE
+#define REPORT_COALESCE_TX_MIN 256				// don't serialize a report into less TX ring space than this
+#endif
+
 enum srVerbosity {								// status report enable and verbosity
 	SR_OFF = 0,									// no reports
 	SR_FILTERED,								// reports only values that have changed from the last report
@@ -62,13 +81,27 @@ typedef struct srSingleton {
 	/*** config values (PUBLIC) ***/
 	uint8_t status_report_verbosity;
 	uint32_t status_report_interval;					// in milliseconds
+#ifdef __SR_BINARY
+	uint8_t binary_report;								// 0=JSON reports, 1=packed binary SR frames
+#endif
 
 	/*** runtime values (PRIVATE) ***/
 	uint8_t status_report_requested;					// flag that SR has been requested
 	uint32_t status_report_systick;						// SysTick value for next status report
+#ifdef __SR_ADAPTIVE
+	uint8_t quiet_reports;								// consecutive filtered reports with nothing to say
+#endif
 	index_t stat_index;									// table index value for stat - determined during initialization
 	index_t status_report_list[NV_STATUS_REPORT_LEN];	// status report elements to report
 	float status_report_value[NV_STATUS_REPORT_LEN];	// previous values for filtered reporting
+#ifdef __SR_COMPILED
+	char_t field_key[NV_STATUS_REPORT_LEN][GROUP_LEN+TOKEN_LEN+1];	// pre-flattened group+token key text
+	fptrCmd field_get[NV_STATUS_REPORT_LEN];			// cached get() bindings
+	uint8_t field_count;								// number of compiled fields
+#endif
+#ifdef __SR_DEADBAND
+	float field_deadband[NV_STATUS_REPORT_LEN];			// per-field change threshold; 0 = exact (EPSILON)
+#endif
 
 } srSingleton_t;
 
@@ -85,6 +118,9 @@ typedef struct qrSingleton {		// data for queue reports
 	uint16_t buffers_removed;		// buffers removed since last report
 	uint8_t motion_mode;			// used to detect arc movement
 	uint32_t init_tick;				// time when values were last initialized or cleared
+#ifdef __QR_LOOKAHEAD_TIME
+	uint16_t starvation_count;		// times the planner queue ran dry during motion (cumulative)
+#endif
 
 } qrSingleton_t;
 
@@ -93,22 +129,84 @@ typedef struct rxSingleton {
     uint16_t space_available;       // space available in usb rx buffer at time of request
 } rxSingleton_t;
 
+#ifdef __JOB_STATS
+#define JOB_SUMMARY_ENABLE 0			// default $jse - job summaries off
+
+typedef struct jobStatsSingleton {		// end-of-job margin summary
+	uint8_t summary_enable;				// $jse - emit a summary report at program end
+	uint8_t job_running;				// a stats window is open
+	uint8_t summary_requested;			// emit the summary on the next callback pass
+	uint32_t start_systick;				// systick when the cycle started
+	uint32_t blocks;					// planner blocks consumed this job
+	uint8_t queue_min;					// fewest planner buffers available this job
+	uint16_t rx_max;					// deepest RX queue occupancy this job (chars)
+	uint16_t starvation_base;			// qr.starvation_count at job start
+} jobStatsSingleton_t;
+#endif
+
+#ifdef __PLAN_EXPORT
+#define PEX_RING_LEN 8					// planned profile records buffered - must be a power of 2
+
+typedef struct pexRecord {				// one executed block as the planner left it
+	uint32_t linenum;					// Gcode line number (N word)
+	float entry_velocity;				// velocities and section lengths from mp_calculate_trapezoid()
+	float cruise_velocity;
+	float exit_velocity;
+	float head_length;
+	float body_length;
+	float tail_length;
+} pexRecord_t;
+
+typedef struct pexSingleton {			// planner velocity profile export
+	uint8_t enable;						// $pex - 0=off, 1=stream binary records
+	volatile uint8_t head;				// next slot to capture into (exec interrupt)
+	volatile uint8_t tail;				// next record to send (controller loop)
+	uint16_t dropped;					// records lost to a full ring (host too slow)
+	pexRecord_t ring[PEX_RING_LEN];
+} pexSingleton_t;
+#endif
+
+#ifdef __CONFIG_REPORT
+#define CONFIG_REPORT_MAX_GROUPS 8	// groups a host can subscribe to - dirty flags are one uint8_t
+typedef struct crSingleton {		// data for config change reports
+	uint8_t group_count;			// subscribed groups; 0 = no subscriptions (the boot state)
+	uint8_t dirty;					// bitmap of subscribed groups with changed values
+	char group[CONFIG_REPORT_MAX_GROUPS][GROUP_LEN+1];	// subscribed group tokens
+} crSingleton_t;
+#endif
+
 /**** Externs - See report.c for allocation ****/
 
 extern srSingleton_t sr;
 extern qrSingleton_t qr;
 extern rxSingleton_t rx;
+#ifdef __JOB_STATS
+extern jobStatsSingleton_t jst;
+#endif
+#ifdef __PLAN_EXPORT
+extern pexSingleton_t pex;
+#endif
+#ifdef __CONFIG_REPORT
+extern crSingleton_t cr;
+#endif
 
 /**** Function Prototypes ****/
 
+#ifdef __ER_RING
+#define ER_RING_LEN 8					// exception records retained - must be a power of 2
+#endif
+
 void rpt_print_message(char *msg);
 stat_t rpt_exception(uint8_t status);
 
 stat_t rpt_er(nvObj_t *nv);
+#ifdef __ER_RING
+stat_t rpt_er_get(nvObj_t *nv);			// $erd - expand and print the exception ring
+#endif
 void rpt_print_loading_configs_message(void);
 void rpt_print_initializing_message(void);
 void rpt_print_system_ready_message(void);
-
+
 void sr_init_status_report(void);
 stat_t sr_set_status_report(nvObj_t *nv);
 stat_t sr_request_status_report(uint8_t request_type);
@@ -126,30 +224,77 @@ stat_t qr_queue_report_callback(void);
 
 void rx_request_rx_report(void);
 stat_t rx_report_callback(void);
+#ifdef __SW_EVENTS
+stat_t sev_report_callback(void);
+#endif
+#ifdef __JOB_STATS
+void rpt_job_stats_start(void);
+void rpt_request_job_summary(void);
+stat_t rpt_job_summary_callback(void);
+#endif
+
+#ifdef __PLAN_EXPORT
+struct mpBuffer;						// defined in planner.h
+void pex_record_block(struct mpBuffer *bf);	// capture a block at exec start (interrupt level)
+stat_t pex_export_callback(void);
+stat_t pex_set_pex(nvObj_t *nv);
+#endif
+
+#ifdef __CONFIG_REPORT
+void cr_mark_group_changed(index_t index);	// called from the nv_set() path
+stat_t cr_report_callback(void);
+stat_t cr_get(nvObj_t *nv);
+stat_t cr_set(nvObj_t *nv);
+#endif
 
 stat_t qr_get(nvObj_t *nv);
 stat_t qi_get(nvObj_t *nv);
 stat_t qo_get(nvObj_t *nv);
+#ifdef __QR_LOOKAHEAD_TIME
+void qr_record_starvation(void);
+stat_t qt_get(nvObj_t *nv);
+stat_t qs_get(nvObj_t *nv);
+#endif
 
 #ifdef __TEXT_MODE
 
 	void sr_print_sr(nvObj_t *nv);
 	void sr_print_si(nvObj_t *nv);
 	void sr_print_sv(nvObj_t *nv);
+	void sr_print_sb(nvObj_t *nv);
+#ifdef __PLAN_EXPORT
+	void pex_print_pex(nvObj_t *nv);
+#endif
 	void qr_print_qv(nvObj_t *nv);
 	void qr_print_qr(nvObj_t *nv);
 	void qr_print_qi(nvObj_t *nv);
 	void qr_print_qo(nvObj_t *nv);
+#ifdef __QR_LOOKAHEAD_TIME
+	void qr_print_qt(nvObj_t *nv);
+	void qr_print_qs(nvObj_t *nv);
+#endif
+#ifdef __JOB_STATS
+	void jst_print_jse(nvObj_t *nv);
+#endif
 
 #else
 
 	#define sr_print_sr tx_print_stub
 	#define sr_print_si tx_print_stub
 	#define sr_print_sv tx_print_stub
+	#define sr_print_sb tx_print_stub
+	#define pex_print_pex tx_print_stub
 	#define qr_print_qv tx_print_stub
 	#define qr_print_qr tx_print_stub
 	#define qr_print_qi tx_print_stub
 	#define qr_print_qo tx_print_stub
+#ifdef __QR_LOOKAHEAD_TIME
+	#define qr_print_qt tx_print_stub
+	#define qr_print_qs tx_print_stub
+#endif
+#ifdef __JOB_STATS
+	#define jst_print_jse tx_print_stub
+#endif
 
 #endif // __TEXT_MODE
 
@@ -42,6 +42,9 @@
 
 // Machine configuration settings
 #define CHORDAL_TOLERANCE 			0.01					// chordal accuracy for arc drawing
+#define BLEND_TOLERANCE				0						// chord tolerance for polyline blending, 0 = off (see __CHORD_BLEND)
+#define SYNC_OUT_AXIS				AXIS_X					// axis whose travel is counted for position triggers (see __SYNC_OUT)
+#define SYNC_OUT_BITMASK			0x01					// GPIO bit(s) changed when a position trigger fires
 #define SOFT_LIMIT_ENABLE			0						// 0 = off, 1 = on
 #define SWITCH_TYPE 				SW_TYPE_NORMALLY_OPEN	// one of: SW_TYPE_NORMALLY_OPEN, SW_TYPE_NORMALLY_CLOSED
 
@@ -65,6 +68,8 @@
 #define STATUS_REPORT_VERBOSITY		SR_FILTERED				// one of: SR_OFF, SR_FILTERED, SR_VERBOSE=
 #define STATUS_REPORT_MIN_MS		100						// milliseconds - enforces a viable minimum
 #define STATUS_REPORT_INTERVAL_MS	500						// milliseconds - set $SV=0 to disable
+#define STATUS_REPORT_BINARY		0						// 0=json reports, 1=packed binary SR frames ($sb)
+#define PLAN_EXPORT_STREAM			0						// 0=off, 1=stream planned velocity records ($pex)
 #define STATUS_REPORT_DEFAULTS "posx","posy","posz","posa","feed","vel","unit","coor","dist","frmo","stat"
 //tgfx-friendly defaults
 //#define STATUS_REPORT_DEFAULTS "line","vel","mpox","mpoy","mpoz","mpoa","coor","ofsa","ofsx","ofsy","ofsz","dist","unit","stat","homz","homy","homx","momo"
@@ -81,7 +86,12 @@
 // Comm mode and echo levels
 #define COM_EXPAND_CR				false
 #define COM_ENABLE_ECHO				false
+#ifdef __BIG_SERIAL_BUFFERS
+#define COM_ENABLE_FLOW_CONTROL		FLOW_CONTROL_RTS		// hardware flow control pairs with the large buffers
+#else
 #define COM_ENABLE_FLOW_CONTROL		FLOW_CONTROL_XON		// FLOW_CONTROL_OFF, FLOW_CONTROL_XON, FLOW_CONTROL_RTS
+#endif
+#define COM_ENABLE_LINE_CRC			false					// CRC16 line framing - senders enable with $fr=1
 
 //**** DEBUG SETTINGS ****
 
@@ -115,6 +125,13 @@
 //#include "settings/settings_ultimaker.h"				// Ultimaker 3D printer
 //#include "settings/settings_zen7x12.h"				// Zen Toolworks 7x12
 
+// Fixed-configuration builds resolve motion-critical profile settings to
+// compile-time constants for the kinematics and planning hot paths.
+// See __CONST_PROFILE in tinyg.h and settings/settings_const.h.
+#ifdef __CONST_PROFILE
+#include "settings/settings_const.h"
+#endif
+
 /*** Handle optional modules that may not be in every machine ***/
 
 // If PWM_1 is not defined fill it with default values
@@ -132,6 +149,97 @@
 #define P1_PWM_PHASE_OFF                0.1
 #endif //P1_PWM_FREQUENCY
 
+// Spindle speed slew rate for the asynchronous ramp engine - see spindle.c.
+// Machine profiles may override. Speed changes step SPINDLE_RAMP_RPM_PER_SEC/100
+// RPM per 10ms RTC tick until the target is reached.
+#ifndef SPINDLE_RAMP_RPM_PER_SEC
+#define SPINDLE_RAMP_RPM_PER_SEC 10000
+#endif
+
+// Torch height control defaults - see thc.c. Machine profiles may override.
+// THC is compiled in (__THC) but inert until $the=1. The voltage scale is
+// set by the external arc voltage divider: volts at the torch per ADC count.
+#ifndef THC_TARGET_VOLTAGE
+#define THC_ENABLE                      0					// 0=off, 1=on
+#define THC_TARGET_VOLTAGE              128					// arc voltage setpoint in volts
+#define THC_GAIN                        0.02				// mm of Z correction per volt of error, per tick
+#define THC_AUTHORITY                   5.0					// max Z offset magnitude in mm
+#define THC_RATE                        500					// max offset slew rate in mm/min
+#define THC_VOLTAGE_SCALE               0.0806				// volts per ADC count (330V full scale / 4096)
+#endif //THC_TARGET_VOLTAGE
+
+// Adaptive feed control defaults - see afc.c. Machine profiles may override.
+// AFC is compiled in (__ADAPTIVE_FEED) but inert until $afe=1. The voltage
+// scale maps the load sensor output to volts at the sensor: a 0-10V signal
+// divided down to the ADC range reads 10V full scale over 4096 counts.
+#ifndef AFC_TARGET_VOLTAGE
+#define AFC_ENABLE                      0					// 0=off, 1=on
+#define AFC_TARGET_VOLTAGE              5.0					// spindle load setpoint in volts
+#define AFC_GAIN                        0.01				// override factor change per volt of error, per tick
+#define AFC_AUTHORITY                   0.3					// factor stays within 1.0 +/- this
+#define AFC_RATE                        0.5					// max factor slew rate per second
+#define AFC_VOLTAGE_SCALE               0.00244				// volts per ADC count (10V full scale / 4096)
+#endif //AFC_TARGET_VOLTAGE
+
+// Axes allowed to run the homing rough-seek concurrently - see cycle_homing.c.
+// Machine profiles may override. X and Y are safe on most gantry machines;
+// Z is excluded so it always clears the work before the other axes move.
+#ifndef HOMING_OVERLAP_AXES_bm
+#define HOMING_OVERLAP_AXES_bm	((1<<AXIS_X) | (1<<AXIS_Y))
+#endif
+
+// Per-motor backlash takeup distance in mm (or degrees) - see stepper.c.
+// Machine profiles may override. Zero disables compensation for that motor.
+#ifndef M1_BACKLASH
+#define M1_BACKLASH 0
+#define M2_BACKLASH 0
+#define M3_BACKLASH 0
+#define M4_BACKLASH 0
+#define M5_BACKLASH 0
+#define M6_BACKLASH 0
+#endif
+
+
+// Spindle at-speed gating - see __SPINDLE_READY in spindle.c.
+// Machine profiles may override. The switch input is any swNums index (switch.h).
+#ifndef SPINDLE_READY_SWITCH
+#define SPINDLE_READY_SWITCH	SW_MAX_A			// VFD at-speed input
+#define SPINDLE_READY_TIMEOUT_MS 15000				// soft alarm if at-speed is never reported
+#endif
+
+// Pulse-input RPM measurement - see __SPINDLE_RPM in spindle.c.
+// Machine profiles may override.
+#ifndef SPINDLE_PULSES_PER_REV
+#define SPINDLE_PULSES_PER_REV	1					// $sppr - sensor pulses per spindle revolution
+#define SPINDLE_READY_RPM_FRACTION 0.95				// measured/commanded ratio that counts as at-speed
+#endif
+
+// Spindle encoder resolution for G33 - see __SPINDLE_SYNC in plan_exec.c.
+// Machine profiles may override. Quadrature counts per spindle revolution.
+#ifndef SPINDLE_SYNC_COUNTS_PER_REV
+#define SPINDLE_SYNC_COUNTS_PER_REV ((float)4096)	// 1024 line encoder x4 decode
+#endif
+
+// Traverse (G0) jerk for each axis - see __TRAVERSE_JERK in plan_line.c.
+// Machine profiles may override. Defaults to the homing jerk - the profile's
+// existing "fast unloaded move" tuning - so rapids ramp harder than feeds.
+#ifndef X_JERK_TRAVERSE
+#define X_JERK_TRAVERSE X_JERK_HOMING
+#define Y_JERK_TRAVERSE Y_JERK_HOMING
+#define Z_JERK_TRAVERSE Z_JERK_HOMING
+#define A_JERK_TRAVERSE A_JERK_HOMING
+#define B_JERK_TRAVERSE B_JERK_HOMING
+#define C_JERK_TRAVERSE C_JERK_HOMING
+#endif
+
+// Input shaper defaults - see __INPUT_SHAPER in plan_exec.c.
+// Machine profiles may override. Frequency 0 leaves the axis unshaped; the
+// damping ratio only matters once a frequency is set.
+#ifndef SHAPER_FREQUENCY
+#define SHAPER_FREQUENCY		((float)0)			// $_shf - resonance to cancel, in Hz
+#define SHAPER_ZETA				((float)0.1)		// $_shz - damping ratio of that resonance
+#define SHAPER_MODE				0					// $shm - 0=ZV, 1=ZVD
+#endif
 
 /*** User-Defined Data Defaults ***/
 
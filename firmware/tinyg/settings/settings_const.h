@@ -0,0 +1,78 @@
+/*
+ * settings_const.h - compile-time constant motion settings for fixed-configuration builds
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	These constants are derived from the machine profile selected in settings.h.
+ *	With __CONST_PROFILE defined (see tinyg.h) the motion hot path reads them
+ *	instead of the st_cfg and cm.a structs, so the compiler folds the
+ *	steps-per-unit multiplies in the kinematics and the per-axis jerk terms in
+ *	block planning into precomputed values - worth real cycles per segment and
+ *	per block on a software float machine.
+ *
+ *	This mode is for production machines whose configuration is locked. The
+ *	config system still accepts and reports runtime changes to motor mapping,
+ *	step angle, travel, microsteps and jerk, but they no longer affect motion.
+ *	Homing also runs at the profile jerk values - Xn_JERK_HOMING does not apply.
+ */
+#ifndef SETTINGS_CONST_H_ONCE
+#define SETTINGS_CONST_H_ONCE
+
+// Per-motor steps-per-unit. Same math as _set_motor_steps_per_unit() in stepper.c
+#define M1_STEPS_PER_UNIT_CT ((float)((360.0 * M1_MICROSTEPS) / (M1_TRAVEL_PER_REV * M1_STEP_ANGLE)))
+#define M2_STEPS_PER_UNIT_CT ((float)((360.0 * M2_MICROSTEPS) / (M2_TRAVEL_PER_REV * M2_STEP_ANGLE)))
+#define M3_STEPS_PER_UNIT_CT ((float)((360.0 * M3_MICROSTEPS) / (M3_TRAVEL_PER_REV * M3_STEP_ANGLE)))
+#define M4_STEPS_PER_UNIT_CT ((float)((360.0 * M4_MICROSTEPS) / (M4_TRAVEL_PER_REV * M4_STEP_ANGLE)))
+#define M5_STEPS_PER_UNIT_CT ((float)((360.0 * M5_MICROSTEPS) / (M5_TRAVEL_PER_REV * M5_STEP_ANGLE)))
+#define M6_STEPS_PER_UNIT_CT ((float)((360.0 * M6_MICROSTEPS) / (M6_TRAVEL_PER_REV * M6_STEP_ANGLE)))
+
+// Initializers for the per-motor constant tables used by ik_kinematics()
+#if (MOTORS == 4)
+#define MOTOR_MAP_CT		{ M1_MOTOR_MAP, M2_MOTOR_MAP, M3_MOTOR_MAP, M4_MOTOR_MAP }
+#define STEPS_PER_UNIT_CT	{ M1_STEPS_PER_UNIT_CT, M2_STEPS_PER_UNIT_CT, M3_STEPS_PER_UNIT_CT, M4_STEPS_PER_UNIT_CT }
+#elif (MOTORS == 5)
+#define MOTOR_MAP_CT		{ M1_MOTOR_MAP, M2_MOTOR_MAP, M3_MOTOR_MAP, M4_MOTOR_MAP, M5_MOTOR_MAP }
+#define STEPS_PER_UNIT_CT	{ M1_STEPS_PER_UNIT_CT, M2_STEPS_PER_UNIT_CT, M3_STEPS_PER_UNIT_CT, M4_STEPS_PER_UNIT_CT, M5_STEPS_PER_UNIT_CT }
+#elif (MOTORS == 6)
+#define MOTOR_MAP_CT		{ M1_MOTOR_MAP, M2_MOTOR_MAP, M3_MOTOR_MAP, M4_MOTOR_MAP, M5_MOTOR_MAP, M6_MOTOR_MAP }
+#define STEPS_PER_UNIT_CT	{ M1_STEPS_PER_UNIT_CT, M2_STEPS_PER_UNIT_CT, M3_STEPS_PER_UNIT_CT, M4_STEPS_PER_UNIT_CT, M5_STEPS_PER_UNIT_CT, M6_STEPS_PER_UNIT_CT }
+#else
+#error __CONST_PROFILE requires MOTORS to be 4, 5 or 6
+#endif
+
+// Initializers for the per-axis jerk tables used by _calc_move() in plan_line.c.
+// The reciprocals match cm_set_axis_jerk(): 1/(jerk * JERK_MULTIPLIER)
+#define JERK_MAX_CT \
+	{ (float)X_JERK_MAX, (float)Y_JERK_MAX, (float)Z_JERK_MAX, \
+	  (float)A_JERK_MAX, (float)B_JERK_MAX, (float)C_JERK_MAX }
+
+#define RECIP_JERK_CT \
+	{ (1/((float)X_JERK_MAX * JERK_MULTIPLIER)), \
+	  (1/((float)Y_JERK_MAX * JERK_MULTIPLIER)), \
+	  (1/((float)Z_JERK_MAX * JERK_MULTIPLIER)), \
+	  (1/((float)A_JERK_MAX * JERK_MULTIPLIER)), \
+	  (1/((float)B_JERK_MAX * JERK_MULTIPLIER)), \
+	  (1/((float)C_JERK_MAX * JERK_MULTIPLIER)) }
+
+#endif	// SETTINGS_CONST_H_ONCE
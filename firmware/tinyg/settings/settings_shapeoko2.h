@@ -127,6 +127,7 @@
 #define Y_JUNCTION_DEVIATION	JUNCTION_DEVIATION
 #define Y_SWITCH_MODE_MIN		SW_MODE_HOMING
 #define Y_SWITCH_MODE_MAX		SW_MODE_DISABLED
+#define SQUARING_SWITCH_2		SW_MIN_A			// Y2 endstop input for auto-squaring - see __DUAL_ENDSTOP in cycle_homing.c
 #define Y_SEARCH_VELOCITY		3000
 #define Y_LATCH_VELOCITY		100
 #define Y_LATCH_BACKOFF			10
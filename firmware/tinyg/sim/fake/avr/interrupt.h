@@ -0,0 +1,18 @@
+/*
+ * fake/avr/interrupt.h - host-build stand-in for avr-libc <avr/interrupt.h>
+ *
+ *	Part of the simulator build (see sim/Makefile). ISR() expands to a plain
+ *	function definition so the harness can invoke the firmware's interrupt
+ *	handlers by their vector names. sei()/cli() are no-ops - the simulator
+ *	is single threaded and runs the "ISRs" synchronously.
+ */
+#ifndef SIM_AVR_INTERRUPT_H_ONCE
+#define SIM_AVR_INTERRUPT_H_ONCE
+
+#include <avr/io.h>
+
+#define ISR(vector) void vector(void)
+#define sei()
+#define cli()
+
+#endif // SIM_AVR_INTERRUPT_H_ONCE
@@ -0,0 +1,139 @@
+/*
+ * fake/avr/io.h - host-build stand-in for the XMega device header
+ *
+ *	Part of the simulator build (see sim/Makefile). Declares just enough of
+ *	the XMega peripheral register file for the firmware sources the simulator
+ *	compiles (stepper.c and friends). The registers are ordinary globals -
+ *	the harness in sim_main.c polls the fake timer CTRLA registers and calls
+ *	the ISR functions directly, standing in for the interrupt controller.
+ *	Tentative definitions merge across translation units, so instances can
+ *	live here just like the firmware's singleton-in-header idiom.
+ */
+#ifndef SIM_AVR_IO_H_ONCE
+#define SIM_AVR_IO_H_ONCE
+
+#include <stdint.h>
+
+typedef struct TC0_struct {				// timer/counter (TC0 and TC1 are identical for our purposes)
+	uint8_t CTRLA;
+	uint8_t CTRLB;
+	uint8_t CTRLC;
+	uint8_t CTRLD;
+	uint8_t CTRLE;
+	uint8_t INTCTRLA;
+	uint8_t INTCTRLB;
+	uint8_t INTFLAGS;
+	uint16_t CNT;
+	uint16_t PER;
+	uint16_t CCA;
+	uint16_t CCB;
+	uint16_t CCC;
+	uint16_t CCD;
+} TC0_t;
+typedef TC0_t TC1_t;
+
+TC0_t TCC0, TCD0, TCE0, TCF0;
+TC1_t TCC1, TCD1, TCE1, TCF1;
+
+typedef struct PORT_struct {
+	uint8_t DIR;
+	uint8_t DIRSET;
+	uint8_t DIRCLR;
+	uint8_t DIRTGL;
+	uint8_t OUT;
+	uint8_t OUTSET;
+	uint8_t OUTCLR;
+	uint8_t OUTTGL;
+	uint8_t IN;
+	uint8_t INTCTRL;
+	uint8_t INT0MASK;
+	uint8_t INT1MASK;
+	uint8_t INTFLAGS;
+	uint8_t PIN0CTRL;
+	uint8_t PIN1CTRL;
+	uint8_t PIN2CTRL;
+	uint8_t PIN3CTRL;
+	uint8_t PIN4CTRL;
+	uint8_t PIN5CTRL;
+	uint8_t PIN6CTRL;
+	uint8_t PIN7CTRL;
+} PORT_t;
+
+PORT_t PORTA, PORTB, PORTC, PORTD, PORTE, PORTF;
+
+typedef struct VPORT_struct {
+	uint8_t DIR;
+	uint8_t OUT;
+	uint8_t IN;
+	uint8_t INTFLAGS;
+} VPORT_t;
+
+VPORT_t VPORT0, VPORT1, VPORT2, VPORT3;
+
+typedef struct PORTCFG_struct {
+	uint8_t MPCMASK;
+	uint8_t VPCTRLA;
+	uint8_t VPCTRLB;
+	uint8_t CLKEVOUT;
+} PORTCFG_t;
+
+PORTCFG_t PORTCFG;
+
+typedef struct EVSYS_struct {			// event system - registers exist but nothing routes events
+	uint8_t CH0MUX;
+	uint8_t CH1MUX;
+	uint8_t CH2MUX;
+	uint8_t CH3MUX;
+	uint8_t CH4MUX;
+	uint8_t CH5MUX;
+	uint8_t CH6MUX;
+	uint8_t CH7MUX;
+	uint8_t CH0CTRL;
+	uint8_t CH1CTRL;
+	uint8_t CH2CTRL;
+	uint8_t CH3CTRL;
+	uint8_t CH4CTRL;
+	uint8_t CH5CTRL;
+	uint8_t CH6CTRL;
+	uint8_t CH7CTRL;
+	uint8_t STROBE;
+	uint8_t DATA;
+} EVSYS_t;
+
+EVSYS_t EVSYS;
+
+// timer clock select group configuration - values match the real part
+enum {
+	TC_CLKSEL_OFF_gc     = 0x00,
+	TC_CLKSEL_DIV1_gc    = 0x01,
+	TC_CLKSEL_DIV2_gc    = 0x02,
+	TC_CLKSEL_DIV4_gc    = 0x03,
+	TC_CLKSEL_DIV8_gc    = 0x04,
+	TC_CLKSEL_DIV64_gc   = 0x05,
+	TC_CLKSEL_DIV256_gc  = 0x06,
+	TC_CLKSEL_DIV1024_gc = 0x07,
+};
+
+// virtual port mappings - the simulator doesn't model port remapping
+enum {
+	PORTCFG_VP0MAP_PORTA_gc = 0x00,
+	PORTCFG_VP1MAP_PORTF_gc = 0x00,
+	PORTCFG_VP2MAP_PORTE_gc = 0x00,
+	PORTCFG_VP3MAP_PORTD_gc = 0x00,
+};
+
+// event system and quadrature decode group configuration - values match the real part
+enum {
+	EVSYS_CHMUX_PORTB_PIN0_gc = 0x58,
+	EVSYS_CHMUX_PORTB_PIN2_gc = 0x5A,
+	EVSYS_QDEN_bm             = 0x08,
+	EVSYS_DIGFILT_2SAMPLES_gc = 0x01,
+	EVSYS_DIGFILT_4SAMPLES_gc = 0x03,
+	TC_EVACT_QDEC_gc          = 0xC0,
+	TC_EVSEL_CH0_gc           = 0x08,
+	TC_EVSEL_CH2_gc           = 0x0A,
+	PORT_ISC_LEVEL_gc         = 0x03,
+	PORT_OPC_PULLUP_gc        = 0x18,
+};
+
+#endif // SIM_AVR_IO_H_ONCE
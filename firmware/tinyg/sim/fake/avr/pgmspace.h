@@ -0,0 +1,44 @@
+/*
+ * fake/avr/pgmspace.h - host-build stand-in for avr-libc <avr/pgmspace.h>
+ *
+ *	Part of the simulator build (see sim/Makefile). The host has a flat
+ *	address space so PROGMEM degenerates to nothing and the _P string and
+ *	read functions map to their plain libc equivalents. pgm_read_*() are
+ *	defined as typed dereferences so pointers survive on 64-bit hosts.
+ */
+#ifndef SIM_AVR_PGMSPACE_H_ONCE
+#define SIM_AVR_PGMSPACE_H_ONCE
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+
+#define PROGMEM
+#define PGM_P const char *
+#define PSTR(s) (s)
+
+#define pgm_read_byte(addr)		(*(addr))
+#define pgm_read_word(addr)		(*(addr))
+#define pgm_read_dword(addr)	(*(addr))
+#define pgm_read_float(addr)	(*(addr))
+#define pgm_read_byte_far(addr)	(*(const uint8_t *)(uintptr_t)(addr))
+
+#define strcpy_P	strcpy
+#define strncpy_P	strncpy
+#define strcat_P	strcat
+#define strncat_P	strncat
+#define strcmp_P	strcmp
+#define strncmp_P	strncmp
+#define strlen_P	strlen
+#define strstr_P	strstr
+#define memcpy_P	memcpy
+
+#define printf_P	printf
+#define fprintf_P	fprintf
+#define sprintf_P	sprintf
+#define snprintf_P	snprintf
+#define vfprintf_P	vfprintf
+#define puts_P		puts
+#define fputs_P		fputs
+
+#endif // SIM_AVR_PGMSPACE_H_ONCE
@@ -0,0 +1,456 @@
+/*
+ * sim_main.c - host-native replay harness for the planner / stepper pipeline
+ *
+ *	Builds the real planner.c, plan_line.c, plan_zoid.c, plan_exec.c and
+ *	stepper.c (plus kinematics, encoder and util) as an x86 executable - see
+ *	the Makefile in this directory. The AVR register file is faked (fake/avr)
+ *	and this harness stands in for the interrupt controller: it polls the fake
+ *	timer CTRLA registers and calls the stepper ISRs by name, so the exec /
+ *	load / DDA pipeline runs exactly the firmware's code in the firmware's
+ *	order, just at host speed.
+ *
+ *	Usage: tgsim [-t timeline.csv] [-r] gcode_file
+ *
+ *	The input can be a plain gcode file (see gcode_samples) or one of the
+ *	canned C test files (.h files under gcode and gcode_samples) - quoted
+ *	string lines are unwrapped automatically. Only lines the planner sees are replayed:
+ *	G0/G1 moves with G90/G91 and G20/G21 modality. Arcs (G2/G3) are counted
+ *	and skipped since plan_arc.c runs upstream of the planner queue.
+ *
+ *	-t writes one CSV row per DDA tick on which any motor stepped, giving the
+ *	step timeline. The summary statistics go to stdout.
+ *
+ *	-r replaces the human summary with a single machine-readable CSV row of
+ *	the deterministic statistics (wall time excluded), for the regression
+ *	suite in tests/ - see tests/planner_regression.sh.
+ */
+
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "encoder.h"
+#include "hardware.h"
+#include "settings.h"
+#include "util.h"
+#include "xmega/xmega_rtc.h"
+
+#ifndef NUL
+#define NUL (char)0x00					// xio.h defines this for the firmware proper
+#endif
+
+// stepper ISR entry points - ISR(v) expands to a plain function (fake/avr/interrupt.h)
+void TIMER_DDA_ISR_vect(void);
+void TIMER_DWELL_ISR_vect(void);
+void TIMER_LOAD_ISR_vect(void);
+void TIMER_EXEC_ISR_vect(void);
+
+typedef struct simState {
+	FILE *gcode_file;
+	FILE *timeline_file;
+	uint8_t in_quoted_array;			// reading a gcode/*.h canned file
+	uint8_t distance_mode;				// ABSOLUTE_MODE or INCREMENTAL_MODE
+	uint8_t motion_mode;				// modal group 1 state
+	float unit_scale;					// 1.0 for G21, 25.4 for G20
+	float feed_rate;					// mm/min
+	float position[AXES];				// model position the reader maintains
+
+	uint32_t lines_read;
+	uint32_t blocks_queued;
+	uint32_t blocks_dropped;			// zero-length and sub-minimum-time moves
+	uint32_t arcs_skipped;
+	uint32_t dda_ticks;
+	uint32_t exec_calls;
+	uint32_t load_calls;
+	uint8_t queue_lowater;
+	uint64_t queue_depth_sum;			// queued buffers summed over main loop passes
+	uint32_t queue_samples;
+	uint8_t record_mode;				// -r: emit one CSV row instead of the summary
+	int32_t last_steps[MOTORS];
+	uint8_t eof;
+} simState_t;
+
+static simState_t sim;
+
+/*
+ * _config_machine() - apply the default settings profile
+ *
+ *	Stands in for config_init(): loads the same values settings.h would
+ *	program through the config tables.
+ */
+static void _config_machine(void)
+{
+	const uint8_t motor_map[MOTORS]  = { M1_MOTOR_MAP, M2_MOTOR_MAP, M3_MOTOR_MAP, M4_MOTOR_MAP };
+	const float step_angle[MOTORS]   = { M1_STEP_ANGLE, M2_STEP_ANGLE, M3_STEP_ANGLE, M4_STEP_ANGLE };
+	const float travel_rev[MOTORS]   = { M1_TRAVEL_PER_REV, M2_TRAVEL_PER_REV, M3_TRAVEL_PER_REV, M4_TRAVEL_PER_REV };
+	const float microsteps[MOTORS]   = { M1_MICROSTEPS, M2_MICROSTEPS, M3_MICROSTEPS, M4_MICROSTEPS };
+
+	const float velocity_max[AXES]   = { X_VELOCITY_MAX, Y_VELOCITY_MAX, Z_VELOCITY_MAX,
+										 A_VELOCITY_MAX, B_VELOCITY_MAX, C_VELOCITY_MAX };
+	const float feedrate_max[AXES]   = { X_FEEDRATE_MAX, Y_FEEDRATE_MAX, Z_FEEDRATE_MAX,
+										 A_FEEDRATE_MAX, B_FEEDRATE_MAX, C_FEEDRATE_MAX };
+	const float jerk_max[AXES]       = { X_JERK_MAX, Y_JERK_MAX, Z_JERK_MAX,
+										 A_JERK_MAX, B_JERK_MAX, C_JERK_MAX };
+#ifdef __TRAVERSE_JERK
+	const float jerk_traverse[AXES]  = { X_JERK_TRAVERSE, Y_JERK_TRAVERSE, Z_JERK_TRAVERSE,
+										 A_JERK_TRAVERSE, B_JERK_TRAVERSE, C_JERK_TRAVERSE };
+#endif
+	const float junction_dev[AXES]   = { X_JUNCTION_DEVIATION, Y_JUNCTION_DEVIATION, Z_JUNCTION_DEVIATION,
+										 A_JUNCTION_DEVIATION, B_JUNCTION_DEVIATION, C_JUNCTION_DEVIATION };
+
+	for (uint8_t m=0; m<MOTORS; m++) {
+		st_cfg.mot[m].motor_map = motor_map[m];
+		st_cfg.mot[m].step_angle = step_angle[m];
+		st_cfg.mot[m].travel_rev = travel_rev[m];
+		st_cfg.mot[m].microsteps = microsteps[m];
+		st_cfg.mot[m].polarity = 0;
+		st_cfg.mot[m].power_mode = MOTOR_POWERED_IN_CYCLE;
+		st_cfg.mot[m].steps_per_unit = (360 / step_angle[m]) * microsteps[m] / travel_rev[m];
+		st_cfg.mot[m].units_per_step = travel_rev[m] / ((360 / step_angle[m]) * microsteps[m]);
+	}
+	st_cfg.motor_power_timeout = MOTOR_IDLE_TIMEOUT;
+
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		cm.a[axis].axis_mode = AXIS_STANDARD;
+		cm.a[axis].velocity_max = velocity_max[axis];
+		cm.a[axis].feedrate_max = feedrate_max[axis];
+		cm.a[axis].jerk_max = jerk_max[axis];
+		cm.a[axis].recip_jerk = 1/(jerk_max[axis] * JERK_MULTIPLIER);
+#ifdef __TRAVERSE_JERK
+		cm.a[axis].jerk_traverse = jerk_traverse[axis];
+		cm.a[axis].recip_jerk_traverse = 1/(jerk_traverse[axis] * JERK_MULTIPLIER);
+#endif
+		cm.a[axis].junction_dev = junction_dev[axis];
+	}
+#ifdef __AXIS_TABLE
+	mp_update_axis_table();
+#endif
+	cm.junction_acceleration = JUNCTION_ACCELERATION;
+	cm.machine_state = MACHINE_READY;
+
+	cm.gm.units_mode = MILLIMETERS;
+	cm.gm.distance_mode = ABSOLUTE_MODE;
+	cm.gm.feed_rate_mode = UNITS_PER_MINUTE_MODE;
+	cm.gm.path_control = PATH_CONTINUOUS;
+	cm.gm.select_plane = CANON_PLANE_XY;
+}
+
+/*
+ * _read_line() - get the next gcode line, unwrapping canned C test files
+ *
+ *	The canned .h test files carry the program as one PROGMEM string built
+ *	from continuation lines ending in a backslash-n escape and a backslash.
+ *	Once PROGMEM is seen each subsequent line is unwrapped: everything after
+ *	an opening quote, up to the first escape, quote or backslash.
+ */
+static char *_read_line(char *buf, int len)
+{
+	static char raw[512];
+
+	while (fgets(raw, sizeof(raw), sim.gcode_file) != NULL) {
+		sim.lines_read++;
+		char *start = raw;
+		if (strstr(raw, "PROGMEM") != NULL) {			// entering a canned C test file
+			sim.in_quoted_array = true;
+			start = strchr(raw, '"');
+			if (start == NULL) { continue;}
+			start++;
+		}
+		char *end;
+		if ((end = strstr(start, "\\n")) != NULL) { *end = NUL;}
+		if ((end = strchr(start, '"')) != NULL) { *end = NUL;}
+		if ((end = strchr(start, '\\')) != NULL) { *end = NUL;}
+		if (*start == NUL) { continue;}
+		size_t n = strlen(start);
+		if (n > len-1) { n = len-1;}
+		memcpy(buf, start, n);
+		buf[n] = NUL;
+		return (buf);
+	}
+	sim.eof = true;
+	return (NULL);
+}
+
+/*
+ * _queue_next_block() - parse one line and hand any motion to mp_aline()
+ *
+ *	A deliberately minimal reader: G0/G1/G90/G91/G20/G21, XYZABC and F words.
+ *	It stands in for the gcode interpreter, which runs upstream of the
+ *	planner and isn't part of the pipeline under test.
+ */
+static void _queue_next_block(void)
+{
+	char line[512];
+	float word[AXES];
+	uint8_t seen[AXES];
+	uint8_t motion = false;
+
+	if (_read_line(line, sizeof(line)) == NULL) { return;}
+
+	memset(seen, 0, sizeof(seen));
+	char *p = line;
+	while (*p != NUL) {
+		char c = tolower(*p);
+		if (c == ';') { break;}							// comment to end of line
+		if (c == '(') {									// inline comment
+			while ((*p != NUL) && (*p != ')')) { p++;}
+			if (*p == NUL) { break;}
+			p++;
+			continue;
+		}
+		if (isalpha(c)) {
+			char letter = c;
+			float value = strtod(++p, &p);
+			switch (letter) {
+				case 'g': {
+					int code = (int)value;
+					if ((code == 0) || (code == 1)) { sim.motion_mode = code; motion = true;}
+					else if ((code == 2) || (code == 3)) { sim.arcs_skipped++; return;}
+					else if ((code == 92) || (code == 28) || (code == 30)) { return;}	// offsets not modeled
+					else if (code == 20) { sim.unit_scale = MM_PER_INCH;}
+					else if (code == 21) { sim.unit_scale = 1;}
+					else if (code == 90) { sim.distance_mode = ABSOLUTE_MODE;}
+					else if (code == 91) { sim.distance_mode = INCREMENTAL_MODE;}
+					break;
+				}
+				case 'f': { sim.feed_rate = value * sim.unit_scale; break;}
+				case 'x': { word[AXIS_X] = value; seen[AXIS_X] = true; break;}
+				case 'y': { word[AXIS_Y] = value; seen[AXIS_Y] = true; break;}
+				case 'z': { word[AXIS_Z] = value; seen[AXIS_Z] = true; break;}
+				case 'a': { word[AXIS_A] = value; seen[AXIS_A] = true; break;}
+				case 'b': { word[AXIS_B] = value; seen[AXIS_B] = true; break;}
+				case 'c': { word[AXIS_C] = value; seen[AXIS_C] = true; break;}
+				default: break;							// N, M, T, S and friends are ignored
+			}
+		} else {
+			p++;
+		}
+	}
+
+	uint8_t have_target = false;
+	for (uint8_t axis=0; axis<AXES; axis++) {
+		if (seen[axis] == false) { continue;}
+		have_target = true;
+		float value = word[axis] * ((axis < AXIS_A) ? sim.unit_scale : 1);
+		if (sim.distance_mode == ABSOLUTE_MODE) {
+			sim.position[axis] = value;
+		} else {
+			sim.position[axis] += value;
+		}
+	}
+	if ((have_target == false) || (motion == false && sim.motion_mode > 1)) { return;}
+
+	cm.gm.linenum++;
+	copy_vector(cm.gm.target, sim.position);
+	if ((sim.motion_mode == 0) || (fp_ZERO(sim.feed_rate))) {
+		cm.gm.motion_mode = MOTION_MODE_STRAIGHT_TRAVERSE;
+		cm.gm.feed_rate = 0;
+	} else {
+		cm.gm.motion_mode = MOTION_MODE_STRAIGHT_FEED;
+		cm.gm.feed_rate = sim.feed_rate;
+	}
+	if (cm.cycle_state == CYCLE_OFF) { cm_cycle_start();}
+
+	if (mp_aline(&cm.gm) == STAT_OK) {
+		sim.blocks_queued++;
+	} else {
+		sim.blocks_dropped++;
+	}
+}
+
+/*
+ * _service_interrupts() - stand in for the XMega interrupt controller
+ *
+ *	One pass services each pending fake timer once, highest level first,
+ *	mirroring the hardware priorities: load and DDA at HI, dwell at HI,
+ *	exec at LO. Each DDA ISR call is one 1/FREQUENCY_DDA tick of machine
+ *	time.
+ */
+static uint8_t _service_interrupts(void)
+{
+	uint8_t serviced = false;
+
+	if (TIMER_LOAD.CTRLA != 0) {
+		TIMER_LOAD_ISR_vect();
+		sim.load_calls++;
+		serviced = true;
+	}
+	if (TIMER_DDA.CTRLA != 0) {
+		TIMER_DDA_ISR_vect();
+#ifdef __DDA_SCALE
+		sim.dda_ticks += TIMER_DDA.PER / (uint16_t)((float)F_CPU / FREQUENCY_DDA);	// scaled segments advance more time per tick
+#else
+		sim.dda_ticks++;
+#endif
+		serviced = true;
+		if (sim.timeline_file != NULL) {
+			uint8_t stepped = false;
+			int32_t steps[MOTORS];
+			for (uint8_t m=0; m<MOTORS; m++) {
+				steps[m] = en.en[m].encoder_steps + en.en[m].steps_run;
+				if (steps[m] != sim.last_steps[m]) { stepped = true;}
+			}
+			if (stepped) {
+				fprintf(sim.timeline_file, "%0.1f,%ld,%ld,%ld,%ld\n",
+					(double)sim.dda_ticks * (1000000 / FREQUENCY_DDA),
+					(long)steps[0], (long)steps[1], (long)steps[2], (long)steps[3]);
+				memcpy(sim.last_steps, steps, sizeof(steps));
+			}
+		}
+	}
+	if (TIMER_DWELL.CTRLA != 0) {
+		TIMER_DWELL_ISR_vect();
+		sim.dda_ticks++;								// dwell ticks are machine time too
+		serviced = true;
+	}
+	if (TIMER_EXEC.CTRLA != 0) {
+		TIMER_EXEC_ISR_vect();
+		sim.exec_calls++;
+		serviced = true;
+	}
+	return (serviced);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *timeline_path = NULL;
+	const char *gcode_path = NULL;
+
+	for (int i=1; i<argc; i++) {
+		if ((strcmp(argv[i], "-t") == 0) && (i+1 < argc)) {
+			timeline_path = argv[++i];
+		} else if (strcmp(argv[i], "-r") == 0) {
+			sim.record_mode = true;
+		} else {
+			gcode_path = argv[i];
+		}
+	}
+	if (gcode_path == NULL) {
+		fprintf(stderr, "usage: tgsim [-t timeline.csv] [-r] gcode_file\n");
+		return (1);
+	}
+	if ((sim.gcode_file = fopen(gcode_path, "r")) == NULL) {
+		fprintf(stderr, "tgsim: cannot open %s\n", gcode_path);
+		return (1);
+	}
+	if (timeline_path != NULL) {
+		if ((sim.timeline_file = fopen(timeline_path, "w")) == NULL) {
+			fprintf(stderr, "tgsim: cannot open %s\n", timeline_path);
+			return (1);
+		}
+		fprintf(sim.timeline_file, "usec,m1,m2,m3,m4\n");
+	}
+	sim.unit_scale = 1;
+	sim.motion_mode = 0;
+	sim.distance_mode = ABSOLUTE_MODE;
+	sim.queue_lowater = PLANNER_BUFFER_POOL_SIZE;
+
+	hw.st_port[0] = &PORT_MOTOR_1;		// stands in for _port_bindings() in hardware.c
+	hw.st_port[1] = &PORT_MOTOR_2;
+	hw.st_port[2] = &PORT_MOTOR_3;
+	hw.st_port[3] = &PORT_MOTOR_4;
+
+	stepper_init();
+	encoder_init();
+	planner_init();
+	_config_machine();
+#ifdef __TIME_ESTIMATE
+	est.accumulate = true;				// accumulate planned durations alongside real execution
+#endif
+
+	struct timespec wall_start, wall_end;
+	clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+	while (true) {
+		// feed the planner the way _command_dispatch does - keep headroom free
+		while ((sim.eof == false) &&
+			   (mp_get_planner_buffers_available() > PLANNER_BUFFER_HEADROOM)) {
+			_queue_next_block();
+		}
+		uint8_t avail = mp_get_planner_buffers_available();
+		if (avail < sim.queue_lowater) { sim.queue_lowater = avail;}
+		sim.queue_depth_sum += PLANNER_BUFFER_POOL_SIZE - avail;
+		sim.queue_samples++;
+
+#ifdef __PLAN_THROTTLE
+		mp_plan_queue_callback();					// the controller loop runs this once per pass
+#endif
+		rtc.sys_ticks++;							// nominal 1ms tick per pass - keeps timeouts live
+#ifdef __START_GATE
+		mp_start_gate_callback();					// the controller loop runs this once per pass
+#endif
+
+		if (_service_interrupts() == false) {
+			if (sim.eof && (avail == PLANNER_BUFFER_POOL_SIZE) && (st_runtime_isbusy() == false)) {
+				break;									// drained - done
+			}
+			st_request_exec_move();						// nudge the pipeline awake
+			if (_service_interrupts() == false) {
+				if (sim.eof) { break;}					// nothing runnable remains
+			}
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &wall_end);
+
+	float machine_sec = (float)sim.dda_ticks / FREQUENCY_DDA;
+	float wall_sec = (wall_end.tv_sec - wall_start.tv_sec) +
+					 (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9;
+
+	float queue_mean = (sim.queue_samples > 0) ?
+		(float)sim.queue_depth_sum / sim.queue_samples : 0;
+#ifdef __TIME_ESTIMATE
+	float planned_sec = est.feed_seconds + est.traverse_seconds + est.dwell_seconds;
+#else
+	float planned_sec = 0;
+#endif
+
+	if (sim.record_mode) {				// deterministic fields only - no wall time
+		const char *base = strrchr(gcode_path, '/');
+		base = (base == NULL) ? gcode_path : base + 1;
+		printf("%s,%lu,%lu,%lu,%lu,%0.2f,%0.2f,%lu,%lu,%lu,%u,%0.1f,%ld,%ld,%ld,%ld,%0.3f,%0.3f,%0.3f,%0.3f\n",
+			base, (unsigned long)sim.lines_read, (unsigned long)sim.blocks_queued,
+			(unsigned long)sim.blocks_dropped, (unsigned long)sim.arcs_skipped,
+			machine_sec, planned_sec, (unsigned long)sim.dda_ticks,
+			(unsigned long)sim.exec_calls, (unsigned long)sim.load_calls,
+			sim.queue_lowater, queue_mean,
+			(long)en.en[0].encoder_steps, (long)en.en[1].encoder_steps,
+			(long)en.en[2].encoder_steps, (long)en.en[3].encoder_steps,
+			mp_get_runtime_absolute_position(AXIS_X), mp_get_runtime_absolute_position(AXIS_Y),
+			mp_get_runtime_absolute_position(AXIS_Z), mp_get_runtime_absolute_position(AXIS_A));
+		if (sim.timeline_file != NULL) { fclose(sim.timeline_file);}
+		fclose(sim.gcode_file);
+		return (0);
+	}
+
+	printf("tgsim: %s\n", gcode_path);
+	printf("  lines read        %lu\n", (unsigned long)sim.lines_read);
+	printf("  blocks queued     %lu\n", (unsigned long)sim.blocks_queued);
+	printf("  blocks dropped    %lu (zero length / below minimum time)\n", (unsigned long)sim.blocks_dropped);
+	printf("  arcs skipped      %lu (plan_arc.c is upstream of the planner)\n", (unsigned long)sim.arcs_skipped);
+	printf("  machine time      %0.2f sec (%lu DDA ticks)\n", machine_sec, (unsigned long)sim.dda_ticks);
+#ifdef __TIME_ESTIMATE
+	printf("  planned estimate  %0.2f sec (feed %0.2f, traverse %0.2f, dwell %0.2f)\n",
+		planned_sec, est.feed_seconds, est.traverse_seconds, est.dwell_seconds);
+#endif
+	printf("  wall time         %0.3f sec (%0.0fx real time)\n", wall_sec,
+		(wall_sec > 0) ? machine_sec / wall_sec : 0);
+	printf("  exec passes       %lu\n", (unsigned long)sim.exec_calls);
+	printf("  loader calls      %lu\n", (unsigned long)sim.load_calls);
+	printf("  queue low water   %u of %u buffers (mean depth %0.1f)\n",
+		sim.queue_lowater, PLANNER_BUFFER_POOL_SIZE, queue_mean);
+	printf("  steps             m1:%ld m2:%ld m3:%ld m4:%ld\n",
+		(long)en.en[0].encoder_steps, (long)en.en[1].encoder_steps,
+		(long)en.en[2].encoder_steps, (long)en.en[3].encoder_steps);
+	printf("  final position    X:%0.3f Y:%0.3f Z:%0.3f A:%0.3f\n",
+		mp_get_runtime_absolute_position(AXIS_X), mp_get_runtime_absolute_position(AXIS_Y),
+		mp_get_runtime_absolute_position(AXIS_Z), mp_get_runtime_absolute_position(AXIS_A));
+
+	if (sim.timeline_file != NULL) { fclose(sim.timeline_file);}
+	fclose(sim.gcode_file);
+	return (0);
+}
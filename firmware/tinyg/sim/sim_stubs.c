@@ -0,0 +1,161 @@
+/*
+ * sim_stubs.c - host-side stand-ins for firmware the simulator doesn't compile
+ *
+ *	Part of the simulator build (see sim/Makefile). The simulator links the
+ *	real planner and stepper sources; everything they reference outside that
+ *	pipeline - the canonical machine, config/reporting and the benchmark and
+ *	diagnostic hooks - resolves here. Stubs are the minimum needed to keep the
+ *	planner honest: machine state transitions are tracked so feedhold and
+ *	cycle logic behaves, reporting calls are no-ops.
+ */
+
+#include "tinyg.h"
+#include "config.h"
+#include "canonical_machine.h"
+#include "planner.h"
+#include "stepper.h"
+#include "raster.h"
+#include "report.h"
+#include "test.h"
+#include "diagnostics.h"
+#include "text_parser.h"
+#include "util.h"
+#include "xmega/xmega_rtc.h"
+
+// singletons normally allocated elsewhere in the firmware
+cmSingleton_t cm;						// canonical_machine.c
+benchmark_t bench;						// test.c
+diaSingleton_t dia;						// diagnostics.c
+rsSingleton_t rs;						// raster.c
+rtClock_t rtc;							// xmega_rtc.c
+stat_t status_code;						// main.c
+char global_string_buf[MESSAGE_LEN];	// main.c
+
+/* canonical machine state - enough to keep the planner's cycle logic honest */
+
+uint8_t cm_get_combined_state() { return (cm.machine_state);}
+uint8_t cm_get_units_mode(GCodeState_t *gcode_state) { return (gcode_state->units_mode);}
+uint8_t cm_get_path_control(GCodeState_t *gcode_state) { return (gcode_state->path_control);}
+void cm_set_motion_state(uint8_t motion_state) { cm.motion_state = motion_state;}
+
+void cm_cycle_start()
+{
+	cm.machine_state = MACHINE_CYCLE;
+	cm.cycle_state = CYCLE_MACHINING;
+}
+
+void cm_cycle_end()
+{
+	cm.cycle_state = CYCLE_OFF;
+	cm.motion_state = MOTION_STOP;
+	cm.machine_state = MACHINE_PROGRAM_STOP;
+}
+
+void cm_abort_arc() {}
+#ifdef __CUBIC_SPLINE
+void cm_abort_spline() {}
+#endif
+
+stat_t cm_hard_alarm(stat_t status)
+{
+	fprintf(stderr, "sim: hard alarm, status %d\n", status);
+	exit(1);
+}
+
+/*
+ * cm_state_to_core() / cm_core_to_state() - mirror canonical_machine.c
+ *
+ *	Copied rather than linked because canonical_machine.c drags in the whole
+ *	machining cycle layer. Keep in sync with the originals.
+ */
+void cm_state_to_core(GCodeStateCore_t *core, const GCodeState_t *gcode_state)
+{
+	core->linenum = gcode_state->linenum;
+	core->motion_mode = gcode_state->motion_mode;
+	copy_vector(core->target, gcode_state->target);
+	core->move_time = gcode_state->move_time;
+	core->minimum_time = gcode_state->minimum_time;
+	core->feed_rate = gcode_state->feed_rate;
+	core->spindle_speed = gcode_state->spindle_speed;
+	core->feed_rate_mode = gcode_state->feed_rate_mode;
+	core->select_plane = gcode_state->select_plane;
+	core->units_mode = gcode_state->units_mode;
+	core->coord_system = gcode_state->coord_system;
+	core->path_control = gcode_state->path_control;
+	core->distance_mode = gcode_state->distance_mode;
+	core->tool = gcode_state->tool;
+	core->mist_coolant = gcode_state->mist_coolant;
+	core->flood_coolant = gcode_state->flood_coolant;
+	core->spindle_mode = gcode_state->spindle_mode;
+}
+
+void cm_core_to_state(GCodeState_t *gcode_state, const GCodeStateCore_t *core)
+{
+	gcode_state->linenum = core->linenum;
+	gcode_state->motion_mode = core->motion_mode;
+	copy_vector(gcode_state->target, core->target);
+	gcode_state->move_time = core->move_time;
+	gcode_state->minimum_time = core->minimum_time;
+	gcode_state->feed_rate = core->feed_rate;
+	gcode_state->spindle_speed = core->spindle_speed;
+	gcode_state->feed_rate_mode = core->feed_rate_mode;
+	gcode_state->select_plane = core->select_plane;
+	gcode_state->units_mode = core->units_mode;
+	gcode_state->coord_system = core->coord_system;
+	gcode_state->path_control = core->path_control;
+	gcode_state->distance_mode = core->distance_mode;
+	gcode_state->tool = core->tool;
+	gcode_state->mist_coolant = core->mist_coolant;
+	gcode_state->flood_coolant = core->flood_coolant;
+	gcode_state->spindle_mode = core->spindle_mode;
+}
+
+/* reporting and config - no-ops in the simulator */
+
+stat_t rpt_exception(uint8_t status)
+{
+	fprintf(stderr, "sim: exception report, status %d\n", status);
+	return (status);
+}
+
+stat_t sr_request_status_report(uint8_t request_type) { return (STAT_OK);}
+void qr_request_queue_report(int8_t buffers) {}
+void qr_record_starvation(void) {}
+void net_master_send_segment(float travel_steps[], float segment_time) {}
+nvObj_t *nv_add_conditional_message(const char_t *string) { return (NULL);}
+
+stat_t set_flt(nvObj_t *nv) { return (STAT_OK);}
+stat_t set_flu(nvObj_t *nv) { return (STAT_OK);}
+stat_t set_int(nvObj_t *nv) { return (STAT_OK);}
+stat_t set_ui8(nvObj_t *nv) { return (STAT_OK);}
+
+void text_print_nul(nvObj_t *nv, const char *format) {}
+void text_print_flt(nvObj_t *nv, const char *format) {}
+void text_print_ui8(nvObj_t *nv, const char *format) {}
+void text_print_P(const char *format, ...) {}
+
+void adc_init(uint8_t channel) {}				// thc.c samples a fake arc voltage of zero
+uint16_t adc_read_sample(void) { return (0);}
+
+/* benchmark and diagnostic hooks compiled into the hot path */
+
+uint16_t bench_now() { return (0);}
+void bench_sample_plan(uint16_t start_ticks) {}
+void bench_sample_exec(uint16_t start_ticks) {}
+
+uint16_t dia_now() { return (0);}
+void dia_sample_load(uint16_t start_ticks) {}
+void dia_sample_exec(uint16_t start_ticks) {}
+void trace_log(uint8_t fmt, uint16_t a, uint16_t b) {}
+
+#ifdef __SPINDLE_CSS
+void cm_spindle_css_update(float radius) {}
+#endif
+
+#ifdef __PLAN_EXPORT
+void pex_record_block(mpBuf_t *bf) {}	// export stream is never enabled in the simulator
+#endif
+
+void raster_pixel_advance() {}			// never armed in the simulator
+void gpio_set_bit_on(uint8_t b) {}		// position-triggered outputs (see __SYNC_OUT)
+void gpio_set_bit_off(uint8_t b) {}
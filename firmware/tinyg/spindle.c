@@ -27,18 +27,77 @@
 
 #include "tinyg.h"		// #1
 #include "config.h"		// #2
+#include "settings.h"
 #include "spindle.h"
 #include "gpio.h"
 #include "planner.h"
+#include "util.h"
 #include "hardware.h"
 #include "pwm.h"
+#include "raster.h"
+#ifdef __SPINDLE_READY
+#include "switch.h"
+#include "text_parser.h"
+#include "stepper.h"
+#include "canonical_machine.h"
+#endif
 
 #ifdef __cplusplus
 extern "C"{
 #endif
 
 static void _exec_spindle_control(float *value, float *flag);
+#ifndef __SPINDLE_RAMP
 static void _exec_spindle_speed(float *value, float *flag);
+#endif
+static float _speed_to_duty(uint8_t spindle_mode, float speed);
+#ifdef __SPINDLE_CSS
+static void _exec_spindle_css(float *value, float *flag);
+static void _exec_css_speed(float *value, float *flag);
+#endif
+
+#ifdef __SPINDLE_RAMP
+static struct spRamp {				// asynchronous spindle speed ramp
+	volatile uint8_t busy;			// true while ramping toward the target
+	float current;					// speed currently on the PWM output, in RPM
+	float target;					// speed being ramped to, in RPM
+} ramp;
+#endif
+
+#ifdef __SPINDLE_CSS
+static struct spCSS {				// G96 constant surface speed
+	volatile uint8_t active;		// true while G96 is in effect and driving the PWM
+	float surface_speed;			// programmed surface speed, normalized to mm/min
+	float max_rpm;					// D word - RPM cap, 0 = uncapped
+	float current_rpm;				// last RPM actually written to the PWM
+} css;
+#endif
+
+#ifdef __SPINDLE_RPM
+static void _init_spindle_rpm(void);
+
+static struct spRpm {				// pulse-input RPM channel - see cm_spindle_rpm_callback()
+	float rpm;						// last measured speed
+	uint32_t capture_ms;			// SysTick time of the last capture
+} rpm_in;
+#endif
+
+#ifdef __SPINDLE_READY
+static struct spReady {				// VFD at-speed gate - see cm_spindle_ready_callback()
+	volatile uint8_t waiting;		// true while motion is gated on the at-speed input
+	uint32_t armed_ms;				// SysTick time the gate was armed
+} ready_gate;
+#endif
+
+#ifdef __SPINDLE_SYNC
+static void _init_spindle_sync(void);
+
+static struct spSync {				// spindle encoder state for G33 - see plan_exec.c
+	volatile uint8_t armed;			// ISR latches the next index pulse while true
+	volatile uint8_t index_seen;	// set by the ISR when the index pulse arrives
+	volatile int16_t index_cnt;		// encoder count captured at the index pulse
+} sync;
+#endif
 
 /*
  * cm_spindle_init()
@@ -50,6 +109,10 @@ void cm_spindle_init()
 
     pwm_set_freq(PWM_1, pwm.c[PWM_1].frequency);
     pwm_set_duty(PWM_1, pwm.c[PWM_1].phase_off);
+
+#ifdef __SPINDLE_CSS
+	css.active = false;				// always init in RPM mode (G97)
+#endif
     
 	// make sure spindle is turned off at init
 	if (cm.gm.spindle_active_dir == SPINDLE_ACTIVE_LOW) {
@@ -58,12 +121,31 @@ void cm_spindle_init()
 		gpio_set_bit_off(SPINDLE_BIT);	
 	}
 
+#ifdef __SPINDLE_SYNC
+	_init_spindle_sync();
+#endif
+#ifdef __SPINDLE_RPM
+	_init_spindle_rpm();
+#endif
 }
 
 /*
  * cm_get_spindle_pwm() - return PWM phase (duty cycle) for dir and speed
+ * _speed_to_duty()	    - helper to map a speed to a duty cycle without side effects
  */
 float cm_get_spindle_pwm( uint8_t spindle_mode )
+{
+	if (spindle_mode==SPINDLE_CW || spindle_mode==SPINDLE_CCW ) {
+		// clamp spindle speed to lo/hi range
+		float speed_lo = (spindle_mode == SPINDLE_CW) ? pwm.c[PWM_1].cw_speed_lo : pwm.c[PWM_1].ccw_speed_lo;
+		float speed_hi = (spindle_mode == SPINDLE_CW) ? pwm.c[PWM_1].cw_speed_hi : pwm.c[PWM_1].ccw_speed_hi;
+		if( cm.gm.spindle_speed < speed_lo ) cm.gm.spindle_speed = speed_lo;
+		if( cm.gm.spindle_speed > speed_hi ) cm.gm.spindle_speed = speed_hi;
+	}
+	return (_speed_to_duty(spindle_mode, cm.gm.spindle_speed));
+}
+
+static float _speed_to_duty(uint8_t spindle_mode, float speed)
 {
 	float speed_lo=0, speed_hi=0, phase_lo=0, phase_hi=0;
 	if (spindle_mode == SPINDLE_CW ) {
@@ -79,12 +161,12 @@ float cm_get_spindle_pwm( uint8_t spindle_mode )
 	}
 
 	if (spindle_mode==SPINDLE_CW || spindle_mode==SPINDLE_CCW ) {
-		// clamp spindle speed to lo/hi range
-		if( cm.gm.spindle_speed < speed_lo ) cm.gm.spindle_speed = speed_lo;
-		if( cm.gm.spindle_speed > speed_hi ) cm.gm.spindle_speed = speed_hi;
+		// clamp speed to lo/hi range
+		if( speed < speed_lo ) speed = speed_lo;
+		if( speed > speed_hi ) speed = speed_hi;
 
 		// normalize speed to [0..1]
-		float speed = (cm.gm.spindle_speed - speed_lo) / (speed_hi - speed_lo);
+		speed = (speed - speed_lo) / (speed_hi - speed_lo);
 		return (speed * (phase_hi - phase_lo)) + phase_lo;
 	} else {
 		return pwm.c[PWM_1].phase_off;
@@ -103,6 +185,21 @@ stat_t cm_spindle_control(uint8_t spindle_mode)
 	return(STAT_OK);
 }
 
+#ifdef __HOLD_ACTIONS
+/*
+ * cm_spindle_control_immediate() - execute a spindle command without queuing it
+ *
+ *	Used by the feedhold hold-entry/exit actions, which run while the rest of
+ *	the program is frozen in the planner queue - a queued M5 would wait behind
+ *	the very blocks the hold has stopped. Runs the same exec as the queued path.
+ */
+void cm_spindle_control_immediate(uint8_t spindle_mode)
+{
+	float value[AXES] = { (float)spindle_mode, 0,0,0,0,0 };
+	_exec_spindle_control(value, value);
+}
+#endif
+
 //static void _exec_spindle_control(uint8_t spindle_mode, float f, float *vector, float *flag)
 static void _exec_spindle_control(float *value, float *flag)
 {
@@ -161,22 +258,244 @@ static void _exec_spindle_control(float *value, float *flag)
 #endif // __ARM
 
 	// PWM spindle control
+#ifdef __SPINDLE_RAMP
+	if ((spindle_mode == SPINDLE_CW) || (spindle_mode == SPINDLE_CCW)) {
+		ramp.target = cm.gm.spindle_speed;	// slew to speed from the RTC callback
+		ramp.busy = true;
+	} else {
+		ramp.busy = false;					// stop is immediate - never ramp down through it
+		ramp.current = 0;
+		pwm_set_duty(PWM_1, cm_get_spindle_pwm(spindle_mode) );
+	}
+#else
 	pwm_set_duty(PWM_1, cm_get_spindle_pwm(spindle_mode) );
+#endif
+#ifdef __RASTER
+	if ((spindle_mode != SPINDLE_CW) && (spindle_mode != SPINDLE_CCW)) {
+		raster_disarm();					// spindle off kills any armed scanline
+	}
+#endif
+#ifdef __SPINDLE_READY
+	if ((spindle_mode == SPINDLE_CW) || (spindle_mode == SPINDLE_CCW)) {
+		if (read_switch(SPINDLE_READY_SWITCH) != SW_CLOSED) {	// skip the gate if already at speed
+			ready_gate.waiting = true;
+			ready_gate.armed_ms = SysTickTimer_getValue();
+		}
+	} else {
+		ready_gate.waiting = false;			// spindle off - nothing to wait for
+	}
+#endif
+}
+
+#ifdef __SPINDLE_READY
+/*
+ * cm_spindle_ready_gating()   - true if the first motion after a spindle-on must hold
+ * cm_spindle_ready_callback() - poll the VFD at-speed input while motion is gated
+ *
+ *	VFDs with an at-speed output make the fixed G4 dwell after every M3/M4
+ *	unnecessary. When a spindle-on command executes and the input is not already
+ *	active, motion is gated: mp_exec_move() declines to start the next line
+ *	until the input closes, so spin-up overlaps planning and streaming instead
+ *	of being padded with a worst-case dwell. The input is sampled from the
+ *	controller loop - an at-speed signal is a steady level, so the raw
+ *	read_switch() is sufficient. A VFD that never reports at-speed within
+ *	SPINDLE_READY_TIMEOUT_MS soft-alarms rather than cutting below speed.
+ *	Spindle off or stop cancels the gate. Speed changes do not re-arm it -
+ *	VFDs commonly drop at-speed transiently on an S change and stalling
+ *	mid-path would dwell the cut in place.
+ */
+
+uint8_t cm_spindle_ready_gating(void)
+{
+	return (ready_gate.waiting);
+}
+
+stat_t cm_spindle_ready_callback(void)
+{
+	if (!ready_gate.waiting) { return (STAT_NOOP);}
+#ifdef __SPINDLE_RPM
+	if ((cm.gm.spindle_speed > 0) &&		// measured speed confirms at-speed - no VFD output needed
+		(cm_get_spindle_rpm() >= (cm.gm.spindle_speed * SPINDLE_READY_RPM_FRACTION))) {
+		ready_gate.waiting = false;
+		st_request_exec_move();
+		return (STAT_OK);
+	}
+#endif
+	if (read_switch(SPINDLE_READY_SWITCH) == SW_CLOSED) {
+		ready_gate.waiting = false;
+		st_request_exec_move();				// restart the exec that declined while gated
+		return (STAT_OK);
+	}
+	if ((SysTickTimer_getValue() - ready_gate.armed_ms) > SPINDLE_READY_TIMEOUT_MS) {
+		ready_gate.waiting = false;
+		return (cm_soft_alarm(STAT_SPINDLE_READY_TIMEOUT));
+	}
+	return (STAT_OK);
+}
+#endif // __SPINDLE_READY
+
+#ifdef __SPINDLE_RPM
+/*
+ * _init_spindle_rpm()		  - route the pulse pin to the capture timer
+ * cm_spindle_rpm_callback() - RTC tick readout of the captured period
+ * cm_get_spindle_rpm()		  - last measured speed for other spindle features
+ *
+ *	The event system carries each pulse edge into TIMER_RPM's frequency capture,
+ *	so the period between pulses accumulates entirely in hardware. The RTC tick
+ *	polls the capture flag (reading CCA clears it) and converts the period to
+ *	RPM. If no pulse arrives for SPINDLE_RPM_TIMEOUT_MS the speed reads as zero
+ *	rather than holding the last value forever.
+ */
+static void _init_spindle_rpm(void)
+{
+	SPINDLE_RPM_PORT.DIRCLR = (1 << SPINDLE_RPM_PIN_bp);
+	SPINDLE_RPM_PORT.SPINDLE_RPM_PINCTRL = PORT_OPC_PULLUP_gc;
+	EVSYS.CH4MUX = SPINDLE_RPM_EVSYS_CHMUX;			// pulse pin is the event source
+	EVSYS.CH4CTRL = EVSYS_DIGFILT_2SAMPLES_gc;
+	TIMER_RPM.CTRLD = TC_EVACT_FRQ_gc | TC_EVSEL_CH4_gc;	// frequency capture from the event channel
+	TIMER_RPM.CTRLB = TC1_CCAEN_bm;
+	TIMER_RPM.PER = 0xFFFF;
+	TIMER_RPM.CTRLA = TC_CLKSEL_DIV1024_gc;			// see SPINDLE_RPM_TICK_HZ
+}
+
+void cm_spindle_rpm_callback(void)
+{
+	if (TIMER_RPM.INTFLAGS & TC1_CCAIF_bm) {
+		uint16_t period = TIMER_RPM.CCA;			// reading CCA clears the capture flag
+		rpm_in.capture_ms = SysTickTimer_getValue();
+		if (period > 0) {
+			rpm_in.rpm = ((float)SPINDLE_RPM_TICK_HZ * 60) /
+						 ((float)period * max(1, cm.spindle_pulses_per_rev));
+		}
+	} else if ((SysTickTimer_getValue() - rpm_in.capture_ms) > SPINDLE_RPM_TIMEOUT_MS) {
+		rpm_in.rpm = 0;								// pulses stopped - spindle is stalled or off
+	}
+}
+
+float cm_get_spindle_rpm()
+{
+	return (rpm_in.rpm);
+}
+
+stat_t cm_get_srpm(nvObj_t *nv)
+{
+	nv->value = rpm_in.rpm;
+	nv->precision = GET_TABLE_WORD(precision);
+	nv->valuetype = TYPE_FLOAT;
+	return (STAT_OK);
+}
+
+stat_t cm_set_sppr(nvObj_t *nv)
+{
+	if (nv->value < 1) { nv->value = 1;}			// a zero divisor can't measure anything
+	cm.spindle_pulses_per_rev = (uint8_t)nv->value;
+	return (STAT_OK);
+}
+
+#ifdef __TEXT_MODE
+static const char fmt_srpm[] PROGMEM = "Spindle speed:%15.0f rpm\n";
+static const char fmt_sppr[] PROGMEM = "[sppr] spindle pulses/rev%8d\n";
+void cm_print_srpm(nvObj_t *nv) { text_print_flt(nv, fmt_srpm);}
+void cm_print_sppr(nvObj_t *nv) { text_print_ui8(nv, fmt_sppr);}
+#endif
+#endif // __SPINDLE_RPM
+
+#ifdef __SPINDLE_SYNC
+/*
+ * _init_spindle_sync()          - set up the spindle encoder and index pulse capture
+ * cm_spindle_sync_arm()         - discard any stale index and latch the next one
+ * cm_spindle_sync_index_seen()  - true once the index pulse has arrived
+ * cm_spindle_sync_index_count() - encoder count captured at the index pulse
+ * cm_spindle_sync_count()       - current encoder count
+ *
+ *	The quadrature setup matches _init_qdec() in encoder.c (event channel 0
+ *	feeding SPINDLE_SYNC_TIMER), which is why __SPINDLE_SYNC and __QDEC_ENCODER
+ *	are mutually exclusive. The index pin adds a MED level port interrupt that
+ *	fires once per revolution; the ISR only latches the count while armed, so
+ *	every threading pass engages at the same spindle angle and repeated passes
+ *	over the same thread track each other. int16 count differences are
+ *	wrap-safe for anything under 32767 counts between samples.
+ */
+
+static void _init_spindle_sync(void)
+{
+	SPINDLE_SYNC_PORT.DIRCLR = (3 << SPINDLE_SYNC_PHASE0_bp) | (1 << SPINDLE_SYNC_INDEX_bp);
+	(&SPINDLE_SYNC_PORT.PIN0CTRL)[SPINDLE_SYNC_PHASE0_bp]   = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	(&SPINDLE_SYNC_PORT.PIN0CTRL)[SPINDLE_SYNC_PHASE0_bp+1] = PORT_ISC_LEVEL_gc | PORT_OPC_PULLUP_gc;
+	(&SPINDLE_SYNC_PORT.PIN0CTRL)[SPINDLE_SYNC_INDEX_bp]    = PORT_ISC_RISING_gc | PORT_OPC_PULLUP_gc;
+	EVSYS.CH0MUX = SPINDLE_SYNC_EVSYS_CHMUX;		// phase A pin is the event source
+	EVSYS.CH0CTRL = EVSYS_QDEN_bm | EVSYS_DIGFILT_2SAMPLES_gc;
+	SPINDLE_SYNC_TIMER.CTRLD = TC_EVACT_QDEC_gc | TC_EVSEL_CH0_gc;
+	SPINDLE_SYNC_TIMER.PER = 0xFFFF;
+	SPINDLE_SYNC_TIMER.CTRLA = TC_CLKSEL_DIV1_gc;
+	SPINDLE_SYNC_PORT.INT0MASK = (1 << SPINDLE_SYNC_INDEX_bp);
+	SPINDLE_SYNC_PORT.INTCTRL |= PORT_INT0LVL_MED_gc;
+}
+
+ISR(SPINDLE_SYNC_ISR_vect)
+{
+	if (sync.armed) {
+		sync.index_cnt = (int16_t)SPINDLE_SYNC_TIMER.CNT;
+		sync.index_seen = true;
+		sync.armed = false;
+	}
+}
+
+void cm_spindle_sync_arm(void)
+{
+	sync.index_seen = false;
+	sync.armed = true;
 }
 
+uint8_t cm_spindle_sync_index_seen(void)
+{
+	return (sync.index_seen);
+}
+
+int16_t cm_spindle_sync_index_count(void)
+{
+	return (sync.index_cnt);
+}
+
+int16_t cm_spindle_sync_count(void)
+{
+	return ((int16_t)SPINDLE_SYNC_TIMER.CNT);
+}
+#endif // __SPINDLE_SYNC
+
 /*
  * cm_set_spindle_speed() 	- queue the S parameter to the planner buffer
  * cm_exec_spindle_speed() 	- execute the S command (called from the planner buffer)
  * _exec_spindle_speed()	- spindle speed callback from planner queue
+ *
+ *	With __SPINDLE_RAMP defined the S word does not consume a planner buffer.
+ *	The new speed is handed to the ramp engine, which slews the PWM output
+ *	toward it from the RTC tick while motion continues to plan and execute.
  */
 stat_t cm_set_spindle_speed(float speed)
 {
 //	if (speed > cfg.max_spindle speed)
 //        return (STAT_MAX_SPINDLE_SPEED_EXCEEDED);
 
+#ifdef __SPINDLE_CSS
+	if (cm.gmx.spindle_speed_mode == SPINDLE_CSS_MODE) {
+		cm_set_spindle_speed_parameter(MODEL, speed);		// reports show S as programmed
+		float value[AXES] = { speed * ((cm_get_units_mode(MODEL) == INCHES) ? (12 * MM_PER_INCH) : 1000), 0,0,0,0,0 };
+		mp_queue_command(_exec_css_speed, value, value);	// surface speed normalized to mm/min
+		return (STAT_OK);
+	}
+#endif
+#ifdef __SPINDLE_RAMP
+	cm_set_spindle_speed_parameter(MODEL, speed);
+	ramp.busy = false;						// close the ramp while the target changes
+	ramp.target = speed;
+	ramp.busy = true;
+	return (STAT_OK);
+#else
 	float value[AXES] = { speed, 0,0,0,0,0 };
 	mp_queue_command(_exec_spindle_speed, value, value);
 	return (STAT_OK);
+#endif
 }
 
 void cm_exec_spindle_speed(float speed)
@@ -184,11 +503,117 @@ void cm_exec_spindle_speed(float speed)
 	cm_set_spindle_speed(speed);
 }
 
+#ifndef __SPINDLE_RAMP
 static void _exec_spindle_speed(float *value, float *flag)
 {
 	cm_set_spindle_speed_parameter(MODEL, value[0]);
+#ifdef __PWM_DUTY_TABLE
+	if ((cm.gm.spindle_mode == SPINDLE_CW) || (cm.gm.spindle_mode == SPINDLE_CCW)) {
+		pwm_set_duty_for_speed(PWM_1, (cm.gm.spindle_mode == SPINDLE_CW) ? PWM_CW : PWM_CCW, cm.gm.spindle_speed);
+		return;
+	}
+#endif
 	pwm_set_duty(PWM_1, cm_get_spindle_pwm(cm.gm.spindle_mode) ); // update spindle speed if we're running
 }
+#endif
+
+#ifdef __SPINDLE_CSS
+/*
+ * cm_set_css_max_rpm()        - D word - cap the RPM while G96 is active
+ * cm_set_spindle_speed_mode() - G96/G97 - queue the spindle speed mode switch
+ * _exec_spindle_css()         - planner callback for the mode switch
+ * _exec_css_speed()           - planner callback for an S word while G96 is active
+ * cm_spindle_css_update()     - recompute the RPM from the X radius (segment rate)
+ *
+ *	In CSS mode the S word is a surface speed - meters/min under G21, feet/min
+ *	under G20 - normalized to mm/min when it queues. The runtime recomputes the
+ *	RPM from the X work radius once per segment (LO interrupt level, from
+ *	_exec_aline_segment()), capped by the D word, and rewrites the PWM only when
+ *	the result moved by CSS_MIN_DELTA_RPM. Mode and speed changes ride the
+ *	planner queue like every other spindle command, so they take effect in
+ *	program order. The Gcode model is not disturbed - it carries the programmed
+ *	surface speed for reporting, the way the ramp engine carries its slew.
+ */
+stat_t cm_set_css_max_rpm(float max_rpm)
+{
+	cm.gmx.css_max_rpm = max_rpm;
+	return (STAT_OK);
+}
+
+stat_t cm_set_spindle_speed_mode(uint8_t mode)
+{
+	cm.gmx.spindle_speed_mode = mode;						// set now - routes the S word in this block
+	float value[AXES] = { (float)mode, cm.gmx.css_max_rpm, 0,0,0,0 };
+	mp_queue_command(_exec_spindle_css, value, value);
+	return (STAT_OK);
+}
+
+static void _exec_spindle_css(float *value, float *flag)
+{
+	css.active = (fp_ZERO(value[0])) ? false : true;		// G97 leaves the PWM at the last CSS speed
+	css.max_rpm = value[1];
+	css.current_rpm = 0;									// force the next segment to rewrite the PWM
+}
+
+static void _exec_css_speed(float *value, float *flag)
+{
+	css.surface_speed = value[0];
+	css.current_rpm = 0;
+}
+
+void cm_spindle_css_update(float radius)
+{
+	if (css.active == false) return;
+	if ((cm.gm.spindle_mode != SPINDLE_CW) && (cm.gm.spindle_mode != SPINDLE_CCW)) return;
+
+	float rpm = css.surface_speed / (2 * M_PI * max(radius, CSS_MIN_RADIUS));
+	if ((css.max_rpm > 0) && (rpm > css.max_rpm)) { rpm = css.max_rpm;}
+	if (fabs(rpm - css.current_rpm) < CSS_MIN_DELTA_RPM) return;
+	css.current_rpm = rpm;
+#ifdef __SPINDLE_RAMP
+	ramp.busy = false;										// CSS owns the output while active
+	ramp.current = rpm;
+	ramp.target = rpm;
+#endif
+#ifdef __PWM_DUTY_TABLE
+	pwm_set_duty_for_speed(PWM_1, (cm.gm.spindle_mode == SPINDLE_CW) ? PWM_CW : PWM_CCW, rpm);
+#else
+	pwm_set_duty(PWM_1, _speed_to_duty(cm.gm.spindle_mode, rpm));
+#endif
+}
+#endif // __SPINDLE_CSS
+
+#ifdef __SPINDLE_RAMP
+/*
+ * cm_spindle_ramp_callback() - slew the PWM output toward the target speed
+ *
+ *	Called from the RTC on each ~10ms tick (LO interrupt level). Costs a test
+ *	and return when no ramp is in flight. The duty cycle is computed from the
+ *	ramped speed without disturbing the Gcode model, which already carries the
+ *	target. Output only happens while the spindle is running - a stop drops
+ *	the PWM to phase_off immediately in _exec_spindle_control().
+ */
+void cm_spindle_ramp_callback(void)
+{
+	if (!ramp.busy) return;
+	if ((cm.gm.spindle_mode != SPINDLE_CW) && (cm.gm.spindle_mode != SPINDLE_CCW)) {
+		ramp.busy = false;
+		return;
+	}
+	float step = SPINDLE_RAMP_RPM_PER_SEC * (RTC_MILLISECONDS * 0.001);
+	if (fabs(ramp.target - ramp.current) <= step) {
+		ramp.current = ramp.target;
+		ramp.busy = false;					// target reached
+	} else {
+		ramp.current += (ramp.target > ramp.current) ? step : -step;
+	}
+#ifdef __PWM_DUTY_TABLE
+	pwm_set_duty_for_speed(PWM_1, (cm.gm.spindle_mode == SPINDLE_CW) ? PWM_CW : PWM_CCW, ramp.current);
+#else
+	pwm_set_duty(PWM_1, _speed_to_duty(cm.gm.spindle_mode, ramp.current));
+#endif
+}
+#endif // __SPINDLE_RAMP
 
 #ifdef __cplusplus
 }
@@ -32,6 +32,35 @@
 extern "C"{
 #endif
 
+#ifdef __SPINDLE_SYNC
+/* Spindle encoder for G33 synchronized feeds. Quadrature phases are decoded in
+ * hardware exactly as __QDEC_ENCODER does it (same event channel and timer, so
+ * the two features are mutually exclusive), plus a once-per-rev index pulse on
+ * a port interrupt to anchor each threading pass at the same spindle angle.
+ */
+#define SPINDLE_SYNC_TIMER		TCF1			// counts decoded quadrature events
+#define SPINDLE_SYNC_PORT		PORTB			// encoder port
+#define SPINDLE_SYNC_PHASE0_bp	2				// phase A bit position (phase B is the next bit up)
+#define SPINDLE_SYNC_INDEX_bp	4				// index pulse bit position
+#define SPINDLE_SYNC_EVSYS_CHMUX EVSYS_CHMUX_PORTB_PIN2_gc	// phase A pin as event source
+#define SPINDLE_SYNC_ISR_vect	PORTB_INT0_vect	// index pulse interrupt
+#endif
+
+#ifdef __SPINDLE_RPM
+/* Pulse-input RPM channel. A once (or N times, see $sppr) per revolution pulse
+ * is routed through the event system into a timer's input capture, so counting
+ * costs no interrupts; the captured period is read out at the RTC tick. Uses
+ * the unallocated TCC1 (TIMER_5 in system.h) and event channel 4.
+ */
+#define TIMER_RPM				TCC1			// captures the pulse period
+#define SPINDLE_RPM_PORT		PORTB			// pulse input port
+#define SPINDLE_RPM_PIN_bp		5				// pulse input bit position
+#define SPINDLE_RPM_PINCTRL		PIN5CTRL		// must agree with the line above
+#define SPINDLE_RPM_EVSYS_CHMUX	EVSYS_CHMUX_PORTB_PIN5_gc	// ditto (channels 0/2 belong to the encoders)
+#define SPINDLE_RPM_TICK_HZ		(F_CPU / 1024)	// capture timebase - 16 bits wrap at ~28 RPM with 1 ppr
+#define SPINDLE_RPM_TIMEOUT_MS	2000			// no capture for this long reads as 0 RPM
+#endif
+
 /*
  * Global Scope Functions
  */
@@ -42,8 +71,49 @@ stat_t cm_set_spindle_speed(float speed);			// S parameter
 void cm_exec_spindle_speed(float speed);			// callback for above
 
 stat_t cm_spindle_control(uint8_t spindle_mode);	// M3, M4, M5 integrated spindle control
+#ifdef __HOLD_ACTIONS
+void cm_spindle_control_immediate(uint8_t spindle_mode);	// execute now - do not queue
+#endif
+#ifdef __SPINDLE_READY
+uint8_t cm_spindle_ready_gating(void);				// true while motion is gated on the at-speed input
+stat_t cm_spindle_ready_callback(void);			// poll the at-speed input and release the gate
+#endif
 void cm_exec_spindle_control(uint8_t spindle_mode);	// callback for above
 
+#ifdef __SPINDLE_SYNC
+void cm_spindle_sync_arm(void);						// capture the next index pulse
+uint8_t cm_spindle_sync_index_seen(void);			// true once the index pulse has arrived
+int16_t cm_spindle_sync_index_count(void);			// encoder count latched at the index pulse
+int16_t cm_spindle_sync_count(void);				// current encoder count
+#endif
+
+#ifdef __SPINDLE_RAMP
+void cm_spindle_ramp_callback(void);				// called from the RTC tick
+#endif
+
+#ifdef __SPINDLE_RPM
+void cm_spindle_rpm_callback(void);					// called from the RTC tick - read the capture timer
+float cm_get_spindle_rpm(void);						// last measured spindle speed
+stat_t cm_get_srpm(nvObj_t *nv);					// $srpm - measured RPM (see config_app.c)
+stat_t cm_set_sppr(nvObj_t *nv);					// $sppr - sensor pulses per revolution
+#ifdef __TEXT_MODE
+void cm_print_srpm(nvObj_t *nv);
+void cm_print_sppr(nvObj_t *nv);
+#else
+#define cm_print_srpm tx_print_stub
+#define cm_print_sppr tx_print_stub
+#endif
+#endif
+
+#ifdef __SPINDLE_CSS
+#define CSS_MIN_DELTA_RPM	1.0					// don't rewrite the PWM for changes smaller than this
+#define CSS_MIN_RADIUS		0.010				// radius floor (mm) so the RPM computation can't blow up
+
+stat_t cm_set_spindle_speed_mode(uint8_t mode);		// G96, G97
+stat_t cm_set_css_max_rpm(float max_rpm);			// D word - RPM cap while G96 is active
+void cm_spindle_css_update(float radius);			// segment-rate RPM recompute (planner runtime)
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -33,9 +33,14 @@
 #include "config.h"
 #include "stepper.h"
 #include "encoder.h"
+#include "network.h"
+#include "raster.h"
 #include "planner.h"
 #include "report.h"
 #include "hardware.h"
+#include "gpio.h"
+#include "test.h"
+#include "diagnostics.h"
 #include "text_parser.h"
 #include "util.h"
 
@@ -45,10 +50,23 @@ stConfig_t st_cfg;
 stPrepSingleton_t st_pre;
 static stRunSingleton_t st_run;
 
+#ifdef __PREP_AHEAD
+static stPrepSingleton_t st_stage;		// second prep buffer - exec preps here while st_pre waits for the loader
+static uint8_t st_pipeline_hot;			// the loader consumed a move on its last run (near-miss detection)
+#define st_exec_pre st_stage			// the buffer the exec/prep side fills
+#else
+#define st_exec_pre st_pre
+#endif
+
 /**** Setup local functions ****/
 
 static void _load_move(void);
 static void _request_load_move(void);
+static void _set_hw_microsteps(const uint8_t motor, const uint8_t microsteps);
+#ifdef __PREP_AHEAD
+static void _transfer_prep(void);
+static void _stage_to_pre(void);
+#endif
 #ifdef __ARM
 static void _set_motor_power_level(const uint8_t motor, const float power_level);
 #endif
@@ -215,6 +233,9 @@ void stepper_init()
 	TIMER_DDA.CTRLA = STEP_TIMER_DISABLE;		// turn timer off
 	TIMER_DDA.CTRLB = STEP_TIMER_WGMODE;		// waveform mode
 	TIMER_DDA.INTCTRLA = TIMER_DDA_INTLVL;		// interrupt mode
+#ifdef __STEP_PULSE_TIMER
+	TIMER_DDA.INTCTRLB = TIMER_DDA_CCAINTLVL;	// compare interrupt times the step pulse trailing edges
+#endif
 
 	// setup DWELL timer
 	TIMER_DWELL.CTRLA = STEP_TIMER_DISABLE;		// turn timer off
@@ -234,6 +255,9 @@ void stepper_init()
 	TIMER_EXEC.PER = EXEC_TIMER_PERIOD;			// set period
 
 	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;
+#ifdef __PREP_AHEAD
+	st_stage.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;
+#endif
 	st_reset();									// reset steppers to known state
 #endif // __AVR
 
@@ -272,6 +296,10 @@ void stepper_init_assertions()
 	st_run.magic_start = MAGICNUM;
 	st_pre.magic_end = MAGICNUM;
 	st_pre.magic_start = MAGICNUM;
+#ifdef __PREP_AHEAD
+	st_stage.magic_end = MAGICNUM;
+	st_stage.magic_start = MAGICNUM;
+#endif
 }
 
 stat_t stepper_test_assertions()
@@ -280,6 +308,10 @@ stat_t stepper_test_assertions()
 	if (st_run.magic_start	!= MAGICNUM) return (STAT_STEPPER_ASSERTION_FAILURE);
 	if (st_pre.magic_end	!= MAGICNUM) return (STAT_STEPPER_ASSERTION_FAILURE);
 	if (st_pre.magic_start	!= MAGICNUM) return (STAT_STEPPER_ASSERTION_FAILURE);
+#ifdef __PREP_AHEAD
+	if (st_stage.magic_end	 != MAGICNUM) return (STAT_STEPPER_ASSERTION_FAILURE);
+	if (st_stage.magic_start != MAGICNUM) return (STAT_STEPPER_ASSERTION_FAILURE);
+#endif
 	return (STAT_OK);
 }
 
@@ -303,15 +335,64 @@ uint8_t st_runtime_isbusy()
  * st_reset() - reset stepper internals
  */
 
-void st_reset()
-{
-	for (uint8_t motor=0; motor<MOTORS; motor++) {
-		st_pre.mot[motor].prev_direction = STEP_INITIAL_DIRECTION;
-		st_run.mot[motor].substep_accumulator = 0;	// will become max negative during per-motor setup;
-		st_pre.mot[motor].corrected_steps = 0;		// diagnostic only - no action effect
+void st_reset()
+{
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		st_pre.mot[motor].prev_direction = STEP_INITIAL_DIRECTION;
+		st_run.mot[motor].substep_accumulator = 0;	// will become max negative during per-motor setup;
+		st_exec_pre.mot[motor].corrected_steps = 0;	// diagnostic only - no action effect
+#ifdef __PREP_AHEAD
+		st_pre.mot[motor].corrected_steps = 0;		// ...and its display copy (see _transfer_prep)
+#endif
+#ifdef __BACKLASH_COMP
+		st_exec_pre.mot[motor].backlash_offset = 0;	// takeup state is unknown after a reset
+#endif
+#ifdef __STEP_CORRECTION_FINE
+		st_exec_pre.mot[motor].error_persist = 0;
+#endif
+#ifdef __MICROSTEP_GEARING
+		st_pre.mot[motor].gear = 1;					// restore the configured microstep mode...
+		st_exec_pre.mot[motor].gear = 1;
+		st_exec_pre.mot[motor].gear_change_flag = false;
+		_set_hw_microsteps(motor, st_cfg.mot[motor].microsteps);	// ...and its mode pins (no-op before config)
+#endif
 	}
-	mp_set_steps_to_runtime_position();
-}
+#ifdef __DUAL_ENDSTOP
+	st_run.motor_gate_bm = 0;						// a reset clears any endstop gating
+#endif
+	mp_set_steps_to_runtime_position();
+}
+
+#ifdef __DUAL_ENDSTOP
+/*
+ * st_gate_motor()    - stop step generation for one motor without disturbing the others
+ * st_ungate_motors() - re-enable step generation for all gated motors
+ *
+ *	Used for gantry auto-squaring: two motors mapped to the same axis home together,
+ *	and each is stopped individually the instant its own endstop closes while its
+ *	partner keeps seeking. Gating zeroes the motor's runtime substep increment so the
+ *	DDA stops issuing pulses (and stops counting encoder steps) on the very next tick.
+ *	The gate is held in motor_gate_bm and re-applied by the loader on every segment,
+ *	since the loader refreshes substep increments from the prep buffer. Callable from
+ *	any interrupt level at or below the DDA: the DDA may preempt the multi-byte store
+ *	of the increment, but a partially cleared value can only be smaller than the
+ *	original, so the worst case is one final step at the commanded rate.
+ */
+
+void st_gate_motor(const uint8_t motor)
+{
+	st_run.motor_gate_bm |= (1 << motor);
+	st_run.mot[motor].substep_increment = 0;
+#ifdef __DDA_PULSE_CORE
+	st_run.mot[motor].step_mask = 0;
+#endif
+}
+
+void st_ungate_motors()
+{
+	st_run.motor_gate_bm = 0;				// increments are restored by the next segment load
+}
+#endif // __DUAL_ENDSTOP
 
 /*
  * st_clc() - clear counters
@@ -335,29 +416,43 @@ stat_t st_clc(nvObj_t *nv)	// clear diagnostic counters, reset stepper prep
  * st_motor_power_callback() - callback to manage motor power sequencing
  */
 
+#ifdef __MOTOR_POWER_EVENTS
+/* Event scheduling state for st_motor_power_callback(). The event flag is armed
+ * by the loader when movement ends, by the energize/deenergize entry points,
+ * and by the power config setters. Pending countdowns schedule a wakeup systick
+ * instead of keeping the flag armed, so a quiescent or moving machine gets
+ * through the callback on a flag test and (at most) one systick compare.
+ */
+static volatile uint8_t st_power_event = true;	// force an initial pass to enforce boot power states
+static uint32_t st_power_wakeup;				// systick of next countdown check (0 = none pending)
+#define _arm_power_event() (st_power_event = true)
+#else
+#define _arm_power_event()
+#endif
+
 static uint8_t _motor_is_enabled(uint8_t motor)
 {
 	uint8_t port;
-	switch(motor) {
-		case (MOTOR_1): { port = PORT_MOTOR_1_VPORT.OUT; break; }
-		case (MOTOR_2): { port = PORT_MOTOR_2_VPORT.OUT; break; }
-		case (MOTOR_3): { port = PORT_MOTOR_3_VPORT.OUT; break; }
-		case (MOTOR_4): { port = PORT_MOTOR_4_VPORT.OUT; break; }
-		default: port = 0xff;	// defaults to disabled for bad motor input value
-	}
-	return ((port & MOTOR_ENABLE_BIT_bm) ? 0 : 1);	// returns 1 if motor is enabled (motor is actually active low)
+	switch(motor) {
+		case (MOTOR_1): { port = PORT_MOTOR_1_VPORT.OUT; break; }
+		case (MOTOR_2): { port = PORT_MOTOR_2_VPORT.OUT; break; }
+		case (MOTOR_3): { port = PORT_MOTOR_3_VPORT.OUT; break; }
+		case (MOTOR_4): { port = PORT_MOTOR_4_VPORT.OUT; break; }
+		default: port = 0xff;	// defaults to disabled for bad motor input value
+	}
+	return ((port & MOTOR_ENABLE_BIT_bm) ? 0 : 1);	// returns 1 if motor is enabled (motor is actually active low)
 }
 
 static void _deenergize_motor(const uint8_t motor)
-{
+{
 #ifdef __AVR
-	switch (motor) {
-		case (MOTOR_1): { PORT_MOTOR_1_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_2): { PORT_MOTOR_2_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_3): { PORT_MOTOR_3_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_4): { PORT_MOTOR_4_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
-	}
-	st_run.mot[motor].power_state = MOTOR_OFF;
+	switch (motor) {
+		case (MOTOR_1): { PORT_MOTOR_1_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_2): { PORT_MOTOR_2_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_3): { PORT_MOTOR_3_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_4): { PORT_MOTOR_4_VPORT.OUT |= MOTOR_ENABLE_BIT_bm; break; }
+	}
+	st_run.mot[motor].power_state = MOTOR_OFF;
 #endif
 #ifdef __ARM
 	// Motors that are not defined are not compiled. Saves some ugly #ifdef code
@@ -368,8 +463,8 @@ static void _deenergize_motor(const uint8_t motor)
 	if (!motor_5.enable.isNull()) if (motor == MOTOR_5) motor_5.enable.set();
 	if (!motor_6.enable.isNull()) if (motor == MOTOR_6) motor_6.enable.set();
 	st_run.mot[motor].power_state = MOTOR_OFF;
-#endif
-}
+#endif
+}
 
 static void _energize_motor(const uint8_t motor)
 {
@@ -378,12 +473,12 @@ static void _energize_motor(const uint8_t motor)
 		return;
 	}
 #ifdef __AVR
-	switch(motor) {
-		case (MOTOR_1): { PORT_MOTOR_1_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_2): { PORT_MOTOR_2_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_3): { PORT_MOTOR_3_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
-		case (MOTOR_4): { PORT_MOTOR_4_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
-	}
+	switch(motor) {
+		case (MOTOR_1): { PORT_MOTOR_1_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_2): { PORT_MOTOR_2_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_3): { PORT_MOTOR_3_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
+		case (MOTOR_4): { PORT_MOTOR_4_VPORT.OUT &= ~MOTOR_ENABLE_BIT_bm; break; }
+	}
 #endif
 #ifdef __ARM
 	// Motors that are not defined are not compiled. Saves some ugly #ifdef code
@@ -395,7 +490,8 @@ static void _energize_motor(const uint8_t motor)
 	if (!motor_5.enable.isNull()) if (motor == MOTOR_5) motor_5.energize(MOTOR_5);
 	if (!motor_6.enable.isNull()) if (motor == MOTOR_6) motor_6.energize(MOTOR_6);
 #endif
-	st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
+	st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
+	_arm_power_event();
 }
 
 /*
@@ -424,8 +520,8 @@ void st_energize_motors()
 		_energize_motor(motor);
 		st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;
 	}
-#ifdef __ARM
-	common_enable.clear();			// enable gShield common enable
+#ifdef __ARM
+	common_enable.clear();			// enable gShield common enable
 #endif
 }
 
@@ -434,18 +530,36 @@ void st_deenergize_motors()
 	for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 		_deenergize_motor(motor);
 	}
-#ifdef __ARM
-	common_enable.set();			// disable gShield common enable
-#endif
+#ifdef __ARM
+	common_enable.set();			// disable gShield common enable
+#endif
+	_arm_power_event();				// so MOTOR_ALWAYS_POWERED motors get re-enforced
 }
 
 /*
  * st_motor_power_callback() - callback to manage motor power sequencing
  *
  *	Handles motor power-down timing, low-power idle, and adaptive motor power
+ *
+ *	With __MOTOR_POWER_EVENTS the callback is event scheduled instead of polled.
+ *	It runs when armed (movement ended, a power entry point or setter changed
+ *	something) or when a pending countdown's wakeup systick arrives; all other
+ *	controller passes exit on the flag test. One consequence: a motor left idle
+ *	by a long job starts its power-down countdown when motion ends rather than
+ *	mid-job, so it stays energized until the job (or a planner starvation gap)
+ *	lets the loader run dry.
  */
 stat_t st_motor_power_callback() 	// called by controller
 {
+#ifdef __MOTOR_POWER_EVENTS
+	if (!st_power_event) {			// no event - check for a scheduled countdown wakeup
+		if ((st_power_wakeup == 0) || (SysTickTimer_getValue() < st_power_wakeup)) {
+			return (STAT_NOOP);
+		}
+	}
+	st_power_event = false;
+	st_power_wakeup = 0;			// rescheduled below if countdowns are still pending
+#endif
 	// manage power for each motor individually
 	for (uint8_t m = MOTOR_1; m < MOTORS; m++) {
 
@@ -470,11 +584,7 @@ stat_t st_motor_power_callback() 	// called by controller
 
 		// do not process countdown if in a feedhold
 		if (cm_get_combined_state() == COMBINED_HOLD) {
-			continue;
-		}
-
-		// do not process countdown if in a feedhold
-		if (cm_get_combined_state() == COMBINED_HOLD) {
+			_arm_power_event();		// revisit when the hold ends
 			continue;
 		}
 
@@ -485,12 +595,40 @@ stat_t st_motor_power_callback() 	// called by controller
 				_deenergize_motor(m);
                 sr_request_status_report(SR_TIMED_REQUEST);		// request a status report when motors shut down
 			}
+#ifdef __MOTOR_POWER_EVENTS
+			else if ((st_power_wakeup == 0) || (st_run.mot[m].power_systick < st_power_wakeup)) {
+				st_power_wakeup = st_run.mot[m].power_systick;	// schedule the next countdown check
+			}
+#endif
 		}
 	}
 	return (STAT_OK);
 }
 
 
+#ifdef __SYNC_OUT
+/*
+ *	Position-triggered output (armed by st_arm_sync_out). The armed motor's
+ *	step events decrement a countdown; crossing zero changes the GPIO bits
+ *	from the DDA ISR, so the trigger lands on an exact step boundary. Costs
+ *	one test per generated step when disarmed.
+ */
+static void _sync_out_fire(void)
+{
+	if (st_run.sync_out_set) {
+		gpio_set_bit_on(st_run.sync_out_bitmask);
+	} else {
+		gpio_set_bit_off(st_run.sync_out_bitmask);
+	}
+}
+#define SYNC_OUT_DDA_TICK(m) \
+	if ((st_run.mot[m].sync_out_steps != 0) && (--st_run.mot[m].sync_out_steps == 0)) { _sync_out_fire();}
+#define SYNC_OUT_DDA_TICK_MASKED(m, step) if (step) { SYNC_OUT_DDA_TICK(m);}
+#else
+#define SYNC_OUT_DDA_TICK(m)
+#define SYNC_OUT_DDA_TICK_MASKED(m, step)
+#endif // __SYNC_OUT
+
 /******************************
  * Interrupt Service Routines *
  ******************************/
@@ -504,40 +642,148 @@ stat_t st_motor_power_callback() 	// called by controller
  *	Uses direct struct addresses and literal values for hardware devices - it's faster than
  *	using indexed timer and port accesses. I checked. Even when -0s or -03 is used.
  */
+#ifdef __DDA_PULSE_CORE
+/*
+ *	Pulse core variant: each motor's step condition is extracted from the accumulator
+ *	sign as a 0x00/0xFF mask, and the port write, accumulator subtract and encoder
+ *	increment all ride that mask unconditionally. This flattens the per-motor
+ *	conditionals out of the worst-case path - every tick costs the same whether 0 or 4
+ *	motors step - which is what bounds ISR duration when raising FREQUENCY_DDA.
+ *	step_mask is precomputed by the loader: STEP_BIT_bm for active motors, 0 for idle
+ *	ones, so idle channels never dirty their ports.
+ */
+ISR(TIMER_DDA_ISR_vect)
+{
+	int32_t accum;
+	uint8_t step;
+
+	accum = (st_run.mot[MOTOR_1].substep_accumulator += st_run.mot[MOTOR_1].substep_increment);
+	step = (uint8_t)((uint32_t)(-accum) >> 31);			// 1 if accumulator > 0, else 0 - no branch
+	PORT_MOTOR_1_VPORT.OUT |= (st_run.mot[MOTOR_1].step_mask & (uint8_t)-step);
+	st_run.mot[MOTOR_1].substep_accumulator = accum - ((int32_t)st_run.dda_ticks_X_substeps & -(int32_t)step);
+	INCREMENT_ENCODER_MASKED(MOTOR_1, step);
+	SYNC_OUT_DDA_TICK_MASKED(MOTOR_1, step);
+#ifdef __RASTER
+	if (step) { RASTER_DDA_TICK();}						// per-step laser power modulation (MOTOR_1 == RASTER_MOTOR)
+#endif
+	accum = (st_run.mot[MOTOR_2].substep_accumulator += st_run.mot[MOTOR_2].substep_increment);
+	step = (uint8_t)((uint32_t)(-accum) >> 31);
+	PORT_MOTOR_2_VPORT.OUT |= (st_run.mot[MOTOR_2].step_mask & (uint8_t)-step);
+	st_run.mot[MOTOR_2].substep_accumulator = accum - ((int32_t)st_run.dda_ticks_X_substeps & -(int32_t)step);
+	INCREMENT_ENCODER_MASKED(MOTOR_2, step);
+	SYNC_OUT_DDA_TICK_MASKED(MOTOR_2, step);
+
+	accum = (st_run.mot[MOTOR_3].substep_accumulator += st_run.mot[MOTOR_3].substep_increment);
+	step = (uint8_t)((uint32_t)(-accum) >> 31);
+	PORT_MOTOR_3_VPORT.OUT |= (st_run.mot[MOTOR_3].step_mask & (uint8_t)-step);
+	st_run.mot[MOTOR_3].substep_accumulator = accum - ((int32_t)st_run.dda_ticks_X_substeps & -(int32_t)step);
+	INCREMENT_ENCODER_MASKED(MOTOR_3, step);
+	SYNC_OUT_DDA_TICK_MASKED(MOTOR_3, step);
+
+	accum = (st_run.mot[MOTOR_4].substep_accumulator += st_run.mot[MOTOR_4].substep_increment);
+	step = (uint8_t)((uint32_t)(-accum) >> 31);
+	PORT_MOTOR_4_VPORT.OUT |= (st_run.mot[MOTOR_4].step_mask & (uint8_t)-step);
+	st_run.mot[MOTOR_4].substep_accumulator = accum - ((int32_t)st_run.dda_ticks_X_substeps & -(int32_t)step);
+	INCREMENT_ENCODER_MASKED(MOTOR_4, step);
+	SYNC_OUT_DDA_TICK_MASKED(MOTOR_4, step);
+
+#else // conditional pulse generation
 ISR(TIMER_DDA_ISR_vect)
 {
 	if ((st_run.mot[MOTOR_1].substep_accumulator += st_run.mot[MOTOR_1].substep_increment) > 0) {
 		PORT_MOTOR_1_VPORT.OUT |= STEP_BIT_bm;		// turn step bit on
 		st_run.mot[MOTOR_1].substep_accumulator -= st_run.dda_ticks_X_substeps;
 		INCREMENT_ENCODER(MOTOR_1);
+		SYNC_OUT_DDA_TICK(MOTOR_1);
+#ifdef __RASTER
+		RASTER_DDA_TICK();							// per-step laser power modulation (MOTOR_1 == RASTER_MOTOR)
+#endif
 	}
 	if ((st_run.mot[MOTOR_2].substep_accumulator += st_run.mot[MOTOR_2].substep_increment) > 0) {
 		PORT_MOTOR_2_VPORT.OUT |= STEP_BIT_bm;
 		st_run.mot[MOTOR_2].substep_accumulator -= st_run.dda_ticks_X_substeps;
 		INCREMENT_ENCODER(MOTOR_2);
+		SYNC_OUT_DDA_TICK(MOTOR_2);
 	}
 	if ((st_run.mot[MOTOR_3].substep_accumulator += st_run.mot[MOTOR_3].substep_increment) > 0) {
 		PORT_MOTOR_3_VPORT.OUT |= STEP_BIT_bm;
 		st_run.mot[MOTOR_3].substep_accumulator -= st_run.dda_ticks_X_substeps;
 		INCREMENT_ENCODER(MOTOR_3);
+		SYNC_OUT_DDA_TICK(MOTOR_3);
 	}
 	if ((st_run.mot[MOTOR_4].substep_accumulator += st_run.mot[MOTOR_4].substep_increment) > 0) {
 		PORT_MOTOR_4_VPORT.OUT |= STEP_BIT_bm;
 		st_run.mot[MOTOR_4].substep_accumulator -= st_run.dda_ticks_X_substeps;
 		INCREMENT_ENCODER(MOTOR_4);
+		SYNC_OUT_DDA_TICK(MOTOR_4);
+	}
+#endif // __DDA_PULSE_CORE
+
+#ifdef __DDA_SMOOTHING
+	if (--st_run.smoothing_countdown == 0) {			// ramp the DDA rate toward the next segment's
+		st_run.smoothing_countdown = DDA_SMOOTHING_TICKS;
+		st_run.mot[MOTOR_1].substep_increment += st_run.mot[MOTOR_1].substep_increment_delta;
+		st_run.mot[MOTOR_2].substep_increment += st_run.mot[MOTOR_2].substep_increment_delta;
+		st_run.mot[MOTOR_3].substep_increment += st_run.mot[MOTOR_3].substep_increment_delta;
+		st_run.mot[MOTOR_4].substep_increment += st_run.mot[MOTOR_4].substep_increment_delta;
 	}
+#endif
 
+#ifdef __STEP_PULSE_TIMER
+	// schedule the trailing edges - the compare interrupt clears the step bits
+	TIMER_DDA.CCA = TIMER_DDA.CNT + STEP_PULSE_TICKS;	// uniform width from the last leading edge
+#else
 	// pulse stretching for using external drivers.- turn step bits off
 	PORT_MOTOR_1_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 5 uSec pulse width
 	PORT_MOTOR_2_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 4 uSec
 	PORT_MOTOR_3_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 3 uSec
 	PORT_MOTOR_4_VPORT.OUT &= ~STEP_BIT_bm;				// ~ 2 uSec
+#endif
 
-	if (--st_run.dda_ticks_downcount != 0) return;
-
+	if (--st_run.dda_ticks_downcount != 0) {
+#ifdef __BENCHMARK
+		if (bench.running) {							// worst-case ISR headroom on the common path
+			uint16_t headroom = TIMER_DDA.PER - TIMER_DDA.CNT;
+			if (headroom < bench.dda_headroom_min) { bench.dda_headroom_min = headroom;}
+		}
+#endif
+#ifdef __DIAG
+		if (TIMER_DDA.CNT > dia.dda_ticks_max) { dia.dda_ticks_max = TIMER_DDA.CNT;}	// CNT counts up from ISR entry
+#endif
+		return;
+	}
 	TIMER_DDA.CTRLA = STEP_TIMER_DISABLE;				// disable DDA timer
+#ifdef __STEP_PULSE_TIMER
+	PORT_MOTOR_1_VPORT.OUT &= ~STEP_BIT_bm;				// the compare can't fire with the timer stopped -
+	PORT_MOTOR_2_VPORT.OUT &= ~STEP_BIT_bm;				// terminate any pulse from this final tick here
+	PORT_MOTOR_3_VPORT.OUT &= ~STEP_BIT_bm;
+	PORT_MOTOR_4_VPORT.OUT &= ~STEP_BIT_bm;
+#endif
+#ifdef __DIAG
+	uint16_t dia_start = dia_now();
+	_load_move();										// load the next move
+	dia_sample_load(dia_start);
+#else
 	_load_move();										// load the next move
+#endif
 }
+
+#ifdef __STEP_PULSE_TIMER
+/*
+ *	Trailing edge interrupt - clears all step bits STEP_PULSE_TICKS after the DDA
+ *	tick set them, the same overflow-sets / match-clears scheme the ARM build uses.
+ *	Pulse width is set by the timer compare, not by instruction counts in the
+ *	overflow ISR, so it stays narrow and uniform regardless of the code path taken.
+ *	Clearing bits that were never set is harmless and cheaper than testing.
+ */
+ISR(TIMER_DDA_CCA_ISR_vect)
+{
+	PORT_MOTOR_1_VPORT.OUT &= ~STEP_BIT_bm;
+	PORT_MOTOR_2_VPORT.OUT &= ~STEP_BIT_bm;
+	PORT_MOTOR_3_VPORT.OUT &= ~STEP_BIT_bm;
+	PORT_MOTOR_4_VPORT.OUT &= ~STEP_BIT_bm;
+}
+#endif // __STEP_PULSE_TIMER
 #endif // __AVR
 
 #ifdef __ARM
@@ -615,12 +861,27 @@ MOTATE_TIMER_INTERRUPT(dda_timer_num)
  */
 
 #ifdef __AVR
-ISR(TIMER_DWELL_ISR_vect) {								// DWELL timer interrupt
-	if (--st_run.dda_ticks_downcount == 0) {
-		TIMER_DWELL.CTRLA = STEP_TIMER_DISABLE;			// disable DWELL timer
-		_load_move();
-	}
+#ifdef __PRECISE_DWELL
+ISR(TIMER_DWELL_ISR_vect) {								// DWELL timer interrupt
+	uint32_t elapsed = TIMER_DWELL.PER;					// each overflow retires one loaded period
+	if (st_run.dda_ticks_downcount <= elapsed) {
+		TIMER_DWELL.CTRLA = STEP_TIMER_DISABLE;			// disable DWELL timer
+		_load_move();
+	} else {
+		st_run.dda_ticks_downcount -= elapsed;
+		if (st_run.dda_ticks_downcount < 0xFFFF) {		// last pass - load the exact remainder
+			TIMER_DWELL.PER = st_run.dda_ticks_downcount;
+		}
+	}
 }
+#else
+ISR(TIMER_DWELL_ISR_vect) {								// DWELL timer interrupt
+	if (--st_run.dda_ticks_downcount == 0) {
+		TIMER_DWELL.CTRLA = STEP_TIMER_DISABLE;			// disable DWELL timer
+		_load_move();
+	}
+}
+#endif
 #endif
 #ifdef __ARM
 namespace Motate {			// Must define timer interrupts inside the Motate namespace
@@ -641,35 +902,53 @@ MOTATE_TIMER_INTERRUPT(dwell_timer_num)
  * exec_timer interrupt		- interrupt handler for calling exec function
  */
 
-#ifdef __AVR
-void st_request_exec_move()
-{
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
-		TIMER_EXEC.PER = EXEC_TIMER_PERIOD;
-		TIMER_EXEC.CTRLA = EXEC_TIMER_ENABLE;				// trigger a LO interrupt
-	}
-}
-
-ISR(TIMER_EXEC_ISR_vect) {								// exec move SW interrupt
-	TIMER_EXEC.CTRLA = EXEC_TIMER_DISABLE;				// disable SW interrupt timer
-
-	// exec_move
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
-		if (mp_exec_move() != STAT_NOOP) {
-			st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
-			_request_load_move();
-		}
-	}
+#ifdef __AVR
+void st_request_exec_move()
+{
+	if (st_exec_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
+		TIMER_EXEC.PER = EXEC_TIMER_PERIOD;
+		TIMER_EXEC.CTRLA = EXEC_TIMER_ENABLE;				// trigger a LO interrupt
+	}
+}
+
+ISR(TIMER_EXEC_ISR_vect) {								// exec move SW interrupt
+	TIMER_EXEC.CTRLA = EXEC_TIMER_DISABLE;				// disable SW interrupt timer
+
+	// exec_move
+	if (st_exec_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {
+#ifdef __BENCHMARK
+		uint16_t bench_start = bench_now();
+#endif
+#ifdef __DIAG
+		uint16_t dia_start = dia_now();
+#endif
+		if (mp_exec_move() != STAT_NOOP) {
+			st_exec_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER; // flip it back
+#ifdef __PREP_AHEAD
+			_stage_to_pre();							// advance into st_pre if it's free, then re-arm exec
+#endif
+			_request_load_move();
+#ifdef __TRACE_RING
+			trace_log(TRACE_FMT_EXEC, mp_get_planner_buffers_available(), 0);
+#endif
+		}
+#ifdef __BENCHMARK
+		bench_sample_exec(bench_start);
+#endif
+#ifdef __DIAG
+		dia_sample_exec(dia_start);
+#endif
+	}
 }
-#endif // __AVR
+#endif // __AVR
 
-#ifdef __ARM
+#ifdef __ARM
 void st_request_exec_move()
-{
-	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
+{
+	if (st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC) {// bother interrupting
 		exec_timer.setInterruptPending();
-	}
-}
+	}
+}
 
 namespace Motate {	// Define timer inside Motate namespace
 	MOTATE_TIMER_INTERRUPT(exec_timer_num)				// exec move SW interrupt
@@ -683,8 +962,8 @@ namespace Motate {	// Define timer inside Motate namespace
 		}
 	}
 } // namespace Motate
-
-#endif // __ARM
+
+#endif // __ARM
 
 /****************************************************************************************
  * Loader sequencing code
@@ -696,7 +975,7 @@ namespace Motate {	// Define timer inside Motate namespace
  *	request a load (see st_request_load_move())
  */
 
-#ifdef __AVR
+#ifdef __AVR
 static void _request_load_move()
 {
 	if (st_runtime_isbusy()) {
@@ -710,11 +989,20 @@ static void _request_load_move()
 
 ISR(TIMER_LOAD_ISR_vect) {										// load steppers SW interrupt
 	TIMER_LOAD.CTRLA = LOAD_TIMER_DISABLE;						// disable SW interrupt timer
+#ifdef __TRACE_RING
+	trace_log(TRACE_FMT_LOAD, (uint16_t)st_pre.dda_ticks, 0);
+#endif
+#ifdef __DIAG
+	uint16_t dia_start = dia_now();
 	_load_move();
+	dia_sample_load(dia_start);
+#else
+	_load_move();
+#endif
 }
-#endif // __AVR
-
-#ifdef __ARM
+#endif // __AVR
+
+#ifdef __ARM
 static void _request_load_move()
 {
 	if (st_runtime_isbusy()) {
@@ -732,20 +1020,96 @@ namespace Motate {	// Define timer inside Motate namespace
 		_load_move();
 	}
 } // namespace Motate
-#endif // __ARM
+#endif // __ARM
+
+#ifdef __NET_SEGMENT_BUS
+void st_request_load_move() { _request_load_move();}	// public entry for the segment bus slave
+#endif
+
+#ifdef __PREP_AHEAD
+/****************************************************************************************
+ * _transfer_prep() - advance a staged segment from st_stage into st_pre
+ * _stage_to_pre()  - exec-level wrapper for _transfer_prep()
+ *
+ *	With __PREP_AHEAD the exec/prep pass fills st_stage instead of st_pre, and a
+ *	finished segment is handed forward to st_pre as soon as st_pre is free. In the
+ *	steady state st_pre holds the next segment while exec preps the one after it
+ *	into the stage, so a single prep that overruns a segment boundary is absorbed
+ *	by the buffered segment instead of starving the DDA.
+ *
+ *	Only the per-segment payload moves. The fields the loader owns across segments
+ *	(prev_direction) stay in st_pre and the fields exec owns across segments
+ *	(correction holdoff and accumulators, prev_segment_time, backlash takeup) stay
+ *	in the stage, so neither side's history forks between the two buffers.
+ *	corrected_steps is copied anyway - it's display-only and the _xs diagnostics
+ *	in config_app.c bind to the st_pre copy.
+ *
+ *	_transfer_prep() may only run where the loader can't preempt it: from the
+ *	loader itself (HI interrupt) or from exec with interrupts masked, which is
+ *	what _stage_to_pre() is for. Masking covers the ~10 uSec of copy; the DDA
+ *	interrupt is latched and runs late by at most that much, same as it tolerates
+ *	for the loader proper. _stage_to_pre() rechecks ownership inside the critical
+ *	section in case the loader consumed the stage between the exec flip and the copy.
+ */
+
+static void _transfer_prep()
+{
+	st_pre.dda_period = st_stage.dda_period;
+	st_pre.dda_ticks = st_stage.dda_ticks;
+	st_pre.dda_ticks_X_substeps = st_stage.dda_ticks_X_substeps;
+	st_pre.move_type = st_stage.move_type;
+	st_pre.bf = st_stage.bf;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		st_pre.mot[motor].substep_increment = st_stage.mot[motor].substep_increment;
+		st_pre.mot[motor].direction = st_stage.mot[motor].direction;
+		st_pre.mot[motor].step_sign = st_stage.mot[motor].step_sign;
+		st_pre.mot[motor].accumulator_correction = st_stage.mot[motor].accumulator_correction;
+		st_pre.mot[motor].accumulator_correction_flag = st_stage.mot[motor].accumulator_correction_flag;
+		st_stage.mot[motor].accumulator_correction_flag = false;	// the correction travels with exactly one segment
+		st_pre.mot[motor].corrected_steps = st_stage.mot[motor].corrected_steps;
+#ifdef __MICROSTEP_GEARING
+		st_pre.mot[motor].gear = st_stage.mot[motor].gear;
+		st_pre.mot[motor].gear_scale = st_stage.mot[motor].gear_scale;
+		st_pre.mot[motor].gear_change_flag = st_stage.mot[motor].gear_change_flag;
+		st_stage.mot[motor].gear_change_flag = false;	// the mode switch travels with exactly one segment
+#endif
+#ifdef __DDA_SMOOTHING
+		st_pre.mot[motor].substep_increment_start = st_stage.mot[motor].substep_increment_start;
+		st_pre.mot[motor].substep_increment_delta = st_stage.mot[motor].substep_increment_delta;
+		st_pre.mot[motor].substep_residual = st_stage.mot[motor].substep_residual;
+#endif
+	}
+	st_stage.move_type = MOVE_TYPE_NULL;
+	st_stage.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// stage is free for the next prep
+	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// ...do this last
+}
+
+static void _stage_to_pre()
+{
+	cli();
+	if ((st_stage.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) &&
+		(st_pre.buffer_state == PREP_BUFFER_OWNED_BY_EXEC)) {
+		_transfer_prep();
+		sei();
+		st_request_exec_move();							// stage is free again - prep the second segment ahead
+		return;
+	}
+	sei();
+}
+#endif // __PREP_AHEAD
 
 /****************************************************************************************
- * _load_move() - Dequeue move and load into stepper struct
- *
- *	This routine can only be called be called from an ISR at the same or
- *	higher level as the DDA or dwell ISR. A software interrupt has been
- *	provided to allow a non-ISR to request a load (see st_request_load_move())
- *
+ * _load_move() - Dequeue move and load into stepper struct
+ *
+ *	This routine can only be called be called from an ISR at the same or
+ *	higher level as the DDA or dwell ISR. A software interrupt has been
+ *	provided to allow a non-ISR to request a load (see st_request_load_move())
+ *
  *	In aline() code:
  *	 - All axes must set steps and compensate for out-of-range pulse phasing.
  *	 - If axis has 0 steps the direction setting can be omitted
  *	 - If axis has 0 steps the motor must not be enabled to support power mode = 1
- */
+ */
 /****** WARNING - THIS CODE IS SPECIFIC TO AVR. SEE G2 FOR ARM CODE ******/
 
 static void _load_move()
@@ -756,10 +1120,29 @@ static void _load_move()
 		return;													// exit if the runtime is busy
 	}
 	if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_LOADER) {	// if there are no moves to load...
+#ifdef __PREP_AHEAD
+		if (st_stage.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) {	// ...a staged segment may still make it
+#ifdef __DIAG
+			if (st_pipeline_hot) {
+				dia.prep_lates++;					// prep missed the segment boundary - count the near-miss
+#ifdef __JOB_STATS
+				dia.job_prep_lates++;
+#endif
+			}
+#endif
+			_transfer_prep();
+		} else {
+			st_pipeline_hot = false;
+			_arm_power_event();						// ...movement has ended - start motor power timeouts
+			return;
+		}
+#else
 //		for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
 //			st_run.mot[motor].power_state = MOTOR_POWER_TIMEOUT_START;	// ...start motor power timeouts
 //		}
+		_arm_power_event();							// ...movement has ended - start motor power timeouts
 		return;
+#endif
 	}
 	// handle aline loads first (most common case)
 	if (st_pre.move_type == MOVE_TYPE_ALINE) {
@@ -777,19 +1160,32 @@ static void _load_move()
 		// the following if() statement sets the runtime substep increment value or zeroes it
 		if ((st_run.mot[MOTOR_1].substep_increment = st_pre.mot[MOTOR_1].substep_increment) != 0) {
 
-			// NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
-			//	   always operate on the last segment actually run by this motor, regardless of how many
-			//	   segments it may have been inactive in between.
+			// NB: If motor has 0 steps the following is all skipped. This ensures that state comparisons
+			//	   always operate on the last segment actually run by this motor, regardless of how many
+			//	   segments it may have been inactive in between.
 
-			// Apply accumulator correction if the time base has changed since previous segment
+			// Apply accumulator correction if the time base has changed since previous segment
 			if (st_pre.mot[MOTOR_1].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_1].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_1].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_1].substep_accumulator *= st_pre.mot[MOTOR_1].accumulator_correction;
 			}
 
-			// Detect direction change and if so:
-			//	- Set the direction bit in hardware.
-			//	- Compensate for direction change by flipping substep accumulator value about its midpoint.
+#ifdef __MICROSTEP_GEARING
+			// Gear change: switch the microstep mode pins and rescale the accumulator
+			// phase to the new step size. Downshift residue past a full new step is
+			// clamped - the following error correction absorbs the sub-step loss.
+			if (st_pre.mot[MOTOR_1].gear_change_flag == true) {
+				st_pre.mot[MOTOR_1].gear_change_flag = false;
+				float phase = (float)(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_1].substep_accumulator) * st_pre.mot[MOTOR_1].gear_scale;
+				if (phase > (float)st_run.dda_ticks_X_substeps) { phase = (float)st_run.dda_ticks_X_substeps;}
+				st_run.mot[MOTOR_1].substep_accumulator = (int32_t)phase - (int32_t)st_run.dda_ticks_X_substeps;
+				_set_hw_microsteps(MOTOR_1, st_cfg.mot[MOTOR_1].microsteps / st_pre.mot[MOTOR_1].gear);
+			}
+#endif
+
+			// Detect direction change and if so:
+			//	- Set the direction bit in hardware.
+			//	- Compensate for direction change by flipping substep accumulator value about its midpoint.
 
 			if (st_pre.mot[MOTOR_1].direction != st_pre.mot[MOTOR_1].prev_direction) {
 				st_pre.mot[MOTOR_1].prev_direction = st_pre.mot[MOTOR_1].direction;
@@ -813,14 +1209,26 @@ static void _load_move()
 			}
 		}
 		// accumulate counted steps to the step position and zero out counted steps for the segment currently being loaded
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_1].step_mask = (st_run.mot[MOTOR_1].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_1);
 
 #if (MOTORS >= 2)	//**** MOTOR_2 LOAD ****
 		if ((st_run.mot[MOTOR_2].substep_increment = st_pre.mot[MOTOR_2].substep_increment) != 0) {
 			if (st_pre.mot[MOTOR_2].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_2].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_2].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_2].substep_accumulator *= st_pre.mot[MOTOR_2].accumulator_correction;
 			}
+#ifdef __MICROSTEP_GEARING
+			if (st_pre.mot[MOTOR_2].gear_change_flag == true) {
+				st_pre.mot[MOTOR_2].gear_change_flag = false;
+				float phase = (float)(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_2].substep_accumulator) * st_pre.mot[MOTOR_2].gear_scale;
+				if (phase > (float)st_run.dda_ticks_X_substeps) { phase = (float)st_run.dda_ticks_X_substeps;}
+				st_run.mot[MOTOR_2].substep_accumulator = (int32_t)phase - (int32_t)st_run.dda_ticks_X_substeps;
+				_set_hw_microsteps(MOTOR_2, st_cfg.mot[MOTOR_2].microsteps / st_pre.mot[MOTOR_2].gear);
+			}
+#endif
 			if (st_pre.mot[MOTOR_2].direction != st_pre.mot[MOTOR_2].prev_direction) {
 				st_pre.mot[MOTOR_2].prev_direction = st_pre.mot[MOTOR_2].direction;
 				st_run.mot[MOTOR_2].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_2].substep_accumulator);
@@ -839,14 +1247,26 @@ static void _load_move()
 				st_run.mot[MOTOR_2].power_state = MOTOR_POWER_TIMEOUT_START;
 			}
 		}
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_2].step_mask = (st_run.mot[MOTOR_2].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_2);
 #endif
 #if (MOTORS >= 3)	//**** MOTOR_3 LOAD ****
 		if ((st_run.mot[MOTOR_3].substep_increment = st_pre.mot[MOTOR_3].substep_increment) != 0) {
 			if (st_pre.mot[MOTOR_3].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_3].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_3].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_3].substep_accumulator *= st_pre.mot[MOTOR_3].accumulator_correction;
 			}
+#ifdef __MICROSTEP_GEARING
+			if (st_pre.mot[MOTOR_3].gear_change_flag == true) {
+				st_pre.mot[MOTOR_3].gear_change_flag = false;
+				float phase = (float)(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_3].substep_accumulator) * st_pre.mot[MOTOR_3].gear_scale;
+				if (phase > (float)st_run.dda_ticks_X_substeps) { phase = (float)st_run.dda_ticks_X_substeps;}
+				st_run.mot[MOTOR_3].substep_accumulator = (int32_t)phase - (int32_t)st_run.dda_ticks_X_substeps;
+				_set_hw_microsteps(MOTOR_3, st_cfg.mot[MOTOR_3].microsteps / st_pre.mot[MOTOR_3].gear);
+			}
+#endif
 			if (st_pre.mot[MOTOR_3].direction != st_pre.mot[MOTOR_3].prev_direction) {
 				st_pre.mot[MOTOR_3].prev_direction = st_pre.mot[MOTOR_3].direction;
 				st_run.mot[MOTOR_3].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_3].substep_accumulator);
@@ -865,14 +1285,26 @@ static void _load_move()
 				st_run.mot[MOTOR_3].power_state = MOTOR_POWER_TIMEOUT_START;
 			}
 		}
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_3].step_mask = (st_run.mot[MOTOR_3].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_3);
 #endif
 #if (MOTORS >= 4)  //**** MOTOR_4 LOAD ****
 		if ((st_run.mot[MOTOR_4].substep_increment = st_pre.mot[MOTOR_4].substep_increment) != 0) {
 			if (st_pre.mot[MOTOR_4].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_4].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_4].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_4].substep_accumulator *= st_pre.mot[MOTOR_4].accumulator_correction;
 			}
+#ifdef __MICROSTEP_GEARING
+			if (st_pre.mot[MOTOR_4].gear_change_flag == true) {
+				st_pre.mot[MOTOR_4].gear_change_flag = false;
+				float phase = (float)(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_4].substep_accumulator) * st_pre.mot[MOTOR_4].gear_scale;
+				if (phase > (float)st_run.dda_ticks_X_substeps) { phase = (float)st_run.dda_ticks_X_substeps;}
+				st_run.mot[MOTOR_4].substep_accumulator = (int32_t)phase - (int32_t)st_run.dda_ticks_X_substeps;
+				_set_hw_microsteps(MOTOR_4, st_cfg.mot[MOTOR_4].microsteps / st_pre.mot[MOTOR_4].gear);
+			}
+#endif
 			if (st_pre.mot[MOTOR_4].direction != st_pre.mot[MOTOR_4].prev_direction) {
 				st_pre.mot[MOTOR_4].prev_direction = st_pre.mot[MOTOR_4].direction;
 				st_run.mot[MOTOR_4].substep_accumulator = -(st_run.dda_ticks_X_substeps + st_run.mot[MOTOR_4].substep_accumulator);
@@ -891,12 +1323,15 @@ static void _load_move()
 				st_run.mot[MOTOR_4].power_state = MOTOR_POWER_TIMEOUT_START;
 			}
 		}
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_4].step_mask = (st_run.mot[MOTOR_4].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_4);
 #endif
 #if (MOTORS >= 5)	//**** MOTOR_5 LOAD ****
 		if ((st_run.mot[MOTOR_5].substep_increment = st_pre.mot[MOTOR_5].substep_increment) != 0) {
 			if (st_pre.mot[MOTOR_5].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_5].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_5].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_5].substep_accumulator *= st_pre.mot[MOTOR_5].accumulator_correction;
 			}
 			if (st_pre.mot[MOTOR_5].direction != st_pre.mot[MOTOR_5].prev_direction) {
@@ -915,12 +1350,15 @@ static void _load_move()
 				st_run.mot[MOTOR_5].power_state = MOTOR_POWER_TIMEOUT_START;
 			}
 		}
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_5].step_mask = (st_run.mot[MOTOR_5].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_5);
 #endif
 #if (MOTORS >= 6)	//**** MOTOR_6 LOAD ****
 		if ((st_run.mot[MOTOR_6].substep_increment = st_pre.mot[MOTOR_6].substep_increment) != 0) {
 			if (st_pre.mot[MOTOR_6].accumulator_correction_flag == true) {
-				st_pre.mot[MOTOR_6].accumulator_correction_flag = false;
+				st_pre.mot[MOTOR_6].accumulator_correction_flag = false;
 				st_run.mot[MOTOR_6].substep_accumulator *= st_pre.mot[MOTOR_6].accumulator_correction;
 			}
 			if (st_pre.mot[MOTOR_6].direction != st_pre.mot[MOTOR_6].prev_direction) {
@@ -939,29 +1377,100 @@ static void _load_move()
 				st_run.mot[MOTOR_6].power_state = MOTOR_POWER_TIMEOUT_START;
 			}
 		}
+#ifdef __DDA_PULSE_CORE
+		st_run.mot[MOTOR_6].step_mask = (st_run.mot[MOTOR_6].substep_increment != 0) ? STEP_BIT_bm : 0;
+#endif
 		ACCUMULATE_ENCODER(MOTOR_6);
+#endif
+#ifdef __DUAL_ENDSTOP
+		// a motor gated by its endstop stays gated across segment loads until the cycle ungates it
+		if (st_run.motor_gate_bm != 0) {
+			for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+				if (st_run.motor_gate_bm & (1 << motor)) {
+					st_run.mot[motor].substep_increment = 0;
+#ifdef __DDA_PULSE_CORE
+					st_run.mot[motor].step_mask = 0;
+#endif
+				}
+			}
+		}
+#endif
+#ifdef __DDA_SMOOTHING
+		// start each motor at the previous segment's final rate and arm the ramp
+		st_run.smoothing_countdown = DDA_SMOOTHING_TICKS;
+		for (uint8_t motor = MOTOR_1; motor < MOTORS; motor++) {
+			if (st_run.mot[motor].substep_increment == 0) {
+				st_run.mot[motor].substep_increment_delta = 0;	// gated and idle motors must not ramp
+				continue;
+			}
+			st_run.mot[motor].substep_increment = st_pre.mot[motor].substep_increment_start;
+			st_run.mot[motor].substep_increment_delta = st_pre.mot[motor].substep_increment_delta;
+			st_run.mot[motor].substep_accumulator += st_pre.mot[motor].substep_residual;
+		}
 #endif
 		//**** do this last ****
 
-		TIMER_DDA.PER = st_pre.dda_period;
-		TIMER_DDA.CTRLA = STEP_TIMER_ENABLE;			// enable the DDA timer
-
-	// handle dwells
-	} else if (st_pre.move_type == MOVE_TYPE_DWELL) {
-		st_run.dda_ticks_downcount = st_pre.dda_ticks;
-		TIMER_DWELL.PER = st_pre.dda_period;			// load dwell timer period
-		TIMER_DWELL.CTRLA = STEP_TIMER_ENABLE;			// enable the dwell timer
-
-	// handle synchronous commands
-	} else if (st_pre.move_type == MOVE_TYPE_COMMAND) {
-		mp_runtime_command(st_pre.bf);
-	}
-
-	// all other cases drop to here (e.g. Null moves after Mcodes skip to here)
+		TIMER_DDA.PER = st_pre.dda_period;
+		TIMER_DDA.CTRLA = STEP_TIMER_ENABLE;			// enable the DDA timer
+
+	// handle dwells
+	} else if (st_pre.move_type == MOVE_TYPE_DWELL) {
+		st_run.dda_ticks_downcount = st_pre.dda_ticks;
+#ifdef __PRECISE_DWELL
+		TIMER_DWELL.PER = (st_pre.dda_ticks > 0xFFFF) ?	// load the whole dwell if it fits in one period,
+			0xFFFF : (uint16_t)st_pre.dda_ticks;		//...otherwise interrupt once per full period
+		TIMER_DWELL.CTRLA = DWELL_TIMER_ENABLE;			// enable the dwell timer at 2 uSec per tick
+#else
+		TIMER_DWELL.PER = st_pre.dda_period;			// load dwell timer period
+		TIMER_DWELL.CTRLA = STEP_TIMER_ENABLE;			// enable the dwell timer
+#endif
+
+	// handle synchronous commands
+	} else if (st_pre.move_type == MOVE_TYPE_COMMAND) {
+		mp_runtime_command(st_pre.bf);
+	}
+
+	// all other cases drop to here (e.g. Null moves after Mcodes skip to here)
 	st_pre.move_type = MOVE_TYPE_NULL;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// we are done with the prep buffer - flip the flag back
+	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// we are done with the prep buffer - flip the flag back
+#ifdef __PREP_AHEAD
+	if (st_stage.buffer_state == PREP_BUFFER_OWNED_BY_LOADER) { _transfer_prep();}	// refill st_pre - stay a segment ahead
+	st_pipeline_hot = true;
+#endif
 	st_request_exec_move();								// exec and prep next move
-}
+}
+
+#if defined(__STEP_CORRECTION) && defined(__STEP_CORRECTION_FINE)
+/*
+ * _persistent_error() - decide whether a following error is worth correcting
+ *
+ *	Errors beyond STEP_CORRECTION_THRESHOLD are corrected immediately, as
+ *	before. Smaller errors are usually quantization jitter - the virtual
+ *	encoder counts whole emitted steps, so a transient +/-1 against the
+ *	rounded commanded position is normal and flips sign or returns to zero
+ *	within a few segments. Real float drift does not: it holds its sign. A
+ *	small error that keeps its sign for STEP_CORRECTION_PERSIST consecutive
+ *	evaluations is treated as drift and corrected, which bounds long-job
+ *	drift below one step instead of the threshold's two.
+ */
+static uint8_t _persistent_error(const uint8_t motor, const int32_t step_error)
+{
+	if (labs(step_error) > STEP_CORRECTION_THRESHOLD) { return (true);}	// gross error - correct immediately
+	if (step_error == 0) {
+		st_exec_pre.mot[motor].error_persist = 0;
+		return (false);
+	}
+	int8_t sign = (step_error > 0) ? 1 : -1;
+	if (((st_exec_pre.mot[motor].error_persist > 0) && (sign < 0)) ||
+		((st_exec_pre.mot[motor].error_persist < 0) && (sign > 0))) {
+		st_exec_pre.mot[motor].error_persist = 0;					// sign flip - that was jitter
+	}
+	st_exec_pre.mot[motor].error_persist += sign;
+	if (abs(st_exec_pre.mot[motor].error_persist) < STEP_CORRECTION_PERSIST) { return (false);}
+	st_exec_pre.mot[motor].error_persist = 0;
+	return (true);
+}
+#endif // __STEP_CORRECTION && __STEP_CORRECTION_FINE
 
 /***********************************************************************************
  * st_prep_line() - Prepare the next move for the loader
@@ -977,8 +1486,6 @@ static void _load_move()
  *		floats that typically have fractional values (fractional steps). The sign
  *		indicates direction. Motors that are not in the move should be 0 steps on input.
  *
- *	  - following_error[] is a vector of measured errors to the step count. Used for correction.
- *
  *	  - segment_time - how many minutes the segment should run. If timing is not
  *		100% accurate this will affect the move velocity, but not the distance traveled.
  *
@@ -987,10 +1494,10 @@ static void _load_move()
  *		    dda_ticks_X_substeps = (int32_t)((microseconds/1000000) * f_dda * dda_substeps);
  */
 
-stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time)
+stat_t st_prep_line(float travel_steps[], float segment_time)
 {
 	// trap conditions that would prevent queueing the line
-	if (st_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) {
+	if (st_exec_pre.buffer_state != PREP_BUFFER_OWNED_BY_EXEC) {
 		return (cm_hard_alarm(STAT_INTERNAL_ERROR));
 	} else if (isinf(segment_time)) { return (cm_hard_alarm(STAT_PREP_LINE_MOVE_TIME_IS_INFINITE));	// never supposed to happen
 	} else if (isnan(segment_time)) { return (cm_hard_alarm(STAT_PREP_LINE_MOVE_TIME_IS_NAN));		// never supposed to happen
@@ -1000,57 +1507,179 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 	// - dda_ticks is the integer number of DDA clock ticks needed to play out the segment
 	// - ticks_X_substeps is the maximum depth of the DDA accumulator (as a negative number)
 
-	st_pre.dda_period = _f_to_period(FREQUENCY_DDA);
-	st_pre.dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
-	st_pre.dda_ticks_X_substeps = st_pre.dda_ticks * DDA_SUBSTEPS;
+#ifdef __DDA_SCALE
+	// Select the slowest DDA clock that still resolves this segment's peak step
+	// rate with DDA_SCALE_MARGIN ticks per step - see stepper.h. The loader
+	// programs the timer period per segment, so changing clocks costs nothing.
+	float max_steps = 0;
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (fabs(travel_steps[motor]) > max_steps) { max_steps = fabs(travel_steps[motor]);}
+	}
+	float freq = FREQUENCY_DDA;
+	float freq_floor = (max_steps / (segment_time * 60)) * DDA_SCALE_MARGIN;
+	while ((freq > (FREQUENCY_DDA / DDA_SCALE_MAX_DIVISOR)) && ((freq / 2) >= freq_floor)) {
+		freq /= 2;
+	}
+	st_exec_pre.dda_period = _f_to_period(freq);
+	st_exec_pre.dda_ticks = (int32_t)(segment_time * 60 * freq);		// NB: converts minutes to seconds
+#else
+	st_exec_pre.dda_period = _f_to_period(FREQUENCY_DDA);
+	st_exec_pre.dda_ticks = (int32_t)(segment_time * 60 * FREQUENCY_DDA);// NB: converts minutes to seconds
+#endif
+	st_exec_pre.dda_ticks_X_substeps = st_exec_pre.dda_ticks * DDA_SUBSTEPS;
+#ifdef __TRACE_RING
+	trace_log(TRACE_FMT_PREP, (uint16_t)(segment_time * 60000000), (uint16_t)st_exec_pre.dda_ticks);
+#endif
 
 	// setup motor parameters
 
 	float correction_steps;
-	for (uint8_t motor=0; motor<MOTORS; motor++) {	// I want to remind myself that this is motors, not axes
+	for (uint8_t motor=0; motor<MOTORS; motor++) {	// I want to remind myself that this is motors, not axes
 
 		// Skip this motor if there are no new steps. Leave all other values intact.
-		if (fp_ZERO(travel_steps[motor])) { st_pre.mot[motor].substep_increment = 0; continue;}
+		if (fp_ZERO(travel_steps[motor])) {
+			st_exec_pre.mot[motor].substep_increment = 0;
+#ifdef __DDA_SMOOTHING
+			st_exec_pre.mot[motor].smoothing_prev = 0;			// an idle segment restarts the ramp from rest
+#endif
+			continue;
+		}
 
 		// Setup the direction, compensating for polarity.
 		// Set the step_sign which is used by the stepper ISR to accumulate step position
 
 		if (travel_steps[motor] >= 0) {					// positive direction
-			st_pre.mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
-			st_pre.mot[motor].step_sign = 1;
+			st_exec_pre.mot[motor].direction = DIRECTION_CW ^ st_cfg.mot[motor].polarity;
+			st_exec_pre.mot[motor].step_sign = 1;
 		} else {
-			st_pre.mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
-			st_pre.mot[motor].step_sign = -1;
+			st_exec_pre.mot[motor].direction = DIRECTION_CCW ^ st_cfg.mot[motor].polarity;
+			st_exec_pre.mot[motor].step_sign = -1;
 		}
 
+#ifdef __BACKLASH_COMP
+		// Backlash compensation. Each motor carries a takeup offset that is either
+		// the full backlash (slack taken up for positive travel) or zero (negative
+		// travel). When the direction reverses the difference is folded into this
+		// segment's travel steps - zero planner buffers, zero extra blocks. The
+		// injection is capped at the DDA's one-step-per-tick ceiling and carries
+		// into following segments if the backlash is larger than the headroom.
+		// backlash_offset records the injected motor steps so the following error
+		// math below can subtract them back out; the holdoff keeps the error
+		// correction quiet until the encoder has seen the takeup run.
+
+		if (fp_NOT_ZERO(st_cfg.mot[motor].backlash)) {
+			int32_t target = (travel_steps[motor] >= 0) ?
+				(int32_t)round(st_cfg.mot[motor].backlash * st_cfg.mot[motor].steps_per_unit) : 0;
+			int32_t pending = target - st_exec_pre.mot[motor].backlash_offset;
+			if (pending != 0) {
+				float headroom = (float)st_exec_pre.dda_ticks - fabs(travel_steps[motor]);
+				int32_t inject = min(labs(pending), (int32_t)max(headroom, 0));
+				if (pending < 0) { inject = -inject;}
+				travel_steps[motor] += (float)inject;
+				st_exec_pre.mot[motor].backlash_offset += inject;
+				st_exec_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
+			}
+		}
+#endif
 		// Detect segment time changes and setup the accumulator correction factor and flag.
 		// Putting this here computes the correct factor even if the motor was dormant for some
 		// number of previous moves. Correction is computed based on the last segment time actually used.
 
-		if (fabs(segment_time - st_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
-			if (fp_NOT_ZERO(st_pre.mot[motor].prev_segment_time)) {					// special case to skip first move
-				st_pre.mot[motor].accumulator_correction_flag = true;
-				st_pre.mot[motor].accumulator_correction = segment_time / st_pre.mot[motor].prev_segment_time;
+#ifdef __DDA_SCALE
+		// The accumulator depth tracks DDA ticks, not wall time, so the carried
+		// residue rescales on clock changes too: fold the selected clock into an
+		// effective time proportional to dda_ticks and correct on that instead.
+		float effective_time = segment_time * (freq / FREQUENCY_DDA);
+#else
+		float effective_time = segment_time;
+#endif
+		if (fabs(effective_time - st_exec_pre.mot[motor].prev_segment_time) > 0.0000001) { // highly tuned FP != compare
+			if (fp_NOT_ZERO(st_exec_pre.mot[motor].prev_segment_time)) {					// special case to skip first move
+				st_exec_pre.mot[motor].accumulator_correction_flag = true;
+				st_exec_pre.mot[motor].accumulator_correction = effective_time / st_exec_pre.mot[motor].prev_segment_time;
 			}
-			st_pre.mot[motor].prev_segment_time = segment_time;
+			st_exec_pre.mot[motor].prev_segment_time = effective_time;
 		}
 
 #ifdef __STEP_CORRECTION
-		// 'Nudge' correction strategy. Inject a single, scaled correction value then hold off
-
-		if ((--st_pre.mot[motor].correction_holdoff < 0) &&
-			(fabs(following_error[motor]) > STEP_CORRECTION_THRESHOLD)) {
-
-			st_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
-			correction_steps = following_error[motor] * STEP_CORRECTION_FACTOR;
+		// 'Nudge' correction strategy. Inject a single, scaled correction value then hold off.
+		// The following error is evaluated here in integer step space - the encoder and the
+		// (rounded) commanded steps are both native int32 (see plan_exec.c) - so the common
+		// no-correction case costs an integer subtract and compare. Floats only come out for
+		// the rare correction itself. Sub-step error is below threshold by definition.
+
+		if (--st_exec_pre.mot[motor].correction_holdoff < 0) {
+#ifdef __BACKLASH_COMP
+			int32_t step_error = mr.encoder_steps[motor] - mr.commanded_steps[motor]
+								 - st_exec_pre.mot[motor].backlash_offset;
+#else
+			int32_t step_error = mr.encoder_steps[motor] - mr.commanded_steps[motor];
+#endif
+#ifdef __QDEC_ENCODER
+			// Stall detection. The external encoder measures actual position, so an
+			// error beyond what correction can plausibly recover means lost steps -
+			// alarm out rather than let the correction chase a stalled motor.
+			if ((motor == QDEC_MOTOR) && (labs(step_error) > QDEC_STALL_THRESHOLD)) {
+				return (cm_hard_alarm(STAT_STALL_DETECTED));
+			}
+#endif
+#ifdef __STEP_CORRECTION_FINE
+			if (_persistent_error(motor, step_error) == true) {
+#else
+			if (labs(step_error) > STEP_CORRECTION_THRESHOLD) {
+#endif
 
-			if (correction_steps > 0) {
-				correction_steps = min3(correction_steps, fabs(travel_steps[motor]), STEP_CORRECTION_MAX);
-			} else {
-				correction_steps = max3(correction_steps, -fabs(travel_steps[motor]), -STEP_CORRECTION_MAX);
+				st_exec_pre.mot[motor].correction_holdoff = STEP_CORRECTION_HOLDOFF;
+				mr.following_error[motor] = (float)step_error;		// capture for _fe diagnostics
+#if defined(__DIAG) && defined(__JOB_STATS)
+				if (fabs(mr.following_error[motor]) > dia.job_ferror_max) {
+					dia.job_ferror_max = fabs(mr.following_error[motor]);
+				}
+#endif
+				correction_steps = mr.following_error[motor] * STEP_CORRECTION_FACTOR;
+
+				if (correction_steps > 0) {
+					correction_steps = min3(correction_steps, fabs(travel_steps[motor]), STEP_CORRECTION_MAX);
+				} else {
+					correction_steps = max3(correction_steps, -fabs(travel_steps[motor]), -STEP_CORRECTION_MAX);
+				}
+				st_exec_pre.mot[motor].corrected_steps += correction_steps;
+				travel_steps[motor] -= correction_steps;
 			}
-			st_pre.mot[motor].corrected_steps += correction_steps;
-			travel_steps[motor] -= correction_steps;
+		}
+#endif
+		float steps = travel_steps[motor];			// steps to feed the substep math, possibly geared down
+
+#ifdef __MICROSTEP_GEARING
+		// Microstep gearing. Segments whose step rate approaches the DDA's
+		// one-step-per-tick ceiling are emitted in a coarser microstep mode:
+		// the loader switches the mode pins and the substep math below runs on
+		// the geared-down step count, cutting the emitted rate by the gear.
+		// Everything upstream of this point - commanded steps, encoder counts,
+		// following error - stays in the configured resolution, so step_sign
+		// is scaled to make the encoder count 'gear' microsteps per emitted
+		// step. See stepper.h for the up/down thresholds and the hysteresis.
+		uint8_t gear = st_exec_pre.mot[motor].gear;
+#ifdef __DDA_SCALE
+		// Gearing caps the absolute step rate, so the ratio is always taken at
+		// the full clock: a segment fast enough to gear selects the undivided
+		// clock anyway, and a scaled slow segment must not be kept from gearing
+		// back down by its inflated per-tick ratio at the divided clock.
+		float steps_per_tick = fabs(steps) / (segment_time * 60 * FREQUENCY_DDA);
+#else
+		float steps_per_tick = fabs(steps) / (float)st_exec_pre.dda_ticks;
+#endif
+		while ((steps_per_tick > (MICROSTEP_GEAR_UP_RATIO * gear)) &&
+			   ((gear * 2) <= st_cfg.mot[motor].microsteps)) { gear *= 2;}
+		while ((gear > 1) && (steps_per_tick < (MICROSTEP_GEAR_DOWN_RATIO * (gear / 2)))) { gear /= 2;}
+		if (gear != st_exec_pre.mot[motor].gear) {
+			st_exec_pre.mot[motor].gear_scale = (float)st_exec_pre.mot[motor].gear / (float)gear;
+			st_exec_pre.mot[motor].gear_change_flag = true;
+			st_exec_pre.mot[motor].gear = gear;
+		}
+		if (gear != 1) {
+			steps /= (float)gear;
+			st_exec_pre.mot[motor].step_sign *= (int8_t)gear;	// encoder counts configured microsteps per emitted step
 		}
 #endif
 		// Compute substeb increment. The accumulator must be *exactly* the incoming
@@ -1058,10 +1687,61 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 		// Rounding is performed to eliminate a negative bias in the uint32 conversion
 		// that results in long-term negative drift. (fabs/round order doesn't matter)
 
-		st_pre.mot[motor].substep_increment = round(fabs(travel_steps[motor] * DDA_SUBSTEPS));
+#ifdef __PREP_FIXED_POINT
+		// Q16.16 fast path. One float multiply and a cast replace the
+		// fabs/round/float-multiply chain, then scaling to substeps is a 32x32
+		// integer multiply with round-to-nearest. Segments too long for Q16.16
+		// (not reachable at nominal segment times) fall back to float math.
+		if (fabs(steps) < 32767.0) {
+			int32_t travel_fp = (int32_t)(steps * 65536.0);	// Q16.16 steps
+			if (travel_fp < 0) { travel_fp = -travel_fp; }
+			st_exec_pre.mot[motor].substep_increment =
+				(uint32_t)((((uint64_t)(uint32_t)travel_fp * DDA_SUBSTEPS_Q8) + (1UL<<23)) >> 24);
+		} else {
+			st_exec_pre.mot[motor].substep_increment = round(fabs(steps * DDA_SUBSTEPS));
+		}
+#else
+		st_exec_pre.mot[motor].substep_increment = round(fabs(steps * DDA_SUBSTEPS));
+#endif
+
+#ifdef __DDA_SMOOTHING
+		// Segment-boundary velocity interpolation. The increment ramps from the previous
+		// segment's final rate S toward (2I - S) in bumps applied every DDA_SMOOTHING_TICKS,
+		// so the area under the ramp - the distance - matches the constant-rate segment
+		// exactly; the division residue is folded into the accumulator once at load time.
+		// The DDA staircase becomes piecewise linear without shrinking segment time.
+		// Segments whose ramp would cross zero rate (decelerating past half speed) and
+		// motors resuming after an idle segment run unsmoothed at their constant rate.
+		{
+			int64_t increment = (int64_t)st_exec_pre.mot[motor].substep_increment;
+			int64_t start = (int64_t)st_exec_pre.mot[motor].smoothing_prev;
+			int32_t groups = st_exec_pre.dda_ticks / DDA_SMOOTHING_TICKS;
+			int32_t rem = st_exec_pre.dda_ticks - (groups * DDA_SMOOTHING_TICKS);
+			int32_t weight = ((DDA_SMOOTHING_TICKS * groups * (groups-1)) / 2) + (rem * groups);
+			int32_t delta = 0;
+			int32_t residual = 0;
+			if ((weight > 0) && (start <= (2 * increment)) && (start != increment)) {
+				int64_t total = (increment - start) * st_exec_pre.dda_ticks;
+				delta = (int32_t)(total / weight);
+				residual = (int32_t)(total - ((int64_t)delta * weight));
+			} else {
+				start = increment;
+			}
+			st_exec_pre.mot[motor].substep_increment_start = (uint32_t)start;
+			st_exec_pre.mot[motor].substep_increment_delta = delta;
+			st_exec_pre.mot[motor].substep_residual = residual;
+			st_exec_pre.mot[motor].smoothing_prev = (uint32_t)(start + ((int64_t)groups * delta));
+		}
+#endif
 	}
-	st_pre.move_type = MOVE_TYPE_ALINE;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	st_exec_pre.move_type = MOVE_TYPE_ALINE;
+	st_exec_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+#if defined(__DIAG) && defined(__JOB_STATS)
+	dia.job_segments++;
+#endif
+#ifdef __NET_SEGMENT_BUS
+	net_master_send_segment(travel_steps, segment_time);	// no-op unless in NETWORK_MASTER mode
+#endif
 	return (STAT_OK);
 }
 
@@ -1071,8 +1751,8 @@ stat_t st_prep_line(float travel_steps[], float following_error[], float segment
 
 void st_prep_null()
 {
-	st_pre.move_type = MOVE_TYPE_NULL;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// signal that prep buffer is empty
+	st_exec_pre.move_type = MOVE_TYPE_NULL;
+	st_exec_pre.buffer_state = PREP_BUFFER_OWNED_BY_EXEC;	// signal that prep buffer is empty
 }
 
 /*
@@ -1081,9 +1761,9 @@ void st_prep_null()
 
 void st_prep_command(void *bf)
 {
-	st_pre.move_type = MOVE_TYPE_COMMAND;
-	st_pre.bf = (mpBuf_t *)bf;
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	st_exec_pre.move_type = MOVE_TYPE_COMMAND;
+	st_exec_pre.bf = (mpBuf_t *)bf;
+	st_exec_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
 }
 
 /*
@@ -1092,11 +1772,45 @@ void st_prep_command(void *bf)
 
 void st_prep_dwell(float microseconds)
 {
-	st_pre.move_type = MOVE_TYPE_DWELL;
-	st_pre.dda_period = _f_to_period(FREQUENCY_DWELL);
-	st_pre.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
-	st_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+	st_exec_pre.move_type = MOVE_TYPE_DWELL;
+#ifdef __PRECISE_DWELL
+	st_exec_pre.dda_ticks = (uint32_t)(microseconds * DWELL_TICKS_PER_USEC);
+	if (st_exec_pre.dda_ticks == 0) { st_exec_pre.dda_ticks = 1; }// zero ticks would underflow the downcount
+#else
+	st_exec_pre.dda_period = _f_to_period(FREQUENCY_DWELL);
+	st_exec_pre.dda_ticks = (uint32_t)((microseconds/1000000) * FREQUENCY_DWELL);
+#endif
+	st_exec_pre.buffer_state = PREP_BUFFER_OWNED_BY_LOADER;	// signal that prep buffer is ready
+}
+
+#ifdef __SYNC_OUT
+/*
+ * st_arm_sync_out() - arm a position-triggered output change
+ *
+ *	Arms the motor mapped to the given axis to change the GPIO bits after
+ *	|distance| units of travel, counted in (micro)steps from the point in the
+ *	move stream where this is called - normally a queued planner command, so
+ *	the countdown starts at an exact queue position. The sign of the distance
+ *	selects the edge: positive sets the bits, negative clears them. A zero
+ *	distance fires immediately. An unexpired countdown keeps counting into
+ *	subsequent moves; re-arming replaces it.
+ */
+void st_arm_sync_out(float distance, uint8_t axis, uint8_t bitmask)
+{
+	for (uint8_t motor=0; motor<MOTORS; motor++) {
+		if (st_cfg.mot[motor].motor_map != axis) { continue; }
+		uint32_t steps = (uint32_t)(fabs(distance) * st_cfg.mot[motor].steps_per_unit);
+		st_run.sync_out_bitmask = bitmask;
+		st_run.sync_out_set = (distance >= 0);
+		if (steps == 0) {
+			_sync_out_fire();
+		} else {
+			st_run.mot[motor].sync_out_steps = steps;	// arming is the last operation
+		}
+		return;
+	}
 }
+#endif // __SYNC_OUT
 
 /*
  * _set_hw_microsteps() - set microsteps in hardware
@@ -1140,7 +1854,7 @@ static void _set_hw_microsteps(const uint8_t motor, const uint8_t microsteps)
  * Functions to get and set variables from the cfgArray table
  ***********************************************************************************/
 
-/* HELPERS
+/* HELPERS
  * _get_motor() - helper to return motor number as an index
  */
 
@@ -1162,13 +1876,13 @@ static void _set_motor_steps_per_unit(nvObj_t *nv)
 	st_reset();
 }
 
-/* PER-MOTOR FUNCTIONS
- * st_set_sa() - set motor step angle
- * st_set_tr() - set travel per motor revolution
- * st_set_mi() - set motor microsteps
- * st_set_pm() - set motor power mode
- * st_set_pl() - set motor power level
- */
+/* PER-MOTOR FUNCTIONS
+ * st_set_sa() - set motor step angle
+ * st_set_tr() - set travel per motor revolution
+ * st_set_mi() - set motor microsteps
+ * st_set_pm() - set motor power mode
+ * st_set_pl() - set motor power level
+ */
 
 stat_t st_set_sa(nvObj_t *nv)			// motor step angle
 {
@@ -1192,17 +1906,18 @@ stat_t st_set_mi(nvObj_t *nv)			// motor microsteps
 	}
 	set_int(nv);						// set it anyway, even if it's unsupported. It could also be > 255
 	_set_motor_steps_per_unit(nv);
-	_set_hw_microsteps(_get_motor(nv), (uint8_t)nv->value);
+	_set_hw_microsteps(_get_motor(nv), (uint8_t)mi);	// nv->value is re-stored typed by set_int()
 	return (STAT_OK);
 }
 
 stat_t st_set_pm(nvObj_t *nv)			// motor power mode
 {
-	if ((uint8_t)nv->value >= MOTOR_POWER_MODE_MAX_VALUE)
-        return (STAT_INPUT_VALUE_RANGE_ERROR);
-	set_ui8(nv);
+	if ((uint8_t)nv->value >= MOTOR_POWER_MODE_MAX_VALUE)
+        return (STAT_INPUT_VALUE_RANGE_ERROR);
+	set_ui8(nv);
+	_arm_power_event();
 	return (STAT_OK);
-	// NOTE: The motor power callback makes these settings take effect immediately
+	// NOTE: The motor power callback makes these settings take effect immediately
 }
 
 /*
@@ -1235,8 +1950,7 @@ stat_t st_set_pl(nvObj_t *nv)	// motor power level
  */
 stat_t st_get_pwr(nvObj_t *nv)
 {
-	nv->value = _motor_is_enabled(_get_motor(nv));
-	nv->valuetype = TYPE_INTEGER;
+	nv_store_int(nv, _motor_is_enabled(_get_motor(nv)));
 	return (STAT_OK);
 }
 
@@ -1254,6 +1968,7 @@ stat_t st_get_pwr(nvObj_t *nv)
 stat_t st_set_mt(nvObj_t *nv)
 {
 	st_cfg.motor_power_timeout = min(MOTOR_TIMEOUT_SECONDS_MAX, max(nv->value, MOTOR_TIMEOUT_SECONDS_MIN));
+	_arm_power_event();
 	return (STAT_OK);
 }
 
@@ -1268,6 +1983,7 @@ stat_t st_set_md(nvObj_t *nv)	// Make sure this function is not part of initiali
         }
         _deenergize_motor(motor-1);     // adjust so that motor 1 is actually 0 (etc)
 	}
+	_arm_power_event();					// so MOTOR_ALWAYS_POWERED motors get re-enforced
 	return (STAT_OK);
 }
 
@@ -1306,8 +2022,11 @@ static const char fmt_0sa[] PROGMEM = "[%s%s] m%s step angle%20.3f%s\n";
 static const char fmt_0tr[] PROGMEM = "[%s%s] m%s travel per revolution%10.4f%s\n";
 static const char fmt_0mi[] PROGMEM = "[%s%s] m%s microsteps%16d [1,2,4,8]\n";
 static const char fmt_0po[] PROGMEM = "[%s%s] m%s polarity%18d [0=normal,1=reverse]\n";
-static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=disabled,1=always on,2=in cycle,3=when moving]\n";
+static const char fmt_0pm[] PROGMEM = "[%s%s] m%s power management%10d [0=disabled,1=always on,2=in cycle,3=when moving]\n";
 static const char fmt_0pl[] PROGMEM = "[%s%s] m%s motor power level%13.3f [0.000=minimum, 1.000=maximum]\n";
+#ifdef __BACKLASH_COMP
+static const char fmt_0bl[] PROGMEM = "[%s%s] m%s backlash%22.4f%s\n";
+#endif
 static const char fmt_pwr[] PROGMEM = "Motor %c power enabled state:%2.0f\n";
 
 void st_print_mt(nvObj_t *nv) { text_print_flt(nv, fmt_mt);}
@@ -1316,22 +2035,22 @@ void st_print_md(nvObj_t *nv) { text_print_nul(nv, fmt_md);}
 
 static void _print_motor_ui8(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, (uint8_t)nv->value);
+	text_print_P(format, nv->group, nv->token, nv->group, (uint8_t)nv->value);
 }
 
 static void _print_motor_flt_units(nvObj_t *nv, const char *format, uint8_t units)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value, GET_TEXT_ITEM(msg_units, units));
+	text_print_P(format, nv->group, nv->token, nv->group, nv->value, GET_TEXT_ITEM(msg_units, units));
 }
 
 static void _print_motor_flt(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->group, nv->token, nv->group, nv->value);
+	text_print_P(format, nv->group, nv->token, nv->group, nv->value);
 }
 
 static void _print_motor_pwr(nvObj_t *nv, const char *format)
 {
-	fprintf_P(stderr, format, nv->token[0], nv->value);
+	text_print_P(format, nv->token[0], nv->value);
 }
 
 void st_print_ma(nvObj_t *nv) { _print_motor_ui8(nv, fmt_0ma);}
@@ -1341,6 +2060,9 @@ void st_print_mi(nvObj_t *nv) { _print_motor_ui8(nv, fmt_0mi);}
 void st_print_po(nvObj_t *nv) { _print_motor_ui8(nv, fmt_0po);}
 void st_print_pm(nvObj_t *nv) { _print_motor_ui8(nv, fmt_0pm);}
 void st_print_pl(nvObj_t *nv) { _print_motor_flt(nv, fmt_0pl);}
+#ifdef __BACKLASH_COMP
+void st_print_bl(nvObj_t *nv) { _print_motor_flt_units(nv, fmt_0bl, cm_get_units_mode(MODEL));}
+#endif
 void st_print_pwr(nvObj_t *nv){ _print_motor_pwr(nv, fmt_pwr);}
 
 #endif // __TEXT_MODE
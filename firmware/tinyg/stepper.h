@@ -117,6 +117,13 @@
  *		or mutexes are needed, which makes the code simpler and faster. With the exception of
  *		the actual values used in step generation (which runs continuously) you can count on
  *		LOAD, EXEC, PREP and PLAN not stepping on each other's variables.
+ *
+ *	  -	With __PREP_AHEAD the PREP results go into a staging buffer (st_stage) and are
+ *		handed forward to the load buffer (st_pre) as soon as it is free, so the pipeline
+ *		runs two prepared segments deep. A PREP that overruns a segment boundary then eats
+ *		the buffered segment instead of starving the DDA; such near-misses are counted in
+ *		the $dia group (diap) so the remaining margin is visible. Without the flag a late
+ *		PREP stalls the step generator until it completes.
  */
 /**** Line planning and execution (in more detail) ****
  *
@@ -253,56 +260,98 @@ enum prepBufferState {
 
 // Currently there is no distinction between IDLE and OFF (DEENERGIZED)
 // In the future IDLE will be powered at a low, torque-maintaining current
-
-enum motorPowerState {					// used w/start and stop flags to sequence motor power
-	MOTOR_OFF = 0,						// motor is stopped and deenergized
-	MOTOR_IDLE,							// motor is stopped and may be partially energized for torque maintenance
-	MOTOR_RUNNING,						// motor is running (and fully energized)
-	MOTOR_POWER_TIMEOUT_START,			// transitional state to start power-down timeout
-	MOTOR_POWER_TIMEOUT_COUNTDOWN		// count down the time to de-energizing motors
-};
-
-enum cmMotorPowerMode {
-	MOTOR_DISABLED = 0,					// motor enable is deactivated
-	MOTOR_ALWAYS_POWERED,				// motor is always powered while machine is ON
-	MOTOR_POWERED_IN_CYCLE,				// motor fully powered during cycles, de-powered out of cycle
-	MOTOR_POWERED_ONLY_WHEN_MOVING,		// motor only powered while moving - idles shortly after it's stopped - even in cycle
-//	MOTOR_POWER_REDUCED_WHEN_IDLE,		// enable Vref current reduction for idle (FUTURE)
-//	MOTOR_ADAPTIVE_POWER				// adjust motor current with velocity (FUTURE)
-	MOTOR_POWER_MODE_MAX_VALUE			// for input range checking
-};
-
-// Stepper power management settings (applicable to ARM only)
-#define Vcc	3.3							// volts
-#define MaxVref	2.25					// max vref for driver circuit. Our ckt is 2.25 volts
+
+enum motorPowerState {					// used w/start and stop flags to sequence motor power
+	MOTOR_OFF = 0,						// motor is stopped and deenergized
+	MOTOR_IDLE,							// motor is stopped and may be partially energized for torque maintenance
+	MOTOR_RUNNING,						// motor is running (and fully energized)
+	MOTOR_POWER_TIMEOUT_START,			// transitional state to start power-down timeout
+	MOTOR_POWER_TIMEOUT_COUNTDOWN		// count down the time to de-energizing motors
+};
+
+enum cmMotorPowerMode {
+	MOTOR_DISABLED = 0,					// motor enable is deactivated
+	MOTOR_ALWAYS_POWERED,				// motor is always powered while machine is ON
+	MOTOR_POWERED_IN_CYCLE,				// motor fully powered during cycles, de-powered out of cycle
+	MOTOR_POWERED_ONLY_WHEN_MOVING,		// motor only powered while moving - idles shortly after it's stopped - even in cycle
+//	MOTOR_POWER_REDUCED_WHEN_IDLE,		// enable Vref current reduction for idle (FUTURE)
+//	MOTOR_ADAPTIVE_POWER				// adjust motor current with velocity (FUTURE)
+	MOTOR_POWER_MODE_MAX_VALUE			// for input range checking
+};
+
+// Stepper power management settings (applicable to ARM only)
+#define Vcc	3.3							// volts
+#define MaxVref	2.25					// max vref for driver circuit. Our ckt is 2.25 volts
 #define POWER_LEVEL_SCALE_FACTOR ((MaxVref/Vcc)) // scale power level setting for voltage range
-
+
 // Min/Max timeouts allowed for motor disable. Allow for inertial stop; must be non-zero
 #define MOTOR_TIMEOUT_SECONDS_MIN 	(float)0.1		// seconds !!! SHOULD NEVER BE ZERO !!!
 #define MOTOR_TIMEOUT_SECONDS_MAX	(float)4294967	// (4294967295/1000) -- for conversion to uint32_t
 #define MOTOR_TIMEOUT_SECONDS 		(float)0.1		// seconds in DISABLE_AXIS_WHEN_IDLE mode
 #define MOTOR_TIMEOUT_WHEN_MOVING	(float)0.25		// timeout for a motor in _ONLY_WHEN_MOVING mode
 
-/* DDA substepping
- *	DDA Substepping is a fixed.point scheme to increase the resolution of the DDA pulse generation
- *	while still using integer math (as opposed to floating point). Improving the accuracy of the DDA
- *	results in more precise pulse timing and therefore less pulse jitter and smoother motor operation.
- *
- *	The DDA accumulator is an int32_t, so the accumulator has the number range of about 2.1 billion.
- *	The DDA_SUBSTEPS is used to multiply the step count for a segment to maximally use this number range.
- *	DDA_SUBSTEPS can be computed for a given DDA clock rate and segment time not to exceed the available
- *	number range. Variables are:
- *
- *		MAX_LONG == 2^31, maximum signed long (depth of accumulator. NB: accumulator values are negative)
- *		FREQUENCY_DDA == DDA clock rate in Hz.
- *		NOM_SEGMENT_TIME == upper bound of segment time in minutes
- *		0.90 == a safety factor used to reduce the result from theoretical maximum
- *
+/* DDA substepping
+ *	DDA Substepping is a fixed.point scheme to increase the resolution of the DDA pulse generation
+ *	while still using integer math (as opposed to floating point). Improving the accuracy of the DDA
+ *	results in more precise pulse timing and therefore less pulse jitter and smoother motor operation.
+ *
+ *	The DDA accumulator is an int32_t, so the accumulator has the number range of about 2.1 billion.
+ *	The DDA_SUBSTEPS is used to multiply the step count for a segment to maximally use this number range.
+ *	DDA_SUBSTEPS can be computed for a given DDA clock rate and segment time not to exceed the available
+ *	number range. Variables are:
+ *
+ *		MAX_LONG == 2^31, maximum signed long (depth of accumulator. NB: accumulator values are negative)
+ *		FREQUENCY_DDA == DDA clock rate in Hz.
+ *		NOM_SEGMENT_TIME == upper bound of segment time in minutes
+ *		0.90 == a safety factor used to reduce the result from theoretical maximum
+ *
  *	The number is about 8.5 million for the Xmega running a 50 KHz DDA with 5 millisecond segments
  *	The ARM is about 1/4 that (or less) as the DDA clock rate is 4x higher. Decreasing the nominal
  *	segment time increases the number precision.
  */
+#ifdef __ADAPTIVE_SEGMENTS
+// Adaptive segments can run as long as SEGMENT_USEC_MAX, so size the substep
+// multiplier for that upper bound or the accumulator overflows on long segments.
+#define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (MAX_SEGMENT_TIME * 60)))
+#else
 #define DDA_SUBSTEPS ((MAX_LONG * 0.90) / (FREQUENCY_DDA * (NOM_SEGMENT_TIME * 60)))
+#endif
+
+#ifdef __DDA_SMOOTHING
+#define DDA_SMOOTHING_TICKS 4			// DDA ticks between increment ramp updates (power of 2 keeps the ISR cheap)
+#endif
+
+/* Per-segment DDA clock scaling - see st_prep_line(). A slow segment runs the
+ * DDA at FREQUENCY_DDA divided by the largest power-of-two divisor (up to
+ * DDA_SCALE_MAX_DIVISOR) that still gives every step at least DDA_SCALE_MARGIN
+ * clock ticks, cutting step ISR overhead by the same factor on finishing
+ * passes. Substep increments are clock-independent - only dda_ticks and the
+ * timer period change, and the loader already programs the period per segment
+ * - so the position math is unaffected. The margin bounds step timing
+ * quantization at the scaled clock and leaves headroom for backlash takeup
+ * and step correction injection on top of the planned steps.
+ */
+#ifdef __DDA_SCALE
+#define DDA_SCALE_MAX_DIVISOR 8			// lowest clock is FREQUENCY_DDA/8
+#define DDA_SCALE_MARGIN ((float)2.5)	// minimum DDA ticks per step at the scaled clock
+#endif
+
+/* Microstep gearing thresholds, in emitted steps per DDA tick. A segment
+ * upshifts (coarser mode, fewer steps) while its rate at the current gear
+ * exceeds the UP ratio, and only downshifts once the rate at the next finer
+ * gear would sit below the DOWN ratio - the gap between the two is the
+ * hysteresis that keeps the gear from flapping between adjacent segments.
+ */
+#ifdef __MICROSTEP_GEARING
+#define MICROSTEP_GEAR_UP_RATIO 0.5		// gear up when steps per tick exceed this at the current gear
+#define MICROSTEP_GEAR_DOWN_RATIO 0.4	// gear down only if the finer gear would run below this
+#endif
+
+/* DDA_SUBSTEPS_Q8 is the substep multiplier in Q24.8 fixed point for the
+ * __PREP_FIXED_POINT fast path in st_prep_line(). At ~8.5 million the Q8 form
+ * still fits a uint32 (~2.2 billion) with relative error below 1e-9.
+ */
+#define DDA_SUBSTEPS_Q8 ((uint32_t)(DDA_SUBSTEPS * 256.0))
 
 /* Step correction settings
  *	Step correction settings determine how the encoder error is fed back to correct position errors.
@@ -312,49 +361,55 @@ enum cmMotorPowerMode {
  *	is too small and/or amount too large and/or holdoff is too small you may get a runaway correction
  *	and error will grow instead of shrink (or oscillate).
  */
-#define STEP_CORRECTION_THRESHOLD	(float)2.00		// magnitude of forwarding error to apply correction (in steps)
+#define STEP_CORRECTION_THRESHOLD			  2		// magnitude of following error to apply correction (in whole steps)
 #define STEP_CORRECTION_FACTOR		(float)0.25		// factor to apply to step correction for a single segment
 #define STEP_CORRECTION_MAX			(float)0.60		// max step correction allowed in a single segment
 #define STEP_CORRECTION_HOLDOFF		 	 	  5		// minimum number of segments to wait between error correction
+#ifdef __STEP_CORRECTION_FINE
+#define STEP_CORRECTION_PERSIST				  8		// consecutive same-sign evaluations before a small error counts as drift
+#endif
 #define STEP_INITIAL_DIRECTION		DIRECTION_CW
 
-/*
- * Stepper control structures
- *
- *	There are 5 main structures involved in stepper operations;
- *
- *	data structure:						found in:		runs primarily at:
- *	  mpBuffer planning buffers (bf)	  planner.c		  main loop
- *	  mrRuntimeSingleton (mr)			  planner.c		  MED ISR
- *	  stConfig (st_cfg)					  stepper.c		  write=bkgd, read=ISRs
- *	  stPrepSingleton (st_pre)			  stepper.c		  MED ISR
- *	  stRunSingleton (st_run)			  stepper.c		  HI ISR
- *
- *	Care has been taken to isolate actions on these structures to the execution level
- *	in which they run and to use the minimum number of volatiles in these structures.
- *	This allows the compiler to optimize the stepper inner-loops better.
- */
+/*
+ * Stepper control structures
+ *
+ *	There are 5 main structures involved in stepper operations;
+ *
+ *	data structure:						found in:		runs primarily at:
+ *	  mpBuffer planning buffers (bf)	  planner.c		  main loop
+ *	  mrRuntimeSingleton (mr)			  planner.c		  MED ISR
+ *	  stConfig (st_cfg)					  stepper.c		  write=bkgd, read=ISRs
+ *	  stPrepSingleton (st_pre)			  stepper.c		  MED ISR
+ *	  stRunSingleton (st_run)			  stepper.c		  HI ISR
+ *
+ *	Care has been taken to isolate actions on these structures to the execution level
+ *	in which they run and to use the minimum number of volatiles in these structures.
+ *	This allows the compiler to optimize the stepper inner-loops better.
+ */
 
 // Motor config structure
 
-typedef struct cfgMotor {				// per-motor configs
-	// public
+typedef struct cfgMotor {				// per-motor configs
+	// public
 	uint8_t	motor_map;					// map motor to axis
 	uint32_t microsteps;				// microsteps to apply for each axis (ex: 8)
 	uint8_t polarity;					// 0=normal polarity, 1=reverse motor direction
-	uint8_t power_mode;					// See cmMotorPowerMode for enum
+	uint8_t power_mode;					// See cmMotorPowerMode for enum
 	float power_level;					// set 0.000 to 1.000 for PMW vref setting
 	float step_angle;					// degrees per whole step (ex: 1.8)
 	float travel_rev;					// mm or deg of travel per motor revolution
 	float steps_per_unit;				// microsteps per mm (or degree) of travel
 	float units_per_step;				// mm or degrees of travel per microstep
+#ifdef __BACKLASH_COMP
+	float backlash;						// backlash takeup distance in mm (or degrees)
+#endif
 
-	// private
+	// private
 	float power_level_scaled;			// scaled to internal range - must be between 0 and 1
 } cfgMotor_t;
 
 typedef struct stConfig {				// stepper configs
-	float motor_power_timeout;			// seconds before setting motors to idle current (currently this is OFF)
+	float motor_power_timeout;			// seconds before setting motors to idle current (currently this is OFF)
 	cfgMotor_t mot[MOTORS];				// settings for motors 1-N
 } stConfig_t;
 
@@ -363,9 +418,18 @@ typedef struct stConfig {				// stepper configs
 typedef struct stRunMotor {				// one per controlled motor
 	uint32_t substep_increment;			// total steps in axis times substeps factor
 	int32_t substep_accumulator;		// DDA phase angle accumulator
+#ifdef __DDA_SMOOTHING
+	int32_t substep_increment_delta;	// increment ramp applied every DDA_SMOOTHING_TICKS
+#endif
+#ifdef __DDA_PULSE_CORE
+	uint8_t step_mask;					// STEP_BIT_bm if motor is active this segment, 0 if idle
+#endif
 	uint8_t power_state;				// state machine for managing motor power
 	uint32_t power_systick;				// sys_tick for next motor power state transition
-	float power_level_dynamic;			// power level for this segment of idle (ARM only)
+	float power_level_dynamic;			// power level for this segment of idle (ARM only)
+#ifdef __SYNC_OUT
+	uint32_t sync_out_steps;			// position-triggered output step countdown; 0 = disarmed
+#endif
 } stRunMotor_t;
 
 typedef struct stRunSingleton {			// Stepper static values and axis parameters
@@ -373,6 +437,16 @@ typedef struct stRunSingleton {			// Stepper static values and axis parameters
 	uint32_t dda_ticks_downcount;		// tick down-counter (unscaled)
 	uint32_t dda_ticks_X_substeps;		// ticks multiplied by scaling factor
 	stRunMotor_t mot[MOTORS];			// runtime motor structures
+#ifdef __DDA_SMOOTHING
+	uint8_t smoothing_countdown;		// ticks until the next increment ramp update
+#endif
+#ifdef __DUAL_ENDSTOP
+	uint8_t motor_gate_bm;				// bitmask of motors gated off by their own endstop (see st_gate_motor)
+#endif
+#ifdef __SYNC_OUT
+	uint8_t sync_out_bitmask;			// GPIO bit(s) to change when the countdown fires
+	uint8_t sync_out_set;				// true = set the bits, false = clear them
+#endif
 	uint16_t magic_end;
 } stRunSingleton_t;
 
@@ -384,24 +458,44 @@ typedef struct stPrepMotor {
 
 	// direction and direction change
 	int8_t direction;					// travel direction corrected for polarity
-	uint8_t prev_direction;				// travel direction from previous segment run for this motor
+	uint8_t prev_direction;				// travel direction from previous segment run for this motor
 	int8_t step_sign;					// set to +1 or -1 for encoders
 
 	// following error correction
 	int32_t correction_holdoff;			// count down segments between corrections
 	float corrected_steps;				// accumulated correction steps for the cycle (for diagnostic display only)
 
+#ifdef __BACKLASH_COMP
+	int32_t backlash_offset;			// motor steps currently injected to take up slack
+#endif
+
 	// accumulator phase correction
 	float prev_segment_time;			// segment time from previous segment run for this motor
+#ifdef __DDA_SMOOTHING
+	uint32_t substep_increment_start;	// first-tick increment - the previous segment's final rate
+	int32_t substep_increment_delta;	// increment ramp applied every DDA_SMOOTHING_TICKS
+	int32_t substep_residual;			// one-time accumulator nudge that keeps segment travel exact
+	uint32_t smoothing_prev;			// final effective increment of the previous segment
+#endif
 	float accumulator_correction;		// factor for adjusting accumulator between segments
 	uint8_t accumulator_correction_flag;// signals accumulator needs correction
 
+#ifdef __STEP_CORRECTION_FINE
+	int8_t error_persist;				// consecutive same-sign small following errors observed
+#endif
+
+#ifdef __MICROSTEP_GEARING
+	uint8_t gear;						// microstep gear divisor in effect - 1, 2, 4 or 8
+	uint8_t gear_change_flag;			// loader must switch the mode pins and rescale the accumulator
+	float gear_scale;					// old gear / new gear - accumulator phase rescale factor
+#endif
+
 } stPrepMotor_t;
 
 typedef struct stPrepSingleton {
 	uint16_t magic_start;				// magic number to test memory integrity
 	volatile uint8_t buffer_state;		// prep buffer state - owned by exec or loader
-	struct mpBuffer *bf;				// static pointer to relevant buffer
+	struct mpBuffer *bf;				// static pointer to relevant buffer
 	uint8_t move_type;					// move type
 
 	uint16_t dda_period;				// DDA or dwell clock period setting
@@ -430,12 +524,22 @@ void st_energize_motors(void);
 void st_deenergize_motors(void);
 void st_set_motor_power(const uint8_t motor);
 stat_t st_motor_power_callback(void);
+#ifdef __DUAL_ENDSTOP
+void st_gate_motor(const uint8_t motor);
+void st_ungate_motors(void);
+#endif
 
 void st_request_exec_move(void);
+#ifdef __NET_SEGMENT_BUS
+void st_request_load_move(void);		// used by the segment bus slave (see network.c)
+#endif
 void st_prep_null(void);
-void st_prep_command(void *bf);		// use a void pointer since we don't know about mpBuf_t yet)
+void st_prep_command(void *bf);		// use a void pointer since we don't know about mpBuf_t yet)
 void st_prep_dwell(float microseconds);
-stat_t st_prep_line(float travel_steps[], float following_error[], float segment_time);
+#ifdef __SYNC_OUT
+void st_arm_sync_out(float distance, uint8_t axis, uint8_t bitmask);
+#endif
+stat_t st_prep_line(float travel_steps[], float segment_time);
 
 stat_t st_set_sa(nvObj_t *nv);
 stat_t st_set_tr(nvObj_t *nv);
@@ -457,6 +561,7 @@ stat_t st_set_me(nvObj_t *nv);
 	void st_print_po(nvObj_t *nv);
 	void st_print_pm(nvObj_t *nv);
 	void st_print_pl(nvObj_t *nv);
+	void st_print_bl(nvObj_t *nv);
 	void st_print_pwr(nvObj_t *nv);
 	void st_print_mt(nvObj_t *nv);
 	void st_print_me(nvObj_t *nv);
@@ -471,6 +576,7 @@ stat_t st_set_me(nvObj_t *nv);
 	#define st_print_po tx_print_stub
 	#define st_print_pm tx_print_stub
 	#define st_print_pl tx_print_stub
+	#define st_print_bl tx_print_stub
 	#define st_print_pwr tx_print_stub
 	#define st_print_mt tx_print_stub
 	#define st_print_me tx_print_stub
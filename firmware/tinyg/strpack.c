@@ -0,0 +1,126 @@
+/*
+ * strpack.c - dictionary-packed PROGMEM string support
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	See strpack.h for the encoding rules and the D_xxx macro dictionary.
+ *	The table below must stay in the same order as the macro blocks there.
+ */
+
+#include "tinyg.h"
+#include "strpack.h"
+
+#ifdef __PACKED_STRINGS
+
+static const char dict_00[] PROGMEM = "Soft limit exceeded - ";
+static const char dict_01[] PROGMEM = "word is ";
+static const char dict_02[] PROGMEM = "assertion failure";
+static const char dict_03[] PROGMEM = "  $test";
+static const char dict_04[] PROGMEM = "Arc specification error - ";
+static const char dict_05[] PROGMEM = "Homing Error - ";
+static const char dict_06[] PROGMEM = "missing";
+static const char dict_07[] PROGMEM = "invalid";
+static const char dict_08[] PROGMEM = "https://github.com/synthetos";
+static const char dict_09[] PROGMEM = "this command";
+static const char dict_10[] PROGMEM = "Spindle ";
+static const char dict_11[] PROGMEM = "Show ";
+static const char dict_12[] PROGMEM = "test ";
+static const char dict_13[] PROGMEM = "is ";
+static const char dict_14[] PROGMEM = "cannot be ";
+static const char dict_15[] PROGMEM = "### TinyG ";
+static const char dict_16[] PROGMEM = "settings";
+static const char dict_17[] PROGMEM = "less than minimum ";
+static const char dict_18[] PROGMEM = "error";
+static const char dict_19[] PROGMEM = "the ";
+static const char dict_20[] PROGMEM = "command ";
+static const char dict_21[] PROGMEM = "Help ###";
+static const char dict_22[] PROGMEM = "configuration ";
+static const char dict_23[] PROGMEM = "These commands are active ";
+static const char dict_24[] PROGMEM = "system ";
+static const char dict_25[] PROGMEM = "position ";
+static const char dict_26[] PROGMEM = "cycle failed";
+static const char dict_27[] PROGMEM = "Generic ";
+static const char dict_28[] PROGMEM = "JSON ";
+static const char dict_29[] PROGMEM = "help screen";
+static const char dict_30[] PROGMEM = "to ";
+static const char dict_31[] PROGMEM = "for ";
+static const char dict_32[] PROGMEM = "velocity ";
+static const char dict_33[] PROGMEM = "  $";
+static const char dict_34[] PROGMEM = "not ";
+static const char dict_35[] PROGMEM = "Input ";
+static const char dict_36[] PROGMEM = "/TinyG";
+static const char dict_37[] PROGMEM = "all ";
+static const char dict_38[] PROGMEM = "enter ";
+static const char dict_39[] PROGMEM = "test";
+
+static const char *const dict_tab[] PROGMEM = {
+	dict_00, dict_01, dict_02, dict_03, dict_04, dict_05, dict_06, dict_07,
+	dict_08, dict_09, dict_10, dict_11, dict_12, dict_13, dict_14, dict_15,
+	dict_16, dict_17, dict_18, dict_19, dict_20, dict_21, dict_22, dict_23,
+	dict_24, dict_25, dict_26, dict_27, dict_28, dict_29, dict_30, dict_31,
+	dict_32, dict_33, dict_34, dict_35, dict_36, dict_37, dict_38, dict_39,
+};
+
+/*
+ * txt_unpack() - decode a packed PROGMEM string into a RAM buffer
+ *
+ *	Truncates at size-1 and always terminates. Returns dst so it can be used
+ *	in-line as a printf argument (see get_status_message() in main.c).
+ */
+char *txt_unpack(char *dst, const char *src, const uint8_t size)
+{
+	char *p = dst;
+	uint8_t c;
+
+	while ((c = pgm_read_byte(src++)) != 0) {
+		if (c < 0x80) {
+			if ((p - dst) >= (size-1)) { break;}
+			*p++ = c;
+		} else {
+			const char *word = (const char *)pgm_read_word(&dict_tab[c - 0x80]);
+			uint8_t w;
+			while ((w = pgm_read_byte(word++)) != 0) {
+				if ((p - dst) >= (size-1)) { break;}
+				*p++ = w;
+			}
+		}
+	}
+	*p = 0;
+	return (dst);
+}
+
+/*
+ * txt_print_packed() - stream-decode a packed PROGMEM string into the TX path
+ *
+ *	No intermediate buffer - bytes go straight to the stream, so arbitrarily
+ *	long text (the help screens) costs no RAM.
+ */
+void txt_print_packed(FILE *stream, const char *src)
+{
+	uint8_t c;
+
+	while ((c = pgm_read_byte(src++)) != 0) {
+		if (c < 0x80) {
+			fputc(c, stream);
+		} else {
+			const char *word = (const char *)pgm_read_word(&dict_tab[c - 0x80]);
+			uint8_t w;
+			while ((w = pgm_read_byte(word++)) != 0) { fputc(w, stream);}
+		}
+	}
+}
+
+#endif // __PACKED_STRINGS
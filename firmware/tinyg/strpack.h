@@ -0,0 +1,150 @@
+/*
+ * strpack.h - dictionary-packed PROGMEM string support
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	Dictionary compression for the flash-resident string tables. Each D_xxx
+ *	macro names a frequent word or phrase; with __PACKED_STRINGS enabled it
+ *	expands to a single escape byte (0x80 + dictionary index) and the decoder
+ *	in strpack.c re-expands it on the way out, either into a RAM buffer
+ *	(txt_unpack - used for the status messages) or streamed byte-at-a-time
+ *	into the TX path (txt_print_packed / fprintf_packed - used for the help
+ *	screens). With the flag disabled the same macros expand to the plain
+ *	words, so string definitions are written once and work either way.
+ *
+ *	Rules: a packed string must never feed printf-style formatting directly
+ *	(the escape bytes would pass through), and literal bytes must stay in the
+ *	0x01-0x7F ASCII range. The dictionary was chosen by phrase frequency over
+ *	the status message table and help screens; the macro blocks below and the
+ *	table in strpack.c must stay in the same order.
+ */
+
+#ifndef STRPACK_H_ONCE
+#define STRPACK_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#ifdef __PACKED_STRINGS
+#define D_SOFT_LIMIT_EXCEEDED_ "\x80"
+#define D_WORD_IS_ "\x81"
+#define D_ASSERTION_FAILURE "\x82"
+#define D_TEST "\x83"
+#define D_ARC_SPECIFICATION_ERROR_ "\x84"
+#define D_HOMING_ERROR_ "\x85"
+#define D_MISSING "\x86"
+#define D_INVALID "\x87"
+#define D_HTTPS_GITHUB_COM_SYNTHETOS "\x88"
+#define D_THIS_COMMAND "\x89"
+#define D_SPINDLE_ "\x8a"
+#define D_SHOW_ "\x8b"
+#define D_TEST_ "\x8c"
+#define D_IS_ "\x8d"
+#define D_CANNOT_BE_ "\x8e"
+#define D_TINYG_ "\x8f"
+#define D_SETTINGS "\x90"
+#define D_LESS_THAN_MINIMUM_ "\x91"
+#define D_ERROR "\x92"
+#define D_THE_ "\x93"
+#define D_COMMAND_ "\x94"
+#define D_HELP "\x95"
+#define D_CONFIGURATION_ "\x96"
+#define D_THESE_COMMANDS_ARE_ACTIVE_ "\x97"
+#define D_SYSTEM_ "\x98"
+#define D_POSITION_ "\x99"
+#define D_CYCLE_FAILED "\x9a"
+#define D_GENERIC_ "\x9b"
+#define D_JSON_ "\x9c"
+#define D_HELP_SCREEN "\x9d"
+#define D_TO_ "\x9e"
+#define D_FOR_ "\x9f"
+#define D_VELOCITY_ "\xa0"
+#define D_SYM "\xa1"
+#define D_NOT_ "\xa2"
+#define D_INPUT_ "\xa3"
+#define D_TINYG "\xa4"
+#define D_ALL_ "\xa5"
+#define D_ENTER_ "\xa6"
+#define D_TEST2 "\xa7"
+#else
+#define D_SOFT_LIMIT_EXCEEDED_ "Soft limit exceeded - "
+#define D_WORD_IS_ "word is "
+#define D_ASSERTION_FAILURE "assertion failure"
+#define D_TEST "  $test"
+#define D_ARC_SPECIFICATION_ERROR_ "Arc specification error - "
+#define D_HOMING_ERROR_ "Homing Error - "
+#define D_MISSING "missing"
+#define D_INVALID "invalid"
+#define D_HTTPS_GITHUB_COM_SYNTHETOS "https://github.com/synthetos"
+#define D_THIS_COMMAND "this command"
+#define D_SPINDLE_ "Spindle "
+#define D_SHOW_ "Show "
+#define D_TEST_ "test "
+#define D_IS_ "is "
+#define D_CANNOT_BE_ "cannot be "
+#define D_TINYG_ "### TinyG "
+#define D_SETTINGS "settings"
+#define D_LESS_THAN_MINIMUM_ "less than minimum "
+#define D_ERROR "error"
+#define D_THE_ "the "
+#define D_COMMAND_ "command "
+#define D_HELP "Help ###"
+#define D_CONFIGURATION_ "configuration "
+#define D_THESE_COMMANDS_ARE_ACTIVE_ "These commands are active "
+#define D_SYSTEM_ "system "
+#define D_POSITION_ "position "
+#define D_CYCLE_FAILED "cycle failed"
+#define D_GENERIC_ "Generic "
+#define D_JSON_ "JSON "
+#define D_HELP_SCREEN "help screen"
+#define D_TO_ "to "
+#define D_FOR_ "for "
+#define D_VELOCITY_ "velocity "
+#define D_SYM "  $"
+#define D_NOT_ "not "
+#define D_INPUT_ "Input "
+#define D_TINYG "/TinyG"
+#define D_ALL_ "all "
+#define D_ENTER_ "enter "
+#define D_TEST2 "test"
+#endif
+
+/*
+ * Global Scope Functions
+ */
+
+#ifdef __PACKED_STRINGS
+char *txt_unpack(char *dst, const char *src, const uint8_t size);	// decode src (PROGMEM) into dst
+void txt_print_packed(FILE *stream, const char *src);				// stream-decode src (PROGMEM)
+#define fprintf_packed(f,s) txt_print_packed(f,s)
+#else
+#define fprintf_packed(f,s) fprintf_P(f,s)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// End of include guard: STRPACK_H_ONCE
@@ -46,6 +46,8 @@
 #include "switch.h"
 #include "hardware.h"
 #include "canonical_machine.h"
+#include "encoder.h"
+#include "diagnostics.h"
 #include "text_parser.h"
 
 static void _switch_isr_helper(uint8_t sw_num);
@@ -102,6 +104,12 @@ void switch_init(void)
  *	When a switch closure is DETECTED the count increments for each RTC tick.
  *	When the count reaches zero the switch is tripped and action occurs.
  *	The counter continues to increment positive until the lockout is exceeded.
+ *
+ *	With __SW_EDGE_TRIP defined the closing edge of an idle switch fires its action
+ *	directly from the ISR and goes straight to lockout, so reaction latency is
+ *	interrupt latency rather than the deglitch time. The counter machinery above
+ *	still times out the lockout and deglitches trailing (opening) edges, but the
+ *	RTC callback skips the scan entirely while all switches are idle.
  */
 
 ISR(X_MIN_ISR_vect)	{ _switch_isr_helper(SW_MIN_X);}
@@ -116,14 +124,73 @@ ISR(A_MAX_ISR_vect)	{ _switch_isr_helper(SW_MAX_A);}
 static void _switch_isr_helper(uint8_t sw_num)
 {
 	if (sw.mode[sw_num] == SW_MODE_DISABLED) return;	// this is never supposed to happen
+
+#ifdef __SW_EVENTS
+	// Stamp the raw edge before the lockout filter so both edges of a pulse
+	// shorter than the lockout window still reach the host. The timestamps let
+	// the host do its own debounce; a full ring drops the edge and flags the gap.
+	if (sw.event_mask & (1 << sw_num)) {
+		uint8_t w = sw.event_w;
+		uint8_t next = (w + 1) & (SW_EVENT_RING - 1);
+		if (next == sw.event_r) {
+			sw.event_overflow = true;
+		} else {
+			sw.event_sw[w] = sw_num;
+			sw.event_state[w] = read_switch(sw_num);
+			sw.event_stamp[w] = dia_time_us();
+			sw.event_w = next;
+		}
+	}
+#endif
 	if (sw.debounce[sw_num] == SW_LOCKOUT) return;		// exit if switch is in lockout
+
+#ifdef __EVENT_TRACE
+	dia_trace_event(DIA_EVENT_SWITCH, sw_num);			// stamp the raw edge; lockout filters bounce
+#endif
+
+#ifdef __SW_EDGE_TRIP
+	// Trip on the edge itself. The lockout period that follows absorbs contact
+	// bounce and noise bursts the same way it absorbed re-fires of the deglitched
+	// trigger, so no re-trigger protection is lost by acting immediately.
+	if ((sw.debounce[sw_num] == SW_IDLE) && (read_switch(sw_num) == SW_CLOSED)) {
+		sw.sw_num_thrown = sw_num;						// record number of thrown switch
+		sw.debounce[sw_num] = SW_LOCKOUT;
+		sw.count[sw_num] = 0;							// lockout runs for the full period
+		sw.debounce_pending = true;
+
+		if ((cm.cycle_state == CYCLE_HOMING) || (cm.cycle_state == CYCLE_PROBE)) {	// regardless of switch type
+#ifdef __PROBE_LATCH
+			if (cm.cycle_state == CYCLE_PROBE) { en_latch_encoders();}	// capture contact position before the hold
+#endif
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+			if ((cm.cycle_state == CYCLE_HOMING) && (cm_homing_squaring_switch(sw_num))) {
+				return;									// gated one gantry motor - its partner is still seeking
+			}
+#endif
+			cm_request_feedhold();
+		} else if (sw.mode[sw_num] & SW_LIMIT_BIT) {	// should be a limit switch, so fire it.
+			sw.limit_flag = true;						// triggers an emergency shutdown
+		}
+		return;
+	}
+#endif
 	sw.debounce[sw_num] = SW_DEGLITCHING;				// either transitions state from IDLE or overwrites it
 	sw.count[sw_num] = -SW_DEGLITCH_TICKS;				// reset deglitch count regardless of entry state
+#ifdef __SW_EDGE_TRIP
+	sw.debounce_pending = true;
+#endif
 	read_switch(sw_num);							// sets the state value in the struct
 }
 
 void switch_rtc_callback(void)
 {
+#ifdef __SW_EDGE_TRIP
+	// Skip the scan entirely while no debounce or lockout is in flight. The flag
+	// is cleared before the scan and re-set by any switch found active, so a
+	// switch ISR firing mid-scan cannot be lost.
+	if (!sw.debounce_pending) return;
+	sw.debounce_pending = false;
+#endif
 	for (uint8_t i=0; i < NUM_SWITCHES; i++) {
 		if (sw.mode[i] == SW_MODE_DISABLED || sw.debounce[i] == SW_IDLE)
             continue;
@@ -135,15 +202,29 @@ void switch_rtc_callback(void)
             if(old_state != read_switch(i)) {
                 sw.debounce[i] = SW_DEGLITCHING;
                 sw.count[i] = -SW_DEGLITCH_TICKS;
+#ifdef __SW_EDGE_TRIP
+				sw.debounce_pending = true;
+#endif
             }
             continue;
 		}
+#ifdef __SW_EDGE_TRIP
+		sw.debounce_pending = true;						// still deglitching or locked out
+#endif
 		if (sw.count[i] == 0) {							// trigger point
 			sw.sw_num_thrown = i;						// record number of thrown switch
 			sw.debounce[i] = SW_LOCKOUT;
 //			sw_show_switch();							// only called if __DEBUG enabled
 
 			if ((cm.cycle_state == CYCLE_HOMING) || (cm.cycle_state == CYCLE_PROBE)) {		// regardless of switch type
+#ifdef __PROBE_LATCH
+				if (cm.cycle_state == CYCLE_PROBE) { en_latch_encoders();}	// late latch, but still pre-hold
+#endif
+#if defined(__DUAL_ENDSTOP) && !defined(__NEW_SWITCHES)
+				if ((cm.cycle_state == CYCLE_HOMING) && (cm_homing_squaring_switch(i))) {
+					continue;						// gated one gantry motor - its partner is still seeking
+				}
+#endif
 				cm_request_feedhold();
 			} else if (sw.mode[i] & SW_LIMIT_BIT) {		// should be a limit switch, so fire it.
 				sw.limit_flag = true;					// triggers an emergency shutdown
@@ -177,6 +258,9 @@ void reset_switches()
 		sw.debounce[i] = SW_IDLE;
         read_switch(i);
 	}
+#ifdef __SW_EDGE_TRIP
+	sw.debounce_pending = false;
+#endif
 	sw.limit_flag = false;
 }
 
@@ -254,6 +338,11 @@ stat_t sw_set_sw(nvObj_t *nv)			// switch setting
 static const char fmt_st[] PROGMEM = "[st]  switch type%18d [0=NO,1=NC]\n";
 void sw_print_st(nvObj_t *nv) { text_print_ui8(nv, fmt_st);}
 
+#ifdef __SW_EVENTS
+static const char fmt_sev[] PROGMEM = "[sev] switch event mask%12d [0=off]\n";
+void sw_print_sev(nvObj_t *nv) { text_print_ui8(nv, fmt_sev);}
+#endif
+
 //static const char fmt_ss[] PROGMEM = "Switch %s state:     %d\n";
 //void sw_print_ss(nvObj_t *nv) { fprintf(stderr, fmt_ss, nv->token, (uint8_t)nv->value);}
 
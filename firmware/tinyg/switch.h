@@ -98,20 +98,20 @@ enum swNums {	 			// indexes into switch arrays
  * Defines for new switch handling code
  */
 
-// switch array configuration / sizing
-#define SW_PAIRS				HOMING_AXES	// number of axes that can have switches
-#define SW_POSITIONS			2			// swPosition is either SW_MIN or SW)MAX
-
-enum swPosition {
-	SW_MIN = 0,
-	SW_MAX
-};
-
-enum swEdge {
-	SW_NO_EDGE = 0,
-	SW_LEADING,
-	SW_TRAILING,
-};
+// switch array configuration / sizing
+#define SW_PAIRS				HOMING_AXES	// number of axes that can have switches
+#define SW_POSITIONS			2			// swPosition is either SW_MIN or SW)MAX
+
+enum swPosition {
+	SW_MIN = 0,
+	SW_MAX
+};
+
+enum swEdge {
+	SW_NO_EDGE = 0,
+	SW_LEADING,
+	SW_TRAILING,
+};
 
 /*
  * Interrupt levels and vectors - The vectors are hard-wired to xmega ports
@@ -132,6 +132,11 @@ enum swEdge {
 #define Z_MAX_ISR_vect PORTE_INT1_vect
 #define A_MAX_ISR_vect PORTF_INT1_vect
 
+#ifdef __SW_EVENTS
+#define SW_EVENT_RING 8						// edge event ring entries - must be a power of 2
+#define SW_EVENT_MASK 0						// default $sev mask - no inputs report edges
+#endif
+
 /*
  * Switch control structures
 // Note 1: The term "thrown" is used because switches could be normally-open
@@ -145,32 +150,44 @@ struct swStruct {								// switch state
 	volatile uint8_t mode[NUM_SWITCHES];		// 0=disabled, 1=homing, 2=homing+limit, 3=limit
 	volatile uint8_t debounce[NUM_SWITCHES];	// switch debouncer state machine - see swDebounce
 	volatile int8_t count[NUM_SWITCHES];		// deglitching and lockout counter
+#ifdef __SW_EDGE_TRIP
+	volatile uint8_t debounce_pending;			// set by switch ISRs so the RTC callback can skip idle scans
+#endif
+#ifdef __SW_EVENTS
+	uint8_t event_mask;							// $sev - bit per switch number; enabled inputs push edge reports
+	volatile uint8_t event_w;					// event ring write index (ISR side)
+	uint8_t event_r;							// event ring read index (report side)
+	volatile uint8_t event_overflow;			// set when the ring fills and an edge is dropped
+	volatile uint8_t event_sw[SW_EVENT_RING];	// switch number of each event
+	volatile uint8_t event_state[SW_EVENT_RING];// switch state read at the edge
+	volatile uint32_t event_stamp[SW_EVENT_RING];	// dia_time_us() at the edge
+#endif
 };
 struct swStruct sw;
 
 //*** Structures from new-style switch code --- NOT YET FOLDED IN ***//
-
-typedef struct swSwitch {						// one struct per switch
-	// public
-	uint8_t type;								// swType: 0=NO, 1=NC
-	uint8_t mode;								// 0=disabled, 1=homing, 2=limit, 3=homing+limit
-	uint8_t state;								// set true if switch is closed
-
-	// private
-	uint8_t edge;								// keeps a transient record of edges for immediate inquiry
-	uint16_t debounce_ticks;					// number of millisecond ticks for debounce lockout
-	uint32_t debounce_timeout;					// time to expire current debounce lockout, or 0 if no lockout
-	void (*when_open)(struct swSwitch *s);		// callback to action function when sw is open - passes *s, returns void
-	void (*when_closed)(struct swSwitch *s);	// callback to action function when closed
-	void (*on_leading)(struct swSwitch *s);		// callback to action function for leading edge onset
-	void (*on_trailing)(struct swSwitch *s);	// callback to action function for trailing edge
-} switch_t;
-typedef void (*sw_callback)(switch_t *s);		// typedef for switch action callback
-
-typedef struct swSwitchArray {					// array of switches
-	uint8_t type;								// switch type for entire array (default)
-	switch_t s[SW_PAIRS][SW_POSITIONS];
-} switches_t;
+
+typedef struct swSwitch {						// one struct per switch
+	// public
+	uint8_t type;								// swType: 0=NO, 1=NC
+	uint8_t mode;								// 0=disabled, 1=homing, 2=limit, 3=homing+limit
+	uint8_t state;								// set true if switch is closed
+
+	// private
+	uint8_t edge;								// keeps a transient record of edges for immediate inquiry
+	uint16_t debounce_ticks;					// number of millisecond ticks for debounce lockout
+	uint32_t debounce_timeout;					// time to expire current debounce lockout, or 0 if no lockout
+	void (*when_open)(struct swSwitch *s);		// callback to action function when sw is open - passes *s, returns void
+	void (*when_closed)(struct swSwitch *s);	// callback to action function when closed
+	void (*on_leading)(struct swSwitch *s);		// callback to action function for leading edge onset
+	void (*on_trailing)(struct swSwitch *s);	// callback to action function for trailing edge
+} switch_t;
+typedef void (*sw_callback)(switch_t *s);		// typedef for switch action callback
+
+typedef struct swSwitchArray {					// array of switches
+	uint8_t type;								// switch type for entire array (default)
+	switch_t s[SW_PAIRS][SW_POSITIONS];
+} switches_t;
 
 /****************************************************************************************
  * Function prototypes
@@ -196,8 +213,14 @@ stat_t sw_set_sw(nvObj_t *nv);
 
 #ifdef __TEXT_MODE
 	void sw_print_st(nvObj_t *nv);
+#ifdef __SW_EVENTS
+	void sw_print_sev(nvObj_t *nv);
+#endif
 #else
 	#define sw_print_st tx_print_stub
+#ifdef __SW_EVENTS
+	#define sw_print_sev tx_print_stub
+#endif
 #endif // __TEXT_MODE
 
 #endif // End of include guard: SWITCH_H_ONCE
@@ -21,9 +21,11 @@
 #include "config.h"			// #2
 #include "controller.h"
 #include "planner.h"
+#include "hardware.h"
 #include "test.h"
 #include "util.h"
 #include "xio.h"
+#include "xmega/xmega_rtc.h"
 
 // regression test files
 #ifdef __CANNED_TESTS
@@ -59,39 +61,133 @@
  */
 uint8_t run_test(nvObj_t *nv)
 {
+	const char *addr = NULL;
+
 	switch ((uint8_t)nv->value) {
 		case 0: { return (STAT_OK);}
 #ifdef __CANNED_TESTS
 
-		case 1: { xio_open(XIO_DEV_PGM, PGMFILE(&test_smoke),PGM_FLAGS); break;}
-		case 2: { xio_open(XIO_DEV_PGM, PGMFILE(&test_homing),PGM_FLAGS); break;}
-		case 3: { xio_open(XIO_DEV_PGM, PGMFILE(&test_squares),PGM_FLAGS); break;}
-		case 4: { xio_open(XIO_DEV_PGM, PGMFILE(&test_arcs),PGM_FLAGS); break;}
-		case 5: { xio_open(XIO_DEV_PGM, PGMFILE(&test_dwell),PGM_FLAGS); break;}
-		case 6: { xio_open(XIO_DEV_PGM, PGMFILE(&test_feedhold),PGM_FLAGS); break;}
-		case 7: { xio_open(XIO_DEV_PGM, PGMFILE(&test_Mcodes),PGM_FLAGS); break;}
-		case 8: { xio_open(XIO_DEV_PGM, PGMFILE(&test_json),PGM_FLAGS); break;}
-		case 9: { xio_open(XIO_DEV_PGM, PGMFILE(&test_inverse_time),PGM_FLAGS); break;}
-		case 10: { xio_open(XIO_DEV_PGM, PGMFILE(&test_rotary),PGM_FLAGS); break;}
-		case 11: { xio_open(XIO_DEV_PGM, PGMFILE(&test_small_moves),PGM_FLAGS); break;}
-		case 12: { xio_open(XIO_DEV_PGM, PGMFILE(&test_slow_moves),PGM_FLAGS); break;}
-		case 13: { xio_open(XIO_DEV_PGM, PGMFILE(&test_coordinate_offsets),PGM_FLAGS); break;}
-		case 14: { xio_open(XIO_DEV_PGM, PGMFILE(&test_microsteps),PGM_FLAGS); break;}
-		case 50: { xio_open(XIO_DEV_PGM, PGMFILE(&test_mudflap),PGM_FLAGS); break;}
-		case 51: { xio_open(XIO_DEV_PGM, PGMFILE(&test_braid),PGM_FLAGS); break;}
+		case 1: { addr = PGMFILE(&test_smoke); break;}
+		case 2: { addr = PGMFILE(&test_homing); break;}
+		case 3: { addr = PGMFILE(&test_squares); break;}
+		case 4: { addr = PGMFILE(&test_arcs); break;}
+		case 5: { addr = PGMFILE(&test_dwell); break;}
+		case 6: { addr = PGMFILE(&test_feedhold); break;}
+		case 7: { addr = PGMFILE(&test_Mcodes); break;}
+		case 8: { addr = PGMFILE(&test_json); break;}
+		case 9: { addr = PGMFILE(&test_inverse_time); break;}
+		case 10: { addr = PGMFILE(&test_rotary); break;}
+		case 11: { addr = PGMFILE(&test_small_moves); break;}
+		case 12: { addr = PGMFILE(&test_slow_moves); break;}
+		case 13: { addr = PGMFILE(&test_coordinate_offsets); break;}
+		case 14: { addr = PGMFILE(&test_microsteps); break;}
+		case 50: { addr = PGMFILE(&test_mudflap); break;}
+		case 51: { addr = PGMFILE(&test_braid); break;}
 
 #endif
 #ifdef __TEST_99
-		case 99: { xio_open(XIO_DEV_PGM, PGMFILE(&test_99),PGM_FLAGS); break;}
+		case 99: { addr = PGMFILE(&test_99); break;}
 #endif
 		default: {
 			fprintf_P(stderr,PSTR("Test #%d not found\n"),(uint8_t)nv->value);
 			return (STAT_ERROR);
 		}
 	}
+#ifdef __JOB_CHAIN
+	return (tg_run_source(XIO_DEV_PGM, addr));	// runs now, or chains behind a streaming file
+#else
+	xio_open(XIO_DEV_PGM, addr, PGM_FLAGS);
 	tg_set_primary_source(XIO_DEV_PGM);
 	return (STAT_OK);
+#endif
+}
+
+#ifdef __BENCHMARK
+/*
+ * run_benchmark() 		  - run a canned test file with instrumentation ($bench=N)
+ * bench_now()			  - sample the benchmark clock
+ * bench_sample_plan()	  - accumulate one mp_aline() planning interval
+ * bench_sample_exec()	  - accumulate one mp_exec_move() interval
+ * bench_report_callback()- emit the JSON summary once the run has drained
+ *
+ *	Uses TIMER_5 (see hardware.h) as a free-running sample clock at CLKper/8 -
+ *	0.25 uSec per tick, 16.4 ms before wrap. When __DIAG is enabled the
+ *	diagnostics module runs the same clock continuously and this code just
+ *	samples it. Interval arithmetic
+ *	is done in uint16 so a single wrap between samples still yields the right
+ *	answer. DDA headroom is sampled in the DDA ISR as (PER - CNT) at ISR exit.
+ */
+#define TIMER_BENCH				TIMER_5
+#define BENCH_TIMER_START		TC_CLKSEL_DIV8_gc	// 4 MHz sample clock
+#define BENCH_TIMER_STOP		TC_CLKSEL_OFF_gc
+#define BENCH_TICKS_PER_USEC	4
+
+benchmark_t bench;
+
+uint8_t run_benchmark(nvObj_t *nv)
+{
+	if (run_test(nv) != STAT_OK) { return (STAT_ERROR);}	// opens the PGM file & sets source
+	memset(&bench, 0, sizeof(bench));
+	bench.dda_headroom_min = 0xFFFF;
+#ifndef __DIAG									// diagnostics owns the clock and keeps it running
+	TIMER_BENCH.CNT = 0;
+	TIMER_BENCH.CTRLA = BENCH_TIMER_START;
+#endif
+	bench.start_ticks = rtc.sys_ticks;
+	bench.running = true;
+	return (STAT_OK);
+}
+
+uint16_t bench_now() { return (TIMER_BENCH.CNT);}
+
+void bench_sample_plan(uint16_t start_ticks)
+{
+	if (bench.running == false) { return;}
+	uint16_t ticks = (uint16_t)(TIMER_BENCH.CNT - start_ticks);
+	bench.blocks++;
+	bench.plan_ticks += ticks;
+	if (ticks > bench.plan_ticks_max) { bench.plan_ticks_max = ticks;}
+}
+
+void bench_sample_exec(uint16_t start_ticks)
+{
+	if (bench.running == false) { return;}
+	uint16_t ticks = (uint16_t)(TIMER_BENCH.CNT - start_ticks);
+	bench.exec_passes++;
+	bench.exec_ticks += ticks;
+	if (ticks > bench.exec_ticks_max) { bench.exec_ticks_max = ticks;}
+}
+
+stat_t bench_report_callback()
+{
+	if (bench.running == false) { return (STAT_NOOP);}
+	if (cs.primary_src == XIO_DEV_PGM) { return (STAT_NOOP);}	// file still feeding
+	if (mp_get_planner_buffers_available() < PLANNER_BUFFER_POOL_SIZE) { return (STAT_NOOP);}
+	if (mp_get_runtime_busy() == true) { return (STAT_NOOP);}	// let motion finish
+
+#ifndef __DIAG
+	TIMER_BENCH.CTRLA = BENCH_TIMER_STOP;
+#endif
+	bench.running = false;
+
+	float seconds = (float)(rtc.sys_ticks - bench.start_ticks) / 1000;
+	float dda_margin = 100;										// no DDA ticks observed
+	if (bench.dda_headroom_min != 0xFFFF) {
+		dda_margin = ((float)bench.dda_headroom_min * 100) / (float)TIMER_DDA.PER;
+	}
+	fprintf_P(stderr, PSTR("{\"bench\":{\"blocks\":%lu,\"sec\":%1.2f,\"blocks_sec\":%1.1f,"
+			"\"plan_avg_us\":%1.0f,\"plan_max_us\":%1.0f,"
+			"\"exec_avg_us\":%1.0f,\"exec_max_us\":%1.0f,\"dda_margin_pct\":%1.1f}}\n"),
+		bench.blocks, seconds,
+		(seconds > 0) ? (float)bench.blocks / seconds : 0,
+		(bench.blocks > 0) ? (float)bench.plan_ticks / (bench.blocks * BENCH_TICKS_PER_USEC) : 0,
+		(float)bench.plan_ticks_max / BENCH_TICKS_PER_USEC,
+		(bench.exec_passes > 0) ? (float)bench.exec_ticks / (bench.exec_passes * BENCH_TICKS_PER_USEC) : 0,
+		(float)bench.exec_ticks_max / BENCH_TICKS_PER_USEC,
+		dda_margin);
+	return (STAT_OK);
 }
+#endif	// __BENCHMARK
 
 /*
  * run_canned_startup() - run a string on startup
@@ -24,6 +24,35 @@
 uint8_t run_test(nvObj_t *nv);
 void run_canned_startup(void);
 
+#ifdef __BENCHMARK
+/***** Benchmark mode *****
+ *
+ *	$bench=N runs the same canned file as $test=N but instruments the hot path
+ *	with a free-running TC (TIMER_BENCH, see test.c) and emits a one-line JSON
+ *	summary when the file has drained and motion has stopped. Used to compare
+ *	firmware builds: blocks/sec, planner and exec time (avg / worst case), and
+ *	worst-case DDA ISR headroom.
+ */
+typedef struct benchSingleton {			// benchmark accumulators
+	uint8_t running;					// true while a benchmark run is in flight
+	uint32_t start_ticks;				// rtc.sys_ticks at start of run (ms)
+	uint32_t blocks;					// aline blocks planned
+	uint32_t plan_ticks;				// accumulated mp_aline() time (bench ticks)
+	uint16_t plan_ticks_max;			// worst-case mp_aline() time
+	uint32_t exec_passes;				// exec interrupt passes
+	uint32_t exec_ticks;				// accumulated mp_exec_move() time
+	uint16_t exec_ticks_max;			// worst-case mp_exec_move() time
+	volatile uint16_t dda_headroom_min;	// min (PER - CNT) observed in DDA ISR (DDA ticks)
+} benchmark_t;
+extern benchmark_t bench;
+
+uint8_t run_benchmark(nvObj_t *nv);
+stat_t bench_report_callback(void);
+uint16_t bench_now(void);
+void bench_sample_plan(uint16_t start_ticks);
+void bench_sample_exec(uint16_t start_ticks);
+#endif	// __BENCHMARK
+
 /***** DEBUG support ******
  *
  *	DEBUGs are print statements you probably only want enabled during
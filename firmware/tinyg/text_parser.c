@@ -25,6 +25,8 @@
  * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <stdarg.h>				// for the fast print formatter
+
 #include "tinyg.h"
 #include "config.h"
 #include "canonical_machine.h"
@@ -180,6 +182,115 @@ void text_response(const stat_t status, char_t *buf)
  * text_print_multiline_formatted()
  */
 
+#ifdef __FAST_TEXT_PRINT
+/*
+ * Fast text-mode formatter
+ *
+ *	$ dumps print dozens of lines through vfprintf_P, which re-parses each
+ *	PROGMEM format string and emits the result a character at a time.
+ *	_print_va() specializes the few conversions the format tables actually
+ *	use - %s %c %d %u %lu and %f with width and precision - rendering floats
+ *	with fntoa() and integers locally, and accumulates the rendered lines in
+ *	a batch buffer that is pushed to the TX queue in large writes at the end
+ *	of each print list. Anything outside the subset falls back to vfprintf_P
+ *	after a flush so line ordering is preserved. The batch is flushed with
+ *	fputs() rather than the DMA block writer because the DMA path can park
+ *	the caller's buffer until the transfer drains, and the batch buffer is
+ *	reused immediately.
+ */
+#define TEXT_BATCH_LEN 192				// batch accumulator - flushed to the TX queue in large writes
+#define TEXT_LINE_MAX 94				// worst-case rendered line (longest table format, expanded)
+
+static char tp_batch[TEXT_BATCH_LEN];
+static uint8_t tp_count = 0;
+
+static void _print_flush()
+{
+	if (tp_count == 0) { return;}
+	tp_batch[tp_count] = NUL;
+	fputs(tp_batch, stderr);
+	tp_count = 0;
+}
+
+static uint8_t _ltoa10(char *str, uint32_t n)	// cousin of _ui32toa() in util.c, which is file static
+{
+	char tmp[10];								// 4294967295 is 10 digits
+	uint8_t i = 0;
+	do { tmp[i++] = '0' + (n % 10); n /= 10; } while (n != 0);
+	uint8_t len = i;
+	while (i != 0) { *str++ = tmp[--i];}
+	return (len);
+}
+
+static void _print_va(const char *format, va_list args)
+{
+	if ((tp_count + TEXT_LINE_MAX) >= TEXT_BATCH_LEN) { _print_flush();}
+	char *wr = tp_batch + tp_count;
+	char *limit = tp_batch + (TEXT_BATCH_LEN-1);	// leave room for the NUL
+
+	va_list fallback;					// preserved in case a conversion is outside the subset
+	va_copy(fallback, args);
+
+	const char *rd = format;
+	char c;
+	while ((c = (char)pgm_read_byte(rd++)) != NUL) {
+		if (c != '%') {
+			if (wr < limit) { *wr++ = c;}
+			continue;
+		}
+		uint8_t width = 0;
+		uint8_t precision = 6;						// printf's %f default
+		uint8_t longflag = false;
+		c = (char)pgm_read_byte(rd++);
+		while ((c >= '0') && (c <= '9')) { width = (width*10) + (c-'0'); c = (char)pgm_read_byte(rd++);}
+		if (c == '.') {
+			precision = 0;
+			c = (char)pgm_read_byte(rd++);
+			while ((c >= '0') && (c <= '9')) { precision = (precision*10) + (c-'0'); c = (char)pgm_read_byte(rd++);}
+		}
+		if (c == 'l') { longflag = true; c = (char)pgm_read_byte(rd++);}
+
+		char field[32];								// widest conversion the tables produce
+		char *body = field;
+		uint8_t len = 0;
+		switch (c) {
+			case 's': { body = va_arg(args, char *); len = (uint8_t)strlen(body); break;}
+			case 'c': { field[0] = (char)va_arg(args, int); len = 1; break;}
+			case 'd': case 'i': {
+				int32_t value = (longflag) ? va_arg(args, int32_t) : (int32_t)va_arg(args, int);
+				if (value < 0) { field[0] = '-'; len = _ltoa10(&field[1], (uint32_t)(-value)) + 1;}
+				else		   { len = _ltoa10(field, (uint32_t)value);}
+				break;
+			}
+			case 'u': {
+				len = _ltoa10(field, (longflag) ? va_arg(args, uint32_t) : (uint32_t)va_arg(args, unsigned int));
+				break;
+			}
+			case 'f': { len = (uint8_t)fntoa(field, (float)va_arg(args, double), precision); break;}
+			case '%': { field[0] = '%'; len = 1; break;}
+			default: {								// outside the subset - let stdio format it
+				_print_flush();						// tp_count is still pre-line, so the partial line is discarded
+				vfprintf_P(stderr, format, fallback);
+				va_end(fallback);
+				return;
+			}
+		}
+		while ((width > len) && (wr < limit)) { *wr++ = ' '; width--;}	// right justify
+		for (uint8_t i=0; ((i < len) && (wr < limit)); i++) { *wr++ = body[i];}
+	}
+	va_end(fallback);
+	tp_count = (uint8_t)(wr - tp_batch);
+}
+
+void text_print_P(const char *format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	_print_va(format, args);
+	va_end(args);
+}
+#endif // __FAST_TEXT_PRINT
+
 void text_print_list(stat_t status, uint8_t flags)
 {
 	switch (flags) {
@@ -188,6 +299,9 @@ void text_print_list(stat_t status, uint8_t flags)
 		case TEXT_INLINE_VALUES: { text_print_inline_values(nv_body); break; }
 		case TEXT_MULTILINE_FORMATTED: { text_print_multiline_formatted(nv_body);}
 	}
+#ifdef __FAST_TEXT_PRINT
+	_print_flush();						// push any batched lines to the TX queue
+#endif
 }
 
 void text_print_inline_pairs(nvObj_t *nv)
@@ -200,7 +314,11 @@ void text_print_inline_pairs(nvObj_t *nv)
 								  fntoa(global_string_buf, nv->value, nv->precision);
 								  fprintf_P(stderr,PSTR("%s:%s"), nv->token, global_string_buf) ; break;
 								}
+#ifdef __TYPED_CONFIG
+			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%s:%ld"), nv->token, (long)nv->value_int); break;}
+#else
 			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%s:%1.0f"), nv->token, nv->value); break;}
+#endif
 			case TYPE_DATA:	    { fprintf_P(stderr,PSTR("%s:%lu"), nv->token, *v); break;}
 			case TYPE_STRING:	{ fprintf_P(stderr,PSTR("%s:%s"), nv->token, *nv->stringp); break;}
 			case TYPE_EMPTY:	{ fprintf_P(stderr,PSTR("\n")); return; }
@@ -220,7 +338,11 @@ void text_print_inline_values(nvObj_t *nv)
 								  fntoa(global_string_buf, nv->value, nv->precision);
 								  fprintf_P(stderr,PSTR("%s"), global_string_buf) ; break;
 								}
+#ifdef __TYPED_CONFIG
+			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%ld"), (long)nv->value_int); break;}
+#else
 			case TYPE_INTEGER:	{ fprintf_P(stderr,PSTR("%1.0f"), nv->value); break;}
+#endif
 			case TYPE_DATA:	    { fprintf_P(stderr,PSTR("%lu"), *v); break;}
 			case TYPE_STRING:	{ fprintf_P(stderr,PSTR("%s"), *nv->stringp); break;}
 			case TYPE_EMPTY:	{ fprintf_P(stderr,PSTR("\n")); return; }
@@ -262,10 +384,25 @@ void tx_print_flt(nvObj_t *nv) { text_print_flt(nv, fmt_flt);}
  *	NOTE: format's are passed in as flash strings (PROGMEM)
  */
 
+#ifdef __FAST_TEXT_PRINT
+
+void text_print_nul(nvObj_t *nv, const char *format) { text_print_P(format);}	// just print the format string
+void text_print_str(nvObj_t *nv, const char *format) { text_print_P(format, *nv->stringp);}
+void text_print_ui8(nvObj_t *nv, const char *format) { text_print_P(format, (uint8_t)nv_int_value(nv));}
+void text_print_int(nvObj_t *nv, const char *format) { text_print_P(format, (uint32_t)nv_int_value(nv));}
+void text_print_flt(nvObj_t *nv, const char *format) { text_print_P(format, nv->value);}
+
+void text_print_flt_units(nvObj_t *nv, const char *format, const char *units)
+{
+	text_print_P(format, nv->value, units);
+}
+
+#else	// __FAST_TEXT_PRINT
+
 void text_print_nul(nvObj_t *nv, const char *format) { fprintf_P(stderr, format);}	// just print the format string
 void text_print_str(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, *nv->stringp);}
-void text_print_ui8(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, (uint8_t)nv->value);}
-void text_print_int(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, (uint32_t)nv->value);}
+void text_print_ui8(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, (uint8_t)nv_int_value(nv));}
+void text_print_int(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, (uint32_t)nv_int_value(nv));}
 void text_print_flt(nvObj_t *nv, const char *format) { fprintf_P(stderr, format, nv->value);}
 
 void text_print_flt_units(nvObj_t *nv, const char *format, const char *units)
@@ -273,6 +410,8 @@ void text_print_flt_units(nvObj_t *nv, const char *format, const char *units)
 	fprintf_P(stderr, format, nv->value, units);
 }
 
+#endif	// __FAST_TEXT_PRINT
+
 /*
  * Formatted print supporting the text parser
  */
@@ -48,7 +48,9 @@ typedef struct txtSingleton {		// text mode data
 
 	/*** config values (PUBLIC) ***/
 
+#ifdef __TEXT_MODE					// headless builds don't carry the text format buffer
 	char_t format[NV_FORMAT_LEN+1];
+#endif
 
 	/*** runtime values (PRIVATE) ***/
 
@@ -81,6 +83,12 @@ extern txtSingleton_t txt;
 	void text_print_flt(nvObj_t *nv, const char *format);
 	void text_print_flt_units(nvObj_t *nv, const char *format, const char *units);
 
+#ifdef __FAST_TEXT_PRINT
+	void text_print_P(const char *format, ...);	// batched PROGMEM formatter - also used by config print functions
+#else
+	#define text_print_P(...) fprintf_P(stderr, __VA_ARGS__)
+#endif
+
 	void tx_print_tv(nvObj_t *nv);
 
 #else
@@ -0,0 +1,133 @@
+/*
+ * thc.c - torch height control for plasma cutting
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* Operation
+ *
+ *	Plasma arc voltage is proportional to arc length, so holding the voltage at
+ *	a setpoint holds the torch standoff as the sheet warps and dishes. Doing
+ *	this through a host adds a serial round trip to every correction; here the
+ *	whole loop is in-firmware: the ADC samples the (divided-down) arc voltage,
+ *	the RTC tick runs a proportional controller on the error, and the segment
+ *	runner (plan_exec.c) injects the resulting Z offset into each 5ms segment
+ *	target - the same steps-only injection mesh leveling uses, so the gcode
+ *	model's Z position is never disturbed.
+ *
+ *	The controller is deliberately simple. Each 10ms tick it filters the new
+ *	sample, converts the voltage error to a Z step ($thg, in mm per volt per
+ *	tick), and slews the offset by at most the rate bound ($thr). The offset
+ *	itself is clamped to the authority bound ($tha), so a lost arc or a torn
+ *	divider can never drive Z further than that from the programmed height.
+ *	Corrections only accumulate while THC is enabled ($the), the torch is on
+ *	(spindle active in the runtime model) and motion is running; otherwise
+ *	the offset bleeds back to zero at the same rate bound, so Z returns to
+ *	the programmed height without a step change.
+ */
+
+#include "tinyg.h"			// #1
+#include "config.h"			// #2
+#include "canonical_machine.h"
+#include "planner.h"
+#include "text_parser.h"
+#include "util.h"
+#include "thc.h"
+
+#ifdef __AVR
+#include "xmega/xmega_adc.h"
+#endif
+
+thcSingleton_t thc;
+
+/*
+ * thc_init() - initialize the torch height controller and its ADC channel
+ * thc_reset() - clear controller state (offset snaps to zero - use with motion stopped)
+ * thc_z_offset() - current Z correction for the segment runner
+ */
+
+void thc_init()
+{
+	thc_reset();
+#ifdef __AVR
+	adc_init(THC_ADC_CHANNEL);
+#endif
+}
+
+void thc_reset()
+{
+	thc.arc_voltage = 0;
+	thc.z_offset = 0;
+}
+
+float thc_z_offset() { return (thc.z_offset);}
+
+#ifdef __AVR
+/*
+ * thc_rtc_callback() - 10ms control loop, called from the RTC tick ISR
+ *
+ *	Runs at the interrupt level - see the ISR notes in xmega_rtc.c. The
+ *	segment runner executes at the same interrupt priority, so z_offset
+ *	reads and writes cannot tear against each other.
+ */
+
+void thc_rtc_callback()
+{
+	float sample = (float)adc_read_sample() * thc.scale;	// also starts the next conversion
+	thc.arc_voltage += (sample - thc.arc_voltage) / (1 << THC_FILTER_SHIFT);
+
+	float step = thc.rate / 6000;				// rate bound in mm per 10ms tick
+
+	if ((thc.enable == false) ||
+		(mr.gm.spindle_mode == SPINDLE_OFF) ||	// torch off in the runtime model
+		(cm.motion_state != MOTION_RUN)) {
+		if (thc.z_offset > step) { thc.z_offset -= step;}		// bleed the correction back
+		else if (thc.z_offset < -step) { thc.z_offset += step;}	// out so Z lands where the
+		else { thc.z_offset = 0;}								// program left it
+		return;
+	}
+	float error = thc.arc_voltage - thc.target_voltage;	// positive error = arc too long = torch too high
+	float correction = -error * thc.gain;
+	correction = min(step, max(-step, correction));
+	thc.z_offset = min(thc.authority, max(-thc.authority, thc.z_offset + correction));
+}
+#endif // __AVR
+
+/***********************************************************************************
+ * TEXT MODE SUPPORT
+ * Functions to print variables from the cfgArray table
+ ***********************************************************************************/
+
+#ifdef __TEXT_MODE
+
+static const char fmt_the[] PROGMEM  = "[the]  thc enable%17d [0=off,1=on]\n";
+static const char fmt_thv[] PROGMEM  = "[thv]  thc target voltage%9.1f volts\n";
+static const char fmt_thg[] PROGMEM  = "[thg]  thc gain%19.4f mm/volt\n";
+static const char fmt_tha[] PROGMEM  = "[tha]  thc authority%14.3f mm\n";
+static const char fmt_thr[] PROGMEM  = "[thr]  thc slew rate%14.0f mm/min\n";
+static const char fmt_ths[] PROGMEM  = "[ths]  thc voltage scale%10.4f volts/count\n";
+static const char fmt_thav[] PROGMEM = "[thav] thc arc voltage%12.1f volts\n";
+static const char fmt_thof[] PROGMEM = "[thof] thc z offset%15.3f mm\n";
+
+void thc_print_the(nvObj_t *nv) { text_print_ui8(nv, fmt_the);}
+void thc_print_thv(nvObj_t *nv) { text_print_flt(nv, fmt_thv);}
+void thc_print_thg(nvObj_t *nv) { text_print_flt(nv, fmt_thg);}
+void thc_print_tha(nvObj_t *nv) { text_print_flt(nv, fmt_tha);}
+void thc_print_thr(nvObj_t *nv) { text_print_flt(nv, fmt_thr);}
+void thc_print_ths(nvObj_t *nv) { text_print_flt(nv, fmt_ths);}
+void thc_print_thav(nvObj_t *nv) { text_print_flt(nv, fmt_thav);}
+void thc_print_thof(nvObj_t *nv) { text_print_flt(nv, fmt_thof);}
+
+#endif // __TEXT_MODE
@@ -0,0 +1,91 @@
+/*
+ * thc.h - torch height control for plasma cutting
+ * This file is part of the TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart, Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * As a special exception, you may use this file as part of a software library without
+ * restriction. Specifically, if other files instantiate templates or use macros or
+ * inline functions from this file, or you compile this file and link it with  other
+ * files to produce an executable, this file does not by itself cause the resulting
+ * executable to be covered by the GNU General Public License. This exception does not
+ * however invalidate any other reasons why the executable file might be covered by the
+ * GNU General Public License.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef THC_H_ONCE
+#define THC_H_ONCE
+
+#ifdef __cplusplus
+extern "C"{
+#endif
+
+#define THC_ADC_CHANNEL 2				// ADCA input pin carrying the divided-down arc voltage
+#define THC_FILTER_SHIFT 2				// IIR smoothing - each new sample carries 1/4 weight
+
+typedef struct thcSingleton {			// see thc.c for operation
+	// configuration ($th group)
+	uint8_t enable;						// $the - 0=off, 1=on
+	float target_voltage;				// $thv - arc voltage setpoint in volts
+	float gain;							// $thg - mm of Z correction per volt of error, per tick
+	float authority;					// $tha - max Z offset magnitude in mm
+	float rate;							// $thr - max offset slew rate in mm/min
+	float scale;						// $ths - volts per ADC count (divider dependent)
+	// state
+	float arc_voltage;					// filtered arc voltage in volts ($thav)
+	volatile float z_offset;			// current Z correction in mm - read by the segment runner ($thof)
+} thcSingleton_t;
+
+extern thcSingleton_t thc;
+
+/*** function prototypes ***/
+
+void thc_init(void);
+void thc_reset(void);
+float thc_z_offset(void);
+
+#ifdef __AVR
+void thc_rtc_callback(void);			// called from the RTC tick
+#endif
+
+#ifdef __TEXT_MODE
+
+	void thc_print_the(nvObj_t *nv);
+	void thc_print_thv(nvObj_t *nv);
+	void thc_print_thg(nvObj_t *nv);
+	void thc_print_tha(nvObj_t *nv);
+	void thc_print_thr(nvObj_t *nv);
+	void thc_print_ths(nvObj_t *nv);
+	void thc_print_thav(nvObj_t *nv);
+	void thc_print_thof(nvObj_t *nv);
+
+#else
+
+	#define thc_print_the tx_print_stub
+	#define thc_print_thv tx_print_stub
+	#define thc_print_thg tx_print_stub
+	#define thc_print_tha tx_print_stub
+	#define thc_print_thr tx_print_stub
+	#define thc_print_ths tx_print_stub
+	#define thc_print_thav tx_print_stub
+	#define thc_print_thof tx_print_stub
+
+#endif // __TEXT_MODE
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif	// End of include guard: THC_H_ONCE
@@ -45,7 +45,7 @@
 /****** REVISIONS ******/
 
 #ifndef TINYG_FIRMWARE_BUILD
-#define TINYG_FIRMWARE_BUILD        440.20	// arc test
+#define TINYG_FIRMWARE_BUILD        440.21	// cfgArray layout changed - invalidates stored EEPROM images
 
 #endif
 #define TINYG_FIRMWARE_VERSION		0.97					// firmware major version
@@ -55,14 +55,158 @@
 
 /****** COMPILE-TIME SETTINGS ******/
 
+// The default-on set below is budgeted to the ATxmega192A3's 16K SRAM
+// alongside the planner pool. Features costing ~1Kb or more of RAM (see the
+// per-flag notes) ship commented out and are enabled per build configuration;
+// the host sim enables the planner-side ones in sim/Makefile so the
+// regression gate still exercises them.
+
 #define __STEP_CORRECTION
+#define __EXEC_SEGMENT_BATCH				// amortize cruise segment math in mp_exec_aline()
+#define __PREP_FIXED_POINT					// Q16.16 substep conversion in st_prep_line()
 //#define __NEW_SWITCHES					// Using v9 style switch code
 //#define __JERK_EXEC						// Use computed jerk (versus forward difference based exec)
 //#define __KAHAN							// Use Kahan summation in aline exec functions
 
+//#define __CFG_SORTED_INDEX					// bucketed binary search for nv_get_index() (~1.3Kb RAM)
+#define __USART_TX_DMA						// DMA block transmit for USB reports (~512b RAM, AVR only)
+#define __XIO_ZERO_COPY						// parsers consume RX lines in place (~512b RAM, AVR only)
+#define __BENCHMARK							// $bench=N replays a test file with timing (see test.c)
+#define __ARC_INCREMENTAL_ROTATION			// rotate arc segments incrementally instead of sin/cos each
+//#define __ARC_NATIVE						// G2/G3 occupies one planner buffer; segments generated at exec time (~1.1Kb RAM)
+//#define __CUBIC_SPLINE						// G5/G5.1 Bezier blocks; one planner buffer, evaluated at exec time (~1.3Kb RAM)
+#define __SR_COMPILED						// precompiled status report field layout (~300b RAM)
+#define __SR_DEADBAND						// per-field change thresholds for filtered status reports
+#define __SR_BINARY							// packed binary status report frames ($sb=1)
+#define __PLAN_EXPORT						// stream planned velocity profiles per executed block ($pex=1)
+#define __NVM_WRITEBACK						// background flush of persistence writes (~200b RAM, AVR only)
+#define __BOOT_TIME							// measure reset-to-ready time, reported in the startup footer
+#define __DIAG								// per-second ISR margin and queue depth counters ($dia group)
+#define __PREPARSE							// pre-parse next JSON line while planner is full (~350b RAM)
+//#define __PLAN_STAGING						// stage compact raw blocks behind a full planner pool (~1KB RAM)
+#define __FAST_ACK							// emit empty-body JSON responses without serializing the nv list
+#define __ACK_WINDOW						// windowed cumulative acks - $aw=N acks every N streamed lines (needs __FAST_ACK)
+#define __TERSE_ACK						// $ta=1 - fixed-form "*status:line" acks for machine-to-machine links
+#define __JSON_BATCH						// multi-command arrays - [{..},{..}] runs in one parser pass, one combined response
+#define __GC_TOKENIZER						// single-pass parse of strict {"gc":"..."} lines ($js=1)
+#define __SW_EDGE_TRIP						// fire switch actions from the port ISR; skip idle RTC scans
+#define __PROBE_LATCH						// latch encoder counts at probe contact for the probe result
+#define __HOMING_OVERLAP					// overlapped rough-seek before the per-axis homing phases
+#define __ADAPTIVE_SEGMENTS					// scale segment time with planner queue depth ($sgl/$sgh)
+#define __SPINDLE_RAMP						// ramp spindle speed from the RTC tick instead of the planner queue
+#define __PWM_DUTY_TABLE					// precomputed spindle speed-to-compare-value table for fast PWM updates
+#define __RASTER							// laser raster engraving: per-step PWM modulation from streamed scanlines
+#define __VELOCITY_JOG						// jog as one open-ended velocity-mode move instead of queued micro-moves
+#define __BACKLASH_COMP						// inject backlash takeup steps at prep on motor direction reversals
+#define __JUNCTION_VMAX_CACHE				// direct-mapped cache of junction vmax results for repetitive toolpaths
+#define __JOB_STORE							// store an uploaded job in app flash and replay it at memory speed
+#define __PGM_BULK_READ						// windowed memcpy_P line reads for PROGMEM files (tests, on-board jobs)
+#define __FAST_UPDATE						// firmware upload over the binary channel with whole-image CRC (see fw_update.c)
+#define __AB_STAGING						// stage firmware pages in the background while jobs run (needs __FAST_UPDATE)
+#define __QR_LOOKAHEAD_TIME					// planned-time and starvation fields in queue reports ($qt/$qs)
+#define __CFG_GROUP_CACHE					// cached cfgArray index spans for fast config group expansion
+#define __CFG_RECORD_CACHE					// RAM cache of hot cfgArray record fields; skips repeated PROGMEM reads (~0.3Kb RAM)
+#define __LINE_CRC							// CRC16-framed input lines with sequence numbers and NAK recovery ($fr)
+#define __MOTOR_POWER_EVENTS				// event-scheduled motor power management; no polling during motion
+#define __NET_SEGMENT_BUS					// RS485 segment bus: master broadcasts prepped segments to slave boards
+#define __DDA_PULSE_CORE					// branch-minimized DDA ISR using precomputed step masks (AVR only)
+#define __STEP_PULSE_TIMER					// compare-timed step pulse trailing edges instead of inline stretching
+#define __STOP_PLAN							// precomputed feedhold stop plan; hold engages without a planning pass
+#define __HOLD_ACTIONS						// firmware park on feedhold - spindle pause and bounded Z retract, restored on cycle start ($fhz/$fhp, needs __VELOCITY_JOG)
+#define __START_GATE						// hold first motion until $pst ms of planned time is queued - clean launch at full lookahead (needs __QR_LOOKAHEAD_TIME)
+#define __MODAL_COMPRESS					// strip repeated F/S and unchanged axis words at the parser boundary
+//#define __NV_ARENAS							// separate nv list pools for commands and reports (~1.5Kb RAM)
+#define __EVENT_TRACE						// microsecond-stamped event ring for stall forensics ($det, needs __DIAG)
+#define __TRACE_RING						// deferred-format trace ring - hot paths log ids, $dtr formats on drain (needs __EVENT_TRACE)
+#define __SW_EVENTS							// push-mode switch edge reports with microsecond stamps ($sev, needs __EVENT_TRACE)
+#define __JOB_STATS							// end-of-job margin summary report at M2/M30 ($jse, needs __DIAG)
+//#define __SD_CARD							// stream jobs from an SPI SD card image with read-ahead ($sd, ~1Kb RAM)
+#define __CYCLE_SNAPSHOT					// shared modal-state snapshot for canned cycle entry/exit
+#define __DUAL_ENDSTOP						// gantry auto-squaring: per-motor step gating from paired homing switches
+#define __TX_PRIORITY						// small high-priority TX ring so acks and qr preempt queued report traffic
+#define __CHORD_BLEND						// merge collinear-within-tolerance G1 blocks in the planner ($bt, ~200 bytes RAM)
+//#define __NVM_SHADOW						// boot-loaded RAM image of NVM; reads never hit the EEPROM (~1.7Kb RAM, AVR only)
+//#define __SETTINGS_PROFILES				// named settings images in app flash; $prof swaps tooling setups (~0.5Kb RAM, needs __NVM_SHADOW)
+#define __SOFT_LIMIT_CACHE					// precomputed soft limit windows; the per-move test is two compares per axis
+#define __FOOTER_FLOW						// RX space and planned-time advisory in response footers (needs __QR_LOOKAHEAD_TIME)
+#define __ER_RING							// capture exceptions in a compact ring; expanded on $erd query
+#define __AXIS_TABLE						// flat axis constraint table; planning loops stop at the highest enabled axis
+#define __TX_CHUNKED						// park oversized responses and drain from the controller loop (needs __USART_TX_DMA)
+#define __BULK_SET							// bulk settings load: {"bset":[i,v,...]} applied in one pass against the NVM shadow
+#define __CMD_PASSTHRU						// coolant M-codes plan as zero-length links - no decel/accel cycle around them
+#define __PRECISE_DWELL						// time dwells by timer period (2 uSec resolution), not 100 uSec tick counting
+#define __ROTARY_MODULO						// axis mode 4 for rotaries: targets resolve modulo 360, shortest path
+#define __SYNC_OUT							// position-triggered output: $sot arms a GPIO change fired by the DDA at a step count
+#define __PC_PROFILE						// 100 Hz PC-sampling profiler on the RTC tick ($pcd, needs __DIAG)
+#define __CRASH_DUMP						// watchdog post-mortem snapshot to EEPROM ($crash, needs __DIAG)
+#define __STACK_WATERMARK					// stack painting + high-water scan, reported as $dias (needs __DIAG)
+#define __LOOP_BUDGET						// skip deferrable controller tasks when dispatch is overdue (needs __EVENT_TRACE)
+#define __RAMP_CHAIN						// collinear blocks continue the neighbor's ramp - no plateau at the boundary
+#define __JOB_CHECKPOINT					// periodic EEPROM checkpoint while machining; {"rsm":n} restores for resume
+#define __SRC_MUX							// console accepts priority commands while a job streams from another device
+#define __PREP_AHEAD						// second prep buffer - exec runs a full segment ahead of the loader
+#define __GC_TABLE							// G/M word dispatch probes a PROGMEM table instead of switch chains
+#define __INLINE_NORMALIZE					// gcode tokenizer normalizes as it consumes - no separate rewrite pass
+#define __FAST_FNTOA						// integer-scaled float-to-ASCII for reports; no printf float engine
+#define __FAST_ATOF							// integer-accumulating parse for gcode/JSON numeric literals
+#define __FAST_FLUSH						// queue flush marks buffers empty instead of reinitializing the ring
+#define __JV_MASK							// JSON verbosity compiles to a per-type suppress mask at $jv set time
+#define __HOMING_CAL						// $hcp repeats the homing latch and reports switch repeatability stats
+#define __PROBE_GRID						// autonomous grid probing with bulk result report ({prbg:[...]}, ~400 bytes RAM, needs __CYCLE_SNAPSHOT)
+#define __MESH_COMP							// bilinear mesh Z-compensation from the probed grid, applied in segment kinematics ({mesh:1|0})
+#define __TOOL_TABLE						// persisted tool table ($tt1-$tt9) with G43/G49 length compensation
+#define __THC								// torch height control: arc voltage ADC loop injecting a bounded Z offset (see thc.c)
+#define __ADAPTIVE_FEED						// adaptive feed: spindle load ADC loop bounding a feed override factor (see afc.c)
+#define __PV_TABLE							// peak-velocity-from-length uses a mantissa table instead of pow()
+#define __INPUT_SHAPER						// ZV/ZVD input shaping of the segment stream ($_shf/$_shz per axis, $shm; ~600b RAM)
+#define __TRAP_PLAN							// $apm=1 - constant-acceleration trapezoid planning for drives that don't need S-curves ($amx)
+#define __FAST_MATH							// approximate sqrt/cbrt/sin/cos for planner hot paths (see util.c for error bounds)
+#define __OFFSET_CACHE						// combined G5x+G92 offset vector rebuilt only when an offset changes
+#define __G68_ROTATION						// G68/G69 planar coordinate rotation fused into the target transform
+#define __FLASH_SCRUB						// idle-time CRC scrub of program flash; alarms on image corruption
+#define __HW_CRC							// use the xmega CRC module for image hashing on parts that have one (see xmega/xmega_crc.c)
+#define __CANNED_CYCLES						// G81/G82/G83 drilling cycles expanded into planner moves in-firmware
+#define __DDA_SMOOTHING						// interpolate the DDA rate within segments to smooth the velocity staircase
+#define __STARTUP_MACRO						// startup gcode macro persisted in EEPROM and replayed at boot
+#define __EVENT_MACRO						// labeled sections of the stored macro replayed on M6 and program start/end
+#define __JOB_CHAIN							// chain queued file devices back-to-back at EOF with no inter-file dead time
+#define __FAST_TEXT_PRINT					// specialized text-mode formatter with batched TX writes (see text_parser.c)
+#define __COMMIT_BATCH						// internal move producers commit several planner buffers per callback pass
+#define __MICROSTEP_GEARING					// gear microstep mode down per segment at high step rates (see stepper.c)
+#define __ASYNC_COMMAND						// commands may park in async records and complete behind motion (see config.c)
+#define __JUNCTION_PLANE_DEV				// resolve the junction deviation circle in the corner plane (see plan_line.c)
+#define __ZOID_CACHE						// cache trapezoid solutions for repeated identical blocks (see plan_zoid.c)
+#define __STEP_CORRECTION_FINE				// correct persistent sub-threshold following error (bounds drift under 1 step)
+#define __SPINDLE_CSS						// G96/G97 constant surface speed - RPM recomputed from the X radius at segment rate (see spindle.c)
+//#define __QDEC_ENCODER					// hardware quadrature decode of an external encoder (see encoder.h)
+//#define __INDEX_HOMING					// home to the encoder index pulse - replaces the slow latch pass (needs __QDEC_ENCODER)
+//#define __MPG_WHEEL						// MPG pendant handwheel fed to the velocity jog engine (needs __VELOCITY_JOG; excludes __QDEC_ENCODER and __SPINDLE_SYNC - same timer. See encoder.h)
+#define __USART_RX_DMA						// DMA-to-ring USB receive - replaces per-byte RX interrupts (see xio_usb.c)
+#define __XIO_RAW_LINE						// echo-off lines ingest via a bulk terminator scan - no per-byte flag dispatch (see xio_usart.c)
+#define __HIGH_BAUD							// 460800-capable baud profiles + RX overrun/framing counters ($dia, needs __DIAG)
+//#define __SPI_SLAVE_DMA					// SPI1 becomes a DMA-backed slave command channel for a Linux host (see xio_spi.c)
+//#define __SPINDLE_READY					// gate first motion after M3/M4 on a VFD at-speed input (see spindle.c)
+//#define __SPINDLE_RPM						// measure spindle RPM by timer capture of a pulse input - no ISR load (TCC1; see spindle.h)
+//#define __REPORT_USART					// route reports out the RS485 port so they never share bandwidth with G-code (see report.h)
+//#define __SPINDLE_SYNC					// G33 spindle-synchronized feed from a spindle encoder; excludes __QDEC_ENCODER (see spindle.h)
+#define __TRAVERSE_JERK					// rapids (G0) ramp at per-axis traverse jerk ($xjt) instead of the feed jerk (see plan_line.c)
+#define __PLAN_THROTTLE					// amortize planner backward passes over bursts of arriving blocks (see plan_line.c)
+#define __DDA_SCALE						// slow segments run a divided DDA clock to cut step ISR overhead (see stepper.c)
+#define __TIME_ESTIMATE					// $est job time estimation - run the planner with the stepper layer detached (see planner.c)
+#define __PATH_CONTROL					// honor G61 exact path / G64 P<tol> in junction planning and chord blending (see plan_line.c)
+#define __PACKED_STRINGS					// dictionary-packed PROGMEM string tables (see strpack.h)
+#define __TYPED_CONFIG					// store TYPE_INTEGER config values natively, not as floats (see config.h)
+#define __SR_ADAPTIVE						// rate-adaptive status reports - burst on change, decay when quiet (see report.c)
+#define __CONFIG_REPORT						// push config groups to subscribed hosts when values change ({cr:{...}}, see report.c)
+#define __WARM_RESET						// ^X re-inits motion state in place when the RAM image validates (see hardware.c)
+#define __REPORT_COALESCE					// hold sr/qr serialization while TX is congested; a held report sends latest state
+//#define __CONST_PROFILE					// freeze profile motion settings to constants; disables runtime motion config
+
+#ifndef __HEADLESS							// ReleaseHeadless build strips the console for JSON-only fleets (see tinyg.cproj)
 #define __TEXT_MODE							// enables text mode	(~10Kb)
 #define __HELP_SCREENS						// enables help screens (~3.5Kb)
 #define __CANNED_TESTS 						// enables $tests 		(~12Kb)
+#endif
 //#define __TEST_99 							// enables diagnostic test 99 (independent of other tests)
 
 /****** DEVELOPMENT SETTINGS ******/
@@ -193,6 +337,7 @@ typedef uint16_t magic_t;		// magic number size
 #define HOMING_AXES	4			// number of axes that can be homed (assumes Zxyabc sequence)
 #define MOTORS		4			// number of motors on the board
 #define COORDS		6			// number of supported coordinate systems (1-6)
+#define TOOLS		9			// tool table entries ($tt1 - $tt9: group names cap at 3 chars)
 #define PWMS		2			// number of supported PWM channels
 
 // Note: If you change COORDS you must adjust the entries in cfgArray table in config.c
@@ -278,8 +423,16 @@ char *get_status_message(stat_t status);
 #define	STAT_INITIALIZING 15			// initializing - not ready for use
 #define	STAT_ENTERING_BOOT_LOADER 16	// this code actually emitted from boot loader, not TinyG
 #define	STAT_FUNCTION_IS_STUBBED 17
+#ifdef __ASYNC_COMMAND
+#define	STAT_ASYNC_PENDING 18			// command parked in an async record - response is deferred
+#else
 #define	STAT_ERROR_18 18
+#endif
+#ifdef __QDEC_ENCODER
+#define	STAT_STALL_DETECTED 19			// external encoder error exceeds the stall threshold. NOTE: XIO codes align to here
+#else
 #define	STAT_ERROR_19 19				// NOTE: XIO codes align to here
+#endif
 
 // Internal errors and startup messages
 #define	STAT_INTERNAL_ERROR 20			// unrecoverable internal error
@@ -322,7 +475,11 @@ char *get_status_message(stat_t status);
 #define	STAT_ERROR_54 54
 #define	STAT_ERROR_55 55
 #define	STAT_ERROR_56 56
+#ifdef __SPINDLE_READY
+#define	STAT_SPINDLE_READY_TIMEOUT 57	// VFD never reported at-speed within the timeout
+#else
 #define	STAT_ERROR_57 57
+#endif
 #define	STAT_ERROR_58 58
 #define	STAT_ERROR_59 59
 
@@ -496,7 +653,7 @@ char *get_status_message(stat_t status);
 #define	STAT_MACHINE_ALARMED 203						// machine is alarmed. Command not processed
 #define	STAT_LIMIT_SWITCH_HIT 204						// a limit switch was hit causing shutdown
 #define	STAT_PLANNER_FAILED_TO_CONVERGE 205				// trapezoid generator can through this exception
-#define	STAT_ERROR_206 206
+#define	STAT_FIRMWARE_IMAGE_CRC_FAILED 206				// staged firmware image failed CRC16 verification
 #define	STAT_ERROR_207 207
 #define	STAT_ERROR_208 208
 #define	STAT_ERROR_209 209
@@ -157,10 +157,101 @@ float max4(float x1, float x2, float x3, float x4)
 	return (max);
 }
 
+#ifdef __FAST_MATH
+/* Approximate math for the planner hot paths
+ * 	fast_rsqrt() - 1/sqrt(x) by exponent bit trick plus two Newton steps
+ * 	fast_sqrt()  - x * fast_rsqrt(x)
+ * 	fast_cbrt()  - cube root by exponent estimate plus two Newton steps
+ * 	fast_sin()   - quadrant reduction into minimax polynomials
+ * 	fast_cos()   - fast_sin() advanced by pi/2
+ *
+ *	Every float operation is emulated in software on the Xmega, so a libm
+ *	sqrt() or sin() costs on the order of a millisecond's worth of planner
+ *	budget when it lands in a loop. These routines replace them where the
+ *	result only steers planning decisions - velocities, junction cosines,
+ *	move times - or where the positional error is provably below a step.
+ *
+ *	Error bounds (verified by exhaustive sweep against double precision):
+ * 	  fast_rsqrt/fast_sqrt  relative error < 5e-6
+ * 	  fast_cbrt             relative error < 2e-6
+ * 	  fast_sin/fast_cos     absolute error < 2e-6 for |x| < 25 radians,
+ * 	                        < 1.3e-5 out to |x| < 200 (reduction rounding)
+ *
+ *	For scale: a 5e-6 velocity error is noise against the jerk math, and a
+ *	2e-6 sin/cos error displaces an arc target by 2 nanometers per mm of
+ *	radius - three orders below the chordal tolerance. Zero and negative
+ *	arguments return 0 rather than NaN; the planner's operands are lengths,
+ *	radii and positive jerk terms, so the guards are belt-and-suspenders.
+ *	(The guards test <= 0, not EPSILON: a 1 micron move squared is 1e-6,
+ *	well under EPSILON but a perfectly good argument.)
+ */
+
+float fast_rsqrt(float x)
+{
+	if (x <= 0) { return (0);}
+	union { float f; uint32_t i; } u = { .f = x };
+	u.i = 0x5f375a86 - (u.i >> 1);					// initial estimate, err < 3.5% (Lomont's constant)
+	float y = u.f;
+	y = y * (1.5 - 0.5 * x * y * y);				// Newton step 1: err < 0.2%
+	y = y * (1.5 - 0.5 * x * y * y);				// Newton step 2: err < 5e-6
+	return (y);
+}
+
+float fast_sqrt(float x)
+{
+	return (x * fast_rsqrt(x));						// 0 for x <= 0
+}
+
+float fast_cbrt(float x)
+{
+	if (x <= 0) { return (0);}						// jerk terms are always positive
+	union { float f; uint32_t i; } u = { .f = x };
+	u.i = (u.i / 3) + 709921077;					// exponent/3 estimate (Hacker's Delight)
+	float y = u.f;
+	y = (2*y + x/(y*y)) / 3;						// Newton step 1
+	y = (2*y + x/(y*y)) / 3;						// Newton step 2: err < 2e-6
+	return (y);
+}
+
+/* Minimax polynomials on |r| <= pi/4 (coefficients from Cephes single precision) */
+
+static float _sin_poly(float r)
+{
+	float z = r*r;
+	return ((((-1.9515296e-4 * z + 8.3321609e-3) * z - 1.6666655e-1) * z) * r + r);
+}
+
+static float _cos_poly(float r)
+{
+	float z = r*r;
+	return (((2.4433157e-5 * z - 1.3887316e-3) * z + 4.1666646e-2) * z*z - 0.5 * z + 1);
+}
+
+float fast_sin(float x)
+{
+	// reduce to x = k*(pi/2) + r with |r| <= pi/4. The two-part pi/2 keeps
+	// the product exact: the hi part carries 12 mantissa bits, so fk * hi
+	// rounds nothing for |k| < 4096
+	int32_t k = (int32_t)(x * 0.63661977 + ((x >= 0) ? 0.5 : -0.5));
+	float fk = (float)k;
+	float r = (x - fk * 1.57078552246) - fk * 1.0804334e-5;
+	switch (k & 3) {								// sin(k*pi/2 + r) by quadrant
+		case 0: return (_sin_poly(r));
+		case 1: return (_cos_poly(r));
+		case 2: return (-_sin_poly(r));
+		default: return (-_cos_poly(r));
+	}
+}
+
+float fast_cos(float x)
+{
+	return (fast_sin(x + 1.57079632679));
+}
+#endif	// __FAST_MATH
+
 
 /**** String utilities ****
  * strcpy_U() 	   - strcpy workalike to get around initial NUL for blank string - possibly wrong
- * isnumber() 	   - isdigit that also accepts plus, minus, and decimal point
  * escape_string() - add escapes to a string - currently for quotes only
  */
 
@@ -174,14 +265,6 @@ uint8_t * strcpy_U( uint8_t * dst, const uint8_t * src )
 	return dst;
 }
 */
-
-uint8_t isnumber(char_t c)
-{
-	if (c == '.') { return (true); }
-	if (c == '-') { return (true); }
-	if (c == '+') { return (true); }
-	return (isdigit(c));
-}
 
 char_t *escape_string(char_t *dst, char_t *src)
 {
@@ -222,6 +305,58 @@ char_t *pstr2str(const char *pgm_string)
  *
  *	Returns length of string, less the terminating NUL character
  */
+#ifdef __FAST_FNTOA
+/*
+ *	__FAST_FNTOA converts by integer scaling instead of running the printf
+ *	float engine: split the value into integer and fractional parts, scale
+ *	the fraction by 10^precision, and emit the digits directly. Every report
+ *	and JSON float passes through here, so this is the hot path when status
+ *	reporting is verbose. Magnitudes too large for 32 bit scaling (and
+ *	precisions past 7) fall back to sprintf. Rounding is half-up on the
+ *	fraction, so the last decimal place can differ from printf by one when
+ *	that place lies at or below single precision resolution.
+ */
+static uint8_t _ui32toa(char_t *str, uint32_t n)
+{
+	char_t tmp[10];
+	uint8_t i = 0;
+	do { tmp[i++] = '0' + (n % 10); n /= 10;} while (n != 0);
+	uint8_t len = i;
+	while (i != 0) { *str++ = tmp[--i];}
+	return (len);
+}
+
+char_t fntoa(char_t *str, float n, uint8_t precision)
+{
+	if (isnan(n)) { strcpy(str, "nan"); return (3);}
+	if (isinf(n)) { strcpy(str, "inf"); return (3);}
+	if (precision > 7) { return ((char_t)sprintf((char *)str, "%f", (double)n));}
+
+	float a = fabs(n);
+	if (a >= 4294967040.0) {							// too large for integer scaling
+		return ((char_t)sprintf((char *)str, "%0.*f", (int)precision, (double)n));
+	}
+	uint32_t scale = 1;
+	for (uint8_t i=precision; i>0; i--) { scale *= 10;}
+	uint32_t integer = (uint32_t)a;
+	uint32_t fraction = (uint32_t)((a - (float)integer) * (float)scale + 0.5);
+	if (fraction >= scale) { integer++; fraction = 0;}	// fraction rounded up into the next integer
+
+	char_t *wr = str;
+	if (n < 0) { *wr++ = '-';}
+	wr += _ui32toa(wr, integer);
+	if (precision > 0) {
+		wr += precision + 1;
+		char_t *digit = wr;
+		for (uint8_t i=0; i<precision; i++) { *(--digit) = '0' + (fraction % 10); fraction /= 10;}
+		*(--digit) = '.';
+	}
+	*wr = 0;									// NUL termination
+	return ((char_t)(wr - str));
+}
+
+#else	// __FAST_FNTOA
+
 char_t fntoa(char_t *str, float n, uint8_t precision)
 {
     // handle special cases
@@ -244,6 +379,62 @@ char_t fntoa(char_t *str, float n, uint8_t precision)
 	} else					    { return((char_t)sprintf((char *)str, "%f", (double) n)); }
 }
 
+#endif	// __FAST_FNTOA
+
+/*
+ * fatof() - specialized strtof() for gcode and JSON numeric literals
+ *
+ *	Handles the sign/digit/dot subset those streams actually contain by
+ *	accumulating the mantissa as an integer and applying the decimal scale
+ *	with a single divide - no exponent scan, locale or infinity handling.
+ *	Exponent forms, hex prefixes and literals longer than 8 significant
+ *	digits fall through to strtof() so nothing parses differently, just
+ *	slower. End pointer semantics match strtof(), including leaving *end
+ *	at the start of the string when no conversion was possible.
+ */
+#ifdef __FAST_ATOF
+
+float fatof(const char_t *str, char_t **end)
+{
+	const char_t *rd = str;
+	while ((*rd == ' ') || (*rd == '\t')) { rd++;}		// strtof() skips leading whitespace
+	uint8_t negative = false;
+	if (*rd == '-') { negative = true; rd++;}
+	else if (*rd == '+') { rd++;}
+
+	uint32_t mantissa = 0;
+	uint8_t digits = 0;
+	uint8_t places = 0;									// digits after the decimal point
+	uint8_t seen_point = false;
+	for (;; rd++) {
+		char_t c = *rd;
+		if ((c >= '0') && (c <= '9')) {
+			if (++digits > 8) { break;}					// too long for exact accumulation
+			mantissa = mantissa * 10 + (c - '0');
+			if (seen_point) { places++;}
+		} else if ((c == '.') && (!seen_point)) {
+			seen_point = true;
+		} else {
+			break;
+		}
+	}
+	if ((digits == 0) || (digits > 8) ||				// nan, inf, empty, or over-long literal
+		(*rd == 'e') || (*rd == 'E') ||					// exponent form
+		(*rd == 'x') || (*rd == 'X')) {					// hex prefix
+		return (strtof((char *)str, (char **)end));
+	}
+	if (end != NULL) { *end = (char_t *)rd;}
+	float value = (float)mantissa;
+	if (places > 0) {
+		static const float pow10[] = {					// places can reach 8 for a literal with no
+			1, 10, 100, 1000, 10000, 100000,			//  integer digits, e.g. X.00000001
+			1000000, 10000000, 100000000 };
+		value /= pow10[places];							// exact powers - one rounding in the divide
+	}
+	return (negative ? -value : value);
+}
+#endif	// __FAST_ATOF
+
 /*
  * compute_checksum() - calculate the checksum for a string
  *
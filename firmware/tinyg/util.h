@@ -67,6 +67,20 @@ float min3(float x1, float x2, float x3);
 float min4(float x1, float x2, float x3, float x4);
 float max3(float x1, float x2, float x3);
 float max4(float x1, float x2, float x3, float x4);
+
+#ifdef __FAST_MATH					// approximate math for planner hot paths - see util.c for error bounds
+float fast_rsqrt(float x);
+float fast_sqrt(float x);
+float fast_cbrt(float x);
+float fast_sin(float x);
+float fast_cos(float x);
+#else								// fall back to libm so call sites don't need conditionals
+#define fast_rsqrt(x) (1/sqrt(x))
+#define fast_sqrt(x) sqrt(x)
+#define fast_cbrt(x) cbrt(x)
+#define fast_sin(x) sin(x)
+#define fast_cos(x) cos(x)
+#endif
 //float std_dev(float a[], uint8_t n, float *mean);
 
 //*** string utilities ***
@@ -75,10 +89,10 @@ float max4(float x1, float x2, float x3, float x4);
 //char_t * strcpy_U( char_t * dst, const char_t * src );
 //#endif
 
-uint8_t isnumber(char_t c);
 char_t *escape_string(char_t *dst, char_t *src);
 char_t *pstr2str(const char *pgm_string);
 char_t fntoa(char_t *str, float n, uint8_t precision);
+float fatof(const char_t *str, char_t **end);
 uint16_t compute_checksum(char_t const *string, const uint16_t length);
 
 //*** other utilities ***
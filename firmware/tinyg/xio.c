@@ -76,6 +76,7 @@
 #include <string.h>					// for memset()
 #include <stdio.h>					// precursor for xio.h
 #include <avr/pgmspace.h>			// precursor for xio.h
+#include <util/crc16.h>				// for __LINE_CRC frame verification
 
 #include "xio.h"					// all device includes are nested here
 #include "tinyg.h"					// needed by init() for default source
@@ -110,6 +111,16 @@ void xio_init()
 	xio_open(XIO_DEV_SPI1, 0, SPI_FLAGS);
 	xio_open(XIO_DEV_SPI2, 0, SPI_FLAGS);
 
+#ifdef __USART_TX_DMA
+	xio_init_usb_tx_dma();			// DMA block transmit for reports
+#endif
+#ifdef __USART_RX_DMA
+	xio_init_usb_rx_dma();			// DMA-to-ring receive - replaces the RXC interrupt
+#endif
+#ifdef __SPI_SLAVE_DMA
+	xio_init_spi_slave_dma();		// SPI1 slave command channel for a Linux host
+#endif
+
 	xio_init_assertions();
 }
 
@@ -142,23 +153,23 @@ uint8_t xio_test_assertions()
 
 /*
  * xio_isbusy() - return TRUE if XIO sub-system is busy
- *
- *	This function is here so that the caller can detect that the serial system is active
- *	and therefore generating interrupts. This is a hack for the earlier AVRs that require
- *	interrupts to be disabled for EEPROM write so the caller can see if the XIO system is
- *	quiescent. This is used by the G10 deferred writeback persistence functions.
- *
- *	Idle conditions:
- *	- The serial RX buffer is empty, indicating with some probability that data is not being sent
- *	- The serial TX buffers are empty
- */
-
-uint8_t xio_isbusy()
-{
-	if (xio_get_rx_bufcount_usart(&USBu) != 0) return (false);
-	if (xio_get_tx_bufcount_usart(&USBu) != 0) return (false);
-	return (true);
-}
+ *
+ *	This function is here so that the caller can detect that the serial system is active
+ *	and therefore generating interrupts. This is a hack for the earlier AVRs that require
+ *	interrupts to be disabled for EEPROM write so the caller can see if the XIO system is
+ *	quiescent. This is used by the G10 deferred writeback persistence functions.
+ *
+ *	Idle conditions:
+ *	- The serial RX buffer is empty, indicating with some probability that data is not being sent
+ *	- The serial TX buffers are empty
+ */
+
+uint8_t xio_isbusy()
+{
+	if (xio_get_rx_bufcount_usart(&USBu) != 0) return (false);
+	if (xio_get_tx_bufcount_usart(&USBu) != 0) return (false);
+	return (true);
+}
 
 /*
  * xio_reset_working_flags()
@@ -223,10 +234,120 @@ FILE *xio_open(uint8_t dev, const char *addr, flags_t flags)
 	return (ds[dev].x_open(dev, addr, flags));
 }
 
+#ifdef __LINE_CRC
+/*
+ * _gets_crc_filter() - verify and strip CRC16 line frames (helper for gets functions)
+ *
+ *	Framed line protocol for noisy serial links. A framed line is an ordinary
+ *	text line with an 7 character trailer appended by the sender:
+ *
+ *		<payload>*SSCCCC<LF>
+ *
+ *	where SS is an 8 bit sequence number in hex and CCCC is the CRC-16 (the
+ *	avr-libc _crc16_update() polynomial, 0xA001, initial value 0x0000) of all
+ *	preceding characters - payload, '*' and sequence digits - in hex. The
+ *	sender streams framed lines without waiting for per-line responses and
+ *	relies on flow control for pacing; this device only speaks up when
+ *	something is wrong. A corrupted or missing line elicits a NAK naming the
+ *	next sequence number this device will accept:
+ *
+ *		*nakSS<LF>
+ *
+ *	and the sender retransmits from there. Duplicates arriving after a
+ *	retransmit (sequence earlier than expected) are dropped silently so a
+ *	single NAK doesn't echo back and forth. The first frame received after
+ *	framing is enabled (see set_fr / XIO_CRC) seeds the expected sequence.
+ *
+ *	Lines without a well-formed trailer pass through untouched, so a console
+ *	and a framing sender can share the port. Frames are verified and stripped
+ *	before the parsers ever see the line.
+ */
+static int32_t _frame_hex(const char *p, uint8_t digits)
+{
+	int32_t value = 0;
+	for (uint8_t i=0; i<digits; i++) {
+		char c = p[i];
+		if ((c >= '0') && (c <= '9')) { value = (value << 4) + (c - '0'); }
+		else if ((c >= 'A') && (c <= 'F')) { value = (value << 4) + (c - 'A' + 10); }
+		else if ((c >= 'a') && (c <= 'f')) { value = (value << 4) + (c - 'a' + 10); }
+		else { return (-1); }					// not a frame after all
+	}
+	return (value);
+}
+
+static int _gets_crc_filter(xioDev_t *d, char *buf)
+{
+	uint8_t len = strlen(buf);
+	if (len < 7) return (XIO_OK);				// too short to carry a trailer
+	char *p = buf + len - 7;
+	if (*p != '*') return (XIO_OK);				// unframed line - pass through
+	int32_t seq = _frame_hex(p+1, 2);
+	int32_t crc = _frame_hex(p+3, 4);
+	if ((seq < 0) || (crc < 0)) return (XIO_OK);	// unframed line - pass through
+
+	uint16_t computed = 0;
+	for (char *b = buf; b < (p+3); b++) { computed = _crc16_update(computed, *b); }
+	if (computed != (uint16_t)crc) {			// corrupted in transit
+		fprintf_P(&d->file, PSTR("*nak%02X\n"), d->crc_seq);
+		return (XIO_EAGAIN);
+	}
+	*p = NUL;									// strip the trailer before dispatch
+	if (d->flag_crc_sync) {						// adopt the stream's starting sequence
+		d->flag_crc_sync = false;
+		d->crc_seq = (uint8_t)seq;
+	}
+	int8_t delta = (int8_t)((uint8_t)seq - d->crc_seq);
+	if (delta < 0) return (XIO_EAGAIN);			// duplicate from a retransmit - drop silently
+	if (delta > 0) {							// gap - a line was lost whole
+		fprintf_P(&d->file, PSTR("*nak%02X\n"), d->crc_seq);
+		return (XIO_EAGAIN);
+	}
+	d->crc_seq++;
+	return (XIO_OK);
+}
+#endif // __LINE_CRC
+
 int xio_gets(const uint8_t dev, char *buf, const int size)
 {
+#ifdef __LINE_CRC
+	int status = ds[dev].x_gets(&ds[dev], buf, size);
+	if ((status == XIO_OK) && (ds[dev].flag_crc)) {
+		status = _gets_crc_filter(&ds[dev], buf);
+	}
+	return (status);
+#else
 	return (ds[dev].x_gets(&ds[dev], buf, size));
+#endif
+}
+
+#ifdef __XIO_ZERO_COPY
+/*
+ * xio_gets_zc() - zero-copy variant of xio_gets()
+ *
+ *	Accumulates the line in one of two xio-owned buffers instead of a caller
+ *	provided buffer. On XIO_OK (STAT_OK) *bufp is set to the completed line
+ *	and the buffers are swapped, so the returned line remains valid - and
+ *	writable, e.g. for in-place JSON wrapping - while the next line collects
+ *	in the other buffer. All other semantics are identical to xio_gets().
+ */
+static char xio_line_buf[2][XIO_LINE_BUFFER_LEN];
+static uint8_t xio_line_active = 0;
+
+int xio_gets_zc(const uint8_t dev, char **bufp)
+{
+	int status = ds[dev].x_gets(&ds[dev], xio_line_buf[xio_line_active], XIO_LINE_BUFFER_LEN);
+#ifdef __LINE_CRC
+	if ((status == XIO_OK) && (ds[dev].flag_crc)) {
+		status = _gets_crc_filter(&ds[dev], xio_line_buf[xio_line_active]);
+	}
+#endif
+	if (status == XIO_OK) {
+		*bufp = xio_line_buf[xio_line_active];
+		xio_line_active ^= 1;					// swap accumulators for the next line
+	}
+	return (status);
 }
+#endif // __XIO_ZERO_COPY
 
 int xio_getc(const uint8_t dev)
 {
@@ -266,6 +387,11 @@ int xio_ctrl_generic(xioDev_t *d, const flags_t flags)
 	CLRFLAG(XIO_NOIGNORELF,	flag_ignorelf);
 	SETFLAG(XIO_LINEMODE,	flag_linemode);
 	CLRFLAG(XIO_NOLINEMODE,	flag_linemode);
+#ifdef __LINE_CRC
+	SETFLAG(XIO_CRC,		flag_crc);
+	CLRFLAG(XIO_NOCRC,		flag_crc);
+	if ((flags & XIO_CRC) != 0) { d->flag_crc_sync = true; }	// adopt the next frame's sequence
+#endif
 	return (XIO_OK);
 }
 
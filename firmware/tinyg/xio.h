@@ -63,6 +63,8 @@
 #ifndef XIO_H_ONCE
 #define XIO_H_ONCE
 
+#include "tinyg.h"					// for compile-time flags used below (__JOB_STORE)
+
 /*************************************************************************
  *	Device configurations
  *************************************************************************/
@@ -77,7 +79,15 @@ enum xioDevNum_t {		// TYPE:	DEVICE:
 //	XIO_DEV_SPI3,		// SPI		SPI channel #3
 //	XIO_DEV_SPI4,		// SPI		SPI channel #4
 	XIO_DEV_PGM,		// FILE		Program memory file  (read only)
-//	XIO_DEV_SD,			// FILE		SD card (not implemented)
+#ifdef __JOB_STORE
+	XIO_DEV_FLASH,		// FILE		Job store in app flash (read only - see job_store.c)
+#endif
+#ifdef __SD_CARD
+	XIO_DEV_SD,			// FILE		SD card job image (read only - see xio_sd.c)
+#endif
+#ifdef __STARTUP_MACRO
+	XIO_DEV_MACRO,		// FILE		Startup macro in EEPROM (read only - see persistence.c)
+#endif
 	XIO_DEV_COUNT		// total device count (must be last entry)
 };
 // If your change these ^, check these v
@@ -88,7 +98,23 @@ enum xioDevNum_t {		// TYPE:	DEVICE:
 #define XIO_DEV_SPI_COUNT 		2 				// # of SPI devices
 #define XIO_DEV_SPI_OFFSET		XIO_DEV_USART_COUNT	// offset for computing indicies
 
-#define XIO_DEV_FILE_COUNT		1				// # of FILE devices
+// # of FILE devices: PGM, plus the optional job store, SD card and startup macro
+#ifdef __JOB_STORE
+#define XIO_DEV_FLASH_PRESENT	1
+#else
+#define XIO_DEV_FLASH_PRESENT	0
+#endif
+#ifdef __SD_CARD
+#define XIO_DEV_SD_PRESENT		1
+#else
+#define XIO_DEV_SD_PRESENT		0
+#endif
+#ifdef __STARTUP_MACRO
+#define XIO_DEV_MACRO_PRESENT	1
+#else
+#define XIO_DEV_MACRO_PRESENT	0
+#endif
+#define XIO_DEV_FILE_COUNT		(1 + XIO_DEV_FLASH_PRESENT + XIO_DEV_SD_PRESENT + XIO_DEV_MACRO_PRESENT)
 #define XIO_DEV_FILE_OFFSET		(XIO_DEV_USART_COUNT + XIO_DEV_SPI_COUNT) // index into FILES
 
 // Fast accessors
@@ -134,6 +160,9 @@ typedef struct xioDEVICE {						// common device struct (one per dev)
 	uint8_t flag_ignorelf;
 	uint8_t flag_linemode;
 	uint8_t flag_xoff;							// xon/xoff enabled
+#ifdef __LINE_CRC
+	uint8_t flag_crc;							// CRC16 line framing enabled
+#endif
 
 	// private working data and runtime flags
 	int size;									// text buffer length (dynamic)
@@ -142,6 +171,10 @@ typedef struct xioDEVICE {						// common device struct (one per dev)
 	uint8_t flag_in_line;						// used as a state variable for line reads
 	uint8_t flag_eol;							// end of line detected
 	uint8_t flag_eof;							// end of file detected
+#ifdef __LINE_CRC
+	uint8_t flag_crc_sync;						// adopt the next frame's sequence number
+	uint8_t crc_seq;							// next expected frame sequence number
+#endif
 	char *buf;									// text buffer binding (can be dynamic)
 	uint16_t magic_end;
 } xioDev_t;
@@ -166,6 +199,9 @@ xioDev_t 		ds[XIO_DEV_COUNT];			// allocate top-level dev structs
 xioUsart_t 		us[XIO_DEV_USART_COUNT];	// USART extended IO structs
 xioSpi_t 		spi[XIO_DEV_SPI_COUNT];		// SPI extended IO structs
 xioFile_t 		fs[XIO_DEV_FILE_COUNT];		// FILE extended IO structs
+#ifdef __SD_CARD
+xioSdCard_t		sdc;						// SD card state and read-ahead buffers
+#endif
 extern struct controllerSingleton tg;		// needed by init() for default source
 
 /*************************************************************************
@@ -180,12 +216,16 @@ extern struct controllerSingleton tg;		// needed by init() for default source
 void xio_init(void);
 void xio_init_assertions(void);
 uint8_t xio_test_assertions(void);
-uint8_t xio_isbusy(void);
+uint8_t xio_isbusy(void);
 
 void xio_reset_working_flags(xioDev_t *d);
 FILE *xio_open(const uint8_t dev, const char *addr, const flags_t flags);
 int xio_ctrl(const uint8_t dev, const flags_t flags);
 int xio_gets(const uint8_t dev, char *buf, const int size);
+#ifdef __XIO_ZERO_COPY
+#define XIO_LINE_BUFFER_LEN 255					// xio-owned line buffers (must match INPUT_BUFFER_LEN)
+int xio_gets_zc(const uint8_t dev, char **bufp);
+#endif
 int xio_getc(const uint8_t dev);
 int xio_putc(const uint8_t dev, const char c);
 int xio_set_baud(const uint8_t dev, const uint8_t baud_rate);
@@ -233,6 +273,10 @@ void xio_set_stderr(const uint8_t dev);
 #define XIO_NOIGNORELF	((uint16_t)1<<11)		// don't ignore <LF> on reads
 #define XIO_LINEMODE	((uint16_t)1<<12)		// special <CR><LF> read handling
 #define XIO_NOLINEMODE	((uint16_t)1<<13)		// no special <CR><LF> read handling
+#ifdef __LINE_CRC
+#define XIO_CRC			((uint16_t)1<<14)		// verify CRC16 line frames on reads
+#define XIO_NOCRC		((uint16_t)1<<15)		// do not verify CRC16 line frames
+#endif
 
 /*
  * Generic XIO signals and error conditions.
@@ -21,7 +21,7 @@
 
 #include <stdio.h>				// precursor for xio.h
 #include <stdbool.h>			// true and false
-#include <string.h>				// for memset
+#include <string.h>				// for memset
 #include <avr/pgmspace.h>		// precursor for xio.h
 #include "../xio.h"				// includes for all devices are in here
 
@@ -47,6 +47,36 @@ static struct cfgFILE const cfgFile[] PROGMEM = {
 	xio_putc_pgm,				// stdio putc function
 	xio_fc_null,				// flow control callback
 }
+#ifdef __JOB_STORE
+,{	// FLASH job store config
+	xio_open_flash,				// open function
+	xio_ctrl_generic, 			// ctrl function
+	xio_gets_flash,				// get string function
+	xio_getc_flash,				// stdio getc function
+	xio_putc_flash,				// stdio putc function
+	xio_fc_null,				// flow control callback
+}
+#endif
+#ifdef __SD_CARD
+,{	// SD card config
+	xio_open_sd,				// open function
+	xio_ctrl_generic, 			// ctrl function
+	xio_gets_sd,				// get string function
+	xio_getc_sd,				// stdio getc function
+	xio_putc_sd,				// stdio putc function
+	xio_fc_null,				// flow control callback
+}
+#endif
+#ifdef __STARTUP_MACRO
+,{	// startup macro config
+	xio_open_macro,				// open function
+	xio_ctrl_generic, 			// ctrl function
+	xio_gets_macro,				// get string function
+	xio_getc_macro,				// stdio getc function
+	xio_putc_macro,				// stdio putc function
+	xio_fc_null,				// flow control callback
+}
+#endif
 };
 /******************************************************************************
  * FUNCTIONS
@@ -88,5 +118,8 @@ FILE * xio_open_file(const uint8_t dev, const char *addr, const flags_t flags)
 	xio_ctrl_generic(d, flags);						// setup control flags
 	dx->filebase_P = (PROGMEM const char *)addr;	// might want to range check this
 	dx->max_offset = PGM_ADDR_MAX;
+#ifdef __PGM_BULK_READ
+	xio_pgm_reset_window();							// a reopened file may reuse the old base address
+#endif
 	return(&d->file);								// return pointer to the FILE stream
 }
@@ -1,11 +1,11 @@
-/*
+/*
  * xio_file.h	- device driver for file-type devices
  *   			- works with avr-gcc stdio library
  *
  * Part of TinyG project
  *
- * Copyright (c) 2011 - 2013 Alden S. Hart Jr.
- *
+ * Copyright (c) 2011 - 2013 Alden S. Hart Jr.
+ *
  * This file ("the software") is free software: you can redistribute it and/or modify
  * it under the terms of the GNU General Public License, version 2 as published by the
  * Free Software Foundation. You should have received a copy of the GNU General Public
@@ -52,9 +52,9 @@
 		return;
 	}
 */
-
-#ifndef xio_file_h
-#define xio_file_h
+
+#ifndef xio_file_h
+#define xio_file_h
 
 #define PGMFILE (const PROGMEM char *)		// extends pgmspace.h
 
@@ -79,15 +79,64 @@ typedef struct xioFILE {
 	const char * filebase_P;			// base location in program memory (PROGMEM)
 } xioFile_t;
 
+#ifdef __SD_CARD
+
+#define SD_BLOCK_SIZE 512				// SD protocol block length (fixed)
+
+// SD card state and read-ahead double buffer (see xio_sd.c)
+typedef struct xioSdCard {
+	uint8_t card_type;					// card variant from init - SD_CARD_NONE if no card
+	uint32_t next_lba;					// next card block to fetch
+	uint32_t bytes_left;				// unfetched bytes remaining in the job image
+	uint8_t active;						// buffer half currently being consumed (0 or 1)
+	uint8_t standby_full;				// standby half already holds the next block
+	uint16_t rd_offset;					// consumption offset into the active half
+	uint16_t count[2];					// valid bytes in each half
+	char buf[2][SD_BLOCK_SIZE];			// double buffer (~1Kb RAM)
+} xioSdCard_t;
+
+#endif // __SD_CARD
+
 /* 
  * FILE DEVICE FUNCTION PROTOTYPES
  */
 void xio_init_file(void);
 FILE *xio_open_file(const uint8_t dev, const char *addr, const flags_t flags);
 int xio_gets_pgm(xioDev_t *d, char *buf, const int size);		// read string from program memory
+#ifdef __PGM_BULK_READ
+void xio_pgm_reset_window(void);								// invalidate the bulk read window
+#endif
 int xio_getc_pgm(FILE *stream);									// get a character from PROGMEM
 int xio_putc_pgm(const char c, FILE *stream);					// always returns ERROR
 
+#ifdef __JOB_STORE
+FILE *xio_open_flash(const uint8_t dev, const char *addr, const flags_t flags);
+int xio_gets_flash(xioDev_t *d, char *buf, const int size);		// read string from the job store
+int xio_getc_flash(FILE *stream);								// get a character from the job store
+int xio_putc_flash(const char c, FILE *stream);					// always returns ERROR
+#endif
+
 // SD Card functions
 
-#endif
+#ifdef __SD_CARD
+FILE *xio_open_sd(const uint8_t dev, const char *addr, const flags_t flags);
+int xio_gets_sd(xioDev_t *d, char *buf, const int size);		// read string from the SD job image
+int xio_getc_sd(FILE *stream);									// get a character from the SD job image
+int xio_putc_sd(const char c, FILE *stream);					// always returns ERROR
+stat_t xio_sd_callback(void);									// read-ahead block fetch (main loop)
+#ifdef CONFIG_H_ONCE	// $sd handlers - only visible where config.h precedes xio.h
+stat_t sd_get_job(nvObj_t *nv);
+stat_t sd_run_job(nvObj_t *nv);
+#endif
+#endif // __SD_CARD
+
+// Startup macro functions
+
+#ifdef __STARTUP_MACRO
+FILE *xio_open_macro(const uint8_t dev, const char *addr, const flags_t flags);
+int xio_gets_macro(xioDev_t *d, char *buf, const int size);		// read string from the startup macro
+int xio_getc_macro(FILE *stream);								// get a character from the startup macro
+int xio_putc_macro(const char c, FILE *stream);					// always returns ERROR
+#endif // __STARTUP_MACRO
+
+#endif
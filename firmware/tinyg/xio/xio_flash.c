@@ -0,0 +1,131 @@
+/*
+ *  xio_flash.c	- device driver for the job store in application flash
+ * 				- works with avr-gcc stdio library
+ *
+ * Part of TinyG project
+ *
+ * Copyright (c) 2011 - 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	This driver reads back a job stored by job_store.c. It's the PGM device
+ *	(xio_pgm.c) with two differences: the file lives at a fixed flash region
+ *	above 64K so reads must use the far pgmspace accessors, and the open
+ *	address argument is ignored since there is only one stored job.
+ */
+
+#include <stdio.h>						// precursor for xio.h
+#include <stdbool.h>					// true and false
+#include <avr/pgmspace.h>				// precursor for xio.h
+#include "../xio.h"						// includes for all devices are in here
+#include "../tinyg.h"					// precursor for job_store.h (stat_t)
+#include "../config.h"					// precursor for job_store.h (nvObj_t)
+#include "../job_store.h"				// job store flash region and length
+
+#ifdef __JOB_STORE
+
+// Fast accessors (cheating)
+#define FLA ds[XIO_DEV_FLASH]			// device struct accessor
+#define FLAf fs[XIO_DEV_FLASH - XIO_DEV_FILE_OFFSET]	// file extended struct accessor
+
+/*
+ *	xio_open_flash() - open the job store for replay
+ *
+ *	The addr argument is unused - the job store is a fixed region. Opening
+ *	with no valid job stored yields a device that returns EOF immediately
+ *	(max_offset 0, which gets_flash treats as file-not-open).
+ */
+FILE * xio_open_flash(const uint8_t dev, const char *addr, const flags_t flags)
+{
+	xioDev_t *d = (xioDev_t *)&ds[dev];
+	d->x = &fs[dev - XIO_DEV_FILE_OFFSET];			// bind extended struct to device
+	xioFile_t *dx = (xioFile_t *)d->x;
+
+	memset (dx, 0, sizeof(xioFile_t));				// clear all values
+	xio_reset_working_flags(d);
+	xio_ctrl_generic(d, flags);						// setup control flags
+	dx->max_offset = job_store_length();			// 0 if no valid job is stored
+	return(&d->file);								// return pointer to the FILE stream
+}
+
+/*
+ *	xio_gets_flash() - main loop task for the job store device
+ *
+ *	Non-blocking, run-to-completion return a line from flash
+ *	Note: LINEMODE flag is ignored. It's ALWAYS LINEMODE here.
+ */
+int xio_gets_flash(xioDev_t *d, char *buf, const int size)
+{
+	if ((FLAf.max_offset) == 0) {		// return error if no job is open
+		return (XIO_FILE_NOT_OPEN);
+	}
+	FLA.signal = XIO_SIG_OK;			// initialize signal
+	if (fgets(buf, size, &FLA.file) == NULL) {
+		FLAf.max_offset = 0;
+		clearerr(&FLA.file);
+		return (XIO_EOF);
+	}
+	return (XIO_OK);
+}
+
+/*
+ *  xio_getc_flash() - read a character from the job store
+ *
+ *	EOF and LINEMODE behaviors are identical to xio_getc_pgm(). The length
+ *	bound backstops the NUL terminator in case the stored text got clipped.
+ */
+int xio_getc_flash(FILE *stream)
+{
+	char c;
+
+	if (FLA.flag_eof ) {
+		FLA.signal = XIO_SIG_EOF;
+		return (_FDEV_EOF);
+	}
+	if (FLAf.rd_offset >= FLAf.max_offset) {
+		c = NUL;
+	} else {
+		c = pgm_read_byte_far(JOB_STORE_DATA + FLAf.rd_offset);
+	}
+	if (c == NUL) {
+		FLA.flag_eof = true;
+	}
+	++FLAf.rd_offset;
+
+	// processing is simple if not in LINEMODE
+	if (FLA.flag_linemode == false) {
+		if (FLA.flag_echo) putchar(c);		// conditional echo
+		return (c);
+	}
+
+	// now do the LINEMODE stuff
+	if (c == NUL) {							// perform newline substitutions
+		c = '\n';
+	} else if (c == '\r') {
+		c = '\n';
+	}
+	if (FLA.flag_echo) putchar(c);			// conditional echo
+	return (c);
+}
+
+/*
+ *	xio_putc_flash() - write character to the job store device
+ *
+ *  Always returns error. Writes go through job_store.c, not the device.
+ */
+int xio_putc_flash(const char c, FILE *stream)
+{
+	return -1;
+}
+
+#endif // __JOB_STORE
@@ -0,0 +1,140 @@
+/*
+ *  xio_macro.c	- device driver for the startup macro in EEPROM
+ * 				- works with avr-gcc stdio library
+ *
+ * Part of TinyG project
+ *
+ * Copyright (c) 2011 - 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	This driver reads back the startup macro recorded by persistence.c. It's
+ *	the job store device (xio_flash.c) with the backing store swapped: the
+ *	text lives in a small EEPROM region instead of application flash, so
+ *	reads go through macro_store_read() rather than the far pgmspace
+ *	accessors. The open address argument is ignored - there is only one
+ *	stored macro.
+ */
+
+#include <stdio.h>						// precursor for xio.h
+#include <stdbool.h>					// true and false
+#include <avr/pgmspace.h>				// precursor for xio.h
+#include "../xio.h"						// includes for all devices are in here
+#include "../tinyg.h"					// precursor for persistence.h (stat_t)
+#include "../config.h"					// precursor for persistence.h (nvObj_t)
+#include "../persistence.h"				// macro store region and accessors
+
+#ifdef __STARTUP_MACRO
+
+// Fast accessors (cheating)
+#define MAC ds[XIO_DEV_MACRO]			// device struct accessor
+#define MACf fs[XIO_DEV_MACRO - XIO_DEV_FILE_OFFSET]	// file extended struct accessor
+
+/*
+ *	xio_open_macro() - open the startup macro for replay
+ *
+ *	The addr argument is unused - the macro is a fixed region. The replay
+ *	window (whole macro, startup section, or one event section) is selected
+ *	by persistence.c before the open. Opening with no valid macro stored
+ *	yields a device that returns EOF immediately (max_offset 0, which
+ *	gets_macro treats as file-not-open).
+ */
+FILE * xio_open_macro(const uint8_t dev, const char *addr, const flags_t flags)
+{
+	xioDev_t *d = (xioDev_t *)&ds[dev];
+	d->x = &fs[dev - XIO_DEV_FILE_OFFSET];			// bind extended struct to device
+	xioFile_t *dx = (xioFile_t *)d->x;
+
+	memset (dx, 0, sizeof(xioFile_t));				// clear all values
+	xio_reset_working_flags(d);
+	xio_ctrl_generic(d, flags);						// setup control flags
+#ifdef __EVENT_MACRO
+	dx->rd_offset = macro_window_start();			// replay window set by the trigger
+	dx->max_offset = macro_window_end();			// 0 if no valid macro is stored
+#else
+	dx->max_offset = macro_store_length();			// 0 if no valid macro is stored
+#endif
+	return(&d->file);								// return pointer to the FILE stream
+}
+
+/*
+ *	xio_gets_macro() - main loop task for the startup macro device
+ *
+ *	Non-blocking, run-to-completion return a line from EEPROM
+ *	Note: LINEMODE flag is ignored. It's ALWAYS LINEMODE here.
+ */
+int xio_gets_macro(xioDev_t *d, char *buf, const int size)
+{
+	if ((MACf.max_offset) == 0) {		// return error if no macro is open
+		return (XIO_FILE_NOT_OPEN);
+	}
+	MAC.signal = XIO_SIG_OK;			// initialize signal
+	if (fgets(buf, size, &MAC.file) == NULL) {
+		MACf.max_offset = 0;
+		clearerr(&MAC.file);
+		return (XIO_EOF);
+	}
+	return (XIO_OK);
+}
+
+/*
+ *  xio_getc_macro() - read a character from the startup macro
+ *
+ *	EOF and LINEMODE behaviors are identical to xio_getc_pgm(). The length
+ *	bound backstops the NUL terminator in case the stored text got clipped.
+ */
+int xio_getc_macro(FILE *stream)
+{
+	char c;
+
+	if (MAC.flag_eof ) {
+		MAC.signal = XIO_SIG_EOF;
+		return (_FDEV_EOF);
+	}
+	if (MACf.rd_offset >= MACf.max_offset) {
+		c = NUL;
+	} else {
+		macro_store_read((uint16_t)MACf.rd_offset, (int8_t *)&c, 1);
+	}
+	if (c == NUL) {
+		MAC.flag_eof = true;
+	}
+	++MACf.rd_offset;
+
+	// processing is simple if not in LINEMODE
+	if (MAC.flag_linemode == false) {
+		if (MAC.flag_echo) putchar(c);		// conditional echo
+		return (c);
+	}
+
+	// now do the LINEMODE stuff
+	if (c == NUL) {							// perform newline substitutions
+		c = '\n';
+	} else if (c == '\r') {
+		c = '\n';
+	}
+	if (MAC.flag_echo) putchar(c);			// conditional echo
+	return (c);
+}
+
+/*
+ *	xio_putc_macro() - write character to the startup macro device
+ *
+ *  Always returns error. Writes go through persistence.c, not the device.
+ */
+int xio_putc_macro(const char c, FILE *stream)
+{
+	return -1;
+}
+
+#endif // __STARTUP_MACRO
@@ -35,6 +35,63 @@
  *	Note: LINEMODE flag is ignored. It's ALWAYS LINEMODE here.
  */
 
+#ifdef __PGM_BULK_READ
+/*
+ *	The stdio path underneath fgets() costs a function call and a pgm_read_byte
+ *	per character, which throttles on-board file replay and distorts benchmark
+ *	runs. The bulk path below fetches the file through a small RAM window with
+ *	memcpy_P and scans for line ends in the window, preserving the EOL and EOF
+ *	semantics of the xio_getc_pgm() path (see its notes below).
+ */
+#define PGM_WINDOW_SIZE 32					// flash bytes fetched per memcpy_P refill
+
+static char pgm_window[PGM_WINDOW_SIZE];	// RAM window onto the PROGMEM file
+static const char *pgm_win_file_P = NULL;	// file the window was filled from
+static uint32_t pgm_win_base;				// file offset of pgm_window[0]
+
+void xio_pgm_reset_window()
+{
+	pgm_win_file_P = NULL;					// force a refill on the next read
+}
+
+int xio_gets_pgm(xioDev_t *d, char *buf, const int size)
+{
+	if ((PGMf.filebase_P) == 0) {		// return error if no file is open
+		return (XIO_FILE_NOT_OPEN);
+	}
+	PGM.signal = XIO_SIG_OK;			// initialize signal
+	if (PGM.flag_eof) {
+		PGMf.filebase_P = NULL;
+		return (XIO_EOF);
+	}
+	int i = 0;
+	while (i < (size-1)) {
+		if ((pgm_win_file_P != PGMf.filebase_P) ||				// window is stale or the
+			(PGMf.rd_offset < pgm_win_base) ||					// read point has left it
+			(PGMf.rd_offset >= (pgm_win_base + PGM_WINDOW_SIZE))) {
+			pgm_win_file_P = PGMf.filebase_P;
+			pgm_win_base = PGMf.rd_offset;
+			memcpy_P(pgm_window, &PGMf.filebase_P[pgm_win_base], PGM_WINDOW_SIZE);
+		}
+		char c = pgm_window[PGMf.rd_offset - pgm_win_base];
+		++PGMf.rd_offset;
+
+		if (c == NUL) {					// deliver the final line with a newline, as fgets() did,
+			PGM.flag_eof = true;		// and return EOF on the next call - see xio_getc_pgm()
+			c = '\n';
+		} else if (c == '\r') {
+			c = '\n';					// normalize EOL chars - same as xio_getc_pgm()
+		}
+		if (PGM.flag_echo) putchar(c);	// conditional echo
+		buf[i++] = c;
+		if (c == '\n') break;
+	}
+	buf[i] = NUL;
+	return (XIO_OK);
+}
+
+#else // __PGM_BULK_READ
+
 int xio_gets_pgm(xioDev_t *d, char *buf, const int size)
 {
 	if ((PGMf.filebase_P) == 0) {		// return error if no file is open
@@ -48,6 +105,7 @@ int xio_gets_pgm(xioDev_t *d, char *buf, const int size)
 	}
 	return (XIO_OK);
 }
+#endif // __PGM_BULK_READ
 
 /*
  *  xio_getc_pgm() - read a character from program memory device
@@ -0,0 +1,408 @@
+/*
+ *  xio_sd.c	- device driver for an SPI-attached SD card
+ * 				- works with avr-gcc stdio library
+ *
+ * Part of TinyG project
+ *
+ * Copyright (c) 2011 - 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	This driver streams a gcode job from a raw SD card image so jobs run from
+ *	local storage at full planner speed, immune to host OS scheduling hiccups.
+ *	It is the flash job store replay path (xio_flash.c) with the text coming
+ *	off the card instead of app flash.
+ *
+ *	There is no filesystem. The card carries a single job image in the job
+ *	store style: block 0 holds a header (magic word, then image length in
+ *	bytes), the gcode text starts at block 1 and is NUL terminated. A host
+ *	writes the image with dd or equivalent. This keeps the driver at one
+ *	block buffer pair instead of a FAT stack.
+ *
+ *	The card is driven in SPI mode over the shared bit-banged SPI port
+ *	(xio_spi.h pin map) using the SS2 select line, so XIO_DEV_SPI2 cannot
+ *	have a slave attached while a card is in use. Mode 3 (clock idles high)
+ *	is valid per the SD spec, so the bitbanger idiom is identical to
+ *	xio_spi.c - except select is held across a whole command sequence here,
+ *	which is why the transfer primitive is duplicated rather than shared.
+ *
+ *	Reads are double buffered: getc() consumes the active 512 byte half
+ *	while xio_sd_callback() (main loop) refills the standby half, so the
+ *	next block is already in RAM when the active half drains. A block holds
+ *	roughly 20 lines of gcode - far more motion time than one bit-banged
+ *	block read takes - so the planner never waits on the card.
+ */
+
+#include <stdio.h>						// precursor for xio.h
+#include <stdbool.h>					// true and false
+#include <string.h>						// for memset
+#include <avr/pgmspace.h>				// precursor for xio.h
+#include "../xio.h"						// includes for all devices are in here
+#include "../tinyg.h"					// precursor for config.h (stat_t)
+#include "../config.h"					// nvObj_t for the $sd handlers
+#include "../controller.h"				// primary source switching
+#include "../canonical_machine.h"		// runtime busy check
+#include "../util.h"					// fp_ZERO
+
+#ifdef __SD_CARD
+
+// Fast accessors (cheating)
+#define SDA ds[XIO_DEV_SD]				// device struct accessor
+#define SDAf fs[XIO_DEV_SD - XIO_DEV_FILE_OFFSET]	// file extended struct accessor
+
+#define SD_JOB_MAGIC	0x44534754UL	// "TGSD" - marks a valid job image header
+#define SD_PORT			SPI_DATA_PORT	// data lines shared with the SPI devices
+
+#define SD_CARD_NONE	0				// no card or card init failed
+#define SD_CARD_V1		1				// SD v1 - byte addressed
+#define SD_CARD_V2		2				// SD v2 standard capacity - byte addressed
+#define SD_CARD_SDHC	3				// SD v2 high capacity - block addressed
+
+#define SD_RESPONSE_TRIES 8				// R1 arrives within 8 bytes of a command
+#define SD_INIT_TRIES	2000			// ACMD41 polls before giving up on a card
+#define SD_READ_TRIES	5000			// polls for the data start token
+
+static uint8_t _sd_init_card(void);
+static uint8_t _sd_read_block(uint32_t lba, char *buf);
+static uint8_t _sd_fill(uint8_t half);
+
+/*
+ * Bitbanger - same idiom as xio_spi.c but with caller-managed select,
+ * since SD command/response/data sequences need select held throughout.
+ */
+#define sd_xfer_bit(mask, b_out, b_in) \
+	SD_PORT.OUTCLR = SPI_SCK_bm; \
+	if ((b_out & mask) == 0) { SD_PORT.OUTCLR = SPI_MOSI_bm; } \
+	else { SD_PORT.OUTSET = SPI_MOSI_bm; } \
+	if (SD_PORT.IN & SPI_MISO_bm) b_in |= (mask); \
+	SD_PORT.OUTSET = SPI_SCK_bm;
+
+static uint8_t _sd_xfer_byte(uint8_t b_out)
+{
+	uint8_t b_in = 0;
+	sd_xfer_bit(0x80, b_out, b_in);
+	sd_xfer_bit(0x40, b_out, b_in);
+	sd_xfer_bit(0x20, b_out, b_in);
+	sd_xfer_bit(0x10, b_out, b_in);
+	sd_xfer_bit(0x08, b_out, b_in);
+	sd_xfer_bit(0x04, b_out, b_in);
+	sd_xfer_bit(0x02, b_out, b_in);
+	sd_xfer_bit(0x01, b_out, b_in);
+	return (b_in);
+}
+
+static void _sd_select(void) { SPI_SS2_PORT.OUTCLR = SPI_SS2_bm;}
+
+static void _sd_deselect(void)
+{
+	SPI_SS2_PORT.OUTSET = SPI_SS2_bm;
+	_sd_xfer_byte(0xFF);				// 8 clocks with select high so the card releases DO
+}
+
+/*
+ * _sd_command() - send one SPI-mode command and return its R1 response
+ *
+ *	The CRC byte only matters for CMD0 and CMD8 (the card checks CRCs until
+ *	SPI mode is entered); 0xFF is fine everywhere else.
+ */
+static uint8_t _sd_command(uint8_t cmd, uint32_t arg, uint8_t crc)
+{
+	uint8_t r1;
+
+	_sd_xfer_byte(0xFF);				// sync byte before the command
+	_sd_xfer_byte(0x40 | cmd);
+	_sd_xfer_byte((uint8_t)(arg >> 24));
+	_sd_xfer_byte((uint8_t)(arg >> 16));
+	_sd_xfer_byte((uint8_t)(arg >> 8));
+	_sd_xfer_byte((uint8_t)arg);
+	_sd_xfer_byte(crc);
+
+	for (uint8_t i=0; i<SD_RESPONSE_TRIES; i++) {
+		if (((r1 = _sd_xfer_byte(0xFF)) & 0x80) == 0) { return (r1);}
+	}
+	return (0xFF);						// card never responded
+}
+
+/*
+ * _sd_init_card() - bring a card to SPI mode and ready state
+ *
+ *	Standard SPI-mode bringup: CMD0 to enter SPI mode, CMD8 to sort v1 from
+ *	v2 cards, ACMD41 until the card leaves idle, CMD58 to detect block
+ *	addressing (SDHC), CMD16 to force 512 byte blocks on byte-addressed
+ *	cards. The bitbanger is well under the 400 KHz init ceiling by nature.
+ */
+static uint8_t _sd_init_card()
+{
+	uint8_t r1 = 0xFF;
+	uint8_t type;
+	uint16_t tries = SD_INIT_TRIES;
+
+	_sd_deselect();
+	for (uint8_t i=0; i<10; i++) { _sd_xfer_byte(0xFF);}	// 80 clocks, select high - card enters native mode
+
+	_sd_select();
+	if (_sd_command(0, 0, 0x95) != 0x01) {					// GO_IDLE_STATE
+		_sd_deselect();
+		return (SD_CARD_NONE);
+	}
+	if ((_sd_command(8, 0x000001AA, 0x87) & 0x04) == 0) {	// SEND_IF_COND - v2 cards answer it
+		for (uint8_t i=0; i<4; i++) { r1 = _sd_xfer_byte(0xFF);}	// last R7 byte echoes the check pattern
+		if (r1 != 0xAA) {
+			_sd_deselect();
+			return (SD_CARD_NONE);
+		}
+		type = SD_CARD_V2;
+	} else {
+		type = SD_CARD_V1;									// v1 cards reject CMD8 as illegal
+	}
+	do {													// ACMD41 until the card leaves idle state
+		_sd_command(55, 0, 0xFF);							// APP_CMD prefix
+		r1 = _sd_command(41, (type == SD_CARD_V1) ? 0 : 0x40000000UL, 0xFF);
+	} while ((r1 != 0x00) && (--tries != 0));
+	if (r1 != 0x00) {
+		_sd_deselect();
+		return (SD_CARD_NONE);
+	}
+	if (type == SD_CARD_V2) {								// READ_OCR - check for block addressing
+		if (_sd_command(58, 0, 0xFF) == 0x00) {
+			if (_sd_xfer_byte(0xFF) & 0x40) { type = SD_CARD_SDHC;}
+			for (uint8_t i=0; i<3; i++) { _sd_xfer_byte(0xFF);}	// drain the rest of the OCR
+		}
+	}
+	if (type != SD_CARD_SDHC) {								// byte-addressed cards need the block length set
+		if (_sd_command(16, SD_BLOCK_SIZE, 0xFF) != 0x00) {
+			_sd_deselect();
+			return (SD_CARD_NONE);
+		}
+	}
+	_sd_deselect();
+	return (type);
+}
+
+/*
+ * _sd_read_block() - read one 512 byte block into buf
+ */
+static uint8_t _sd_read_block(uint32_t lba, char *buf)
+{
+	uint16_t tries = SD_READ_TRIES;
+	uint32_t addr = (sdc.card_type == SD_CARD_SDHC) ? lba : (lba * SD_BLOCK_SIZE);
+
+	_sd_select();
+	if (_sd_command(17, addr, 0xFF) != 0x00) {				// READ_SINGLE_BLOCK
+		_sd_deselect();
+		return (false);
+	}
+	while (_sd_xfer_byte(0xFF) != 0xFE) {					// wait for the data start token
+		if (--tries == 0) {
+			_sd_deselect();
+			return (false);
+		}
+	}
+	for (uint16_t i=0; i<SD_BLOCK_SIZE; i++) { buf[i] = _sd_xfer_byte(0xFF);}
+	_sd_xfer_byte(0xFF);									// discard the 16 bit data CRC
+	_sd_xfer_byte(0xFF);
+	_sd_deselect();
+	return (true);
+}
+
+/*
+ * _sd_fill() - fetch the next image block into the given buffer half
+ *
+ *	A read fault truncates the job (bytes_left = 0) so the reader sees a
+ *	clean EOF instead of repeating a line or spinning on a dead card.
+ */
+static uint8_t _sd_fill(uint8_t half)
+{
+	if (sdc.bytes_left == 0) {
+		sdc.count[half] = 0;
+		return (false);
+	}
+	if (_sd_read_block(sdc.next_lba, sdc.buf[half]) == false) {
+		sdc.bytes_left = 0;
+		sdc.count[half] = 0;
+		return (false);
+	}
+	sdc.next_lba++;
+	sdc.count[half] = (sdc.bytes_left > SD_BLOCK_SIZE) ? SD_BLOCK_SIZE : (uint16_t)sdc.bytes_left;
+	sdc.bytes_left -= sdc.count[half];
+	return (true);
+}
+
+/*
+ *	xio_open_sd() - init the card, validate the job header, prime the buffers
+ *
+ *	The addr argument is unused - the job image location is fixed. With no
+ *	card or no valid image the device opens with max_offset 0, which
+ *	gets_sd treats as file-not-open (same convention as the flash device).
+ */
+FILE * xio_open_sd(const uint8_t dev, const char *addr, const flags_t flags)
+{
+	xioDev_t *d = (xioDev_t *)&ds[dev];
+	d->x = &fs[dev - XIO_DEV_FILE_OFFSET];			// bind extended struct to device
+	xioFile_t *dx = (xioFile_t *)d->x;
+
+	memset (dx, 0, sizeof(xioFile_t));				// clear all values
+	memset (&sdc, 0, sizeof(sdc));
+	xio_reset_working_flags(d);
+	xio_ctrl_generic(d, flags);						// setup control flags
+
+	if ((sdc.card_type = _sd_init_card()) == SD_CARD_NONE) { return (&d->file);}
+	if (_sd_read_block(0, sdc.buf[0]) == false) { return (&d->file);}
+
+	uint32_t magic, length;							// header: magic word, then image length
+	memcpy(&magic,  &sdc.buf[0][0], sizeof(magic));
+	memcpy(&length, &sdc.buf[0][4], sizeof(length));
+	if ((magic != SD_JOB_MAGIC) || (length == 0)) { return (&d->file);}
+
+	dx->max_offset = length;
+	sdc.bytes_left = length;
+	sdc.next_lba = 1;								// job text starts at the second block
+	_sd_fill(0);									// prime the active half...
+	sdc.standby_full = _sd_fill(1);					// ...and the read-ahead half
+	return(&d->file);								// return pointer to the FILE stream
+}
+
+/*
+ *	xio_gets_sd() - main loop task for the SD card device
+ *
+ *	Non-blocking, run-to-completion return a line from the card
+ *	Note: LINEMODE flag is ignored. It's ALWAYS LINEMODE here.
+ */
+int xio_gets_sd(xioDev_t *d, char *buf, const int size)
+{
+	if ((SDAf.max_offset) == 0) {		// return error if no job is open
+		return (XIO_FILE_NOT_OPEN);
+	}
+	SDA.signal = XIO_SIG_OK;			// initialize signal
+	if (fgets(buf, size, &SDA.file) == NULL) {
+		SDAf.max_offset = 0;
+		clearerr(&SDA.file);
+		return (XIO_EOF);
+	}
+	return (XIO_OK);
+}
+
+/*
+ *  xio_getc_sd() - read a character from the SD card job image
+ *
+ *	Serves characters from the active buffer half, swapping to the standby
+ *	half when it drains. The swap is free if the read-ahead callback has
+ *	already filled the standby half; if not (e.g. dense short lines consumed
+ *	a block before the main loop came around) the block is fetched inline.
+ *	EOF and LINEMODE behaviors are identical to xio_getc_pgm().
+ */
+int xio_getc_sd(FILE *stream)
+{
+	char c;
+
+	if (SDA.flag_eof ) {
+		SDA.signal = XIO_SIG_EOF;
+		return (_FDEV_EOF);
+	}
+	if (SDAf.rd_offset >= SDAf.max_offset) {
+		c = NUL;
+	} else {
+		if (sdc.rd_offset >= sdc.count[sdc.active]) {	// active half is drained
+			if (sdc.standby_full == false) { _sd_fill(sdc.active ^ 1);}
+			sdc.active ^= 1;
+			sdc.rd_offset = 0;
+			sdc.standby_full = false;
+		}
+		if (sdc.count[sdc.active] == 0) {				// card fault truncated the job
+			c = NUL;
+		} else {
+			c = sdc.buf[sdc.active][sdc.rd_offset++];
+		}
+	}
+	if (c == NUL) {
+		SDA.flag_eof = true;
+	}
+	++SDAf.rd_offset;
+
+	// processing is simple if not in LINEMODE
+	if (SDA.flag_linemode == false) {
+		if (SDA.flag_echo) putchar(c);		// conditional echo
+		return (c);
+	}
+
+	// now do the LINEMODE stuff
+	if (c == NUL) {							// perform newline substitutions
+		c = '\n';
+	} else if (c == '\r') {
+		c = '\n';
+	}
+	if (SDA.flag_echo) putchar(c);			// conditional echo
+	return (c);
+}
+
+/*
+ *	xio_putc_sd() - write character to the SD card device
+ *
+ *  Always returns error. The card is read-only to the firmware.
+ */
+int xio_putc_sd(const char c, FILE *stream)
+{
+	return -1;
+}
+
+/*
+ *	xio_sd_callback() - refill the standby buffer half from the main loop
+ *
+ *	This is the read-ahead: it runs whenever the controller has nothing
+ *	more urgent to do, so the block fetch overlaps motion instead of
+ *	delaying the next line. Costs nothing when no job is streaming.
+ */
+stat_t xio_sd_callback()
+{
+	if ((sdc.standby_full == true) || (sdc.bytes_left == 0)) { return (STAT_NOOP);}
+	sdc.standby_full = _sd_fill(sdc.active ^ 1);
+	return (STAT_OK);
+}
+
+/*
+ * sd_get_job() - get SD job image size for $sd / {"sd":n}
+ * sd_run_job() - run the job from the card ($sd=1)
+ *
+ *	The get probes the card (init + header read) unless a replay is in
+ *	progress, in which case it reports the bytes left to run instead of
+ *	resetting the card out from under the reader.
+ */
+stat_t sd_get_job(nvObj_t *nv)
+{
+	if (cs.primary_src == XIO_DEV_SD) {
+		nv->value = (float)(SDAf.max_offset - SDAf.rd_offset);
+	} else {
+		xio_open(XIO_DEV_SD, NULL, PGM_FLAGS);
+		nv->value = (float)SDAf.max_offset;
+	}
+	nv->valuetype = TYPE_FLOAT;
+	nv->precision = 0;
+	return (STAT_OK);
+}
+
+stat_t sd_run_job(nvObj_t *nv)
+{
+#ifdef __JOB_CHAIN
+	if (fp_ZERO(nv->value)) { return (STAT_OK);}	// $sd=0 is a no-op
+	return (tg_run_source(XIO_DEV_SD, NULL));		// the card probe happens at open time
+#else
+	if (cm_get_runtime_busy() == true) { return (STAT_COMMAND_NOT_ACCEPTED);}
+	if (fp_ZERO(nv->value)) { return (STAT_OK);}	// $sd=0 is a no-op
+	xio_open(XIO_DEV_SD, NULL, PGM_FLAGS);
+	if (SDAf.max_offset == 0) { return (STAT_FILE_NOT_OPEN);}	// no card or no valid job image
+	tg_set_primary_source(XIO_DEV_SD);
+	return (STAT_OK);
+#endif
+}
+
+#endif // __SD_CARD
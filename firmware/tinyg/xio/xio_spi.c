@@ -74,12 +74,24 @@
 #include "../xio.h"						// includes for all devices are in here
 #include "../xmega/xmega_interrupts.h"
 #include "../tinyg.h"					// needed for AXES definition
+#ifdef __SPI_SLAVE_DMA
+#include "../config.h"					// precursor for canonical_machine.h
+#include "../hardware.h"					// needed for hard reset requests
+#include "../canonical_machine.h"		// trapped characters communicate directly with the canonical machine
+#endif
 
 // statics
 static char _read_rx_buffer(xioSpi_t *dx);
 static char _write_rx_buffer(xioSpi_t *dx, char c);
 static char _read_tx_buffer(xioSpi_t *dx);
 //static char _write_tx_buffer(xioSpi_t *dx, char c);
+#ifdef __SPI_SLAVE_DMA
+static char _write_tx_buffer(xioSpi_t *dx, char c);
+static void _open_spi_slave(xioSpi_t *dx);
+static void _slave_rx_dma_arm(void);
+static void _slave_rx_drain(xioSpi_t *dx);
+static void _slave_accept(xioSpi_t *dx, const char c);
+#endif
 static char _xfer_spi_char(xioSpi_t *dx, char c_out);
 static char _read_spi_char(xioSpi_t *dx);
 
@@ -189,6 +201,9 @@ FILE *xio_open_spi(const uint8_t dev, const char *addr, const flags_t flags)
 	dx->data_port->DIRSET = (uint8_t)pgm_read_byte(&cfgSpi[idx].outbits);
 	dx->data_port->OUTCLR = (uint8_t)pgm_read_byte(&cfgSpi[idx].outclr);
 	dx->data_port->OUTSET = (uint8_t)pgm_read_byte(&cfgSpi[idx].outset);
+#ifdef __SPI_SLAVE_DMA
+	if (idx == 0) { _open_spi_slave(dx);}		// SPI1 is the slave command channel
+#endif
 	return (&d->file);							// return FILE reference
 }
 
@@ -230,9 +245,18 @@ int xio_gets_spi(xioDev_t *d, char *buf, const int size)
 			return (XIO_BUFFER_FULL);
 		}
 		if ((c_out = _read_rx_buffer(dx)) == Q_EMPTY) {
+#ifdef __SPI_SLAVE_DMA
+			if (dx == (xioSpi_t *)SPI1.x) {		// slave channel - data arrives by DMA
+				_slave_rx_drain(dx);
+				if ((c_out = _read_rx_buffer(dx)) == Q_EMPTY) { return (XIO_EAGAIN);}
+			} else if ((c_out = _read_spi_char(dx)) == ETX) { // get a char from slave
+				return (XIO_EAGAIN);
+			}
+#else
 			if ((c_out = _read_spi_char(dx)) == ETX) { // get a char from slave
 				return (XIO_EAGAIN);
 			}
+#endif
 		}
 		if (c_out == LF) {
 			d->buf[(d->len)++] = NUL;
@@ -263,10 +287,23 @@ int xio_getc_spi(FILE *stream)
 	char c;
 
 	if ((c = _read_rx_buffer(dx)) == Q_EMPTY) {
+#ifdef __SPI_SLAVE_DMA
+		if (dx == (xioSpi_t *)SPI1.x) {			// slave channel - data arrives by DMA
+			_slave_rx_drain(dx);
+			c = _read_rx_buffer(dx);
+		} else {
+			c = _read_spi_char(dx);
+		}
+		if ((c == Q_EMPTY) || (c == ETX)) {
+			d->signal = XIO_SIG_EOL;
+			return(_FDEV_ERR);
+		}
+#else
 		if ((c = _read_spi_char(dx)) == ETX) {
 			d->signal = XIO_SIG_EOL;
 			return(_FDEV_ERR);
 		}
+#endif
 	}
 	return (c);
 }
@@ -291,6 +328,17 @@ int xio_putc_spi(const char c, FILE *stream)
 	xioSpi_t *dx = ((xioDev_t *)stream->udata)->x;
 	char c_in;
 
+#ifdef __SPI_SLAVE_DMA
+	if (dx == (xioSpi_t *)SPI1.x) {				// slave channel - the master clocks responses out
+		if (SPI_SLAVE_SPI.INTCTRL == 0) {		// first char of a response - take over from DMA
+			DMA.CH2.CTRLA &= ~DMA_CH_ENABLE_bm;
+			_slave_rx_drain(dx);				// catch anything received before the handoff
+			SPI_SLAVE_SPI.INTCTRL = SPI_INTLVL_LO_gc;
+		}
+		while (_write_tx_buffer(dx, c) == Q_EMPTY) { sleep_mode();}	// ISR drains as the master polls
+		return (XIO_OK);
+	}
+#endif
 	if ((c_in = _xfer_spi_char(dx,c)) != ETX) {
 		if ((c_in == 0x00) || (c_in == 0xFF)) {
 			return (XIO_NO_SUCH_DEVICE);
@@ -338,6 +386,114 @@ void _xio_tx_spi_dx(xioSpi_t *dx)
 	}
 }
 */
+#ifdef __SPI_SLAVE_DMA
+/*
+ * SPI slave command channel (SPI1)
+ *
+ *	_open_spi_slave()        - put the SPI port in hardware slave mode
+ *	xio_init_spi_slave_dma() - one-time setup of DMA channel 2 for slave receive
+ *	_slave_rx_dma_arm()      - (re)start the receive DMA ring
+ *	_slave_rx_drain()        - bulk-move received chars from the DMA ring to the RX buffer
+ *	_slave_accept()          - per-character triage (padding, signals) and ring insert
+ *	SPI_SLAVE_ISR            - MISO refill while a response is draining
+ *
+ *	The bit-banged master code above drives downstream slave boards. When an
+ *	embedded Linux host fronts the machine the roles reverse: the host is the SPI
+ *	master and this board is the slave. SPI1 is rebound to the port's hardware
+ *	SPI module (SPIC - same pins, slave select on what is SS1 in master mode) and
+ *	becomes a line-oriented command channel that plugs into the existing xio
+ *	device dispatch unchanged - select it with tg_set_primary_source(XIO_DEV_SPI1).
+ *
+ *	Receive - the direction that carries the rate win - is a hardware ring: DMA
+ *	channel 2 copies each received byte out of SPIC.DATA into a 256 byte buffer
+ *	that REPEAT mode wraps forever (same technique as the USB receive, see
+ *	xio_usb.c). At multi-MHz SPI clocks whole lines land in the ring with no
+ *	per-byte work at all; xio_gets_spi() drains and line-assembles them once per
+ *	controller pass. The message protocol at the top of this file still applies:
+ *	NUL, STX and ETX are padding and polling bytes and are discarded in the
+ *	drain; signal characters are trapped exactly as the USB receive does.
+ *
+ *	Transmit shares SPIC.DATA with the receive DMA and both are driven by the
+ *	same interrupt flag, so while a response is draining the channel drops back
+ *	to the transfer-complete interrupt: the DMA is parked, the ISR captures each
+ *	MOSI byte and refills MISO with the next response char, and when the TX
+ *	buffer runs dry it re-arms the DMA ring and goes quiet. Ingest runs
+ *	interrupt-free; responses cost a per-byte interrupt only while they drain.
+ */
+
+static char spi_rx_dma_buf[SPI_RX_DMA_BUFFER_SIZE];
+static uint8_t spi_rx_dma_tail;
+
+static void _open_spi_slave(xioSpi_t *dx)
+{
+	dx->data_port->DIRCLR = SPI_SCK_bm | SPI_MOSI_bm | SPI_SS1_bm;	// the master drives these
+	dx->data_port->DIRSET = SPI_MISO_bm;
+	SPI_SLAVE_SPI.CTRL = SPI_ENABLE_bm | SPI_MODE_3_gc;				// slave, mode 3, MSB first
+	SPI_SLAVE_SPI.INTCTRL = 0;										// quiet until a response queues
+	SPI_SLAVE_SPI.DATA = ETX;										// nothing to send yet
+}
+
+static void _slave_rx_dma_arm(void)
+{
+	DMA.CH2.CTRLA = 0;									// reset the channel
+	DMA.CH2.CTRLB = 0;									// no interrupts - the drain polls TRFCNT
+	DMA.CH2.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+					   DMA_CH_DESTRELOAD_BLOCK_gc | DMA_CH_DESTDIR_INC_gc;
+	DMA.CH2.TRIGSRC = DMA_CH_TRIGSRC_SPIC_gc;			// one byte per completed transfer
+	DMA.CH2.SRCADDR0 = (uint8_t)((uint16_t)&SPI_SLAVE_SPI.DATA);
+	DMA.CH2.SRCADDR1 = (uint8_t)((uint16_t)&SPI_SLAVE_SPI.DATA >> 8);
+	DMA.CH2.SRCADDR2 = 0;
+	DMA.CH2.DESTADDR0 = (uint8_t)((uint16_t)spi_rx_dma_buf);
+	DMA.CH2.DESTADDR1 = (uint8_t)((uint16_t)spi_rx_dma_buf >> 8);
+	DMA.CH2.DESTADDR2 = 0;
+	DMA.CH2.TRFCNT = SPI_RX_DMA_BUFFER_SIZE;
+	DMA.CH2.REPCNT = 0;									// repeat forever - the buffer is a hardware ring
+	DMA.CH2.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_REPEAT_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+	spi_rx_dma_tail = 0;
+}
+
+void xio_init_spi_slave_dma(void)
+{
+	DMA.CTRL |= DMA_ENABLE_bm;							// enable the DMA controller
+	_slave_rx_dma_arm();
+}
+
+static void _slave_accept(xioSpi_t *dx, const char c)
+{
+	if ((c == NUL) || (c == STX) || (c == ETX)) { return;}	// padding and polling bytes
+	if (c == CHAR_RESET) 		{ hw_request_hard_reset(); return;}
+	if (c == CHAR_FEEDHOLD) 	{ cm_request_feedhold(); return;}
+	if (c == CHAR_QUEUE_FLUSH) 	{ cm_request_queue_flush(); return;}
+	if (c == CHAR_CYCLE_START) 	{ cm_request_cycle_start(); return;}
+	_write_rx_buffer(dx, c);							// drops the char if the RX buffer is full
+}
+
+static void _slave_rx_drain(xioSpi_t *dx)
+{
+	uint16_t t;
+	do { t = DMA.CH2.TRFCNT; } while (t != DMA.CH2.TRFCNT);	// re-read until stable (see xio_usb.c)
+	uint8_t head = (uint8_t)(SPI_RX_DMA_BUFFER_SIZE - t);
+	while (spi_rx_dma_tail != head) {
+		_slave_accept(dx, spi_rx_dma_buf[spi_rx_dma_tail++]);
+	}
+}
+
+ISR(SPI_SLAVE_ISR_vect)
+{
+	xioSpi_t *dx = (xioSpi_t *)SPI1.x;
+	char c;
+
+	_slave_accept(dx, SPI_SLAVE_SPI.DATA);				// capture the MOSI byte of the completed transfer
+	if ((c = _read_tx_buffer(dx)) == Q_EMPTY) {
+		SPI_SLAVE_SPI.DATA = ETX;						// tell the master to stop polling
+		SPI_SLAVE_SPI.INTCTRL = 0;						// response is drained -
+		_slave_rx_dma_arm();							//  hand receive back to the DMA ring
+	} else {
+		SPI_SLAVE_SPI.DATA = c;
+	}
+}
+#endif // __SPI_SLAVE_DMA
+
 /*
  * Buffer read and write helpers
  *
@@ -382,7 +538,7 @@ static char _read_tx_buffer(xioSpi_t *dx)
 	if ((--(dx->tx_buf_tail)) == 0) { dx->tx_buf_tail = SPI_TX_BUFFER_SIZE-1;}
 	return (c);
 }
-/*
+#ifdef __SPI_SLAVE_DMA
 static char _write_tx_buffer(xioSpi_t *dx, char c)
 {
 	spibuf_t next_buf_head = dx->tx_buf_head-1;
@@ -392,7 +548,7 @@ static char _write_tx_buffer(xioSpi_t *dx, char c)
 	dx->tx_buf_head = next_buf_head;
 	return (XIO_OK);
 }
-*/
+#endif
 /*
  * Bitbangers used by the SPI routines
  * _xfer_spi_char() - send a character on MOSI and receive incoming char on MISO
@@ -45,6 +45,13 @@
 //#define SPI_RX_BUFFER_SIZE (spibuf_t)1024
 //#define SPI_TX_BUFFER_SIZE (spibuf_t)1024
 
+#ifdef __SPI_SLAVE_DMA
+// Slave command channel (SPI1) - see the slave mode section in xio_spi.c
+#define SPI_SLAVE_SPI SPIC					// hardware SPI module on the SPI port pins
+#define SPI_SLAVE_ISR_vect SPIC_INT_vect
+#define SPI_RX_DMA_BUFFER_SIZE 256			// must be exactly 256 so the uint8_t ring index wraps for free
+#endif
+
 
 //**** SPI device configuration ****
 //NOTE: XIO_BLOCK / XIO_NOBLOCK affects reads only. Writes always block. (see xio.h)
@@ -112,6 +119,9 @@ typedef struct xioSPI {
  ******************************************************************************/
 
 void xio_init_spi(void);
+#ifdef __SPI_SLAVE_DMA
+void xio_init_spi_slave_dma(void);			// setup DMA CH2 for slave receive
+#endif
 FILE *xio_open_spi(const uint8_t dev, const char *addr, const flags_t flags);
 int xio_gets_spi(xioDev_t *d, char *buf, const int size);
 int xio_putc_spi(const char c, FILE *stream);
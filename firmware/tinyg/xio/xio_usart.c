@@ -37,8 +37,15 @@
  * USART CONFIGURATION RECORDS
  ******************************************************************************/
 // See xio_usart.h for baud rate configuration settings
+#ifdef __HIGH_BAUD
+// 230400/460800 use the deepest fractional BSCALE that keeps BSEL in 8 bits,
+// cutting baud error from -0.79% to -0.08% at 32 MHz - see xio_usart.h
+static const uint8_t bsel[] PROGMEM = { 0, 207, 103, 51, 34, 33, 246, 214, 19, 1, 1 };
+static const uint8_t bscale[] PROGMEM = { 0, 0, 0, 0, 0, (-1<<4), (-5<<4), (-6<<4), (-4<<4), (1<<4), 1 };
+#else
 static const uint8_t bsel[] PROGMEM = { 0, 207, 103, 51, 34, 33, 31, 27, 19, 1, 1 };
 static const uint8_t bscale[] PROGMEM = { 0, 0, 0, 0, 0, (-1<<4), (-2<<4), (-3<<4), (-4<<4), (1<<4), 1 };
+#endif
 
 struct cfgUSART {
 		x_open_t x_open;
@@ -94,6 +101,9 @@ static struct cfgUSART const cfgUsart[] PROGMEM = {
  ******************************************************************************/
 
 static int _gets_helper(xioDev_t *d, xioUsart_t *dx);
+#ifdef __XIO_RAW_LINE
+static int _gets_raw(xioDev_t *d, xioUsart_t *dx);
+#endif
 
 /*
  *	xio_init_usart() - general purpose USART initialization (shared)
@@ -135,6 +145,10 @@ FILE *xio_open_usart(const uint8_t dev, const char *addr, const flags_t flags)
 	dx->rx_buf_tail = 1;
 	dx->tx_buf_head = 1;
 	dx->tx_buf_tail = 1;
+#ifdef __TX_PRIORITY
+	dx->tx_pri_head = 1;
+	dx->tx_pri_tail = 1;
+#endif
 
 	// baud rate and USART setup (do this last)
 	dx->usart = (USART_t *)pgm_read_word(&cfgUsart[idx].usart);
@@ -188,7 +202,7 @@ void xio_xoff_usart(xioUsart_t *dx)
 		// If using XON/XOFF flow control
 		if (cfg.enable_flow_control == FLOW_CONTROL_XON) {
 			dx->fc_char_rx = XOFF;
-			dx->usart->CTRLA = CTRLA_RXON_TXON;		// force a TX interrupt
+			dx->usart->CTRLA = CTRLA_USB_TXON;		// force a TX interrupt
 		}
 
 		// If using hardware flow control. The CTS pin on the *FTDI* is our RTS.
@@ -207,7 +221,7 @@ void xio_xon_usart(xioUsart_t *dx)
 		// If using XON/XOFF flow control
 		if (cfg.enable_flow_control == FLOW_CONTROL_XON) {
 			dx->fc_char_rx = XON;
-			dx->usart->CTRLA = CTRLA_RXON_TXON;		// force a TX interrupt
+			dx->usart->CTRLA = CTRLA_USB_TXON;		// force a TX interrupt
 		}
 
 		// If using hardware flow control. The CTS pin on the *FTDI* is our RTS.
@@ -264,6 +278,9 @@ int xio_gets_usart(xioDev_t *d, char *buf, const int size)
 {
 	xioUsart_t *dx = d->x;						// USART pointer
 
+#ifdef __USART_RX_DMA
+	if (dx == &USBu) { xio_usb_rx_dma_drain();}	// bulk-move DMA'd chars into the RX ring
+#endif
 	if (d->flag_in_line == false) {				// first time thru initializations
 		d->flag_in_line = true;					// yes, we are busy getting a line
 		d->len = 0;								// zero buffer
@@ -271,6 +288,11 @@ int xio_gets_usart(xioDev_t *d, char *buf, const int size)
 		d->size = size;
 		d->signal = XIO_SIG_OK;					// reset signal register
 	}
+#ifdef __XIO_RAW_LINE
+	if (d->flag_echo == false) {				// machine-to-machine channel - take the bulk scan
+		return (_gets_raw(d,dx));
+	}
+#endif
 	while (true) {
 		switch (_gets_helper(d,dx)) {
 			case (XIO_BUFFER_EMPTY): return (XIO_EAGAIN); // empty condition
@@ -312,6 +334,55 @@ static int _gets_helper(xioDev_t *d, xioUsart_t *dx)
 	return (XIO_EAGAIN);
 }
 
+#ifdef __XIO_RAW_LINE
+/*
+ * _gets_raw() - bulk terminator scan for echo-off channels
+ *
+ *	Functionally identical to looping _gets_helper() with echo off, but the
+ *	per-character costs are hoisted out of the loop: no function call and
+ *	switch dispatch per byte, no echo flag test, no flow control callback,
+ *	and the volatile ring indexes are read once and committed once. The ISR
+ *	only ever adds characters behind the head snapshot, so scanning up to it
+ *	is safe. Flow control runs once per drain instead of once per byte.
+ */
+static int _gets_raw(xioDev_t *d, xioUsart_t *dx)
+{
+	buffer_t tail = dx->rx_buf_tail;			// local copies - no volatile re-reads in the loop
+	buffer_t head = dx->rx_buf_head;
+	char *buf = d->buf;
+	int len = d->len;
+
+	while (tail != head) {
+		if (--tail == 0) { tail = RX_BUFFER_SIZE-1;}	// same geometry as advance_buffer()
+		char c = (dx->rx_buf[tail] & 0x007F);	// get char from RX Q & mask MSB
+		if ((c == CR) || (c == LF)) {			// handle CR, LF termination
+			buf[len++] = NUL;
+			d->len = len;
+			d->signal = XIO_SIG_EOL;
+			d->flag_in_line = false;			// clear in-line state (reset)
+			dx->rx_buf_tail = tail;
+			dx->rx_buf_count = xio_get_rx_bufcount_usart(dx);
+			d->x_flow(d);						// run flow control
+			return (XIO_OK);
+		}
+		if (len >= d->size) {					// handle buffer overruns
+			buf[d->size] = NUL;					// terminate line (d->size is zero based)
+			d->signal = XIO_SIG_EOL;
+			dx->rx_buf_tail = tail;
+			dx->rx_buf_count = xio_get_rx_bufcount_usart(dx);
+			d->x_flow(d);
+			return (XIO_BUFFER_FULL);
+		}
+		buf[len++] = c;
+	}
+	d->len = len;								// no terminator yet - hold the partial line
+	dx->rx_buf_tail = tail;
+	dx->rx_buf_count = 0;						// reset count for good measure
+	d->x_flow(d);
+	return (XIO_EAGAIN);
+}
+#endif // __XIO_RAW_LINE
+
 /*
  *  xio_getc_usart() - generic char reader for USART devices
  *
@@ -346,6 +417,12 @@ int xio_getc_usart(FILE *stream)
 	char c;
 
 	while (dx->rx_buf_head == dx->rx_buf_tail) {	// RX ISR buffer empty
+#ifdef __USART_RX_DMA
+		if (dx == &USBu) {
+			xio_usb_rx_dma_drain();					// RX arrives by DMA - poll it into the ring
+			if (dx->rx_buf_head != dx->rx_buf_tail) { break;}
+		}
+#endif
 		dx->rx_buf_count = 0;						// reset count for good measure
 		if (d->flag_block) {
 			sleep_mode();
@@ -37,6 +37,19 @@
 #define CTRLA_RXOFF_TXON_TXCON (USART_DREINTLVL_MED_gc | USART_TXCINTLVL_MED_gc)
 #define CTRLA_RXOFF_TXOFF_TXCON (USART_TXCINTLVL_MED_gc)
 
+// USB-side interrupt settings. With __USART_RX_DMA the received bytes arrive by DMA
+// and the RXC interrupt must stay off everywhere, so all USB CTRLA writes go through
+// these. RS485 keeps its RXC interrupt either way.
+#ifdef __USART_RX_DMA
+#define CTRLA_RXOFF_TXON (USART_DREINTLVL_MED_gc)
+#define CTRLA_RXOFF_TXOFF (0)
+#define CTRLA_USB_TXON CTRLA_RXOFF_TXON
+#define CTRLA_USB_TXOFF CTRLA_RXOFF_TXOFF
+#else
+#define CTRLA_USB_TXON CTRLA_RXON_TXON
+#define CTRLA_USB_TXOFF CTRLA_RXON_TXOFF
+#endif
+
 // Maps RX to medium and TX to lo interrupt levels
 // But don't use this or exception reports and other prints from medium interrupts
 // can cause the system to lock up if the TX buffer is full. See xio.h for explanation.
@@ -47,6 +60,15 @@
 //#define CTRLA_RXOFF_TXOFF_TXCON (USART_TXCINTLVL_LO_gc)
 
 // Buffer sizing
+#ifdef __BIG_SERIAL_BUFFERS						// set by the ReleaseBigBuffers build configuration
+#define buffer_t uint16_t						// slower, but larger buffers
+#define RX_BUFFER_SIZE (buffer_t)1022			// 2046 is the practical upper limit
+#define TX_BUFFER_SIZE (buffer_t)1022			// 2046 is practical upper limit given RAM
+#elif defined(__HEADLESS)						// set by the ReleaseHeadless build configuration
+#define buffer_t uint16_t						// slower, but larger buffers
+#define RX_BUFFER_SIZE (buffer_t)510			// deeper RX ring absorbs streaming bursts
+#define TX_BUFFER_SIZE (buffer_t)254			// TX is paced by reports - no need to grow it
+#else
 #define buffer_t uint_fast8_t					// fast, but limits buffer to 255 char max
 //#define buffer_t uint16_t						// larger buffers
 
@@ -62,6 +84,15 @@
 //#define TX_BUFFER_SIZE (buffer_t)510			// buffer_t must be 16 bits if >255
 //#define RX_BUFFER_SIZE (buffer_t)1022			// 2046 is the practical upper limit
 //#define TX_BUFFER_SIZE (buffer_t)1022			// 2046 is practical upper limit given RAM
+#endif // __BIG_SERIAL_BUFFERS
+
+#ifdef __TX_PRIORITY
+#define TX_PRIORITY_BUFFER_SIZE (buffer_t)64	// high-priority TX ring - sized for an ack or qr line
+#endif
+
+#ifdef __USART_RX_DMA
+#define RX_DMA_BUFFER_SIZE 256					// must be exactly 256 so the uint8_t ring index wraps for free
+#endif
 
 // XON/XOFF hi and lo watermarks. At 115.200 the host has approx. 100 uSec per char
 // to react to an XOFF. 90% (0.9) of 255 chars gives 25 chars to react, or about 2.5 ms.
@@ -175,12 +206,21 @@ typedef struct xioUSART {
 	volatile buffer_t tx_buf_tail;			// TX buffer read index  (written by ISR)
 	volatile buffer_t tx_buf_head;			// TX buffer write index
 	volatile buffer_t tx_buf_count;
+#ifdef __TX_PRIORITY
+	volatile buffer_t tx_pri_tail;			// priority TX ring read index (written by ISR)
+	volatile buffer_t tx_pri_head;			// priority TX ring write index
+	volatile uint8_t tx_pri_mode;			// writes route to the priority ring while true
+	volatile uint8_t tx_bulk_midline;		// last bulk byte sent was not a line ending (written by ISR)
+#endif
 
 	USART_t *usart;							// xmega USART structure
 	PORT_t	*port;							// corresponding port
 
 	volatile char rx_buf[RX_BUFFER_SIZE];	// (written by ISR)
 	volatile char tx_buf[TX_BUFFER_SIZE];
+#ifdef __TX_PRIORITY
+	volatile char tx_pri_buf[TX_PRIORITY_BUFFER_SIZE];
+#endif
 } xioUsart_t;
 
 /******************************************************************************
@@ -196,6 +236,22 @@ int xio_gets_usart(xioDev_t *d, char *buf, const int size);
 int xio_getc_usart(FILE *stream);
 int xio_putc_usart(const char c, FILE *stream);
 int xio_putc_usb(const char c, FILE *stream);	// stdio compatible put character
+#ifdef __TX_PRIORITY
+void xio_set_tx_priority_usb(const uint8_t enable);	// route writes to the high-priority TX ring
+#endif
+#ifdef __USART_TX_DMA
+void xio_init_usb_tx_dma(void);					// setup DMA CH0 for USB block transmit
+uint8_t xio_usb_tx_dma_busy(void);				// true while a DMA transfer is in flight
+int xio_write_usb(const char *buf, uint16_t len); // transmit a whole buffer via DMA
+#ifdef __TX_CHUNKED
+stat_t xio_tx_flush_callback(void);				// drain a parked response into the TX ring
+#endif
+#endif
+#ifdef __USART_RX_DMA
+void xio_init_usb_rx_dma(void);					// setup DMA CH1 for USB receive
+void xio_usb_rx_dma_drain(void);				// bulk-move received chars into the RX ring
+void xio_usb_rx_dma_sync(void);					// discard undrained DMA bytes
+#endif
 int xio_putc_rs485(const char c, FILE *stream);	// stdio compatible put character
 void xio_enable_rs485_rx(void);					// needed for startup
 void xio_enable_rs485_tx(void);					// included for completeness
@@ -204,6 +260,7 @@ void xio_enable_rs485_tx(void);					// included for completeness
 buffer_t xio_get_rx_bufcount_usart(const xioUsart_t *dx);
 buffer_t xio_get_tx_bufcount_usart(const xioUsart_t *dx);
 buffer_t xio_get_usb_rx_free(void);
+buffer_t xio_get_usb_tx_free(void);
 void xio_reset_usb_rx_buffers(void);
 
 void xio_queue_RX_char_usart(const uint8_t dev, const char c);
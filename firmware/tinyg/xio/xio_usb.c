@@ -35,6 +35,7 @@
 #include "../hardware.h"
 #include "../controller.h"
 #include "../canonical_machine.h"		// trapped characters communicate directly with the canonical machine
+#include "../diagnostics.h"				// RX queue high water mark
 
 /*
  * xio_putc_usb()
@@ -51,29 +52,65 @@
  *	an interrupt.
  */
 
+#ifdef __TX_PRIORITY
+/*
+ * Priority TX ring
+ *
+ *	A small second TX ring that the DRE interrupt drains ahead of the bulk ring,
+ *	so protocol-critical bytes (command acks, queue reports) are never stuck
+ *	behind a 200 byte status report already queued for transmission. Writers
+ *	turn the ring on around an emission with xio_set_tx_priority_usb() - all
+ *	chars written while enabled route here. The ISR only switches rings at line
+ *	boundaries (tracked in tx_bulk_midline) so a line already in transmission
+ *	from the bulk ring is never split by priority bytes.
+ */
+
+void xio_set_tx_priority_usb(const uint8_t enable) { USBu.tx_pri_mode = enable; }
+
+static void _putc_usb_pri(const char c)
+{
+	buffer_t next_tx_pri_head = USBu.tx_pri_head-1;
+	if (next_tx_pri_head == 0)
+		next_tx_pri_head = TX_PRIORITY_BUFFER_SIZE-1;	// detect wrap and adjust; -1 avoids off-by-one
+	while (next_tx_pri_head == USBu.tx_pri_tail)
+		sleep_mode();									// sleep until there is space in the ring
+	USBu.usart->CTRLA = CTRLA_USB_TXOFF;				// disable TX interrupt (mutex region)
+	USBu.tx_pri_head = next_tx_pri_head;
+	USBu.tx_pri_buf[USBu.tx_pri_head] = c;
+	USBu.usart->CTRLA = CTRLA_USB_TXON;				// force interrupt to send the char
+}
+#endif // __TX_PRIORITY
+
 int xio_putc_usb(const char c, FILE *stream)
 {
+#ifdef __TX_PRIORITY
+	if (USBu.tx_pri_mode) {
+		_putc_usb_pri(c);
+		if ((c == '\n') && (USB.flag_crlf)) { _putc_usb_pri(CR);}	// expand <LF> to <LF><CR> if $ec is set
+		return (XIO_OK);
+	}
+#endif
 	buffer_t next_tx_buf_head = USBu.tx_buf_head-1;		// set next head while leaving current one alone
 	if (next_tx_buf_head == 0)
 		next_tx_buf_head = TX_BUFFER_SIZE-1; 			// detect wrap and adjust; -1 avoids off-by-one
 	while (next_tx_buf_head == USBu.tx_buf_tail)
 		sleep_mode(); 									// sleep until there is space in the buffer
-	USBu.usart->CTRLA = CTRLA_RXON_TXOFF;				// disable TX interrupt (mutex region)
+	USBu.usart->CTRLA = CTRLA_USB_TXOFF;				// disable TX interrupt (mutex region)
 	USBu.tx_buf_head = next_tx_buf_head;				// accept next buffer head
 	USBu.tx_buf[USBu.tx_buf_head] = c;					// write char to buffer
 
 	// expand <LF> to <LF><CR> if $ec is set
 	if ((c == '\n') && (USB.flag_crlf)) {
-		USBu.usart->CTRLA = CTRLA_RXON_TXON;			// force interrupt to send the queued <CR>
+		USBu.usart->CTRLA = CTRLA_USB_TXON;			// force interrupt to send the queued <CR>
 		buffer_t next_tx_buf_head = USBu.tx_buf_head-1;
 		if (next_tx_buf_head == 0) next_tx_buf_head = TX_BUFFER_SIZE-1;
 		while (next_tx_buf_head == USBu.tx_buf_tail) sleep_mode();
-		USBu.usart->CTRLA = CTRLA_RXON_TXOFF;			// MUTEX region
+		USBu.usart->CTRLA = CTRLA_USB_TXOFF;			// MUTEX region
 		USBu.tx_buf_head = next_tx_buf_head;
 		USBu.tx_buf[USBu.tx_buf_head] = CR;
 	}
 	// finish up
-	USBu.usart->CTRLA = CTRLA_RXON_TXON;			// force interrupt to send char(s) - doesn't work if you just |= it
+	USBu.usart->CTRLA = CTRLA_USB_TXON;			// force interrupt to send char(s) - doesn't work if you just |= it
 	return (XIO_OK);
 }
 
@@ -81,7 +118,7 @@ ISR(USB_TX_ISR_vect) //ISR(USARTC0_DRE_vect)		// USARTC0 data register empty
 {
 	// If the CTS pin (FTDI's RTS) is HIGH, then we cannot send anything, so exit
 	if ((cfg.enable_flow_control == FLOW_CONTROL_RTS) && (USBu.port->IN & USB_CTS_bm)) {
-		USBu.usart->CTRLA = CTRLA_RXON_TXOFF;		// force another TX interrupt
+		USBu.usart->CTRLA = CTRLA_USB_TXOFF;		// force another TX interrupt
 		return;
 	}
 
@@ -97,12 +134,26 @@ ISR(USB_TX_ISR_vect) //ISR(USARTC0_DRE_vect)		// USARTC0 data register empty
 		return;
 	}
 
+#ifdef __TX_PRIORITY
+	// Drain the priority ring first, but never split a line already in transmission
+	// from the bulk ring. With the bulk ring empty any unterminated output is
+	// complete (e.g. a text-mode prompt), so the priority ring may proceed.
+	if ((USBu.tx_pri_head != USBu.tx_pri_tail) &&
+		((USBu.tx_bulk_midline == false) || (USBu.tx_buf_head == USBu.tx_buf_tail))) {
+		advance_buffer(USBu.tx_pri_tail, TX_PRIORITY_BUFFER_SIZE);
+		USBu.usart->DATA = USBu.tx_pri_buf[USBu.tx_pri_tail];
+		return;
+	}
+#endif
 	// Otherwise process normal TX transmission
 	if (USBu.tx_buf_head != USBu.tx_buf_tail) {		// buffer has data
 		advance_buffer(USBu.tx_buf_tail, TX_BUFFER_SIZE);
+#ifdef __TX_PRIORITY
+		USBu.tx_bulk_midline = ((USBu.tx_buf[USBu.tx_buf_tail] != LF) && (USBu.tx_buf[USBu.tx_buf_tail] != CR));
+#endif
 		USBu.usart->DATA = USBu.tx_buf[USBu.tx_buf_tail];
 	} else {
-		USBu.usart->CTRLA = CTRLA_RXON_TXOFF;		// buffer has no data; force another interrupt
+		USBu.usart->CTRLA = CTRLA_USB_TXOFF;		// buffer has no data; force another interrupt
 	}
 }
 
@@ -112,8 +163,123 @@ ISR(USB_TX_ISR_vect) //ISR(USARTC0_DRE_vect)		// USARTC0 data register empty
 
 ISR(USB_CTS_ISR_vect)
 {
-	USBu.usart->CTRLA = CTRLA_RXON_TXON;		// force another interrupt
+	USBu.usart->CTRLA = CTRLA_USB_TXON;		// force another interrupt
+}
+
+#ifdef __USART_TX_DMA
+/*
+ * DMA-driven block transmit for the USB USART
+ *
+ *	xio_init_usb_tx_dma() - one-time setup of DMA channel 0 for USARTC0 TX
+ *	xio_usb_tx_dma_busy() - true while a DMA transfer is in flight
+ *	xio_write_usb()		  - queue a whole buffer for transmission in one shot
+ *
+ *	Large reports (status reports, config dumps) normally drain through the
+ *	per-byte DRE interrupt, stealing MED-level interrupt time from EXEC/PREP.
+ *	xio_write_usb() instead copies the output into a private DMA buffer and
+ *	hands it to DMA CH0, which feeds USARTC0.DATA one byte per DRE trigger
+ *	with no CPU involvement. The DRE interrupt is held off while DMA owns the
+ *	transmitter and re-enabled from the transfer-complete interrupt so any
+ *	chars queued through xio_putc_usb() in the meantime still drain.
+ *
+ *	Falls back to the stdio path if DMA is already busy, the TX ring has
+ *	queued data (ordering), or TX-side XOFF is in effect. CRLF expansion is
+ *	not applied to DMA writes - callers emit fully-formed lines.
+ */
+
+static char usb_tx_dma_buf[OUTPUT_BUFFER_LEN];
+static volatile uint8_t usb_tx_dma_busy = false;
+
+#ifdef __TX_CHUNKED
+static const char *tx_chunk_ptr;				// next unsent char of a parked response
+static volatile uint16_t tx_chunk_remaining = 0;// chars left to drain; 0 means nothing is parked
+#endif
+
+void xio_init_usb_tx_dma(void)
+{
+	DMA.CTRL |= DMA_ENABLE_bm;							// enable the DMA controller
+	DMA.CH0.CTRLA = 0;									// reset the channel
+	DMA.CH0.CTRLB = DMA_CH_TRNINTLVL_LO_gc;				// interrupt on transaction complete
+	DMA.CH0.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_INC_gc |
+					   DMA_CH_DESTRELOAD_NONE_gc | DMA_CH_DESTDIR_FIXED_gc;
+	DMA.CH0.TRIGSRC = DMA_CH_TRIGSRC_USARTC0_DRE_gc;	// one byte per data-register-empty
+	DMA.CH0.DESTADDR0 = (uint8_t)((uint16_t)&USBu.usart->DATA);
+	DMA.CH0.DESTADDR1 = (uint8_t)((uint16_t)&USBu.usart->DATA >> 8);
+	DMA.CH0.DESTADDR2 = 0;
+}
+
+uint8_t xio_usb_tx_dma_busy(void) { return (usb_tx_dma_busy); }
+
+int xio_write_usb(const char *buf, uint16_t len)
+{
+	if ((len == 0) || (len >= sizeof(usb_tx_dma_buf))) { return (XIO_BUFFER_FULL); }
+
+	if ((usb_tx_dma_busy == true) ||						// transfer in flight
+		(USBu.tx_buf_head != USBu.tx_buf_tail) ||			// ring has data - preserve ordering
+#ifdef __TX_CHUNKED
+		(tx_chunk_remaining != 0) ||						// a parked response is still draining - preserve ordering
+#endif
+		(USBu.fc_state_tx == FC_IN_XOFF)) {					// host asked us to stop
+#ifdef __TX_CHUNKED
+		if (tx_chunk_remaining == 0) {
+			tx_chunk_ptr = buf;								// park it; the caller's buffer must stay intact
+			tx_chunk_remaining = len;						// until the controller drains it (see controller.c)
+			xio_tx_flush_callback();						// opportunistic first chunk
+			return (XIO_OK);
+		}
+#endif
+		fprintf(stderr, "%s", buf);							// per-byte fallback path
+		return (XIO_OK);
+	}
+	memcpy(usb_tx_dma_buf, buf, len);
+	usb_tx_dma_busy = true;
+	USBu.usart->CTRLA = CTRLA_USB_TXOFF;					// DRE interrupt off - DMA owns TX
+
+	DMA.CH0.SRCADDR0 = (uint8_t)((uint16_t)usb_tx_dma_buf);
+	DMA.CH0.SRCADDR1 = (uint8_t)((uint16_t)usb_tx_dma_buf >> 8);
+	DMA.CH0.SRCADDR2 = 0;
+	DMA.CH0.TRFCNT = len;
+	DMA.CH0.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+	return (XIO_OK);
+}
+
+ISR(DMA_CH0_vect)
+{
+	DMA.CH0.CTRLB |= DMA_CH_TRNIF_bm;						// clear the interrupt flag
+	usb_tx_dma_busy = false;
+	USBu.usart->CTRLA = CTRLA_USB_TXON;					// hand TX back to the DRE interrupt
+}
+
+#ifdef __TX_CHUNKED
+/*
+ * xio_tx_flush_callback() - drain a parked response into the TX ring, a chunk at a time
+ *
+ *	When xio_write_usb() cannot start a DMA transfer it parks the caller's buffer here
+ *	instead of blocking in the stdio path. The controller dispatches this callback each
+ *	pass and it stuffs only as many chars as the TX ring is known to have room for, so
+ *	xio_putc_usb() never sleeps. Returns STAT_EAGAIN while chars remain - the controller
+ *	restarts its loop on that, which keeps cs.out_buf untouched until the drain finishes
+ *	(reports, preparse and command dispatch all run downstream of this callback).
+ *
+ *	Parked responses drain through the bulk ring regardless of the priority-ring mode
+ *	in effect when they were parked - the 64 byte priority ring is sized for acks, not
+ *	for the oversized responses that get parked in the first place.
+ */
+stat_t xio_tx_flush_callback(void)
+{
+	if (tx_chunk_remaining == 0) { return (STAT_NOOP); }
+	buffer_t space = xio_get_usb_tx_free();
+	uint16_t count = (space > 4) ? ((space-2) >> 1) : 0;	// halved for worst-case CRLF expansion
+	if (count > tx_chunk_remaining) { count = tx_chunk_remaining; }
+	tx_chunk_remaining -= count;
+	while (count-- != 0) {
+		xio_putc_usb(*tx_chunk_ptr++, NULL);				// space was verified - will not block
+	}
+	if (tx_chunk_remaining != 0) { return (STAT_EAGAIN); }
+	return (STAT_OK);
 }
+#endif // __TX_CHUNKED
+#endif // __USART_TX_DMA
 
 /*
  * USB_RX_ISR - USB receiver interrupt (RX)
@@ -135,10 +301,8 @@ ISR(USB_CTS_ISR_vect)
  *	- Low water mark about 50% full
  */
 
-ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
+static void _rx_char(const char c)
 {
-	char c = USBu.usart->DATA;					// can only read DATA once
-
 	if (cs.network_mode == NETWORK_MASTER) {	// forward character if you are a master
 		net_forward(c);
 	}
@@ -166,7 +330,7 @@ ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
 		}
 		if (c == XON) {
 			USBu.fc_state_tx = FC_IN_XON;
-			USBu.usart->CTRLA = CTRLA_RXON_TXOFF;// force a TX interrupt
+			USBu.usart->CTRLA = CTRLA_USB_TXOFF;// force a TX interrupt
 			return;
 		}
 	}
@@ -180,10 +344,19 @@ ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
 	if (USBu.rx_buf_head != USBu.rx_buf_tail) {	// buffer is not full
 		USBu.rx_buf[USBu.rx_buf_head] = c;		// write char unless full
 		USBu.rx_buf_count++;
+#ifdef __DIAG
+		if (USBu.rx_buf_count > dia.rx_hiwater) { dia.rx_hiwater = USBu.rx_buf_count;}
+#endif
 		if ((USB.flag_xoff) && (xio_get_rx_bufcount_usart(&USBu) > XOFF_RX_HI_WATER_MARK)) {
 			xio_xoff_usart(&USBu);
 		}
 	} else { 											// buffer-full - toss the incoming character
+#ifdef __EVENT_TRACE
+		dia_trace_event(DIA_EVENT_RX_OVERRUN, c);
+#endif
+#ifdef __HIGH_BAUD
+		dia.rx_overrun_count++;
+#endif
 		if ((++USBu.rx_buf_head) > RX_BUFFER_SIZE-1) {	// reset the head
 			USBu.rx_buf_count = RX_BUFFER_SIZE-1;		// reset count for good measure
 			USBu.rx_buf_head = 1;
@@ -191,6 +364,90 @@ ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
 	}
 }
 
+#ifndef __USART_RX_DMA
+ISR(USB_RX_ISR_vect)	//ISR(USARTC0_RXC_vect)	// serial port C0 RX int
+{
+#ifdef __HIGH_BAUD
+	uint8_t status = USBu.usart->STATUS;		// sample error flags before DATA clears them
+	if (status & USART_FERR_bm) { dia.rx_ferr_count++;}
+	if (status & USART_BUFOVF_bm) { dia.rx_overrun_count++;}
+#endif
+	_rx_char(USBu.usart->DATA);					// can only read DATA once
+}
+#endif
+
+#ifdef __USART_RX_DMA
+/*
+ * DMA-to-ring receive for the USB USART
+ *
+ *	xio_init_usb_rx_dma()  - one-time setup of DMA channel 1 for USARTC0 RX
+ *	xio_usb_rx_dma_drain() - bulk-move received chars from the DMA ring to the RX buffer
+ *	xio_usb_rx_dma_sync()  - discard undrained DMA bytes (RX buffer reset)
+ *
+ *	Sustained streaming at 115200 baud costs ~11k MED-level RXC interrupts a
+ *	second, fixed overhead competing with EXEC and PREP. Instead DMA CH1 copies
+ *	each received byte into a 256 byte ring - REPEAT mode reloads the destination
+ *	forever so the hardware wraps by itself - and the RXC interrupt stays off
+ *	(see CTRLA_USB_TXON in xio_usart.h). The drain runs from xio_gets_usart(),
+ *	once per controller pass, and performs the same per-character triage the ISR
+ *	did (signal traps, XON/XOFF, flow control) in one tight mainline loop.
+ *	Signal characters (feedhold et al) are thus seen a controller pass later
+ *	than with the interrupt - well inside their response requirements.
+ *
+ *	The hardware write index is recovered from TRFCNT, which is read twice until
+ *	stable because the DMA can decrement it between the two byte accesses of a
+ *	16 bit read. Bytes are at least 87 uSec apart so this settles immediately.
+ */
+
+static char usb_rx_dma_buf[RX_DMA_BUFFER_SIZE];
+static uint8_t usb_rx_dma_tail;
+
+static uint8_t _rx_dma_head(void)
+{
+	uint16_t t;
+	do { t = DMA.CH1.TRFCNT; } while (t != DMA.CH1.TRFCNT);
+	return ((uint8_t)(RX_DMA_BUFFER_SIZE - t));
+}
+
+void xio_init_usb_rx_dma(void)
+{
+	DMA.CTRL |= DMA_ENABLE_bm;							// enable the DMA controller
+	DMA.CH1.CTRLA = 0;									// reset the channel
+	DMA.CH1.CTRLB = 0;									// no interrupts - the drain polls TRFCNT
+	DMA.CH1.ADDRCTRL = DMA_CH_SRCRELOAD_NONE_gc | DMA_CH_SRCDIR_FIXED_gc |
+					   DMA_CH_DESTRELOAD_BLOCK_gc | DMA_CH_DESTDIR_INC_gc;
+	DMA.CH1.TRIGSRC = DMA_CH_TRIGSRC_USARTC0_RXC_gc;	// one byte per reception-complete
+	DMA.CH1.SRCADDR0 = (uint8_t)((uint16_t)&USBu.usart->DATA);
+	DMA.CH1.SRCADDR1 = (uint8_t)((uint16_t)&USBu.usart->DATA >> 8);
+	DMA.CH1.SRCADDR2 = 0;
+	DMA.CH1.DESTADDR0 = (uint8_t)((uint16_t)usb_rx_dma_buf);
+	DMA.CH1.DESTADDR1 = (uint8_t)((uint16_t)usb_rx_dma_buf >> 8);
+	DMA.CH1.DESTADDR2 = 0;
+	DMA.CH1.TRFCNT = RX_DMA_BUFFER_SIZE;
+	DMA.CH1.REPCNT = 0;									// repeat forever - the buffer is a hardware ring
+	DMA.CH1.CTRLA = DMA_CH_ENABLE_bm | DMA_CH_REPEAT_bm | DMA_CH_SINGLE_bm | DMA_CH_BURSTLEN_1BYTE_gc;
+	usb_rx_dma_tail = 0;
+	USBu.usart->CTRLA = CTRLA_USB_TXON;					// RXC interrupt off - DMA owns RX from here
+}
+
+void xio_usb_rx_dma_drain(void)
+{
+#ifdef __HIGH_BAUD
+	// Opportunistic sample - the DMA consumes the per-character error flags, so
+	// this undercounts, but a nonzero reading still disqualifies a baud rate.
+	uint8_t status = USBu.usart->STATUS;
+	if (status & USART_FERR_bm) { dia.rx_ferr_count++;}
+	if (status & USART_BUFOVF_bm) { dia.rx_overrun_count++;}
+#endif
+	uint8_t head = _rx_dma_head();
+	while (usb_rx_dma_tail != head) {
+		_rx_char(usb_rx_dma_buf[usb_rx_dma_tail++]);
+	}
+}
+
+void xio_usb_rx_dma_sync(void) { usb_rx_dma_tail = _rx_dma_head();}
+#endif // __USART_RX_DMA
+
 /*
  * xio_get_usb_rx_free() - returns free space in the USB RX buffer
  *
@@ -201,6 +458,17 @@ buffer_t xio_get_usb_rx_free(void)
 	return (RX_BUFFER_SIZE - xio_get_rx_bufcount_usart(&USBu));
 }
 
+/*
+ * xio_get_usb_tx_free() - returns free space in the USB TX buffer
+ *
+ *	A stale tail read only under-reports free space, so the result is safe
+ *	to rely on without locking out the TX interrupt.
+ */
+buffer_t xio_get_usb_tx_free(void)
+{
+	return (TX_BUFFER_SIZE - xio_get_tx_bufcount_usart(&USBu));
+}
+
 /*
  * xio_reset_usb_rx_buffers() - clears the USB RX buffer
  */
@@ -213,4 +481,7 @@ void xio_reset_usb_rx_buffers(void)
 	// reset RX interrupt circular buffer
 	USBu.rx_buf_head = 1;		// can't use location 0 in circular buffer
 	USBu.rx_buf_tail = 1;
+#ifdef __USART_RX_DMA
+	xio_usb_rx_dma_sync();		// discard anything still parked in the DMA ring
+#endif
 }
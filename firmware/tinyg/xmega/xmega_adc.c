@@ -0,0 +1,89 @@
+/*
+ * xmega_adc.c - analog to digital converter driver
+ * Part of TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/*	Minimal single-channel driver for ADCA, used by the torch height controller
+ *	(thc.c). Conversions are started explicitly and never block: the caller
+ *	starts one, goes away, and collects the result on its next pass - at the
+ *	10ms control loop rate a conversion is always long finished. Follows the
+ *	setup sequence in app note AVR1300.
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+
+#include "../tinyg.h"
+#include "xmega_adc.h"
+
+/*
+ * adc_init() - set up ADCA channel 0 as a single-ended input on the given pin
+ *
+ *	12 bit unsigned, VCC/1.6 reference (3.3V boards: ~2.06V full scale), ADC
+ *	clock at 32MHz/64 = 500kHz so a conversion completes in well under 20us.
+ *	The first conversion is started here, so adc_read_sample() always has a
+ *	completed result to collect.
+ */
+
+void adc_init(uint8_t channel)
+{
+	ADCA.CTRLB = ADC_RESOLUTION_12BIT_gc;
+	ADCA.REFCTRL = ADC_REFSEL_VCC_gc;				// VCC/1.6 reference
+	ADCA.PRESCALER = ADC_PRESCALER_DIV64_gc;
+	ADCA.CH0.CTRL = ADC_CH_INPUTMODE_SINGLEENDED_gc;
+	ADCA.CH0.MUXCTRL = (channel << ADC_CH_MUXPOS_gp);
+	ADCA.CTRLA = ADC_ENABLE_bm;
+	ADCA.CH0.CTRL |= ADC_CH_START_bm;				// prime the first conversion
+}
+
+/*
+ * adc_read_sample() - collect the last conversion result and start the next one
+ */
+
+uint16_t adc_read_sample()
+{
+	uint16_t result = ADCA.CH0.RES;
+	ADCA.CH0.CTRL |= ADC_CH_START_bm;
+	return (result);
+}
+
+#ifdef __ADAPTIVE_FEED
+/*
+ * adc_init_load() / adc_read_load() - same driver on virtual channel 1
+ *
+ *	The spindle load input (afc.c) runs concurrently with the arc voltage
+ *	input, so it gets its own virtual channel. The common ADCA setup is
+ *	repeated here - the writes are idempotent, so init order doesn't matter.
+ */
+
+void adc_init_load(uint8_t channel)
+{
+	ADCA.CTRLB = ADC_RESOLUTION_12BIT_gc;
+	ADCA.REFCTRL = ADC_REFSEL_VCC_gc;				// VCC/1.6 reference
+	ADCA.PRESCALER = ADC_PRESCALER_DIV64_gc;
+	ADCA.CH1.CTRL = ADC_CH_INPUTMODE_SINGLEENDED_gc;
+	ADCA.CH1.MUXCTRL = (channel << ADC_CH_MUXPOS_gp);
+	ADCA.CTRLA = ADC_ENABLE_bm;
+	ADCA.CH1.CTRL |= ADC_CH_START_bm;				// prime the first conversion
+}
+
+uint16_t adc_read_load()
+{
+	uint16_t result = ADCA.CH1.RES;
+	ADCA.CH1.CTRL |= ADC_CH_START_bm;
+	return (result);
+}
+#endif // __ADAPTIVE_FEED
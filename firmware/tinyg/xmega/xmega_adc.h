@@ -0,0 +1,31 @@
+/*
+ * xmega_adc.h - analog to digital converter driver
+ * Part of TinyG project
+ *
+ * Copyright (c) 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef XMEGA_ADC_H_ONCE
+#define XMEGA_ADC_H_ONCE
+
+void adc_init(uint8_t channel);
+uint16_t adc_read_sample(void);
+
+#ifdef __ADAPTIVE_FEED
+void adc_init_load(uint8_t channel);
+uint16_t adc_read_load(void);
+#endif
+
+#endif // End of include guard: XMEGA_ADC_H_ONCE
@@ -0,0 +1,111 @@
+/*
+ * xmega_crc.c - CRC-16/CCITT generation (hardware CRC module where available)
+ * Part of TinyG project
+ *
+ * Copyright (c) 2010 - 2015 Alden S. Hart Jr.
+ *
+ * This file ("the software") is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2 as published by the
+ * Free Software Foundation. You should have received a copy of the GNU General Public
+ * License, version 2 along with the software.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ * THE SOFTWARE IS DISTRIBUTED IN THE HOPE THAT IT WILL BE USEFUL, BUT WITHOUT ANY
+ * WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES
+ * OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT
+ * SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF
+ * OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+/* One CRC kernel for the image hashing done around the firmware - the idle-time
+ * flash scrub (controller.c) and anything else that needs a CRC-16/CCITT over a
+ * RAM buffer or a flash range. Callers thread a running CRC through successive
+ * calls (seed 0xFFFF), so long regions can be hashed in small slices.
+ *
+ * The AU/B/C xmega families have a hardware CRC generator that computes exactly
+ * this polynomial (0x1021). Where the device header exposes it the block
+ * functions feed the module through DATAIN, seeding CHECKSUM with the running
+ * CRC so slicing still works. The A3 parts on current boards predate the module,
+ * so they get a nibble-table software kernel instead - 2 lookups per byte beats
+ * the 8-shift loop about 4:1, and the 32-byte table lives in PROGMEM.
+ *
+ * Note what does NOT come through here: the JSON footer checksum is the Java
+ * hashCode scheme hosts already verify (util.c), and the $fr line frames use the
+ * reflected 0xA001 polynomial (avr-libc _crc16_update). Neither is producible by
+ * the CRC module, and both are wire protocol - changing them orphans the hosts.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+
+#include "../tinyg.h"
+#include "xmega_crc.h"
+
+#if defined(__HW_CRC) && defined(CRC_SOURCE_IO_gc)	// device has the CRC module
+
+/*
+ * crc16_ccitt_block() - run a RAM buffer through the CRC module
+ * crc16_ccitt_flash() - run a flash range through the CRC module
+ *
+ *	The module is seeded with the caller's running CRC (CHECKSUM is writable
+ *	while SOURCE is disabled), so these chain exactly like the software kernel.
+ *	IO mode is used for both cases - flash bytes are fetched with
+ *	pgm_read_byte_far() and fed through DATAIN like any others, which keeps the
+ *	driver off the NVM controller and works for ranges that don't start on a
+ *	page boundary.
+ */
+
+uint16_t crc16_ccitt_block(uint16_t crc, const uint8_t *buf, uint16_t len)
+{
+	CRC.CTRL = CRC_SOURCE_DISABLE_gc;			// unlock the checksum registers
+	CRC.CHECKSUM0 = (uint8_t)crc;				// seed with the running CRC
+	CRC.CHECKSUM1 = (uint8_t)(crc >> 8);
+	CRC.CTRL = CRC_SOURCE_IO_gc;				// CRC-16 is the reset default (CRC32 bit clear)
+	for (uint16_t i=0; i<len; i++) { CRC.DATAIN = buf[i];}
+	CRC.STATUS = CRC_BUSY_bm;					// signal end of IO data
+	crc = ((uint16_t)CRC.CHECKSUM1 << 8) | CRC.CHECKSUM0;
+	CRC.CTRL = CRC_SOURCE_DISABLE_gc;
+	return (crc);
+}
+
+uint16_t crc16_ccitt_flash(uint16_t crc, uint32_t addr, uint16_t len)
+{
+	CRC.CTRL = CRC_SOURCE_DISABLE_gc;
+	CRC.CHECKSUM0 = (uint8_t)crc;
+	CRC.CHECKSUM1 = (uint8_t)(crc >> 8);
+	CRC.CTRL = CRC_SOURCE_IO_gc;
+	for (uint16_t i=0; i<len; i++) { CRC.DATAIN = pgm_read_byte_far(addr++);}
+	CRC.STATUS = CRC_BUSY_bm;
+	crc = ((uint16_t)CRC.CHECKSUM1 << 8) | CRC.CHECKSUM0;
+	CRC.CTRL = CRC_SOURCE_DISABLE_gc;
+	return (crc);
+}
+
+#else	// no CRC module (A3 parts) - nibble-table software kernel
+
+static const uint16_t crc16_hi_table[16] PROGMEM = {	// CCITT table for the high nibble
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+	0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+static uint16_t _crc16_byte(uint16_t crc, uint8_t data)
+{
+	crc = (crc << 4) ^ pgm_read_word(&crc16_hi_table[((crc >> 12) ^ (data >> 4)) & 0x0F]);
+	crc = (crc << 4) ^ pgm_read_word(&crc16_hi_table[((crc >> 12) ^ data) & 0x0F]);
+	return (crc);
+}
+
+uint16_t crc16_ccitt_block(uint16_t crc, const uint8_t *buf, uint16_t len)
+{
+	for (uint16_t i=0; i<len; i++) { crc = _crc16_byte(crc, buf[i]);}
+	return (crc);
+}
+
+uint16_t crc16_ccitt_flash(uint16_t crc, uint32_t addr, uint16_t len)
+{
+	for (uint16_t i=0; i<len; i++) { crc = _crc16_byte(crc, pgm_read_byte_far(addr++));}
+	return (crc);
+}
+
+#endif	// __HW_CRC
@@ -23,6 +23,10 @@
 #include "../tinyg.h"
 #include "../config.h"
 #include "../switch.h"
+#include "../spindle.h"
+#include "../thc.h"
+#include "../afc.h"
+#include "../diagnostics.h"
 #include "xmega_rtc.h"
 
 rtClock_t rtc;		// allocate clock control struct
@@ -72,8 +76,23 @@ void rtc_init()
 
 ISR(RTC_COMP_vect)
 {
+#ifdef __PC_PROFILE
+	dia_profile_sample(__builtin_return_address(0));	// sample the PC this tick interrupted
+#endif
 	rtc.sys_ticks = ++rtc.rtc_ticks*10;		// advance both tick counters as appropriate
 
 	// callbacks to whatever you need to happen on each RTC tick go here:
 	switch_rtc_callback();					// switch debouncing
+#ifdef __SPINDLE_RAMP
+	cm_spindle_ramp_callback();				// spindle speed ramping
+#endif
+#ifdef __SPINDLE_RPM
+	cm_spindle_rpm_callback();				// spindle RPM measurement readout
+#endif
+#ifdef __THC
+	thc_rtc_callback();						// torch height control loop
+#endif
+#ifdef __ADAPTIVE_FEED
+	afc_rtc_callback();						// adaptive feed control loop
+#endif
 }
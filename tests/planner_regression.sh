@@ -0,0 +1,63 @@
+#!/bin/sh
+# planner_regression.sh - replay the gcode corpus through the host simulator
+#
+# Builds tgsim (firmware/tinyg/sim) and replays every canned test file under
+# firmware/tinyg/gcode plus the real jobs in gcode_samples, recording the
+# deterministic planner statistics for each file (blocks queued, machine and
+# planned time, DDA ticks, queue low water / mean depth, step totals, final
+# position - see the -r row format in sim_main.c). Results are compared
+# against the golden baseline checked in as planner_baseline.csv, so any
+# planner or parser change shows its performance delta across representative
+# workloads before anything is flashed. Wall-clock throughput is printed to
+# the console but kept out of the baseline since it is host-dependent.
+#
+#   tests/planner_regression.sh            run and diff against the baseline
+#   tests/planner_regression.sh --rebase   accept current results as golden
+
+ROOT=$(cd "$(dirname "$0")/.." && pwd)
+SIM="$ROOT/firmware/tinyg/sim"
+GOLDEN="$ROOT/tests/planner_baseline.csv"
+CURRENT="$ROOT/tests/planner_current.csv"
+
+make -s -C "$SIM" || exit 1
+
+HEADER="file,lines,queued,dropped,arcs,machine_sec,planned_sec,dda_ticks,exec,load,qlow,qmean,m1,m2,m3,m4,x,y,z,a"
+echo "$HEADER" > "$CURRENT"
+
+corpus() {
+	ls "$ROOT"/firmware/tinyg/gcode/*.h
+	for f in "$ROOT"/gcode_samples/*.gcode "$ROOT"/gcode_samples/*.ngc \
+			 "$ROOT"/gcode_samples/*.txt; do
+		case $(basename "$f") in
+			_*|outfile.txt) ;;		# leading underscore marks a parked sample
+			*) [ -f "$f" ] && echo "$f" ;;
+		esac
+	done
+}
+
+start=$(date +%s)
+nfiles=0
+for f in $(corpus); do
+	"$SIM/tgsim" -r "$f" >> "$CURRENT" || exit 1
+	nfiles=$((nfiles + 1))
+done
+elapsed=$(($(date +%s) - start))
+blocks=$(awk -F, 'NR>1 { n += $3 } END { print n }' "$CURRENT")
+echo "replayed $nfiles files, $blocks blocks in ${elapsed}s"
+
+if [ "$1" = "--rebase" ]; then
+	cp "$CURRENT" "$GOLDEN"
+	echo "baseline rebased: $GOLDEN"
+	exit 0
+fi
+if [ ! -f "$GOLDEN" ]; then
+	echo "no baseline - run with --rebase to create one" >&2
+	exit 1
+fi
+if diff -u "$GOLDEN" "$CURRENT"; then
+	echo "PASS: corpus matches baseline"
+else
+	echo "FAIL: planner statistics changed - review the delta above;" >&2
+	echo "      rerun with --rebase if the change is intended" >&2
+	exit 1
+fi